@@ -241,6 +241,10 @@ typedef void *(*libvlc_video_lock_cb)(void *opaque, void **planes);
  *
  * \warning A picture buffer is unlocked after the picture is decoded,
  * but before the picture is displayed.
+ * If the video decoder renders directly into the picture buffers (see
+ * @ref libvlc_video_format_cb), a buffer is only unlocked once LibVLC does
+ * not use it anymore, which may be after it is displayed; it can then be
+ * reused.
  *
  * \param opaque private pointer as passed to libvlc_video_set_callbacks() [IN]
  * \param picture private pointer returned from the @ref libvlc_video_lock_cb
@@ -281,6 +285,12 @@ typedef void (*libvlc_video_display_cb)(void *opaque, void *picture);
  * \return the number of picture buffers allocated, 0 indicates failure
  *
  * \note
+ * If enough picture buffers are allocated (about 20, depending on the codec),
+ * the video decoder renders directly into them, which saves a copy of every
+ * picture. The lock callback then lends one of them for every decoded
+ * picture, and the unlock callback gives it back.
+ *
+ * \note
  * For each pixels plane, the scanline pitch must be bigger than or equal to
  * the number of bytes per pixel multiplied by the pixel width.
  * Similarly, the number of scanlines must be bigger than of equal to
@@ -85,6 +85,8 @@ typedef struct block_sys_t block_sys_t;
 #define BLOCK_FLAG_BOTTOM_FIELD_FIRST 0x4000
 /** This is the last block of the stream */
 #define BLOCK_FLAG_END_OF_STREAM 0x8000
+/** This picture is not used as a reference: it can be dropped undecoded */
+#define BLOCK_FLAG_DISPOSABLE    0x00010000
 
 /** This block contains an interlaced picture */
 #define BLOCK_FLAG_INTERLACED_MASK \
@@ -94,8 +96,8 @@ typedef struct block_sys_t block_sys_t;
     (BLOCK_FLAG_TYPE_I|BLOCK_FLAG_TYPE_P|BLOCK_FLAG_TYPE_B|BLOCK_FLAG_TYPE_PB)
 
 /* These are for input core private usage only */
-#define BLOCK_FLAG_CORE_PRIVATE_MASK  0x00ff0000
-#define BLOCK_FLAG_CORE_PRIVATE_SHIFT 16
+#define BLOCK_FLAG_CORE_PRIVATE_MASK  0x00fe0000
+#define BLOCK_FLAG_CORE_PRIVATE_SHIFT 17
 
 /* These are for module private usage only */
 #define BLOCK_FLAG_PRIVATE_MASK  0xff000000
@@ -291,6 +293,8 @@ static inline block_t *block_ChainGather( block_t *p_list )
  * Fifos of blocks.
  ****************************************************************************
  * - block_FifoNew : create and init a new fifo
+ * - block_FifoNewSPSC : create a fifo for exactly one producer thread and one
+ *      consumer thread, that does not lock in the common case
  * - block_FifoRelease : destroy a fifo and free all blocks in it.
  * - block_FifoPace : wait for a fifo to drain to a specified number of packets or total data size
  * - block_FifoEmpty : free all blocks in a fifo
@@ -307,6 +311,7 @@ static inline block_t *block_ChainGather( block_t *p_list )
  ****************************************************************************/
 
 VLC_API block_fifo_t * block_FifoNew( void ) VLC_USED;
+VLC_API block_fifo_t * block_FifoNewSPSC( void ) VLC_USED;
 VLC_API void block_FifoRelease( block_fifo_t * );
 VLC_API void block_FifoPace( block_fifo_t *fifo, size_t max_depth, size_t max_size );
 VLC_API void block_FifoEmpty( block_fifo_t * );
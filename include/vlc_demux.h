@@ -57,6 +57,10 @@ struct demux_t
     /* es output */
     es_out_t    *out;   /* our p_es_out */
 
+    /* Only the meta data and the length of the stream are wanted: the
+     * demuxer may skip building indexes, cues and the like */
+    bool        b_preparsing;
+
     /* set by demuxer */
     int (*pf_demux)  ( demux_t * );   /* demux one frame only */
     int (*pf_control)( demux_t *, int i_query, va_list args);
@@ -56,6 +56,9 @@ struct filter_t
     /* Output format of filter */
     es_format_t         fmt_out;
     bool                b_allow_fmt_out_change;
+    /* Set by video filters that can write their output over their input
+     * picture (same format, no pixel read after it was written) */
+    bool                b_video_inplace;
 
     /* Filter configuration */
     config_chain_t *    p_cfg;
@@ -115,6 +115,8 @@ VLC_API char* httpd_ServerIP( const httpd_client_t *cl, char *, int * );
 
 VLC_API httpd_file_t * httpd_FileNew( httpd_host_t *, const char *psz_url, const char *psz_mime, const char *psz_user, const char *psz_password, const vlc_acl_t *p_acl, httpd_file_callback_t pf_fill, httpd_file_sys_t * ) VLC_USED;
 VLC_API httpd_file_sys_t * httpd_FileDelete( httpd_file_t * );
+/* serve a file from disk, with byte range support; delete with httpd_FileDelete() */
+VLC_API httpd_file_t * httpd_FileNewPath( httpd_host_t *, const char *psz_url, const char *psz_mime, const char *psz_user, const char *psz_password, const vlc_acl_t *p_acl, const char *psz_path ) VLC_USED;
 
 
 VLC_API httpd_handler_t * httpd_HandlerNew( httpd_host_t *, const char *psz_url, const char *psz_user, const char *psz_password, const vlc_acl_t *p_acl, httpd_handler_callback_t pf_fill, httpd_handler_sys_t * ) VLC_USED;
@@ -129,6 +131,10 @@ VLC_API httpd_stream_t * httpd_StreamNew( httpd_host_t *, const char *psz_url, c
 VLC_API void httpd_StreamDelete( httpd_stream_t * );
 VLC_API int httpd_StreamHeader( httpd_stream_t *, uint8_t *p_data, int i_data );
 VLC_API int httpd_StreamSend( httpd_stream_t *, uint8_t *p_data, int i_data );
+/* The data sent next starts with a key frame: new clients will start there */
+VLC_API void httpd_StreamKeyFrame( httpd_stream_t * );
+/* Rate (bytes/s) at which new clients catch up from the key frame, 0 for unlimited */
+VLC_API void httpd_StreamBurst( httpd_stream_t *, int i_rate );
 
 
 /* Msg functions facilities */
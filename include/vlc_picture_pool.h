@@ -121,6 +121,19 @@ VLC_API picture_pool_t * picture_pool_Reserve(picture_pool_t *, int picture_coun
  */
 VLC_API int picture_pool_GetSize(picture_pool_t *);
 
+/**
+ * Picture pool usage counters
+ */
+typedef struct {
+    unsigned used_max;    /**< highest number of pictures in use at once */
+    unsigned starvations; /**< picture_pool_Get() calls without a picture */
+} picture_pool_stats_t;
+
+/**
+ * It returns the usage counters of the given pool since its creation.
+ */
+VLC_API void picture_pool_GetStats(picture_pool_t *, picture_pool_stats_t *);
+
 
 #endif /* VLC_PICTURE_POOL_H */
 
@@ -45,6 +45,8 @@ extern "C" {
 /* Opaque definition for text reader context */
 typedef struct stream_text_t stream_text_t;
 
+struct iovec;
+
 /**
  * stream_t definition
  */
@@ -80,6 +82,13 @@ struct stream_t
 
     /* Weak link to parent input */
     input_thread_t *p_input;
+
+    /* Scatter-gather peek (optional, see stream_PeekV) */
+    int      (*pf_peekv)  ( stream_t *, struct iovec *, unsigned *pi_iov,
+                            unsigned int i_peek );
+
+    /* Block read (optional, see stream_Block) */
+    block_t *(*pf_block)  ( stream_t *, unsigned int i_size );
 };
 
 /**
@@ -115,6 +124,7 @@ enum stream_query_e
 
 VLC_API int stream_Read( stream_t *s, void *p_read, int i_read );
 VLC_API int stream_Peek( stream_t *s, const uint8_t **pp_peek, int i_peek );
+VLC_API int stream_PeekV( stream_t *s, struct iovec *iov, unsigned *pi_iov, int i_peek );
 VLC_API int stream_vaControl( stream_t *s, int i_query, va_list args );
 VLC_API void stream_Delete( stream_t *s );
 VLC_API int stream_Control( stream_t *s, int i_query, ... );
@@ -102,6 +102,8 @@ struct video_splitter_t
     /* Buffer allocation */
     int  (*pf_picture_new) ( video_splitter_t *, picture_t *pp_picture[] );
     void (*pf_picture_del) ( video_splitter_t *, picture_t *pp_picture[] );
+    picture_t *(*pf_picture_ref) ( video_splitter_t *, int i_index,
+                                   picture_t *p_src, int i_x, int i_y );
     video_splitter_owner_t *p_owner;
 };
 
@@ -132,6 +134,25 @@ static inline void video_splitter_DeletePicture( video_splitter_t *p_splitter,
     p_splitter->pf_picture_del( p_splitter, pp_picture );
 }
 
+/**
+ * It will create a picture for the output i_index sharing the planes of
+ * p_src, from its pixel (i_x, i_y) on, so that the output shows this part
+ * of the source without any copy.
+ *
+ * It returns NULL if the output needs pictures of its own (from
+ * video_splitter_NewPicture), for instance because its display only accepts
+ * its own buffers. The returned picture holds a reference on p_src.
+ */
+static inline picture_t *video_splitter_RefPicture( video_splitter_t *p_splitter,
+                                                    int i_index,
+                                                    picture_t *p_src,
+                                                    int i_x, int i_y )
+{
+    if( !p_splitter->pf_picture_ref )
+        return NULL;
+    return p_splitter->pf_picture_ref( p_splitter, i_index, p_src, i_x, i_y );
+}
+
 /* */
 VLC_API video_splitter_t * video_splitter_New( vlc_object_t *, const char *psz_name, const video_format_t * );
 VLC_API void video_splitter_Delete( video_splitter_t * );
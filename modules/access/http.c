@@ -54,6 +54,9 @@
 
 #include <assert.h>
 #include <limits.h>
+#ifdef HAVE_POLL
+#   include <poll.h>
+#endif
 
 #ifdef HAVE_LIBPROXY
 #    include <proxy.h>
@@ -181,6 +184,7 @@ struct access_sys_t
     char       *psz_icy_title;
 
     uint64_t i_remaining;
+    uint64_t i_window;
 
     bool b_seekable;
     bool b_reconnect;
@@ -192,6 +196,16 @@ struct access_sys_t
     vlc_array_t * cookies;
 };
 
+/* Smallest and largest byte range requested at once once the size is known.
+ * The range grows while reading sequentially and shrinks back on seek, so
+ * that the rest of the range can be drained cheaply and the connection kept
+ * alive across the seek. */
+#define HTTP_WINDOW_MIN (INT64_C(64) << 10)
+#define HTTP_WINDOW_MAX (INT64_C(16) << 20)
+/* Largest forward gap read through rather than seeking, and largest
+ * remainder of a response drained to keep the connection alive */
+#define HTTP_SEEK_GAP   (INT64_C(64) << 10)
+
 /* */
 static int OpenWithCookies( vlc_object_t *p_this, const char *psz_access,
                             unsigned i_redirect, vlc_array_t *cookies );
@@ -206,6 +220,10 @@ static int Control( access_t *, int, va_list );
 static int Connect( access_t *, uint64_t );
 static int Request( access_t *p_access, uint64_t i_tell );
 static void Disconnect( access_t * );
+static int  Skip( access_t *, uint64_t );
+
+static int  PoolGet( const char *, int );
+static void PoolPut( const char *, int, int );
 
 /* Small Cookie utilities. Cookies support is partial. */
 static char * cookie_get_content( const char * cookie );
@@ -285,6 +303,7 @@ static int OpenWithCookies( vlc_object_t *p_this, const char *psz_access,
     p_sys->psz_icy_genre = NULL;
     p_sys->psz_icy_title = NULL;
     p_sys->i_remaining = 0;
+    p_sys->i_window = 0; /* open-ended until the server accepts ranges */
     p_sys->b_persist = false;
     p_sys->b_has_size = false;
     p_access->info.i_size = 0;
@@ -584,6 +603,7 @@ connect:
         p_access->psz_location = strdup( p_sys->psz_location
                                        + strlen( psz_protocol ) + 3 );
         /* Clean up current Open() run */
+        Disconnect( p_access );
         vlc_UrlClean( &p_sys->url );
         http_auth_Reset( &p_sys->auth );
         vlc_UrlClean( &p_sys->proxy );
@@ -595,7 +615,6 @@ connect:
         free( p_sys->psz_user_agent );
         free( p_sys->psz_referrer );
 
-        Disconnect( p_access );
         cookies = p_sys->cookies;
 #ifdef HAVE_ZLIB_H
         inflateEnd( &p_sys->inflate.stream );
@@ -678,6 +697,8 @@ connect:
     return VLC_SUCCESS;
 
 error:
+    Disconnect( p_access );
+
     vlc_UrlClean( &p_sys->url );
     vlc_UrlClean( &p_sys->proxy );
     free( p_sys->psz_proxy_passbuf );
@@ -687,8 +708,6 @@ error:
     free( p_sys->psz_user_agent );
     free( p_sys->psz_referrer );
 
-    Disconnect( p_access );
-
     if( p_sys->cookies )
     {
         int i;
@@ -712,6 +731,8 @@ static void Close( vlc_object_t *p_this )
     access_t     *p_access = (access_t*)p_this;
     access_sys_t *p_sys = p_access->p_sys;
 
+    Disconnect( p_access );
+
     vlc_UrlClean( &p_sys->url );
     http_auth_Reset( &p_sys->auth );
     vlc_UrlClean( &p_sys->proxy );
@@ -728,8 +749,6 @@ static void Close( vlc_object_t *p_this )
     free( p_sys->psz_user_agent );
     free( p_sys->psz_referrer );
 
-    Disconnect( p_access );
-
     if( p_sys->cookies )
     {
         int i;
@@ -800,6 +819,23 @@ static int ReadData( access_t *p_access, int *pi_read,
  * Read: Read up to i_len bytes from the http connection and place in
  * p_buffer. Return the actual number of bytes read
  *****************************************************************************/
+/* Requests the next byte range once the current one is exhausted */
+static int NextRange( access_t *p_access )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    if( p_sys->i_window < HTTP_WINDOW_MAX )
+        p_sys->i_window *= 2;
+
+    if( p_sys->fd != -1 && p_sys->b_persist && !p_sys->b_chunked
+     && Request( p_access, p_access->info.i_pos ) == VLC_SUCCESS )
+        return VLC_SUCCESS;
+
+    Disconnect( p_access );
+    return Connect( p_access, p_access->info.i_pos ) ? VLC_EGENERIC
+                                                     : VLC_SUCCESS;
+}
+
 static int ReadICYMeta( access_t *p_access );
 static ssize_t Read( access_t *p_access, uint8_t *p_buffer, size_t i_len )
 {
@@ -816,6 +852,14 @@ static ssize_t Read( access_t *p_access, uint8_t *p_buffer, size_t i_len )
         if( remainder < i_len )
             i_len = remainder;
 
+        /* End of the requested range, but not of the file */
+        if( p_sys->i_remaining == 0 && p_sys->i_code == 206 && remainder > 0
+         && p_sys->i_window > 0 )
+        {
+            if( NextRange( p_access ) || p_sys->fd == -1 )
+                goto fatal;
+        }
+
         /* Remaining bytes in the response */
         if( p_sys->i_remaining < i_len )
             i_len = p_sys->i_remaining;
@@ -1003,17 +1047,34 @@ static ssize_t ReadCompressed( access_t *p_access, uint8_t *p_buffer,
 }
 #endif
 
+/* Reads and discards bytes from the current response */
+static int Skip( access_t *p_access, uint64_t i_len )
+{
+    uint8_t p_buffer[4096];
+
+    while( i_len > 0 )
+    {
+        ssize_t i_read = Read( p_access, p_buffer,
+                               __MIN( i_len, sizeof( p_buffer ) ) );
+        if( i_read <= 0 )
+            return VLC_EGENERIC;
+        i_len -= i_read;
+    }
+    return VLC_SUCCESS;
+}
+
 /*****************************************************************************
- * Seek: close and re-open a connection at the right place
+ * Seek: reuse the connection if possible, or re-open one at the right place
  *****************************************************************************/
 static int Seek( access_t *p_access, uint64_t i_pos )
 {
-    msg_Dbg( p_access, "trying to seek to %"PRId64, i_pos );
+    access_sys_t *p_sys = p_access->p_sys;
 
-    Disconnect( p_access );
+    msg_Dbg( p_access, "trying to seek to %"PRId64, i_pos );
 
     if( p_access->info.i_size
      && i_pos >= p_access->info.i_size ) {
+        Disconnect( p_access );
         msg_Err( p_access, "seek to far" );
         int retval = Seek( p_access, p_access->info.i_size - 1 );
         if( retval == VLC_SUCCESS ) {
@@ -1023,6 +1084,41 @@ static int Seek( access_t *p_access, uint64_t i_pos )
         }
         return retval;
     }
+
+    if( p_sys->fd != -1 && p_sys->b_has_size && p_sys->i_icy_meta == 0
+#ifdef HAVE_ZLIB_H
+     && !p_sys->b_compressed
+#endif
+      )
+    {
+        uint64_t i_gap = i_pos - p_access->info.i_pos;
+
+        if( i_pos >= p_access->info.i_pos && i_gap <= HTTP_SEEK_GAP
+         && i_gap < p_sys->i_remaining )
+        {   /* Short forward seek: read through */
+            if( Skip( p_access, i_gap ) == VLC_SUCCESS )
+            {
+                p_access->info.b_eof = false;
+                return VLC_SUCCESS;
+            }
+        }
+        else if( p_sys->b_persist && !p_sys->b_chunked
+              && p_sys->i_remaining <= HTTP_SEEK_GAP
+              && Skip( p_access, p_sys->i_remaining ) == VLC_SUCCESS
+              && p_sys->fd != -1 )
+        {   /* Drain the response and send the next request alongside */
+            p_sys->i_window = HTTP_WINDOW_MIN;
+            p_sys->i_icy_offset = i_pos;
+            p_access->info.i_pos = i_pos;
+            p_access->info.b_eof = false;
+            if( Request( p_access, i_pos ) == VLC_SUCCESS )
+                return VLC_SUCCESS;
+        }
+    }
+
+    if( p_sys->b_seekable )
+        p_sys->i_window = HTTP_WINDOW_MIN;
+    Disconnect( p_access );
     if( Connect( p_access, i_pos ) )
     {
         msg_Err( p_access, "seek failed" );
@@ -1143,6 +1239,23 @@ static int Connect( access_t *p_access, uint64_t i_tell )
 
     /* Open connection */
     assert( p_sys->fd == -1 ); /* No open sockets (leaking fds is BAD) */
+    if( !p_sys->b_ssl )
+    {
+        /* Reuse an idle connection to the same server, if any */
+        p_sys->fd = PoolGet( srv.psz_host, srv.i_port );
+        if( p_sys->fd != -1 )
+        {
+            msg_Dbg( p_access, "reusing connection to %s:%d",
+                     srv.psz_host, srv.i_port );
+            if( Request( p_access, i_tell ) == VLC_SUCCESS )
+                return 0;
+
+            /* The server may have closed it in the mean time */
+            p_sys->b_has_size = false;
+            p_access->info.i_size = 0;
+            p_access->info.i_pos  = i_tell;
+        }
+    }
     p_sys->fd = net_ConnectTCP( p_access, srv.psz_host, srv.i_port );
     if( p_sys->fd == -1 )
     {
@@ -1270,10 +1383,16 @@ static int Request( access_t *p_access, uint64_t i_tell )
     if( p_sys->i_version == 1 && ! p_sys->b_continuous )
     {
         p_sys->b_persist = true;
-        net_Printf( p_access, p_sys->fd, pvs,
-                    "Range: bytes=%"PRIu64"-\r\n", i_tell );
-        net_Printf( p_access, p_sys->fd, pvs, "Connection: close\r\n" );
+        if( p_sys->i_window > 0 )
+            net_Printf( p_access, p_sys->fd, pvs,
+                        "Range: bytes=%"PRIu64"-%"PRIu64"\r\n",
+                        i_tell, i_tell + p_sys->i_window - 1 );
+        else
+            net_Printf( p_access, p_sys->fd, pvs,
+                        "Range: bytes=%"PRIu64"-\r\n", i_tell );
     }
+    else
+        net_Printf( p_access, p_sys->fd, pvs, "Connection: close\r\n" );
 
     /* Cookies */
     if( p_sys->cookies )
@@ -1316,6 +1435,7 @@ static int Request( access_t *p_access, uint64_t i_tell )
     if( net_Printf( p_access, p_sys->fd, pvs, "\r\n" ) < 0 )
     {
         msg_Err( p_access, "failed to send request" );
+        p_sys->b_persist = false;
         Disconnect( p_access );
         return VLC_EGENERIC;
     }
@@ -1330,11 +1450,14 @@ static int Request( access_t *p_access, uint64_t i_tell )
     {
         p_sys->psz_protocol = "HTTP";
         p_sys->i_code = atoi( &psz[9] );
+        if( psz[7] == '0' )
+            p_sys->b_persist = false;
     }
     else if( !strncmp( psz, "ICY", 3 ) )
     {
         p_sys->psz_protocol = "ICY";
         p_sys->i_code = atoi( &psz[4] );
+        p_sys->b_persist = false;
         p_sys->b_reconnect = true;
     }
     else
@@ -1625,6 +1748,7 @@ static int Request( access_t *p_access, uint64_t i_tell )
     return VLC_SUCCESS;
 
 error:
+    p_sys->b_persist = false;
     Disconnect( p_access );
     return VLC_EGENERIC;
 }
@@ -1636,6 +1760,12 @@ static void Disconnect( access_t *p_access )
 {
     access_sys_t *p_sys = p_access->p_sys;
 
+    /* Keep plain connections whose last response was read completely */
+    bool b_reuse = p_sys->p_tls == NULL && p_sys->b_persist
+                && p_sys->b_has_size && !p_sys->b_chunked
+                && p_sys->i_remaining == 0 && p_sys->i_icy_meta == 0
+                && !p_sys->b_error;
+
     if( p_sys->p_tls != NULL)
     {
         vlc_tls_ClientDelete( p_sys->p_tls );
@@ -1644,12 +1774,113 @@ static void Disconnect( access_t *p_access )
     }
     if( p_sys->fd != -1)
     {
-        net_Close(p_sys->fd);
+        if( b_reuse )
+        {
+            const vlc_url_t *srv = p_sys->b_proxy ? &p_sys->proxy
+                                                  : &p_sys->url;
+            PoolPut( srv->psz_host, srv->i_port, p_sys->fd );
+        }
+        else
+            net_Close(p_sys->fd);
         p_sys->fd = -1;
     }
 
 }
 
+/*****************************************************************************
+ * Connection pool: idle persistent connections, shared by all HTTP inputs
+ *****************************************************************************/
+#define POOL_SIZE 8
+#define POOL_IDLE (5 * CLOCK_FREQ) /* servers drop idle connections anyway */
+
+static struct
+{
+    char    *psz_host; /* NULL if the slot is free */
+    int      i_port;
+    int      fd;
+    mtime_t  i_date;
+} pool[POOL_SIZE];
+static vlc_mutex_t pool_lock = VLC_STATIC_MUTEX;
+
+static void PoolDrop( unsigned i )
+{
+    net_Close( pool[i].fd );
+    free( pool[i].psz_host );
+    pool[i].psz_host = NULL;
+}
+
+/* Closes the connections that were idle for too long (pool_lock held) */
+static void PoolExpire( mtime_t now )
+{
+    for( unsigned i = 0; i < POOL_SIZE; i++ )
+        if( pool[i].psz_host != NULL && pool[i].i_date + POOL_IDLE < now )
+            PoolDrop( i );
+}
+
+/* Takes an idle connection to the given server, or returns -1 */
+static int PoolGet( const char *psz_host, int i_port )
+{
+    int fd = -1;
+
+    vlc_mutex_lock( &pool_lock );
+    PoolExpire( mdate() );
+    for( unsigned i = 0; i < POOL_SIZE && fd == -1; i++ )
+    {
+        if( pool[i].psz_host == NULL || pool[i].i_port != i_port
+         || strcasecmp( pool[i].psz_host, psz_host ) )
+            continue;
+
+        /* An idle connection must have nothing to read: anything there is
+         * either the end of the stream or garbage */
+        struct pollfd ufd = { .fd = pool[i].fd, .events = POLLIN };
+        if( poll( &ufd, 1, 0 ) == 0 )
+        {
+            fd = pool[i].fd;
+            free( pool[i].psz_host );
+            pool[i].psz_host = NULL;
+        }
+        else
+            PoolDrop( i );
+    }
+    vlc_mutex_unlock( &pool_lock );
+    return fd;
+}
+
+/* Gives an idle connection to the pool, evicting the oldest one if full */
+static void PoolPut( const char *psz_host, int i_port, int fd )
+{
+    char *psz_dup = strdup( psz_host );
+    if( unlikely(psz_dup == NULL) )
+    {
+        net_Close( fd );
+        return;
+    }
+
+    mtime_t now = mdate();
+    unsigned i_slot = 0;
+
+    vlc_mutex_lock( &pool_lock );
+    PoolExpire( now );
+    for( unsigned i = 0; i < POOL_SIZE; i++ )
+    {
+        if( pool[i].psz_host == NULL )
+        {
+            i_slot = i;
+            break;
+        }
+        if( pool[i].i_date < pool[i_slot].i_date )
+            i_slot = i;
+    }
+    if( pool[i_slot].psz_host != NULL )
+        PoolDrop( i_slot );
+
+    pool[i_slot].psz_host = psz_dup;
+    pool[i_slot].i_port = i_port;
+    pool[i_slot].fd = fd;
+    pool[i_slot].i_date = now;
+    vlc_mutex_unlock( &pool_lock );
+}
+
 /*****************************************************************************
  * Cookies (FIXME: we may want to rewrite that using a nice structure to hold
  * them) (FIXME: only support the "domain=" param)
@@ -0,0 +1,653 @@
+/*****************************************************************************
+ * packet.c: UDP multicast input through a shared packet ring
+ *****************************************************************************
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************
+ * All the multicast inputs of the process on a given network interface share
+ * a single Linux TPACKET_V3 memory-mapped receive ring. One thread per ring
+ * walks the blocks handed over by the kernel, and dispatches the UDP payloads
+ * to the inputs by destination group and port. The groups are still joined
+ * with ordinary sockets, but those are never bound, so the kernel does not
+ * queue nor copy anything to them.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <linux/if_packet.h>
+#include <linux/if_ether.h>
+#include <linux/filter.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_access.h>
+#include <vlc_block.h>
+#include <vlc_fs.h>
+#include <vlc_network.h>
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+static int  Open ( vlc_object_t * );
+static void Close( vlc_object_t * );
+
+#define IF_TEXT N_("Packet ring interface")
+#define IF_LONGTEXT N_( \
+    "Receive IPv4 UDP multicast from this network interface through a " \
+    "memory-mapped packet ring shared by all inputs, instead of one socket " \
+    "per input. This requires the CAP_NET_RAW capability." )
+#define SIZE_TEXT N_("Packet ring size (MiB)")
+#define SIZE_LONGTEXT N_( \
+    "Memory mapped for the shared packet ring of each interface." )
+
+vlc_module_begin ()
+    set_shortname( N_("UDP ring") )
+    set_description( N_("UDP multicast input through a packet ring") )
+    set_category( CAT_INPUT )
+    set_subcategory( SUBCAT_INPUT_ACCESS )
+
+    add_string( "packet-if", NULL, IF_TEXT, IF_LONGTEXT, true )
+    add_integer( "packet-ring-size", 16, SIZE_TEXT, SIZE_LONGTEXT, true )
+        change_integer_range( 1, 1024 )
+
+    /* Takes over the UDP input when enabled */
+    set_capability( "access", 10 )
+    add_shortcut( "udp", "udpstream", "udp4" )
+
+    set_callbacks( Open, Close )
+vlc_module_end ()
+
+/*****************************************************************************
+ * Local prototypes
+ *****************************************************************************/
+#define RING_BLOCK_SIZE (1 << 20)
+#define RING_FRAME_SIZE 2048
+#define RING_TIMEOUT    10 /* ms before a partly filled block is handed over */
+#define HASH_SIZE       256
+#define FIFO_MAX        4096 /* datagrams queued per input before dropping */
+
+typedef struct packet_ring_t packet_ring_t;
+
+struct packet_ring_t
+{
+    packet_ring_t *p_next;
+    unsigned       i_refs;
+    int            i_ifindex;
+    int            fd;
+    uint8_t       *p_map;
+    unsigned       i_blocks;
+    vlc_thread_t   thread;
+
+    vlc_mutex_t    lock; /* protects pp_hash */
+    access_sys_t  *pp_hash[HASH_SIZE];
+};
+
+struct access_sys_t
+{
+    access_sys_t  *p_next; /* in the ring hash bucket */
+    packet_ring_t *p_ring;
+    block_fifo_t  *p_fifo;
+    int            pi_wake[2]; /* written by the ring thread on new data */
+    int            fd; /* multicast membership socket */
+
+    /* Network byte order */
+    in_addr_t      i_group;
+    in_addr_t      i_source; /* INADDR_ANY if any source */
+    uint16_t       i_port;
+
+    bool           b_queued; /* data queued since the last wake-up */
+};
+
+static vlc_mutex_t rings_lock = VLC_STATIC_MUTEX;
+static packet_ring_t *p_rings = NULL;
+
+static block_t *Block( access_t * );
+static int Control( access_t *, int, va_list );
+
+static unsigned Hash( in_addr_t i_group, uint16_t i_port )
+{
+    return (ntohl( i_group ) * 31 + ntohs( i_port )) % HASH_SIZE;
+}
+
+/*****************************************************************************
+ * RingPacket: dispatches one received IPv4 packet
+ *****************************************************************************/
+static void RingPacket( packet_ring_t *p_ring, const uint8_t *p, size_t len )
+{
+    if( len < 28 || (p[0] >> 4) != 4 )
+        return;
+
+    size_t ihl = (p[0] & 0xF) * 4;
+    if( ihl < 20 || len < ihl + 8 || p[9] != IPPROTO_UDP )
+        return;
+    if( GetWBE( p + 6 ) & 0x3FFF )
+        return; /* fragment: not supported */
+
+    in_addr_t i_source, i_group;
+    uint16_t i_port;
+    memcpy( &i_source, p + 12, 4 );
+    memcpy( &i_group, p + 16, 4 );
+    memcpy( &i_port, p + ihl + 2, 2 );
+
+    size_t i_length = GetWBE( p + ihl + 4 );
+    if( i_length < 8 || ihl + i_length > len )
+        return; /* truncated */
+    p += ihl + 8;
+    i_length -= 8;
+
+    for( access_sys_t *p_sys = p_ring->pp_hash[Hash( i_group, i_port )];
+         p_sys != NULL; p_sys = p_sys->p_next )
+    {
+        if( p_sys->i_group != i_group || p_sys->i_port != i_port
+         || (p_sys->i_source != INADDR_ANY && p_sys->i_source != i_source) )
+            continue;
+        if( block_FifoCount( p_sys->p_fifo ) >= FIFO_MAX )
+            continue; /* input too slow: drop */
+
+        block_t *p_block = block_Alloc( i_length );
+        if( unlikely(p_block == NULL) )
+            continue;
+        memcpy( p_block->p_buffer, p, i_length );
+        block_FifoPut( p_sys->p_fifo, p_block );
+        p_sys->b_queued = true;
+    }
+}
+
+/*****************************************************************************
+ * RingBlock: dispatches the packets of one ring block
+ *****************************************************************************/
+static void RingBlock( packet_ring_t *p_ring, struct tpacket_block_desc *p_desc )
+{
+    const uint8_t *p = (const uint8_t *)p_desc
+                     + p_desc->hdr.bh1.offset_to_first_pkt;
+
+    vlc_mutex_lock( &p_ring->lock );
+    for( uint32_t n = p_desc->hdr.bh1.num_pkts; n > 0; n-- )
+    {
+        const struct tpacket3_hdr *p_hdr = (const void *)p;
+        const struct sockaddr_ll *p_sll =
+            (const void *)(p + TPACKET_ALIGN( sizeof( *p_hdr ) ));
+
+        if( p_sll->sll_pkttype != PACKET_OUTGOING )
+            RingPacket( p_ring, p + p_hdr->tp_net, p_hdr->tp_snaplen );
+        p += p_hdr->tp_next_offset;
+    }
+
+    /* One wake-up per input per block */
+    for( unsigned i = 0; i < HASH_SIZE; i++ )
+        for( access_sys_t *p_sys = p_ring->pp_hash[i]; p_sys != NULL;
+             p_sys = p_sys->p_next )
+            if( p_sys->b_queued )
+            {
+                p_sys->b_queued = false;
+                if( write( p_sys->pi_wake[1], &(uint8_t){ 0 }, 1 ) < 0 )
+                {
+                    /* pipe full: the input will wake up anyway */
+                }
+            }
+    vlc_mutex_unlock( &p_ring->lock );
+}
+
+static void *RingThread( void *data )
+{
+    packet_ring_t *p_ring = data;
+    unsigned i = 0;
+
+    for( ;; )
+    {
+        struct tpacket_block_desc *p_desc =
+            (void *)(p_ring->p_map + i * RING_BLOCK_SIZE);
+
+        if( !(p_desc->hdr.bh1.block_status & TP_STATUS_USER) )
+        {
+            struct pollfd ufd = { .fd = p_ring->fd, .events = POLLIN };
+
+            poll( &ufd, 1, -1 );
+            continue;
+        }
+        barrier();
+
+        int canc = vlc_savecancel();
+        RingBlock( p_ring, p_desc );
+        vlc_restorecancel( canc );
+
+        /* Hand the block back to the kernel */
+        barrier();
+        p_desc->hdr.bh1.block_status = TP_STATUS_KERNEL;
+        i = (i + 1) % p_ring->i_blocks;
+    }
+    return NULL;
+}
+
+/*****************************************************************************
+ * RingCreate: sets up the packet ring of an interface
+ *****************************************************************************/
+static packet_ring_t *RingCreate( vlc_object_t *p_obj, int i_ifindex )
+{
+    unsigned i_blocks = var_InheritInteger( p_obj, "packet-ring-size" );
+    packet_ring_t *p_ring = calloc( 1, sizeof( *p_ring ) );
+    if( unlikely(p_ring == NULL) )
+        return NULL;
+
+    /* No packets until bind() */
+    p_ring->fd = vlc_socket( PF_PACKET, SOCK_DGRAM, 0, false );
+    if( p_ring->fd == -1 )
+    {
+        msg_Err( p_obj, "cannot create packet socket: %m" );
+        free( p_ring );
+        return NULL;
+    }
+
+    /* Only pass IPv4 UDP multicast to user space */
+    static const struct sock_filter filter[] = {
+        BPF_STMT( BPF_LD + BPF_B + BPF_ABS, 9 ),                /* protocol */
+        BPF_JUMP( BPF_JMP + BPF_JEQ + BPF_K, IPPROTO_UDP, 0, 3 ),
+        BPF_STMT( BPF_LD + BPF_W + BPF_ABS, 16 ),          /* destination */
+        BPF_STMT( BPF_ALU + BPF_AND + BPF_K, 0xF0000000 ),
+        BPF_JUMP( BPF_JMP + BPF_JEQ + BPF_K, 0xE0000000, 1, 0 ),
+        BPF_STMT( BPF_RET + BPF_K, 0 ),
+        BPF_STMT( BPF_RET + BPF_K, 0xFFFF ),
+    };
+    const struct sock_fprog prog = {
+        .len = sizeof( filter ) / sizeof( filter[0] ),
+        .filter = (struct sock_filter *)filter,
+    };
+    int i_version = TPACKET_V3;
+    struct tpacket_req3 req = {
+        .tp_block_size = RING_BLOCK_SIZE,
+        .tp_block_nr = i_blocks,
+        .tp_frame_size = RING_FRAME_SIZE,
+        .tp_frame_nr = i_blocks * (RING_BLOCK_SIZE / RING_FRAME_SIZE),
+        .tp_retire_blk_tov = RING_TIMEOUT,
+    };
+    struct sockaddr_ll addr = {
+        .sll_family = AF_PACKET,
+        .sll_protocol = htons( ETH_P_IP ),
+        .sll_ifindex = i_ifindex,
+    };
+
+    if( setsockopt( p_ring->fd, SOL_SOCKET, SO_ATTACH_FILTER,
+                    &prog, sizeof( prog ) )
+     || setsockopt( p_ring->fd, SOL_PACKET, PACKET_VERSION,
+                    &i_version, sizeof( i_version ) )
+     || setsockopt( p_ring->fd, SOL_PACKET, PACKET_RX_RING,
+                    &req, sizeof( req ) ) )
+    {
+        msg_Err( p_obj, "cannot set up packet ring: %m" );
+        goto error;
+    }
+
+    p_ring->p_map = mmap( NULL, (size_t)i_blocks * RING_BLOCK_SIZE,
+                          PROT_READ | PROT_WRITE, MAP_SHARED, p_ring->fd, 0 );
+    if( p_ring->p_map == MAP_FAILED )
+    {
+        msg_Err( p_obj, "cannot map packet ring: %m" );
+        goto error;
+    }
+    p_ring->i_blocks = i_blocks;
+
+    if( bind( p_ring->fd, (struct sockaddr *)&addr, sizeof( addr ) ) )
+    {
+        msg_Err( p_obj, "cannot bind packet socket: %m" );
+        goto error;
+    }
+
+    p_ring->i_refs = 1;
+    p_ring->i_ifindex = i_ifindex;
+    vlc_mutex_init( &p_ring->lock );
+    if( vlc_clone( &p_ring->thread, RingThread, p_ring,
+                   VLC_THREAD_PRIORITY_INPUT ) )
+    {
+        vlc_mutex_destroy( &p_ring->lock );
+        goto error;
+    }
+    msg_Dbg( p_obj, "packet ring of %u MiB on interface %d", i_blocks,
+             i_ifindex );
+    return p_ring;
+
+error:
+    if( p_ring->p_map != NULL && p_ring->p_map != MAP_FAILED )
+        munmap( p_ring->p_map, (size_t)i_blocks * RING_BLOCK_SIZE );
+    close( p_ring->fd );
+    free( p_ring );
+    return NULL;
+}
+
+/*****************************************************************************
+ * RingHold/RingRelease: shares a packet ring between the inputs
+ *****************************************************************************/
+static packet_ring_t *RingHold( vlc_object_t *p_obj, int i_ifindex )
+{
+    packet_ring_t *p_ring;
+
+    vlc_mutex_lock( &rings_lock );
+    for( p_ring = p_rings; p_ring != NULL; p_ring = p_ring->p_next )
+        if( p_ring->i_ifindex == i_ifindex )
+        {
+            p_ring->i_refs++;
+            break;
+        }
+
+    if( p_ring == NULL )
+    {
+        p_ring = RingCreate( p_obj, i_ifindex );
+        if( p_ring != NULL )
+        {
+            p_ring->p_next = p_rings;
+            p_rings = p_ring;
+        }
+    }
+    vlc_mutex_unlock( &rings_lock );
+    return p_ring;
+}
+
+static void RingRelease( packet_ring_t *p_ring )
+{
+    vlc_mutex_lock( &rings_lock );
+    if( --p_ring->i_refs > 0 )
+    {
+        vlc_mutex_unlock( &rings_lock );
+        return;
+    }
+
+    for( packet_ring_t **pp = &p_rings; *pp != NULL; pp = &(*pp)->p_next )
+        if( *pp == p_ring )
+        {
+            *pp = p_ring->p_next;
+            break;
+        }
+    vlc_mutex_unlock( &rings_lock );
+
+    vlc_cancel( p_ring->thread );
+    vlc_join( p_ring->thread, NULL );
+    vlc_mutex_destroy( &p_ring->lock );
+    munmap( p_ring->p_map, (size_t)p_ring->i_blocks * RING_BLOCK_SIZE );
+    close( p_ring->fd );
+    free( p_ring );
+}
+
+/*****************************************************************************
+ * ParseLocation: [source[:port]]@group[:port]
+ *****************************************************************************/
+static int ParseLocation( access_sys_t *p_sys, const char *psz_location )
+{
+    char *psz_name = strdup( psz_location );
+    if( unlikely(psz_name == NULL) )
+        return VLC_ENOMEM;
+
+    char *psz_group = strchr( psz_name, '@' );
+    const char *psz_source = psz_name;
+    int i_port = 1234;
+    int i_ret = VLC_EGENERIC;
+
+    if( psz_group == NULL )
+        goto out; /* not multicast */
+    *psz_group++ = '\0';
+
+    char *psz_port = strchr( psz_group, ':' );
+    if( psz_port != NULL )
+    {
+        *psz_port++ = '\0';
+        i_port = atoi( psz_port );
+    }
+    psz_port = strchr( psz_name, ':' );
+    if( psz_port != NULL )
+        *psz_port = '\0'; /* the source port is not checked */
+
+    struct in_addr group, source = { INADDR_ANY };
+    if( inet_pton( AF_INET, psz_group, &group ) != 1
+     || !IN_MULTICAST( ntohl( group.s_addr ) )
+     || (*psz_source && inet_pton( AF_INET, psz_source, &source ) != 1)
+     || i_port <= 0 || i_port > 65535 )
+        goto out;
+
+    p_sys->i_group = group.s_addr;
+    p_sys->i_source = source.s_addr;
+    p_sys->i_port = htons( i_port );
+    i_ret = VLC_SUCCESS;
+out:
+    free( psz_name );
+    return i_ret;
+}
+
+/*****************************************************************************
+ * Join: joins the multicast group without receiving through the socket
+ *****************************************************************************/
+static int Join( access_t *p_access, int i_ifindex )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    struct sockaddr_in group = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = p_sys->i_group,
+    };
+    int i_val;
+
+    p_sys->fd = vlc_socket( PF_INET, SOCK_DGRAM, IPPROTO_UDP, false );
+    if( p_sys->fd == -1 )
+        return VLC_EGENERIC;
+
+    if( p_sys->i_source != INADDR_ANY )
+    {
+        struct group_source_req gsr = { .gsr_interface = i_ifindex };
+        struct sockaddr_in source = {
+            .sin_family = AF_INET,
+            .sin_addr.s_addr = p_sys->i_source,
+        };
+
+        memcpy( &gsr.gsr_group, &group, sizeof( group ) );
+        memcpy( &gsr.gsr_source, &source, sizeof( source ) );
+        i_val = setsockopt( p_sys->fd, SOL_IP, MCAST_JOIN_SOURCE_GROUP,
+                            &gsr, sizeof( gsr ) );
+    }
+    else
+    {
+        struct group_req gr = { .gr_interface = i_ifindex };
+
+        memcpy( &gr.gr_group, &group, sizeof( group ) );
+        i_val = setsockopt( p_sys->fd, SOL_IP, MCAST_JOIN_GROUP,
+                            &gr, sizeof( gr ) );
+    }
+
+    if( i_val )
+    {
+        msg_Err( p_access, "cannot join multicast group: %m" );
+        net_Close( p_sys->fd );
+        return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Open: subscribes to the packet ring
+ *****************************************************************************/
+static int Open( vlc_object_t *p_this )
+{
+    access_t *p_access = (access_t *)p_this;
+
+    char *psz_if = var_InheritString( p_access, "packet-if" );
+    if( psz_if == NULL )
+        return VLC_EGENERIC; /* not enabled */
+
+    int i_ifindex = if_nametoindex( psz_if );
+    if( i_ifindex == 0 )
+    {
+        msg_Err( p_access, "unknown network interface %s", psz_if );
+        free( psz_if );
+        return VLC_EGENERIC;
+    }
+    free( psz_if );
+
+    access_sys_t *p_sys = calloc( 1, sizeof( *p_sys ) );
+    if( unlikely(p_sys == NULL) )
+        return VLC_ENOMEM;
+
+    if( ParseLocation( p_sys, p_access->psz_location ) )
+    {
+        msg_Dbg( p_access, "not an IPv4 multicast group, skipping" );
+        free( p_sys );
+        return VLC_EGENERIC;
+    }
+
+    p_sys->p_fifo = block_FifoNewSPSC();
+    if( unlikely(p_sys->p_fifo == NULL) )
+    {
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+
+    if( vlc_pipe( p_sys->pi_wake ) )
+        goto error;
+    fcntl( p_sys->pi_wake[1], F_SETFL, O_NONBLOCK );
+
+    p_access->p_sys = p_sys;
+    if( Join( p_access, i_ifindex ) )
+        goto error_pipe;
+
+    p_sys->p_ring = RingHold( p_this, i_ifindex );
+    if( p_sys->p_ring == NULL )
+    {
+        net_Close( p_sys->fd );
+        goto error_pipe;
+    }
+
+    packet_ring_t *p_ring = p_sys->p_ring;
+    access_sys_t **pp_bucket =
+        &p_ring->pp_hash[Hash( p_sys->i_group, p_sys->i_port )];
+
+    vlc_mutex_lock( &p_ring->lock );
+    p_sys->p_next = *pp_bucket;
+    *pp_bucket = p_sys;
+    vlc_mutex_unlock( &p_ring->lock );
+
+    access_InitFields( p_access );
+    ACCESS_SET_CALLBACKS( NULL, Block, Control, NULL );
+    return VLC_SUCCESS;
+
+error_pipe:
+    close( p_sys->pi_wake[0] );
+    close( p_sys->pi_wake[1] );
+error:
+    block_FifoRelease( p_sys->p_fifo );
+    free( p_sys );
+    return VLC_EGENERIC;
+}
+
+/*****************************************************************************
+ * Close: unsubscribes from the packet ring
+ *****************************************************************************/
+static void Close( vlc_object_t *p_this )
+{
+    access_t     *p_access = (access_t*)p_this;
+    access_sys_t *p_sys = p_access->p_sys;
+    packet_ring_t *p_ring = p_sys->p_ring;
+
+    vlc_mutex_lock( &p_ring->lock );
+    for( access_sys_t **pp =
+             &p_ring->pp_hash[Hash( p_sys->i_group, p_sys->i_port )];
+         *pp != NULL; pp = &(*pp)->p_next )
+        if( *pp == p_sys )
+        {
+            *pp = p_sys->p_next;
+            break;
+        }
+    vlc_mutex_unlock( &p_ring->lock );
+
+    RingRelease( p_ring );
+    net_Close( p_sys->fd );
+    close( p_sys->pi_wake[0] );
+    close( p_sys->pi_wake[1] );
+    block_FifoRelease( p_sys->p_fifo );
+    free( p_sys );
+}
+
+/*****************************************************************************
+ * Control:
+ *****************************************************************************/
+static int Control( access_t *p_access, int i_query, va_list args )
+{
+    bool    *pb_bool;
+    int64_t *pi_64;
+
+    switch( i_query )
+    {
+        /* */
+        case ACCESS_CAN_SEEK:
+        case ACCESS_CAN_FASTSEEK:
+        case ACCESS_CAN_PAUSE:
+        case ACCESS_CAN_CONTROL_PACE:
+            pb_bool = (bool*)va_arg( args, bool* );
+            *pb_bool = false;
+            break;
+        /* */
+        case ACCESS_GET_PTS_DELAY:
+            pi_64 = (int64_t*)va_arg( args, int64_t * );
+            *pi_64 = INT64_C(1000)
+                   * var_InheritInteger(p_access, "network-caching");
+            break;
+
+        /* */
+        case ACCESS_SET_PAUSE_STATE:
+        case ACCESS_GET_TITLE_INFO:
+        case ACCESS_SET_TITLE:
+        case ACCESS_SET_SEEKPOINT:
+        case ACCESS_SET_PRIVATE_ID_STATE:
+        case ACCESS_GET_CONTENT_TYPE:
+            return VLC_EGENERIC;
+
+        default:
+            msg_Warn( p_access, "unimplemented query in control" );
+            return VLC_EGENERIC;
+
+    }
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Block:
+ *****************************************************************************
+ * Returns all the datagrams dispatched to this input so far as a chain.
+ *****************************************************************************/
+static block_t *Block( access_t *p_access )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    block_t *p_chain = NULL, **pp_last = &p_chain;
+
+    /* Each wake-up byte is written after its data is queued,
+     * so that none can be missed after the count was checked. */
+    while( block_FifoCount( p_sys->p_fifo ) == 0 )
+    {
+        uint8_t buf[64];
+
+        if( net_Read( p_access, p_sys->pi_wake[0], NULL,
+                      buf, sizeof( buf ), false ) < 0 )
+            return NULL;
+    }
+
+    for( size_t n = block_FifoCount( p_sys->p_fifo ); n > 0; n-- )
+        block_ChainLastAppend( &pp_last, block_FifoGet( p_sys->p_fifo ) );
+    return p_chain;
+}
@@ -0,0 +1,156 @@
+/**
+ * @file fec.c
+ * @brief SMPTE 2022-1 forward error correction for RTP
+ */
+/*****************************************************************************
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ ****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+
+#include "rtp.h"
+
+/*
+ * A FEC packet is a RTP packet whose payload starts with this header:
+ *
+ *  0                   1                   2                   3
+ *  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+ * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ * |      SNBase low bits          |        Length recovery        |
+ * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ * |E| PT recovery |                    Mask                       |
+ * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ * |                          TS recovery                          |
+ * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ * |N|D|type |index|    Offset     |       NA      |SNBase ext bits|
+ * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *
+ * followed by the XOR of the protected packets after their RTP headers.
+ * It protects the NA packets SNBase, SNBase + Offset, ...
+ * SMPTE 2022-1 protected packets have no CSRC, extension nor padding.
+ */
+#define FEC_HEADER_SIZE 16
+
+/** Returns the offset of the FEC header, or 0 if the packet is invalid */
+static size_t fec_header_offset (const block_t *fec)
+{
+    if (fec->i_buffer < 12 || (fec->p_buffer[0] >> 6) != 2)
+        return 0;
+
+    size_t skip = 12u + (fec->p_buffer[0] & 0x0F) * 4;
+    if (fec->p_buffer[0] & 0x10)
+    {
+        skip += 4;
+        if (fec->i_buffer < skip)
+            return 0;
+        skip += 4 * GetWBE (fec->p_buffer + skip - 2);
+    }
+
+    if (fec->i_buffer < skip + FEC_HEADER_SIZE)
+        return 0;
+    return skip;
+}
+
+/**
+ * Parses a FEC packet.
+ * @param base set to the sequence number of the first protected packet
+ * @param offset set to the sequence number step between protected packets
+ * @param count set to the number of protected packets
+ * @return false if the packet is not a usable XOR FEC packet
+ */
+bool rtp_fec_parse (const block_t *fec, uint16_t *base, unsigned *offset,
+                    unsigned *count)
+{
+    size_t skip = fec_header_offset (fec);
+    if (skip == 0)
+        return false;
+
+    const uint8_t *hdr = fec->p_buffer + skip;
+    if ((hdr[12] >> 3) & 7)
+        return false; /* not XOR */
+
+    *base = GetWBE (hdr);
+    *offset = hdr[13];
+    *count = hdr[14];
+    return *offset > 0 && *count > 1;
+}
+
+/**
+ * Recovers the single missing packet protected by a FEC packet.
+ * @param fec FEC packet (checked with rtp_fec_parse())
+ * @param pktv the other protected packets
+ * @param count number of packets in pktv
+ * @param seq sequence number of the missing packet
+ * @return the recovered RTP packet, or NULL on error
+ */
+block_t *rtp_fec_recover (const block_t *fec, block_t *const *pktv,
+                          unsigned count, uint16_t seq)
+{
+    size_t skip = fec_header_offset (fec);
+    assert (skip != 0 && count > 0);
+
+    const uint8_t *hdr = fec->p_buffer + skip;
+    const uint8_t *payload = hdr + FEC_HEADER_SIZE;
+    size_t payload_len = fec->i_buffer - skip - FEC_HEADER_SIZE;
+
+    uint16_t len = GetWBE (hdr + 2);
+    uint8_t ptype = hdr[4] & 0x7F;
+    uint32_t ts = GetDWBE (hdr + 8);
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        const block_t *pkt = pktv[i];
+
+        assert (pkt->i_buffer >= 12);
+        len ^= pkt->i_buffer - 12;
+        ptype ^= pkt->p_buffer[1] & 0x7F;
+        ts ^= GetDWBE (pkt->p_buffer + 4);
+    }
+
+    if (len > payload_len)
+        return NULL; /* inconsistent with the other packets */
+
+    block_t *block = block_Alloc (12 + len);
+    if (unlikely(block == NULL))
+        return NULL;
+
+    uint8_t *p = block->p_buffer;
+    p[0] = 0x80;
+    p[1] = ptype;
+    SetWBE (p + 2, seq);
+    SetDWBE (p + 4, ts);
+    memcpy (p + 8, pktv[0]->p_buffer + 8, 4); /* SSRC */
+
+    p += 12;
+    memcpy (p, payload, len);
+    for (unsigned i = 0; i < count; i++)
+    {
+        const uint8_t *data = pktv[i]->p_buffer + 12;
+        size_t data_len = pktv[i]->i_buffer - 12;
+
+        if (data_len > len)
+            data_len = len;
+        for (size_t j = 0; j < data_len; j++)
+            p[j] ^= data[j];
+    }
+    return block;
+}
@@ -41,42 +41,184 @@
 #endif
 
 /**
- * Processes a packet received from the RTP socket.
+ * Processes packets received from the RTP socket.
  */
-static void rtp_process (demux_t *demux, block_t *block)
+static void rtp_process (demux_t *demux, block_t **blockv, unsigned count)
 {
     demux_sys_t *sys = demux->p_sys;
+    unsigned n = 0;
 
-    if (block->i_buffer < 2)
-        goto drop;
-    const uint8_t ptype = rtp_ptype (block);
-    if (ptype >= 72 && ptype <= 76)
-        goto drop; /* Muxed RTCP, ignore for now FIXME */
+    for (unsigned i = 0; i < count; i++)
+    {
+        block_t *block = blockv[i];
+
+        if (block->i_buffer < 2)
+            goto drop;
+        const uint8_t ptype = rtp_ptype (block);
+        if (ptype >= 72 && ptype <= 76)
+            goto drop; /* Muxed RTCP, ignore for now FIXME */
+
+        blockv[n++] = block;
+        continue;
+    drop:
+        block_Release (block);
+    }
 
 #ifdef HAVE_SRTP
-    if (sys->srtp != NULL)
+    if (sys->srtp != NULL && n > 0)
     {
-        size_t len = block->i_buffer;
-        if (srtp_recv (sys->srtp, block->p_buffer, &len))
+        uint8_t *bufv[n];
+        size_t lenv[n];
+        int errv[n];
+
+        for (unsigned i = 0; i < n; i++)
         {
-            msg_Dbg (demux, "SRTP authentication/decryption failed");
-            goto drop;
+            bufv[i] = blockv[i]->p_buffer;
+            lenv[i] = blockv[i]->i_buffer;
+        }
+
+        /* All packets in one go */
+        srtp_recv_batch (sys->srtp, n, bufv, lenv, errv);
+
+        count = n;
+        n = 0;
+        for (unsigned i = 0; i < count; i++)
+        {
+            if (errv[i])
+            {
+                msg_Dbg (demux, "SRTP authentication/decryption failed");
+                block_Release (blockv[i]);
+                continue;
+            }
+            blockv[i]->i_buffer = lenv[i];
+            blockv[n++] = blockv[i];
         }
-        block->i_buffer = len;
     }
 #endif
 
-    /* TODO: use SDP and get rid of this hack */
-    if (unlikely(sys->autodetect))
-    {   /* Autodetect payload type, _before_ rtp_queue() */
-        rtp_autodetect (demux, sys->session, block);
-        sys->autodetect = false;
+    for (unsigned i = 0; i < n; i++)
+    {
+        /* TODO: use SDP and get rid of this hack */
+        if (unlikely(sys->autodetect))
+        {   /* Autodetect payload type, _before_ rtp_queue() */
+            rtp_autodetect (demux, sys->session, blockv[i]);
+            sys->autodetect = false;
+        }
+
+        rtp_queue (demux, sys->session, blockv[i]);
     }
+}
 
-    rtp_queue (demux, sys->session, block);
-    return;
-drop:
-    block_Release (block);
+/* Most datagrams processed per wake-up */
+#define RTP_BATCH_MAX 16
+
+/* Receive buffers kept across wake-ups */
+typedef struct
+{
+    block_t *blockv[RTP_BATCH_MAX];
+} rtp_buffers_t;
+
+static void rtp_buffers_release (void *data)
+{
+    rtp_buffers_t *bufs = data;
+
+    for (unsigned i = 0; i < RTP_BATCH_MAX; i++)
+        if (bufs->blockv[i] != NULL)
+            block_Release (bufs->blockv[i]);
+}
+
+/**
+ * Receives the datagrams pending on the RTP socket, into the free receive
+ * buffers. The filled buffers are moved to blockv.
+ * @return the number of received datagrams
+ */
+static unsigned rtp_recv (demux_t *demux, int fd, rtp_buffers_t *bufs,
+                          block_t **blockv)
+{
+#ifdef HAVE_RECVMMSG
+    const unsigned max = RTP_BATCH_MAX;
+#else
+    const unsigned max = 1;
+#endif
+    unsigned n;
+
+    for (n = 0; n < max; n++)
+    {
+        if (bufs->blockv[n] == NULL)
+        {
+            bufs->blockv[n] = block_Alloc (0xffff); /* TODO: p_sys->mru */
+            if (unlikely(bufs->blockv[n] == NULL))
+                break;
+        }
+        bufs->blockv[n]->i_buffer = 0xffff;
+    }
+    if (unlikely(n == 0))
+        return 0;
+
+#ifdef HAVE_RECVMMSG
+    struct mmsghdr msgv[n];
+    struct iovec iov[n];
+
+    memset (msgv, 0, sizeof (msgv));
+    for (unsigned i = 0; i < n; i++)
+    {
+        iov[i].iov_base = bufs->blockv[i]->p_buffer;
+        iov[i].iov_len = bufs->blockv[i]->i_buffer;
+        msgv[i].msg_hdr.msg_iov = &iov[i];
+        msgv[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int val = recvmmsg (fd, msgv, n, MSG_DONTWAIT, NULL);
+    if (val == -1)
+    {
+        msg_Warn (demux, "RTP network error: %m");
+        return 0;
+    }
+    for (int i = 0; i < val; i++)
+    {
+        blockv[i] = bufs->blockv[i];
+        blockv[i]->i_buffer = msgv[i].msg_len;
+    }
+    /* Keep the free buffers first */
+    memmove (bufs->blockv, bufs->blockv + val,
+             (RTP_BATCH_MAX - val) * sizeof (bufs->blockv[0]));
+    memset (bufs->blockv + RTP_BATCH_MAX - val, 0,
+            val * sizeof (bufs->blockv[0]));
+    return val;
+#else
+    ssize_t len = recv (fd, bufs->blockv[0]->p_buffer,
+                        bufs->blockv[0]->i_buffer, 0);
+    if (len == -1)
+    {
+        msg_Warn (demux, "RTP network error: %m");
+        return 0;
+    }
+    blockv[0] = bufs->blockv[0];
+    blockv[0]->i_buffer = len;
+    bufs->blockv[0] = NULL;
+    return 1;
+#endif
+}
+
+/**
+ * Receives one packet from a FEC socket.
+ */
+static void rtp_fec_recv (demux_t *demux, int fd)
+{
+    demux_sys_t *sys = demux->p_sys;
+    block_t *block = block_Alloc (0xffff);
+    if (unlikely(block == NULL))
+        return;
+
+    ssize_t len = recv (fd, block->p_buffer, block->i_buffer, MSG_DONTWAIT);
+    if (len == -1)
+    {
+        msg_Warn (demux, "FEC network error: %m");
+        block_Release (block);
+        return;
+    }
+    block->i_buffer = len;
+    rtp_fec_queue (demux, sys->session, block);
 }
 
 static int rtp_timeout (mtime_t deadline)
@@ -104,13 +246,22 @@ void *rtp_dgram_thread (void *opaque)
     mtime_t deadline = VLC_TS_INVALID;
     int rtp_fd = sys->fd;
 
-    struct pollfd ufd[1];
+    struct pollfd ufd[3];
     ufd[0].fd = rtp_fd;
     ufd[0].events = POLLIN;
+    for (unsigned i = 0; i < 2; i++)
+    {   /* negative file descriptors are ignored */
+        ufd[1 + i].fd = sys->fec_fd[i];
+        ufd[1 + i].events = POLLIN;
+    }
+
+    rtp_buffers_t bufs;
+    memset (&bufs, 0, sizeof (bufs));
+    vlc_cleanup_push (rtp_buffers_release, &bufs);
 
     for (;;)
     {
-        int n = poll (ufd, 1, rtp_timeout (deadline));
+        int n = poll (ufd, 3, rtp_timeout (deadline));
         if (n == -1)
             continue;
 
@@ -124,28 +275,25 @@ void *rtp_dgram_thread (void *opaque)
             if (unlikely(ufd[0].revents & POLLHUP))
                 break; /* RTP socket dead (DCCP only) */
 
-            block_t *block = block_Alloc (0xffff); /* TODO: p_sys->mru */
-            if (unlikely(block == NULL))
-                break; /* we are totallly screwed */
+            block_t *blockv[RTP_BATCH_MAX];
+            unsigned count = rtp_recv (demux, rtp_fd, &bufs, blockv);
+            if (count > 0)
+                rtp_process (demux, blockv, count);
+        }
 
-            ssize_t len = recv (rtp_fd, block->p_buffer, block->i_buffer, 0);
-            if (len != -1)
-            {
-                block->i_buffer = len;
-                rtp_process (demux, block);
-            }
-            else
+        for (unsigned i = 1; i < 3 && n > 0; i++)
+            if (ufd[i].revents)
             {
-                msg_Warn (demux, "RTP network error: %m");
-                block_Release (block);
+                n--;
+                rtp_fec_recv (demux, ufd[i].fd);
             }
-        }
 
     dequeue:
         if (!rtp_dequeue (demux, sys->session, &deadline))
             deadline = VLC_TS_INVALID;
         vlc_restorecancel (canc);
     }
+    vlc_cleanup_run ();
     return NULL;
 }
 
@@ -183,7 +331,7 @@ void *rtp_stream_thread (void *opaque)
         }
 
         int canc = vlc_savecancel ();
-        rtp_process (demux, block);
+        rtp_process (demux, &block, 1);
         rtp_dequeue_force (demux, sys->session);
         vlc_restorecancel (canc);
     }
@@ -75,6 +75,11 @@
     "RTP packets will be discarded if they are too far behind (i.e. in the " \
     "past) by this many packets from the last received packet." )
 
+#define RTP_FEC_TEXT N_("SMPTE 2022-1 forward error correction")
+#define RTP_FEC_LONGTEXT N_( \
+    "Lost RTP packets will be recovered with the column and row FEC " \
+    "streams received on the RTP port plus 2 and plus 4 respectively.")
+
 #define RTP_DYNAMIC_PT_TEXT N_("RTP payload format assumed for dynamic " \
                                "payloads")
 #define RTP_DYNAMIC_PT_LONGTEXT N_( \
@@ -122,6 +127,8 @@ vlc_module_begin ()
     add_integer ("rtp-max-misorder", 100, RTP_MAX_MISORDER_TEXT,
                  RTP_MAX_MISORDER_LONGTEXT, true)
         change_integer_range (0, 32767)
+    add_bool ("rtp-fec", false, RTP_FEC_TEXT, RTP_FEC_LONGTEXT, true)
+        change_safe ()
     add_string ("rtp-dynamic-pt", NULL, RTP_DYNAMIC_PT_TEXT,
                 RTP_DYNAMIC_PT_LONGTEXT, true)
         change_string_list (dynamic_pt_list, dynamic_pt_list_text, NULL)
@@ -205,7 +212,7 @@ static int Open (vlc_object_t *obj)
     int rtcp_dport = var_CreateGetInteger (obj, "rtcp-port");
 
     /* Try to connect */
-    int fd = -1, rtcp_fd = -1;
+    int fd = -1, rtcp_fd = -1, fec_fd[2] = { -1, -1 };
 
     switch (tp)
     {
@@ -216,6 +223,17 @@ static int Open (vlc_object_t *obj)
                 break;
             if (rtcp_dport > 0) /* XXX: source port is unknown */
                 rtcp_fd = net_OpenDgram (obj, dhost, rtcp_dport, shost, 0, tp);
+            if (var_CreateGetBool (obj, "rtp-fec"))
+            {
+                for (unsigned i = 0; i < 2; i++)
+                {
+                    fec_fd[i] = net_OpenDgram (obj, dhost, dport + 2 * (i + 1),
+                                               shost, 0, tp);
+                    if (fec_fd[i] == -1)
+                        msg_Warn (obj, "cannot open %s FEC port %d",
+                                  i ? "row" : "column", dport + 2 * (i + 1));
+                }
+            }
             break;
 
          case IPPROTO_DCCP:
@@ -250,6 +268,9 @@ static int Open (vlc_object_t *obj)
         net_Close (fd);
         if (rtcp_fd != -1)
             net_Close (rtcp_fd);
+        for (unsigned i = 0; i < 2; i++)
+            if (fec_fd[i] != -1)
+                net_Close (fec_fd[i]);
         return VLC_EGENERIC;
     }
 
@@ -258,6 +279,8 @@ static int Open (vlc_object_t *obj)
 #endif
     p_sys->fd           = fd;
     p_sys->rtcp_fd      = rtcp_fd;
+    p_sys->fec_fd[0]    = fec_fd[0];
+    p_sys->fec_fd[1]    = fec_fd[1];
     p_sys->max_src      = var_CreateGetInteger (obj, "rtp-max-src");
     p_sys->timeout      = var_CreateGetInteger (obj, "rtp-timeout")
                         * CLOCK_FREQ;
@@ -332,6 +355,9 @@ static void Close (vlc_object_t *obj)
 #endif
     if (p_sys->session)
         rtp_session_destroy (demux, p_sys->session);
+    for (unsigned i = 0; i < 2; i++)
+        if (p_sys->fec_fd[i] != -1)
+            net_Close (p_sys->fec_fd[i]);
     if (p_sys->rtcp_fd != -1)
         net_Close (p_sys->rtcp_fd);
     net_Close (p_sys->fd);
@@ -51,9 +51,15 @@ void xiph_decode (demux_t *demux, void *data, block_t *block);
 rtp_session_t *rtp_session_create (demux_t *);
 void rtp_session_destroy (demux_t *, rtp_session_t *);
 void rtp_queue (demux_t *, rtp_session_t *, block_t *);
-bool rtp_dequeue (demux_t *, const rtp_session_t *, mtime_t *);
+bool rtp_dequeue (demux_t *, rtp_session_t *, mtime_t *);
 void rtp_dequeue_force (demux_t *, const rtp_session_t *);
 int rtp_add_type (demux_t *demux, rtp_session_t *ses, const rtp_pt_t *pt);
+void rtp_fec_queue (demux_t *, rtp_session_t *, block_t *);
+
+/** @section SMPTE 2022-1 FEC */
+bool rtp_fec_parse (const block_t *, uint16_t *, unsigned *, unsigned *);
+block_t *rtp_fec_recover (const block_t *, block_t *const *, unsigned,
+                          uint16_t);
 
 void *rtp_dgram_thread (void *data);
 void *rtp_stream_thread (void *data);
@@ -67,6 +73,7 @@ struct demux_sys_t
 #endif
     int           fd;
     int           rtcp_fd;
+    int           fec_fd[2]; /**< Column and row FEC sockets, or -1 */
     vlc_thread_t  thread;
 
     mtime_t       timeout;
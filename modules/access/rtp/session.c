@@ -35,6 +35,11 @@
 
 typedef struct rtp_source_t rtp_source_t;
 
+/** Maximum number of pending FEC packets */
+#define RTP_FEC_MAX 64
+/** Number of decoded packets kept for FEC recovery (power of two) */
+#define RTP_FEC_HISTORY 256
+
 /** State for a RTP session: */
 struct rtp_session_t
 {
@@ -42,6 +47,10 @@ struct rtp_session_t
     unsigned       srcc;
     uint8_t        ptc;
     rtp_pt_t      *ptv;
+
+    block_t       *fecv[RTP_FEC_MAX]; /* pending SMPTE 2022-1 FEC packets */
+    unsigned       fecc;
+    unsigned       fec_span; /* packets sent before the FEC of a packet */
 };
 
 static rtp_source_t *
@@ -50,6 +59,7 @@ static void
 rtp_source_destroy (demux_t *, const rtp_session_t *, rtp_source_t *);
 
 static void rtp_decode (demux_t *, const rtp_session_t *, rtp_source_t *);
+static void rtp_source_flush (rtp_source_t *);
 
 /**
  * Creates a new RTP session.
@@ -65,6 +75,8 @@ rtp_session_create (demux_t *demux)
     session->srcc = 0;
     session->ptc = 0;
     session->ptv = NULL;
+    session->fecc = 0;
+    session->fec_span = 0;
 
     (void)demux;
     return session;
@@ -79,6 +91,9 @@ void rtp_session_destroy (demux_t *demux, rtp_session_t *session)
     for (unsigned i = 0; i < session->srcc; i++)
         rtp_source_destroy (demux, session, session->srcv[i]);
 
+    for (unsigned i = 0; i < session->fecc; i++)
+        block_Release (session->fecv[i]);
+
     free (session->srcv);
     free (session->ptv);
     free (session);
@@ -147,8 +162,11 @@ struct rtp_source_t
     uint16_t bad_seq; /* tentatively next expected sequence for resync */
     uint16_t max_seq; /* next expected sequence */
 
-    uint16_t last_seq; /* sequence of the next dequeued packet */
-    block_t *blocks; /* re-ordered blocks queue */
+    uint16_t last_seq; /* sequence of the last dequeued packet */
+    uint16_t ring_mask; /* re-ordering ring size minus one */
+    unsigned queued; /* number of packets in the ring */
+    block_t **ring; /* re-ordered blocks, indexed by sequence number */
+    block_t **history; /* copies of the last decoded packets (FEC only) */
     void    *opaque[0]; /* Per-source private payload data */
 };
 
@@ -159,12 +177,33 @@ static rtp_source_t *
 rtp_source_create (demux_t *demux, const rtp_session_t *session,
                    uint32_t ssrc, uint16_t init_seq)
 {
+    demux_sys_t *p_sys = demux->p_sys;
     rtp_source_t *source;
 
     source = malloc (sizeof (*source) + (sizeof (void *) * session->ptc));
     if (source == NULL)
         return NULL;
 
+    /* The ring must span the whole accepted sequence window */
+    unsigned size = 64;
+    while (size <= (unsigned)p_sys->max_dropout + p_sys->max_misorder
+        && size < 32768)
+        size *= 2;
+
+    source->ring = calloc (size, sizeof (block_t *));
+    source->history = NULL;
+    if (p_sys->fec_fd[0] != -1 || p_sys->fec_fd[1] != -1)
+        source->history = calloc (RTP_FEC_HISTORY, sizeof (block_t *));
+    if (unlikely(source->ring == NULL
+     || ((p_sys->fec_fd[0] != -1 || p_sys->fec_fd[1] != -1)
+      && source->history == NULL)))
+    {
+        free (source->history);
+        free (source->ring);
+        free (source);
+        return NULL;
+    }
+
     source->ssrc = ssrc;
     source->jitter = 0;
     source->ref_rtp = 0;
@@ -172,7 +211,8 @@ rtp_source_create (demux_t *demux, const rtp_session_t *session,
     source->ref_ntp = UINT64_C (1) << 62;
     source->max_seq = source->bad_seq = init_seq;
     source->last_seq = init_seq - 1;
-    source->blocks = NULL;
+    source->ring_mask = size - 1;
+    source->queued = 0;
 
     /* Initializes all payload */
     for (unsigned i = 0; i < session->ptc; i++)
@@ -194,7 +234,15 @@ rtp_source_destroy (demux_t *demux, const rtp_session_t *session,
 
     for (unsigned i = 0; i < session->ptc; i++)
         session->ptv[i].destroy (demux, source->opaque[i]);
-    block_ChainRelease (source->blocks);
+    rtp_source_flush (source);
+    if (source->history != NULL)
+    {
+        for (unsigned i = 0; i < RTP_FEC_HISTORY; i++)
+            if (source->history[i] != NULL)
+                block_Release (source->history[i]);
+        free (source->history);
+    }
+    free (source->ring);
     free (source);
 }
 
@@ -210,6 +258,86 @@ static inline uint32_t rtp_timestamp (const block_t *block)
     return GetDWBE (block->p_buffer + 4);
 }
 
+/**
+ * Returns the queued packet with the lowest sequence number.
+ */
+static block_t **rtp_source_first (rtp_source_t *src)
+{
+    assert (src->queued > 0);
+
+    for (uint16_t seq = src->last_seq + 1;; seq++)
+    {
+        block_t **pp = &src->ring[seq & src->ring_mask];
+        if (*pp != NULL)
+            return pp;
+    }
+}
+
+/**
+ * Returns the queued or recently decoded packet with a given sequence number,
+ * or NULL if there is none.
+ */
+static block_t *rtp_source_get (const rtp_source_t *src, uint16_t seq)
+{
+    block_t *block = src->ring[seq & src->ring_mask];
+    if (block != NULL && rtp_seq (block) == seq)
+        return block;
+
+    if (src->history != NULL)
+    {
+        block = src->history[seq & (RTP_FEC_HISTORY - 1)];
+        if (block != NULL && rtp_seq (block) == seq)
+            return block;
+    }
+    return NULL;
+}
+
+static void rtp_source_flush (rtp_source_t *src)
+{
+    for (unsigned i = 0; src->queued > 0; i++)
+        if (src->ring[i] != NULL)
+        {
+            block_Release (src->ring[i]);
+            src->ring[i] = NULL;
+            src->queued--;
+        }
+}
+
+/**
+ * Inserts a packet in the re-ordering ring of its source.
+ */
+static void rtp_source_insert (demux_t *demux, const rtp_session_t *session,
+                               rtp_source_t *src, block_t *block)
+{
+    const uint16_t seq = rtp_seq (block);
+
+    if ((int16_t)(seq - (src->last_seq + 1)) < 0)
+    {   /* Trash too late packets (and PIM Assert duplicates) */
+        msg_Dbg (demux, "ignoring late packet (sequence: %"PRIu16")", seq);
+        block_Release (block);
+        return;
+    }
+
+    /* Make room if the packet is too far ahead of the ring */
+    while ((uint16_t)(seq - (src->last_seq + 1)) > src->ring_mask)
+    {
+        if (src->queued > 0)
+            rtp_decode (demux, session, src);
+        else
+            src->last_seq = seq - src->ring_mask - 1;
+    }
+
+    block_t **pp = &src->ring[seq & src->ring_mask];
+    if (*pp != NULL)
+    {
+        msg_Dbg (demux, "duplicate packet (sequence: %"PRIu16")", seq);
+        block_Release (block);
+        return;
+    }
+    *pp = block;
+    src->queued++;
+}
+
 static const struct rtp_pt_t *
 rtp_find_ptype (const rtp_session_t *session, rtp_source_t *source,
                 const block_t *block, void **pt_data)
@@ -335,10 +463,10 @@ rtp_queue (demux_t *demux, rtp_session_t *session, block_t *block)
         if (seq == src->bad_seq)
         {
             src->max_seq = src->bad_seq = seq + 1;
-            src->last_seq = seq - 0x7fffe; /* hack for rtp_decode() */
+            src->last_seq = seq - 1;
             msg_Warn (demux, "sequence resynchronized");
-            block_ChainRelease (src->blocks);
-            src->blocks = NULL;
+            rtp_source_flush (src);
+            block->i_flags |= BLOCK_FLAG_DISCONTINUITY;
         }
         else
         {
@@ -352,31 +480,115 @@ rtp_queue (demux_t *demux, rtp_session_t *session, block_t *block)
 
     /* Queues the block in sequence order,
      * hence there is a single queue for all payload types. */
-    block_t **pp = &src->blocks;
-    for (block_t *prev = *pp; prev != NULL; prev = *pp)
+    rtp_source_insert (demux, session, src, block);
+    return;
+
+drop:
+    block_Release (block);
+}
+
+/**
+ * Recovers the missing packets of a source that the pending FEC packets
+ * allow, and discards the FEC packets that have become useless.
+ */
+static void rtp_fec_process (demux_t *demux, rtp_session_t *session,
+                             rtp_source_t *src)
+{
+    bool recovered;
+
+    do
     {
-        int16_t delta_seq = seq - rtp_seq (prev);
-        if (delta_seq < 0)
-            break;
-        if (delta_seq == 0)
+        recovered = false;
+
+        for (unsigned i = 0; i < session->fecc;)
         {
-            msg_Dbg (demux, "duplicate packet (sequence: %"PRIu16")", seq);
-            goto drop; /* duplicate */
+            block_t *fec = session->fecv[i];
+            uint16_t base, lost_seq = 0;
+            unsigned offset, count, lost = 0;
+            bool pending = false;
+
+            rtp_fec_parse (fec, &base, &offset, &count);
+
+            block_t *pktv[count];
+            unsigned n = 0;
+
+            for (unsigned k = 0; k < count; k++)
+            {
+                uint16_t seq = base + k * offset;
+                block_t *pkt = rtp_source_get (src, seq);
+
+                if (pkt != NULL)
+                    pktv[n++] = pkt;
+                else
+                {
+                    lost++;
+                    lost_seq = seq;
+                    /* Still worth waiting for? */
+                    if ((int16_t)(seq - (src->last_seq + 1)) >= 0)
+                        pending = true;
+                }
+            }
+
+            if (lost == 1 && pending)
+            {
+                block_t *block = rtp_fec_recover (fec, pktv, n, lost_seq);
+                if (block != NULL)
+                {
+                    msg_Dbg (demux, "recovered packet (sequence: %"PRIu16")",
+                             lost_seq);
+                    block->i_pts = mdate ();
+                    rtp_source_insert (demux, session, src, block);
+                    recovered = true;
+                }
+            }
+
+            if (lost >= 2 && pending)
+            {
+                i++;
+                continue;
+            }
+
+            /* Complete, recovered or hopeless */
+            block_Release (fec);
+            session->fecv[i] = session->fecv[--session->fecc];
         }
-        pp = &prev->p_next;
     }
-    block->p_next = *pp;
-    *pp = block;
+    while (recovered);
+}
 
-    /*rtp_decode (demux, session, src);*/
-    return;
+/**
+ * Receives a SMPTE 2022-1 FEC packet for the RTP session.
+ * FEC is only supported for the first RTP source of the session.
+ * Not a cancellation point.
+ */
+void rtp_fec_queue (demux_t *demux, rtp_session_t *session, block_t *block)
+{
+    uint16_t base;
+    unsigned offset, count;
 
-drop:
-    block_Release (block);
-}
+    if (session->srcc == 0 || session->srcv[0]->history == NULL
+     || !rtp_fec_parse (block, &base, &offset, &count))
+    {
+        block_Release (block);
+        return;
+    }
 
+    if (session->fecc >= RTP_FEC_MAX)
+    {   /* Drop the oldest */
+        block_Release (session->fecv[0]);
+        memmove (session->fecv, session->fecv + 1,
+                 --session->fecc * sizeof (session->fecv[0]));
+    }
+    session->fecv[session->fecc++] = block;
 
-static void rtp_decode (demux_t *, const rtp_session_t *, rtp_source_t *);
+    /* Column FEC packets are often sent during the next FEC matrix:
+     * allow for twice the matrix size. */
+    unsigned span = 2 * count * offset;
+    if (span > session->fec_span && span < RTP_FEC_HISTORY)
+        session->fec_span = span;
+
+    rtp_fec_process (demux, session, session->srcv[0]);
+}
 
 /**
  * Dequeues RTP packets and pass them to decoder. Not cancellation-safe(?).
@@ -390,7 +602,7 @@ static void rtp_decode (demux_t *, const rtp_session_t *, rtp_source_t *);
  * @return true if the buffer is not empty, false otherwise.
  * In the later case, *deadlinep is undefined.
  */
-bool rtp_dequeue (demux_t *demux, const rtp_session_t *session,
+bool rtp_dequeue (demux_t *demux, rtp_session_t *session,
                   mtime_t *restrict deadlinep)
 {
     mtime_t now = mdate ();
@@ -419,14 +631,23 @@ bool rtp_dequeue (demux_t *demux, const rtp_session_t *session,
          * LibVLC E/S-out clock synchronization. Here, we need to bother about
          * re-ordering packets, as decoders can't cope with mis-ordered data.
          */
-        while (((block = src->blocks)) != NULL)
+        while (src->queued > 0)
         {
-            if ((int16_t)(rtp_seq (block) - (src->last_seq + 1)) <= 0)
-            {   /* Next (or earlier) block ready, no need to wait */
+            block = *rtp_source_first (src);
+            if (rtp_seq (block) == (uint16_t)(src->last_seq + 1))
+            {   /* Next block ready, no need to wait */
                 rtp_decode (demux, session, src);
                 continue;
             }
 
+            if (session->fecc > 0 && i == 0)
+            {   /* Missing packet: try to recover it */
+                rtp_fec_process (demux, session, src);
+                block = *rtp_source_first (src);
+                if (rtp_seq (block) == (uint16_t)(src->last_seq + 1))
+                    continue;
+            }
+
             /* Wait for 3 times the inter-arrival delay variance (about 99.7%
              * match for random gaussian jitter).
              */
@@ -446,7 +667,28 @@ bool rtp_dequeue (demux_t *demux, const rtp_session_t *session,
              * non-missing packet (lowest sequence number). We have no better
              * estimated time of arrival, as we do not know the RTP timestamp
              * of not yet received packets. */
+            mtime_t wait = deadline;
             deadline += block->i_pts;
+
+            /* With FEC, the missing packet can be recovered once the FEC
+             * packets protecting it have been sent. */
+            if (session->fec_span > 0 && i == 0)
+            {
+                uint16_t end = src->last_seq + session->fec_span;
+                const block_t *last = rtp_source_get (src, end);
+                mtime_t fec_deadline;
+
+                if (last != NULL)
+                    fec_deadline = last->i_pts + wait;
+                else
+                if ((int16_t)(end - src->max_seq) >= 0)
+                    fec_deadline = block->i_pts + wait + CLOCK_FREQ;
+                else
+                    fec_deadline = deadline;
+                if (fec_deadline > deadline)
+                    deadline = fec_deadline;
+            }
+
             if (now >= deadline)
             {
                 rtp_decode (demux, session, src);
@@ -470,9 +712,8 @@ void rtp_dequeue_force (demux_t *demux, const rtp_session_t *session)
     for (unsigned i = 0, max = session->srcc; i < max; i++)
     {
         rtp_source_t *src = session->srcv[i];
-        block_t *block;
 
-        while (((block = src->blocks)) != NULL)
+        while (src->queued > 0)
             rtp_decode (demux, session, src);
     }
 }
@@ -483,27 +724,31 @@ void rtp_dequeue_force (demux_t *demux, const rtp_session_t *session)
 static void
 rtp_decode (demux_t *demux, const rtp_session_t *session, rtp_source_t *src)
 {
-    block_t *block = src->blocks;
+    block_t **pp = rtp_source_first (src);
+    block_t *block = *pp;
 
-    assert (block);
-    src->blocks = block->p_next;
-    block->p_next = NULL;
+    *pp = NULL;
+    src->queued--;
 
     /* Discontinuity detection */
     uint16_t delta_seq = rtp_seq (block) - (src->last_seq + 1);
     if (delta_seq != 0)
     {
-        if (delta_seq >= 0x8000)
-        {   /* Trash too late packets (and PIM Assert duplicates) */
-            msg_Dbg (demux, "ignoring late packet (sequence: %"PRIu16")",
-                      rtp_seq (block));
-            goto drop;
-        }
         msg_Warn (demux, "%"PRIu16" packet(s) lost", delta_seq);
         block->i_flags |= BLOCK_FLAG_DISCONTINUITY;
     }
     src->last_seq = rtp_seq (block);
 
+    /* Keep a copy of the packet for FEC recovery */
+    if (src->history != NULL)
+    {
+        block_t **hp = &src->history[src->last_seq & (RTP_FEC_HISTORY - 1)];
+
+        if (*hp != NULL)
+            block_Release (*hp);
+        *hp = block_Duplicate (block);
+    }
+
     /* Match the payload type */
     void *pt_data;
     const rtp_pt_t *pt = rtp_find_ptype (session, src, block, &pt_data);
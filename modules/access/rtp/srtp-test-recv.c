@@ -168,5 +168,106 @@ int main (void)
 
     srtp_destroy (se);
     srtp_destroy (sd);
+
+    /* Batches must match packet per packet processing */
+    srtp_session_t *sb;
+    se = srtp_create (SRTP_ENCR_AES_CM, SRTP_AUTH_HMAC_SHA1, 10,
+                      SRTP_PRF_AES_CM, SRTP_RCC_MODE2);
+    sb = srtp_create (SRTP_ENCR_AES_CM, SRTP_AUTH_HMAC_SHA1, 10,
+                      SRTP_PRF_AES_CM, SRTP_RCC_MODE2);
+    sd = srtp_create (SRTP_ENCR_AES_CM, SRTP_AUTH_HMAC_SHA1, 10,
+                      SRTP_PRF_AES_CM, SRTP_RCC_MODE2);
+    assert (se != NULL && sb != NULL && sd != NULL);
+    srtp_setrcc_rate (se, 4);
+    srtp_setrcc_rate (sb, 4);
+    srtp_setrcc_rate (sd, 4);
+    assert (srtp_setkeystring (se, key, salt) == 0);
+    assert (srtp_setkeystring (sb, key, salt) == 0);
+    assert (srtp_setkeystring (sd, key, salt) == 0);
+
+    enum { BATCH = 24 };
+    static uint8_t pkt[BATCH][300], pkt2[BATCH][300];
+    uint8_t *bufv[BATCH];
+    size_t lenv[BATCH], sizev[BATCH];
+    int errv[BATCH];
+
+    for (unsigned seq = 0x1000; seq < 0x10000; seq += 0x6000)
+    {   /* move all sessions close to a sequence number wrap */
+        memset (buf, 0, 12);
+        buf[0] = 0x80;
+        buf[2] = seq >> 8;
+        len = 12;
+        val = srtp_send (se, buf, &len, sizeof (buf));
+        assert (val == 0);
+        val = srtp_recv (sd, buf, &len);
+        assert (val == 0);
+
+        memset (buf, 0, 12);
+        buf[0] = 0x80;
+        buf[2] = seq >> 8;
+        bufv[0] = buf;
+        lenv[0] = 12;
+        sizev[0] = sizeof (buf);
+        srtp_send_batch (sb, 1, bufv, lenv, sizev, errv);
+        assert (errv[0] == 0);
+    }
+
+    for (unsigned b = 0; b < 3; b++) /* spans a sequence number wrap */
+    {
+        for (unsigned i = 0; i < BATCH; i++)
+        {
+            uint16_t seq = 0xffe0 + b * BATCH + i;
+
+            lenv[i] = 12 + (i * 37) % 250; /* not multiples of 16 */
+            memset (pkt[i], 0, 12);
+            pkt[i][0] = 0x80;
+            pkt[i][2] = seq >> 8;
+            pkt[i][3] = seq;
+            for (unsigned j = 12; j < lenv[i]; j++)
+                pkt[i][j] = i + j;
+            memcpy (pkt2[i], pkt[i], lenv[i]);
+            bufv[i] = pkt2[i];
+
+            len = lenv[i];
+            val = srtp_send (se, pkt[i], &len, sizeof (pkt[i]));
+            assert (val == 0);
+            sizev[i] = len; /* exactly the required size */
+        }
+
+        size_t plainv[BATCH];
+        memcpy (plainv, lenv, sizeof (lenv));
+        srtp_send_batch (sb, BATCH, bufv, lenv, sizev, errv);
+        for (unsigned i = 0; i < BATCH; i++)
+        {
+            assert (errv[i] == 0);
+            assert (lenv[i] == sizev[i]);
+            assert (!memcmp (pkt[i], pkt2[i], lenv[i]));
+        }
+
+        srtp_recv_batch (sd, BATCH, bufv, lenv, errv);
+        for (unsigned i = 0; i < BATCH; i++)
+        {
+            assert (errv[i] == 0);
+            assert (lenv[i] == plainv[i]);
+            for (unsigned j = 12; j < lenv[i]; j++)
+                assert (bufv[i][j] == (uint8_t)(i + j));
+        }
+        /* Replay attack */
+        len = sizev[1];
+        val = srtp_recv (sd, pkt[1], &len);
+        assert (val == EACCES);
+    }
+
+    /* Too small buffer in a batch */
+    pkt2[0][3]++;
+    lenv[0] = 20;
+    sizev[0] = 20;
+    srtp_send_batch (sb, 1, bufv, lenv, sizev, errv);
+    assert (errv[0] == ENOSPC);
+    assert (lenv[0] > 20);
+
+    srtp_destroy (se);
+    srtp_destroy (sb);
+    srtp_destroy (sd);
     return 0;
 }
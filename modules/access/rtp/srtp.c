@@ -68,6 +68,14 @@ struct srtp_session_t
     uint8_t  tag_len;
 };
 
+/** Pending en-/decryption of one packet in a batch */
+typedef struct srtp_job_t
+{
+    uint32_t counter[4];
+    uint8_t *data;
+    size_t   len;
+} srtp_job_t;
+
 enum
 {
     SRTP_CRYPT,
@@ -229,6 +237,22 @@ do_ctr_crypt (gcry_cipher_hd_t hd, const void *ctr, uint8_t *data, size_t len)
 }
 
 
+/**
+ * Counter Mode encryption/decryption of several buffers, each with its own
+ * counter. gcrypt processes many blocks of each buffer at once (AES-NI).
+ */
+static int
+do_ctr_crypt_batch (gcry_cipher_hd_t hd, const srtp_job_t *jobs,
+                    unsigned count)
+{
+    for (unsigned i = 0; i < count; i++)
+        if (jobs[i].len > 0
+         && do_ctr_crypt (hd, jobs[i].counter, jobs[i].data, jobs[i].len))
+            return -1;
+    return 0;
+}
+
+
 /**
  * AES-CM key derivation (saltlen = 14 bytes)
  */
@@ -388,6 +412,18 @@ void srtp_setrcc_rate (srtp_session_t *s, uint16_t rate)
 }
 
 
+/** AES-CM counter (IV) for RTP (salt = 14 bytes + 2 nul bytes) */
+static void
+rtp_counter (uint32_t *counter, uint32_t ssrc, uint32_t roc, uint16_t seq,
+             const uint32_t *salt)
+{
+    counter[0] = salt[0];
+    counter[1] = salt[1] ^ ssrc;
+    counter[2] = salt[2] ^ htonl (roc);
+    counter[3] = salt[3] ^ htonl (seq << 16);
+}
+
+
 /** AES-CM for RTP (salt = 14 bytes + 2 nul bytes) */
 static int
 rtp_crypt (gcry_cipher_hd_t hd, uint32_t ssrc, uint32_t roc, uint16_t seq,
@@ -395,10 +431,7 @@ rtp_crypt (gcry_cipher_hd_t hd, uint32_t ssrc, uint32_t roc, uint16_t seq,
 {
     /* Determines cryptographic counter (IV) */
     uint32_t counter[4];
-    counter[0] = salt[0];
-    counter[1] = salt[1] ^ ssrc;
-    counter[2] = salt[2] ^ htonl (roc);
-    counter[3] = salt[3] ^ htonl (seq << 16);
+    rtp_counter (counter, ssrc, roc, seq, salt);
 
     /* Encryption */
     return do_ctr_crypt (hd, counter, data, len);
@@ -447,18 +480,52 @@ rtp_digest (gcry_md_hd_t md, const uint8_t *data, size_t len,
 
 
 /**
- * Encrypts/decrypts a RTP packet and updates SRTP context
- * (CTR block cypher mode of operation has identical encryption and
- * decryption function).
+ * Determines the byte length of the authentication tag and of the carried
+ * Roll-Over-Counter of a RTP packet, depending on the RCC mode.
+ */
+static size_t
+rtp_tag_len (const srtp_session_t *s, const uint8_t *buf, size_t *roc_lenp)
+{
+    size_t tag_len = s->tag_len;
+
+    *roc_lenp = 0;
+    if (rcc_mode (s))
+    {
+        assert (tag_len >= 4);
+        assert (s->rtp_rcc != 0);
+        if ((rtp_seq (buf) % s->rtp_rcc) == 0)
+        {
+            *roc_lenp = 4;
+            if (rcc_mode (s) == 3)
+                tag_len = 0; /* RCC mode 3 -> no auth*/
+            else
+                tag_len -= 4; /* RCC mode 1 or 2 -> auth*/
+        }
+        else
+        {
+            if (rcc_mode (s) & 1)
+                tag_len = 0; /* RCC mode 1 or 3 -> no auth */
+        }
+    }
+    return tag_len;
+}
+
+
+/**
+ * Checks a RTP packet and updates SRTP context, then determines what needs
+ * to be en-/decrypted: the payload in job->data and job->len, and the
+ * counter in job->counter.
  *
  * @param buf RTP packet to be en-/decrypted
  * @param len RTP packet length
+ * @param rocp set to the packet Roll-Over-Counter (if not NULL)
  *
  * @return 0 on success, in case of error:
  *  EINVAL  malformatted RTP packet
  *  EACCES  replayed packet or out-of-window or sync lost
  */
-static int srtp_crypt (srtp_session_t *s, uint8_t *buf, size_t len)
+static int srtp_prepare (srtp_session_t *s, uint8_t *buf, size_t len,
+                         srtp_job_t *job, uint32_t *rocp)
 {
     assert (s != NULL);
     assert (len >= 12u);
@@ -508,12 +575,40 @@ static int srtp_crypt (srtp_session_t *s, uint8_t *buf, size_t len)
         s->rtp.window |= 1 << diff;
     }
 
+    rtp_counter (job->counter, ssrc, roc, seq, s->rtp.salt);
+    job->data = buf + offset;
+    job->len = (s->flags & SRTP_UNENCRYPTED) ? 0 : (len - offset);
+    if (rocp != NULL)
+        *rocp = roc;
+    return 0;
+}
+
+
+/**
+ * Encrypts/decrypts a RTP packet and updates SRTP context
+ * (CTR block cypher mode of operation has identical encryption and
+ * decryption function).
+ *
+ * @param buf RTP packet to be en-/decrypted
+ * @param len RTP packet length
+ *
+ * @return 0 on success, in case of error:
+ *  EINVAL  malformatted RTP packet
+ *  EACCES  replayed packet or out-of-window or sync lost
+ */
+static int srtp_crypt (srtp_session_t *s, uint8_t *buf, size_t len)
+{
+    srtp_job_t job;
+
+    int val = srtp_prepare (s, buf, len, &job, NULL);
+    if (val)
+        return val;
+
     /* Encrypt/Decrypt */
-    if (s->flags & SRTP_UNENCRYPTED)
+    if (job.len == 0)
         return 0;
 
-    if (rtp_crypt (s->rtp.cipher, ssrc, roc, seq, s->rtp.salt,
-                   buf + offset, len - offset))
+    if (do_ctr_crypt (s->rtp.cipher, job.counter, job.data, job.len))
         return EINVAL;
 
     return 0;
@@ -549,27 +644,7 @@ srtp_send (srtp_session_t *s, uint8_t *buf, size_t *lenp, size_t bufsize)
 
     if (!(s->flags & SRTP_UNAUTHENTICATED))
     {
-        tag_len = s->tag_len;
-
-        if (rcc_mode (s))
-        {
-            assert (tag_len >= 4);
-            assert (s->rtp_rcc != 0);
-            if ((rtp_seq (buf) % s->rtp_rcc) == 0)
-            {
-                roc_len = 4;
-                if (rcc_mode (s) == 3)
-                    tag_len = 0; /* RCC mode 3 -> no auth*/
-                else
-                    tag_len -= 4; /* RCC mode 1 or 2 -> auth*/
-            }
-            else
-            {
-                if (rcc_mode (s) & 1)
-                    tag_len = 0; /* RCC mode 1 or 3 -> no auth */
-            }
-        }
-
+        tag_len = rtp_tag_len (s, buf, &roc_len);
         *lenp = len + roc_len + tag_len;
     }
     else
@@ -608,19 +683,94 @@ srtp_send (srtp_session_t *s, uint8_t *buf, size_t *lenp, size_t bufsize)
 
 
 /**
- * Turns a SRTP packet into a RTP packet: authenticates the packet,
- * then decrypts it.
+ * Turns many RTP packets into SRTP packets, as srtp_send() would do for each
+ * of them in order.
  *
- * @param buf RTP packet to be digested/decrypted
- * @param lenp pointer to the SRTP packet length on entry,
- *             set to the RTP length on exit (undefined in case of error)
+ * @param count number of packets
+ * @param bufv RTP packets to be encrypted/digested
+ * @param lenv RTP packets lengths on entry, SRTP lengths on exit
+ * @param sizev packets buffers sizes
+ * @param errv set to the srtp_send() error code of each packet
+ */
+void
+srtp_send_batch (srtp_session_t *s, unsigned count, uint8_t *const *bufv,
+                 size_t *lenv, const size_t *sizev, int *errv)
+{
+    srtp_job_t jobs[count];
+    uint32_t rocv[count];
+    unsigned n = 0;
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        size_t len = lenv[i];
+
+        if (len < 12u)
+        {
+            errv[i] = EINVAL;
+            continue;
+        }
+
+        if (!(s->flags & SRTP_UNAUTHENTICATED))
+        {
+            size_t roc_len;
+            size_t tag_len = rtp_tag_len (s, bufv[i], &roc_len);
+
+            lenv[i] = len + roc_len + tag_len;
+        }
+        if (sizev[i] < lenv[i])
+        {
+            errv[i] = ENOSPC;
+            continue;
+        }
+
+        errv[i] = srtp_prepare (s, bufv[i], len, &jobs[n], &rocv[i]);
+        if (errv[i] == 0)
+            n++;
+    }
+    if (n == 0)
+        return;
+
+    if (do_ctr_crypt_batch (s->rtp.cipher, jobs, n))
+    {
+        for (unsigned i = 0; i < count; i++)
+            if (errv[i] == 0)
+                errv[i] = EINVAL;
+        return;
+    }
+
+    /* Authenticate payloads */
+    if (s->flags & SRTP_UNAUTHENTICATED)
+        return;
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        if (errv[i])
+            continue;
+
+        uint8_t *buf = bufv[i];
+        size_t roc_len, tag_len = rtp_tag_len (s, buf, &roc_len);
+        size_t len = lenv[i] - roc_len - tag_len;
+        const uint8_t *tag = rtp_digest (s->rtp.mac, buf, len, rocv[i]);
+
+        if (roc_len)
+        {
+            memcpy (buf + len, &(uint32_t){ htonl (rocv[i]) }, 4);
+            len += 4;
+        }
+        memcpy (buf + len, tag, tag_len);
+    }
+}
+
+
+/**
+ * Authenticates a SRTP packet, strips its authentication tag and updates
+ * SRTP context. Decryption is left to the caller.
  *
- * @return 0 on success, in case of error:
- *  EINVAL  malformatted SRTP packet
- *  EACCES  authentication failed (spoofed packet or out-of-sync)
+ * @return 0 on success, in case of error (see srtp_recv())
  */
-int
-srtp_recv (srtp_session_t *s, uint8_t *buf, size_t *lenp)
+static int
+srtp_recv_prepare (srtp_session_t *s, uint8_t *buf, size_t *lenp,
+                   srtp_job_t *job)
 {
     size_t len = *lenp;
     if (len < 12u)
@@ -628,23 +778,7 @@ srtp_recv (srtp_session_t *s, uint8_t *buf, size_t *lenp)
 
     if (!(s->flags & SRTP_UNAUTHENTICATED))
     {
-        size_t tag_len = s->tag_len, roc_len = 0;
-        if (rcc_mode (s))
-        {
-            if ((rtp_seq (buf) % s->rtp_rcc) == 0)
-            {
-                roc_len = 4;
-                if (rcc_mode (s) == 3)
-                    tag_len = 0;
-                else
-                    tag_len -= 4;
-            }
-            else
-            {
-                if (rcc_mode (s) & 1)
-                    tag_len = 0; // RCC mode 1 or 3: no auth
-            }
-        }
+        size_t roc_len, tag_len = rtp_tag_len (s, buf, &roc_len);
 
         if (len < (12u + roc_len + tag_len))
             return EINVAL;
@@ -682,7 +816,69 @@ srtp_recv (srtp_session_t *s, uint8_t *buf, size_t *lenp)
         *lenp = len;
     }
 
-    return srtp_crypt (s, buf, len);
+    return srtp_prepare (s, buf, len, job, NULL);
+}
+
+
+/**
+ * Turns a SRTP packet into a RTP packet: authenticates the packet,
+ * then decrypts it.
+ *
+ * @param buf RTP packet to be digested/decrypted
+ * @param lenp pointer to the SRTP packet length on entry,
+ *             set to the RTP length on exit (undefined in case of error)
+ *
+ * @return 0 on success, in case of error:
+ *  EINVAL  malformatted SRTP packet
+ *  EACCES  authentication failed (spoofed packet or out-of-sync)
+ */
+int
+srtp_recv (srtp_session_t *s, uint8_t *buf, size_t *lenp)
+{
+    srtp_job_t job;
+
+    int val = srtp_recv_prepare (s, buf, lenp, &job);
+    if (val)
+        return val;
+
+    if (job.len == 0)
+        return 0;
+
+    if (do_ctr_crypt (s->rtp.cipher, job.counter, job.data, job.len))
+        return EINVAL;
+    return 0;
+}
+
+
+/**
+ * Turns many SRTP packets into RTP packets, as srtp_recv() would do for each
+ * of them in order.
+ *
+ * @param count number of packets
+ * @param bufv SRTP packets to be digested/decrypted
+ * @param lenv SRTP packets lengths on entry, RTP lengths on exit
+ * @param errv set to the srtp_recv() error code of each packet
+ */
+void
+srtp_recv_batch (srtp_session_t *s, unsigned count, uint8_t *const *bufv,
+                 size_t *lenv, int *errv)
+{
+    srtp_job_t jobs[count];
+    unsigned n = 0;
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        errv[i] = srtp_recv_prepare (s, bufv[i], &lenv[i], &jobs[n]);
+        if (errv[i] == 0)
+            n++;
+    }
+    if (n == 0)
+        return;
+
+    if (do_ctr_crypt_batch (s->rtp.cipher, jobs, n))
+        for (unsigned i = 0; i < count; i++)
+            if (errv[i] == 0)
+                errv[i] = EINVAL;
 }
 
 
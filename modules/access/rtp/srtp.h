@@ -72,6 +72,10 @@ void srtp_setrcc_rate (srtp_session_t *s, uint16_t rate);
 
 int srtp_send (srtp_session_t *s, uint8_t *buf, size_t *lenp, size_t maxsize);
 int srtp_recv (srtp_session_t *s, uint8_t *buf, size_t *lenp);
+void srtp_send_batch (srtp_session_t *s, unsigned count, uint8_t *const *bufv,
+                      size_t *lenv, const size_t *sizev, int *errv);
+void srtp_recv_batch (srtp_session_t *s, unsigned count, uint8_t *const *bufv,
+                      size_t *lenv, int *errv);
 int srtcp_send (srtp_session_t *s, uint8_t *buf, size_t *lenp, size_t maxsiz);
 int srtcp_recv (srtp_session_t *s, uint8_t *buf, size_t *lenp);
 
@@ -41,6 +41,12 @@
 #include <vlc_access.h>
 #include <vlc_network.h>
 
+#ifdef HAVE_RECVMMSG
+# include <sys/socket.h>
+# include <sys/uio.h>
+# include <errno.h>
+#endif
+
 #define MTU 65535
 
 /*****************************************************************************
@@ -49,6 +55,16 @@
 static int  Open ( vlc_object_t * );
 static void Close( vlc_object_t * );
 
+#define BATCH_TEXT N_("Datagrams per read")
+#define BATCH_LONGTEXT N_( \
+    "Maximum number of datagrams received at once. Receiving several " \
+    "datagrams with a single system call reduces the per-packet overhead " \
+    "at high packet rates. 1 disables batching." )
+#define BATCH_MTU_TEXT N_("Batched datagram size")
+#define BATCH_MTU_LONGTEXT N_( \
+    "Size of each receive buffer in batched mode. Longer datagrams are " \
+    "truncated." )
+
 vlc_module_begin ()
     set_shortname( N_("UDP" ) )
     set_description( N_("UDP input") )
@@ -56,6 +72,13 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_INPUT_ACCESS )
 
     add_obsolete_integer( "server-port" ) /* since 2.0.0 */
+#ifdef HAVE_RECVMMSG
+    add_integer( "udp-batch", 1, BATCH_TEXT, BATCH_LONGTEXT, true )
+        change_integer_range( 1, 1024 )
+    add_integer( "udp-batch-mtu", 1500, BATCH_MTU_TEXT, BATCH_MTU_LONGTEXT,
+                 true )
+        change_integer_range( 576, MTU )
+#endif
 
     set_capability( "access", 0 )
     add_shortcut( "udp", "udpstream", "udp4", "udp6" )
@@ -67,8 +90,23 @@ vlc_module_end ()
  * Local prototypes
  *****************************************************************************/
 static block_t *BlockUDP( access_t * );
+#ifdef HAVE_RECVMMSG
+static block_t *BlockUDPBatch( access_t * );
+#endif
 static int Control( access_t *, int, va_list );
 
+struct access_sys_t
+{
+    int fd;
+#ifdef HAVE_RECVMMSG
+    unsigned i_batch; /* datagrams per read */
+    size_t i_mtu; /* size of each receive buffer */
+    block_t **pp_ring; /* pre-allocated receive buffers */
+    struct mmsghdr *p_msgs;
+    struct iovec *p_iov;
+#endif
+};
+
 /*****************************************************************************
  * Open: open the socket
  *****************************************************************************/
@@ -76,16 +114,27 @@ static int Open( vlc_object_t *p_this )
 {
     access_t     *p_access = (access_t*)p_this;
 
-    char *psz_name = strdup( p_access->psz_location );
+    char *psz_name;
     char *psz_parser;
     const char *psz_server_addr, *psz_bind_addr = "";
     int  i_bind_port = 1234, i_server_port = 0;
     int fd;
 
+    access_sys_t *p_sys = calloc( 1, sizeof( *p_sys ) );
+    if( unlikely(p_sys == NULL) )
+        return VLC_ENOMEM;
+
     /* Set up p_access */
     access_InitFields( p_access );
     ACCESS_SET_CALLBACKS( NULL, BlockUDP, Control, NULL );
 
+    psz_name = strdup( p_access->psz_location );
+    if( unlikely(psz_name == NULL) )
+    {
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+
     /* Parse psz_name syntax :
      * [serveraddr[:serverport]][@[bindaddr]:[bindport]] */
     psz_parser = strchr( psz_name, '@' );
@@ -134,9 +183,37 @@ static int Open( vlc_object_t *p_this )
     if( fd == -1 )
     {
         msg_Err( p_access, "cannot open socket" );
+        free( p_sys );
         return VLC_EGENERIC;
     }
-    p_access->p_sys = (void *)(intptr_t)fd;
+    p_sys->fd = fd;
+    p_access->p_sys = p_sys;
+
+#ifdef HAVE_RECVMMSG
+    p_sys->i_batch = var_InheritInteger( p_access, "udp-batch" );
+    p_sys->i_mtu = var_InheritInteger( p_access, "udp-batch-mtu" );
+    if( p_sys->i_batch > 1 )
+    {
+        p_sys->pp_ring = calloc( p_sys->i_batch, sizeof( *p_sys->pp_ring ) );
+        p_sys->p_msgs = calloc( p_sys->i_batch, sizeof( *p_sys->p_msgs ) );
+        p_sys->p_iov = calloc( p_sys->i_batch, sizeof( *p_sys->p_iov ) );
+        if( unlikely(p_sys->pp_ring == NULL || p_sys->p_msgs == NULL
+                  || p_sys->p_iov == NULL) )
+        {
+            Close( p_this );
+            return VLC_ENOMEM;
+        }
+
+        for( unsigned i = 0; i < p_sys->i_batch; i++ )
+        {
+            p_sys->p_msgs[i].msg_hdr.msg_iov = &p_sys->p_iov[i];
+            p_sys->p_msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        p_access->pf_block = BlockUDPBatch;
+        msg_Dbg( p_access, "receiving up to %u datagrams of %zu bytes at once",
+                 p_sys->i_batch, p_sys->i_mtu );
+    }
+#endif
 
     return VLC_SUCCESS;
 }
@@ -147,8 +224,19 @@ static int Open( vlc_object_t *p_this )
 static void Close( vlc_object_t *p_this )
 {
     access_t     *p_access = (access_t*)p_this;
+    access_sys_t *p_sys = p_access->p_sys;
 
-    net_Close( (intptr_t)p_access->p_sys );
+    net_Close( p_sys->fd );
+#ifdef HAVE_RECVMMSG
+    if( p_sys->pp_ring != NULL )
+        for( unsigned i = 0; i < p_sys->i_batch; i++ )
+            if( p_sys->pp_ring[i] != NULL )
+                block_Release( p_sys->pp_ring[i] );
+    free( p_sys->pp_ring );
+    free( p_sys->p_msgs );
+    free( p_sys->p_iov );
+#endif
+    free( p_sys );
 }
 
 /*****************************************************************************
@@ -207,7 +295,7 @@ static block_t *BlockUDP( access_t *p_access )
 
     /* Read data */
     p_block = block_New( p_access, MTU );
-    len = net_Read( p_access, (intptr_t)p_sys, NULL,
+    len = net_Read( p_access, p_sys->fd, NULL,
                     p_block->p_buffer, MTU, false );
     if( len < 0 )
     {
@@ -217,3 +305,84 @@ static block_t *BlockUDP( access_t *p_access )
 
     return block_Realloc( p_block, 0, len );
 }
+
+#ifdef HAVE_RECVMMSG
+/*****************************************************************************
+ * BlockUDPBatch:
+ *****************************************************************************
+ * Waits for one datagram with net_Read(), so that the input thread can still
+ * be interrupted, then drains whatever else is already queued on the socket
+ * with a single non-blocking recvmmsg(). The datagrams are returned as a
+ * chain of blocks; buffers that did not receive anything are kept for the
+ * next call.
+ *****************************************************************************/
+static block_t *BlockUDPBatch( access_t *p_access )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    block_t *p_chain = NULL, **pp_last = &p_chain;
+    unsigned i_slots;
+    int i_count;
+    ssize_t len;
+
+    if( p_access->info.b_eof )
+        return NULL;
+
+    /* Refill the buffers handed out by the previous call */
+    for( i_slots = 0; i_slots < p_sys->i_batch; i_slots++ )
+    {
+        block_t *p_block = p_sys->pp_ring[i_slots];
+
+        if( p_block == NULL )
+        {
+            p_block = block_Alloc( p_sys->i_mtu );
+            if( unlikely(p_block == NULL) )
+                break;
+            p_sys->pp_ring[i_slots] = p_block;
+        }
+        p_sys->p_iov[i_slots].iov_base = p_block->p_buffer;
+        p_sys->p_iov[i_slots].iov_len = p_sys->i_mtu;
+    }
+    if( unlikely(i_slots == 0) )
+        return NULL;
+
+    len = net_Read( p_access, p_sys->fd, NULL,
+                    p_sys->p_iov[0].iov_base, p_sys->i_mtu, false );
+    if( len < 0 )
+        return NULL;
+    p_sys->p_msgs[0].msg_len = len;
+    p_sys->p_msgs[0].msg_hdr.msg_flags = 0;
+
+    i_count = 0;
+    if( i_slots > 1 )
+    {
+        i_count = recvmmsg( p_sys->fd, p_sys->p_msgs + 1, i_slots - 1,
+                            MSG_DONTWAIT, NULL );
+        if( i_count < 0 )
+        {
+            if( errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR )
+                msg_Err( p_access, "batched receive error: %m" );
+            i_count = 0;
+        }
+    }
+    i_count++;
+
+    for( int i = 0; i < i_count; i++ )
+    {
+        block_t *p_block = p_sys->pp_ring[i];
+        const struct mmsghdr *p_msg = &p_sys->p_msgs[i];
+
+        if( p_msg->msg_len == 0 )
+            continue; /* keep the buffer for the next call */
+        if( p_msg->msg_hdr.msg_flags & MSG_TRUNC )
+        {
+            msg_Warn( p_access, "datagram truncated to %zu bytes "
+                      "(consider increasing udp-batch-mtu)", p_sys->i_mtu );
+            p_block->i_flags |= BLOCK_FLAG_CORRUPTED;
+        }
+        p_block->i_buffer = p_msg->msg_len;
+        p_sys->pp_ring[i] = NULL;
+        block_ChainLastAppend( &pp_last, p_block );
+    }
+    return p_chain;
+}
+#endif
@@ -0,0 +1,686 @@
+/*****************************************************************************
+ * uring.c: local file input through a shared Linux io_uring
+ *****************************************************************************
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************
+ * All the file inputs of the process share a single io_uring submission and
+ * completion queue. Each input keeps a few reads ahead of its position in
+ * flight, so that many inputs served together keep the disks busy with deep
+ * queues. One thread reaps the completions on behalf of all inputs, and
+ * wakes up the inputs whose reads completed. Optionally, the file is opened
+ * with O_DIRECT to bypass the page cache.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_input.h>
+#include <vlc_access.h>
+#include <vlc_fs.h>
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+static int  Open ( vlc_object_t * );
+static void Close( vlc_object_t * );
+
+#define URING_TEXT N_("Asynchronous file input")
+#define URING_LONGTEXT N_( \
+    "Read local files through an io_uring queue shared by all inputs, " \
+    "with several reads in flight per input, instead of one blocking " \
+    "read at a time. This helps when many files are served at once." )
+#define DEPTH_TEXT N_("Reads in flight per input")
+#define DEPTH_LONGTEXT N_( \
+    "Number of reads each input keeps queued ahead of its position." )
+#define BLOCK_TEXT N_("Read size (kB)")
+#define BLOCK_LONGTEXT N_( \
+    "Size of each queued read, in kilobytes." )
+#define DIRECT_TEXT N_("Bypass the page cache")
+#define DIRECT_LONGTEXT N_( \
+    "Open the files with O_DIRECT, so that the data is read straight from " \
+    "the disk into VLC buffers without polluting the page cache." )
+
+vlc_module_begin ()
+    set_shortname( N_("io_uring") )
+    set_description( N_("File input through io_uring") )
+    set_category( CAT_INPUT )
+    set_subcategory( SUBCAT_INPUT_ACCESS )
+
+    add_bool( "uring", false, URING_TEXT, URING_LONGTEXT, true )
+    add_integer( "uring-depth", 4, DEPTH_TEXT, DEPTH_LONGTEXT, true )
+        change_integer_range( 1, 64 )
+    add_integer( "uring-block", 256, BLOCK_TEXT, BLOCK_LONGTEXT, true )
+        change_integer_range( 4, 16384 )
+    add_bool( "uring-direct", false, DIRECT_TEXT, DIRECT_LONGTEXT, true )
+
+    /* Takes over the file input when enabled */
+    set_capability( "access", 60 )
+    add_shortcut( "file", "uring" )
+
+    set_callbacks( Open, Close )
+vlc_module_end ()
+
+/*****************************************************************************
+ * Local prototypes
+ *****************************************************************************/
+#define RING_ENTRIES 256
+#define DIRECT_ALIGN 4096 /* O_DIRECT offset, size and memory alignment */
+
+typedef struct uring_t uring_t;
+typedef struct uring_req_t uring_req_t;
+
+struct uring_t
+{
+    unsigned       i_refs;
+    int            fd;
+    vlc_thread_t   thread;
+    bool           b_exit;
+    unsigned       i_inflight;
+    unsigned       i_max_inflight;
+
+    /* Submission queue */
+    void          *p_sq;
+    size_t         i_sq;
+    unsigned      *pi_sq_head, *pi_sq_tail, *pi_sq_array;
+    unsigned       i_sq_mask;
+    struct io_uring_sqe *p_sqes;
+    size_t         i_sqes;
+
+    /* Completion queue */
+    void          *p_cq;
+    size_t         i_cq;
+    unsigned      *pi_cq_head, *pi_cq_tail;
+    unsigned       i_cq_mask;
+    struct io_uring_cqe *p_cqes;
+};
+
+enum
+{
+    REQ_IDLE,    /* no data */
+    REQ_PENDING, /* queued read */
+    REQ_DONE,    /* data available */
+};
+
+struct uring_req_t
+{
+    access_sys_t *p_sys;
+    int           i_state;
+    uint64_t      i_offset;
+    struct iovec  iov;
+    int           i_res;     /* read result or -errno */
+    int           i_used;    /* bytes already consumed */
+};
+
+struct access_sys_t
+{
+    uring_t       *p_ring;
+    int            fd;
+    bool           b_direct;
+    vlc_cond_t     wait; /* signaled by the ring thread on completions */
+
+    size_t         i_block;
+    unsigned       i_depth;
+    unsigned       i_head; /* request of the current position */
+    uint64_t       i_next; /* file offset of the next read to queue */
+    unsigned       i_skip; /* bytes to ignore from the first read */
+    uint8_t       *p_buffer;
+    uring_req_t   *p_req;
+};
+
+/* Protects the ring, its queues and the request states */
+static vlc_mutex_t ring_lock = VLC_STATIC_MUTEX;
+static uring_t *p_rings = NULL;
+
+static ssize_t Read( access_t *, uint8_t *, size_t );
+static int Seek( access_t *, uint64_t );
+static int Control( access_t *, int, va_list );
+
+/*****************************************************************************
+ * RingSubmit: queues one request (ring lock held)
+ *****************************************************************************/
+static int RingSubmit( uring_t *p_ring, uint8_t i_opcode, int fd,
+                       uring_req_t *p_req )
+{
+    if( p_ring->i_inflight >= p_ring->i_max_inflight )
+        return VLC_EGENERIC; /* no room left for its completion */
+
+    unsigned i_tail = *p_ring->pi_sq_tail;
+    unsigned i_index = i_tail & p_ring->i_sq_mask;
+    struct io_uring_sqe *p_sqe = &p_ring->p_sqes[i_index];
+
+    memset( p_sqe, 0, sizeof( *p_sqe ) );
+    p_sqe->opcode = i_opcode;
+    p_sqe->fd = fd;
+    if( p_req != NULL )
+    {
+        p_sqe->off = p_req->i_offset;
+        p_sqe->addr = (uintptr_t)&p_req->iov;
+        p_sqe->len = 1;
+    }
+    p_sqe->user_data = (uintptr_t)p_req;
+    p_ring->pi_sq_array[i_index] = i_index;
+    __atomic_store_n( p_ring->pi_sq_tail, i_tail + 1, __ATOMIC_RELEASE );
+
+    if( syscall( __NR_io_uring_enter, p_ring->fd, 1, 0, 0, NULL, 0 ) != 1 )
+    {
+        /* Take the entry back */
+        __atomic_store_n( p_ring->pi_sq_tail, i_tail, __ATOMIC_RELEASE );
+        return VLC_EGENERIC;
+    }
+    p_ring->i_inflight++;
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * RingThread: dispatches the completions to the inputs
+ *****************************************************************************/
+static void *RingThread( void *data )
+{
+    uring_t *p_ring = data;
+
+    for( ;; )
+    {
+        if( syscall( __NR_io_uring_enter, p_ring->fd, 0, 1,
+                     IORING_ENTER_GETEVENTS, NULL, 0 ) < 0 && errno != EINTR )
+            break;
+
+        vlc_mutex_lock( &ring_lock );
+        unsigned i_head = *p_ring->pi_cq_head;
+        unsigned i_tail = __atomic_load_n( p_ring->pi_cq_tail, __ATOMIC_ACQUIRE );
+
+        for( ; i_head != i_tail; i_head++ )
+        {
+            const struct io_uring_cqe *p_cqe =
+                &p_ring->p_cqes[i_head & p_ring->i_cq_mask];
+            uring_req_t *p_req = (uring_req_t *)(uintptr_t)p_cqe->user_data;
+
+            p_ring->i_inflight--;
+            if( p_req == NULL )
+                continue; /* wake-up */
+
+            p_req->i_res = p_cqe->res;
+            p_req->i_state = REQ_DONE;
+            vlc_cond_signal( &p_req->p_sys->wait );
+        }
+        __atomic_store_n( p_ring->pi_cq_head, i_head, __ATOMIC_RELEASE );
+
+        bool b_exit = p_ring->b_exit && p_ring->i_inflight == 0;
+        vlc_mutex_unlock( &ring_lock );
+        if( b_exit )
+            break;
+    }
+    return NULL;
+}
+
+/*****************************************************************************
+ * RingCreate: sets up the shared ring (ring lock held)
+ *****************************************************************************/
+static uring_t *RingCreate( vlc_object_t *p_obj )
+{
+    struct io_uring_params params;
+    uring_t *p_ring = calloc( 1, sizeof( *p_ring ) );
+    if( unlikely(p_ring == NULL) )
+        return NULL;
+
+    memset( &params, 0, sizeof( params ) );
+    p_ring->fd = syscall( __NR_io_uring_setup, RING_ENTRIES, &params );
+    if( p_ring->fd == -1 )
+    {
+        msg_Err( p_obj, "cannot create io_uring: %m" );
+        free( p_ring );
+        return NULL;
+    }
+    fcntl( p_ring->fd, F_SETFD, FD_CLOEXEC );
+
+    p_ring->i_sq = params.sq_off.array + params.sq_entries * sizeof( unsigned );
+    p_ring->i_cq = params.cq_off.cqes
+              + params.cq_entries * sizeof( struct io_uring_cqe );
+    if( params.features & IORING_FEAT_SINGLE_MMAP )
+        p_ring->i_sq = p_ring->i_cq = __MAX( p_ring->i_sq, p_ring->i_cq );
+    p_ring->i_sqes = params.sq_entries * sizeof( struct io_uring_sqe );
+
+    p_ring->p_sq = mmap( NULL, p_ring->i_sq, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, p_ring->fd, IORING_OFF_SQ_RING );
+    if( p_ring->p_sq == MAP_FAILED )
+        goto error;
+    if( params.features & IORING_FEAT_SINGLE_MMAP )
+        p_ring->p_cq = p_ring->p_sq;
+    else
+    {
+        p_ring->p_cq = mmap( NULL, p_ring->i_cq, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, p_ring->fd,
+                          IORING_OFF_CQ_RING );
+        if( p_ring->p_cq == MAP_FAILED )
+            goto error;
+    }
+    p_ring->p_sqes = mmap( NULL, p_ring->i_sqes, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, p_ring->fd, IORING_OFF_SQES );
+    if( p_ring->p_sqes == MAP_FAILED )
+        goto error;
+
+    uint8_t *p_sq = p_ring->p_sq, *p_cq = p_ring->p_cq;
+    p_ring->pi_sq_head = (unsigned *)(p_sq + params.sq_off.head);
+    p_ring->pi_sq_tail = (unsigned *)(p_sq + params.sq_off.tail);
+    p_ring->pi_sq_array = (unsigned *)(p_sq + params.sq_off.array);
+    p_ring->i_sq_mask = *(unsigned *)(p_sq + params.sq_off.ring_mask);
+    p_ring->pi_cq_head = (unsigned *)(p_cq + params.cq_off.head);
+    p_ring->pi_cq_tail = (unsigned *)(p_cq + params.cq_off.tail);
+    p_ring->i_cq_mask = *(unsigned *)(p_cq + params.cq_off.ring_mask);
+    p_ring->p_cqes = (struct io_uring_cqe *)(p_cq + params.cq_off.cqes);
+
+    /* Keep one completion for the wake-up of the thread */
+    p_ring->i_max_inflight = params.cq_entries - 1;
+    p_ring->i_inflight = 0;
+    p_ring->b_exit = false;
+
+    p_ring->i_refs = 1;
+    if( vlc_clone( &p_ring->thread, RingThread, p_ring,
+                   VLC_THREAD_PRIORITY_INPUT ) )
+        goto error;
+    msg_Dbg( p_obj, "io_uring of %u entries", params.sq_entries );
+    return p_ring;
+
+error:
+    msg_Err( p_obj, "cannot set up io_uring: %m" );
+    if( p_ring->p_sqes != NULL && p_ring->p_sqes != MAP_FAILED )
+        munmap( p_ring->p_sqes, p_ring->i_sqes );
+    if( p_ring->p_cq != NULL && p_ring->p_cq != MAP_FAILED && p_ring->p_cq != p_ring->p_sq )
+        munmap( p_ring->p_cq, p_ring->i_cq );
+    if( p_ring->p_sq != NULL && p_ring->p_sq != MAP_FAILED )
+        munmap( p_ring->p_sq, p_ring->i_sq );
+    close( p_ring->fd );
+    free( p_ring );
+    return NULL;
+}
+
+/*****************************************************************************
+ * RingHold/RingRelease: shares the ring between the inputs
+ *****************************************************************************/
+static uring_t *RingHold( vlc_object_t *p_obj )
+{
+    uring_t *p_ring;
+
+    vlc_mutex_lock( &ring_lock );
+    p_ring = p_rings;
+    if( p_ring != NULL )
+        p_ring->i_refs++;
+    else
+        p_ring = p_rings = RingCreate( p_obj );
+    vlc_mutex_unlock( &ring_lock );
+    return p_ring;
+}
+
+static void RingRelease( uring_t *p_ring )
+{
+    vlc_mutex_lock( &ring_lock );
+    if( --p_ring->i_refs > 0 )
+    {
+        vlc_mutex_unlock( &ring_lock );
+        return;
+    }
+    p_rings = NULL;
+
+    /* Wake the thread up; it exits once all completions are reaped */
+    p_ring->b_exit = true;
+    p_ring->i_max_inflight++;
+    if( RingSubmit( p_ring, IORING_OP_NOP, -1, NULL ) )
+        abort(); /* the slot is reserved for this */
+    vlc_mutex_unlock( &ring_lock );
+
+    vlc_join( p_ring->thread, NULL );
+    munmap( p_ring->p_sqes, p_ring->i_sqes );
+    if( p_ring->p_cq != p_ring->p_sq )
+        munmap( p_ring->p_cq, p_ring->i_cq );
+    munmap( p_ring->p_sq, p_ring->i_sq );
+    close( p_ring->fd );
+    free( p_ring );
+}
+
+/*****************************************************************************
+ * Queue: keeps the reads ahead of the position in flight (ring lock held)
+ *****************************************************************************/
+static void Queue( access_t *p_access )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    for( unsigned i = 0; i < p_sys->i_depth; i++ )
+    {
+        uring_req_t *p_req =
+            &p_sys->p_req[(p_sys->i_head + i) % p_sys->i_depth];
+
+        if( p_req->i_state != REQ_IDLE )
+            continue;
+        if( p_access->info.i_size && p_sys->i_next >= p_access->info.i_size )
+            break;
+
+        p_req->i_offset = p_sys->i_next;
+        p_req->i_used = 0;
+        if( RingSubmit( p_sys->p_ring, IORING_OP_READV, p_sys->fd, p_req ) )
+            break; /* ring full: retry on the next read */
+        p_req->i_state = REQ_PENDING;
+        p_sys->i_next += p_sys->i_block;
+    }
+}
+
+/*****************************************************************************
+ * Flush: waits for and drops all the queued reads (ring lock held)
+ *****************************************************************************/
+static void Flush( access_t *p_access )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    for( unsigned i = 0; i < p_sys->i_depth; i++ )
+    {
+        uring_req_t *p_req = &p_sys->p_req[i];
+
+        while( p_req->i_state == REQ_PENDING )
+            vlc_cond_wait( &p_sys->wait, &ring_lock );
+        p_req->i_state = REQ_IDLE;
+    }
+    p_sys->i_head = 0;
+}
+
+/* Restarts the reads from a given offset (ring lock held) */
+static void Restart( access_t *p_access, uint64_t i_pos )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    Flush( p_access );
+    if( p_sys->b_direct )
+    {
+        p_sys->i_next = i_pos & ~(uint64_t)(DIRECT_ALIGN - 1);
+        p_sys->i_skip = i_pos - p_sys->i_next;
+    }
+    else
+    {
+        p_sys->i_next = i_pos;
+        p_sys->i_skip = 0;
+    }
+}
+
+/*****************************************************************************
+ * Open:
+ *****************************************************************************/
+static int Open( vlc_object_t *p_this )
+{
+    access_t *p_access = (access_t *)p_this;
+
+    if( strcmp( p_access->psz_access, "uring" )
+     && !var_InheritBool( p_access, "uring" ) )
+        return VLC_EGENERIC;
+    if( p_access->psz_filepath == NULL )
+        return VLC_EGENERIC;
+
+    bool b_direct = var_InheritBool( p_access, "uring-direct" );
+    int fd = vlc_open( p_access->psz_filepath,
+                       O_RDONLY | (b_direct ? O_DIRECT : 0) );
+    if( fd == -1 && b_direct && errno == EINVAL )
+    {
+        msg_Warn( p_access, "direct I/O not supported by the file system" );
+        b_direct = false;
+        fd = vlc_open( p_access->psz_filepath, O_RDONLY );
+    }
+    if( fd == -1 )
+    {
+        msg_Err( p_access, "cannot open file %s (%m)",
+                 p_access->psz_filepath );
+        return VLC_EGENERIC;
+    }
+
+    struct stat st;
+    if( fstat( fd, &st ) || !S_ISREG( st.st_mode ) )
+    {   /* Leave the rest to the file input */
+        close( fd );
+        return VLC_EGENERIC;
+    }
+
+    access_sys_t *p_sys = malloc( sizeof( *p_sys ) );
+    if( unlikely(p_sys == NULL) )
+    {
+        close( fd );
+        return VLC_ENOMEM;
+    }
+
+    size_t i_block = var_InheritInteger( p_access, "uring-block" ) * 1024;
+    i_block = (i_block + DIRECT_ALIGN - 1) & ~(size_t)(DIRECT_ALIGN - 1);
+    p_sys->fd = fd;
+    p_sys->b_direct = b_direct;
+    p_sys->i_block = i_block;
+    p_sys->i_depth = var_InheritInteger( p_access, "uring-depth" );
+    p_sys->i_head = 0;
+    p_sys->i_next = 0;
+    p_sys->i_skip = 0;
+    p_sys->p_buffer = vlc_memalign( DIRECT_ALIGN, i_block * p_sys->i_depth );
+    p_sys->p_req = calloc( p_sys->i_depth, sizeof( *p_sys->p_req ) );
+    if( unlikely(p_sys->p_buffer == NULL || p_sys->p_req == NULL) )
+        goto error;
+
+    for( unsigned i = 0; i < p_sys->i_depth; i++ )
+    {
+        uring_req_t *p_req = &p_sys->p_req[i];
+
+        p_req->p_sys = p_sys;
+        p_req->i_state = REQ_IDLE;
+        p_req->iov.iov_base = p_sys->p_buffer + i * i_block;
+        p_req->iov.iov_len = i_block;
+    }
+
+    p_sys->p_ring = RingHold( p_this );
+    if( p_sys->p_ring == NULL )
+        goto error;
+    vlc_cond_init( &p_sys->wait );
+
+    access_InitFields( p_access );
+    p_access->info.i_size = st.st_size;
+    p_access->pf_read = Read;
+    p_access->pf_block = NULL;
+    p_access->pf_control = Control;
+    p_access->pf_seek = Seek;
+    p_access->p_sys = p_sys;
+
+    vlc_mutex_lock( &ring_lock );
+    Queue( p_access );
+    vlc_mutex_unlock( &ring_lock );
+
+    msg_Dbg( p_access, "%u reads of %zu bytes in flight%s", p_sys->i_depth,
+             i_block, b_direct ? ", direct I/O" : "" );
+    return VLC_SUCCESS;
+
+error:
+    vlc_free( p_sys->p_buffer );
+    free( p_sys->p_req );
+    free( p_sys );
+    close( fd );
+    return VLC_EGENERIC;
+}
+
+/*****************************************************************************
+ * Close:
+ *****************************************************************************/
+static void Close( vlc_object_t *p_this )
+{
+    access_t *p_access = (access_t *)p_this;
+    access_sys_t *p_sys = p_access->p_sys;
+
+    vlc_mutex_lock( &ring_lock );
+    Flush( p_access );
+    vlc_mutex_unlock( &ring_lock );
+    RingRelease( p_sys->p_ring );
+
+    vlc_cond_destroy( &p_sys->wait );
+    vlc_free( p_sys->p_buffer );
+    free( p_sys->p_req );
+    close( p_sys->fd );
+    free( p_sys );
+}
+
+/*****************************************************************************
+ * Read:
+ *****************************************************************************/
+static ssize_t Read( access_t *p_access, uint8_t *p_buffer, size_t i_len )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    uring_req_t *p_req = &p_sys->p_req[p_sys->i_head];
+    ssize_t i_ret;
+
+    vlc_mutex_lock( &ring_lock );
+    Queue( p_access );
+    if( p_req->i_state == REQ_IDLE )
+    {
+        /* Nothing could be queued: end of file, or the ring is full */
+        if( p_access->info.i_size && p_sys->i_next >= p_access->info.i_size )
+        {
+            struct stat st;
+
+            /* The file may have grown */
+            if( fstat( p_sys->fd, &st ) == 0
+             && (uint64_t)st.st_size != p_access->info.i_size )
+            {
+                p_access->info.i_size = st.st_size;
+                p_access->info.i_update |= INPUT_UPDATE_SIZE;
+                Queue( p_access );
+            }
+        }
+        if( p_req->i_state == REQ_IDLE
+         && p_sys->i_next < p_access->info.i_size )
+        {
+            p_req->i_offset = p_sys->i_next;
+            p_req->i_used = 0;
+            p_req->i_res = pread( p_sys->fd, p_req->iov.iov_base,
+                                  p_req->iov.iov_len, p_req->i_offset );
+            if( p_req->i_res < 0 )
+                p_req->i_res = -errno;
+            p_req->i_state = REQ_DONE;
+            p_sys->i_next += p_sys->i_block;
+        }
+    }
+    while( p_req->i_state == REQ_PENDING )
+        vlc_cond_wait( &p_sys->wait, &ring_lock );
+
+    if( p_req->i_state == REQ_IDLE )
+    {
+        p_access->info.b_eof = true;
+        i_ret = 0;
+    }
+    else if( p_req->i_res < 0 )
+    {
+        errno = -p_req->i_res;
+        if( errno == EINTR || errno == EAGAIN )
+        {   /* Queue it again */
+            Restart( p_access, p_access->info.i_pos );
+            i_ret = -1;
+        }
+        else
+        {
+            msg_Err( p_access, "failed to read (%m)" );
+            p_access->info.b_eof = true;
+            i_ret = 0;
+        }
+    }
+    else
+    {
+        if( p_req->i_used < (int)p_sys->i_skip )
+            p_req->i_used = p_sys->i_skip;
+        p_sys->i_skip = 0;
+
+        i_ret = __MIN( (size_t)__MAX( p_req->i_res - p_req->i_used, 0 ),
+                       i_len );
+        memcpy( p_buffer, (uint8_t *)p_req->iov.iov_base + p_req->i_used,
+                i_ret );
+        p_req->i_used += i_ret;
+        p_access->info.i_pos += i_ret;
+
+        if( p_req->i_used >= p_req->i_res )
+        {
+            p_req->i_state = REQ_IDLE;
+            p_sys->i_head = (p_sys->i_head + 1) % p_sys->i_depth;
+
+            /* A short read means that the queued offsets are wrong */
+            if( (size_t)p_req->i_res < p_sys->i_block )
+            {
+                Restart( p_access, p_access->info.i_pos );
+                if( p_req->i_res == 0 )
+                    p_access->info.b_eof = true;
+            }
+        }
+        Queue( p_access );
+    }
+    vlc_mutex_unlock( &ring_lock );
+    return i_ret;
+}
+
+/*****************************************************************************
+ * Seek:
+ *****************************************************************************/
+static int Seek( access_t *p_access, uint64_t i_pos )
+{
+    vlc_mutex_lock( &ring_lock );
+    Restart( p_access, i_pos );
+    p_access->info.i_pos = i_pos;
+    p_access->info.b_eof = false;
+    Queue( p_access );
+    vlc_mutex_unlock( &ring_lock );
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Control:
+ *****************************************************************************/
+static int Control( access_t *p_access, int i_query, va_list args )
+{
+    bool    *pb_bool;
+    int64_t *pi_64;
+
+    switch( i_query )
+    {
+        case ACCESS_CAN_SEEK:
+        case ACCESS_CAN_FASTSEEK:
+        case ACCESS_CAN_PAUSE:
+        case ACCESS_CAN_CONTROL_PACE:
+            pb_bool = (bool*)va_arg( args, bool* );
+            *pb_bool = true;
+            break;
+
+        case ACCESS_GET_PTS_DELAY:
+            pi_64 = (int64_t*)va_arg( args, int64_t * );
+            *pi_64 = var_InheritInteger( p_access, "file-caching" ) * 1000;
+            break;
+
+        case ACCESS_SET_PAUSE_STATE:
+            /* Nothing to do */
+            break;
+
+        default:
+            return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
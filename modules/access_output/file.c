@@ -55,6 +55,8 @@
 #   define O_LARGEFILE 0
 #endif
 
+#include "writer.h"
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -81,6 +83,10 @@ vlc_module_begin ()
     add_bool( SOUT_CFG_PREFIX "sync", false, SYNC_TEXT,SYNC_LONGTEXT,
               false )
 #endif
+    add_bool( SOUT_CFG_PREFIX "async", false, WRITER_ASYNC_TEXT,
+              WRITER_ASYNC_LONGTEXT, true )
+    add_bool( SOUT_CFG_PREFIX "direct", false, WRITER_DIRECT_TEXT,
+              WRITER_DIRECT_LONGTEXT, true )
     set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -93,9 +99,17 @@ static const char *const ppsz_sout_options[] = {
 #ifdef O_SYNC
     "sync",
 #endif
+    "async",
+    "direct",
     NULL
 };
 
+struct sout_access_out_sys_t
+{
+    int           fd;
+    file_writer_t *p_writer;    /* NULL unless writing from a thread */
+};
+
 static ssize_t Write( sout_access_out_t *, block_t * );
 static int Seek ( sout_access_out_t *, off_t  );
 static ssize_t Read ( sout_access_out_t *, block_t * );
@@ -171,16 +185,34 @@ static int Open( vlc_object_t *p_this )
         }
     }
 
+    sout_access_out_sys_t *p_sys = malloc( sizeof( *p_sys ) );
+    if( !p_sys )
+    {
+        close( fd );
+        return VLC_ENOMEM;
+    }
+    p_sys->fd = fd;
+    p_sys->p_writer = NULL;
+
     p_access->pf_write = Write;
     p_access->pf_read  = Read;
     p_access->pf_seek  = Seek;
     p_access->pf_control = Control;
-    p_access->p_sys    = (void *)(intptr_t)fd;
+    p_access->p_sys    = p_sys;
 
     msg_Dbg( p_access, "file access output opened (%s)", p_access->psz_path );
     if (append)
         lseek (fd, 0, SEEK_END);
 
+    /* Pipes and devices are written directly */
+    if( var_GetBool( p_access, SOUT_CFG_PREFIX "async" ) )
+    {
+        p_sys->p_writer = file_writer_New( p_access, fd,
+                            var_GetBool( p_access, SOUT_CFG_PREFIX "direct" ) );
+        if( p_sys->p_writer )
+            msg_Dbg( p_access, "writing from a separate thread" );
+    }
+
     return VLC_SUCCESS;
 }
 
@@ -190,8 +222,12 @@ static int Open( vlc_object_t *p_this )
 static void Close( vlc_object_t * p_this )
 {
     sout_access_out_t *p_access = (sout_access_out_t*)p_this;
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
 
-    close( (intptr_t)p_access->p_sys );
+    if( p_sys->p_writer )
+        file_writer_Delete( p_sys->p_writer );
+    close( p_sys->fd );
+    free( p_sys );
 
     msg_Dbg( p_access, "file access output closed" );
 }
@@ -218,10 +254,14 @@ static int Control( sout_access_out_t *p_access, int i_query, va_list args )
  *****************************************************************************/
 static ssize_t Read( sout_access_out_t *p_access, block_t *p_buffer )
 {
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
     ssize_t val;
 
+    if( p_sys->p_writer )
+        file_writer_Flush( p_sys->p_writer );
+
     do
-        val = read( (intptr_t)p_access->p_sys, p_buffer->p_buffer,
+        val = read( p_sys->fd, p_buffer->p_buffer,
                     p_buffer->i_buffer );
     while (val == -1 && errno == EINTR);
     return val;
@@ -232,11 +272,31 @@ static ssize_t Read( sout_access_out_t *p_access, block_t *p_buffer )
  *****************************************************************************/
 static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
 {
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
     size_t i_write = 0;
 
+    if( p_sys->p_writer )
+    {
+        while( p_buffer )
+        {
+            block_t *p_next = p_buffer->p_next;
+
+            if( file_writer_Write( p_sys->p_writer, p_buffer->p_buffer,
+                                   p_buffer->i_buffer ) )
+            {
+                block_ChainRelease( p_buffer );
+                return -1;
+            }
+            i_write += p_buffer->i_buffer;
+            block_Release( p_buffer );
+            p_buffer = p_next;
+        }
+        return i_write;
+    }
+
     while( p_buffer )
     {
-        ssize_t val = write ((intptr_t)p_access->p_sys,
+        ssize_t val = write (p_sys->fd,
                              p_buffer->p_buffer, p_buffer->i_buffer);
         if (val == -1)
         {
@@ -267,5 +327,9 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
  *****************************************************************************/
 static int Seek( sout_access_out_t *p_access, off_t i_pos )
 {
-    return lseek( (intptr_t)p_access->p_sys, i_pos, SEEK_SET );
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    if( p_sys->p_writer )
+        file_writer_Flush( p_sys->p_writer );
+    return lseek( p_sys->fd, i_pos, SEEK_SET );
 }
@@ -68,6 +68,11 @@ static void Close( vlc_object_t * );
 #define MIME_TEXT N_("Mime")
 #define MIME_LONGTEXT N_("MIME returned by the server (autodetected " \
                         "if not specified)." )
+#define BURST_TEXT N_("Burst rate (kb/s)")
+#define BURST_LONGTEXT N_("New clients start at the latest key frame and get " \
+                          "what was sent since then at this rate, which " \
+                          "must exceed the stream bitrate. " \
+                          "0 sends it as fast as possible." )
 #define BONJOUR_TEXT N_( "Advertise with Bonjour")
 #define BONJOUR_LONGTEXT N_( "Advertise the stream with the Bonjour protocol." )
 
@@ -85,6 +90,9 @@ vlc_module_begin ()
                   PASS_TEXT, PASS_LONGTEXT, true )
     add_string( SOUT_CFG_PREFIX "mime", "",
                 MIME_TEXT, MIME_LONGTEXT, true )
+    add_integer( SOUT_CFG_PREFIX "burst", 0,
+                 BURST_TEXT, BURST_LONGTEXT, true )
+        change_integer_range( 0, 1000000 )
 #if 0 //def HAVE_AVAHI_CLIENT
     add_bool( SOUT_CFG_PREFIX "bonjour", false,
               BONJOUR_TEXT, BONJOUR_LONGTEXT, true);
@@ -97,7 +105,7 @@ vlc_module_end ()
  * Exported prototypes
  *****************************************************************************/
 static const char *const ppsz_sout_options[] = {
-    "user", "pwd", "mime", NULL
+    "user", "pwd", "mime", "burst", NULL
 };
 
 static ssize_t Write( sout_access_out_t *, block_t * );
@@ -225,6 +233,8 @@ static int Open( vlc_object_t *p_this )
         free( p_sys );
         return VLC_EGENERIC;
     }
+    httpd_StreamBurst( p_sys->p_httpd_stream,
+                       var_GetInteger( p_access, SOUT_CFG_PREFIX "burst" ) * 125 );
 
 #if 0 //def HAVE_AVAHI_CLIENT
     if( var_InheritBool(p_this, SOUT_CFG_PREFIX "bonjour") )
@@ -352,6 +362,9 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
                                 p_sys->i_header_size );
         }
 
+        if( p_buffer->i_flags & BLOCK_FLAG_TYPE_I )
+            httpd_StreamKeyFrame( p_sys->p_httpd_stream );
+
         i_len += p_buffer->i_buffer;
         /* send data */
         i_err = httpd_StreamSend( p_sys->p_httpd_stream, p_buffer->p_buffer,
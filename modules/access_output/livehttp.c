@@ -44,6 +44,7 @@
 #include <vlc_fs.h>
 #include <vlc_strings.h>
 #include <vlc_charset.h>
+#include <vlc_httpd.h>
 
 #ifndef O_LARGEFILE
 #   define O_LARGEFILE 0
@@ -82,6 +83,40 @@ static void Close( vlc_object_t * );
 
 #define RATECONTROL_TEXT N_("Use muxers rate control mechanism")
 
+#define HTTPD_TEXT N_("Serve from memory")
+#define HTTPD_LONGTEXT N_("Keep the index and the segments in memory and "\
+                        "serve them with the built-in HTTP server instead "\
+                        "of writing files. The index and segment paths are "\
+                        "then used as URL paths.")
+
+#define PARTLEN_TEXT N_("Part length (ms)")
+#define PARTLEN_LONGTEXT N_("Announce parts of this length of the segment "\
+                          "being written, so that clients can fetch it "\
+                          "before it is complete. 0 disables parts.")
+
+#define BLOCKRELOAD_TEXT N_("Blocking playlist reload")
+#define BLOCKRELOAD_LONGTEXT N_("Tell clients that the HTTP server holds "\
+                              "index requests until the asked part is "\
+                              "available. Only enable it if the server "\
+                              "really does so.")
+
+#define GROUP_TEXT N_("Variant group")
+#define GROUP_LONGTEXT N_("Outputs of the same group are the variants of "\
+                        "one stream: they are split at the same timestamps "\
+                        "and share the same segment numbers.")
+
+#define MASTER_TEXT N_("Master playlist")
+#define MASTER_LONGTEXT N_("Path to the master playlist listing the "\
+                         "variants of the group")
+
+#define BANDWIDTH_TEXT N_("Variant bandwidth")
+#define BANDWIDTH_LONGTEXT N_("Peak bit rate of this variant (bit/s), as "\
+                            "announced in the master playlist")
+
+#define VARIANTURL_TEXT N_("Variant URL")
+#define VARIANTURL_LONGTEXT N_("URL of the index of this variant in the "\
+                             "master playlist. Defaults to the index file name.")
+
 vlc_module_begin ()
     set_description( N_("HTTP Live streaming output") )
     set_shortname( N_("LiveHTTP" ))
@@ -101,6 +136,19 @@ vlc_module_begin ()
                 INDEX_TEXT, INDEX_LONGTEXT, true )
     add_string( SOUT_CFG_PREFIX "index-url", NULL,
                 INDEXURL_TEXT, INDEXURL_LONGTEXT, true )
+    add_bool( SOUT_CFG_PREFIX "httpd", false,
+              HTTPD_TEXT, HTTPD_LONGTEXT, true )
+    add_integer( SOUT_CFG_PREFIX "partlen", 0, PARTLEN_TEXT, PARTLEN_LONGTEXT, true )
+    add_bool( SOUT_CFG_PREFIX "blockreload", false,
+              BLOCKRELOAD_TEXT, BLOCKRELOAD_LONGTEXT, true )
+    add_string( SOUT_CFG_PREFIX "group", NULL,
+                GROUP_TEXT, GROUP_LONGTEXT, true )
+    add_string( SOUT_CFG_PREFIX "master", NULL,
+                MASTER_TEXT, MASTER_LONGTEXT, true )
+    add_integer( SOUT_CFG_PREFIX "bandwidth", 0,
+                 BANDWIDTH_TEXT, BANDWIDTH_LONGTEXT, true )
+    add_string( SOUT_CFG_PREFIX "variant-url", NULL,
+                VARIANTURL_TEXT, VARIANTURL_LONGTEXT, true )
     set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -116,6 +164,13 @@ static const char *const ppsz_sout_options[] = {
     "index",
     "index-url",
     "ratecontrol",
+    "partlen",
+    "blockreload",
+    "httpd",
+    "group",
+    "master",
+    "bandwidth",
+    "variant-url",
     NULL
 };
 
@@ -123,6 +178,63 @@ static ssize_t Write( sout_access_out_t *, block_t * );
 static int Seek ( sout_access_out_t *, off_t  );
 static int Control( sout_access_out_t *, int, va_list );
 
+/* A part is a byte range of a segment file */
+typedef struct
+{
+    uint64_t i_offset;
+    uint64_t i_length;
+    mtime_t  i_duration;
+    bool     b_independent;
+} livehttp_part_t;
+
+typedef struct
+{
+    livehttp_part_t *p_parts;
+    unsigned         i_parts;
+} livehttp_parts_t;
+
+/* Index being generated */
+typedef struct
+{
+    char   *psz_data;
+    size_t  i_data;
+} livehttp_index_t;
+
+/* Segment or index served by the built-in HTTP server */
+struct httpd_file_sys_t
+{
+    sout_access_out_sys_t *p_sys; /* set for the index only */
+    httpd_file_t *p_file;
+    block_t *p_data;
+    uint32_t i_segment;
+};
+
+/* Variants of a stream, split on the same timestamps */
+#define GROUP_CUTS 32
+
+typedef struct
+{
+    uint32_t i_segment;
+    mtime_t  i_dts;
+} livehttp_cut_t;
+
+typedef struct
+{
+    char *psz_name;
+    char *psz_master;
+    int i_members;
+    sout_access_out_sys_t **pp_members;
+    /* Start of the recent segments, whichever variant decided it */
+    livehttp_cut_t cuts[GROUP_CUTS];
+} livehttp_group_t;
+
+static vlc_mutex_t group_lock = VLC_STATIC_MUTEX;
+static int i_groups;
+static livehttp_group_t **pp_groups;
+
+static int groupJoin( sout_access_out_t *, sout_access_out_sys_t *, const char * );
+static void groupLeave( sout_access_out_t *, sout_access_out_sys_t * );
+
 struct sout_access_out_sys_t
 {
     char *psz_cursegPath;
@@ -137,6 +249,35 @@ struct sout_access_out_sys_t
     bool b_delsegs;
     bool b_ratecontrol;
     bool b_splitanywhere;
+
+    /* Parts of the segment being written, and of the previous one */
+    mtime_t i_partlen;
+    mtime_t i_partlenm;
+    mtime_t i_partdts;
+    mtime_t i_lastdts;
+    uint64_t i_segoffset;
+    uint64_t i_partoffset;
+    bool b_partindependent;
+    bool b_blockreload;
+    livehttp_parts_t curparts;
+    livehttp_parts_t prevparts;
+
+    /* Serving from memory */
+    bool b_segment;
+    httpd_host_t *p_httpd_host;
+    vlc_mutex_t lock; /* protects the served index */
+    livehttp_index_t index;
+    httpd_file_sys_t *p_httpd_index;
+    block_t *p_segdata;
+    block_t **pp_segdata_last;
+    int i_memsegs;
+    httpd_file_sys_t **pp_memsegs;
+
+    /* Variant group */
+    livehttp_group_t *p_group;
+    uint32_t i_initseg;
+    int64_t i_bandwidth;
+    char *psz_variantUrl;
 };
 
 /*****************************************************************************
@@ -168,6 +309,44 @@ static int Open( vlc_object_t *p_this )
     p_sys->b_delsegs = var_GetBool( p_access, SOUT_CFG_PREFIX "delsegs" );
     p_sys->b_ratecontrol = var_GetBool( p_access, SOUT_CFG_PREFIX "ratecontrol") ;
 
+    p_sys->i_partlen = var_GetInteger( p_access, SOUT_CFG_PREFIX "partlen" ) * 1000;
+    if ( p_sys->i_partlen < 0 || p_sys->i_partlen >= CLOCK_FREQ * (mtime_t)p_sys->i_seglen )
+        p_sys->i_partlen = 0;
+    /* Parts must not exceed the announced target, stay a bit under it */
+    p_sys->i_partlenm = p_sys->i_partlen * 0.9;
+    p_sys->b_blockreload = var_GetBool( p_access, SOUT_CFG_PREFIX "blockreload" );
+    p_sys->curparts.p_parts = p_sys->prevparts.p_parts = NULL;
+    p_sys->curparts.i_parts = p_sys->prevparts.i_parts = 0;
+    p_sys->i_segoffset = p_sys->i_partoffset = 0;
+    p_sys->i_partdts = p_sys->i_lastdts = 0;
+
+    p_sys->b_segment = false;
+    p_sys->p_httpd_host = NULL;
+    p_sys->index.psz_data = NULL;
+    p_sys->index.i_data = 0;
+    p_sys->p_httpd_index = NULL;
+    p_sys->p_segdata = NULL;
+    p_sys->pp_segdata_last = &p_sys->p_segdata;
+    TAB_INIT( p_sys->i_memsegs, p_sys->pp_memsegs );
+    vlc_mutex_init( &p_sys->lock );
+    if ( var_GetBool( p_access, SOUT_CFG_PREFIX "httpd" ) )
+    {
+        p_sys->p_httpd_host = vlc_http_HostNew( VLC_OBJECT(p_access) );
+        if ( !p_sys->p_httpd_host )
+        {
+            msg_Err( p_access, "cannot start HTTP server" );
+            vlc_mutex_destroy( &p_sys->lock );
+            free( p_sys );
+            return VLC_EGENERIC;
+        }
+        /* The server cannot answer byte range requests */
+        if ( p_sys->i_partlen > 0 )
+        {
+            msg_Warn( p_access, "parts are not available when serving from memory" );
+            p_sys->i_partlen = 0;
+        }
+    }
+
     p_sys->psz_indexPath = NULL;
     psz_idx = var_GetNonEmptyString( p_access, SOUT_CFG_PREFIX "index" );
     if ( psz_idx )
@@ -177,12 +356,16 @@ static int Open( vlc_object_t *p_this )
         free( psz_idx );
         if ( !psz_tmp )
         {
+            if ( p_sys->p_httpd_host )
+                httpd_HostDelete( p_sys->p_httpd_host );
+            vlc_mutex_destroy( &p_sys->lock );
             free( p_sys );
             return VLC_ENOMEM;
         }
         path_sanitize( psz_tmp );
         p_sys->psz_indexPath = psz_tmp;
-        vlc_unlink( p_sys->psz_indexPath );
+        if ( !p_sys->p_httpd_host )
+            vlc_unlink( p_sys->psz_indexPath );
     }
 
     p_sys->psz_indexUrl = var_GetNonEmptyString( p_access, SOUT_CFG_PREFIX "index-url" );
@@ -190,8 +373,36 @@ static int Open( vlc_object_t *p_this )
     p_access->p_sys = p_sys;
     p_sys->i_handle = -1;
     p_sys->i_segment = 0;
+    p_sys->i_initseg = 1;
     p_sys->psz_cursegPath = NULL;
 
+    p_sys->p_group = NULL;
+    p_sys->i_bandwidth = var_GetInteger( p_access, SOUT_CFG_PREFIX "bandwidth" );
+    p_sys->psz_variantUrl = var_GetNonEmptyString( p_access, SOUT_CFG_PREFIX "variant-url" );
+    if ( !p_sys->psz_variantUrl && p_sys->psz_indexPath )
+    {
+        const char *psz_file = strrchr( p_sys->psz_indexPath, '/' );
+        p_sys->psz_variantUrl = strdup( psz_file ? psz_file + 1 : p_sys->psz_indexPath );
+    }
+
+    char *psz_group = var_GetNonEmptyString( p_access, SOUT_CFG_PREFIX "group" );
+    if ( psz_group )
+    {
+        int i_ret = groupJoin( p_access, p_sys, psz_group );
+        free( psz_group );
+        if ( i_ret != VLC_SUCCESS )
+        {
+            if ( p_sys->p_httpd_host )
+                httpd_HostDelete( p_sys->p_httpd_host );
+            vlc_mutex_destroy( &p_sys->lock );
+            free( p_sys->psz_variantUrl );
+            free( p_sys->psz_indexUrl );
+            free( p_sys->psz_indexPath );
+            free( p_sys );
+            return i_ret;
+        }
+    }
+
     p_access->pf_write = Write;
     p_access->pf_seek  = Seek;
     p_access->pf_control = Control;
@@ -231,90 +442,292 @@ static char *formatSegmentPath( sout_access_out_t *p_access, char *psz_path, uin
     return psz_result;
 }
 
+/* Playlists need a dot as decimal separator whatever the locale */
+#define DURATION_FMT "%"PRId64".%03"PRId64
+#define DURATION_ARGS( d ) (int64_t)(d) / CLOCK_FREQ, ((int64_t)(d) % CLOCK_FREQ) / 1000
+
 /************************************************************************
- * updateIndexAndDel: If necessary, update index file & delete old segments
+ * indexPrintf: append to the index being generated
  ************************************************************************/
-static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys, bool b_isend )
+static int indexPrintf( livehttp_index_t *p_index, const char *psz_fmt, ... ) VLC_FORMAT( 2, 3 );
+static int indexPrintf( livehttp_index_t *p_index, const char *psz_fmt, ... )
 {
+    va_list args;
+    char *psz_line, *psz_new;
+    int i_line;
+
+    va_start( args, psz_fmt );
+    i_line = vasprintf( &psz_line, psz_fmt, args );
+    va_end( args );
+    if ( i_line < 0 )
+        return -1;
 
-    uint32_t i_firstseg;
-
-    if ( p_sys->i_numsegs == 0 || p_sys->i_segment < p_sys->i_numsegs )
-        i_firstseg = 1;
-    else
-        i_firstseg = ( p_sys->i_segment - p_sys->i_numsegs ) + 1;
+    psz_new = realloc( p_index->psz_data, p_index->i_data + i_line + 1 );
+    if ( !psz_new )
+    {
+        free( psz_line );
+        return -1;
+    }
+    memcpy( psz_new + p_index->i_data, psz_line, i_line + 1 );
+    p_index->psz_data = psz_new;
+    p_index->i_data += i_line;
+    free( psz_line );
+    return i_line;
+}
 
-    // First update index
-    if ( p_sys->psz_indexPath )
+/************************************************************************
+ * writeParts: list the parts of a segment in the index
+ ************************************************************************/
+static int writeParts( livehttp_index_t *p_index, const livehttp_parts_t *p_parts, const char *psz_name )
+{
+    for ( unsigned i = 0; i < p_parts->i_parts; i++ )
     {
-        int val;
-        FILE *fp;
-        char *psz_idxTmp;
-        if ( asprintf( &psz_idxTmp, "%s.tmp", p_sys->psz_indexPath ) < 0)
+        const livehttp_part_t *p_part = &p_parts->p_parts[i];
+        if ( indexPrintf( p_index, "#EXT-X-PART:DURATION="DURATION_FMT",URI=\"%s\","
+                          "BYTERANGE=\"%"PRIu64"@%"PRIu64"\"%s\n",
+                      DURATION_ARGS( p_part->i_duration ), psz_name,
+                      p_part->i_length, p_part->i_offset,
+                      p_part->b_independent ? ",INDEPENDENT=YES" : "" ) < 0 )
             return -1;
+    }
+    return 0;
+}
 
-        fp = vlc_fopen( psz_idxTmp, "wt");
-        if ( !fp )
-        {
-            msg_Err( p_access, "cannot open index file `%s'", psz_idxTmp );
-            free( psz_idxTmp );
-            return -1;
-        }
+/************************************************************************
+ * httpdFill: answer a request for the index or a segment
+ ************************************************************************/
+static int httpdFill( httpd_file_sys_t *p_file_sys, httpd_file_t *p_file,
+                      uint8_t *psz_request, uint8_t **pp_data, int *pi_data )
+{
+    VLC_UNUSED( p_file ); VLC_UNUSED( psz_request );
+    sout_access_out_sys_t *p_sys = p_file_sys->p_sys;
 
-        if ( fprintf( fp, "#EXTM3U\n#EXT-X-TARGETDURATION:%zu\n#EXT-X-MEDIA-SEQUENCE:%"PRIu32"\n", p_sys->i_seglen, i_firstseg ) < 0 )
-        {
-            free( psz_idxTmp );
-            fclose( fp );
-            return -1;
-        }
+    *pp_data = NULL;
+    *pi_data = 0;
 
-        char *psz_idxFormat = p_sys->psz_indexUrl ? p_sys->psz_indexUrl : p_access->psz_path;
-        for ( uint32_t i = i_firstseg; i <= p_sys->i_segment; i++ )
-        {
-            char *psz_name;
-            if ( ! ( psz_name = formatSegmentPath( p_access, psz_idxFormat, i, false ) ) )
-            {
-                free( psz_idxTmp );
-                fclose( fp );
-                return -1;
-            }
-            val = fprintf( fp, "#EXTINF:%zu,\n%s\n", p_sys->i_seglen, psz_name );
-            free( psz_name );
-            if ( val < 0 )
-            {
-                free( psz_idxTmp );
-                fclose( fp );
-                return -1;
-            }
-        }
+    /* Segments never change once published, only the index needs locking */
+    if ( p_sys )
+        vlc_mutex_lock( &p_sys->lock );
 
-        if ( b_isend )
-        {
-            if ( fputs ( STR_ENDLIST, fp ) < 0)
-            {
-                free( psz_idxTmp );
-                fclose( fp ) ;
-                return -1;
-            }
+    const void *p_src = p_sys ? (const void *)p_sys->index.psz_data
+                              : (const void *)p_file_sys->p_data->p_buffer;
+    size_t i_src = p_sys ? p_sys->index.i_data : p_file_sys->p_data->i_buffer;
 
-        }
-        fclose( fp );
+    if ( i_src > 0 && ( *pp_data = malloc( i_src ) ) != NULL )
+    {
+        memcpy( *pp_data, p_src, i_src );
+        *pi_data = i_src;
+    }
 
-        val = vlc_rename ( psz_idxTmp, p_sys->psz_indexPath);
+    if ( p_sys )
+        vlc_mutex_unlock( &p_sys->lock );
+    return VLC_SUCCESS;
+}
 
-        if ( val < 0 )
+/************************************************************************
+ * httpdNew: publish data on the built-in HTTP server
+ ************************************************************************/
+static httpd_file_sys_t *httpdNew( sout_access_out_t *p_access, const char *psz_path,
+                                   const char *psz_mime, sout_access_out_sys_t *p_sys,
+                                   block_t *p_data )
+{
+    httpd_file_sys_t *p_file_sys = malloc( sizeof( *p_file_sys ) );
+    char *psz_url;
+
+    if ( !p_file_sys )
+        return NULL;
+    if ( asprintf( &psz_url, "%s%s", *psz_path == '/' ? "" : "/", psz_path ) < 0 )
+    {
+        free( p_file_sys );
+        return NULL;
+    }
+
+    p_file_sys->p_sys = p_sys;
+    p_file_sys->p_data = p_data;
+    p_file_sys->p_file = httpd_FileNew( p_access->p_sys->p_httpd_host, psz_url, psz_mime,
+                                        NULL, NULL, NULL, httpdFill, p_file_sys );
+    if ( !p_file_sys->p_file )
+    {
+        msg_Err( p_access, "cannot serve `%s'", psz_url );
+        free( psz_url );
+        free( p_file_sys );
+        return NULL;
+    }
+    free( psz_url );
+    return p_file_sys;
+}
+
+static void httpdDelete( httpd_file_sys_t *p_file_sys )
+{
+    httpd_FileDelete( p_file_sys->p_file );
+    if ( p_file_sys->p_data )
+        block_Release( p_file_sys->p_data );
+    free( p_file_sys );
+}
+
+/************************************************************************
+ * writeIndexFile: atomically replace a playlist file
+ ************************************************************************/
+static int writeIndexFile( sout_access_out_t *p_access, const char *psz_path,
+                           const livehttp_index_t *p_index )
+{
+    FILE *fp;
+    char *psz_idxTmp;
+    int val;
+
+    if ( asprintf( &psz_idxTmp, "%s.tmp", psz_path ) < 0)
+        return -1;
+
+    fp = vlc_fopen( psz_idxTmp, "wt");
+    if ( !fp )
+    {
+        msg_Err( p_access, "cannot open index file `%s'", psz_idxTmp );
+        free( psz_idxTmp );
+        return -1;
+    }
+
+    val = fwrite( p_index->psz_data, 1, p_index->i_data, fp ) == p_index->i_data ? 0 : -1;
+    if ( fclose( fp ) || val < 0 )
+    {
+        vlc_unlink( psz_idxTmp );
+        free( psz_idxTmp );
+        return -1;
+    }
+
+    val = vlc_rename ( psz_idxTmp, psz_path );
+
+    if ( val < 0 )
+    {
+        vlc_unlink( psz_idxTmp );
+        msg_Err( p_access, "Error moving LiveHttp index file" );
+    }
+
+    free( psz_idxTmp );
+    return val < 0 ? -1 : 0;
+}
+
+/************************************************************************
+ * updateIndex: rewrite the index file
+ ************************************************************************/
+static int updateIndex( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys, uint32_t i_firstseg, bool b_isend )
+{
+    int val;
+    livehttp_index_t index = { NULL, 0 };
+    /* While a segment is being written only its parts can be listed */
+    bool b_current = p_sys->b_segment;
+    uint32_t i_lastseg = b_current ? p_sys->i_segment - 1 : p_sys->i_segment;
+
+    if ( p_sys->i_partlen > 0 )
+        val = indexPrintf( &index, "#EXTM3U\n#EXT-X-VERSION:6\n#EXT-X-TARGETDURATION:%zu\n"
+                           "#EXT-X-SERVER-CONTROL:%sPART-HOLD-BACK="DURATION_FMT"\n"
+                           "#EXT-X-PART-INF:PART-TARGET="DURATION_FMT"\n"
+                           "#EXT-X-MEDIA-SEQUENCE:%"PRIu32"\n",
+                       p_sys->i_seglen,
+                       p_sys->b_blockreload ? "CAN-BLOCK-RELOAD=YES," : "",
+                       DURATION_ARGS( 3 * p_sys->i_partlen ),
+                       DURATION_ARGS( p_sys->i_partlen ), i_firstseg );
+    else
+        val = indexPrintf( &index, "#EXTM3U\n#EXT-X-TARGETDURATION:%zu\n#EXT-X-MEDIA-SEQUENCE:%"PRIu32"\n", p_sys->i_seglen, i_firstseg );
+    if ( val < 0 )
+        goto error;
+
+    char *psz_idxFormat = p_sys->psz_indexUrl ? p_sys->psz_indexUrl : p_access->psz_path;
+    for ( uint32_t i = i_firstseg; i <= i_lastseg + b_current; i++ )
+    {
+        char *psz_name;
+        if ( ! ( psz_name = formatSegmentPath( p_access, psz_idxFormat, i, false ) ) )
+            goto error;
+
+        if ( i > i_lastseg )
         {
-            vlc_unlink( psz_idxTmp );
-            msg_Err( p_access, "Error moving LiveHttp index file" );
+            val = writeParts( &index, &p_sys->curparts, psz_name );
+            if ( val >= 0 )
+                val = indexPrintf( &index, "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"%s\",BYTERANGE-START=%"PRIu64"\n",
+                                   psz_name, p_sys->i_partoffset );
         }
         else
-            msg_Info( p_access, "LiveHttpIndexComplete: %s" , p_sys->psz_indexPath );
+        {
+            /* Parts stay listed for the last complete segment, for clients
+             * which have not caught up with it yet */
+            val = 0;
+            if ( i == i_lastseg )
+                val = writeParts( &index, &p_sys->prevparts, psz_name );
+            if ( val >= 0 )
+                val = indexPrintf( &index, "#EXTINF:%zu,\n%s\n", p_sys->i_seglen, psz_name );
+        }
+        free( psz_name );
+        if ( val < 0 )
+            goto error;
+    }
 
-        free( psz_idxTmp );
+    if ( b_isend )
+    {
+        if ( indexPrintf( &index, "%s", STR_ENDLIST ) < 0)
+            goto error;
+    }
+
+    if ( p_sys->p_httpd_host )
+    {
+        vlc_mutex_lock( &p_sys->lock );
+        free( p_sys->index.psz_data );
+        p_sys->index = index;
+        vlc_mutex_unlock( &p_sys->lock );
+
+        if ( !p_sys->p_httpd_index )
+            p_sys->p_httpd_index = httpdNew( p_access, p_sys->psz_indexPath,
+                                             "application/vnd.apple.mpegurl",
+                                             p_sys, NULL );
+        return p_sys->p_httpd_index ? 0 : -1;
     }
 
+    val = writeIndexFile( p_access, p_sys->psz_indexPath, &index );
+    free( index.psz_data );
+    if ( val == 0 && !b_current )
+        msg_Info( p_access, "LiveHttpIndexComplete: %s" , p_sys->psz_indexPath );
+    return val;
+
+error:
+    free( index.psz_data );
+    return -1;
+}
+
+/************************************************************************
+ * getFirstSegment: first segment listed in the index
+ ************************************************************************/
+static uint32_t getFirstSegment( sout_access_out_sys_t *p_sys )
+{
+    if ( p_sys->i_numsegs == 0 || p_sys->i_segment < p_sys->i_initseg + p_sys->i_numsegs )
+        return p_sys->i_initseg;
+    return ( p_sys->i_segment - p_sys->i_numsegs ) + 1;
+}
+
+/************************************************************************
+ * updateIndexAndDel: If necessary, update index file & delete old segments
+ ************************************************************************/
+static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys, bool b_isend )
+{
+
+    uint32_t i_firstseg = getFirstSegment( p_sys );
+
+    // First update index
+    if ( p_sys->psz_indexPath && updateIndex( p_access, p_sys, i_firstseg, b_isend ) < 0 )
+        return -1;
+
     // Then take care of deletion
-    if ( p_sys->b_delsegs && i_firstseg > 1 )
+    if ( p_sys->b_delsegs && i_firstseg > p_sys->i_initseg && p_sys->p_httpd_host )
+    {
+        for ( int i = 0; i < p_sys->i_memsegs; i++ )
+        {
+            httpd_file_sys_t *p_seg = p_sys->pp_memsegs[i];
+            if ( p_seg->i_segment == i_firstseg - 1 )
+            {
+                TAB_REMOVE( p_sys->i_memsegs, p_sys->pp_memsegs, p_seg );
+                httpdDelete( p_seg );
+                break;
+            }
+        }
+    }
+    else if ( p_sys->b_delsegs && i_firstseg > p_sys->i_initseg )
     {
         char *psz_name = formatSegmentPath( p_access, p_access->psz_path, i_firstseg-1, true );
          if ( psz_name )
@@ -326,25 +739,233 @@ static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t
     return 0;
 }
 
+/*****************************************************************************
+ * closeCurrentPart: record the part written so far
+ *****************************************************************************/
+static void closeCurrentPart( sout_access_out_sys_t *p_sys, mtime_t i_dts )
+{
+    livehttp_parts_t *p_parts = &p_sys->curparts;
+
+    if ( p_sys->i_partlen == 0 || p_sys->i_segoffset == p_sys->i_partoffset )
+        return;
+
+    livehttp_part_t *p_new = realloc( p_parts->p_parts,
+                                      ( p_parts->i_parts + 1 ) * sizeof( *p_new ) );
+    if ( unlikely( !p_new ) )
+        return;
+    p_parts->p_parts = p_new;
+    p_new += p_parts->i_parts++;
+
+    p_new->i_offset = p_sys->i_partoffset;
+    p_new->i_length = p_sys->i_segoffset - p_sys->i_partoffset;
+    p_new->i_duration = i_dts - p_sys->i_partdts;
+    p_new->b_independent = p_sys->b_partindependent;
+
+    p_sys->i_partoffset = p_sys->i_segoffset;
+    p_sys->i_partdts = i_dts;
+}
+
 /*****************************************************************************
  * closeCurrentSegment: Close the segment file
  *****************************************************************************/
 static void closeCurrentSegment( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys, bool b_isend )
 {
-    if ( p_sys->i_handle >= 0 )
+    if ( p_sys->b_segment )
     {
-        close( p_sys->i_handle );
-        p_sys->i_handle = -1;
+        p_sys->b_segment = false;
+        if ( p_sys->i_handle >= 0 )
+        {
+            close( p_sys->i_handle );
+            p_sys->i_handle = -1;
+        }
+        else if ( p_sys->psz_cursegPath )
+        {
+            /* Publish the segment now that it is complete */
+            block_t *p_data = block_ChainGather( p_sys->p_segdata );
+            httpd_file_sys_t *p_seg = NULL;
+
+            p_sys->p_segdata = NULL;
+            p_sys->pp_segdata_last = &p_sys->p_segdata;
+            if ( p_data )
+                p_seg = httpdNew( p_access, p_sys->psz_cursegPath, "video/MP2T", NULL, p_data );
+            if ( p_seg )
+            {
+                p_seg->i_segment = p_sys->i_segment;
+                TAB_APPEND( p_sys->i_memsegs, p_sys->pp_memsegs, p_seg );
+            }
+            else if ( p_data )
+                block_Release( p_data );
+        }
         if ( p_sys->psz_cursegPath )
         {
             msg_Info( p_access, "LiveHttpSegmentComplete: %s (%"PRIu32")" , p_sys->psz_cursegPath, p_sys->i_segment );
             free( p_sys->psz_cursegPath );
             p_sys->psz_cursegPath = 0;
+
+            free( p_sys->prevparts.p_parts );
+            p_sys->prevparts = p_sys->curparts;
+            p_sys->curparts.p_parts = NULL;
+            p_sys->curparts.i_parts = 0;
+
             updateIndexAndDel( p_access, p_sys, b_isend );
         }
     }
 }
 
+/*****************************************************************************
+ * groupWriteMaster: list the variants of the group, group_lock held
+ *****************************************************************************/
+static void groupWriteMaster( sout_access_out_t *p_access, livehttp_group_t *p_group )
+{
+    livehttp_index_t master = { NULL, 0 };
+    int val;
+
+    if ( !p_group->psz_master )
+        return;
+
+    val = indexPrintf( &master, "#EXTM3U\n" );
+    for ( int i = 0; i < p_group->i_members && val >= 0; i++ )
+    {
+        const sout_access_out_sys_t *p_member = p_group->pp_members[i];
+        if ( p_member->psz_variantUrl )
+            val = indexPrintf( &master, "#EXT-X-STREAM-INF:BANDWIDTH=%"PRId64"\n%s\n",
+                               p_member->i_bandwidth, p_member->psz_variantUrl );
+    }
+
+    if ( val >= 0 && writeIndexFile( p_access, p_group->psz_master, &master ) == 0 )
+        msg_Dbg( p_access, "master playlist %s updated", p_group->psz_master );
+    free( master.psz_data );
+}
+
+/*****************************************************************************
+ * groupJoin: become a variant of the named group
+ *****************************************************************************/
+static int groupJoin( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys, const char *psz_name )
+{
+    livehttp_group_t *p_group = NULL;
+    char *psz_master = var_GetNonEmptyString( p_access, SOUT_CFG_PREFIX "master" );
+
+    if ( psz_master && p_sys->i_bandwidth <= 0 )
+        msg_Warn( p_access, "no bandwidth given for the master playlist" );
+
+    vlc_mutex_lock( &group_lock );
+    for ( int i = 0; i < i_groups; i++ )
+    {
+        if ( !strcmp( pp_groups[i]->psz_name, psz_name ) )
+        {
+            p_group = pp_groups[i];
+            break;
+        }
+    }
+
+    if ( !p_group )
+    {
+        p_group = calloc( 1, sizeof( *p_group ) );
+        if ( !p_group || !( p_group->psz_name = strdup( psz_name ) ) )
+        {
+            vlc_mutex_unlock( &group_lock );
+            free( p_group );
+            free( psz_master );
+            return VLC_ENOMEM;
+        }
+        TAB_INIT( p_group->i_members, p_group->pp_members );
+        TAB_APPEND( i_groups, pp_groups, p_group );
+    }
+
+    if ( psz_master && !p_group->psz_master )
+    {
+        p_group->psz_master = psz_master;
+        psz_master = NULL;
+    }
+    else if ( psz_master && strcmp( psz_master, p_group->psz_master ) )
+        msg_Warn( p_access, "group %s already writes its master playlist to %s",
+                  psz_name, p_group->psz_master );
+
+    TAB_APPEND( p_group->i_members, p_group->pp_members, p_sys );
+    p_sys->p_group = p_group;
+    groupWriteMaster( p_access, p_group );
+    vlc_mutex_unlock( &group_lock );
+
+    msg_Dbg( p_access, "variant %d of group %s", p_group->i_members, psz_name );
+    free( psz_master );
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * groupLeave: remove the variant, and the group with the last one
+ *****************************************************************************/
+static void groupLeave( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys )
+{
+    livehttp_group_t *p_group = p_sys->p_group;
+
+    vlc_mutex_lock( &group_lock );
+    TAB_REMOVE( p_group->i_members, p_group->pp_members, p_sys );
+    if ( p_group->i_members > 0 )
+        groupWriteMaster( p_access, p_group );
+    else
+    {
+        TAB_REMOVE( i_groups, pp_groups, p_group );
+        free( p_group->psz_master );
+        free( p_group->psz_name );
+        free( p_group );
+    }
+    vlc_mutex_unlock( &group_lock );
+    p_sys->p_group = NULL;
+}
+
+/*****************************************************************************
+ * groupFirstSegment: number the first segment like the other variants
+ *****************************************************************************/
+static void groupFirstSegment( sout_access_out_sys_t *p_sys, mtime_t i_dts )
+{
+    const livehttp_cut_t *p_found = NULL;
+
+    vlc_mutex_lock( &group_lock );
+    for ( int i = 0; i < GROUP_CUTS; i++ )
+    {
+        const livehttp_cut_t *p_cut = &p_sys->p_group->cuts[i];
+        if ( p_cut->i_segment > 0 && p_cut->i_dts <= i_dts &&
+             ( !p_found || p_cut->i_segment > p_found->i_segment ) )
+            p_found = p_cut;
+    }
+    if ( p_found )
+    {
+        p_sys->i_initseg = p_found->i_segment;
+        p_sys->i_segment = p_found->i_segment - 1;
+    }
+    vlc_mutex_unlock( &group_lock );
+}
+
+/*****************************************************************************
+ * shouldSplit: whether the segment being written ends before i_dts
+ *****************************************************************************/
+static bool shouldSplit( sout_access_out_sys_t *p_sys, mtime_t i_dts )
+{
+    livehttp_cut_t *p_cut;
+    bool b_split;
+
+    if ( !p_sys->p_group )
+        return ( i_dts - p_sys->i_opendts ) > p_sys->i_seglenm;
+
+    vlc_mutex_lock( &group_lock );
+    p_cut = &p_sys->p_group->cuts[( p_sys->i_segment + 1 ) % GROUP_CUTS];
+    if ( p_cut->i_segment == p_sys->i_segment + 1 )
+    {
+        /* Another variant already started the next segment */
+        b_split = i_dts >= p_cut->i_dts;
+    }
+    else if ( ( i_dts - p_sys->i_opendts ) > p_sys->i_seglenm )
+    {
+        p_cut->i_segment = p_sys->i_segment + 1;
+        p_cut->i_dts = i_dts;
+        b_split = true;
+    }
+    else
+        b_split = false;
+    vlc_mutex_unlock( &group_lock );
+    return b_split;
+}
+
 /*****************************************************************************
  * Close: close the target
  *****************************************************************************/
@@ -354,7 +975,27 @@ static void Close( vlc_object_t * p_this )
     sout_access_out_sys_t *p_sys = p_access->p_sys;
 
 
+    closeCurrentPart( p_sys, p_sys->i_lastdts );
     closeCurrentSegment( p_access, p_sys, true );
+    free( p_sys->curparts.p_parts );
+    free( p_sys->prevparts.p_parts );
+
+    if ( p_sys->p_group )
+        groupLeave( p_access, p_sys );
+    free( p_sys->psz_variantUrl );
+
+    if ( p_sys->p_httpd_host )
+    {
+        for ( int i = 0; i < p_sys->i_memsegs; i++ )
+            httpdDelete( p_sys->pp_memsegs[i] );
+        TAB_CLEAN( p_sys->i_memsegs, p_sys->pp_memsegs );
+        if ( p_sys->p_httpd_index )
+            httpdDelete( p_sys->p_httpd_index );
+        httpd_HostDelete( p_sys->p_httpd_host );
+    }
+    free( p_sys->index.psz_data );
+    vlc_mutex_destroy( &p_sys->lock );
+
     free( p_sys->psz_indexUrl );
     free( p_sys->psz_indexPath );
     free( p_sys );
@@ -395,6 +1036,15 @@ static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t
     if ( !psz_seg )
         return -1;
 
+    if ( p_sys->p_httpd_host )
+    {
+        msg_Dbg( p_access, "Started livehttp segment: %s (%"PRIu32")" , psz_seg, i_newseg );
+        p_sys->psz_cursegPath = psz_seg;
+        p_sys->i_segment = i_newseg;
+        p_sys->b_segment = true;
+        return 0;
+    }
+
     fd = vlc_open( psz_seg, O_WRONLY | O_CREAT | O_LARGEFILE |
                      O_TRUNC, 0666 );
     if ( fd == -1 )
@@ -410,6 +1060,7 @@ static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t
     p_sys->psz_cursegPath = psz_seg;
     p_sys->i_handle = fd;
     p_sys->i_segment = i_newseg;
+    p_sys->b_segment = true;
     return fd;
 }
 
@@ -423,16 +1074,46 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
 
     while( p_buffer )
     {
-        if ( p_sys->i_handle >= 0 && ( p_sys->b_splitanywhere || ( p_buffer->i_flags & BLOCK_FLAG_TYPE_I ) ) && ( p_buffer->i_dts-p_sys->i_opendts ) > p_sys->i_seglenm )
+        if ( p_sys->b_segment && ( p_sys->b_splitanywhere || ( p_buffer->i_flags & BLOCK_FLAG_TYPE_I ) ) && shouldSplit( p_sys, p_buffer->i_dts ) )
         {
+            closeCurrentPart( p_sys, p_buffer->i_dts );
             closeCurrentSegment( p_access, p_sys, false );
         }
-        if ( p_buffer->i_buffer > 0 && p_sys->i_handle < 0 )
+        else if ( p_sys->i_partlen > 0 && p_sys->b_segment &&
+                  ( p_buffer->i_dts - p_sys->i_partdts ) > p_sys->i_partlenm )
+        {
+            closeCurrentPart( p_sys, p_buffer->i_dts );
+            if ( p_sys->psz_indexPath )
+                updateIndex( p_access, p_sys, getFirstSegment( p_sys ), false );
+        }
+        if ( p_buffer->i_buffer > 0 && !p_sys->b_segment )
         {
             p_sys->i_opendts = p_buffer->i_dts;
+            if ( p_sys->p_group && p_sys->i_segment == 0 )
+                groupFirstSegment( p_sys, p_buffer->i_dts );
             if ( openNextFile( p_access, p_sys ) < 0 )
                 return -1;
+            p_sys->i_partdts = p_buffer->i_dts;
+            p_sys->i_segoffset = p_sys->i_partoffset = 0;
         }
+        if ( p_sys->i_segoffset == p_sys->i_partoffset )
+            p_sys->b_partindependent = ( p_buffer->i_flags & BLOCK_FLAG_TYPE_I ) != 0;
+
+        if ( p_sys->p_httpd_host )
+        {
+            /* Keep the block itself, no copy */
+            block_t *p_next = p_buffer->p_next;
+            size_t i_buffer = p_buffer->i_buffer;
+
+            p_buffer->p_next = NULL;
+            p_sys->i_segoffset += i_buffer;
+            p_sys->i_lastdts = p_buffer->i_dts;
+            block_ChainLastAppend( &p_sys->pp_segdata_last, p_buffer );
+            i_write += i_buffer;
+            p_buffer = p_next;
+            continue;
+        }
+
         ssize_t val = write ( p_sys->i_handle,
                              p_buffer->p_buffer, p_buffer->i_buffer );
         if ( val == -1 )
@@ -443,6 +1124,9 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
             return -1;
         }
 
+        p_sys->i_segoffset += val;
+        p_sys->i_lastdts = p_buffer->i_dts;
+
         if ( (size_t)val >= p_buffer->i_buffer )
         {
             block_t *p_next = p_buffer->p_next;
@@ -73,6 +73,13 @@ static void Close( vlc_object_t * );
                           "helps reducing the scheduling load on " \
                           "heavily-loaded systems." )
 
+#define BATCH_TEXT N_("Batching window (ms)")
+#define BATCH_LONGTEXT N_("Packets due within this window are sent " \
+                          "together with a single system call. This " \
+                          "reduces the per-packet overhead at high packet " \
+                          "rates, at the expense of pacing accuracy. " \
+                          "0 disables batching." )
+
 vlc_module_begin ()
     set_description( N_("UDP stream output") )
     set_shortname( "UDP" )
@@ -81,6 +88,11 @@ vlc_module_begin ()
     add_integer( SOUT_CFG_PREFIX "caching", DEFAULT_PTS_DELAY / 1000, CACHING_TEXT, CACHING_LONGTEXT, true )
     add_integer( SOUT_CFG_PREFIX "group", 1, GROUP_TEXT, GROUP_LONGTEXT,
                                  true )
+#ifdef HAVE_SENDMMSG
+    add_integer( SOUT_CFG_PREFIX "batch-window", 0, BATCH_TEXT,
+                 BATCH_LONGTEXT, true )
+        change_integer_range( 0, 100 )
+#endif
 
     set_capability( "sout access", 0 )
     add_shortcut( "udp" )
@@ -94,6 +106,9 @@ vlc_module_end ()
 static const char *const ppsz_sout_options[] = {
     "caching",
     "group",
+#ifdef HAVE_SENDMMSG
+    "batch-window",
+#endif
     NULL
 };
 
@@ -110,11 +125,17 @@ static int  Seek    ( sout_access_out_t *, off_t  );
 static int Control( sout_access_out_t *, int, va_list );
 
 static void* ThreadWrite( void * );
+#ifdef HAVE_SENDMMSG
+static void* ThreadWriteBatch( void * );
+#endif
 static block_t *NewUDPPacket( sout_access_out_t *, mtime_t );
 
 struct sout_access_out_sys_t
 {
     mtime_t       i_caching;
+#ifdef HAVE_SENDMMSG
+    mtime_t       i_batch_window;
+#endif
     int           i_handle;
     bool          b_mtu_warning;
     size_t        i_mtu;
@@ -212,11 +233,25 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_handle = i_handle;
     p_sys->i_mtu = var_CreateGetInteger( p_this, "mtu" );
     p_sys->b_mtu_warning = false;
-    p_sys->p_fifo = block_FifoNew();
-    p_sys->p_empty_blocks = block_FifoNew();
+    /* Write() feeds p_fifo and drains p_empty_blocks, ThreadWrite() does
+     * the opposite: each queue has a single producer and a single consumer. */
+    p_sys->p_fifo = block_FifoNewSPSC();
+    p_sys->p_empty_blocks = block_FifoNewSPSC();
     p_sys->p_buffer = NULL;
 
-    if( vlc_clone( &p_sys->thread, ThreadWrite, p_access,
+    void *(*pf_thread)( void * ) = ThreadWrite;
+#ifdef HAVE_SENDMMSG
+    p_sys->i_batch_window = UINT64_C(1000)
+                     * var_GetInteger( p_access, SOUT_CFG_PREFIX "batch-window" );
+    if( p_sys->i_batch_window > 0 )
+    {
+        msg_Dbg( p_access, "batching packets within %"PRId64" ms",
+                 p_sys->i_batch_window / 1000 );
+        pf_thread = ThreadWriteBatch;
+    }
+#endif
+
+    if( vlc_clone( &p_sys->thread, pf_thread, p_access,
                            VLC_THREAD_PRIORITY_HIGHEST ) )
     {
         msg_Err( p_access, "cannot spawn sout access thread" );
@@ -394,6 +429,31 @@ static block_t *NewUDPPacket( sout_access_out_t *p_access, mtime_t i_dts)
     return p_buffer;
 }
 
+/*****************************************************************************
+ * CheckHole: tells whether a packet is too far in the future to be sent
+ *****************************************************************************/
+static bool CheckHole( sout_access_out_t *p_access, mtime_t i_date,
+                       mtime_t i_date_last, unsigned i_dropped_packets )
+{
+    if( i_date_last <= 0 )
+        return false;
+
+    if( i_date - i_date_last > 2000000 )
+    {
+        if( !i_dropped_packets )
+            msg_Dbg( p_access, "mmh, hole (%"PRId64" > 2s) -> drop",
+                     i_date - i_date_last );
+        return true;
+    }
+    else if( i_date - i_date_last < -1000 )
+    {
+        if( !i_dropped_packets )
+            msg_Dbg( p_access, "mmh, packets in the past (%"PRId64")",
+                     i_date_last - i_date );
+    }
+    return false;
+}
+
 /*****************************************************************************
  * ThreadWrite: Write a packet on the network at the good time.
  *****************************************************************************/
@@ -413,26 +473,13 @@ static void* ThreadWrite( void *data )
         mtime_t       i_date, i_sent;
 
         i_date = p_sys->i_caching + p_pk->i_dts;
-        if( i_date_last > 0 )
+        if( CheckHole( p_access, i_date, i_date_last, i_dropped_packets ) )
         {
-            if( i_date - i_date_last > 2000000 )
-            {
-                if( !i_dropped_packets )
-                    msg_Dbg( p_access, "mmh, hole (%"PRId64" > 2s) -> drop",
-                             i_date - i_date_last );
-
-                block_FifoPut( p_sys->p_empty_blocks, p_pk );
+            block_FifoPut( p_sys->p_empty_blocks, p_pk );
 
-                i_date_last = i_date;
-                i_dropped_packets++;
-                continue;
-            }
-            else if( i_date - i_date_last < -1000 )
-            {
-                if( !i_dropped_packets )
-                    msg_Dbg( p_access, "mmh, packets in the past (%"PRId64")",
-                             i_date_last - i_date );
-            }
+            i_date_last = i_date;
+            i_dropped_packets++;
+            continue;
         }
 
         block_cleanup_push( p_pk );
@@ -467,3 +514,122 @@ static void* ThreadWrite( void *data )
     }
     return NULL;
 }
+
+#ifdef HAVE_SENDMMSG
+#define MAX_BATCH_PACKETS 64
+
+typedef struct
+{
+    unsigned i_count;
+    block_t *pp_blocks[MAX_BATCH_PACKETS];
+} udp_batch_t;
+
+static void BatchCleanup( void *data )
+{
+    udp_batch_t *p_batch = data;
+
+    for( unsigned i = 0; i < p_batch->i_count; i++ )
+        block_Release( p_batch->pp_blocks[i] );
+    p_batch->i_count = 0;
+}
+
+/*****************************************************************************
+ * ThreadWriteBatch: Write all the packets due within the batching window
+ * with a single sendmmsg() call.
+ *****************************************************************************
+ * The batch starts at the first pending packet and the thread waits for its
+ * date only. Packets carrying a PCR always start a new batch so that they are
+ * never sent ahead of time.
+ *****************************************************************************/
+static void* ThreadWriteBatch( void *data )
+{
+    sout_access_out_t *p_access = data;
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    udp_batch_t batch = { .i_count = 0 };
+    struct mmsghdr msgs[MAX_BATCH_PACKETS];
+    struct iovec iov[MAX_BATCH_PACKETS];
+    mtime_t i_date_last = -1;
+    unsigned i_dropped_packets = 0;
+
+    memset( msgs, 0, sizeof( msgs ) );
+    for( unsigned i = 0; i < MAX_BATCH_PACKETS; i++ )
+    {
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    vlc_cleanup_push( BatchCleanup, &batch );
+    for (;;)
+    {
+        block_t *p_pk = block_FifoGet( p_sys->p_fifo );
+        mtime_t i_date, i_sent;
+
+        i_date = p_sys->i_caching + p_pk->i_dts;
+        if( CheckHole( p_access, i_date, i_date_last, i_dropped_packets ) )
+        {
+            block_FifoPut( p_sys->p_empty_blocks, p_pk );
+
+            i_date_last = i_date;
+            i_dropped_packets++;
+            continue;
+        }
+
+        batch.pp_blocks[batch.i_count++] = p_pk;
+        mwait( i_date );
+
+        /* Gather the packets that are already queued and due soon enough */
+        const mtime_t i_deadline = i_date + p_sys->i_batch_window;
+        while( batch.i_count < MAX_BATCH_PACKETS
+            && block_FifoCount( p_sys->p_fifo ) > 0 )
+        {
+            block_t *p_next = block_FifoShow( p_sys->p_fifo );
+            mtime_t i_next = p_sys->i_caching + p_next->i_dts;
+
+            if( i_next > i_deadline || i_next < i_date
+             || (p_next->i_flags & BLOCK_FLAG_CLOCK) )
+                break;
+            batch.pp_blocks[batch.i_count++] = block_FifoGet( p_sys->p_fifo );
+            i_date_last = i_next;
+        }
+        if( i_date_last < i_date )
+            i_date_last = i_date;
+
+        for( unsigned i = 0; i < batch.i_count; i++ )
+        {
+            iov[i].iov_base = batch.pp_blocks[i]->p_buffer;
+            iov[i].iov_len = batch.pp_blocks[i]->i_buffer;
+        }
+
+        for( unsigned i = 0; i < batch.i_count; )
+        {
+            int val = sendmmsg( p_sys->i_handle, msgs + i,
+                                batch.i_count - i, 0 );
+            if( val == -1 )
+            {
+                msg_Warn( p_access, "send error: %m" );
+                val = 1; /* skip the faulty packet */
+            }
+            i += val;
+        }
+
+        if( i_dropped_packets )
+        {
+            msg_Dbg( p_access, "dropped %i packets", i_dropped_packets );
+            i_dropped_packets = 0;
+        }
+
+        i_sent = mdate();
+        if ( i_sent > i_date + 20000 )
+        {
+            msg_Dbg( p_access, "packet has been sent too late (%"PRId64 ")",
+                     i_sent - i_date );
+        }
+
+        for( unsigned i = 0; i < batch.i_count; i++ )
+            block_FifoPut( p_sys->p_empty_blocks, batch.pp_blocks[i] );
+        batch.i_count = 0;
+    }
+    vlc_cleanup_pop();
+    return NULL;
+}
+#endif
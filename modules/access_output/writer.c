@@ -0,0 +1,373 @@
+/*****************************************************************************
+ * writer.c: buffered file writer thread
+ *****************************************************************************
+ * Copyright (C) 2012 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include <vlc_common.h>
+
+#if defined( WIN32 ) && !defined( UNDER_CE )
+#   include <io.h>
+#   define lseek _lseeki64
+#elif defined( __OS2__ )
+#   include <io.h>
+#else
+#   include <unistd.h>
+#endif
+
+#include "writer.h"
+
+#define WRITER_BUFFERS      4
+#define WRITER_BUFFER_SIZE  (1 << 20)
+/* Alignment of the buffers, and of the offsets and sizes for O_DIRECT */
+#define WRITER_ALIGN        4096
+/* Size by which the file is extended ahead of the writes */
+#define WRITER_PREALLOC     (32 << 20)
+
+struct file_writer_t
+{
+    vlc_object_t *p_obj;
+    int          fd;
+    uint8_t      *p_data;           /* WRITER_BUFFERS buffers */
+
+    /* Caller side */
+    unsigned     i_current;         /* buffer being filled */
+    size_t       i_fill;
+
+    /* Shared, protected by lock */
+    vlc_thread_t thread;
+    vlc_mutex_t  lock;
+    vlc_cond_t   wait;              /* signals queued buffers */
+    vlc_cond_t   done;              /* signals written buffers */
+    unsigned     i_first;           /* oldest queued buffer */
+    unsigned     i_queued;
+    size_t       pi_size[WRITER_BUFFERS];
+    bool         b_exit;
+    bool         b_error;
+
+    /* Writer thread side */
+    bool         b_direct;          /* O_DIRECT is wanted */
+    bool         b_direct_set;      /* O_DIRECT is set on fd */
+    bool         b_prealloc;
+    uint64_t     i_prealloc;        /* end of the preallocated area */
+    uint64_t     i_cache_start;     /* last range written to the cache */
+    uint64_t     i_cache_size;
+};
+
+static void SetDirect( file_writer_t *p_writer, bool b_direct )
+{
+#ifdef O_DIRECT
+    if( b_direct == p_writer->b_direct_set )
+        return;
+
+    int i_flags = fcntl( p_writer->fd, F_GETFL );
+    if( i_flags == -1
+     || fcntl( p_writer->fd, F_SETFL,
+               b_direct ? ( i_flags | O_DIRECT ) : ( i_flags & ~O_DIRECT ) ) )
+    {
+        if( b_direct )
+        {
+            msg_Warn( p_writer->p_obj, "cannot use direct I/O: %m" );
+            p_writer->b_direct = false;
+        }
+        return;
+    }
+    p_writer->b_direct_set = b_direct;
+#else
+    VLC_UNUSED( p_writer ); VLC_UNUSED( b_direct );
+#endif
+}
+
+/* Reserves the disk space ahead of the writes, without changing the file
+ * size, so that a file written slowly is not fragmented */
+static void Preallocate( file_writer_t *p_writer, uint64_t i_start,
+                         uint64_t i_end )
+{
+#ifdef FALLOC_FL_KEEP_SIZE
+    if( !p_writer->b_prealloc || i_end <= p_writer->i_prealloc )
+        return;
+
+    if( i_start < p_writer->i_prealloc )
+        i_start = p_writer->i_prealloc;
+    i_end += WRITER_PREALLOC;
+
+    if( fallocate( p_writer->fd, FALLOC_FL_KEEP_SIZE,
+                   i_start, i_end - i_start ) )
+    {
+        msg_Dbg( p_writer->p_obj, "cannot preallocate (%m)" );
+        p_writer->b_prealloc = false;
+        return;
+    }
+    p_writer->i_prealloc = i_end;
+#else
+    VLC_UNUSED( p_writer ); VLC_UNUSED( i_start ); VLC_UNUSED( i_end );
+#endif
+}
+
+/* Starts writing back a range written to the page cache, then waits for
+ * the previous one to reach the disk and drops it from the cache */
+static void Uncache( file_writer_t *p_writer, uint64_t i_start,
+                     uint64_t i_size )
+{
+#if defined( SYNC_FILE_RANGE_WRITE ) && defined( HAVE_POSIX_FADVISE )
+    const int fd = p_writer->fd;
+
+    if( i_size > 0 )
+        sync_file_range( fd, i_start, i_size, SYNC_FILE_RANGE_WRITE );
+
+    if( p_writer->i_cache_size > 0 )
+    {
+        sync_file_range( fd, p_writer->i_cache_start,
+                         p_writer->i_cache_size,
+                         SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE |
+                         SYNC_FILE_RANGE_WAIT_AFTER );
+        posix_fadvise( fd, p_writer->i_cache_start, p_writer->i_cache_size,
+                       POSIX_FADV_DONTNEED );
+    }
+    p_writer->i_cache_start = i_start;
+    p_writer->i_cache_size = i_size;
+#else
+    VLC_UNUSED( p_writer ); VLC_UNUSED( i_start ); VLC_UNUSED( i_size );
+#endif
+}
+
+static bool WriteBuffer( file_writer_t *p_writer, const uint8_t *p_buffer,
+                         size_t i_buffer )
+{
+    const int fd = p_writer->fd;
+    off_t i_offset = lseek( fd, 0, SEEK_CUR );
+
+    if( i_offset == -1 )
+    {
+        msg_Err( p_writer->p_obj, "cannot get the file position: %m" );
+        return false;
+    }
+
+    Preallocate( p_writer, i_offset, i_offset + i_buffer );
+    SetDirect( p_writer, p_writer->b_direct
+                      && ( i_offset % WRITER_ALIGN ) == 0
+                      && ( i_buffer % WRITER_ALIGN ) == 0 );
+
+    const bool b_cached = !p_writer->b_direct_set;
+    size_t i_written = 0;
+
+    while( i_written < i_buffer )
+    {
+        ssize_t val = write( fd, &p_buffer[i_written], i_buffer - i_written );
+        if( val == -1 )
+        {
+            if( errno == EINTR )
+                continue;
+            if( errno == EINVAL && p_writer->b_direct_set )
+            {
+                msg_Warn( p_writer->p_obj, "direct I/O failed, disabling" );
+                p_writer->b_direct = false;
+                SetDirect( p_writer, false );
+                continue;
+            }
+            msg_Err( p_writer->p_obj, "cannot write: %m" );
+            return false;
+        }
+        i_written += val;
+    }
+
+    if( b_cached )
+        Uncache( p_writer, i_offset, i_written );
+    return true;
+}
+
+static void *Thread( void *data )
+{
+    file_writer_t *p_writer = data;
+
+    vlc_mutex_lock( &p_writer->lock );
+    for( ;; )
+    {
+        while( p_writer->i_queued == 0 && !p_writer->b_exit )
+            vlc_cond_wait( &p_writer->wait, &p_writer->lock );
+        if( p_writer->i_queued == 0 )
+            break;
+
+        const unsigned i = p_writer->i_first;
+        const size_t i_size = p_writer->pi_size[i];
+        vlc_mutex_unlock( &p_writer->lock );
+
+        bool b_ok = WriteBuffer( p_writer,
+                                 &p_writer->p_data[i * WRITER_BUFFER_SIZE],
+                                 i_size );
+
+        vlc_mutex_lock( &p_writer->lock );
+        if( !b_ok )
+            p_writer->b_error = true;
+        p_writer->i_first = ( i + 1 ) % WRITER_BUFFERS;
+        p_writer->i_queued--;
+        vlc_cond_signal( &p_writer->done );
+    }
+    vlc_mutex_unlock( &p_writer->lock );
+
+    /* Drop the last range too */
+    Uncache( p_writer, 0, 0 );
+    return NULL;
+}
+
+/* Hands the current buffer to the thread, and waits for a free one. */
+static void Queue( file_writer_t *p_writer )
+{
+    vlc_mutex_lock( &p_writer->lock );
+    p_writer->pi_size[p_writer->i_current] = p_writer->i_fill;
+    p_writer->i_queued++;
+    vlc_cond_signal( &p_writer->wait );
+
+    while( p_writer->i_queued >= WRITER_BUFFERS )
+        vlc_cond_wait( &p_writer->done, &p_writer->lock );
+    vlc_mutex_unlock( &p_writer->lock );
+
+    p_writer->i_current = ( p_writer->i_current + 1 ) % WRITER_BUFFERS;
+    p_writer->i_fill = 0;
+}
+
+#undef file_writer_New
+file_writer_t *file_writer_New( vlc_object_t *p_obj, int fd, bool b_direct )
+{
+    struct stat st;
+
+    if( fstat( fd, &st ) || !S_ISREG( st.st_mode ) )
+        return NULL;
+
+    file_writer_t *p_writer = malloc( sizeof( *p_writer ) );
+    if( !p_writer )
+        return NULL;
+
+    p_writer->p_data = vlc_memalign( WRITER_ALIGN,
+                                     WRITER_BUFFERS * WRITER_BUFFER_SIZE );
+    if( !p_writer->p_data )
+    {
+        free( p_writer );
+        return NULL;
+    }
+
+#ifndef O_DIRECT
+    if( b_direct )
+        msg_Warn( p_obj, "direct I/O is not supported" );
+    b_direct = false;
+#endif
+
+    p_writer->p_obj = p_obj;
+    p_writer->fd = fd;
+    p_writer->i_current = 0;
+    p_writer->i_fill = 0;
+    vlc_mutex_init( &p_writer->lock );
+    vlc_cond_init( &p_writer->wait );
+    vlc_cond_init( &p_writer->done );
+    p_writer->i_first = 0;
+    p_writer->i_queued = 0;
+    p_writer->b_exit = false;
+    p_writer->b_error = false;
+    p_writer->b_direct = b_direct;
+    p_writer->b_direct_set = false;
+    p_writer->b_prealloc = true;
+    p_writer->i_prealloc = 0;
+    p_writer->i_cache_start = 0;
+    p_writer->i_cache_size = 0;
+
+    if( vlc_clone( &p_writer->thread, Thread, p_writer,
+                   VLC_THREAD_PRIORITY_LOW ) )
+    {
+        vlc_cond_destroy( &p_writer->done );
+        vlc_cond_destroy( &p_writer->wait );
+        vlc_mutex_destroy( &p_writer->lock );
+        vlc_free( p_writer->p_data );
+        free( p_writer );
+        return NULL;
+    }
+    return p_writer;
+}
+
+void file_writer_Delete( file_writer_t *p_writer )
+{
+    if( p_writer->i_fill > 0 )
+        Queue( p_writer );
+
+    vlc_mutex_lock( &p_writer->lock );
+    p_writer->b_exit = true;
+    vlc_cond_signal( &p_writer->wait );
+    vlc_mutex_unlock( &p_writer->lock );
+
+    vlc_join( p_writer->thread, NULL );
+    SetDirect( p_writer, false );
+
+    /* Release the space preallocated beyond the end of the file */
+    struct stat st;
+    if( p_writer->i_prealloc > 0 && !fstat( p_writer->fd, &st )
+     && ftruncate( p_writer->fd, st.st_size ) )
+        msg_Warn( p_writer->p_obj, "cannot truncate the file: %m" );
+
+    vlc_cond_destroy( &p_writer->done );
+    vlc_cond_destroy( &p_writer->wait );
+    vlc_mutex_destroy( &p_writer->lock );
+    vlc_free( p_writer->p_data );
+    free( p_writer );
+}
+
+int file_writer_Write( file_writer_t *p_writer, const void *p_data,
+                       size_t i_data )
+{
+    const uint8_t *p = p_data;
+
+    while( i_data > 0 )
+    {
+        size_t i_copy = __MIN( i_data, WRITER_BUFFER_SIZE - p_writer->i_fill );
+
+        memcpy( &p_writer->p_data[p_writer->i_current * WRITER_BUFFER_SIZE
+                                  + p_writer->i_fill], p, i_copy );
+        p_writer->i_fill += i_copy;
+        p += i_copy;
+        i_data -= i_copy;
+
+        if( p_writer->i_fill >= WRITER_BUFFER_SIZE )
+            Queue( p_writer );
+    }
+
+    vlc_mutex_lock( &p_writer->lock );
+    bool b_error = p_writer->b_error;
+    vlc_mutex_unlock( &p_writer->lock );
+    return b_error ? VLC_EGENERIC : VLC_SUCCESS;
+}
+
+int file_writer_Flush( file_writer_t *p_writer )
+{
+    if( p_writer->i_fill > 0 )
+        Queue( p_writer );
+
+    vlc_mutex_lock( &p_writer->lock );
+    while( p_writer->i_queued > 0 )
+        vlc_cond_wait( &p_writer->done, &p_writer->lock );
+    /* The thread is idle: let the caller use the descriptor as usual */
+    SetDirect( p_writer, false );
+    bool b_error = p_writer->b_error;
+    vlc_mutex_unlock( &p_writer->lock );
+    return b_error ? VLC_EGENERIC : VLC_SUCCESS;
+}
@@ -0,0 +1,71 @@
+/*****************************************************************************
+ * writer.h: buffered file writer thread
+ *****************************************************************************
+ * Copyright (C) 2012 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_FILE_WRITER_H
+#define VLC_FILE_WRITER_H 1
+
+/* A file writer gathers the written data in a few large aligned buffers,
+ * and writes them from its own thread, so that a slow disk does not stall
+ * the caller. The written data is dropped from the page cache as it
+ * reaches the disk (or never enters it with O_DIRECT), and the file is
+ * preallocated ahead of the writes when the file system supports it.
+ *
+ * It is used by the file stream output and by the stream record filter. */
+
+#define WRITER_ASYNC_TEXT N_("Write from a separate thread")
+#define WRITER_ASYNC_LONGTEXT N_( \
+    "Gather the data in large buffers and write them from a separate " \
+    "thread, keeping the written data out of the page cache. This is " \
+    "useful when recording many streams at once." )
+#define WRITER_DIRECT_TEXT N_("Direct I/O")
+#define WRITER_DIRECT_LONGTEXT N_( \
+    "With the separate writer thread, write with O_DIRECT, bypassing the " \
+    "page cache entirely." )
+
+typedef struct file_writer_t file_writer_t;
+
+/**
+ * Starts a writer for a file descriptor, which is not closed by the writer.
+ * \return NULL if the descriptor is not a regular file, or on error
+ */
+file_writer_t *file_writer_New( vlc_object_t *, int fd, bool b_direct );
+#define file_writer_New( a, b, c ) file_writer_New( VLC_OBJECT(a), b, c )
+
+/**
+ * Writes the pending data, stops the thread and frees the writer.
+ */
+void file_writer_Delete( file_writer_t * );
+
+/**
+ * Queues data (it is copied). This blocks if the writer thread falls
+ * behind by more than its buffers.
+ * \return VLC_EGENERIC if a previous write failed
+ */
+int file_writer_Write( file_writer_t *, const void *, size_t );
+
+/**
+ * Waits for all the queued data to be written. Afterwards, the file
+ * position of the descriptor is the end of the written data, and the
+ * caller may seek or read until the next file_writer_Write().
+ * \return VLC_EGENERIC if a write failed
+ */
+int file_writer_Flush( file_writer_t * );
+
+#endif
@@ -26,6 +26,9 @@
 #include <vlc_plugin.h>
 #include <vlc_aout.h>
 #include <vlc_aout_mixer.h>
+#include <vlc_cpu.h>
+
+#include "gain.h"
 
 static int Activate (vlc_object_t *);
 
@@ -39,6 +42,9 @@ vlc_module_end ()
 
 static void FilterFI32 (audio_mixer_t *, block_t *, float);
 static void FilterS16N (audio_mixer_t *, block_t *, float);
+#if defined (__SSE2__)
+static void FilterS16NSSE2 (audio_mixer_t *, block_t *, float);
+#endif
 
 static int Activate (vlc_object_t *obj)
 {
@@ -51,6 +57,10 @@ static int Activate (vlc_object_t *obj)
             break;
         case VLC_CODEC_S16N:
             mixer->mix = FilterS16N;
+#if defined (__SSE2__)
+            if (vlc_CPU() & CPU_CAPABILITY_SSE2)
+                mixer->mix = FilterS16NSSE2;
+#endif
             break;
         default:
             return -1;
@@ -83,27 +93,21 @@ static void FilterS16N (audio_mixer_t *mixer, block_t *block, float volume)
     if (mult == 0x10000)
         return;
 
-    int16_t *p = (int16_t *)block->p_buffer;
+    GainS16C ((int16_t *)block->p_buffer, block->i_buffer / sizeof (int16_t),
+              mult);
+    (void) mixer;
+}
 
-    if (mult < 0x10000)
-    {
-        for (size_t n = block->i_buffer / sizeof (*p); n > 0; n--)
-        {
-            *p = (*p * mult) >> 16;
-            p++;
-        }
-    }
-    else
-    {
-        mult >>= 4;
-        for (size_t n = block->i_buffer / sizeof (*p); n > 0; n--)
-        {
-            int32_t v = (*p * mult) >> 12;
-            if (abs (v) > 0x7fff)
-                v = 0x8000;
-            *(p++) = v;
-        }
-    }
+#if defined (__SSE2__)
+static void FilterS16NSSE2 (audio_mixer_t *mixer, block_t *block, float volume)
+{
+    int32_t mult = volume * 0x1.p16;
 
+    if (mult == 0x10000)
+        return;
+
+    GainS16SSE2 ((int16_t *)block->p_buffer,
+                 block->i_buffer / sizeof (int16_t), mult);
     (void) mixer;
 }
+#endif
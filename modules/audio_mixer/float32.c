@@ -34,12 +34,24 @@
 #include <vlc_plugin.h>
 #include <vlc_aout.h>
 #include <vlc_aout_mixer.h>
+#include <vlc_cpu.h>
+
+#include "gain.h"
 
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
 static int Create( vlc_object_t * );
 static void DoWork( audio_mixer_t *, aout_buffer_t *, float );
+#if defined (__SSE__)
+static void DoWorkSSE( audio_mixer_t *, aout_buffer_t *, float );
+#endif
+#if defined (CAN_COMPILE_AVX)
+static void DoWorkAVX( audio_mixer_t *, aout_buffer_t *, float );
+#endif
+#if defined (__ARM_NEON__)
+static void DoWorkNEON( audio_mixer_t *, aout_buffer_t *, float );
+#endif
 
 /*****************************************************************************
  * Module descriptor
@@ -63,11 +75,23 @@ static int Create( vlc_object_t *p_this )
         return -1;
 
     p_mixer->mix = DoWork;
+#if defined (__SSE__)
+    if( vlc_CPU() & CPU_CAPABILITY_SSE )
+        p_mixer->mix = DoWorkSSE;
+#endif
+#if defined (CAN_COMPILE_AVX)
+    if( vlc_CPU() & CPU_CAPABILITY_AVX )
+        p_mixer->mix = DoWorkAVX;
+#endif
+#if defined (__ARM_NEON__)
+    if( vlc_CPU() & CPU_CAPABILITY_NEON )
+        p_mixer->mix = DoWorkNEON;
+#endif
     return 0;
 }
 
 /**
- * Mixes a new output buffer
+ * Mixes a new output buffer, clipping the samples when amplified
  */
 static void DoWork( audio_mixer_t * p_mixer, aout_buffer_t *p_buffer,
                     float f_multiplier )
@@ -75,9 +99,46 @@ static void DoWork( audio_mixer_t * p_mixer, aout_buffer_t *p_buffer,
     if( f_multiplier == 1.0 )
         return; /* nothing to do */
 
-    float *p = (float *)p_buffer->p_buffer;
-    for( size_t i = p_buffer->i_buffer / sizeof(float); i > 0; i-- )
-        *(p++) *= f_multiplier;
+    GainFloatC( (float *)p_buffer->p_buffer,
+                p_buffer->i_buffer / sizeof(float), f_multiplier );
+    (void) p_mixer;
+}
 
+#if defined (__SSE__)
+static void DoWorkSSE( audio_mixer_t * p_mixer, aout_buffer_t *p_buffer,
+                       float f_multiplier )
+{
+    if( f_multiplier == 1.0 )
+        return;
+
+    GainFloatSSE( (float *)p_buffer->p_buffer,
+                  p_buffer->i_buffer / sizeof(float), f_multiplier );
     (void) p_mixer;
 }
+#endif
+
+#if defined (CAN_COMPILE_AVX)
+static void DoWorkAVX( audio_mixer_t * p_mixer, aout_buffer_t *p_buffer,
+                       float f_multiplier )
+{
+    if( f_multiplier == 1.0 )
+        return;
+
+    GainFloatAVX( (float *)p_buffer->p_buffer,
+                  p_buffer->i_buffer / sizeof(float), f_multiplier );
+    (void) p_mixer;
+}
+#endif
+
+#if defined (__ARM_NEON__)
+static void DoWorkNEON( audio_mixer_t * p_mixer, aout_buffer_t *p_buffer,
+                        float f_multiplier )
+{
+    if( f_multiplier == 1.0 )
+        return;
+
+    GainFloatNEON( (float *)p_buffer->p_buffer,
+                   p_buffer->i_buffer / sizeof(float), f_multiplier );
+    (void) p_mixer;
+}
+#endif
@@ -0,0 +1,190 @@
+/*****************************************************************************
+ * gain.h : software amplification of the audio samples
+ *****************************************************************************
+ * Copyright (C) 2012 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_AUDIO_MIXER_GAIN_H_
+#define VLC_AUDIO_MIXER_GAIN_H_
+
+/* The amplification of n samples in place. When amplified, the float
+ * samples are clipped to [-1, 1] and the 16 bits ones saturate, so that
+ * every kernel gives the same samples as the C one. */
+
+#if defined (__SSE__)
+# include <xmmintrin.h>
+#endif
+#if defined (__SSE2__)
+# include <emmintrin.h>
+#endif
+#if defined (CAN_COMPILE_AVX)
+# include <immintrin.h>
+#endif
+#if defined (__ARM_NEON__)
+# include <arm_neon.h>
+#endif
+
+static inline void GainFloatC( float *p, size_t n, float f )
+{
+    if( f > 1.f )
+    {
+        for( size_t i = 0; i < n; i++ )
+        {
+            const float v = p[i] * f;
+            p[i] = v > 1.f ? 1.f : v < -1.f ? -1.f : v;
+        }
+    }
+    else
+    {
+        for( size_t i = 0; i < n; i++ )
+            p[i] *= f;
+    }
+}
+
+#if defined (__SSE__)
+VLC_SSE
+static inline void GainFloatSSE( float *p, size_t n, float f )
+{
+    const __m128 mult = _mm_set1_ps( f );
+    const __m128 max = _mm_set1_ps( 1.f );
+    const __m128 min = _mm_set1_ps( -1.f );
+    size_t i = 0;
+
+    if( f > 1.f )
+    {
+        for( ; i + 4 <= n; i += 4 )
+        {
+            __m128 v = _mm_mul_ps( _mm_loadu_ps( &p[i] ), mult );
+            _mm_storeu_ps( &p[i], _mm_max_ps( _mm_min_ps( v, max ), min ) );
+        }
+    }
+    else
+    {
+        for( ; i + 4 <= n; i += 4 )
+            _mm_storeu_ps( &p[i], _mm_mul_ps( _mm_loadu_ps( &p[i] ), mult ) );
+    }
+    GainFloatC( &p[i], n - i, f );
+}
+#endif
+
+#if defined (CAN_COMPILE_AVX)
+VLC_AVX
+static inline void GainFloatAVX( float *p, size_t n, float f )
+{
+    const __m256 mult = _mm256_set1_ps( f );
+    const __m256 max = _mm256_set1_ps( 1.f );
+    const __m256 min = _mm256_set1_ps( -1.f );
+    size_t i = 0;
+
+    if( f > 1.f )
+    {
+        for( ; i + 8 <= n; i += 8 )
+        {
+            __m256 v = _mm256_mul_ps( _mm256_loadu_ps( &p[i] ), mult );
+            _mm256_storeu_ps( &p[i], _mm256_max_ps( _mm256_min_ps( v, max ), min ) );
+        }
+    }
+    else
+    {
+        for( ; i + 8 <= n; i += 8 )
+            _mm256_storeu_ps( &p[i], _mm256_mul_ps( _mm256_loadu_ps( &p[i] ), mult ) );
+    }
+    GainFloatC( &p[i], n - i, f );
+}
+#endif
+
+#if defined (__ARM_NEON__)
+static inline void GainFloatNEON( float *p, size_t n, float f )
+{
+    const float32x4_t max = vdupq_n_f32( 1.f );
+    const float32x4_t min = vdupq_n_f32( -1.f );
+    size_t i = 0;
+
+    if( f > 1.f )
+    {
+        for( ; i + 4 <= n; i += 4 )
+        {
+            float32x4_t v = vmulq_n_f32( vld1q_f32( &p[i] ), f );
+            vst1q_f32( &p[i], vmaxq_f32( vminq_f32( v, max ), min ) );
+        }
+    }
+    else
+    {
+        for( ; i + 4 <= n; i += 4 )
+            vst1q_f32( &p[i], vmulq_n_f32( vld1q_f32( &p[i] ), f ) );
+    }
+    GainFloatC( &p[i], n - i, f );
+}
+#endif
+
+/* mult is the gain in 16.16 fixed point, not 1.0 */
+static inline void GainS16C( int16_t *p, size_t n, int32_t mult )
+{
+    if( mult < 0x10000 )
+    {
+        for( size_t i = 0; i < n; i++ )
+            p[i] = (p[i] * mult) >> 16;
+    }
+    else
+    {
+        mult >>= 4;
+        for( size_t i = 0; i < n; i++ )
+        {
+            int32_t v = (p[i] * mult) >> 12;
+            p[i] = v > 0x7fff ? 0x7fff : v < -0x8000 ? -0x8000 : v;
+        }
+    }
+}
+
+#if defined (__SSE2__)
+static inline void GainS16SSE2( int16_t *p, size_t n, int32_t mult )
+{
+    size_t i = 0;
+
+    if( mult < 0x10000 )
+    {
+        /* The signed high product is short of p when mult has bit 15 set */
+        const __m128i m = _mm_set1_epi16( mult );
+        const __m128i fix = _mm_set1_epi16( mult & 0x8000 ? -1 : 0 );
+
+        for( ; i + 8 <= n; i += 8 )
+        {
+            __m128i v = _mm_loadu_si128( (const __m128i *)&p[i] );
+            __m128i hi = _mm_mulhi_epi16( v, m );
+            hi = _mm_add_epi16( hi, _mm_and_si128( v, fix ) );
+            _mm_storeu_si128( (__m128i *)&p[i], hi );
+        }
+    }
+    else if( (mult >> 4) <= 0x7fff )
+    {
+        const __m128i m = _mm_set1_epi16( mult >> 4 );
+
+        for( ; i + 8 <= n; i += 8 )
+        {
+            __m128i v = _mm_loadu_si128( (const __m128i *)&p[i] );
+            __m128i lo = _mm_mullo_epi16( v, m );
+            __m128i hi = _mm_mulhi_epi16( v, m );
+            __m128i v0 = _mm_srai_epi32( _mm_unpacklo_epi16( lo, hi ), 12 );
+            __m128i v1 = _mm_srai_epi32( _mm_unpackhi_epi16( lo, hi ), 12 );
+            _mm_storeu_si128( (__m128i *)&p[i], _mm_packs_epi32( v0, v1 ) );
+        }
+    }
+    GainS16C( &p[i], n - i, mult );
+}
+#endif
+
+#endif
@@ -108,6 +108,8 @@ vlc_module_begin ()
         false )
     add_bool( "ffmpeg-hurry-up", true, HURRYUP_TEXT, HURRYUP_LONGTEXT,
         false )
+    add_bool( "ffmpeg-hurry-up-ahead", false, HURRYUP_AHEAD_TEXT,
+        HURRYUP_AHEAD_LONGTEXT, true )
     add_integer( "ffmpeg-skip-frame", 0, SKIP_FRAME_TEXT,
         SKIP_FRAME_LONGTEXT, true )
         change_integer_range( -1, 4 )
@@ -98,6 +98,13 @@ int ffmpeg_OpenCodec( decoder_t *p_dec );
     "when there is not enough time. It's useful with low CPU power " \
     "but it can produce distorted pictures.")
 
+#define HURRYUP_AHEAD_TEXT N_("Hurry up ahead of time")
+#define HURRYUP_AHEAD_LONGTEXT N_( \
+    "The decoder measures how long each picture takes to decode, and skips " \
+    "the pictures which are not used as references as soon as it runs short " \
+    "of time, instead of once the pictures are already late. This avoids " \
+    "bursts of dropped pictures on slow computers.")
+
 #define FAST_TEXT N_("Allow speed tricks")
 #define FAST_LONGTEXT N_( \
     "Allow non specification compliant speedup tricks. Faster but error-prone.")
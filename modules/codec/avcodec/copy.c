@@ -29,6 +29,9 @@
 #include <vlc_picture.h>
 #include <vlc_cpu.h>
 #include <assert.h>
+#ifdef __ARM_NEON__
+# include <arm_neon.h>
+#endif
 
 #include "copy.h"
 
@@ -356,6 +359,34 @@ static void SplitPlanes(uint8_t *dstu, size_t dstu_pitch,
     }
 }
 
+#ifdef __ARM_NEON__
+/* The surfaces are not USWC memory there: only the interleaved chroma
+ * needs some care, memcpy() is as good as it gets for the planes.
+ */
+static void NEON_SplitPlanes(uint8_t *dstu, size_t dstu_pitch,
+                             uint8_t *dstv, size_t dstv_pitch,
+                             const uint8_t *src, size_t src_pitch,
+                             unsigned width, unsigned height)
+{
+    for (unsigned y = 0; y < height; y++) {
+        unsigned x = 0;
+
+        for (; x + 15 < width; x += 16) {
+            const uint8x16x2_t uv = vld2q_u8(&src[2*x]);
+            vst1q_u8(&dstu[x], uv.val[0]);
+            vst1q_u8(&dstv[x], uv.val[1]);
+        }
+        for (; x < width; x++) {
+            dstu[x] = src[2*x+0];
+            dstv[x] = src[2*x+1];
+        }
+        src  += src_pitch;
+        dstu += dstu_pitch;
+        dstv += dstv_pitch;
+    }
+}
+#endif
+
 void CopyFromNv12(picture_t *dst, uint8_t *src[2], size_t src_pitch[2],
                   unsigned width, unsigned height,
                   copy_cache_t *cache)
@@ -372,6 +403,13 @@ void CopyFromNv12(picture_t *dst, uint8_t *src[2], size_t src_pitch[2],
     CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch,
               src[0], src_pitch[0],
               width, height);
+#ifdef __ARM_NEON__
+    if (vlc_CPU() & CPU_CAPABILITY_NEON)
+        return NEON_SplitPlanes(dst->p[2].p_pixels, dst->p[2].i_pitch,
+                                dst->p[1].p_pixels, dst->p[1].i_pitch,
+                                src[1], src_pitch[1],
+                                width/2, height/2);
+#endif
     SplitPlanes(dst->p[2].p_pixels, dst->p[2].i_pitch,
                 dst->p[1].p_pixels, dst->p[1].i_pitch,
                 src[1], src_pitch[1],
@@ -396,5 +434,5 @@ void CopyFromYv12(picture_t *dst, uint8_t *src[3], size_t src_pitch[3],
      CopyPlane(dst->p[1].p_pixels, dst->p[1].i_pitch,
                src[1], src_pitch[1], width / 2, height / 2);
      CopyPlane(dst->p[2].p_pixels, dst->p[2].i_pitch,
-               src[1], src_pitch[2], width / 2, height / 2);
+               src[2], src_pitch[2], width / 2, height / 2);
 }
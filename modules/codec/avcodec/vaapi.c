@@ -85,6 +85,9 @@ typedef struct
     VAImage      image;
     copy_cache_t image_cache;
 
+    /* The surfaces can be mapped directly (no vaGetImage() copy) */
+    bool         b_derive;
+
 } vlc_va_vaapi_t;
 
 static vlc_va_vaapi_t *vlc_va_vaapi_Get( void *p_va )
@@ -93,6 +96,13 @@ static vlc_va_vaapi_t *vlc_va_vaapi_Get( void *p_va )
 }
 
 /* */
+static bool IsSupportedImage( const VAImageFormat *p_fmt )
+{
+    return p_fmt->fourcc == VA_FOURCC( 'Y', 'V', '1', '2' ) ||
+           p_fmt->fourcc == VA_FOURCC( 'I', '4', '2', '0' ) ||
+           p_fmt->fourcc == VA_FOURCC( 'N', 'V', '1', '2' );
+}
+
 static int Open( vlc_va_vaapi_t *p_va, int i_codec_id )
 {
     VAProfile i_profile, *p_profiles_list;
@@ -281,9 +291,7 @@ static int CreateSurfaces( vlc_va_vaapi_t *p_va, void **pp_hw_ctx, vlc_fourcc_t
     VAImageFormat fmt;
     for( int i = 0; i < i_fmt_count; i++ )
     {
-        if( p_fmt[i].fourcc == VA_FOURCC( 'Y', 'V', '1', '2' ) ||
-            p_fmt[i].fourcc == VA_FOURCC( 'I', '4', '2', '0' ) ||
-            p_fmt[i].fourcc == VA_FOURCC( 'N', 'V', '1', '2' ) )
+        if( IsSupportedImage( &p_fmt[i] ) )
         {
             if( vaCreateImage(  p_va->p_display, &p_fmt[i], i_width, i_height, &p_va->image ) )
             {
@@ -310,6 +318,16 @@ static int CreateSurfaces( vlc_va_vaapi_t *p_va, void **pp_hw_ctx, vlc_fourcc_t
         goto error;
     *pi_chroma = i_chroma;
 
+    /* Mapping the surfaces themselves saves a copy of each picture, when
+     * the driver supports it with a format we can read */
+    VAImage derived;
+    p_va->b_derive = false;
+    if( !vaDeriveImage( p_va->p_display, pi_surface_id[0], &derived ) )
+    {
+        p_va->b_derive = IsSupportedImage( &derived.format );
+        vaDestroyImage( p_va->p_display, derived.image_id );
+    }
+
     if( unlikely(CopyInitCache( &p_va->image_cache, i_width )) )
         goto error;
 
@@ -368,20 +386,28 @@ static int Extract( vlc_va_t *p_external, picture_t *p_picture, AVFrame *p_ff )
 #endif
         return VLC_EGENERIC;
 
-    /* XXX vaDeriveImage may be better but it is not supported by
-     * my setup.
-     */
-
-    if( vaGetImage( p_va->p_display, i_surface_id,
-                    0, 0, p_va->i_surface_width, p_va->i_surface_height,
-                    p_va->image.image_id) )
+    VAImage derived;
+    const VAImage *p_image = &p_va->image;
+    if( p_va->b_derive )
+    {
+        if( vaDeriveImage( p_va->p_display, i_surface_id, &derived ) )
+            return VLC_EGENERIC;
+        p_image = &derived;
+    }
+    else if( vaGetImage( p_va->p_display, i_surface_id,
+                         0, 0, p_va->i_surface_width, p_va->i_surface_height,
+                         p_va->image.image_id) )
         return VLC_EGENERIC;
 
     void *p_base;
-    if( vaMapBuffer( p_va->p_display, p_va->image.buf, &p_base ) )
+    if( vaMapBuffer( p_va->p_display, p_image->buf, &p_base ) )
+    {
+        if( p_va->b_derive )
+            vaDestroyImage( p_va->p_display, derived.image_id );
         return VLC_EGENERIC;
+    }
 
-    const uint32_t i_fourcc = p_va->image.format.fourcc;
+    const uint32_t i_fourcc = p_image->format.fourcc;
     if( i_fourcc == VA_FOURCC('Y','V','1','2') ||
         i_fourcc == VA_FOURCC('I','4','2','0') )
     {
@@ -392,8 +418,8 @@ static int Extract( vlc_va_t *p_external, picture_t *p_picture, AVFrame *p_ff )
         for( int i = 0; i < 3; i++ )
         {
             const int i_src_plane = (b_swap_uv && i != 0) ?  (3 - i) : i;
-            pp_plane[i] = (uint8_t*)p_base + p_va->image.offsets[i_src_plane];
-            pi_pitch[i] = p_va->image.pitches[i_src_plane];
+            pp_plane[i] = (uint8_t*)p_base + p_image->offsets[i_src_plane];
+            pi_pitch[i] = p_image->pitches[i_src_plane];
         }
         CopyFromYv12( p_picture, pp_plane, pi_pitch,
                       p_va->i_surface_width,
@@ -408,8 +434,8 @@ static int Extract( vlc_va_t *p_external, picture_t *p_picture, AVFrame *p_ff )
 
         for( int i = 0; i < 2; i++ )
         {
-            pp_plane[i] = (uint8_t*)p_base + p_va->image.offsets[i];
-            pi_pitch[i] = p_va->image.pitches[i];
+            pp_plane[i] = (uint8_t*)p_base + p_image->offsets[i];
+            pi_pitch[i] = p_image->pitches[i];
         }
         CopyFromNv12( p_picture, pp_plane, pi_pitch,
                       p_va->i_surface_width,
@@ -417,10 +443,12 @@ static int Extract( vlc_va_t *p_external, picture_t *p_picture, AVFrame *p_ff )
                       &p_va->image_cache );
     }
 
-    if( vaUnmapBuffer( p_va->p_display, p_va->image.buf ) )
-        return VLC_EGENERIC;
-
-    return VLC_SUCCESS;
+    int i_ret = VLC_SUCCESS;
+    if( vaUnmapBuffer( p_va->p_display, p_image->buf ) )
+        i_ret = VLC_EGENERIC;
+    if( p_va->b_derive )
+        vaDestroyImage( p_va->p_display, derived.image_id );
+    return i_ret;
 }
 static int Get( vlc_va_t *p_external, AVFrame *p_ff )
 {
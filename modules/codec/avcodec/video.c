@@ -87,6 +87,12 @@ struct decoder_sys_t
     int     i_late_frames;
     mtime_t i_late_frames_start;
 
+    /* for frame skipping ahead of time */
+    bool    b_hurry_up_ahead;
+    bool    b_skipping_ahead;
+    mtime_t i_decode_time; /* average decoding time of a picture */
+    mtime_t i_advance;     /* of the last picture over its display date */
+
     /* for direct rendering */
     bool b_direct_rendering;
     int  i_direct_rendering_used;
@@ -264,6 +270,8 @@ int InitVideoDec( decoder_t *p_dec, AVCodecContext *p_context,
 
     /* ***** ffmpeg frame skipping ***** */
     p_sys->b_hurry_up = var_CreateGetBool( p_dec, "ffmpeg-hurry-up" );
+    p_sys->b_hurry_up_ahead = p_sys->b_hurry_up &&
+                              var_CreateGetBool( p_dec, "ffmpeg-hurry-up-ahead" );
 
     switch( var_CreateGetInteger( p_dec, "ffmpeg-skip-frame" ) )
     {
@@ -286,6 +294,9 @@ int InitVideoDec( decoder_t *p_dec, AVCodecContext *p_context,
             p_sys->p_context->skip_frame = AVDISCARD_NONE;
             break;
     }
+    if( var_InheritBool( p_dec, "video-keyframes-only" ) &&
+        p_sys->p_context->skip_frame < AVDISCARD_NONKEY )
+        p_sys->p_context->skip_frame = AVDISCARD_NONKEY;
     p_sys->i_skip_frame = p_sys->p_context->skip_frame;
 
     switch( var_CreateGetInteger( p_dec, "ffmpeg-skip-idct" ) )
@@ -359,7 +370,13 @@ int InitVideoDec( decoder_t *p_dec, AVCodecContext *p_context,
             i_thread_count++;
 
         //FIXME: take in count the decoding time
-        i_thread_count = __MIN( i_thread_count, 4 );
+#if defined(CODEC_CAP_FRAME_THREADS) && defined(CODEC_CAP_SLICE_THREADS)
+        /* Each frame thread delays the output by one more picture, whereas
+         * slice threads (as for MPEG-1/2 video) only split each picture */
+        if( ( p_codec->capabilities & CODEC_CAP_FRAME_THREADS ) ||
+            !( p_codec->capabilities & CODEC_CAP_SLICE_THREADS ) )
+#endif
+            i_thread_count = __MIN( i_thread_count, 4 );
     }
     i_thread_count = __MIN( i_thread_count, 16 );
     msg_Dbg( p_dec, "allowing %d thread(s) for decoding", i_thread_count );
@@ -392,7 +409,16 @@ int InitVideoDec( decoder_t *p_dec, AVCodecContext *p_context,
 #endif
 #ifdef HAVE_AVCODEC_MT
     if( p_sys->p_context->thread_type & FF_THREAD_FRAME )
+    {
         p_dec->i_extra_picture_buffers = 2 * p_sys->p_context->thread_count;
+
+        /* ffmpeg_GetFrameBuf() only touches the decoder state while the
+         * decoder thread is within avcodec (see sem_mt), so the frame
+         * threads may get their direct rendering pictures by themselves
+         * instead of waiting for the decoder thread to do it for them */
+        if( p_sys->b_direct_rendering )
+            p_sys->p_context->thread_safe_callbacks = true;
+    }
 #endif
 
 
@@ -402,6 +428,9 @@ int InitVideoDec( decoder_t *p_dec, AVCodecContext *p_context,
     p_sys->b_first_frame = true;
     p_sys->b_flush = false;
     p_sys->i_late_frames = 0;
+    p_sys->b_skipping_ahead = false;
+    p_sys->i_decode_time = 0;
+    p_sys->i_advance = INT64_MAX;
 
     /* Set output properties */
     p_dec->fmt_out.i_cat = VIDEO_ES;
@@ -462,6 +491,37 @@ int InitVideoDec( decoder_t *p_dec, AVCodecContext *p_context,
     return VLC_SUCCESS;
 }
 
+/*****************************************************************************
+ * SkipAhead: tells if the non-reference pictures should be skipped
+ *****************************************************************************
+ * Instead of waiting for the pictures to be late, the non-reference pictures
+ * are skipped as soon as the advance of the decoder over the display dates
+ * falls below a few decoding times, until it has grown back.
+ *****************************************************************************/
+static bool SkipAhead( decoder_t *p_dec )
+{
+    decoder_sys_t *p_sys = p_dec->p_sys;
+
+    if( p_sys->i_decode_time <= 0 || p_sys->i_advance == INT64_MAX )
+        return false;
+
+    if( !p_sys->b_skipping_ahead &&
+        p_sys->i_advance < 3 * p_sys->i_decode_time )
+    {
+        msg_Dbg( p_dec, "skipping the non-reference pictures ahead "
+                 "(%"PRId64" us in advance, %"PRId64" us per picture)",
+                 p_sys->i_advance, p_sys->i_decode_time );
+        p_sys->b_skipping_ahead = true;
+    }
+    else if( p_sys->b_skipping_ahead &&
+             p_sys->i_advance > 6 * p_sys->i_decode_time )
+    {
+        msg_Dbg( p_dec, "decoding all the pictures again" );
+        p_sys->b_skipping_ahead = false;
+    }
+    return p_sys->b_skipping_ahead;
+}
+
 /*****************************************************************************
  * DecodeVideo: Called to decode one or more frames
  *****************************************************************************/
@@ -498,9 +558,16 @@ picture_t *DecodeVideo( decoder_t *p_dec, block_t **pp_block )
         p_sys->i_pts = VLC_TS_INVALID; /* To make sure we recover properly */
 
         p_sys->i_late_frames = 0;
+        p_sys->b_skipping_ahead = false;
+        p_sys->i_advance = INT64_MAX;
 
         if( p_block->i_flags & BLOCK_FLAG_DISCONTINUITY )
+        {
+            /* The frame threads may be waiting for a picture buffer */
+            post_mt( p_sys );
             avcodec_flush_buffers( p_context );
+            wait_mt( p_sys );
+        }
 
         block_Release( p_block );
         return NULL;
@@ -509,8 +576,7 @@ picture_t *DecodeVideo( decoder_t *p_dec, block_t **pp_block )
     if( p_block->i_flags & BLOCK_FLAG_PREROLL )
     {
         /* Do not care about late frames when prerolling
-         * TODO avoid decoding of non reference frame
-         * (ie all B except for H264 where it depends only on nal_ref_idc) */
+         * (the non reference pictures are dropped below when flagged) */
         p_sys->i_late_frames = 0;
     }
 
@@ -557,6 +623,11 @@ picture_t *DecodeVideo( decoder_t *p_dec, block_t **pp_block )
             b_drawpicture = 1;
         else
             b_drawpicture = 0;
+
+        if( !p_dec->b_pace_control && p_sys->b_hurry_up_ahead &&
+            b_drawpicture && SkipAhead( p_dec ) )
+            p_context->skip_frame = __MAX( p_sys->i_skip_frame,
+                                           AVDISCARD_NONREF );
     }
 
     if( p_context->width <= 0 || p_context->height <= 0 )
@@ -576,6 +647,17 @@ picture_t *DecodeVideo( decoder_t *p_dec, block_t **pp_block )
 #endif
     }
 
+    /* The packetizer flags the pictures no other one refers to: those that
+     * would be discarded anyway need not even be parsed by libavcodec */
+    if( ( p_block->i_flags & BLOCK_FLAG_DISPOSABLE ) &&
+        !( p_block->i_flags & BLOCK_FLAG_END_OF_SEQUENCE ) &&
+        ( ( p_block->i_flags & BLOCK_FLAG_PREROLL ) ||
+          p_context->skip_frame >= AVDISCARD_NONREF ) )
+    {
+        block_Release( p_block );
+        return NULL;
+    }
+
     /*
      * Do the actual decoding now */
 
@@ -614,6 +696,7 @@ picture_t *DecodeVideo( decoder_t *p_dec, block_t **pp_block )
         p_block->i_pts =
         p_block->i_dts = VLC_TS_INVALID;
 
+        const mtime_t i_decode_start = mdate();
         post_mt( p_sys );
 
         av_init_packet( &pkt );
@@ -634,6 +717,19 @@ picture_t *DecodeVideo( decoder_t *p_dec, block_t **pp_block )
         }
         wait_mt( p_sys );
 
+        /* The frame threads decode asynchronously: the time spent in
+         * avcodec is meaningless then. The skipped pictures are not
+         * measured either, so that the average keeps the full cost. */
+        if( p_sys->b_hurry_up_ahead && b_gotpicture &&
+            !p_sys->b_skipping_ahead && p_context->thread_count <= 1 )
+        {
+            const mtime_t i_decode = mdate() - i_decode_start;
+            if( p_sys->i_decode_time <= 0 )
+                p_sys->i_decode_time = i_decode;
+            else
+                p_sys->i_decode_time += ( i_decode - p_sys->i_decode_time ) / 8;
+        }
+
         if( p_sys->b_flush )
             p_sys->b_first_frame = true;
 
@@ -733,6 +829,8 @@ picture_t *DecodeVideo( decoder_t *p_dec, block_t **pp_block )
         mtime_t i_display_date = 0;
         if( !(p_block->i_flags & BLOCK_FLAG_PREROLL) )
             i_display_date = decoder_GetDisplayDate( p_dec, i_pts );
+        if( i_display_date > 0 )
+            p_sys->i_advance = i_display_date - mdate();
 
         if( i_display_date > 0 && i_display_date <= mdate() )
         {
@@ -1139,6 +1237,9 @@ static void ffmpeg_ReleaseFrameBuf( struct AVCodecContext *p_context,
     {
         picture_t *p_pic = (picture_t*)p_ff_pic->opaque;
 
+        /* This may run in any frame thread, and even after EndVideoDec():
+         * the picture pool of the vout has its own lock, sem_mt is not
+         * needed (nor available) here */
         decoder_UnlinkPicture( p_dec, p_pic );
     }
     for( int i = 0; i < 4; i++ )
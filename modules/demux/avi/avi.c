@@ -40,7 +40,7 @@
 #include <vlc_meta.h>
 #include <vlc_codecs.h>
 #include <vlc_charset.h>
-#include <vlc_memory.h>
+#include <vlc_url.h>
 
 #include "libavi.h"
 
@@ -54,16 +54,18 @@
 #define INDEX_TEXT N_("Force index creation")
 #define INDEX_LONGTEXT N_( \
     "Recreate a index for the AVI file. Use this if your AVI file is damaged "\
-    "or incomplete (not seekable)." )
+    "or incomplete (not seekable). A local file can be fixed in the "\
+    "background, while it plays from the beginning." )
 
 static int  Open ( vlc_object_t * );
 static void Close( vlc_object_t * );
 
-static const int pi_index[] = {0,1,2};
+static const int pi_index[] = {0,1,2,3};
 
 static const char *const ppsz_indexes[] = { N_("Ask for action"),
                                             N_("Always fix"),
-                                            N_("Never fix") };
+                                            N_("Never fix"),
+                                            N_("Fix in background") };
 
 vlc_module_begin ()
     set_shortname( "AVI" )
@@ -112,26 +114,43 @@ typedef struct
 } avi_packet_t;
 
 
+/* An index entry takes 12 bytes: 48 bits of chunk position, the AVIIF_*
+ * flags that fit in 16 bits and the chunk length */
 typedef struct
 {
-    vlc_fourcc_t i_id;
-    uint32_t     i_flags;
-    off_t        i_pos;
+    uint32_t     i_pos_lo;
+    uint16_t     i_pos_hi;
+    uint16_t     i_flags;
     uint32_t     i_length;
-    int64_t      i_lengthtotal;
 
 } avi_entry_t;
 
+/* The cumulated length is only kept every AVI_INDEX_STEP entries */
+#define AVI_INDEX_STEP 64
+
 typedef struct
 {
     unsigned int    i_size;
     unsigned int    i_max;
     avi_entry_t     *p_entry;
 
+    int64_t         *p_total;   /* length of the entries before each step */
+    int64_t         i_total;    /* length of all the entries */
+
 } avi_index_t;
 static void avi_index_Init( avi_index_t * );
 static void avi_index_Clean( avi_index_t * );
-static void avi_index_Append( avi_index_t *, off_t *, avi_entry_t * );
+static void avi_index_Append( avi_index_t *, off_t *,
+                              off_t i_pos, uint32_t i_length, uint32_t i_flags );
+static int64_t avi_index_GetTotal( const avi_index_t *, unsigned int );
+static unsigned int avi_index_FindPos( const avi_index_t *, off_t );
+
+static inline off_t avi_index_GetPos( const avi_index_t *p_index,
+                                      unsigned int i )
+{
+    const avi_entry_t *p_entry = &p_index->p_entry[i];
+    return ((off_t)p_entry->i_pos_hi << 32) | p_entry->i_pos_lo;
+}
 
 typedef struct
 {
@@ -184,6 +203,15 @@ struct demux_sys_t
 
     unsigned int       i_attachment;
     input_attachment_t **attachment;
+
+    /* index created in the background */
+    bool         b_index_thread;
+    vlc_thread_t index_thread;
+    vlc_mutex_t  index_lock;
+    bool         b_index_abort;     /* protected by index_lock */
+    bool         b_index_done;      /* protected by index_lock */
+    avi_index_t  *p_index_new;      /* one per track */
+    off_t        i_index_new_lastchunk_pos;
 };
 
 static inline off_t __EVEN( off_t i )
@@ -206,13 +234,17 @@ static int AVI_StreamBytesSet ( demux_t *,
 vlc_fourcc_t AVI_FourccGetCodec( unsigned int i_cat, vlc_fourcc_t );
 static int   AVI_GetKeyFlag    ( vlc_fourcc_t , uint8_t * );
 
-static int AVI_PacketGetHeader( demux_t *, avi_packet_t *p_pk );
-static int AVI_PacketNext     ( demux_t * );
+static int AVI_PacketGetHeader( stream_t *, avi_packet_t *p_pk );
+static int AVI_PacketNext     ( stream_t * );
 static int AVI_PacketRead     ( demux_t *, avi_packet_t *, block_t **);
-static int AVI_PacketSearch   ( demux_t * );
+static int AVI_PacketSearch   ( demux_t *, stream_t * );
+static bool AVI_Stopped       ( demux_t * );
 
 static void AVI_IndexLoad    ( demux_t * );
 static void AVI_IndexCreate  ( demux_t * );
+static int  AVI_IndexStart   ( demux_t * );
+static void AVI_IndexStop    ( demux_t * );
+static void AVI_IndexUpdate  ( demux_t * );
 
 static void AVI_ExtractSubtitle( demux_t *, unsigned int i_stream, avi_chunk_list_t *, avi_chunk_STRING_t * );
 
@@ -283,6 +315,10 @@ static int Open( vlc_object_t * p_this )
     p_sys->track    = NULL;
     p_sys->meta     = NULL;
     TAB_INIT(p_sys->i_attachment, p_sys->attachment);
+    p_sys->b_index_thread = false;
+    p_sys->b_index_abort = false;
+    p_sys->p_index_new = NULL;
+    vlc_mutex_init( &p_sys->index_lock );
 
     stream_Control( p_demux->s, STREAM_CAN_FASTSEEK, &p_sys->b_seekable );
 
@@ -304,6 +340,7 @@ static int Open( vlc_object_t * p_this )
     if( AVI_ChunkReadRoot( p_demux->s, &p_sys->ck_root ) )
     {
         msg_Err( p_demux, "avi module discarded (invalid file)" );
+        vlc_mutex_destroy( &p_sys->index_lock );
         free(p_sys);
         return VLC_EGENERIC;
     }
@@ -666,7 +703,14 @@ aviindex:
 
         msg_Warn( p_demux, "broken or missing index, 'seek' will be "
                            "approximative or will exhibit strange behavior" );
-        if( i_do_index == 0 && !b_index )
+        if( i_do_index == 3 && !b_index && p_sys->b_seekable )
+        {
+            b_index = true;
+            if( AVI_IndexStart( p_demux ) )
+                goto aviindex;
+            p_sys->i_length = 0;
+        }
+        else if( i_do_index == 0 && !b_index )
         {
             if( !p_sys->b_seekable ) {
                 b_index = true;
@@ -718,9 +762,7 @@ aviindex:
         if( p_auds->p_wf->wFormatTag != WAVE_FORMAT_PCM &&
             (unsigned int)tk->i_rate == p_auds->p_wf->nSamplesPerSec )
         {
-            int64_t i_track_length =
-                tk->idx.p_entry[tk->idx.i_size-1].i_length +
-                tk->idx.p_entry[tk->idx.i_size-1].i_lengthtotal;
+            int64_t i_track_length = tk->idx.i_total;
             mtime_t i_length = (mtime_t)p_avih->i_totalframes *
                                (mtime_t)p_avih->i_microsecperframe;
 
@@ -754,6 +796,8 @@ error:
     if( p_sys->meta )
         vlc_meta_Delete( p_sys->meta );
 
+    AVI_IndexStop( p_demux );
+    vlc_mutex_destroy( &p_sys->index_lock );
     AVI_ChunkFreeRoot( p_demux->s, &p_sys->ck_root );
     free( p_sys );
     return vlc_object_alive( p_demux ) ? VLC_EGENERIC : VLC_ETIMEOUT;
@@ -768,6 +812,9 @@ static void Close ( vlc_object_t * p_this )
     unsigned int i;
     demux_sys_t *p_sys = p_demux->p_sys  ;
 
+    AVI_IndexStop( p_demux );
+    vlc_mutex_destroy( &p_sys->index_lock );
+
     for( i = 0; i < p_sys->i_track; i++ )
     {
         if( p_sys->track[i] )
@@ -815,6 +862,7 @@ static int Demux_Seekable( demux_t *p_demux )
     /* cannot be more than 100 stream (dcXX or wbXX) */
     avi_track_toread_t toread[100];
 
+    AVI_IndexUpdate( p_demux );
 
     /* detect new selected/unselected streams */
     for( i_track = 0; i_track < p_sys->i_track; i_track++ )
@@ -876,7 +924,7 @@ static int Demux_Seekable( demux_t *p_demux )
         toread[i_track].b_ok = tk->b_activated && !tk->b_eof;
         if( tk->i_idxposc < tk->idx.i_size )
         {
-            toread[i_track].i_posf = tk->idx.p_entry[tk->i_idxposc].i_pos;
+            toread[i_track].i_posf = avi_index_GetPos( &tk->idx, tk->i_idxposc );
            if( tk->i_idxposb > 0 )
            {
                 toread[i_track].i_posf += 8 + tk->i_idxposb;
@@ -957,7 +1005,7 @@ static int Demux_Seekable( demux_t *p_demux )
             if( p_sys->i_movi_lastchunk_pos >= p_sys->i_movi_begin + 12 )
             {
                 stream_Seek( p_demux->s, p_sys->i_movi_lastchunk_pos );
-                if( AVI_PacketNext( p_demux ) )
+                if( AVI_PacketNext( p_demux->s ) )
                 {
                     return( AVI_TrackStopFinishedStreams( p_demux ) ? 0 : 1 );
                 }
@@ -971,7 +1019,7 @@ static int Demux_Seekable( demux_t *p_demux )
             {
                 avi_packet_t avi_pk;
 
-                if( AVI_PacketGetHeader( p_demux, &avi_pk ) )
+                if( AVI_PacketGetHeader( p_demux->s, &avi_pk ) )
                 {
                     msg_Warn( p_demux,
                              "cannot get packet header, track disabled" );
@@ -980,7 +1028,7 @@ static int Demux_Seekable( demux_t *p_demux )
                 if( avi_pk.i_stream >= p_sys->i_track ||
                     ( avi_pk.i_cat != AUDIO_ES && avi_pk.i_cat != VIDEO_ES ) )
                 {
-                    if( AVI_PacketNext( p_demux ) )
+                    if( AVI_PacketNext( p_demux->s ) )
                     {
                         msg_Warn( p_demux,
                                   "cannot skip packet, track disabled" );
@@ -1007,12 +1055,9 @@ static int Demux_Seekable( demux_t *p_demux )
                     tk = p_sys->track[i_track];
 
                     /* add this chunk to the index */
-                    avi_entry_t index;
-                    index.i_id     = avi_pk.i_fourcc;
-                    index.i_flags  = AVI_GetKeyFlag(tk->i_codec, avi_pk.i_peek);
-                    index.i_pos    = avi_pk.i_pos;
-                    index.i_length = avi_pk.i_size;
-                    avi_index_Append( &tk->idx, &p_sys->i_movi_lastchunk_pos, &index );
+                    avi_index_Append( &tk->idx, &p_sys->i_movi_lastchunk_pos,
+                                      avi_pk.i_pos, avi_pk.i_size,
+                                      AVI_GetKeyFlag(tk->i_codec, avi_pk.i_peek) );
 
                     /* do we will read this data ? */
                     if( AVI_GetDPTS( tk, toread[i_track].i_toread ) > -25*1000 )
@@ -1021,7 +1066,7 @@ static int Demux_Seekable( demux_t *p_demux )
                     }
                     else
                     {
-                        if( AVI_PacketNext( p_demux ) )
+                        if( AVI_PacketNext( p_demux->s ) )
                         {
                             msg_Warn( p_demux,
                                       "cannot skip packet, track disabled" );
@@ -1129,7 +1174,7 @@ static int Demux_Seekable( demux_t *p_demux )
         if( tk->i_idxposc < tk->idx.i_size)
         {
             toread[i_track].i_posf =
-                tk->idx.p_entry[tk->i_idxposc].i_pos;
+                avi_index_GetPos( &tk->idx, tk->i_idxposc );
             if( tk->i_idxposb > 0 )
             {
                 toread[i_track].i_posf += 8 + tk->i_idxposb;
@@ -1211,7 +1256,7 @@ static int Demux_UnSeekable( demux_t *p_demux )
 
         avi_packet_t    avi_pk;
 
-        if( AVI_PacketGetHeader( p_demux, &avi_pk ) )
+        if( AVI_PacketGetHeader( p_demux->s, &avi_pk ) )
         {
             return( 0 );
         }
@@ -1228,17 +1273,17 @@ static int Demux_UnSeekable( demux_t *p_demux )
                 case AVIFOURCC_JUNK:
                 case AVIFOURCC_LIST:
                 case AVIFOURCC_RIFF:
-                    return( !AVI_PacketNext( p_demux ) ? 1 : 0 );
+                    return( !AVI_PacketNext( p_demux->s ) ? 1 : 0 );
                 case AVIFOURCC_idx1:
                     if( p_sys->b_odml )
                     {
-                        return( !AVI_PacketNext( p_demux ) ? 1 : 0 );
+                        return( !AVI_PacketNext( p_demux->s ) ? 1 : 0 );
                     }
                     return( 0 );    /* eof */
                 default:
                     msg_Warn( p_demux,
                               "seems to have lost position, resync" );
-                    if( AVI_PacketSearch( p_demux ) )
+                    if( AVI_PacketSearch( p_demux, p_demux->s ) )
                     {
                         msg_Err( p_demux, "resync failed" );
                         return( -1 );
@@ -1272,7 +1317,7 @@ static int Demux_UnSeekable( demux_t *p_demux )
             }
             else
             {
-                if( AVI_PacketNext( p_demux ) )
+                if( AVI_PacketNext( p_demux->s ) )
                 {
                     return( 0 );
                 }
@@ -1313,6 +1358,8 @@ static int Seek( demux_t *p_demux, mtime_t i_date, int i_percent )
     {
         unsigned i_stream;
 
+        AVI_IndexUpdate( p_demux );
+
         if( !p_sys->i_length )
         {
             avi_track_t *p_stream = NULL;
@@ -1356,7 +1403,16 @@ static int Seek( demux_t *p_demux, mtime_t i_date, int i_percent )
                 return VLC_EGENERIC;
             }
 
-            while( i_pos >= p_stream->idx.p_entry[p_stream->i_idxposc].i_pos +
+            /* start from the indexed chunk before i_pos */
+            unsigned int i_ck = avi_index_FindPos( &p_stream->idx, i_pos );
+            if( i_ck > 0 &&
+                AVI_StreamChunkSet( p_demux, i_stream, i_ck - 1 ) )
+            {
+                msg_Warn( p_demux, "cannot seek" );
+                return VLC_EGENERIC;
+            }
+
+            while( i_pos >= avi_index_GetPos( &p_stream->idx, p_stream->i_idxposc ) +
                p_stream->idx.p_entry[p_stream->i_idxposc].i_length + 8 )
             {
                 /* search after i_idxposc */
@@ -1418,7 +1474,7 @@ static double ControlGetPosition( demux_t *p_demux )
             avi_track_t *tk = p_sys->track[i];
             if( tk->b_activated && tk->i_idxposc < tk->idx.i_size )
             {
-                i_tmp = tk->idx.p_entry[tk->i_idxposc].i_pos +
+                i_tmp = avi_index_GetPos( &tk->idx, tk->i_idxposc ) +
                         tk->idx.p_entry[tk->i_idxposc].i_length + 8;
                 if( i_tmp > i64 )
                 {
@@ -1572,22 +1628,8 @@ static mtime_t AVI_GetPTS( avi_track_t *tk )
 {
     if( tk->i_samplesize )
     {
-        int64_t i_count = 0;
+        int64_t i_count = avi_index_GetTotal( &tk->idx, tk->i_idxposc );
 
-        /* we need a valid entry we will emulate one */
-        if( tk->i_idxposc == tk->idx.i_size )
-        {
-            if( tk->i_idxposc )
-            {
-                /* use the last entry */
-                i_count = tk->idx.p_entry[tk->idx.i_size - 1].i_lengthtotal
-                            + tk->idx.p_entry[tk->idx.i_size - 1].i_length;
-            }
-        }
-        else
-        {
-            i_count = tk->idx.p_entry[tk->i_idxposc].i_lengthtotal;
-        }
         return AVI_GetDPTS( tk, i_count + tk->i_idxposb );
     }
     else
@@ -1614,7 +1656,7 @@ static int AVI_StreamChunkFind( demux_t *p_demux, unsigned int i_stream )
     if( p_sys->i_movi_lastchunk_pos >= p_sys->i_movi_begin + 12 )
     {
         stream_Seek( p_demux->s, p_sys->i_movi_lastchunk_pos );
-        if( AVI_PacketNext( p_demux ) )
+        if( AVI_PacketNext( p_demux->s ) )
         {
             return VLC_EGENERIC;
         }
@@ -1628,7 +1670,7 @@ static int AVI_StreamChunkFind( demux_t *p_demux, unsigned int i_stream )
     {
         if( !vlc_object_alive (p_demux) ) return VLC_EGENERIC;
 
-        if( AVI_PacketGetHeader( p_demux, &avi_pk ) )
+        if( AVI_PacketGetHeader( p_demux->s, &avi_pk ) )
         {
             msg_Warn( p_demux, "cannot get packet header" );
             return VLC_EGENERIC;
@@ -1636,7 +1678,7 @@ static int AVI_StreamChunkFind( demux_t *p_demux, unsigned int i_stream )
         if( avi_pk.i_stream >= p_sys->i_track ||
             ( avi_pk.i_cat != AUDIO_ES && avi_pk.i_cat != VIDEO_ES ) )
         {
-            if( AVI_PacketNext( p_demux ) )
+            if( AVI_PacketNext( p_demux->s ) )
             {
                 return VLC_EGENERIC;
             }
@@ -1658,19 +1700,16 @@ static int AVI_StreamChunkFind( demux_t *p_demux, unsigned int i_stream )
             avi_track_t *tk_pk = p_sys->track[avi_pk.i_stream];
 
             /* add this chunk to the index */
-            avi_entry_t index;
-            index.i_id     = avi_pk.i_fourcc;
-            index.i_flags  = AVI_GetKeyFlag(tk_pk->i_codec, avi_pk.i_peek);
-            index.i_pos    = avi_pk.i_pos;
-            index.i_length = avi_pk.i_size;
-            avi_index_Append( &tk_pk->idx, &p_sys->i_movi_lastchunk_pos, &index );
+            avi_index_Append( &tk_pk->idx, &p_sys->i_movi_lastchunk_pos,
+                              avi_pk.i_pos, avi_pk.i_size,
+                              AVI_GetKeyFlag(tk_pk->i_codec, avi_pk.i_peek) );
 
             if( avi_pk.i_stream == i_stream  )
             {
                 return VLC_SUCCESS;
             }
 
-            if( AVI_PacketNext( p_demux ) )
+            if( AVI_PacketNext( p_demux->s ) )
             {
                 return VLC_EGENERIC;
             }
@@ -1713,40 +1752,31 @@ static int AVI_StreamBytesSet( demux_t    *p_demux,
     demux_sys_t *p_sys = p_demux->p_sys;
     avi_track_t *p_stream = p_sys->track[i_stream];
 
-    if( ( p_stream->idx.i_size > 0 )
-        &&( i_byte < p_stream->idx.p_entry[p_stream->idx.i_size - 1].i_lengthtotal +
-                p_stream->idx.p_entry[p_stream->idx.i_size - 1].i_length ) )
+    if( i_byte < p_stream->idx.i_total )
     {
         /* index is valid to find the ck */
-        /* uses dichototmie to be fast enougth */
-        int i_idxposc = __MIN( p_stream->i_idxposc, p_stream->idx.i_size - 1 );
-        int i_idxmax  = p_stream->idx.i_size;
-        int i_idxmin  = 0;
-        for( ;; )
-        {
-            if( p_stream->idx.p_entry[i_idxposc].i_lengthtotal > i_byte )
-            {
-                i_idxmax  = i_idxposc ;
-                i_idxposc = ( i_idxmin + i_idxposc ) / 2 ;
-            }
+        /* uses dichotomy on the steps, then walks the last one */
+        unsigned int i_min = 0;
+        unsigned int i_max = ( p_stream->idx.i_size - 1 ) / AVI_INDEX_STEP;
+        while( i_min < i_max )
+        {
+            unsigned int i_mid = ( i_min + i_max + 1 ) / 2;
+            if( p_stream->idx.p_total[i_mid] > i_byte )
+                i_max = i_mid - 1;
             else
-            {
-                if( p_stream->idx.p_entry[i_idxposc].i_lengthtotal +
-                        p_stream->idx.p_entry[i_idxposc].i_length <= i_byte)
-                {
-                    i_idxmin  = i_idxposc ;
-                    i_idxposc = (i_idxmax + i_idxposc ) / 2 ;
-                }
-                else
-                {
-                    p_stream->i_idxposc = i_idxposc;
-                    p_stream->i_idxposb = i_byte -
-                            p_stream->idx.p_entry[i_idxposc].i_lengthtotal;
-                    return VLC_SUCCESS;
-                }
-            }
+                i_min = i_mid;
         }
 
+        unsigned int i_idxposc = i_min * AVI_INDEX_STEP;
+        int64_t i_total = p_stream->idx.p_total[i_min];
+        while( i_total + p_stream->idx.p_entry[i_idxposc].i_length <= i_byte )
+        {
+            i_total += p_stream->idx.p_entry[i_idxposc].i_length;
+            i_idxposc++;
+        }
+        p_stream->i_idxposc = i_idxposc;
+        p_stream->i_idxposb = i_byte - i_total;
+        return VLC_SUCCESS;
     }
     else
     {
@@ -1760,11 +1790,11 @@ static int AVI_StreamBytesSet( demux_t    *p_demux,
                 return VLC_EGENERIC;
             }
 
-        } while( p_stream->idx.p_entry[p_stream->i_idxposc].i_lengthtotal +
-                    p_stream->idx.p_entry[p_stream->i_idxposc].i_length <= i_byte );
+        } while( p_stream->idx.i_total <= i_byte );
 
-        p_stream->i_idxposb = i_byte -
-                       p_stream->idx.p_entry[p_stream->i_idxposc].i_lengthtotal;
+        /* the chunk found is the last one of the index */
+        p_stream->i_idxposb = i_byte - ( p_stream->idx.i_total -
+                       p_stream->idx.p_entry[p_stream->i_idxposc].i_length );
         return VLC_SUCCESS;
     }
 }
@@ -1968,17 +1998,17 @@ static void AVI_ParseStreamHeader( vlc_fourcc_t i_id,
 /****************************************************************************
  *
  ****************************************************************************/
-static int AVI_PacketGetHeader( demux_t *p_demux, avi_packet_t *p_pk )
+static int AVI_PacketGetHeader( stream_t *s, avi_packet_t *p_pk )
 {
     const uint8_t *p_peek;
 
-    if( stream_Peek( p_demux->s, &p_peek, 16 ) < 16 )
+    if( stream_Peek( s, &p_peek, 16 ) < 16 )
     {
         return VLC_EGENERIC;
     }
     p_pk->i_fourcc  = VLC_FOURCC( p_peek[0], p_peek[1], p_peek[2], p_peek[3] );
     p_pk->i_size    = GetDWLE( p_peek + 4 );
-    p_pk->i_pos     = stream_Tell( p_demux->s );
+    p_pk->i_pos     = stream_Tell( s );
     if( p_pk->i_fourcc == AVIFOURCC_LIST || p_pk->i_fourcc == AVIFOURCC_RIFF )
     {
         p_pk->i_type = VLC_FOURCC( p_peek[8],  p_peek[9],
@@ -1995,12 +2025,12 @@ static int AVI_PacketGetHeader( demux_t *p_demux, avi_packet_t *p_pk )
     return VLC_SUCCESS;
 }
 
-static int AVI_PacketNext( demux_t *p_demux )
+static int AVI_PacketNext( stream_t *s )
 {
     avi_packet_t    avi_ck;
     int             i_skip = 0;
 
-    if( AVI_PacketGetHeader( p_demux, &avi_ck ) )
+    if( AVI_PacketGetHeader( s, &avi_ck ) )
     {
         return VLC_EGENERIC;
     }
@@ -2020,7 +2050,7 @@ static int AVI_PacketNext( demux_t *p_demux )
         i_skip = __EVEN( avi_ck.i_size ) + 8;
     }
 
-    if( stream_Read( p_demux->s, NULL, i_skip ) != i_skip )
+    if( stream_Read( s, NULL, i_skip ) != i_skip )
     {
         return VLC_EGENERIC;
     }
@@ -2050,7 +2080,7 @@ static int AVI_PacketRead( demux_t   *p_demux,
     return VLC_SUCCESS;
 }
 
-static int AVI_PacketSearch( demux_t *p_demux )
+static int AVI_PacketSearch( demux_t *p_demux, stream_t *s )
 {
     demux_sys_t     *p_sys = p_demux->p_sys;
     avi_packet_t    avi_pk;
@@ -2058,11 +2088,11 @@ static int AVI_PacketSearch( demux_t *p_demux )
 
     for( ;; )
     {
-        if( stream_Read( p_demux->s, NULL, 1 ) != 1 )
+        if( stream_Read( s, NULL, 1 ) != 1 )
         {
             return VLC_EGENERIC;
         }
-        AVI_PacketGetHeader( p_demux, &avi_pk );
+        AVI_PacketGetHeader( s, &avi_pk );
         if( avi_pk.i_stream < p_sys->i_track &&
             ( avi_pk.i_cat == AUDIO_ES || avi_pk.i_cat == VIDEO_ES ) )
         {
@@ -2083,7 +2113,7 @@ static int AVI_PacketSearch( demux_t *p_demux )
          * this code is called only on broken files). */
         if( !(++i_count % 1024) )
         {
-            if( !vlc_object_alive (p_demux) ) return VLC_EGENERIC;
+            if( AVI_Stopped( p_demux ) ) return VLC_EGENERIC;
 
             msleep( 10000 );
             if( !(i_count % (1024 * 10)) )
@@ -2100,40 +2130,83 @@ static void avi_index_Init( avi_index_t *p_index )
     p_index->i_size  = 0;
     p_index->i_max   = 0;
     p_index->p_entry = NULL;
+    p_index->p_total = NULL;
+    p_index->i_total = 0;
 }
 static void avi_index_Clean( avi_index_t *p_index )
 {
     free( p_index->p_entry );
+    free( p_index->p_total );
 }
 static void avi_index_Append( avi_index_t *p_index, off_t *pi_last_pos,
-                              avi_entry_t *p_entry )
+                              off_t i_pos, uint32_t i_length, uint32_t i_flags )
 {
+    if( i_pos < 0 || i_pos >= INT64_C(1) << 48 )
+        return;
+
     /* Update last chunk position */
-    if( *pi_last_pos < p_entry->i_pos )
-         *pi_last_pos = p_entry->i_pos;
+    if( *pi_last_pos < i_pos )
+         *pi_last_pos = i_pos;
 
     /* add the entry */
     if( p_index->i_size >= p_index->i_max )
     {
-        p_index->i_max += 16384;
-        p_index->p_entry = realloc_or_free( p_index->p_entry,
-                                            p_index->i_max * sizeof( *p_index->p_entry ) );
-        if( !p_index->p_entry )
+        const unsigned int i_max = p_index->i_max + 16384;
+        avi_entry_t *p_entry = realloc( p_index->p_entry,
+                                        i_max * sizeof( *p_entry ) );
+        if( !p_entry )
             return;
+        p_index->p_entry = p_entry;
+
+        int64_t *p_total = realloc( p_index->p_total,
+                                    i_max / AVI_INDEX_STEP * sizeof( *p_total ) );
+        if( !p_total )
+            return;
+        p_index->p_total = p_total;
+        p_index->i_max = i_max;
     }
-    /* calculate cumulate length */
-    if( p_index->i_size > 0 )
-    {
-        p_entry->i_lengthtotal =
-            p_index->p_entry[p_index->i_size - 1].i_length +
-                p_index->p_entry[p_index->i_size - 1].i_lengthtotal;
-    }
-    else
+
+    /* keep the cumulated length at each step */
+    if( p_index->i_size % AVI_INDEX_STEP == 0 )
+        p_index->p_total[p_index->i_size / AVI_INDEX_STEP] = p_index->i_total;
+    p_index->i_total += i_length;
+
+    avi_entry_t *p_entry = &p_index->p_entry[p_index->i_size++];
+    p_entry->i_pos_lo = i_pos & UINT32_MAX;
+    p_entry->i_pos_hi = i_pos >> 32;
+    p_entry->i_flags  = i_flags & UINT16_MAX;
+    p_entry->i_length = i_length;
+}
+
+/* Returns the length of the entries before i_entry */
+static int64_t avi_index_GetTotal( const avi_index_t *p_index,
+                                   unsigned int i_entry )
+{
+    if( i_entry >= p_index->i_size )
+        return p_index->i_total;
+
+    unsigned int i = i_entry - i_entry % AVI_INDEX_STEP;
+    int64_t i_total = p_index->p_total[i / AVI_INDEX_STEP];
+    for( ; i < i_entry; i++ )
+        i_total += p_index->p_entry[i].i_length;
+    return i_total;
+}
+
+/* Returns the first entry at or after i_pos (the chunks of a stream are
+ * stored in order in the file) */
+static unsigned int avi_index_FindPos( const avi_index_t *p_index, off_t i_pos )
+{
+    unsigned int i_low = 0, i_high = p_index->i_size;
+
+    while( i_low < i_high )
     {
-        p_entry->i_lengthtotal = 0;
+        unsigned int i_mid = i_low + (i_high - i_low) / 2;
+        if( avi_index_GetPos( p_index, i_mid ) < i_pos )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
     }
-
-    p_index->p_entry[p_index->i_size++] = *p_entry;
+    return i_low;
 }
 
 static int AVI_IndexFind_idx1( demux_t *p_demux,
@@ -2206,13 +2279,10 @@ static int AVI_IndexLoad_idx1( demux_t *p_demux,
         if( i_stream < p_sys->i_track &&
             (i_cat == p_sys->track[i_stream]->i_cat || i_cat == UNKNOWN_ES ) )
         {
-            avi_entry_t index;
-            index.i_id     = p_idx1->entry[i_index].i_fourcc;
-            index.i_flags  = p_idx1->entry[i_index].i_flags&(~AVIIF_FIXKEYFRAME);
-            index.i_pos    = p_idx1->entry[i_index].i_pos + i_offset;
-            index.i_length = p_idx1->entry[i_index].i_length;
-
-            avi_index_Append( &p_index[i_stream], pi_last_offset, &index );
+            avi_index_Append( &p_index[i_stream], pi_last_offset,
+                              p_idx1->entry[i_index].i_pos + i_offset,
+                              p_idx1->entry[i_index].i_length,
+                              p_idx1->entry[i_index].i_flags&(~AVIIF_FIXKEYFRAME) );
         }
     }
     return VLC_SUCCESS;
@@ -2221,31 +2291,25 @@ static int AVI_IndexLoad_idx1( demux_t *p_demux,
 static void __Parse_indx( demux_t *p_demux, avi_index_t *p_index, off_t *pi_max_offset,
                           avi_chunk_indx_t *p_indx )
 {
-    avi_entry_t index;
-
     msg_Dbg( p_demux, "loading subindex(0x%x) %d entries", p_indx->i_indextype, p_indx->i_entriesinuse );
     if( p_indx->i_indexsubtype == 0 )
     {
         for( unsigned i = 0; i < p_indx->i_entriesinuse; i++ )
         {
-            index.i_id     = p_indx->i_id;
-            index.i_flags  = p_indx->idx.std[i].i_size & 0x80000000 ? 0 : AVIIF_KEYFRAME;
-            index.i_pos    = p_indx->i_baseoffset + p_indx->idx.std[i].i_offset - 8;
-            index.i_length = p_indx->idx.std[i].i_size&0x7fffffff;
-
-            avi_index_Append( p_index, pi_max_offset, &index );
+            avi_index_Append( p_index, pi_max_offset,
+                              p_indx->i_baseoffset + p_indx->idx.std[i].i_offset - 8,
+                              p_indx->idx.std[i].i_size&0x7fffffff,
+                              p_indx->idx.std[i].i_size & 0x80000000 ? 0 : AVIIF_KEYFRAME );
         }
     }
     else if( p_indx->i_indexsubtype == AVI_INDEX_2FIELD )
     {
         for( unsigned i = 0; i < p_indx->i_entriesinuse; i++ )
         {
-            index.i_id     = p_indx->i_id;
-            index.i_flags  = p_indx->idx.field[i].i_size & 0x80000000 ? 0 : AVIIF_KEYFRAME;
-            index.i_pos    = p_indx->i_baseoffset + p_indx->idx.field[i].i_offset - 8;
-            index.i_length = p_indx->idx.field[i].i_size;
-
-            avi_index_Append( p_index, pi_max_offset, &index );
+            avi_index_Append( p_index, pi_max_offset,
+                              p_indx->i_baseoffset + p_indx->idx.field[i].i_offset - 8,
+                              p_indx->idx.field[i].i_size,
+                              p_indx->idx.field[i].i_size & 0x80000000 ? 0 : AVIIF_KEYFRAME );
         }
     }
     else
@@ -2368,49 +2432,40 @@ static void AVI_IndexLoad( demux_t *p_demux )
     }
 }
 
-static void AVI_IndexCreate( demux_t *p_demux )
+/* Tells if the demuxer is being closed or killed */
+static bool AVI_Stopped( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
 
-    avi_chunk_list_t *p_riff;
-    avi_chunk_list_t *p_movi;
-
-    unsigned int i_stream;
-    off_t i_movi_end;
-
-    mtime_t i_dialog_update;
-    dialog_progress_bar_t *p_dialog = NULL;
+    vlc_mutex_lock( &p_sys->index_lock );
+    bool b_abort = p_sys->b_index_abort;
+    vlc_mutex_unlock( &p_sys->index_lock );
 
-    p_riff = AVI_ChunkFind( &p_sys->ck_root, AVIFOURCC_RIFF, 0);
-    p_movi = AVI_ChunkFind( p_riff, AVIFOURCC_movi, 0);
+    return b_abort || !vlc_object_alive( p_demux );
+}
 
-    if( !p_movi )
-    {
-        msg_Err( p_demux, "cannot find p_movi" );
-        return;
-    }
+/* Creates the indexes of the tracks from the LIST-movi, read from s */
+static void AVI_IndexScan( demux_t *p_demux, stream_t *s,
+                           avi_chunk_list_t *p_movi,
+                           avi_index_t p_index[], off_t *pi_last_pos,
+                           dialog_progress_bar_t *p_dialog )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
 
-    for( i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
-        avi_index_Init( &p_sys->track[i_stream]->idx );
+    off_t i_movi_end;
+    mtime_t i_dialog_update;
 
     i_movi_end = __MIN( (off_t)(p_movi->i_chunk_pos + p_movi->i_chunk_size),
-                        stream_Size( p_demux->s ) );
-
-    stream_Seek( p_demux->s, p_movi->i_chunk_pos + 12 );
-    msg_Warn( p_demux, "creating index from LIST-movi, will take time !" );
+                        stream_Size( s ) );
 
+    stream_Seek( s, p_movi->i_chunk_pos + 12 );
 
-    /* Only show dialog if AVI is > 10MB */
     i_dialog_update = mdate();
-    if( stream_Size( p_demux->s ) > 10000000 )
-        p_dialog = dialog_ProgressCreate( p_demux, _("Fixing AVI Index..."),
-                                       NULL, _("Cancel") );
-
     for( ;; )
     {
         avi_packet_t pk;
 
-        if( !vlc_object_alive (p_demux) )
+        if( AVI_Stopped( p_demux ) )
             break;
 
         /* Don't update/check dialog too often */
@@ -2419,15 +2474,15 @@ static void AVI_IndexCreate( demux_t *p_demux )
             if( dialog_ProgressCancelled( p_dialog ) )
                 break;
 
-            double f_current = stream_Tell( p_demux->s );
-            double f_size    = stream_Size( p_demux->s );
+            double f_current = stream_Tell( s );
+            double f_size    = stream_Size( s );
             double f_pos     = f_current / f_size;
             dialog_ProgressSet( p_dialog, NULL, f_pos );
 
             i_dialog_update = mdate();
         }
 
-        if( AVI_PacketGetHeader( p_demux, &pk ) )
+        if( AVI_PacketGetHeader( s, &pk ) )
             break;
 
         if( pk.i_stream < p_sys->i_track &&
@@ -2435,12 +2490,9 @@ static void AVI_IndexCreate( demux_t *p_demux )
         {
             avi_track_t *tk = p_sys->track[pk.i_stream];
 
-            avi_entry_t index;
-            index.i_id      = pk.i_fourcc;
-            index.i_flags   = AVI_GetKeyFlag(tk->i_codec, pk.i_peek);
-            index.i_pos     = pk.i_pos;
-            index.i_length  = pk.i_size;
-            avi_index_Append( &tk->idx, &p_sys->i_movi_lastchunk_pos, &index );
+            avi_index_Append( &p_index[pk.i_stream], pi_last_pos,
+                              pk.i_pos, pk.i_size,
+                              AVI_GetKeyFlag(tk->i_codec, pk.i_peek) );
         }
         else
         {
@@ -2454,11 +2506,11 @@ static void AVI_IndexCreate( demux_t *p_demux )
                                             AVIFOURCC_RIFF, 1 );
 
                     msg_Dbg( p_demux, "looking for new RIFF chunk" );
-                    if( stream_Seek( p_demux->s, p_sysx->i_chunk_pos + 24 ) )
-                        goto print_stat;
+                    if( stream_Seek( s, p_sysx->i_chunk_pos + 24 ) )
+                        return;
                     break;
                 }
-                goto print_stat;
+                return;
 
             case AVIFOURCC_RIFF:
                     msg_Dbg( p_demux, "new RIFF chunk found" );
@@ -2470,32 +2522,199 @@ static void AVI_IndexCreate( demux_t *p_demux )
 
             default:
                 msg_Warn( p_demux, "need resync, probably broken avi" );
-                if( AVI_PacketSearch( p_demux ) )
+                if( AVI_PacketSearch( p_demux, s ) )
                 {
                     msg_Warn( p_demux, "lost sync, abord index creation" );
-                    goto print_stat;
+                    return;
                 }
             }
         }
 
         if( ( !p_sys->b_odml && pk.i_pos + pk.i_size >= i_movi_end ) ||
-            AVI_PacketNext( p_demux ) )
+            AVI_PacketNext( s ) )
         {
             break;
         }
     }
+}
+
+static void AVI_IndexCreate( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    avi_chunk_list_t *p_riff;
+    avi_chunk_list_t *p_movi;
+
+    unsigned int i_stream;
+
+    dialog_progress_bar_t *p_dialog = NULL;
+
+    p_riff = AVI_ChunkFind( &p_sys->ck_root, AVIFOURCC_RIFF, 0);
+    p_movi = AVI_ChunkFind( p_riff, AVIFOURCC_movi, 0);
+
+    if( !p_movi )
+    {
+        msg_Err( p_demux, "cannot find p_movi" );
+        return;
+    }
+
+    msg_Warn( p_demux, "creating index from LIST-movi, will take time !" );
+
+    /* Only show dialog if AVI is > 10MB */
+    if( stream_Size( p_demux->s ) > 10000000 )
+        p_dialog = dialog_ProgressCreate( p_demux, _("Fixing AVI Index..."),
+                                       NULL, _("Cancel") );
+
+    assert( p_sys->i_track <= 100 );
+    avi_index_t p_index[p_sys->i_track];
+    for( i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
+        avi_index_Init( &p_index[i_stream] );
+
+    AVI_IndexScan( p_demux, p_demux->s, p_movi,
+                   p_index, &p_sys->i_movi_lastchunk_pos, p_dialog );
 
-print_stat:
     if( p_dialog != NULL )
         dialog_ProgressDestroy( p_dialog );
 
     for( i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
     {
+        avi_index_Clean( &p_sys->track[i_stream]->idx );
+        p_sys->track[i_stream]->idx = p_index[i_stream];
         msg_Dbg( p_demux, "stream[%d] creating %d index entries",
                 i_stream, p_sys->track[i_stream]->idx.i_size );
     }
 }
 
+static void *AVI_IndexThread( void *data )
+{
+    demux_t     *p_demux = data;
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    avi_chunk_list_t *p_riff = AVI_ChunkFind( &p_sys->ck_root, AVIFOURCC_RIFF, 0);
+    avi_chunk_list_t *p_movi = AVI_ChunkFind( p_riff, AVIFOURCC_movi, 0);
+
+    char *psz_url = make_URI( p_demux->psz_file, "file" );
+    stream_t *s = psz_url ? stream_UrlNew( p_demux, psz_url ) : NULL;
+    free( psz_url );
+    if( s )
+    {
+        AVI_IndexScan( p_demux, s, p_movi, p_sys->p_index_new,
+                       &p_sys->i_index_new_lastchunk_pos, NULL );
+        stream_Delete( s );
+    }
+
+    vlc_mutex_lock( &p_sys->index_lock );
+    p_sys->b_index_done = true;
+    vlc_mutex_unlock( &p_sys->index_lock );
+    return NULL;
+}
+
+/* Creates the index from a second stream, while the playback starts from
+ * an empty index completed with the chunks met along the way */
+static int AVI_IndexStart( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_demux->b_preparsing || !p_demux->psz_file )
+        return VLC_EGENERIC;
+
+    p_sys->p_index_new = malloc( p_sys->i_track * sizeof( *p_sys->p_index_new ) );
+    if( !p_sys->p_index_new )
+        return VLC_ENOMEM;
+
+    /* The loaded index cannot be trusted */
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+    {
+        avi_index_Clean( &p_sys->track[i]->idx );
+        avi_index_Init( &p_sys->track[i]->idx );
+        avi_index_Init( &p_sys->p_index_new[i] );
+    }
+    p_sys->i_movi_lastchunk_pos = 0;
+    p_sys->i_index_new_lastchunk_pos = 0;
+    p_sys->b_index_done = false;
+
+    if( vlc_clone( &p_sys->index_thread, AVI_IndexThread, p_demux,
+                   VLC_THREAD_PRIORITY_LOW ) )
+    {
+        free( p_sys->p_index_new );
+        p_sys->p_index_new = NULL;
+        return VLC_EGENERIC;
+    }
+    p_sys->b_index_thread = true;
+    msg_Dbg( p_demux, "creating index in the background" );
+    return VLC_SUCCESS;
+}
+
+static void AVI_IndexStop( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( !p_sys->b_index_thread )
+        return;
+
+    vlc_mutex_lock( &p_sys->index_lock );
+    p_sys->b_index_abort = true;
+    vlc_mutex_unlock( &p_sys->index_lock );
+
+    vlc_join( p_sys->index_thread, NULL );
+    p_sys->b_index_thread = false;
+
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+        avi_index_Clean( &p_sys->p_index_new[i] );
+    free( p_sys->p_index_new );
+    p_sys->p_index_new = NULL;
+}
+
+/* Switches to the index created in the background once it is complete */
+static void AVI_IndexUpdate( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( !p_sys->b_index_thread )
+        return;
+
+    vlc_mutex_lock( &p_sys->index_lock );
+    bool b_done = p_sys->b_index_done;
+    vlc_mutex_unlock( &p_sys->index_lock );
+    if( !b_done )
+        return;
+
+    vlc_join( p_sys->index_thread, NULL );
+    p_sys->b_index_thread = false;
+
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+    {
+        avi_track_t *tk = p_sys->track[i];
+        avi_index_t *p_index = &p_sys->p_index_new[i];
+
+        /* The scan may have stopped early on a broken file */
+        if( p_index->i_size <= tk->idx.i_size )
+        {
+            avi_index_Clean( p_index );
+            continue;
+        }
+
+        /* Keep on reading the same chunk */
+        if( tk->i_idxposc < tk->idx.i_size )
+            tk->i_idxposc = avi_index_FindPos( p_index,
+                                avi_index_GetPos( &tk->idx, tk->i_idxposc ) );
+        else if( tk->idx.i_size > 0 )
+            tk->i_idxposc = avi_index_FindPos( p_index,
+                                avi_index_GetPos( &tk->idx, tk->idx.i_size - 1 ) + 1 );
+
+        avi_index_Clean( &tk->idx );
+        tk->idx = *p_index;
+        msg_Dbg( p_demux, "stream[%u] created %u index entries in the background",
+                 i, tk->idx.i_size );
+    }
+    free( p_sys->p_index_new );
+    p_sys->p_index_new = NULL;
+
+    p_sys->i_movi_lastchunk_pos = __MAX( p_sys->i_movi_lastchunk_pos,
+                                         p_sys->i_index_new_lastchunk_pos );
+    p_sys->i_length = AVI_MovieGetLength( p_demux );
+}
+
 /* */
 static void AVI_MetaLoad( demux_t *p_demux,
                           avi_chunk_list_t *p_riff, avi_chunk_avih_t *p_avih )
@@ -2722,9 +2941,7 @@ static mtime_t  AVI_MovieGetLength( demux_t *p_demux )
 
         if( tk->i_samplesize )
         {
-            i_length = AVI_GetDPTS( tk,
-                                    tk->idx.p_entry[tk->idx.i_size-1].i_lengthtotal +
-                                        tk->idx.p_entry[tk->idx.i_size-1].i_length );
+            i_length = AVI_GetDPTS( tk, tk->idx.i_total );
         }
         else
         {
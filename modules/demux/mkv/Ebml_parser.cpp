@@ -208,3 +208,144 @@ bool EbmlParser::IsTopPresent( EbmlElement *el ) const
     return false;
 }
 
+
+/*****************************************************************************
+ * Raw EBML reading
+ *****************************************************************************/
+#define EBML_RAW_ID_CLUSTER      0x1F43B675
+#define EBML_RAW_ID_TIMECODE     0xE7
+
+/* Reads a variable size integer, keeping the length marker for IDs */
+static bool RawReadVarInt( IOCallback & io, int i_max, bool b_marker,
+                           uint64_t *pi_value, int *pi_length )
+{
+    uint8_t p_buf[8];
+
+    if( io.read( p_buf, 1 ) != 1 )
+        return false;
+
+    int i_length = 1;
+    while( i_length <= i_max && !( p_buf[0] & ( 0x80 >> ( i_length - 1 ) ) ) )
+        i_length++;
+    if( i_length > i_max ||
+        ( i_length > 1 && io.read( &p_buf[1], i_length - 1 ) != (uint32)( i_length - 1 ) ) )
+        return false;
+
+    uint64_t i_value = b_marker ? p_buf[0] : p_buf[0] & ( 0xFF >> i_length );
+    for( int i = 1; i < i_length; i++ )
+        i_value = ( i_value << 8 ) | p_buf[i];
+
+    *pi_value = i_value;
+    *pi_length = i_length;
+    return true;
+}
+
+bool EbmlRawReadHeader( IOCallback & io, uint32_t *pi_id, uint64_t *pi_size )
+{
+    uint64_t i_id, i_size;
+    int i_length;
+
+    if( !RawReadVarInt( io, 4, true, &i_id, &i_length ) ||
+        !RawReadVarInt( io, 8, false, &i_size, &i_length ) )
+        return false;
+
+    /* all the bits set mean an unknown size */
+    if( i_size == ( UINT64_C(1) << ( 7 * i_length ) ) - 1 )
+        i_size = EBML_RAW_UNKNOWN_SIZE;
+
+    *pi_id = i_id;
+    *pi_size = i_size;
+    return true;
+}
+
+/* The elements that end a cluster of unknown size */
+static bool RawIsTopLevel( uint32_t i_id )
+{
+    switch( i_id )
+    {
+        case EBML_RAW_ID_CLUSTER:
+        case 0x1C53BB6B: /* Cues */
+        case 0x114D9B74: /* SeekHead */
+        case 0x1549A966: /* Info */
+        case 0x1654AE6B: /* Tracks */
+        case 0x1043A770: /* Chapters */
+        case 0x1254C367: /* Tags */
+        case 0x1941A469: /* Attachments */
+        case 0x18538067: /* Segment */
+        case 0x1A45DFA3: /* EBML header */
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool EbmlRawFindCluster( IOCallback & io, int64_t *pi_position,
+                         uint64_t *pi_timecode )
+{
+    uint32_t i_id;
+    uint64_t i_size;
+
+    for( ;; )
+    {
+        int64_t i_position = io.getFilePointer();
+
+        if( !EbmlRawReadHeader( io, &i_id, &i_size ) )
+            return false;
+        if( i_id != EBML_RAW_ID_CLUSTER )
+        {
+            if( i_size == EBML_RAW_UNKNOWN_SIZE )
+                return false;
+            io.setFilePointer( i_size, seek_current );
+            continue;
+        }
+
+        /* go through the children headers: the timecode comes first, the
+         * blocks are skipped */
+        uint64_t i_end = i_size == EBML_RAW_UNKNOWN_SIZE ? UINT64_MAX :
+                         io.getFilePointer() + i_size;
+        bool b_timecode = false;
+
+        while( io.getFilePointer() < i_end )
+        {
+            uint64_t i_child_position = io.getFilePointer();
+            uint32_t i_child;
+            uint64_t i_child_size;
+
+            if( !EbmlRawReadHeader( io, &i_child, &i_child_size ) )
+                return b_timecode;
+            if( RawIsTopLevel( i_child ) )
+            {
+                io.setFilePointer( i_child_position, seek_beginning );
+                break;
+            }
+            if( i_child_size == EBML_RAW_UNKNOWN_SIZE )
+                return false;
+
+            if( i_child == EBML_RAW_ID_TIMECODE && !b_timecode &&
+                i_child_size <= 8 )
+            {
+                uint8_t p_buf[8];
+                uint64_t i_timecode = 0;
+
+                if( io.read( p_buf, i_child_size ) != i_child_size )
+                    return false;
+                for( uint64_t i = 0; i < i_child_size; i++ )
+                    i_timecode = ( i_timecode << 8 ) | p_buf[i];
+                *pi_timecode = i_timecode;
+                b_timecode = true;
+
+                /* the end of a sized cluster is known */
+                if( i_end != UINT64_MAX )
+                    io.setFilePointer( i_end, seek_beginning );
+            }
+            else
+                io.setFilePointer( i_child_size, seek_current );
+        }
+
+        if( b_timecode )
+        {
+            *pi_position = i_position;
+            return true;
+        }
+    }
+}
@@ -61,6 +61,21 @@ class EbmlParser
     bool        mb_dummy;
 };
 
+/*****************************************************************************
+ * Raw EBML reading, for the paths that only skip elements: nothing is
+ * created through the libebml element factory
+ *****************************************************************************/
+#define EBML_RAW_UNKNOWN_SIZE UINT64_MAX
+
+/* Reads the ID and the data size of the element at the current position */
+bool EbmlRawReadHeader( IOCallback &, uint32_t *pi_id, uint64_t *pi_size );
+
+/* Finds the next cluster from the current position, which must be at the
+ * top level of the segment. Returns its position and its timecode (in the
+ * segment timescale), leaving the stream after it. */
+bool EbmlRawFindCluster( IOCallback &, int64_t *pi_position,
+                         uint64_t *pi_timecode );
+
 /* This class works around a bug in KaxBlockVirtual implementation */
 class KaxBlockVirtualWorkaround : public KaxBlockVirtual
 {
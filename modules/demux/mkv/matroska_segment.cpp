@@ -30,11 +30,14 @@
 
 #include "Ebml_parser.hpp"
 
+#include "stream_io_callback.hpp"
+
 extern "C" {
 #include "../vobsub.h"
 }
 
 #include <vlc_codecs.h>
+#include <vlc_url.h>
 
 /* GetFourCC helper */
 #define GetFOURCC( p )  __GetFOURCC( (uint8_t*)p )
@@ -65,8 +68,6 @@ matroska_segment_c::matroska_segment_c( demux_sys_t & demuxer, EbmlStream & estr
     ,p_prev_segment_uid(NULL)
     ,p_next_segment_uid(NULL)
     ,b_cues(false)
-    ,i_index(0)
-    ,i_index_max(1024)
     ,psz_muxing_application(NULL)
     ,psz_writing_application(NULL)
     ,psz_segment_filename(NULL)
@@ -77,12 +78,16 @@ matroska_segment_c::matroska_segment_c( demux_sys_t & demuxer, EbmlStream & estr
     ,ep(NULL)
     ,b_preloaded(false)
     ,b_ref_external_segments(false)
+    ,b_scan_running(false)
+    ,b_scan_abort(false)
 {
-    p_indexes = (mkv_index_t*)malloc( sizeof( mkv_index_t ) * i_index_max );
+    vlc_mutex_init( &index_lock );
 }
 
 matroska_segment_c::~matroska_segment_c()
 {
+    IndexScanStop();
+
     for( size_t i_track = 0; i_track < tracks.size(); i_track++ )
     {
         delete tracks[i_track]->p_compression_data;
@@ -97,7 +102,7 @@ matroska_segment_c::~matroska_segment_c()
     free( psz_segment_filename );
     free( psz_title );
     free( psz_date_utc );
-    free( p_indexes );
+    vlc_mutex_destroy( &index_lock );
 
     delete ep;
     delete segment;
@@ -134,13 +139,8 @@ void matroska_segment_c::LoadCues( KaxCues *cues )
     {
         if( MKV_IS_ID( el, KaxCuePoint ) )
         {
-#define idx p_indexes[i_index]
-
-            idx.i_track       = -1;
-            idx.i_block_number= -1;
-            idx.i_position    = -1;
-            idx.i_time        = 0;
-            idx.b_key         = true;
+            mtime_t i_time = 0;
+            int64_t i_position = -1;
 
             ep->Down();
             while( ( el = ep->Get() ) != NULL )
@@ -151,35 +151,26 @@ void matroska_segment_c::LoadCues( KaxCues *cues )
 
                     ctime.ReadData( es.I_O() );
 
-                    idx.i_time = uint64( ctime ) * i_timescale / (mtime_t)1000;
+                    i_time = uint64( ctime ) * i_timescale / (mtime_t)1000;
                 }
                 else if( MKV_IS_ID( el, KaxCueTrackPositions ) )
                 {
                     ep->Down();
                     while( ( el = ep->Get() ) != NULL )
                     {
-                        if( MKV_IS_ID( el, KaxCueTrack ) )
-                        {
-                            KaxCueTrack &ctrack = *(KaxCueTrack*)el;
-
-                            ctrack.ReadData( es.I_O() );
-                            idx.i_track = uint16( ctrack );
-                        }
-                        else if( MKV_IS_ID( el, KaxCueClusterPosition ) )
+                        if( MKV_IS_ID( el, KaxCueClusterPosition ) )
                         {
                             KaxCueClusterPosition &ccpos = *(KaxCueClusterPosition*)el;
 
                             ccpos.ReadData( es.I_O() );
-                            idx.i_position = segment->GetGlobalPosition( uint64( ccpos ) );
+                            /* all the tracks of the cue point are in the
+                             * cluster seen first */
+                            int64_t i_pos = segment->GetGlobalPosition( uint64( ccpos ) );
+                            if( i_position < 0 || i_pos < i_position )
+                                i_position = i_pos;
                         }
-                        else if( MKV_IS_ID( el, KaxCueBlockNumber ) )
-                        {
-                            KaxCueBlockNumber &cbnum = *(KaxCueBlockNumber*)el;
-
-                            cbnum.ReadData( es.I_O() );
-                            idx.i_block_number = uint32( cbnum );
-                        }
-                        else
+                        else if( !MKV_IS_ID( el, KaxCueTrack ) &&
+                                 !MKV_IS_ID( el, KaxCueBlockNumber ) )
                         {
                             msg_Dbg( &sys.demuxer, "         * Unknown (%s)", typeid(*el).name() );
                         }
@@ -194,19 +185,11 @@ void matroska_segment_c::LoadCues( KaxCues *cues )
             ep->Up();
 
 #if 0
-            msg_Dbg( &sys.demuxer, " * added time=%"PRId64" pos=%"PRId64
-                     " track=%d bnum=%d", idx.i_time, idx.i_position,
-                     idx.i_track, idx.i_block_number );
+            msg_Dbg( &sys.demuxer, " * added time=%"PRId64" pos=%"PRId64,
+                     i_time, i_position );
 #endif
-
-            i_index++;
-            if( i_index >= i_index_max )
-            {
-                i_index_max += 1024;
-                p_indexes = (mkv_index_t*)xrealloc( p_indexes,
-                                        sizeof( mkv_index_t ) * i_index_max );
-            }
-#undef idx
+            if( i_position >= 0 )
+                IndexAdd( i_time, i_position );
         }
         else
         {
@@ -218,6 +201,19 @@ void matroska_segment_c::LoadCues( KaxCues *cues )
     msg_Dbg( &sys.demuxer, "|   - loading cues done." );
 }
 
+/* Loads the cues found while preloading, which are only needed to seek */
+bool matroska_segment_c::LoadPendingCues()
+{
+    if( !b_cues && i_cues_position >= 0 &&
+        !LoadSeekHeadItem( EBML_INFO(KaxCues), i_cues_position ) )
+    {
+        /* index the clusters instead */
+        i_cues_position = -1;
+        IndexScanStart();
+    }
+    return b_cues;
+}
+
 
 #define PARSE_TAG( type ) \
     do { \
@@ -423,23 +419,116 @@ void matroska_segment_c::InformationCreate( )
  * Misc
  *****************************************************************************/
 
-void matroska_segment_c::IndexAppendCluster( KaxCluster *cluster )
+static bool IndexCompare( mtime_t i_time, const mkv_index_t &index )
+{
+    return i_time < index.i_time;
+}
+
+/* Inserts a seek point, unless it is known already or does not fit between
+ * its neighbours */
+void matroska_segment_c::IndexAdd( mtime_t i_time, int64_t i_position )
+{
+    vlc_mutex_locker l( &index_lock );
+
+    std::vector<mkv_index_t>::iterator it =
+        std::upper_bound( indexes.begin(), indexes.end(), i_time, IndexCompare );
+
+    if( it != indexes.begin() && (it - 1)->i_position >= i_position )
+        return;
+    if( it != indexes.end() && it->i_position <= i_position )
+        return;
+
+    mkv_index_t index;
+    index.i_time     = i_time;
+    index.i_position = i_position;
+    indexes.insert( it, index );
+}
+
+/* Gets the last seek point at or before i_time, or the first one */
+bool matroska_segment_c::IndexFind( mtime_t i_time, mkv_index_t *p_index )
 {
-#define idx p_indexes[i_index]
-    idx.i_track       = -1;
-    idx.i_block_number= -1;
-    idx.i_position    = cluster->GetElementPosition();
-    idx.i_time        = cluster->GlobalTimecode()/ (mtime_t) 1000;
-    idx.b_key         = true;
-
-    i_index++;
-    if( i_index >= i_index_max )
+    vlc_mutex_locker l( &index_lock );
+
+    if( indexes.empty() )
+        return false;
+
+    std::vector<mkv_index_t>::iterator it =
+        std::upper_bound( indexes.begin(), indexes.end(), i_time, IndexCompare );
+    if( it != indexes.begin() )
+        it--;
+    *p_index = *it;
+    return true;
+}
+
+bool matroska_segment_c::IndexLast( mkv_index_t *p_index )
+{
+    vlc_mutex_locker l( &index_lock );
+
+    if( indexes.empty() )
+        return false;
+    *p_index = indexes.back();
+    return true;
+}
+
+void *matroska_segment_c::IndexScanThread( void *data )
+{
+    static_cast<matroska_segment_c *>( data )->IndexScan();
+    return NULL;
+}
+
+/* Builds the index of a file without cues from a second stream, so that
+ * neither the playback start nor the first seeks wait for it */
+void matroska_segment_c::IndexScanStart()
+{
+    if( b_scan_running || sys.demuxer.b_preparsing || !sys.demuxer.psz_file ||
+        sys.streams.empty() || &es != sys.streams[0]->p_estream )
+        return;
+
+    b_scan_abort = false;
+    b_scan_running = !vlc_clone( &scan_thread, IndexScanThread, this,
+                                 VLC_THREAD_PRIORITY_LOW );
+}
+
+void matroska_segment_c::IndexScanStop()
+{
+    if( !b_scan_running )
+        return;
+
+    vlc_mutex_lock( &index_lock );
+    b_scan_abort = true;
+    vlc_mutex_unlock( &index_lock );
+
+    vlc_join( scan_thread, NULL );
+    b_scan_running = false;
+}
+
+void matroska_segment_c::IndexScan()
+{
+    char *psz_url = make_URI( sys.demuxer.psz_file, "file" );
+    stream_t *p_stream = psz_url ? stream_UrlNew( &sys.demuxer, psz_url ) : NULL;
+    free( psz_url );
+    if( !p_stream )
+        return;
+
+    vlc_stream_io_callback io( p_stream, true );
+    io.setFilePointer( i_start_pos, seek_beginning );
+
+    int64_t i_position;
+    uint64_t i_timecode;
+    int i_count = 0;
+
+    while( EbmlRawFindCluster( io, &i_position, &i_timecode ) )
     {
-        i_index_max += 1024;
-        p_indexes = (mkv_index_t*)xrealloc( p_indexes,
-                                        sizeof( mkv_index_t ) * i_index_max );
+        vlc_mutex_lock( &index_lock );
+        bool b_abort = b_scan_abort;
+        vlc_mutex_unlock( &index_lock );
+        if( b_abort )
+            return;
+
+        IndexAdd( i_timecode * i_timescale / (mtime_t)1000, i_position );
+        i_count++;
     }
-#undef idx
+    msg_Dbg( &sys.demuxer, "indexed %d clusters in the background", i_count );
 }
 
 bool matroska_segment_c::PreloadFamily( const matroska_segment_c & of_segment )
@@ -532,9 +621,9 @@ bool matroska_segment_c::Preload( )
         else if( MKV_IS_ID( el, KaxCues ) )
         {
             msg_Dbg(  &sys.demuxer, "|   + Cues" );
+            /* Cues are only used for seeking, load them on the first one */
             if( i_cues_position < 0 )
-                LoadCues( static_cast<KaxCues*>( el ) );
-            i_cues_position = (int64_t) es.I_O().getFilePointer();
+                i_cues_position = (int64_t) el->GetElementPosition();
         }
         else if( MKV_IS_ID( el, KaxCluster ) )
         {
@@ -633,7 +722,7 @@ bool matroska_segment_c::LoadSeekHeadItem( const EbmlCallbacks & ClassInfos, int
     else if( MKV_IS_ID( el, KaxCues ) )
     {
         msg_Dbg( &sys.demuxer, "|   + Cues" );
-        if( i_cues_position < 0 )
+        if( !b_cues )
             LoadCues( static_cast<KaxCues*>( el ) );
         i_cues_position = i_element_position;
     }
@@ -693,38 +782,28 @@ void matroska_segment_c::Seek( mtime_t i_date, mtime_t i_time_offset, int64_t i_
     spoint *p_last = NULL;
     int i_cat;
     bool b_has_key = false;
+    mkv_index_t index;
+    bool b_index;
 
     if( i_global_position >= 0 )
     {
-        /* Special case for seeking in files with no cues */
-        EbmlElement *el = NULL;
+        /* Special case for seeking in files with no cues: index the
+         * clusters up to the requested position */
+        int64_t i_position;
+        uint64_t i_timecode;
 
         /* Start from the last known index instead of the beginning eachtime */
-        if( i_index == 0)
-            es.I_O().setFilePointer( i_start_pos, seek_beginning );
-        else
-            es.I_O().setFilePointer( p_indexes[ i_index - 1 ].i_position,
-                                     seek_beginning );
-        delete ep;
-        ep = new EbmlParser( &es, segment, &sys.demuxer );
-        cluster = NULL;
+        if( !IndexLast( &index ) )
+            index.i_position = -1;
+        es.I_O().setFilePointer( index.i_position >= 0 ? index.i_position :
+                                                         i_start_pos,
+                                 seek_beginning );
 
-        while( ( el = ep->Get() ) != NULL )
+        while( EbmlRawFindCluster( es.I_O(), &i_position, &i_timecode ) )
         {
-            if( MKV_IS_ID( el, KaxCluster ) )
-            {
-                cluster = (KaxCluster *)el;
-                i_cluster_pos = cluster->GetElementPosition();
-                if( i_index == 0 ||
-                    ( i_index > 0 &&
-                      p_indexes[i_index - 1].i_position < (int64_t)cluster->GetElementPosition() ) )
-                {
-                    ParseCluster(false);
-                    IndexAppendCluster( cluster );
-                }
-                if( es.I_O().getFilePointer() >= (unsigned) i_global_position )
-                    break;
-            }
+            IndexAdd( i_timecode * i_timescale / (mtime_t)1000, i_position );
+            if( es.I_O().getFilePointer() >= (uint64)i_global_position )
+                break;
         }
     }
 
@@ -745,19 +824,13 @@ void matroska_segment_c::Seek( mtime_t i_date, mtime_t i_time_offset, int64_t i_
         return;       
     }
 
-    int i_idx = 0;
-    if ( i_index > 0 )
-    {
-
-        for( ; i_idx < i_index; i_idx++ )
-            if( p_indexes[i_idx].i_time + i_time_offset > i_date )
-                break;
-
-        if( i_idx > 0 )
-            i_idx--;
+    LoadPendingCues();
 
-        i_seek_position = p_indexes[i_idx].i_position;
-        i_seek_time = p_indexes[i_idx].i_time;
+    b_index = IndexFind( i_date - i_time_offset, &index );
+    if( b_index )
+    {
+        i_seek_position = index.i_position;
+        i_seek_time = index.i_time;
     }
 
     msg_Dbg( &sys.demuxer, "seek got %"PRId64" (%d%%)",
@@ -858,14 +931,18 @@ void matroska_segment_c::Seek( mtime_t i_date, mtime_t i_time_offset, int64_t i_
 
             delete block;
         }
-        if( b_has_key || !i_idx )
+        if( b_has_key || !b_index )
             break;
 
         /* No key picture was found in the cluster seek to previous seekpoint */
-        i_date = i_time_offset + p_indexes[i_idx].i_time;
-        i_idx--;
+        mkv_index_t prev;
+        if( !IndexFind( index.i_time - 1, &prev ) ||
+            prev.i_position >= index.i_position )
+            break;
+        i_date = i_time_offset + index.i_time;
+        index = prev;
         i_pts = 0;
-        es.I_O().setFilePointer( p_indexes[i_idx].i_position );
+        es.I_O().setFilePointer( index.i_position );
         delete ep;
         ep = new EbmlParser( &es, segment, &sys.demuxer );
         cluster = NULL;
@@ -1409,6 +1486,9 @@ bool matroska_segment_c::Select( mtime_t i_start_time )
     delete ep;
     ep = new EbmlParser( &es, segment, &sys.demuxer );
 
+    if( i_cues_position < 0 )
+        IndexScanStart();
+
     return true;
 }
 
@@ -1460,17 +1540,6 @@ int matroska_segment_c::BlockGet( KaxBlock * & pp_block, KaxSimpleBlock * & pp_s
                 *pb_discardable_picture = pp_simpleblock->IsDiscardable();
             }
 
-            /* update the index */
-#define idx p_indexes[i_index - 1]
-            if( i_index > 0 && idx.i_time == -1 )
-            {
-                if ( pp_simpleblock != NULL )
-                    idx.i_time        = pp_simpleblock->GlobalTimecode() / (mtime_t)1000;
-                else
-                    idx.i_time        = (*pp_block).GlobalTimecode() / (mtime_t)1000;
-                idx.b_key         = *pb_key_picture;
-            }
-#undef idx
             return VLC_SUCCESS;
         }
 
@@ -1535,12 +1604,10 @@ int matroska_segment_c::BlockGet( KaxBlock * & pp_block, KaxSimpleBlock * & pp_s
 
                 ctc.ReadData( es.I_O(), SCOPE_ALL_DATA );
                 cluster->InitTimecode( uint64( ctc ), i_timescale );
- 
+
                 /* add it to the index */
-                if( i_index == 0 ||
-                    ( i_index > 0 &&
-                      p_indexes[i_index - 1].i_position < (int64_t)cluster->GetElementPosition() ) )
-                    IndexAppendCluster( cluster );
+                IndexAdd( cluster->GlobalTimecode() / (mtime_t) 1000,
+                          cluster->GetElementPosition() );
             }
             else if( MKV_IS_ID( el, KaxClusterSilentTracks ) )
             {
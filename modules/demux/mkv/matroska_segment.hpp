@@ -74,9 +74,6 @@ public:
     KaxNextUID              *p_next_segment_uid;
 
     bool                    b_cues;
-    int                     i_index;
-    int                     i_index_max;
-    mkv_index_t             *p_indexes;
 
     /* info */
     char                    *psz_muxing_application;
@@ -108,6 +105,10 @@ public:
     int BlockFindTrackIndex( size_t *pi_track,
                              const KaxBlock *, const KaxSimpleBlock * );
 
+    bool LoadPendingCues();
+    bool IndexFind( mtime_t i_time, mkv_index_t * );
+    bool IndexLast( mkv_index_t * );
+
     bool Select( mtime_t i_start_time );
     void UnSelect();
 
@@ -126,7 +127,22 @@ private:
     void ParseTrackEntry( KaxTrackEntry *m );
     void ParseCluster( bool b_update_start_time = true );
     void ParseSimpleTags( KaxTagSimple *tag );
-    void IndexAppendCluster( KaxCluster *cluster );
+    void IndexAdd( mtime_t i_time, int64_t i_position );
+
+    /* background scan of the clusters, for files without cues */
+    void IndexScanStart();
+    void IndexScanStop();
+    void IndexScan();
+    static void *IndexScanThread( void * );
+
+    /* index, sorted by time, filled from the cues (loaded on the first
+     * seek) and from the clusters that were parsed or scanned */
+    std::vector<mkv_index_t> indexes;
+    vlc_mutex_t             index_lock;
+
+    bool                    b_scan_running;
+    bool                    b_scan_abort;
+    vlc_thread_t            scan_thread;
 };
 
 
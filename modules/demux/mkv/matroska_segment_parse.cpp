@@ -93,7 +93,9 @@ void matroska_segment_c::ParseSeekHead( KaxSeekHead *seekhead )
                 if( id == EBML_ID(KaxCues) )
                 {
                     msg_Dbg( &sys.demuxer, "|   - cues at %"PRId64, i_pos );
-                    LoadSeekHeadItem( EBML_INFO(KaxCues), i_pos );
+                    /* loaded on the first seek */
+                    if( i_cues_position < 0 )
+                        i_cues_position = i_pos;
                 }
                 else if( id == EBML_ID(KaxInfo) )
                 {
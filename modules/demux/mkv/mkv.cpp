@@ -35,6 +35,7 @@
 
 #include <vlc_fs.h>
 #include <vlc_url.h>
+#include <vlc_atomic.h>
 
 /*****************************************************************************
  * Module descriptor
@@ -141,7 +142,8 @@ static int Open( vlc_object_t * p_this )
         goto error;
     }
 
-    if (b_need_preload && var_InheritBool( p_demux, "mkv-preload-local-dir" ))
+    if (b_need_preload && !p_demux->b_preparsing &&
+        var_InheritBool( p_demux, "mkv-preload-local-dir" ))
     {
         msg_Dbg( p_demux, "Preloading local dir" );
         /* get the files from the same dir from the same family (based on p_demux->psz_path) */
@@ -236,7 +238,7 @@ static int Open( vlc_object_t * p_this )
 
         p_sys->PreloadFamily( *p_segment );
     }
-    else if (b_need_preload)
+    else if (b_need_preload && !p_demux->b_preparsing)
         msg_Warn( p_demux, "This file references other files, you may want to enable the preload of local directory");
 
     if ( !p_sys->PreloadLinked() ||
@@ -421,8 +423,6 @@ static void Seek( demux_t *p_demux, mtime_t i_date, double f_percent, virtual_ch
     mtime_t            i_time_offset = 0;
     int64_t            i_global_position = -1;
 
-    int         i_index;
-
     msg_Dbg( p_demux, "seek request to %"PRId64" (%f%%)", i_date, f_percent );
     if( i_date < 0 && f_percent < 0 )
     {
@@ -441,24 +441,18 @@ static void Seek( demux_t *p_demux, mtime_t i_date, double f_percent, virtual_ch
     }
 
     /* seek without index or without date */
-    if( f_percent >= 0 && (var_InheritBool( p_demux, "mkv-seek-percent" ) || !p_segment->b_cues || i_date < 0 ))
+    bool b_cues = p_segment->LoadPendingCues();
+    if( f_percent >= 0 && (var_InheritBool( p_demux, "mkv-seek-percent" ) || !b_cues || i_date < 0 ))
     {
         i_date = int64_t( f_percent * p_sys->f_duration * 1000.0 );
-        if( !p_segment->b_cues )
+        if( !b_cues )
         {
             int64_t i_pos = int64_t( f_percent * stream_Size( p_demux->s ) );
+            mkv_index_t index;
 
             msg_Dbg( p_demux, "lengthy way of seeking for pos:%"PRId64, i_pos );
-            for( i_index = 0; i_index < p_segment->i_index; i_index++ )
-            {
-                if( p_segment->p_indexes[i_index].i_position >= i_pos &&
-                    p_segment->p_indexes[i_index].i_time > 0 )
-                    break;
-            }
-            if( i_index == p_segment->i_index )
-                i_index--;
-
-            if( p_segment->p_indexes[i_index].i_position < i_pos )
+            /* the clusters that are not indexed yet have to be parsed */
+            if( !p_segment->IndexLast( &index ) || index.i_position < i_pos )
             {
                 msg_Dbg( p_demux, "no cues, seek request to global pos: %"PRId64, i_pos );
                 i_global_position = i_pos;
@@ -482,6 +476,75 @@ static block_t *MemToBlock( uint8_t *p_mem, size_t i_mem, size_t offset)
     return p_block;
 }
 
+/* The data of a libmatroska block, shared by the frames sent from it */
+typedef struct
+{
+    vlc_atomic_t refs;
+    binary       *p_buffer;
+    size_t       i_size;
+} mkv_block_data_t;
+
+typedef struct
+{
+    block_t          self;
+    mkv_block_data_t *p_data;
+} mkv_frame_t;
+
+static void BlockDataRelease( mkv_block_data_t *p_data )
+{
+    if( vlc_atomic_dec( &p_data->refs ) > 0 )
+        return;
+    free( p_data->p_buffer );
+    free( p_data );
+}
+
+/* Takes the data read by libmatroska away from the block, which can still
+ * be skipped and deleted as usual */
+static mkv_block_data_t *BlockDataTake( KaxInternalBlock *block )
+{
+    binary *p_buffer = block->EbmlBinary::GetBuffer();
+    if( p_buffer == NULL )
+        return NULL;
+
+    mkv_block_data_t *p_data = (mkv_block_data_t *)malloc( sizeof( *p_data ) );
+    if( unlikely( p_data == NULL ) )
+        return NULL;
+
+    /* EbmlBinary allocates its data with malloc() and does not free it once
+     * detached; the size is kept so that the element is skipped properly */
+    vlc_atomic_set( &p_data->refs, 1 );
+    p_data->p_buffer = p_buffer;
+    p_data->i_size   = block->GetSize();
+    block->SetBuffer( NULL, (uint32)block->GetSize() );
+    return p_data;
+}
+
+static void FrameRelease( block_t *p_block )
+{
+    BlockDataRelease( ((mkv_frame_t *)p_block)->p_data );
+    free( p_block );
+}
+
+/* Returns a block referencing a frame within the shared block data */
+static block_t *FrameNew( mkv_block_data_t *p_data, binary *p_buffer,
+                          size_t i_size )
+{
+    size_t i_offset = p_buffer - p_data->p_buffer;
+    if( p_buffer < p_data->p_buffer || i_offset > p_data->i_size ||
+        i_size > p_data->i_size - i_offset )
+        return MemToBlock( p_buffer, i_size, 0 );
+
+    mkv_frame_t *p_frame = (mkv_frame_t *)malloc( sizeof( *p_frame ) );
+    if( unlikely( p_frame == NULL ) )
+        return NULL;
+
+    block_Init( &p_frame->self, p_buffer, i_size );
+    p_frame->self.pf_release = FrameRelease;
+    p_frame->p_data = p_data;
+    vlc_atomic_inc( &p_data->refs );
+    return &p_frame->self;
+}
+
 /* Needed by matroska_segment::Seek() and Seek */
 void BlockDecode( demux_t *p_demux, KaxBlock *block, KaxSimpleBlock *simpleblock,
                          mtime_t i_pts, mtime_t i_duration, bool f_mandatory )
@@ -542,7 +605,18 @@ void BlockDecode( demux_t *p_demux, KaxBlock *block, KaxSimpleBlock *simpleblock
         block_size = simpleblock->GetSize();
     else
         block_size = block->GetSize();
- 
+
+    /* Without content encoding, the frames are sent without copying them */
+    mkv_block_data_t *p_shared = NULL;
+    if( tk->i_compression_type == MATROSKA_COMPRESSION_NONE &&
+        tk->fmt.i_cat != NAV_ES )
+    {
+        if( simpleblock != NULL )
+            p_shared = BlockDataTake( simpleblock );
+        else
+            p_shared = BlockDataTake( block );
+    }
+
     for( unsigned int i = 0;
          ( block != NULL && i < block->NumberFrames()) || ( simpleblock != NULL && i < simpleblock->NumberFrames() );
          i++ )
@@ -567,7 +641,9 @@ void BlockDecode( demux_t *p_demux, KaxBlock *block, KaxSimpleBlock *simpleblock
             break;
         }
 
-        if( tk->i_compression_type == MATROSKA_COMPRESSION_HEADER && tk->p_compression_data != NULL )
+        if( p_shared != NULL )
+            p_block = FrameNew( p_shared, data->Buffer(), data->Size() );
+        else if( tk->i_compression_type == MATROSKA_COMPRESSION_HEADER && tk->p_compression_data != NULL )
             p_block = MemToBlock( data->Buffer(), data->Size(), tk->p_compression_data->GetSize() );
         else
             p_block = MemToBlock( data->Buffer(), data->Size(), 0 );
@@ -647,6 +723,9 @@ msg_Dbg( p_demux, "block i_dts: %"PRId64" / i_pts: %"PRId64, p_block->i_dts, p_b
                  i_pts + ( mtime_t )( tk->i_default_duration / 1000 ):
                  VLC_TS_INVALID;
     }
+
+    if( p_shared != NULL )
+        BlockDataRelease( p_shared );
 }
 
 /*****************************************************************************
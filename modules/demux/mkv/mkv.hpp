@@ -223,15 +223,11 @@ struct mkv_track_t
 
 };
 
+/* seek point: the position of a cluster and its start time */
 struct mkv_index_t
 {
-    int     i_track;
-    int     i_block_number;
-
-    int64_t i_position;
     int64_t i_time;
-
-    bool       b_key;
+    int64_t i_position;
 };
 
 
@@ -597,6 +597,25 @@ static void MP4_FreeBox_trun( MP4_Box_t *p_box )
     FREENULL( p_box->data.p_trun->p_samples );
 }
 
+static int MP4_ReadBox_tfdt( stream_t *p_stream, MP4_Box_t *p_box )
+{
+    MP4_READBOX_ENTER( MP4_Box_data_tfdt_t );
+
+    MP4_GETVERSIONFLAGS( p_box->data.p_tfdt );
+
+    if( p_box->data.p_tfdt->i_version == 1 )
+        MP4_GET8BYTES( p_box->data.p_tfdt->i_base_media_decode_time );
+    else
+        MP4_GET4BYTES( p_box->data.p_tfdt->i_base_media_decode_time );
+
+#ifdef MP4_VERBOSE
+    msg_Dbg( p_stream, "read box: \"tfdt\" base media decode time %"PRIu64,
+             p_box->data.p_tfdt->i_base_media_decode_time );
+#endif
+
+    MP4_READBOX_EXIT( 1 );
+}
+
 
 
 static int MP4_ReadBox_tkhd(  stream_t *p_stream, MP4_Box_t *p_box )
@@ -3097,6 +3116,7 @@ static const struct
     { ATOM_mfhd,    MP4_ReadBox_mfhd,         MP4_FreeBox_Common },
     { ATOM_tfhd,    MP4_ReadBox_tfhd,         MP4_FreeBox_Common },
     { ATOM_trun,    MP4_ReadBox_trun,         MP4_FreeBox_trun },
+    { ATOM_tfdt,    MP4_ReadBox_tfdt,         MP4_FreeBox_Common },
     { ATOM_trex,    MP4_ReadBox_trex,         MP4_FreeBox_Common },
     { ATOM_mehd,    MP4_ReadBox_mehd,         MP4_FreeBox_Common },
     { ATOM_sdtp,    MP4_ReadBox_sdtp,         MP4_FreeBox_sdtp },
@@ -3204,6 +3224,81 @@ void MP4_BoxFree( stream_t *s, MP4_Box_t *p_box )
     free( p_box );
 }
 
+/*****************************************************************************
+ * MP4_ReadBoxRoot : load the first level boxes
+ *****************************************************************************
+ * Like MP4_ReadBoxContainerRaw, but the fragments following a moov with
+ * mvex are left for MP4_BoxGetNextFragment, and without fast seeking, the
+ * loading stops before the media data instead of skipping it.
+ *****************************************************************************/
+static int MP4_ReadBoxRoot( stream_t *p_stream, MP4_Box_t *p_root )
+{
+    MP4_Box_t *p_box;
+    MP4_Box_t box;
+    bool b_fastseek = false;
+
+    stream_Control( p_stream, STREAM_CAN_FASTSEEK, &b_fastseek );
+
+    if( stream_Tell( p_stream ) + 8 > (off_t)(p_root->i_pos + p_root->i_size) )
+    {
+        /* there is no box to load */
+        return 0;
+    }
+
+    do
+    {
+        if( !b_fastseek && MP4_ReadBoxCommon( p_stream, &box ) &&
+            box.i_type == ATOM_mdat )
+            break;
+
+        if( ( p_box = MP4_ReadBox( p_stream, p_root ) ) == NULL ) break;
+
+        if( !p_root->p_first ) p_root->p_first = p_box;
+        else p_root->p_last->p_next = p_box;
+        p_root->p_last = p_box;
+
+        if( p_box->i_type == ATOM_moov && MP4_BoxGet( p_box, "mvex" ) )
+        {
+            /* fragmented file, stop at the first fragment */
+            MP4_NextBox( p_stream, p_box );
+            break;
+        }
+
+    } while( MP4_NextBox( p_stream, p_box ) == 1 );
+
+    return 1;
+}
+
+MP4_Box_t *MP4_BoxGetNextFragment( stream_t *s, MP4_Box_t *p_root )
+{
+    MP4_Box_t box;
+    MP4_Box_t *p_moof;
+
+    for( ;; )
+    {
+        if( !MP4_ReadBoxCommon( s, &box ) )
+            return NULL;
+        if( box.i_type == ATOM_moof )
+            break;
+
+        /* skip this box, unless it extends to the end or is broken */
+        if( box.i_size < 8 ||
+            stream_Seek( s, box.i_pos + box.i_size ) )
+            return NULL;
+    }
+
+    p_moof = MP4_ReadBox( s, p_root );
+    if( p_moof == NULL )
+        return NULL;
+
+    if( stream_Seek( s, p_moof->i_pos + p_moof->i_size ) )
+    {
+        MP4_BoxFree( s, p_moof );
+        return NULL;
+    }
+    return p_moof;
+}
+
 /*****************************************************************************
  * MP4_BoxGetRoot : Parse the entire file, and create all boxes in memory
  *****************************************************************************
@@ -3224,6 +3319,8 @@ MP4_Box_t *MP4_BoxGetRoot( stream_t *s )
     p_root->i_type = ATOM_root;
     p_root->i_shortsize = 1;
     p_root->i_size = stream_Size( s );
+    if( p_root->i_size == 0 )
+        p_root->i_size = INT64_MAX; /* live stream */
     CreateUUID( &p_root->i_uuid, p_root->i_type );
 
     p_root->data.p_data = NULL;
@@ -3234,7 +3331,7 @@ MP4_Box_t *MP4_BoxGetRoot( stream_t *s )
 
     p_stream = s;
 
-    i_result = MP4_ReadBoxContainerRaw( p_stream, p_root );
+    i_result = MP4_ReadBoxRoot( p_stream, p_root );
 
     if( i_result )
     {
@@ -80,6 +80,7 @@
 #define ATOM_traf VLC_FOURCC( 't', 'r', 'a', 'f' )
 #define ATOM_tfhd VLC_FOURCC( 't', 'f', 'h', 'd' )
 #define ATOM_trun VLC_FOURCC( 't', 'r', 'u', 'n' )
+#define ATOM_tfdt VLC_FOURCC( 't', 'f', 'd', 't' )
 #define ATOM_cprt VLC_FOURCC( 'c', 'p', 'r', 't' )
 #define ATOM_iods VLC_FOURCC( 'i', 'o', 'd', 's' )
 #define ATOM_pasp VLC_FOURCC( 'p', 'a', 's', 'p' )
@@ -841,6 +842,8 @@ typedef struct MP4_Box_data_mfhd_s
 #define MP4_TFHD_DFLT_SAMPLE_DURATION (1LL<<3)
 #define MP4_TFHD_DFLT_SAMPLE_SIZE     (1LL<<4)
 #define MP4_TFHD_DFLT_SAMPLE_FLAGS    (1LL<<5)
+#define MP4_TFHD_DURATION_IS_EMPTY    (1LL<<16)
+#define MP4_TFHD_DEFAULT_BASE_IS_MOOF (1LL<<17)
 typedef struct MP4_Box_data_tfhd_s
 {
     uint8_t  i_version;
@@ -884,6 +887,15 @@ typedef struct MP4_Box_data_trun_s
 
 } MP4_Box_data_trun_t;
 
+typedef struct MP4_Box_data_tfdt_s
+{
+    uint8_t  i_version;
+    uint32_t i_flags;
+
+    uint64_t i_base_media_decode_time;
+
+} MP4_Box_data_tfdt_t;
+
 
 typedef struct
 {
@@ -1046,6 +1058,7 @@ typedef union MP4_Box_data_s
     MP4_Box_data_mfhd_t *p_mfhd;
     MP4_Box_data_tfhd_t *p_tfhd;
     MP4_Box_data_trun_t *p_trun;
+    MP4_Box_data_tfdt_t *p_tfdt;
     MP4_Box_data_tkhd_t *p_tkhd;
     MP4_Box_data_mdhd_t *p_mdhd;
     MP4_Box_data_hdlr_t *p_hdlr;
@@ -1142,9 +1155,21 @@ typedef struct MP4_Box_s
  *****************************************************************************
  *  The first box is a virtual box "root" and is the father for all first
  *  level boxes
+ *  A fragmented file (moov with mvex) is only parsed up to its moov, and
+ *  the stream is left at the first fragment. Without fast seeking, the
+ *  parsing also stops before the first mdat.
  *****************************************************************************/
 MP4_Box_t *MP4_BoxGetRoot( stream_t * );
 
+/*****************************************************************************
+ * MP4_BoxGetNextFragment : Parse the next moof box
+ *****************************************************************************
+ *  The boxes before the moof (mdat, styp, sidx...) are skipped, and the
+ *  stream is left at the end of the moof. The moof is not linked to p_root,
+ *  it has to be freed with MP4_BoxFree. Return NULL at the end of the stream.
+ *****************************************************************************/
+MP4_Box_t *MP4_BoxGetNextFragment( stream_t *, MP4_Box_t *p_root );
+
 /*****************************************************************************
  * MP4_FreeBox : free memory allocated after read with MP4_ReadBox
  *               or MP4_BoxGetRoot, this means also children boxes
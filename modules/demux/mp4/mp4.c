@@ -35,6 +35,7 @@
 #include <vlc_charset.h>                           /* EnsureUTF8 */
 #include <vlc_meta.h>                              /* vlc_meta_t, vlc_meta_ */
 #include <vlc_input.h>
+#include <vlc_url.h>                               /* make_URI */
 
 #include "libmp4.h"
 #include "drms.h"
@@ -46,6 +47,12 @@
 static int  Open ( vlc_object_t * );
 static void Close( vlc_object_t * );
 
+#define THREADS_TEXT N_("Read the tracks from separate threads")
+#define THREADS_LONGTEXT N_( \
+    "Read each selected track of a local file from its own thread, ahead " \
+    "of the playback. This helps when many tracks are demuxed at once, " \
+    "for instance to transcode all the audio tracks of a file." )
+
 vlc_module_begin ()
     set_category( CAT_INPUT )
     set_subcategory( SUBCAT_INPUT_DEMUX )
@@ -53,6 +60,9 @@ vlc_module_begin ()
     set_shortname( N_("MP4") )
     set_capability( "demux", 240 )
     set_callbacks( Open, Close )
+
+    add_bool( "mp4-track-threads", false,
+              THREADS_TEXT, THREADS_LONGTEXT, true )
 vlc_module_end ()
 
 /*****************************************************************************
@@ -60,9 +70,17 @@ vlc_module_end ()
  *****************************************************************************/
 static int   Demux   ( demux_t * );
 static int   DemuxRef( demux_t *p_demux ){ (void)p_demux; return 0;}
+static int   DemuxFrag( demux_t * );
 static int   Seek    ( demux_t *, mtime_t );
 static int   Control ( demux_t *, int, va_list );
 
+/* Position in a run-length sample table (stts or ctts) */
+typedef struct
+{
+    uint32_t     i_index;  /* entry of the table */
+    uint32_t     i_used;   /* samples of the entry before the position */
+} mp4_run_t;
+
 /* Contain all information about a chunk */
 typedef struct
 {
@@ -71,24 +89,62 @@ typedef struct
     uint32_t     i_sample_count; /* how many samples in this chunk */
     uint32_t     i_sample_first; /* index of the first sample in this chunk */
 
-    /* now provide way to calculate pts, dts, and offset without too
-        much memory and with fast access */
-
-    /* with this we can calculate dts/pts without waste memory */
+    /* the timing tables are kept in their run-length form, the chunk only
+     * records where its first sample is in them */
     uint64_t     i_first_dts;   /* DTS of the first sample */
     uint64_t     i_last_dts;    /* DTS of the last sample */
-    uint32_t     *p_sample_count_dts;
-    uint32_t     *p_sample_delta_dts;   /* dts delta */
+    mp4_run_t    dts_run;       /* first sample in stts */
+    mp4_run_t    pts_run;       /* first sample in ctts */
 
-    uint32_t     *p_sample_count_pts;
-    int32_t      *p_sample_offset_pts;  /* pts-dts */
+} mp4_chunk_t;
 
-    /* TODO if needed add pts
-        but quickly *add* support for edts and seeking */
+/* Last sample whose dts, pts-dts and offset were resolved, so that reading
+ * the samples in order does not walk the tables from the chunk start */
+typedef struct
+{
+    uint32_t     i_chunk;
+    uint32_t     i_sample;
+    uint64_t     i_dts;
+    mp4_run_t    dts_run;
+    mp4_run_t    pts_run;
+    uint64_t     i_pos;         /* only with p_sample_size */
+} mp4_cursor_t;
 
-} mp4_chunk_t;
+/* Next sample of a track in the current fragment (moof) */
+typedef struct
+{
+    MP4_Box_t    *p_traf;       /* NULL when there is no sample left */
+    MP4_Box_data_tfhd_t *p_tfhd;
+    MP4_Box_t    *p_trun;
+    uint32_t     i_sample;      /* in the trun */
+    uint64_t     i_base;        /* base data offset of the traf */
+    uint64_t     i_offset;      /* absolute position of the sample */
+    uint64_t     i_dts;         /* in track timescale */
+} mp4_fragpos_t;
 
  /* Contain all needed information for read all track with vlc */
+/* Samples read ahead from the thread of a track */
+typedef struct
+{
+    vlc_thread_t thread;
+    demux_t      *p_demux;
+    stream_t     *s;             /* own stream, positioned for this track */
+
+    vlc_mutex_t  lock;
+    vlc_cond_t   wait;
+    block_t      *p_first;       /* queued blocks, in DTS order */
+    block_t      **pp_last;
+    size_t       i_size;
+    unsigned     i_count;
+    bool         b_abort;
+    bool         b_eof;          /* no more block will be queued */
+    bool         b_error;        /* because a read failed */
+} mp4_reader_t;
+
+/* Bounds of the queue of a track reader */
+#define MP4_READER_MAX_SIZE  (4 * 1024 * 1024)
+#define MP4_READER_MAX_COUNT 500
+
 typedef struct
 {
     unsigned int i_track_ID;/* this should be unique */
@@ -128,8 +184,16 @@ typedef struct
     /* sample size, p_sample_size defined only if i_sample_size == 0
         else i_sample_size is size for all sample */
     uint32_t         i_sample_size;
-    uint32_t         *p_sample_size; /* XXX perhaps add file offset if take
-                                    too much time to do sumations each time*/
+    uint32_t         *p_sample_size; /* points into the stsz box */
+
+    MP4_Box_data_stts_t *p_stts;
+    MP4_Box_data_ctts_t *p_ctts;    /* could be NULL */
+    mp4_cursor_t     cursor;
+
+    /* fragmented file */
+    MP4_Box_data_trex_t *p_trex;    /* could be NULL */
+    mp4_fragpos_t    frag;
+    uint64_t         i_frag_end_dts; /* after the samples of the fragment */
 
     MP4_Box_t *p_stbl;  /* will contain all timing information */
     MP4_Box_t *p_stsd;  /* will contain all data to initialize decoder */
@@ -139,6 +203,8 @@ typedef struct
     void      *p_drms;
     MP4_Box_t *p_skcr;
 
+    mp4_reader_t *p_reader; /* NULL unless read from its own thread */
+
 } mp4_track_t;
 
 
@@ -156,6 +222,15 @@ struct demux_sys_t
     mp4_track_t  *track;         /* array of track */
     float        f_fps;          /* number of frame per seconds */
 
+    /* fragmented file, read one moof at a time */
+    bool         b_fragmented;
+    MP4_Box_t    *p_moof;        /* current fragment */
+    uint64_t     i_frag_first;   /* position of the first fragment */
+    uint64_t     i_frag_next;    /* position after the current fragment */
+
+    /* read the selected tracks from their own threads */
+    bool         b_track_threads;
+
     /* */
     MP4_Box_t    *p_tref_chap;
 
@@ -179,35 +254,86 @@ static int      MP4_TrackSampleSize( mp4_track_t * );
 static int      MP4_TrackNextSample( demux_t *, mp4_track_t * );
 static void     MP4_TrackSetELST( demux_t *, mp4_track_t *, int64_t );
 
+static block_t *MP4_TrackReadSample( demux_t *, mp4_track_t *, stream_t * );
+
+static int      MP4_ReaderStart( demux_t *, mp4_track_t * );
+static void     MP4_ReaderStop ( mp4_track_t * );
+static void     MP4_ReadersSend( demux_t * );
+
 static void     MP4_UpdateSeekpoint( demux_t * );
 static const char *MP4_ConvertMacCode( uint16_t );
 
-/* Return time in s of a track */
-static inline int64_t MP4_TrackGetDTS( demux_t *p_demux, mp4_track_t *p_track )
+/* Moves a position forward by i_count samples in a run-length table, and
+ * returns the sum of the deltas of the skipped samples (if pi_delta is
+ * given). Afterwards, the position is never at the end of an entry. */
+static uint64_t RunSkip( mp4_run_t *p_run, uint32_t i_entries,
+                         const uint32_t *pi_count, const int32_t *pi_delta,
+                         uint32_t i_count )
 {
-#define chunk p_track->chunk[p_track->i_chunk]
-
-    unsigned int i_index = 0;
-    unsigned int i_sample = p_track->i_sample - chunk.i_sample_first;
-    int64_t i_dts = chunk.i_first_dts;
+    uint64_t i_sum = 0;
 
-    while( i_sample > 0 )
+    while( p_run->i_index < i_entries )
     {
-        if( i_sample > chunk.p_sample_count_dts[i_index] )
+        if( pi_count[p_run->i_index] <= p_run->i_used )
         {
-            i_dts += chunk.p_sample_count_dts[i_index] *
-                chunk.p_sample_delta_dts[i_index];
-            i_sample -= chunk.p_sample_count_dts[i_index];
-            i_index++;
+            p_run->i_index++;
+            p_run->i_used = 0;
+            continue;
         }
-        else
-        {
-            i_dts += i_sample * chunk.p_sample_delta_dts[i_index];
+        if( i_count == 0 )
             break;
-        }
+
+        uint32_t i_rest = pi_count[p_run->i_index] - p_run->i_used;
+        uint32_t i_used = __MIN( i_rest, i_count );
+        if( pi_delta )
+            i_sum += (uint64_t)i_used * (uint32_t)pi_delta[p_run->i_index];
+        p_run->i_used += i_used;
+        i_count -= i_used;
+    }
+    return i_sum;
+}
+
+/* Resolves the timing and the position of the current sample */
+static void MP4_TrackUpdateCursor( mp4_track_t *p_track )
+{
+    mp4_cursor_t *p_cur = &p_track->cursor;
+    const mp4_chunk_t *ck = &p_track->chunk[p_track->i_chunk];
+
+    if( p_cur->i_chunk != p_track->i_chunk ||
+        p_cur->i_sample > p_track->i_sample )
+    {
+        p_cur->i_chunk  = p_track->i_chunk;
+        p_cur->i_sample = ck->i_sample_first;
+        p_cur->i_dts    = ck->i_first_dts;
+        p_cur->dts_run  = ck->dts_run;
+        p_cur->pts_run  = ck->pts_run;
+        p_cur->i_pos    = ck->i_offset;
     }
+    if( p_cur->i_sample == p_track->i_sample )
+        return;
 
-#undef chunk
+    const uint32_t i_count = p_track->i_sample - p_cur->i_sample;
+
+    p_cur->i_dts += RunSkip( &p_cur->dts_run, p_track->p_stts->i_entry_count,
+                             p_track->p_stts->i_sample_count,
+                             p_track->p_stts->i_sample_delta, i_count );
+    if( p_track->p_ctts )
+        RunSkip( &p_cur->pts_run, p_track->p_ctts->i_entry_count,
+                 p_track->p_ctts->i_sample_count, NULL, i_count );
+    if( p_track->p_sample_size )
+    {
+        for( uint32_t i = p_cur->i_sample; i < p_track->i_sample; i++ )
+            p_cur->i_pos += p_track->p_sample_size[i];
+    }
+    p_cur->i_sample = p_track->i_sample;
+}
+
+/* Return time in s of a track */
+static inline int64_t MP4_TrackGetDTS( demux_t *p_demux, mp4_track_t *p_track )
+{
+    MP4_TrackUpdateCursor( p_track );
+
+    int64_t i_dts = p_track->cursor.i_dts;
 
     /* now handle elst */
     if( p_track->p_elst )
@@ -235,21 +361,17 @@ static inline int64_t MP4_TrackGetDTS( demux_t *p_demux, mp4_track_t *p_track )
 
 static inline int64_t MP4_TrackGetPTSDelta( mp4_track_t *p_track )
 {
-    mp4_chunk_t *ck = &p_track->chunk[p_track->i_chunk];
-    unsigned int i_index = 0;
-    unsigned int i_sample = p_track->i_sample - ck->i_sample_first;
+    MP4_Box_data_ctts_t *ctts = p_track->p_ctts;
 
-    if( ck->p_sample_count_pts == NULL || ck->p_sample_offset_pts == NULL )
+    if( ctts == NULL )
         return -1;
 
-    for( i_index = 0;; i_index++ )
-    {
-        if( i_sample < ck->p_sample_count_pts[i_index] )
-            return ck->p_sample_offset_pts[i_index] * INT64_C(1000000) /
-                   (int64_t)p_track->i_timescale;
+    MP4_TrackUpdateCursor( p_track );
+    if( p_track->cursor.pts_run.i_index >= ctts->i_entry_count )
+        return -1;
 
-        i_sample -= ck->p_sample_count_pts[i_index];
-    }
+    return ctts->i_sample_offset[p_track->cursor.pts_run.i_index] *
+           INT64_C(1000000) / (int64_t)p_track->i_timescale;
 }
 
 static inline int64_t MP4_GetMoviePTS(demux_sys_t *p_sys )
@@ -302,13 +424,8 @@ static int Open( vlc_object_t * p_this )
             return VLC_EGENERIC;
     }
 
-    /* I need to seek */
+    /* I need to seek, unless the file is fragmented */
     stream_Control( p_demux->s, STREAM_CAN_FASTSEEK, &b_seekable );
-    if( !b_seekable )
-    {
-        msg_Warn( p_demux, "MP4 plugin discarded (not fastseekable)" );
-        return VLC_EGENERIC;
-    }
 
     /*Set exported functions */
     p_demux->pf_demux = Demux;
@@ -384,6 +501,26 @@ static int Open( vlc_object_t * p_this )
         p_foov->i_type = ATOM_moov;
     }
 
+    p_sys->b_fragmented = MP4_BoxGet( p_sys->p_root, "/moov/mvex" ) != NULL;
+    if( !b_seekable && !p_sys->b_fragmented )
+    {
+        msg_Warn( p_demux, "MP4 plugin discarded (not fastseekable)" );
+        goto error;
+    }
+    if( p_sys->b_fragmented )
+    {
+        msg_Dbg( p_demux, "fragmented file" );
+        p_sys->i_frag_first = p_sys->i_frag_next = stream_Tell( p_demux->s );
+        p_sys->i_pcr = -1;
+        p_demux->pf_demux = DemuxFrag;
+    }
+    else
+    {
+        /* the readers open the file a second time */
+        p_sys->b_track_threads = !p_demux->b_preparsing && p_demux->psz_file &&
+                                 var_InheritBool( p_demux, "mp4-track-threads" );
+    }
+
     if( ( p_rmra = MP4_BoxGet( p_sys->p_root,  "/moov/rmra" ) ) )
     {
         int        i_count = MP4_BoxCount( p_rmra, "rmda" );
@@ -484,6 +621,10 @@ static int Open( vlc_object_t * p_this )
             goto error;
         }
         p_sys->i_duration = p_mvhd->data.p_mvhd->i_duration;
+
+        MP4_Box_t *p_mehd = MP4_BoxGet( p_sys->p_root, "/moov/mvex/mehd" );
+        if( p_sys->i_duration == 0 && p_mehd )
+            p_sys->i_duration = p_mehd->data.p_mehd->i_fragment_duration;
     }
 
     if( !( p_sys->i_tracks = MP4_BoxCount( p_sys->p_root, "/moov/trak" ) ) )
@@ -565,8 +706,9 @@ static int Open( vlc_object_t * p_this )
         }
     }
 
-    /* */
-    LoadChapter( p_demux );
+    /* Chapters are titles, which are not used when preparsing */
+    if( !p_demux->b_preparsing )
+        LoadChapter( p_demux );
 
     return VLC_SUCCESS;
 
@@ -600,7 +742,8 @@ static int Demux( demux_t *p_demux )
         bool b;
 
         if( !tk->b_ok || tk->b_chapter ||
-            ( tk->b_selected && tk->i_sample >= tk->i_sample_count ) )
+            ( tk->b_selected && !tk->p_reader &&
+              tk->i_sample >= tk->i_sample_count ) )
         {
             continue;
         }
@@ -609,6 +752,7 @@ static int Demux( demux_t *p_demux )
 
         if( tk->b_selected && !b )
         {
+            MP4_ReaderStop( tk );
             MP4_TrackUnselect( p_demux, tk );
         }
         else if( !tk->b_selected && b)
@@ -654,7 +798,13 @@ static int Demux( demux_t *p_demux )
     {
         mp4_track_t *tk = &p_sys->track[i_track];
 
-        if( !tk->b_ok || tk->b_chapter || !tk->b_selected || tk->i_sample >= tk->i_sample_count )
+        if( !tk->b_ok || tk->b_chapter || !tk->b_selected || tk->p_reader ||
+            tk->i_sample >= tk->i_sample_count )
+            continue;
+
+        /* with several tracks, let a thread read ahead for this one */
+        if( p_sys->b_track_threads && i_track_selected > 1 &&
+            !MP4_ReaderStart( p_demux, tk ) )
             continue;
 
         while( MP4_TrackGetDTS( p_demux, tk ) < MP4_GetMoviePTS( p_sys ) )
@@ -667,11 +817,9 @@ static int Demux( demux_t *p_demux )
 
             if( MP4_TrackSampleSize( tk ) > 0 )
             {
-                block_t *p_block;
-                int64_t i_delta;
-
-                /* go,go go ! */
-                if( stream_Seek( p_demux->s, MP4_TrackGetPos( tk ) ) )
+                block_t *p_block = MP4_TrackReadSample( p_demux, tk,
+                                                        p_demux->s );
+                if( !p_block )
                 {
                     msg_Warn( p_demux, "track[0x%x] will be disabled (eof?)",
                               tk->i_track_ID );
@@ -679,90 +827,645 @@ static int Demux( demux_t *p_demux )
                     break;
                 }
 
-                /* now read pes */
-                if( !(p_block =
-                         stream_Block( p_demux->s, MP4_TrackSampleSize(tk) )) )
+                if( !tk->b_drms || ( tk->b_drms && tk->p_drms ) )
+                    es_out_Send( p_demux->out, tk->p_es, p_block );
+                else
+                    block_Release( p_block );
+            }
+
+            /* Next sample */
+            if( MP4_TrackNextSample( p_demux, tk ) )
+                break;
+        }
+    }
+
+    MP4_ReadersSend( p_demux );
+
+    return 1;
+}
+
+/*****************************************************************************
+ * MP4_TrackReadSample: read the current sample of a track from a stream
+ *****************************************************************************/
+static block_t *MP4_TrackReadSample( demux_t *p_demux, mp4_track_t *tk,
+                                     stream_t *s )
+{
+    block_t *p_block;
+    int64_t i_delta;
+
+    /* go,go go ! */
+    if( stream_Seek( s, MP4_TrackGetPos( tk ) ) )
+        return NULL;
+
+    /* now read pes */
+    if( !(p_block = stream_Block( s, MP4_TrackSampleSize(tk) )) )
+        return NULL;
+
+    if( tk->b_drms && tk->p_drms )
+    {
+        if( tk->p_skcr )
+        {
+            uint32_t p_key[4];
+            drms_get_p_key( tk->p_drms, p_key );
+
+            for( size_t i_pos = tk->p_skcr->data.p_skcr->i_init; i_pos < p_block->i_buffer; )
+            {
+                int n = __MIN( tk->p_skcr->data.p_skcr->i_encr, p_block->i_buffer - i_pos );
+                drms_decrypt( tk->p_drms, (uint32_t*)&p_block->p_buffer[i_pos], n, p_key );
+                i_pos += n;
+                i_pos += __MIN( tk->p_skcr->data.p_skcr->i_decr, p_block->i_buffer - i_pos );
+            }
+        }
+        else
+        {
+            drms_decrypt( tk->p_drms, (uint32_t*)p_block->p_buffer,
+                          p_block->i_buffer, NULL );
+        }
+    }
+    else if( tk->fmt.i_cat == SPU_ES )
+    {
+        if( tk->fmt.i_codec == VLC_FOURCC( 's', 'u', 'b', 't' ) &&
+            p_block->i_buffer >= 2 )
+        {
+            size_t i_size = GetWBE( p_block->p_buffer );
+
+            if( i_size + 2 <= p_block->i_buffer )
+            {
+                char *p;
+                /* remove the length field, and append a '\0' */
+                memmove( &p_block->p_buffer[0],
+                         &p_block->p_buffer[2], i_size );
+                p_block->p_buffer[i_size] = '\0';
+                p_block->i_buffer = i_size + 1;
+
+                /* convert \r -> \n */
+                while( ( p = strchr((char *) p_block->p_buffer, '\r' ) ) )
+                {
+                    *p = '\n';
+                }
+            }
+            else
+            {
+                /* Invalid */
+                p_block->i_buffer = 0;
+            }
+        }
+    }
+    /* dts */
+    p_block->i_dts = VLC_TS_0 + MP4_TrackGetDTS( p_demux, tk );
+    /* pts */
+    i_delta = MP4_TrackGetPTSDelta( tk );
+    if( i_delta != -1 )
+        p_block->i_pts = p_block->i_dts + i_delta;
+    else if( tk->fmt.i_cat != VIDEO_ES )
+        p_block->i_pts = p_block->i_dts;
+    else
+        p_block->i_pts = VLC_TS_INVALID;
+
+    return p_block;
+}
+
+/*****************************************************************************
+ * Track readers: a thread per track walks its sample table and reads its
+ * samples from a stream of its own, while Demux sends the queued blocks in
+ * DTS order. The demux thread does not touch the track while its reader
+ * runs: the reader is stopped before seeking or unselecting the track.
+ *****************************************************************************/
+static void *MP4_ReaderThread( void *data )
+{
+    mp4_track_t  *tk = data;
+    mp4_reader_t *p_reader = tk->p_reader;
+    demux_t      *p_demux = p_reader->p_demux;
+
+    vlc_mutex_lock( &p_reader->lock );
+    while( !p_reader->b_abort )
+    {
+        if( p_reader->i_size >= MP4_READER_MAX_SIZE ||
+            p_reader->i_count >= MP4_READER_MAX_COUNT )
+        {
+            vlc_cond_wait( &p_reader->wait, &p_reader->lock );
+            continue;
+        }
+        vlc_mutex_unlock( &p_reader->lock );
+
+        block_t *p_block = NULL;
+        bool b_error = false;
+
+        if( MP4_TrackSampleSize( tk ) > 0 )
+        {
+            p_block = MP4_TrackReadSample( p_demux, tk, p_reader->s );
+            b_error = p_block == NULL;
+        }
+        bool b_eof = b_error || MP4_TrackNextSample( p_demux, tk );
+
+        vlc_mutex_lock( &p_reader->lock );
+        if( p_block )
+        {
+            *p_reader->pp_last = p_block;
+            p_reader->pp_last = &p_block->p_next;
+            p_reader->i_size += p_block->i_buffer;
+            p_reader->i_count++;
+        }
+        p_reader->b_eof = b_eof;
+        p_reader->b_error = b_error;
+        vlc_cond_broadcast( &p_reader->wait );
+        if( b_eof )
+            break;
+    }
+    vlc_mutex_unlock( &p_reader->lock );
+    return NULL;
+}
+
+static int MP4_ReaderStart( demux_t *p_demux, mp4_track_t *tk )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    /* the reader can neither recreate the ES nor drop locked samples */
+    if( tk->b_drms && !tk->p_drms )
+        return VLC_EGENERIC;
+    for( uint32_t i = 1; i < tk->i_chunk_count; i++ )
+        if( tk->chunk[i].i_sample_description_index !=
+            tk->chunk[0].i_sample_description_index )
+            return VLC_EGENERIC;
+
+    mp4_reader_t *p_reader = malloc( sizeof( *p_reader ) );
+    if( !p_reader )
+        return VLC_ENOMEM;
+
+    char *psz_url = make_URI( p_demux->psz_file, "file" );
+    p_reader->s = psz_url ? stream_UrlNew( p_demux, psz_url ) : NULL;
+    free( psz_url );
+    if( !p_reader->s )
+    {
+        msg_Warn( p_demux, "cannot open the file again, "
+                  "reading all the tracks from one thread" );
+        p_sys->b_track_threads = false;
+        free( p_reader );
+        return VLC_EGENERIC;
+    }
+
+    p_reader->p_demux = p_demux;
+    vlc_mutex_init( &p_reader->lock );
+    vlc_cond_init( &p_reader->wait );
+    p_reader->p_first = NULL;
+    p_reader->pp_last = &p_reader->p_first;
+    p_reader->i_size = 0;
+    p_reader->i_count = 0;
+    p_reader->b_abort = false;
+    p_reader->b_eof = false;
+    p_reader->b_error = false;
+
+    tk->p_reader = p_reader;
+    if( vlc_clone( &p_reader->thread, MP4_ReaderThread, tk,
+                   VLC_THREAD_PRIORITY_INPUT ) )
+    {
+        tk->p_reader = NULL;
+        vlc_cond_destroy( &p_reader->wait );
+        vlc_mutex_destroy( &p_reader->lock );
+        stream_Delete( p_reader->s );
+        free( p_reader );
+        return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+/* Stops the reader of a track, dropping the blocks it has read ahead */
+static void MP4_ReaderStop( mp4_track_t *tk )
+{
+    mp4_reader_t *p_reader = tk->p_reader;
+
+    if( !p_reader )
+        return;
+
+    vlc_mutex_lock( &p_reader->lock );
+    p_reader->b_abort = true;
+    vlc_cond_broadcast( &p_reader->wait );
+    vlc_mutex_unlock( &p_reader->lock );
+
+    vlc_join( p_reader->thread, NULL );
+    tk->p_reader = NULL;
+
+    block_ChainRelease( p_reader->p_first );
+    vlc_cond_destroy( &p_reader->wait );
+    vlc_mutex_destroy( &p_reader->lock );
+    stream_Delete( p_reader->s );
+    free( p_reader );
+}
+
+/* Sends the blocks of the read ahead tracks up to the movie time, the
+ * lowest DTS first */
+static void MP4_ReadersSend( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const mtime_t i_end = VLC_TS_0 + MP4_GetMoviePTS( p_sys );
+
+    for( ;; )
+    {
+        mp4_track_t *p_next = NULL;
+        mtime_t i_next_dts = 0;
+
+        for( unsigned i = 0; i < p_sys->i_tracks; i++ )
+        {
+            mp4_track_t  *tk = &p_sys->track[i];
+            mp4_reader_t *p_reader = tk->p_reader;
+            bool b_done;
+
+            if( !p_reader )
+                continue;
+
+            vlc_mutex_lock( &p_reader->lock );
+            while( !p_reader->p_first && !p_reader->b_eof )
+                vlc_cond_wait( &p_reader->wait, &p_reader->lock );
+
+            const block_t *p_block = p_reader->p_first;
+            if( p_block && p_block->i_dts < i_end &&
+                ( !p_next || p_block->i_dts < i_next_dts ) )
+            {
+                p_next = tk;
+                i_next_dts = p_block->i_dts;
+            }
+            b_done = !p_block;
+            vlc_mutex_unlock( &p_reader->lock );
+
+            /* the thread has exited */
+            if( b_done )
+            {
+                bool b_error = p_reader->b_error;
+
+                MP4_ReaderStop( tk );
+                if( b_error )
                 {
                     msg_Warn( p_demux, "track[0x%x] will be disabled (eof?)",
                               tk->i_track_ID );
                     MP4_TrackUnselect( p_demux, tk );
-                    break;
                 }
+            }
+        }
 
-                if( tk->b_drms && tk->p_drms )
-                {
-                    if( tk->p_skcr )
-                    {
-                        uint32_t p_key[4];
-                        drms_get_p_key( tk->p_drms, p_key );
+        if( !p_next )
+            break;
 
-                        for( size_t i_pos = tk->p_skcr->data.p_skcr->i_init; i_pos < p_block->i_buffer; )
-                        {
-                            int n = __MIN( tk->p_skcr->data.p_skcr->i_encr, p_block->i_buffer - i_pos );
-                            drms_decrypt( tk->p_drms, (uint32_t*)&p_block->p_buffer[i_pos], n, p_key );
-                            i_pos += n;
-                            i_pos += __MIN( tk->p_skcr->data.p_skcr->i_decr, p_block->i_buffer - i_pos );
-                        }
-                    }
-                    else
-                    {
-                        drms_decrypt( tk->p_drms, (uint32_t*)p_block->p_buffer,
-                                      p_block->i_buffer, NULL );
-                    }
-                }
-                else if( tk->fmt.i_cat == SPU_ES )
-                {
-                    if( tk->fmt.i_codec == VLC_FOURCC( 's', 'u', 'b', 't' ) &&
-                        p_block->i_buffer >= 2 )
-                    {
-                        size_t i_size = GetWBE( p_block->p_buffer );
+        mp4_reader_t *p_reader = p_next->p_reader;
+        block_t *p_block;
 
-                        if( i_size + 2 <= p_block->i_buffer )
-                        {
-                            char *p;
-                            /* remove the length field, and append a '\0' */
-                            memmove( &p_block->p_buffer[0],
-                                     &p_block->p_buffer[2], i_size );
-                            p_block->p_buffer[i_size] = '\0';
-                            p_block->i_buffer = i_size + 1;
-
-                            /* convert \r -> \n */
-                            while( ( p = strchr((char *) p_block->p_buffer, '\r' ) ) )
-                            {
-                                *p = '\n';
-                            }
-                        }
-                        else
-                        {
-                            /* Invalid */
-                            p_block->i_buffer = 0;
-                        }
-                    }
-                }
-                /* dts */
-                p_block->i_dts = VLC_TS_0 + MP4_TrackGetDTS( p_demux, tk );
-                /* pts */
-                i_delta = MP4_TrackGetPTSDelta( tk );
-                if( i_delta != -1 )
-                    p_block->i_pts = p_block->i_dts + i_delta;
-                else if( tk->fmt.i_cat != VIDEO_ES )
-                    p_block->i_pts = p_block->i_dts;
-                else
-                    p_block->i_pts = VLC_TS_INVALID;
+        vlc_mutex_lock( &p_reader->lock );
+        p_block = p_reader->p_first;
+        p_reader->p_first = p_block->p_next;
+        if( !p_reader->p_first )
+            p_reader->pp_last = &p_reader->p_first;
+        p_reader->i_size -= p_block->i_buffer;
+        p_reader->i_count--;
+        vlc_cond_broadcast( &p_reader->wait );
+        vlc_mutex_unlock( &p_reader->lock );
 
-                if( !tk->b_drms || ( tk->b_drms && tk->p_drms ) )
-                    es_out_Send( p_demux->out, tk->p_es, p_block );
-            }
+        p_block->p_next = NULL;
+        es_out_Send( p_demux->out, p_next->p_es, p_block );
+    }
+}
 
-            /* Next sample */
-            if( MP4_TrackNextSample( p_demux, tk ) )
-                break;
+/*****************************************************************************
+ * Fragmented files: the fragments are read one at a time, and their samples
+ * are read in file order, so that the stream is only read forward.
+ *****************************************************************************/
+static MP4_Box_data_trex_t *FragGetTrex( demux_sys_t *p_sys,
+                                         uint32_t i_track_ID )
+{
+    MP4_Box_t *p_mvex = MP4_BoxGet( p_sys->p_root, "/moov/mvex" );
+
+    for( MP4_Box_t *p_box = p_mvex ? p_mvex->p_first : NULL; p_box != NULL;
+         p_box = p_box->p_next )
+    {
+        if( p_box->i_type == ATOM_trex && p_box->data.p_trex &&
+            p_box->data.p_trex->i_track_ID == i_track_ID )
+            return p_box->data.p_trex;
+    }
+    return NULL;
+}
+
+/* Returns the first box of the given type from p_box on, skipping the
+ * leaf boxes that could not be parsed */
+static MP4_Box_t *FragNextBox( MP4_Box_t *p_box, uint32_t i_type )
+{
+    while( p_box && ( p_box->i_type != i_type ||
+                      ( !p_box->data.p_data && !p_box->p_first ) ) )
+        p_box = p_box->p_next;
+    return p_box;
+}
+
+static MP4_Box_data_tfhd_t *FragGetTfhd( MP4_Box_t *p_traf )
+{
+    MP4_Box_t *p_tfhd = FragNextBox( p_traf->p_first, ATOM_tfhd );
+    return p_tfhd ? p_tfhd->data.p_tfhd : NULL;
+}
+
+static uint32_t FragSampleSize( const MP4_Box_data_tfhd_t *tfhd,
+                                const MP4_Box_data_trex_t *trex,
+                                const MP4_Box_data_trun_t *trun,
+                                uint32_t i_sample )
+{
+    if( trun->i_flags & MP4_TRUN_SAMPLE_SIZE )
+        return trun->p_samples[i_sample].i_size;
+    if( tfhd->i_flags & MP4_TFHD_DFLT_SAMPLE_SIZE )
+        return tfhd->i_default_sample_size;
+    return trex ? trex->i_default_sample_size : 0;
+}
+
+static uint32_t FragSampleDuration( const MP4_Box_data_tfhd_t *tfhd,
+                                    const MP4_Box_data_trex_t *trex,
+                                    const MP4_Box_data_trun_t *trun,
+                                    uint32_t i_sample )
+{
+    if( trun->i_flags & MP4_TRUN_SAMPLE_DURATION )
+        return trun->p_samples[i_sample].i_duration;
+    if( tfhd->i_flags & MP4_TFHD_DFLT_SAMPLE_DURATION )
+        return tfhd->i_default_sample_duration;
+    return trex ? trex->i_default_sample_duration : 0;
+}
+
+/* Returns the base data offset of a traf: the explicit one, else the moof
+ * for the first traf, else the end of the data of the previous traf */
+static uint64_t FragTrafBase( demux_sys_t *p_sys, MP4_Box_t *p_traf )
+{
+    uint64_t i_end = p_sys->p_moof->i_pos;
+
+    for( MP4_Box_t *p_box = FragNextBox( p_sys->p_moof->p_first, ATOM_traf );
+         p_box != NULL; p_box = FragNextBox( p_box->p_next, ATOM_traf ) )
+    {
+        MP4_Box_data_tfhd_t *tfhd = FragGetTfhd( p_box );
+        if( !tfhd )
+            continue;
+
+        uint64_t i_base = i_end;
+        if( tfhd->i_flags & MP4_TFHD_BASE_DATA_OFFSET )
+            i_base = tfhd->i_base_data_offset;
+        else if( tfhd->i_flags & MP4_TFHD_DEFAULT_BASE_IS_MOOF )
+            i_base = p_sys->p_moof->i_pos;
+        if( p_box == p_traf )
+            return i_base;
+
+        const MP4_Box_data_trex_t *trex = FragGetTrex( p_sys, tfhd->i_track_ID );
+        i_end = i_base;
+        for( MP4_Box_t *p_trun = FragNextBox( p_box->p_first, ATOM_trun );
+             p_trun != NULL; p_trun = FragNextBox( p_trun->p_next, ATOM_trun ) )
+        {
+            const MP4_Box_data_trun_t *trun = p_trun->data.p_trun;
+
+            if( trun->i_flags & MP4_TRUN_DATA_OFFSET )
+                i_end = i_base + (int32_t)trun->i_data_offset;
+            for( uint32_t i = 0; i < trun->i_sample_count; i++ )
+                i_end += FragSampleSize( tfhd, trex, trun, i );
+        }
+    }
+    return i_end;
+}
+
+static void FragEnterTrun( demux_t *, mp4_track_t *, MP4_Box_t * );
+
+/* Moves the track to its first sample in the trafs starting at p_traf */
+static void FragEnterTraf( demux_t *p_demux, mp4_track_t *p_track,
+                           MP4_Box_t *p_traf )
+{
+    mp4_fragpos_t *p_pos = &p_track->frag;
+    MP4_Box_data_tfhd_t *tfhd = NULL;
+
+    for( p_traf = FragNextBox( p_traf, ATOM_traf ); p_traf != NULL;
+         p_traf = FragNextBox( p_traf->p_next, ATOM_traf ) )
+    {
+        tfhd = FragGetTfhd( p_traf );
+        if( tfhd && tfhd->i_track_ID == p_track->i_track_ID )
+            break;
+    }
+    p_pos->p_traf = p_traf;
+    if( !p_traf )
+        return;
+
+    MP4_Box_t *p_tfdt = FragNextBox( p_traf->p_first, ATOM_tfdt );
+    if( p_tfdt )
+        p_pos->i_dts = p_tfdt->data.p_tfdt->i_base_media_decode_time;
+
+    p_pos->p_tfhd = tfhd;
+    p_pos->i_base = p_pos->i_offset = FragTrafBase( p_demux->p_sys, p_traf );
+    FragEnterTrun( p_demux, p_track, FragNextBox( p_traf->p_first, ATOM_trun ) );
+}
+
+/* Moves the track to the first sample of the truns starting at p_trun */
+static void FragEnterTrun( demux_t *p_demux, mp4_track_t *p_track,
+                           MP4_Box_t *p_trun )
+{
+    mp4_fragpos_t *p_pos = &p_track->frag;
+
+    for( ; p_trun != NULL; p_trun = FragNextBox( p_trun->p_next, ATOM_trun ) )
+    {
+        const MP4_Box_data_trun_t *trun = p_trun->data.p_trun;
+
+        if( trun->i_flags & MP4_TRUN_DATA_OFFSET )
+            p_pos->i_offset = p_pos->i_base + (int32_t)trun->i_data_offset;
+        if( trun->i_sample_count > 0 )
+        {
+            p_pos->p_trun = p_trun;
+            p_pos->i_sample = 0;
+            return;
+        }
+    }
+    FragEnterTraf( p_demux, p_track, p_pos->p_traf->p_next );
+}
+
+static void FragNextSample( demux_t *p_demux, mp4_track_t *p_track )
+{
+    mp4_fragpos_t *p_pos = &p_track->frag;
+    const MP4_Box_data_trun_t *trun = p_pos->p_trun->data.p_trun;
+
+    p_pos->i_offset += FragSampleSize( p_pos->p_tfhd, p_track->p_trex,
+                                       trun, p_pos->i_sample );
+    p_pos->i_dts += FragSampleDuration( p_pos->p_tfhd, p_track->p_trex,
+                                        trun, p_pos->i_sample );
+    if( ++p_pos->i_sample >= trun->i_sample_count )
+        FragEnterTrun( p_demux, p_track,
+                       FragNextBox( p_pos->p_trun->p_next, ATOM_trun ) );
+}
+
+/* Replaces the current fragment by the next one */
+static int FragLoadNext( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    MP4_Box_t box;
+
+    for( unsigned i = 0; i < p_sys->i_tracks; i++ )
+    {
+        mp4_track_t *tk = &p_sys->track[i];
+        tk->frag.p_traf = NULL;
+        tk->frag.i_dts = tk->i_frag_end_dts;
+    }
+    MP4_BoxFree( p_demux->s, p_sys->p_moof );
+    p_sys->p_moof = NULL;
+
+    if( stream_Tell( p_demux->s ) != (int64_t)p_sys->i_frag_next &&
+        stream_Seek( p_demux->s, p_sys->i_frag_next ) )
+        return VLC_EGENERIC;
+
+    p_sys->p_moof = MP4_BoxGetNextFragment( p_demux->s, p_sys->p_root );
+    if( !p_sys->p_moof )
+        return VLC_EGENERIC;
+
+    /* the samples are usually in the following mdat */
+    p_sys->i_frag_next = p_sys->p_moof->i_pos + p_sys->p_moof->i_size;
+    if( MP4_ReadBoxCommon( p_demux->s, &box ) && box.i_type == ATOM_mdat &&
+        box.i_size >= 8 )
+        p_sys->i_frag_next = box.i_pos + box.i_size;
+
+    for( unsigned i = 0; i < p_sys->i_tracks; i++ )
+    {
+        mp4_track_t *tk = &p_sys->track[i];
+
+        if( !tk->b_ok || tk->b_chapter )
+            continue;
+
+        FragEnterTraf( p_demux, tk, p_sys->p_moof->p_first );
+
+        /* find where the track ends, for the next fragment */
+        const mp4_fragpos_t pos = tk->frag;
+        while( tk->frag.p_traf )
+            FragNextSample( p_demux, tk );
+        tk->i_frag_end_dts = tk->frag.i_dts;
+        tk->frag = pos;
+    }
+    return VLC_SUCCESS;
+}
+
+/* Sends the lowest dts of the selected tracks as PCR */
+static void FragUpdatePCR( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    mtime_t i_pcr = -1;
+
+    for( unsigned i = 0; i < p_sys->i_tracks; i++ )
+    {
+        mp4_track_t *tk = &p_sys->track[i];
+
+        if( !tk->b_ok || tk->b_chapter || !tk->b_selected )
+            continue;
+
+        const uint64_t i_dts = tk->frag.p_traf ? tk->frag.i_dts :
+                                                 tk->i_frag_end_dts;
+        const mtime_t i_time = INT64_C(1000000) * i_dts / tk->i_timescale;
+        if( i_pcr < 0 || i_time < i_pcr )
+            i_pcr = i_time;
+    }
+
+    if( i_pcr > p_sys->i_pcr )
+    {
+        p_sys->i_pcr = i_pcr;
+        p_sys->i_time = i_pcr * p_sys->i_timescale / 1000000;
+        es_out_Control( p_demux->out, ES_OUT_SET_PCR, VLC_TS_0 + i_pcr );
+    }
+}
+
+static int DemuxFrag( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    mp4_track_t *tk = NULL;
+
+    for( unsigned i = 0; i < p_sys->i_tracks; i++ )
+    {
+        mp4_track_t *p_track = &p_sys->track[i];
+
+        if( !p_track->b_ok || p_track->b_chapter )
+            continue;
+
+        es_out_Control( p_demux->out, ES_OUT_GET_ES_STATE, p_track->p_es,
+                        &p_track->b_selected );
+
+        if( p_track->frag.p_traf &&
+            ( !tk || p_track->frag.i_offset < tk->frag.i_offset ) )
+            tk = p_track;
+    }
+
+    if( !tk )
+    {
+        if( FragLoadNext( p_demux ) )
+            return 0;
+        return 1;
+    }
+
+    const mp4_fragpos_t *p_pos = &tk->frag;
+    const MP4_Box_data_trun_t *trun = p_pos->p_trun->data.p_trun;
+    const uint32_t i_size = FragSampleSize( p_pos->p_tfhd, tk->p_trex, trun,
+                                            p_pos->i_sample );
+
+    if( tk->b_selected && i_size > 0 )
+    {
+        block_t *p_block;
+
+        if( stream_Seek( p_demux->s, p_pos->i_offset ) ||
+            !( p_block = stream_Block( p_demux->s, i_size ) ) )
+        {
+            msg_Warn( p_demux, "track[0x%x] cannot read sample (eof?)",
+                      tk->i_track_ID );
+            return 0;
         }
+
+        p_block->i_dts = VLC_TS_0 +
+            INT64_C(1000000) * p_pos->i_dts / tk->i_timescale;
+        if( trun->i_flags & MP4_TRUN_SAMPLE_TIME_OFFSET )
+        {
+            int64_t i_offset = trun->p_samples[p_pos->i_sample].i_composition_time_offset;
+            if( trun->i_version == 1 )
+                i_offset = (int32_t)i_offset;
+            p_block->i_pts = p_block->i_dts +
+                INT64_C(1000000) * i_offset / (int64_t)tk->i_timescale;
+        }
+        else if( tk->fmt.i_cat != VIDEO_ES )
+            p_block->i_pts = p_block->i_dts;
+        else
+            p_block->i_pts = VLC_TS_INVALID;
+
+        FragUpdatePCR( p_demux );
+        es_out_Send( p_demux->out, tk->p_es, p_block );
     }
 
+    FragNextSample( p_demux, tk );
     return 1;
 }
 
+static int FragSeek( demux_t *p_demux, mtime_t i_date )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    bool b_seekable;
+
+    stream_Control( p_demux->s, STREAM_CAN_SEEK, &b_seekable );
+    if( !b_seekable )
+        return VLC_EGENERIC;
+
+    /* Go through the fragments from the first one, up to the one that
+     * contains i_date, only reading their moof */
+    p_sys->i_frag_next = p_sys->i_frag_first;
+    for( unsigned i = 0; i < p_sys->i_tracks; i++ )
+        p_sys->track[i].i_frag_end_dts = 0;
+
+    while( !FragLoadNext( p_demux ) )
+    {
+        bool b_found = false;
+
+        for( unsigned i = 0; i < p_sys->i_tracks; i++ )
+        {
+            mp4_track_t *tk = &p_sys->track[i];
+
+            if( tk->frag.p_traf &&
+                (mtime_t)( INT64_C(1000000) * tk->i_frag_end_dts /
+                           tk->i_timescale ) > i_date )
+                b_found = true;
+        }
+        if( b_found )
+            break;
+    }
+
+    p_sys->i_pcr = -1;
+    p_sys->i_time = i_date * p_sys->i_timescale / 1000000;
+    es_out_Control( p_demux->out, ES_OUT_SET_NEXT_DISPLAY_TIME, i_date );
+
+    return VLC_SUCCESS;
+}
+
 static void MP4_UpdateSeekpoint( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
@@ -792,6 +1495,9 @@ static int Seek( demux_t *p_demux, mtime_t i_date )
     demux_sys_t *p_sys = p_demux->p_sys;
     unsigned int i_track;
 
+    if( p_sys->b_fragmented )
+        return FragSeek( p_demux, i_date );
+
     /* First update update global time */
     p_sys->i_time = i_date * p_sys->i_timescale / 1000000;
     p_sys->i_pcr  = i_date;
@@ -800,6 +1506,7 @@ static int Seek( demux_t *p_demux, mtime_t i_date )
     for( i_track = 0; i_track < p_sys->i_tracks; i_track++ )
     {
         mp4_track_t *tk = &p_sys->track[i_track];
+        MP4_ReaderStop( tk );
         MP4_TrackSeek( p_demux, tk, i_date );
     }
     MP4_UpdateSeekpoint( p_demux );
@@ -1064,6 +1771,10 @@ static void Close ( vlc_object_t * p_this )
 
     msg_Dbg( p_demux, "freeing all memory" );
 
+    for( i_track = 0; i_track < p_sys->i_tracks; i_track++ )
+        MP4_ReaderStop( &p_sys->track[i_track] );
+
+    MP4_BoxFree( p_demux->s, p_sys->p_moof );
     MP4_BoxFree( p_demux->s, p_sys->p_root );
     for( i_track = 0; i_track < p_sys->i_tracks; i_track++ )
     {
@@ -1212,10 +1923,6 @@ static int TrackCreateChunksIndex( demux_t *p_demux,
         ck->i_offset = p_co64->data.p_co64->i_chunk_offset[i_chunk];
 
         ck->i_first_dts = 0;
-        ck->p_sample_count_dts = NULL;
-        ck->p_sample_delta_dts = NULL;
-        ck->p_sample_count_pts = NULL;
-        ck->p_sample_offset_pts = NULL;
     }
 
     /* now we read index for SampleEntry( soun vide mp4a mp4v ...)
@@ -1270,13 +1977,6 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
     MP4_Box_data_stts_t *stts;
     /* TODO use also stss and stsh table for seeking */
     /* FIXME use edit table */
-    int64_t i_sample;
-    int64_t i_chunk;
-
-    int64_t i_index;
-    int64_t i_index_sample_used;
-
-    int64_t i_next_dts;
 
     /* Find stsz
      *  Gives the sample size for each samples. There is also a stz2 table
@@ -1301,8 +2001,20 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
     }
     stts = p_box->data.p_stts;
 
-    /* Use stsz table to create a sample number -> sample size table */
     p_demux_track->i_sample_count = stsz->i_sample_count;
+    p_demux_track->p_stts = stts;
+    p_box = MP4_BoxGet( p_demux_track->p_stbl, "ctts" );
+    p_demux_track->p_ctts = p_box ? p_box->data.p_ctts : NULL;
+    p_demux_track->cursor.i_chunk = UINT32_MAX;
+    if( p_demux->b_preparsing )
+    {
+        /* The tables are only needed to read the samples */
+        p_demux_track->i_sample_size = stsz->i_sample_size;
+        p_demux_track->p_sample_size = NULL;
+        return VLC_SUCCESS;
+    }
+
+    /* Use stsz table as the sample number -> sample size table */
     if( stsz->i_sample_size )
     {
         /* 1: all sample have the same size, so no need to construct a table */
@@ -1313,151 +2025,46 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
     {
         /* 2: each sample can have a different size */
         p_demux_track->i_sample_size = 0;
-        p_demux_track->p_sample_size =
-            calloc( p_demux_track->i_sample_count, sizeof( uint32_t ) );
-        if( p_demux_track->p_sample_size == NULL )
-            return VLC_ENOMEM;
-
-        for( i_sample = 0; i_sample < p_demux_track->i_sample_count; i_sample++ )
-        {
-            p_demux_track->p_sample_size[i_sample] =
-                    stsz->i_entry_size[i_sample];
-        }
+        p_demux_track->p_sample_size = stsz->i_entry_size;
     }
 
-    /* Use stts table to create a sample number -> dts table.
-     * XXX: if we don't want to waste too much memory, we can't expand
-     *  the box! so each chunk will contain an "extract" of this table
-     *  for fast research (problem with raw stream where a sample is sometime
-     *  just channels*bits_per_sample/8 */
+    /* Record where each chunk starts in the stts and ctts tables; the dts
+     * and pts of the samples are resolved from there when they are read.
+     * Expanding the tables would waste too much memory (problem with raw
+     * stream where a sample is sometime just channels*bits_per_sample/8) */
+    mp4_run_t dts_run = { 0, 0 };
+    mp4_run_t pts_run = { 0, 0 };
+    int64_t i_next_dts = 0;
 
-    i_next_dts = 0;
-    i_index = 0; i_index_sample_used = 0;
-    for( i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
+    for( uint32_t i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
     {
         mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-        int64_t i_entry, i_sample_count, i;
 
-        /* save first dts */
         ck->i_first_dts = i_next_dts;
-        ck->i_last_dts  = i_next_dts;
-
-        /* count how many entries are needed for this chunk
-         * for p_sample_delta_dts and p_sample_count_dts */
-        i_sample_count = ck->i_sample_count;
-
-        i_entry = 0;
-        while( i_sample_count > 0 )
+        ck->dts_run = dts_run;
+        if( ck->i_sample_count > 0 )
         {
-            i_sample_count -= stts->i_sample_count[i_index+i_entry];
-            /* don't count already used sample in this entry */
-            if( i_entry == 0 )
-                i_sample_count += i_index_sample_used;
-
-            i_entry++;
+            i_next_dts += RunSkip( &dts_run, stts->i_entry_count,
+                                   stts->i_sample_count, stts->i_sample_delta,
+                                   ck->i_sample_count - 1 );
+            ck->i_last_dts = i_next_dts;
+            i_next_dts += RunSkip( &dts_run, stts->i_entry_count,
+                                   stts->i_sample_count, stts->i_sample_delta,
+                                   1 );
         }
+        else
+            ck->i_last_dts = i_next_dts;
 
-        /* allocate them */
-        ck->p_sample_count_dts = calloc( i_entry, sizeof( uint32_t ) );
-        ck->p_sample_delta_dts = calloc( i_entry, sizeof( uint32_t ) );
-
-        if( !ck->p_sample_count_dts || !ck->p_sample_delta_dts )
-            return VLC_ENOMEM;
-
-        /* now copy */
-        i_sample_count = ck->i_sample_count;
-        for( i = 0; i < i_entry; i++ )
-        {
-            int64_t i_used;
-            int64_t i_rest;
-
-            i_rest = stts->i_sample_count[i_index] - i_index_sample_used;
-
-            i_used = __MIN( i_rest, i_sample_count );
-
-            i_index_sample_used += i_used;
-            i_sample_count -= i_used;
-            i_next_dts += i_used * stts->i_sample_delta[i_index];
-
-            ck->p_sample_count_dts[i] = i_used;
-            ck->p_sample_delta_dts[i] = stts->i_sample_delta[i_index];
-            if( i_used > 0 )
-                ck->i_last_dts = i_next_dts - ck->p_sample_delta_dts[i];
-
-            if( i_index_sample_used >= stts->i_sample_count[i_index] )
-            {
-                i_index++;
-                i_index_sample_used = 0;
-            }
-        }
+        ck->pts_run = pts_run;
+        if( p_demux_track->p_ctts )
+            RunSkip( &pts_run, p_demux_track->p_ctts->i_entry_count,
+                     p_demux_track->p_ctts->i_sample_count, NULL,
+                     ck->i_sample_count );
     }
 
-    /* Find ctts
-     *  Gives the delta between decoding time (dts) and composition table (pts)
-     */
-    p_box = MP4_BoxGet( p_demux_track->p_stbl, "ctts" );
-    if( p_box )
-    {
-        MP4_Box_data_ctts_t *ctts = p_box->data.p_ctts;
-
+    if( p_demux_track->p_ctts )
         msg_Warn( p_demux, "CTTS table" );
 
-        /* Create pts-dts table per chunk */
-        i_index = 0; i_index_sample_used = 0;
-        for( i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
-        {
-            mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-            int64_t i_entry, i_sample_count, i;
-
-            /* count how many entries are needed for this chunk
-             * for p_sample_delta_dts and p_sample_count_dts */
-            i_sample_count = ck->i_sample_count;
-
-            i_entry = 0;
-            while( i_sample_count > 0 )
-            {
-                i_sample_count -= ctts->i_sample_count[i_index+i_entry];
-
-                /* don't count already used sample in this entry */
-                if( i_entry == 0 )
-                    i_sample_count += i_index_sample_used;
-
-                i_entry++;
-            }
-
-            /* allocate them */
-            ck->p_sample_count_pts = calloc( i_entry, sizeof( uint32_t ) );
-            ck->p_sample_offset_pts = calloc( i_entry, sizeof( int32_t ) );
-            if( !ck->p_sample_count_pts || !ck->p_sample_offset_pts )
-                return VLC_ENOMEM;
-
-            /* now copy */
-            i_sample_count = ck->i_sample_count;
-            for( i = 0; i < i_entry; i++ )
-            {
-                int64_t i_used;
-                int64_t i_rest;
-
-                i_rest = ctts->i_sample_count[i_index] -
-                    i_index_sample_used;
-
-                i_used = __MIN( i_rest, i_sample_count );
-
-                i_index_sample_used += i_used;
-                i_sample_count -= i_used;
-
-                ck->p_sample_count_pts[i] = i_used;
-                ck->p_sample_offset_pts[i] = ctts->i_sample_offset[i_index];
-
-                if( i_index_sample_used >= ctts->i_sample_count[i_index] )
-                {
-                    i_index++;
-                    i_index_sample_used = 0;
-                }
-            }
-        }
-    }
-
     msg_Dbg( p_demux, "track[Id 0x%x] read %d samples length:%"PRId64"s",
              p_demux_track->i_track_ID, p_demux_track->i_sample_count,
              i_next_dts / p_demux_track->i_timescale );
@@ -1465,6 +2072,29 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
     return VLC_SUCCESS;
 }
 
+/* The samples of a fragmented file are described by the fragments, the
+ * track only gets a chunk for the sample description */
+static int TrackCreateFragmented( demux_t *p_demux,
+                                  mp4_track_t *p_demux_track )
+{
+    p_demux_track->p_trex = FragGetTrex( p_demux->p_sys,
+                                         p_demux_track->i_track_ID );
+
+    p_demux_track->chunk = calloc( 1, sizeof( mp4_chunk_t ) );
+    if( p_demux_track->chunk == NULL )
+        return VLC_ENOMEM;
+    p_demux_track->i_chunk_count = 1;
+    p_demux_track->chunk[0].i_sample_description_index =
+        p_demux_track->p_trex &&
+        p_demux_track->p_trex->i_default_sample_description_index ?
+        p_demux_track->p_trex->i_default_sample_description_index : 1;
+
+    p_demux_track->i_sample_count = 0;
+    p_demux_track->i_sample_size = 0;
+    p_demux_track->p_sample_size = NULL;
+    return VLC_SUCCESS;
+}
+
 /**
  * It computes the sample rate for a video track using the given sample
  * description index
@@ -2107,7 +2737,6 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
     uint64_t     i_dts;
     unsigned int i_sample;
     unsigned int i_chunk;
-    int          i_index;
 
     /* FIXME see if it's needed to check p_track->i_chunk_count */
     if( p_track->i_chunk_count == 0 )
@@ -2151,49 +2780,48 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
         i_start = i_start * p_track->i_timescale / (int64_t)1000000;
     }
 
-    /* we start from sample 0/chunk 0, hope it won't take too much time */
     /* *** find good chunk *** */
-    for( i_chunk = 0; ; i_chunk++ )
-    {
-        if( i_chunk + 1 >= p_track->i_chunk_count )
-        {
-            /* at the end and can't check if i_start in this chunk,
-               it will be check while searching i_sample */
-            i_chunk = p_track->i_chunk_count - 1;
-            break;
-        }
-
-        if( (uint64_t)i_start >= p_track->chunk[i_chunk].i_first_dts &&
-            (uint64_t)i_start <  p_track->chunk[i_chunk + 1].i_first_dts )
-        {
-            break;
-        }
+    /* the last one starting at or before i_start (the first one starts at
+     * 0); if i_start is beyond it, it will be checked while searching
+     * i_sample */
+    unsigned int i_low = 0, i_high = p_track->i_chunk_count;
+    while( i_high - i_low > 1 )
+    {
+        unsigned int i_mid = ( i_low + i_high ) / 2;
+        if( (uint64_t)i_start < p_track->chunk[i_mid].i_first_dts )
+            i_high = i_mid;
+        else
+            i_low = i_mid;
     }
+    i_chunk = i_low;
 
     /* *** find sample in the chunk *** */
-    i_sample = p_track->chunk[i_chunk].i_sample_first;
-    i_dts    = p_track->chunk[i_chunk].i_first_dts;
-    for( i_index = 0; i_sample < p_track->chunk[i_chunk].i_sample_count; )
+    const mp4_chunk_t *ck = &p_track->chunk[i_chunk];
+    MP4_Box_data_stts_t *stts = p_track->p_stts;
+    mp4_run_t run = ck->dts_run;
+    uint32_t i_left = ck->i_sample_count;
+
+    i_sample = ck->i_sample_first;
+    i_dts    = ck->i_first_dts;
+    RunSkip( &run, stts->i_entry_count, stts->i_sample_count, NULL, 0 );
+    while( i_left > 0 && run.i_index < stts->i_entry_count )
     {
-        if( i_dts +
-            p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-            p_track->chunk[i_chunk].p_sample_delta_dts[i_index] < (uint64_t)i_start )
-        {
-            i_dts    +=
-                p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
+        uint32_t i_count = __MIN( stts->i_sample_count[run.i_index] - run.i_used,
+                                  i_left );
+        uint32_t i_delta = stts->i_sample_delta[run.i_index];
 
-            i_sample += p_track->chunk[i_chunk].p_sample_count_dts[i_index];
-            i_index++;
+        if( i_dts + (uint64_t)i_count * i_delta < (uint64_t)i_start )
+        {
+            i_dts    += RunSkip( &run, stts->i_entry_count,
+                                 stts->i_sample_count, stts->i_sample_delta,
+                                 i_count );
+            i_sample += i_count;
+            i_left   -= i_count;
         }
         else
         {
-            if( p_track->chunk[i_chunk].p_sample_delta_dts[i_index] <= 0 )
-            {
-                break;
-            }
-            i_sample += ( i_start - i_dts ) /
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
+            if( i_delta > 0 && (uint64_t)i_start > i_dts )
+                i_sample += ( i_start - i_dts ) / i_delta;
             break;
         }
     }
@@ -2485,8 +3113,13 @@ static void MP4_TrackCreate( demux_t *p_demux, mp4_track_t *p_track,
     }
 
     /* Create chunk index table and sample index table */
-    if( TrackCreateChunksIndex( p_demux,p_track  ) ||
-        TrackCreateSamplesIndex( p_demux, p_track ) )
+    if( p_sys->b_fragmented )
+    {
+        if( TrackCreateFragmented( p_demux, p_track ) )
+            return;
+    }
+    else if( TrackCreateChunksIndex( p_demux,p_track  ) ||
+             TrackCreateSamplesIndex( p_demux, p_track ) )
     {
         return; /* cannot create chunks index */
     }
@@ -2552,31 +3185,14 @@ static void MP4_TrackCreate( demux_t *p_demux, mp4_track_t *p_track,
  ****************************************************************************/
 static void MP4_TrackDestroy( mp4_track_t *p_track )
 {
-    unsigned int i_chunk;
-
     p_track->b_ok = false;
     p_track->b_enable   = false;
     p_track->b_selected = false;
 
     es_format_Clean( &p_track->fmt );
 
-    for( i_chunk = 0; i_chunk < p_track->i_chunk_count; i_chunk++ )
-    {
-        if( p_track->chunk )
-        {
-           FREENULL(p_track->chunk[i_chunk].p_sample_count_dts);
-           FREENULL(p_track->chunk[i_chunk].p_sample_delta_dts );
-
-           FREENULL(p_track->chunk[i_chunk].p_sample_count_pts);
-           FREENULL(p_track->chunk[i_chunk].p_sample_offset_pts );
-        }
-    }
     FREENULL( p_track->chunk );
-
-    if( !p_track->i_sample_size )
-    {
-        FREENULL( p_track->p_sample_size );
-    }
+    p_track->p_sample_size = NULL;
 }
 
 static int MP4_TrackSelect( demux_t *p_demux, mp4_track_t *p_track,
@@ -2700,7 +3316,6 @@ static int MP4_TrackSampleSize( mp4_track_t *p_track )
 
 static uint64_t MP4_TrackGetPos( mp4_track_t *p_track )
 {
-    unsigned int i_sample;
     uint64_t i_pos;
 
     i_pos = p_track->chunk[p_track->i_chunk].i_offset;
@@ -2726,11 +3341,8 @@ static uint64_t MP4_TrackGetPos( mp4_track_t *p_track )
     }
     else
     {
-        for( i_sample = p_track->chunk[p_track->i_chunk].i_sample_first;
-             i_sample < p_track->i_sample; i_sample++ )
-        {
-            i_pos += p_track->p_sample_size[i_sample];
-        }
+        MP4_TrackUpdateCursor( p_track );
+        i_pos = p_track->cursor.i_pos;
     }
 
     return i_pos;
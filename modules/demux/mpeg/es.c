@@ -38,6 +38,7 @@
 #include <vlc_input.h>
 
 #include "../../codec/a52.h"
+#include "../seekindex.h"
 
 /*****************************************************************************
  * Module descriptor
@@ -116,6 +117,12 @@ struct demux_sys_t
 
     float   f_fps;
 
+    /* Seek index. Times are only recorded while they are exact, that is
+     * until the first seek */
+    seekindex_t *p_index;
+    bool        b_index_exact;
+    mtime_t     i_index_time;   /* Time of the next frame after a seek */
+
     /* Mpga specific */
     struct
     {
@@ -182,6 +189,8 @@ static int OpenCommon( demux_t *p_demux,
     p_sys->b_big_endian = false;
     p_sys->f_fps = var_InheritFloat( p_demux, "es-fps" );
     p_sys->p_packetized_data = NULL;
+    p_sys->b_index_exact = true;
+    p_sys->i_index_time = -1;
 
     if( stream_Seek( p_demux->s, p_sys->i_stream_offset ) )
     {
@@ -213,6 +222,8 @@ static int OpenCommon( demux_t *p_demux,
         if( p_sys->p_packetized_data )
             break;
     }
+
+    p_sys->p_index = seekindex_New( p_demux, "es" );
     return VLC_SUCCESS;
 }
 static int OpenAudio( vlc_object_t *p_this )
@@ -260,12 +271,17 @@ static int Demux( demux_t *p_demux )
     demux_sys_t *p_sys = p_demux->p_sys;
 
     block_t *p_block_out = p_sys->p_packetized_data;
+    int64_t i_index_pos = -1;
     if( p_block_out )
         p_sys->p_packetized_data = NULL;
     else
+    {
+        if( p_sys->p_index && p_sys->b_index_exact )
+            i_index_pos = stream_Tell( p_demux->s );
         ret = Parse( p_demux, &p_block_out ) ? 0 : 1;
+    }
 
-    while( p_block_out )
+    for( int i_frame = 0; p_block_out; i_frame++ )
     {
         block_t *p_next = p_block_out->p_next;
 
@@ -283,6 +299,17 @@ static int Demux( demux_t *p_demux )
             p_sys->i_pts = p_block_out->i_pts - VLC_TS_0;
         }
 
+        if( p_sys->i_index_time >= 0 )
+        {
+            /* First frame after a seek through the index */
+            p_sys->i_time_offset = p_sys->i_index_time - p_sys->i_pts;
+            p_sys->i_index_time = -1;
+        }
+        /* The first frame of the block started before it: the second one
+         * is found first when seeking to the block */
+        if( i_index_pos >= 0 && i_frame == 1 && p_sys->b_index_exact )
+            seekindex_Add( p_sys->p_index, p_sys->i_pts, i_index_pos );
+
         if( p_block_out->i_pts > VLC_TS_INVALID )
         {
             p_block_out->i_pts += p_sys->i_time_offset;
@@ -317,6 +344,8 @@ static void Close( vlc_object_t * p_this )
     if( p_sys->p_packetized_data )
         block_ChainRelease( p_sys->p_packetized_data );
     demux_PacketizerDestroy( p_sys->p_packetizer );
+    if( p_sys->p_index )
+        seekindex_Delete( p_demux, p_sys->p_index );
     free( p_sys );
 }
 
@@ -369,12 +398,38 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
             return i_ret;
 
         case DEMUX_SET_TIME:
+            if( p_sys->p_index )
+            {
+                mtime_t i_time;
+                int64_t i_pos;
+
+                if( !seekindex_Lookup( p_sys->p_index,
+                                       va_arg( args_save, int64_t ),
+                                       &i_time, &i_pos ) &&
+                    !stream_Seek( p_demux->s, i_pos ) )
+                {
+                    p_sys->i_index_time = i_time;
+                    p_sys->b_index_exact = false;
+                    if( p_sys->p_packetized_data )
+                        block_ChainRelease( p_sys->p_packetized_data );
+                    p_sys->p_packetized_data = NULL;
+                    va_end( args_save );
+                    return VLC_SUCCESS;
+                }
+            }
             /* FIXME TODO: implement a high precision seek (with mp3 parsing)
              * needed for multi-input */
+            /* fall through */
         default:
             i_ret = demux_vaControlHelper( p_demux->s, p_sys->i_stream_offset, -1,
                                             p_sys->i_bitrate_avg, 1, i_query,
                                             args );
+            if( !i_ret &&
+                (i_query == DEMUX_SET_POSITION || i_query == DEMUX_SET_TIME) )
+            {
+                p_sys->b_index_exact = false;
+                p_sys->i_index_time = -1;
+            }
             if( !i_ret && p_sys->i_bitrate_avg > 0 &&
                 (i_query == DEMUX_SET_POSITION || i_query == DEMUX_SET_TIME) )
             {
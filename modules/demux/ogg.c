@@ -121,6 +121,7 @@ static int  Control( demux_t *, int, va_list );
 
 /* Bitstream manipulation */
 static int  Ogg_ReadPage     ( demux_t *, ogg_page * );
+static void Ogg_ResetStreams ( demux_sys_t * );
 static void Ogg_UpdatePCR    ( logical_stream_t *, ogg_packet * );
 static void Ogg_DecodePacket ( demux_t *, logical_stream_t *, ogg_packet * );
 static int  Ogg_OpusPacketDuration( logical_stream_t *, ogg_packet * );
@@ -300,6 +301,10 @@ static int Demux( demux_t * p_demux )
                 continue;
             }
 
+            oggseek_page_cache_add( p_stream,
+                                    ogg_page_granulepos( &p_sys->current_page ),
+                                    p_sys->i_page_pos );
+
         }
 
         while( ogg_stream_packetout( &p_stream->os, &oggpacket ) > 0 )
@@ -458,7 +463,51 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
             return VLC_SUCCESS;
 
         case DEMUX_SET_TIME:
-            return VLC_EGENERIC;
+        {
+            int64_t i_time = (int64_t)va_arg( args, int64_t );
+            bool b_precise = (bool)va_arg( args, int );
+            logical_stream_t *p_stream = NULL;
+
+            /* same restriction as DEMUX_SET_POSITION; video streams need a
+               keyframe search which is left to the position fallback */
+            if( p_sys->i_bos > 0 )
+                return VLC_EGENERIC;
+
+            for( i = 0; i < p_sys->i_streams; i++ )
+            {
+                logical_stream_t *p_cur = p_sys->pp_stream[i];
+
+                if( p_cur->fmt.i_cat == VIDEO_ES )
+                    return VLC_EGENERIC;
+                if( p_stream == NULL && p_cur->f_rate > 0 &&
+                    ( p_cur->fmt.i_codec == VLC_CODEC_VORBIS ||
+                      p_cur->fmt.i_codec == VLC_CODEC_OPUS ||
+                      p_cur->fmt.i_codec == VLC_CODEC_SPEEX ||
+                      p_cur->fmt.i_codec == VLC_CODEC_FLAC ) )
+                    p_stream = p_cur;
+            }
+            if( p_stream == NULL || i_time < 0 )
+                return VLC_EGENERIC;
+
+            /* Opus needs 80 ms of preroll to converge */
+            int64_t i_target = i_time;
+            if( p_stream->fmt.i_codec == VLC_CODEC_OPUS )
+                i_target = __MAX( i_target - 80000, 0 );
+            int64_t i_granule = i_target * p_stream->f_rate / CLOCK_FREQ +
+                                p_stream->i_pre_skip;
+
+            int64_t i_pagepos = oggseek_find_granule( p_demux, p_stream,
+                                                      i_granule );
+
+            Ogg_ResetStreams( p_sys );
+            if( stream_Seek( p_demux->s, i_pagepos ) )
+                return VLC_EGENERIC;
+
+            if( b_precise )
+                es_out_Control( p_demux->out, ES_OUT_SET_NEXT_DISPLAY_TIME,
+                                VLC_TS_0 + i_time );
+            return VLC_SUCCESS;
+        }
 
         case DEMUX_GET_ATTACHMENTS:
         {
@@ -485,18 +534,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
                 return VLC_EGENERIC;
             }
 
-            for( i = 0; i < p_sys->i_streams; i++ )
-            {
-                logical_stream_t *p_stream = p_sys->pp_stream[i];
-
-                /* we'll trash all the data until we find the next pcr */
-                p_stream->b_reinit = true;
-                p_stream->i_pcr = -1;
-                p_stream->i_interpolated_pcr = -1;
-                p_stream->i_previous_granulepos = -1;
-                ogg_stream_reset( &p_stream->os );
-            }
-            ogg_sync_reset( &p_sys->oy );
+            Ogg_ResetStreams( p_sys );
             return demux_vaControlHelper( p_demux->s, 0, -1, p_sys->i_bitrate,
                                           1, i_query, args );
         case DEMUX_GET_LENGTH:
@@ -514,6 +552,27 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
     }
 }
 
+/****************************************************************************
+ * Ogg_ResetStreams: drop the pending data of all the logical streams before
+ *                   a seek.
+ ****************************************************************************/
+static void Ogg_ResetStreams( demux_sys_t *p_sys )
+{
+    for( int i = 0; i < p_sys->i_streams; i++ )
+    {
+        logical_stream_t *p_stream = p_sys->pp_stream[i];
+
+        /* we'll trash all the data until we find the next pcr */
+        p_stream->b_reinit = true;
+        p_stream->i_pcr = -1;
+        p_stream->i_interpolated_pcr = -1;
+        p_stream->i_previous_granulepos = -1;
+        ogg_stream_reset( &p_stream->os );
+    }
+    ogg_sync_reset( &p_sys->oy );
+    p_sys->b_page_waiting = false;
+}
+
 /****************************************************************************
  * Ogg_ReadPage: Read a full Ogg page from the physical bitstream.
  ****************************************************************************
@@ -537,6 +596,10 @@ static int Ogg_ReadPage( demux_t *p_demux, ogg_page *p_oggpage )
         ogg_sync_wrote( &p_ogg->oy, i_read );
     }
 
+    p_ogg->i_page_pos = stream_Tell( p_demux->s ) -
+                        ( p_ogg->oy.fill - p_ogg->oy.returned ) -
+                        p_oggpage->header_len - p_oggpage->body_len;
+
     return VLC_SUCCESS;
 }
 
@@ -1072,6 +1135,7 @@ static int Ogg_FindLogicalStreams( demux_t *p_demux )
                 p_stream->i_skip_frames = 0;
 
                 p_stream->i_data_start = 0;
+                p_stream->p_page_cache = NULL;
 
                 es_format_Init( &p_stream->fmt, 0, 0 );
                 es_format_Init( &p_stream->fmt_old, 0, 0 );
@@ -1631,6 +1695,8 @@ static void Ogg_LogicalStreamDelete( demux_t *p_demux, logical_stream_t *p_strea
         oggseek_index_entries_free( p_stream->idx );
     }
 
+    oggseek_page_cache_free( p_stream->p_page_cache );
+
     free( p_stream );
 }
 /**
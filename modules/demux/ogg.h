@@ -35,6 +35,7 @@
 
 
 typedef struct oggseek_index_entry demux_index_entry_t;
+typedef struct oggseek_page_cache oggseek_page_cache_t;
 
 
 typedef struct logical_stream_s
@@ -77,6 +78,9 @@ typedef struct logical_stream_s
     /* keyframe index for seeking, created as we discover keyframes */
     demux_index_entry_t *idx;
 
+    /* page offsets for seeking, cached as we read pages */
+    oggseek_page_cache_t *p_page_cache;
+
     /* skip some frames after a seek */
     int i_skip_frames;
 
@@ -128,8 +132,9 @@ struct demux_sys_t
     /* offset position in file (for reading) */
     int64_t i_input_position;
 
-    /* current page being parsed */
+    /* current page being parsed, and its offset in the file */
     ogg_page current_page;
+    int64_t i_page_pos;
 
     mtime_t i_st_pts;
 
@@ -177,6 +177,82 @@ const demux_index_entry_t *oggseek_theora_index_entry_add ( logical_stream_t *p_
 
 
 
+/************************************************************
+* page cache
+*************************************************************/
+
+/* return the index of the first cached page ending at or after i_granule */
+
+static int page_cache_search( const oggseek_page_cache_t *p_cache, int64_t i_granule )
+{
+    int i_low = 0, i_high = p_cache->i_count;
+
+    while ( i_low < i_high )
+    {
+        int i_mid = ( i_low + i_high ) / 2;
+        if ( p_cache->p_pages[i_mid].i_granule < i_granule )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+    return i_low;
+}
+
+
+/* remember that the page of p_stream at i_pagepos ends at i_granule; pages that
+   do not fit between their neighbours (chained or broken streams) are ignored */
+
+void oggseek_page_cache_add ( logical_stream_t *p_stream, int64_t i_granule,
+                              int64_t i_pagepos )
+{
+    oggseek_page_cache_t *p_cache = p_stream->p_page_cache;
+
+    if ( i_granule < 0 || i_pagepos < 0 ) return;
+
+    if ( p_cache == NULL )
+    {
+        p_cache = p_stream->p_page_cache = calloc( 1, sizeof( *p_cache ) );
+        if ( p_cache == NULL ) return;
+    }
+
+    int i = page_cache_search( p_cache, i_granule );
+
+    if ( i > 0 && p_cache->p_pages[i-1].i_pagepos >= i_pagepos ) return;
+    if ( i < p_cache->i_count &&
+         ( p_cache->p_pages[i].i_granule == i_granule ||
+           p_cache->p_pages[i].i_pagepos <= i_pagepos ) ) return;
+
+    if ( p_cache->i_count >= p_cache->i_alloc )
+    {
+        if ( p_cache->i_alloc >= OGGSEEK_CACHE_MAX ) return;
+
+        int i_alloc = p_cache->i_alloc ? 2 * p_cache->i_alloc : 256;
+        void *p_pages = realloc( p_cache->p_pages,
+                                 i_alloc * sizeof( *p_cache->p_pages ) );
+        if ( p_pages == NULL ) return;
+        p_cache->p_pages = p_pages;
+        p_cache->i_alloc = i_alloc;
+    }
+
+    memmove( &p_cache->p_pages[i+1], &p_cache->p_pages[i],
+             ( p_cache->i_count - i ) * sizeof( *p_cache->p_pages ) );
+    p_cache->p_pages[i].i_granule = i_granule;
+    p_cache->p_pages[i].i_pagepos = i_pagepos;
+    p_cache->i_count++;
+}
+
+
+void oggseek_page_cache_free ( oggseek_page_cache_t *p_cache )
+{
+    if ( p_cache == NULL ) return;
+
+    free( p_cache->p_pages );
+    free( p_cache );
+}
+
+
+
+
 /*********************************************************************
  * private functions
  **********************************************************************/
@@ -717,6 +793,65 @@ static int64_t get_last_frame ( demux_t *p_demux, logical_stream_t *p_stream )
 
 
 
+/* read the pages from i_pos, caching them, until a page of p_stream with a
+   granulepos; return its offset, or -1 if there is none starting before i_limit */
+
+static int64_t find_granule_page( demux_t *p_demux, logical_stream_t *p_stream,
+                                  int64_t i_pos, int64_t i_limit,
+                                  int64_t *pi_granule )
+{
+    demux_sys_t *p_sys  = p_demux->p_sys;
+    ogg_page page;
+
+    seek_byte( p_demux, i_pos );
+    if ( stream_Tell( p_demux->s ) != i_pos ) return -1;
+
+    while ( i_pos < i_limit )
+    {
+        long i_result = ogg_sync_pageseek( &p_sys->oy, &page );
+
+        if ( i_result == 0 )
+        {
+            /* need more data */
+            char *buf = ogg_sync_buffer( &p_sys->oy, OGGSEEK_BYTES_TO_READ );
+            int i_read = stream_Read( p_demux->s, buf, OGGSEEK_BYTES_TO_READ );
+            if ( i_read <= 0 ) return -1;
+            ogg_sync_wrote( &p_sys->oy, i_read );
+            continue;
+        }
+
+        if ( i_result < 0 )
+        {
+            /* skipped bytes before a page */
+            i_pos -= i_result;
+            continue;
+        }
+
+        int64_t i_granule = ogg_page_granulepos( &page );
+        if ( i_granule >= 0 )
+        {
+            for ( int i = 0; i < p_sys->i_streams; i++ )
+            {
+                logical_stream_t *p_other = p_sys->pp_stream[i];
+                if ( p_other->os.serialno == ogg_page_serialno( &page ) )
+                    oggseek_page_cache_add( p_other, i_granule, i_pos );
+            }
+
+            if ( p_stream->os.serialno == ogg_page_serialno( &page ) )
+            {
+                *pi_granule = i_granule;
+                return i_pos;
+            }
+        }
+
+        i_pos += i_result;
+    }
+
+    return -1;
+}
+
+
+
 /************************************************************************
  * public functions
  *************************************************************************/
@@ -856,6 +991,90 @@ int oggseek_find_frame ( demux_t *p_demux, logical_stream_t *p_stream, int64_t i
 
 
 
+/* find the offset of a page of p_stream (which must have sample granules) from
+   which reading reaches i_granule within OGGSEEK_BYTES_TO_READ bytes.
+ *
+ * The search starts from the closest cached pages around i_granule and goes on
+ * by interpolation of the granulepos between the bounds, falling back to
+ * bisection; every page read is added to the cache, so that the next seeks
+ * read less.
+ */
+
+int64_t oggseek_find_granule ( demux_t *p_demux, logical_stream_t *p_stream,
+                               int64_t i_granule )
+{
+    demux_sys_t *p_sys  = p_demux->p_sys;
+    const oggseek_page_cache_t *p_cache;
+
+    /* lower bound: a page ending before i_granule, upper bound: one ending after */
+    int64_t i_pos_lower = p_stream->i_data_start;
+    int64_t i_pos_upper = p_sys->i_total_length;
+    int64_t i_granule_lower = 0;
+    int64_t i_granule_upper = -1;
+    int i_reads = 0;
+
+    if ( ( p_cache = p_stream->p_page_cache ) != NULL )
+    {
+        int i = page_cache_search( p_cache, i_granule );
+
+        if ( i > 0 && p_cache->p_pages[i-1].i_pagepos >= i_pos_lower )
+        {
+            i_pos_lower = p_cache->p_pages[i-1].i_pagepos;
+            i_granule_lower = p_cache->p_pages[i-1].i_granule;
+        }
+        if ( i < p_cache->i_count && p_cache->p_pages[i].i_pagepos > i_pos_lower )
+        {
+            i_pos_upper = p_cache->p_pages[i].i_pagepos;
+            i_granule_upper = p_cache->p_pages[i].i_granule;
+        }
+    }
+
+    while ( i_pos_upper - i_pos_lower > OGGSEEK_BYTES_TO_READ )
+    {
+        int64_t i_range = i_pos_upper - i_pos_lower;
+        int64_t i_pos = i_pos_lower + i_range / 2;
+        int64_t i_found;
+
+        if ( i_granule_upper > i_granule_lower )
+        {
+            /* guess from the granulepos, but keep away from the bounds */
+            i_pos = i_pos_lower + i_range * ( i_granule - i_granule_lower ) /
+                                  ( i_granule_upper - i_granule_lower );
+            if ( i_pos < i_pos_lower + i_range / 8 )
+                i_pos = i_pos_lower + i_range / 8;
+            if ( i_pos > i_pos_upper - i_range / 8 )
+                i_pos = i_pos_upper - i_range / 8;
+        }
+
+        int64_t i_pagepos = find_granule_page( p_demux, p_stream, i_pos,
+                                               i_pos_upper, &i_found );
+        i_reads++;
+
+        if ( i_pagepos < 0 )
+        {
+            /* no page of the stream after i_pos */
+            i_pos_upper = i_pos;
+            i_granule_upper = -1;
+        }
+        else if ( i_found < i_granule )
+        {
+            i_pos_lower = i_pagepos;
+            i_granule_lower = i_found;
+        }
+        else
+        {
+            i_pos_upper = i_pagepos;
+            i_granule_upper = i_found;
+        }
+    }
+
+    msg_Dbg( p_demux, "found granulepos %"PRId64" at offset %"PRId64" in %d reads",
+             i_granule, i_pos_lower, i_reads );
+    return i_pos_lower;
+}
+
+
+
 /****************************************************************************
  * oggseek_read_page: Read a full Ogg page from the physical bitstream.
  ****************************************************************************
@@ -49,6 +49,23 @@ struct oggseek_index_entry
     int64_t i_pagepos_end;
 };
 
+/* Maximum number of pages remembered per logical stream */
+#define OGGSEEK_CACHE_MAX (1 << 18)
+
+/* this is typedefed to oggseek_page_cache_t in ogg.h
+ * The pages of a logical stream met while playing or seeking, sorted by
+ * granulepos: the granulepos at the end of the page -> page offset */
+struct oggseek_page_cache
+{
+    int i_count;
+    int i_alloc;
+    struct
+    {
+        int64_t i_granule;
+        int64_t i_pagepos;
+    } *p_pages;
+};
+
 
 
 
@@ -58,6 +75,13 @@ const demux_index_entry_t *oggseek_theora_index_entry_add ( logical_stream_t *,
 
 void oggseek_index_entries_free ( demux_index_entry_t * );
 
+void oggseek_page_cache_add ( logical_stream_t *, int64_t i_granule,
+                              int64_t i_pagepos );
+
+void oggseek_page_cache_free ( oggseek_page_cache_t * );
+
+int64_t oggseek_find_granule ( demux_t *, logical_stream_t *, int64_t i_granule );
+
 int64_t oggseek_get_last_frame ( demux_t *, logical_stream_t *);
 
 int oggseek_find_frame ( demux_t *, logical_stream_t *, int64_t i_tframe );
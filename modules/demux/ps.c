@@ -34,6 +34,7 @@
 #include <vlc_demux.h>
 
 #include "ps.h"
+#include "seekindex.h"
 
 /* TODO:
  *  - re-add pre-scanning.
@@ -92,6 +93,10 @@ struct demux_sys_t
     bool  b_lost_sync;
     bool  b_have_pack;
     bool  b_seekable;
+
+    /* Seek index, and offset of the pack waiting for its first PTS */
+    seekindex_t *p_index;
+    int64_t     i_index_pos;
 };
 
 static int Demux  ( demux_t *p_demux );
@@ -145,6 +150,9 @@ static int OpenCommon( vlc_object_t *p_this, bool b_force )
 
     stream_Control( p_demux->s, STREAM_CAN_SEEK, &p_sys->b_seekable );
 
+    p_sys->p_index = seekindex_New( p_demux, "ps" );
+    p_sys->i_index_pos = -1;
+
     ps_psm_init( &p_sys->psm );
     ps_track_init( p_sys->tk );
 
@@ -184,6 +192,8 @@ static void Close( vlc_object_t *p_this )
 
     ps_psm_destroy( &p_sys->psm );
 
+    if( p_sys->p_index )
+        seekindex_Delete( p_demux, p_sys->p_index );
     free( p_sys );
 }
 
@@ -308,6 +318,9 @@ static int Demux( demux_t *p_demux )
     if( p_sys->i_length < 0 && p_sys->b_seekable )
         FindLength( p_demux );
 
+    if( i_code == 0x1ba && p_sys->p_index )
+        p_sys->i_index_pos = stream_Tell( p_demux->s );
+
     if( ( p_pkt = ps_pkt_read( p_demux->s, i_code ) ) == NULL )
     {
         return 0;
@@ -418,6 +431,16 @@ static int Demux( demux_t *p_demux )
                     es_out_Control( p_demux->out, ES_OUT_SET_PCR, p_pkt->i_pts );
                 }
 
+                /* After seeking to the pack, the first PTS gives the time */
+                if( p_sys->i_index_pos >= 0 && p_sys->i_time_track >= 0 &&
+                    p_pkt->i_pts > VLC_TS_INVALID )
+                {
+                    seekindex_Add( p_sys->p_index, (int64_t)p_pkt->i_pts -
+                                   p_sys->tk[p_sys->i_time_track].i_first_pts,
+                                   p_sys->i_index_pos );
+                    p_sys->i_index_pos = -1;
+                }
+
                 if( (int64_t)p_pkt->i_pts > p_sys->i_current_pts )
                 {
                     p_sys->i_current_pts = (int64_t)p_pkt->i_pts;
@@ -469,6 +492,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
             f = (double) va_arg( args, double );
             i64 = stream_Size( p_demux->s );
             p_sys->i_current_pts = 0;
+            p_sys->i_index_pos = -1;
 
             return stream_Seek( p_demux->s, (int64_t)(i64 * f) );
 
@@ -506,6 +530,19 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         case DEMUX_SET_TIME:
             i64 = (int64_t)va_arg( args, int64_t );
+            if( p_sys->p_index && p_sys->i_time_track >= 0 )
+            {
+                mtime_t i_time;
+                int64_t i_pos;
+
+                if( !seekindex_Lookup( p_sys->p_index, i64, &i_time, &i_pos ) &&
+                    !stream_Seek( p_demux->s, i_pos ) )
+                {
+                    p_sys->i_current_pts = 0;
+                    p_sys->i_index_pos = -1;
+                    return VLC_SUCCESS;
+                }
+            }
             if( p_sys->i_time_track >= 0 && p_sys->i_current_pts > 0 )
             {
                 int64_t i_now = p_sys->i_current_pts - p_sys->tk[p_sys->i_time_track].i_first_pts;
@@ -515,6 +552,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
                     return i64 ? VLC_EGENERIC : VLC_SUCCESS;
 
                 p_sys->i_current_pts = 0;
+                p_sys->i_index_pos = -1;
                 i_pos *= (float)i64 / (float)i_now;
                 stream_Seek( p_demux->s, i_pos );
                 return VLC_SUCCESS;
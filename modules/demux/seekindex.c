@@ -0,0 +1,299 @@
+/*****************************************************************************
+ * seekindex.c: persistent time to offset index for demuxers
+ *****************************************************************************
+ * Copyright (C) 2012 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_fs.h>
+#include <vlc_md5.h>
+
+#include <sys/stat.h>
+
+#include "seekindex.h"
+
+/* File layout: magic, entry count, then (time, offset) pairs, all big
+ * endian 64-bits values */
+#define SEEKINDEX_MAGIC "VLCSIDX1"
+#define SEEKINDEX_HEADER_SIZE 16
+#define SEEKINDEX_ENTRY_SIZE 16
+
+/* Do not use an entry further than this before the requested time */
+#define SEEKINDEX_MAX_GAP (2 * SEEKINDEX_INTERVAL)
+
+/* Upper bound on the number of entries (about 290 hours) */
+#define SEEKINDEX_MAX_COUNT (1 << 20)
+
+typedef struct
+{
+    mtime_t i_time;
+    int64_t i_offset;
+} seekindex_entry_t;
+
+struct seekindex_t
+{
+    char              *psz_path;
+    int64_t            i_size;
+
+    int                i_count;
+    int                i_alloc;
+    seekindex_entry_t *p_entries;
+
+    bool               b_dirty;
+};
+
+/* Returns the index of the first entry at or after i_time */
+static int Search( const seekindex_t *p_index, mtime_t i_time )
+{
+    int i_low = 0, i_high = p_index->i_count;
+
+    while( i_low < i_high )
+    {
+        int i_mid = (i_low + i_high) / 2;
+        if( p_index->p_entries[i_mid].i_time < i_time )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+    return i_low;
+}
+
+/* Inserts an entry, unless it is too close to its neighbours or does not
+ * fit between them (timestamp discontinuity) */
+static bool Insert( seekindex_t *p_index, mtime_t i_time, int64_t i_offset )
+{
+    if( i_time < 0 || i_offset < 0 || i_offset >= p_index->i_size
+     || p_index->i_count >= SEEKINDEX_MAX_COUNT )
+        return false;
+
+    int i = Search( p_index, i_time );
+    const seekindex_entry_t *p_prev = i > 0 ? &p_index->p_entries[i-1] : NULL;
+    const seekindex_entry_t *p_next = i < p_index->i_count ?
+                                      &p_index->p_entries[i] : NULL;
+
+    if( p_prev && ( i_time - p_prev->i_time < SEEKINDEX_INTERVAL
+                 || i_offset <= p_prev->i_offset ) )
+        return false;
+    if( p_next && ( p_next->i_time - i_time < SEEKINDEX_INTERVAL
+                 || i_offset >= p_next->i_offset ) )
+        return false;
+
+    if( p_index->i_count >= p_index->i_alloc )
+    {
+        int i_alloc = p_index->i_alloc ? 2 * p_index->i_alloc : 256;
+        seekindex_entry_t *p_entries =
+            realloc( p_index->p_entries, i_alloc * sizeof( *p_entries ) );
+        if( !p_entries )
+            return false;
+        p_index->p_entries = p_entries;
+        p_index->i_alloc = i_alloc;
+    }
+
+    memmove( &p_index->p_entries[i+1], &p_index->p_entries[i],
+             (p_index->i_count - i) * sizeof( *p_index->p_entries ) );
+    p_index->p_entries[i].i_time = i_time;
+    p_index->p_entries[i].i_offset = i_offset;
+    p_index->i_count++;
+    return true;
+}
+
+static void Load( demux_t *p_demux, seekindex_t *p_index )
+{
+    FILE *file = vlc_fopen( p_index->psz_path, "rb" );
+    if( !file )
+        return;
+
+    uint8_t p_buf[SEEKINDEX_ENTRY_SIZE];
+    uint64_t i_count;
+
+    if( fread( p_buf, SEEKINDEX_HEADER_SIZE, 1, file ) != 1
+     || memcmp( p_buf, SEEKINDEX_MAGIC, 8 ) )
+        goto error;
+
+    i_count = GetQWBE( &p_buf[8] );
+    if( i_count > SEEKINDEX_MAX_COUNT )
+        goto error;
+
+    for( uint64_t i = 0; i < i_count; i++ )
+    {
+        if( fread( p_buf, SEEKINDEX_ENTRY_SIZE, 1, file ) != 1 )
+            goto error;
+        /* Entries that do not fit are dropped; the index rebuilds them */
+        Insert( p_index, GetQWBE( &p_buf[0] ), GetQWBE( &p_buf[8] ) );
+    }
+    fclose( file );
+
+    msg_Dbg( p_demux, "loaded %d seek index entries", p_index->i_count );
+    return;
+
+error:
+    msg_Warn( p_demux, "ignoring invalid seek index %s", p_index->psz_path );
+    fclose( file );
+    p_index->i_count = 0;
+    p_index->b_dirty = true;
+}
+
+/* Creates the directories leading to the index file */
+static void CreateDir( char *psz_path )
+{
+    for( char *psz = strchr( psz_path + 1, DIR_SEP_CHAR ); psz != NULL;
+         psz = strchr( psz + 1, DIR_SEP_CHAR ) )
+    {
+        *psz = '\0';
+        vlc_mkdir( psz_path, 0700 );
+        *psz = DIR_SEP_CHAR;
+    }
+}
+
+static void Save( demux_t *p_demux, seekindex_t *p_index )
+{
+    char *psz_tmp;
+
+    CreateDir( p_index->psz_path );
+
+    if( asprintf( &psz_tmp, "%s.tmp", p_index->psz_path ) == -1 )
+        return;
+
+    FILE *file = vlc_fopen( psz_tmp, "wb" );
+    if( !file )
+    {
+        msg_Warn( p_demux, "cannot create %s (%m)", psz_tmp );
+        free( psz_tmp );
+        return;
+    }
+
+    uint8_t p_buf[SEEKINDEX_ENTRY_SIZE];
+    bool b_error;
+
+    memcpy( p_buf, SEEKINDEX_MAGIC, 8 );
+    SetQWBE( &p_buf[8], p_index->i_count );
+    b_error = fwrite( p_buf, SEEKINDEX_HEADER_SIZE, 1, file ) != 1;
+
+    for( int i = 0; i < p_index->i_count && !b_error; i++ )
+    {
+        SetQWBE( &p_buf[0], p_index->p_entries[i].i_time );
+        SetQWBE( &p_buf[8], p_index->p_entries[i].i_offset );
+        b_error = fwrite( p_buf, SEEKINDEX_ENTRY_SIZE, 1, file ) != 1;
+    }
+    b_error |= fclose( file ) != 0;
+
+    /* Replace the previous index atomically */
+    if( b_error || vlc_rename( psz_tmp, p_index->psz_path ) )
+    {
+        msg_Warn( p_demux, "cannot write seek index %s", p_index->psz_path );
+        vlc_unlink( psz_tmp );
+    }
+    else
+        msg_Dbg( p_demux, "saved %d seek index entries", p_index->i_count );
+    free( psz_tmp );
+}
+
+/* Computes the name of the index file, from what identifies the file */
+static char *GetPath( demux_t *p_demux, const char *psz_tag, int64_t i_size )
+{
+    struct md5_s md5;
+    struct stat st;
+    char psz_size[32];
+
+    InitMD5( &md5 );
+    AddMD5( &md5, psz_tag, strlen( psz_tag ) + 1 );
+    AddMD5( &md5, p_demux->psz_access, strlen( p_demux->psz_access ) + 1 );
+    AddMD5( &md5, p_demux->psz_location, strlen( p_demux->psz_location ) + 1 );
+    snprintf( psz_size, sizeof( psz_size ), "%"PRId64, i_size );
+    AddMD5( &md5, psz_size, strlen( psz_size ) + 1 );
+    /* A local file that got rewritten with the same size gets a new index */
+    if( p_demux->psz_file && !vlc_stat( p_demux->psz_file, &st ) )
+        AddMD5( &md5, &st.st_mtime, sizeof( st.st_mtime ) );
+    EndMD5( &md5 );
+
+    char *psz_hash = psz_md5_hash( &md5 );
+    char *psz_dir = config_GetUserDir( VLC_CACHE_DIR );
+    char *psz_path = NULL;
+
+    if( psz_hash && psz_dir
+     && asprintf( &psz_path, "%s"DIR_SEP"seekindex"DIR_SEP"%s",
+                  psz_dir, psz_hash ) == -1 )
+        psz_path = NULL;
+    free( psz_dir );
+    free( psz_hash );
+    return psz_path;
+}
+
+seekindex_t *seekindex_New( demux_t *p_demux, const char *psz_tag )
+{
+    bool b_seekable = false;
+
+    if( p_demux->b_preparsing || !var_InheritBool( p_demux, "demux-seek-index" ) )
+        return NULL;
+
+    stream_Control( p_demux->s, STREAM_CAN_SEEK, &b_seekable );
+    int64_t i_size = stream_Size( p_demux->s );
+    if( !b_seekable || i_size <= 0 )
+        return NULL;
+
+    seekindex_t *p_index = malloc( sizeof( *p_index ) );
+    if( !p_index )
+        return NULL;
+
+    p_index->psz_path = GetPath( p_demux, psz_tag, i_size );
+    if( !p_index->psz_path )
+    {
+        free( p_index );
+        return NULL;
+    }
+    p_index->i_size = i_size;
+    p_index->i_count = 0;
+    p_index->i_alloc = 0;
+    p_index->p_entries = NULL;
+    p_index->b_dirty = false;
+
+    Load( p_demux, p_index );
+    return p_index;
+}
+
+void seekindex_Delete( demux_t *p_demux, seekindex_t *p_index )
+{
+    if( p_index->b_dirty )
+        Save( p_demux, p_index );
+    free( p_index->p_entries );
+    free( p_index->psz_path );
+    free( p_index );
+}
+
+void seekindex_Add( seekindex_t *p_index, mtime_t i_time, int64_t i_offset )
+{
+    if( Insert( p_index, i_time, i_offset ) )
+        p_index->b_dirty = true;
+}
+
+int seekindex_Lookup( const seekindex_t *p_index, mtime_t i_time,
+                      mtime_t *pi_time, int64_t *pi_offset )
+{
+    int i = Search( p_index, i_time + 1 ) - 1;
+
+    if( i < 0 || i_time - p_index->p_entries[i].i_time > SEEKINDEX_MAX_GAP )
+        return VLC_EGENERIC;
+
+    *pi_time = p_index->p_entries[i].i_time;
+    *pi_offset = p_index->p_entries[i].i_offset;
+    return VLC_SUCCESS;
+}
@@ -0,0 +1,64 @@
+/*****************************************************************************
+ * seekindex.h: persistent time to offset index for demuxers
+ *****************************************************************************
+ * Copyright (C) 2012 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_DEMUX_SEEKINDEX_H
+#define VLC_DEMUX_SEEKINDEX_H 1
+
+/* Demuxers of formats without an index (MPEG-PS, MPEG-TS, elementary
+ * streams) can only seek by bisection or by guessing from the bitrate.
+ * A seek index remembers, for a given file, the byte offsets at which
+ * playback reached known times. It is filled while playing, kept in the
+ * user cache directory, and loaded again on the next open of the file.
+ *
+ * Entries must be such that, after seeking to the offset, the demuxer
+ * reports the time of the entry again. */
+
+typedef struct seekindex_t seekindex_t;
+
+/* Interval between two index entries */
+#define SEEKINDEX_INTERVAL (CLOCK_FREQ)
+
+/**
+ * Loads (or creates) the index for the stream of a demuxer.
+ * \param psz_tag identifies the demuxer, whose times are not comparable
+ * with the other demuxers' ones
+ * \return NULL if the index is disabled or the stream cannot seek
+ */
+seekindex_t *seekindex_New( demux_t *, const char *psz_tag );
+
+/**
+ * Saves the index if it changed, and frees it.
+ */
+void seekindex_Delete( demux_t *, seekindex_t * );
+
+/**
+ * Records that i_time is reached at i_offset. Entries closer than
+ * SEEKINDEX_INTERVAL to an existing one are ignored.
+ */
+void seekindex_Add( seekindex_t *, mtime_t i_time, int64_t i_offset );
+
+/**
+ * Finds the latest entry at or before i_time.
+ * \return VLC_EGENERIC if there is none close enough to i_time
+ */
+int seekindex_Lookup( const seekindex_t *, mtime_t i_time,
+                      mtime_t *pi_time, int64_t *pi_offset );
+
+#endif
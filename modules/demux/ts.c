@@ -45,6 +45,7 @@
 #include <vlc_fs.h>        /* vlc_fopen for file-dump mode */
 
 #include "../mux/mpeg/csa.h"
+#include "seekindex.h"
 
 /* Include dvbpsi headers */
 # include <dvbpsi/dvbpsi.h>
@@ -143,6 +144,13 @@ static void Close ( vlc_object_t * );
     "Seek and position based on a percent byte position, not a PCR generated " \
     "time position. If seeking doesn't work property, turn on this option." )
 
+#define CHUNK_TEXT N_("Packets per read")
+#define CHUNK_LONGTEXT N_( \
+    "Number of TS packets read at once from live (non seekable) inputs. " \
+    "Packets are then parsed in place instead of being allocated one by " \
+    "one, which saves CPU time on high bitrate streams at the expense of " \
+    "some latency. 1 reads packets one by one.")
+
 
 vlc_module_begin ()
     set_description( N_("MPEG Transport Stream demuxer") )
@@ -172,6 +180,8 @@ vlc_module_begin ()
                  DUMPSIZE_LONGTEXT, true )
     add_bool( "ts-split-es", true, SPLIT_ES_TEXT, SPLIT_ES_LONGTEXT, false )
     add_bool( "ts-seek-percent", false, SEEK_PERCENT_TEXT, SEEK_PERCENT_LONGTEXT, true )
+    add_integer( "ts-chunk-packets", 1, CHUNK_TEXT, CHUNK_LONGTEXT, true )
+        change_integer_range( 1, 4096 )
 
     set_capability( "demux", 10 )
     set_callbacks( Open, Close )
@@ -333,6 +343,24 @@ typedef struct
 
 } ts_pid_t;
 
+typedef struct ts_chunk_t ts_chunk_t;
+
+/* A TS packet within a chunk: it shares the chunk buffer */
+typedef struct
+{
+    block_t     self;
+    ts_chunk_t *p_chunk;
+} ts_packet_t;
+
+/* Several TS packets read at once */
+struct ts_chunk_t
+{
+    block_t     *p_data;
+    unsigned    i_refs; /* packets in use, plus one while being read */
+    unsigned    i_packets; /* packets handed out */
+    ts_packet_t packets[];
+};
+
 struct demux_sys_t
 {
     vlc_mutex_t     csa_lock;
@@ -343,6 +371,11 @@ struct demux_sys_t
     /* how many TS packet we read at once */
     int         i_ts_read;
 
+    /* chunked reading (if i_chunk_packets > 1) */
+    int         i_chunk_packets;
+    ts_chunk_t  *p_chunk;
+    size_t      i_chunk_offset;
+
     /* to determine length and time */
     int         i_pid_ref_pcr;
     mtime_t     i_first_pcr;
@@ -352,10 +385,17 @@ struct demux_sys_t
     int         i_pcrs_num;
     mtime_t     *p_pcrs;
     int64_t     *p_pos;
+    seekindex_t *p_index;   /* positions of the reference PCR */
 
     /* All pid */
     ts_pid_t    pid[8192];
 
+    /* Bitmap of the pid we need to look at (all of them unless a program
+     * selection was requested), rebuilt when b_pid_filter_changed is set */
+    uint32_t    pid_wanted[8192/32];
+    bool        b_pid_filter;
+    bool        b_pid_filter_changed;
+
     /* All PMT */
     bool        b_user_pmt;
     int         i_pmt;
@@ -416,9 +456,22 @@ static inline int PIDGet( block_t *p )
     return ( (p->p_buffer[1]&0x1f)<<8 )|p->p_buffer[2];
 }
 
+static inline bool PIDWanted( const demux_sys_t *p_sys, int i_pid )
+{
+    return p_sys->pid_wanted[i_pid >> 5] & (1u << (i_pid & 31));
+}
+
+static inline void PIDSetWanted( demux_sys_t *p_sys, int i_pid )
+{
+    p_sys->pid_wanted[i_pid >> 5] |= 1u << (i_pid & 31);
+}
+static void UpdatePIDFilter( demux_t * );
+
 static bool GatherPES( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk );
 
 static block_t* ReadTSPacket( demux_t *p_demux );
+static void ChunkRelease( ts_chunk_t * );
+static void ChunkPacketRelease( block_t * );
 static mtime_t GetPCR( block_t *p_pkt );
 static int SeekToPCR( demux_t *p_demux, int64_t i_pos );
 static int Seek( demux_t *p_demux, double f_percent );
@@ -435,6 +488,7 @@ static int UserPmt( demux_t *p_demux, const char * );
 
 static int  SetPIDFilter( demux_t *, int i_pid, bool b_selected );
 static void SetPrgFilter( demux_t *, int i_prg, bool b_selected );
+static bool ProgramIsSelected( demux_t *, uint16_t i_pgrm );
 
 #define TS_PACKET_SIZE_188 188
 #define TS_PACKET_SIZE_192 192
@@ -657,6 +711,9 @@ static int Open( vlc_object_t *p_this )
     }
     /* PID 8191 is padding */
     p_sys->pid[8191].b_seen = true;
+    p_sys->b_pid_filter = false;
+    p_sys->b_pid_filter_changed = false;
+    memset( p_sys->pid_wanted, 0xff, sizeof( p_sys->pid_wanted ) );
     p_sys->i_packet_size = i_packet_size;
     p_sys->b_udp_out = false;
     p_sys->fd = -1;
@@ -813,13 +870,29 @@ static int Open( vlc_object_t *p_this )
     if( can_seek  )
     {
         GetFirstPCR( p_demux );
-        CheckPCR( p_demux );
+        /* The PCR table is only used for seeking */
+        if( !p_demux->b_preparsing )
+            CheckPCR( p_demux );
         GetLastPCR( p_demux );
     }
     if( p_sys->i_first_pcr < 0 || p_sys->i_last_pcr < 0 )
     {
         p_sys->b_force_seek_per_percent = true;
     }
+    if( !p_sys->b_force_seek_per_percent && !p_sys->b_file_out )
+        p_sys->p_index = seekindex_New( p_demux, "ts" );
+
+    /* Chunked reading breaks byte position tracking: live streams only */
+    p_sys->i_chunk_packets = var_InheritInteger( p_demux, "ts-chunk-packets" );
+    stream_Control( p_demux->s, STREAM_CAN_SEEK, &can_seek );
+    if( p_sys->i_chunk_packets > 1 )
+    {
+        if( can_seek )
+            p_sys->i_chunk_packets = 1;
+        else
+            msg_Dbg( p_demux, "reading %d packets at once",
+                     p_sys->i_chunk_packets );
+    }
 
     while( !p_sys->b_file_out && p_sys->i_pmt_es <= 0 &&
            vlc_object_alive( p_demux ) )
@@ -918,8 +991,13 @@ static void Close( vlc_object_t *p_this )
     free( p_sys->buffer );
     free( p_sys->psz_file );
 
+    if( p_sys->p_chunk )
+        ChunkRelease( p_sys->p_chunk );
+
     free( p_sys->p_pcrs );
     free( p_sys->p_pos );
+    if( p_sys->p_index )
+        seekindex_Delete( p_demux, p_sys->p_index );
 
     vlc_mutex_destroy( &p_sys->csa_lock );
     free( p_sys );
@@ -963,6 +1041,10 @@ static int DemuxFile( demux_t *p_demux )
         return i_data;
     }
 
+    /* Packets to decrypt */
+    uint8_t *pp_csa[CSA_BATCH_SIZE];
+    int i_csa = 0;
+
     /* Test continuity counter */
     for( int i_pos = 0; i_pos < i_data;  )
     {
@@ -1029,14 +1111,26 @@ static int DemuxFile( demux_t *p_demux )
         /* Test if user wants to decrypt it first */
         if( p_sys->csa )
         {
-            vlc_mutex_lock( &p_sys->csa_lock );
-            csa_Decrypt( p_demux->p_sys->csa, &p_buffer[i_pos], p_demux->p_sys->i_csa_pkt_size );
-            vlc_mutex_unlock( &p_sys->csa_lock );
+            pp_csa[i_csa++] = &p_buffer[i_pos];
+            if( i_csa == CSA_BATCH_SIZE )
+            {
+                vlc_mutex_lock( &p_sys->csa_lock );
+                csa_DecryptBatch( p_sys->csa, pp_csa, i_csa, p_sys->i_csa_pkt_size );
+                vlc_mutex_unlock( &p_sys->csa_lock );
+                i_csa = 0;
+            }
         }
 
         i_pos += p_sys->i_packet_size;
     }
 
+    if( i_csa > 0 )
+    {
+        vlc_mutex_lock( &p_sys->csa_lock );
+        csa_DecryptBatch( p_sys->csa, pp_csa, i_csa, p_sys->i_csa_pkt_size );
+        vlc_mutex_unlock( &p_sys->csa_lock );
+    }
+
     /* Then write */
     const int i_write = fwrite( p_sys->buffer, 1, i_data, p_sys->p_file );
     if( i_write < 0 )
@@ -1081,7 +1175,18 @@ static int Demux( demux_t *p_demux )
         }
 
         /* Parse the TS packet */
-        ts_pid_t *p_pid = &p_sys->pid[PIDGet( p_pkt )];
+        if( unlikely(p_sys->b_pid_filter_changed) )
+            UpdatePIDFilter( p_demux );
+
+        const int i_pid = PIDGet( p_pkt );
+        if( !PIDWanted( p_sys, i_pid ) )
+        {
+            /* Not part of the selected programs */
+            block_Release( p_pkt );
+            continue;
+        }
+
+        ts_pid_t *p_pid = &p_sys->pid[i_pid];
 
         if( p_pid->b_valid )
         {
@@ -1267,6 +1372,11 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
         p_list = (vlc_list_t *)va_arg( args, vlc_list_t * );
         msg_Dbg( p_demux, "DEMUX_SET_GROUP %d %p", i_int, p_list );
 
+        /* Only filter out the other programs on explicit selection */
+        if( i_int != 0 )
+            p_sys->b_pid_filter = i_int > 0 || p_list != NULL;
+        p_sys->b_pid_filter_changed = true;
+
         if( i_int == 0 && p_sys->i_current_program > 0 )
             i_int = p_sys->i_current_program;
 
@@ -1326,6 +1436,20 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
     case DEMUX_GET_FPS:
     case DEMUX_SET_TIME:
+    {
+        mtime_t i_time;
+
+        i64 = (int64_t)va_arg( args, int64_t );
+        if( p_sys->p_index && !p_sys->b_force_seek_per_percent &&
+            !seekindex_Lookup( p_sys->p_index, i64, &i_time, &i64 ) &&
+            !stream_Seek( p_demux->s, i64 ) )
+        {
+            p_sys->i_current_pcr = p_sys->i_first_pcr + i_time * 9 / 100;
+            return VLC_SUCCESS;
+        }
+        return VLC_EGENERIC;
+    }
+
     default:
         return VLC_EGENERIC;
     }
@@ -1519,6 +1643,59 @@ static void SetPrgFilter( demux_t *p_demux, int i_prg_id, bool b_selected )
     }
 }
 
+/**
+ * Rebuilds the bitmap of wanted PID: PSI, ES and PCR of the selected
+ * programs, and the reference PCR used for time and length.
+ */
+static void UpdatePIDFilter( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    p_sys->b_pid_filter_changed = false;
+    if( !p_sys->b_pid_filter )
+    {
+        memset( p_sys->pid_wanted, 0xff, sizeof( p_sys->pid_wanted ) );
+        return;
+    }
+    memset( p_sys->pid_wanted, 0, sizeof( p_sys->pid_wanted ) );
+
+    for( int i = 0; i < 8192; i++ )
+    {
+        const ts_pid_t *pid = &p_sys->pid[i];
+
+        if( !pid->b_valid )
+            continue;
+        if( pid->psi )
+        {
+            PIDSetWanted( p_sys, i );
+            continue;
+        }
+        for( int i_prg = 0; i_prg < pid->p_owner->i_prg; i_prg++ )
+        {
+            if( ProgramIsSelected( p_demux, pid->p_owner->prg[i_prg]->i_number ) )
+            {
+                PIDSetWanted( p_sys, i );
+                break;
+            }
+        }
+    }
+
+    for( int i = 0; i < p_sys->i_pmt; i++ )
+    {
+        const ts_psi_t *psi = p_sys->pmt[i]->psi;
+
+        for( int i_prg = 0; i_prg < psi->i_prg; i_prg++ )
+        {
+            const int i_pcr = psi->prg[i_prg]->i_pid_pcr;
+            if( i_pcr > 0 && i_pcr < 8192 &&
+                ProgramIsSelected( p_demux, psi->prg[i_prg]->i_number ) )
+                PIDSetWanted( p_sys, i_pcr );
+        }
+    }
+    if( p_sys->i_pid_ref_pcr > 0 && p_sys->i_pid_ref_pcr < 8192 )
+        PIDSetWanted( p_sys, p_sys->i_pid_ref_pcr );
+}
+
 static void PIDInit( ts_pid_t *pid, bool b_psi, ts_psi_t *p_owner )
 {
     bool b_old_valid = pid->b_valid;
@@ -1824,7 +2001,16 @@ static void ParsePES( demux_t *p_demux, ts_pid_t *pid )
 
         p_pes->i_length = i_length * 100 / 9;
 
-        p_block = block_ChainGather( p_pes );
+        if( p_pes->p_next == NULL && p_pes->pf_release == ChunkPacketRelease )
+        {
+            /* Do not send packets that share a chunk buffer */
+            p_block = block_Duplicate( p_pes );
+            block_Release( p_pes );
+            if( p_block == NULL )
+                return;
+        }
+        else
+            p_block = block_ChainGather( p_pes );
         if( pid->es->fmt.i_codec == VLC_CODEC_SUBT )
         {
             if( i_pes_size > 0 && p_block->i_buffer > i_pes_size )
@@ -1852,12 +2038,147 @@ static void ParsePES( demux_t *p_demux, ts_pid_t *pid )
     }
 }
 
+/*****************************************************************************
+ * TS packets chunks
+ *****************************************************************************/
+static void ChunkRelease( ts_chunk_t *p_chunk )
+{
+    if( --p_chunk->i_refs > 0 )
+        return;
+    block_Release( p_chunk->p_data );
+    free( p_chunk );
+}
+
+static void ChunkPacketRelease( block_t *p_block )
+{
+    ChunkRelease( ((ts_packet_t *)p_block)->p_chunk );
+}
+
+/**
+ * Reads a new chunk of packets, starting with the i_left bytes at p_left
+ * (an incomplete packet from the previous chunk).
+ */
+static ts_chunk_t *ChunkNew( demux_t *p_demux, const uint8_t *p_left,
+                             size_t i_left )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const size_t i_chunk = p_sys->i_chunk_packets * p_sys->i_packet_size;
+    block_t *p_data;
+
+    if( i_left == 0 )
+    {
+        p_data = stream_Block( p_demux->s, i_chunk );
+        if( p_data == NULL )
+            return NULL;
+    }
+    else
+    {
+        p_data = block_Alloc( i_chunk );
+        if( p_data == NULL )
+            return NULL;
+        memcpy( p_data->p_buffer, p_left, i_left );
+
+        int i_read = stream_Read( p_demux->s, p_data->p_buffer + i_left,
+                                  i_chunk - i_left );
+        if( i_read <= 0 )
+        {
+            block_Release( p_data );
+            return NULL;
+        }
+        p_data->i_buffer = i_left + i_read;
+    }
+
+    ts_chunk_t *p_chunk = malloc( sizeof( *p_chunk )
+                        + p_sys->i_chunk_packets * sizeof( ts_packet_t ) );
+    if( unlikely(p_chunk == NULL) )
+    {
+        block_Release( p_data );
+        return NULL;
+    }
+    p_chunk->p_data = p_data;
+    p_chunk->i_refs = 1;
+    p_chunk->i_packets = 0;
+    return p_chunk;
+}
+
+/**
+ * Returns the next TS packet of the current chunk, reading a new chunk if
+ * needed. The packet is not copied.
+ */
+static block_t *ReadTSChunkPacket( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const size_t i_size = p_sys->i_packet_size;
+
+    for( ;; )
+    {
+        ts_chunk_t *p_chunk = p_sys->p_chunk;
+
+        if( p_chunk == NULL )
+        {
+            p_chunk = p_sys->p_chunk = ChunkNew( p_demux, NULL, 0 );
+            p_sys->i_chunk_offset = 0;
+            if( p_chunk == NULL )
+            {
+                msg_Dbg( p_demux, "eof ?" );
+                return NULL;
+            }
+        }
+
+        const block_t *p_data = p_chunk->p_data;
+        uint8_t *p = p_data->p_buffer + p_sys->i_chunk_offset;
+        const size_t i_left = p_data->i_buffer - p_sys->i_chunk_offset;
+
+        if( i_left >= i_size )
+        {
+            if( p[0] != 0x47 )
+            {
+                /* Re-sync within the chunk */
+                size_t i_skip = 1;
+
+                msg_Warn( p_demux, "lost synchro" );
+                while( i_skip + i_size < i_left &&
+                       ( p[i_skip] != 0x47 || p[i_skip + i_size] != 0x47 ) )
+                    i_skip++;
+                if( i_skip + i_size >= i_left )
+                    i_skip = i_left - i_size + 1; /* try with next chunk */
+                msg_Dbg( p_demux, "skipping %zu bytes of garbage", i_skip );
+                p_sys->i_chunk_offset += i_skip;
+                continue;
+            }
+
+            assert( p_chunk->i_packets < (unsigned)p_sys->i_chunk_packets );
+            ts_packet_t *p_pkt = &p_chunk->packets[p_chunk->i_packets++];
+
+            block_Init( &p_pkt->self, p, i_size );
+            p_pkt->self.pf_release = ChunkPacketRelease;
+            p_pkt->p_chunk = p_chunk;
+            p_chunk->i_refs++;
+            p_sys->i_chunk_offset += i_size;
+            return &p_pkt->self;
+        }
+
+        /* Chunk exhausted: keep the incomplete packet, if any */
+        p_sys->p_chunk = ChunkNew( p_demux, p, i_left );
+        p_sys->i_chunk_offset = 0;
+        ChunkRelease( p_chunk );
+        if( p_sys->p_chunk == NULL )
+        {
+            msg_Dbg( p_demux, "eof ?" );
+            return NULL;
+        }
+    }
+}
+
 static block_t* ReadTSPacket( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
 
     block_t     *p_pkt;
 
+    if( p_sys->i_chunk_packets > 1 )
+        return ReadTSChunkPacket( p_demux );
+
     /* Get a new TS packet */
     if( !( p_pkt = stream_Block( p_demux->s, p_sys->i_packet_size ) ) )
     {
@@ -2183,6 +2504,10 @@ static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
         if( p_sys->i_pid_ref_pcr == pid->i_pid )
         {
             p_sys->i_current_pcr = AdjustPCRWrapAround( p_demux, i_pcr );
+            if( p_sys->p_index )
+                seekindex_Add( p_sys->p_index,
+                               (p_sys->i_current_pcr - p_sys->i_first_pcr) * 100 / 9,
+                               stream_Tell( p_demux->s ) - p_sys->i_packet_size );
         }
 
         /* Search program and set the PCR */
@@ -2894,6 +3219,7 @@ static void ValidateDVBMeta( demux_t *p_demux, int i_pid )
         return;
 
     msg_Warn( p_demux, "Switching to non DVB mode" );
+    p_sys->b_pid_filter_changed = true;
 
     /* This doesn't look like a DVB stream so don't try
      * parsing the SDT/EDT/TDT */
@@ -4095,6 +4421,8 @@ static void PMTCallBack( demux_t *p_demux, dvbpsi_pmt_t *p_pmt )
     int                  i_clean = 0;
     bool                 b_hdmv = false;
 
+    p_sys->b_pid_filter_changed = true;
+
     msg_Dbg( p_demux, "PMTCallBack called" );
 
     /* First find this PMT declared in PAT */
@@ -4376,6 +4704,7 @@ static void PATCallBack( demux_t *p_demux, dvbpsi_pat_t *p_pat )
     ts_pid_t             *pat = &p_sys->pid[0];
 
     msg_Dbg( p_demux, "PATCallBack called" );
+    p_sys->b_pid_filter_changed = true;
 
     if( ( pat->psi->i_pat_version != -1 &&
             ( !p_pat->b_current_next ||
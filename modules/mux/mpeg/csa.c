@@ -72,6 +72,14 @@ void csa_Delete( csa_t *c )
     free( c );
 }
 
+/*****************************************************************************
+ * csa_Copy: copies the keys (and the state) of a csa_t into another one
+ *****************************************************************************/
+void csa_Copy( csa_t *p_dst, const csa_t *p_src )
+{
+    *p_dst = *p_src;
+}
+
 /*****************************************************************************
  * csa_SetCW:
  *****************************************************************************/
@@ -610,3 +618,515 @@ static void csa_BlockCypher( uint8_t kk[57], uint8_t bd[8], uint8_t ib[8] )
     }
 }
 
+
+/*****************************************************************************
+ * Batch processing
+ *****************************************************************************
+ * The stream cypher is bitsliced: every bit of its state is kept in a 64 bits
+ * word holding that bit for 64 packets, so that one clock of the cypher
+ * is computed for all of them with a few hundred boolean operations.
+ * The block cypher is still run packet by packet.
+ *****************************************************************************/
+typedef uint64_t csa_word_t;
+
+typedef struct
+{
+    csa_word_t A[11][4];
+    csa_word_t B[11][4];
+    csa_word_t X[4], Y[4], Z[4];
+    csa_word_t D[4], E[4], F[4];
+    csa_word_t p, q, r;
+} csa_bs_t;
+
+/* In place transposition of a 64x64 bits matrix: bit c of a[r] is
+ * exchanged with bit r of a[c] */
+static void csa_Transpose( uint64_t a[64] )
+{
+    uint64_t m = UINT64_C(0x00000000FFFFFFFF);
+
+    for( int j = 32; j != 0; j >>= 1, m ^= m << j )
+    {
+        for( int k = 0; k < 64; k = ((k | j) + 1) & ~j )
+        {
+            const uint64_t t = ((a[k] >> j) ^ a[k | j]) & m;
+            a[k] ^= t << j;
+            a[k | j] ^= t;
+        }
+    }
+}
+
+/* The s-boxes of the stream cypher, in algebraic normal form (the output
+ * bits are xors of products of the input bits, m<i> being the product of the
+ * bits set in i) */
+static inline void csa_BsSbox1( csa_word_t m16, csa_word_t m8, csa_word_t m4,
+                                csa_word_t m2, csa_word_t m1, csa_word_t o[2] )
+{
+    const csa_word_t m3 = m1 & m2;
+    const csa_word_t m5 = m1 & m4;
+    const csa_word_t m6 = m2 & m4;
+    const csa_word_t m9 = m1 & m8;
+    const csa_word_t m10 = m2 & m8;
+    const csa_word_t m11 = m3 & m8;
+    const csa_word_t m12 = m4 & m8;
+    const csa_word_t m13 = m5 & m8;
+    const csa_word_t m14 = m6 & m8;
+    const csa_word_t m17 = m1 & m16;
+    const csa_word_t m19 = m3 & m16;
+    const csa_word_t m20 = m4 & m16;
+    const csa_word_t m22 = m6 & m16;
+    const csa_word_t m24 = m8 & m16;
+    const csa_word_t m26 = m10 & m16;
+    const csa_word_t m27 = m11 & m16;
+    const csa_word_t m28 = m12 & m16;
+    const csa_word_t m29 = m13 & m16;
+    const csa_word_t m30 = m14 & m16;
+    o[1] = ~(m1 ^ m2 ^ m3 ^ m5 ^ m6 ^ m9 ^ m10 ^ m12 ^ m13 ^ m14 ^ m16 ^ m19
+            ^ m20 ^ m22 ^ m24 ^ m26 ^ m27 ^ m28 ^ m30);
+    o[0] = m2 ^ m5 ^ m8 ^ m9 ^ m11 ^ m17 ^ m24 ^ m26 ^ m28 ^ m29;
+}
+
+static inline void csa_BsSbox2( csa_word_t m16, csa_word_t m8, csa_word_t m4,
+                                csa_word_t m2, csa_word_t m1, csa_word_t o[2] )
+{
+    const csa_word_t m3 = m1 & m2;
+    const csa_word_t m5 = m1 & m4;
+    const csa_word_t m6 = m2 & m4;
+    const csa_word_t m7 = m3 & m4;
+    const csa_word_t m9 = m1 & m8;
+    const csa_word_t m10 = m2 & m8;
+    const csa_word_t m11 = m3 & m8;
+    const csa_word_t m12 = m4 & m8;
+    const csa_word_t m13 = m5 & m8;
+    const csa_word_t m19 = m3 & m16;
+    const csa_word_t m20 = m4 & m16;
+    const csa_word_t m22 = m6 & m16;
+    const csa_word_t m24 = m8 & m16;
+    const csa_word_t m25 = m9 & m16;
+    const csa_word_t m26 = m10 & m16;
+    const csa_word_t m27 = m11 & m16;
+    const csa_word_t m28 = m12 & m16;
+    const csa_word_t m29 = m13 & m16;
+    o[1] = ~(m1 ^ m2 ^ m5 ^ m6 ^ m7 ^ m8 ^ m22 ^ m25 ^ m26 ^ m27 ^ m28);
+    o[0] = ~(m2 ^ m4 ^ m5 ^ m11 ^ m13 ^ m19 ^ m20 ^ m24 ^ m27 ^ m29);
+}
+
+static inline void csa_BsSbox3( csa_word_t m16, csa_word_t m8, csa_word_t m4,
+                                csa_word_t m2, csa_word_t m1, csa_word_t o[2] )
+{
+    const csa_word_t m3 = m1 & m2;
+    const csa_word_t m5 = m1 & m4;
+    const csa_word_t m6 = m2 & m4;
+    const csa_word_t m7 = m3 & m4;
+    const csa_word_t m9 = m1 & m8;
+    const csa_word_t m10 = m2 & m8;
+    const csa_word_t m11 = m3 & m8;
+    const csa_word_t m12 = m4 & m8;
+    const csa_word_t m14 = m6 & m8;
+    const csa_word_t m18 = m2 & m16;
+    const csa_word_t m19 = m3 & m16;
+    const csa_word_t m20 = m4 & m16;
+    const csa_word_t m21 = m5 & m16;
+    const csa_word_t m22 = m6 & m16;
+    const csa_word_t m23 = m7 & m16;
+    const csa_word_t m25 = m9 & m16;
+    const csa_word_t m28 = m12 & m16;
+    const csa_word_t m30 = m14 & m16;
+    o[1] = ~(m1 ^ m2 ^ m5 ^ m6 ^ m7 ^ m8 ^ m9 ^ m10 ^ m11 ^ m12 ^ m14 ^ m16 ^
+            m18 ^ m19 ^ m20 ^ m21 ^ m22 ^ m23 ^ m25 ^ m28 ^ m30);
+    o[0] = m2 ^ m3 ^ m5 ^ m8 ^ m16;
+}
+
+static inline void csa_BsSbox4( csa_word_t m16, csa_word_t m8, csa_word_t m4,
+                                csa_word_t m2, csa_word_t m1, csa_word_t o[2] )
+{
+    const csa_word_t m3 = m1 & m2;
+    const csa_word_t m6 = m2 & m4;
+    const csa_word_t m7 = m3 & m4;
+    const csa_word_t m9 = m1 & m8;
+    const csa_word_t m11 = m3 & m8;
+    const csa_word_t m12 = m4 & m8;
+    const csa_word_t m14 = m6 & m8;
+    const csa_word_t m17 = m1 & m16;
+    const csa_word_t m18 = m2 & m16;
+    const csa_word_t m23 = m7 & m16;
+    const csa_word_t m24 = m8 & m16;
+    const csa_word_t m25 = m9 & m16;
+    const csa_word_t m27 = m11 & m16;
+    const csa_word_t m28 = m12 & m16;
+    const csa_word_t m30 = m14 & m16;
+    o[1] = ~(m1 ^ m3 ^ m4 ^ m7 ^ m8 ^ m14 ^ m16 ^ m17 ^ m18 ^ m23 ^ m24 ^ m25
+            ^ m27 ^ m28 ^ m30);
+    o[0] = ~(m2 ^ m3 ^ m4 ^ m9 ^ m11 ^ m12 ^ m17 ^ m18 ^ m23 ^ m24 ^ m25 ^
+            m27 ^ m28 ^ m30);
+}
+
+static inline void csa_BsSbox5( csa_word_t m16, csa_word_t m8, csa_word_t m4,
+                                csa_word_t m2, csa_word_t m1, csa_word_t o[2] )
+{
+    const csa_word_t m3 = m1 & m2;
+    const csa_word_t m5 = m1 & m4;
+    const csa_word_t m6 = m2 & m4;
+    const csa_word_t m7 = m3 & m4;
+    const csa_word_t m9 = m1 & m8;
+    const csa_word_t m10 = m2 & m8;
+    const csa_word_t m11 = m3 & m8;
+    const csa_word_t m13 = m5 & m8;
+    const csa_word_t m14 = m6 & m8;
+    const csa_word_t m17 = m1 & m16;
+    const csa_word_t m18 = m2 & m16;
+    const csa_word_t m20 = m4 & m16;
+    const csa_word_t m21 = m5 & m16;
+    const csa_word_t m22 = m6 & m16;
+    const csa_word_t m23 = m7 & m16;
+    const csa_word_t m24 = m8 & m16;
+    const csa_word_t m25 = m9 & m16;
+    const csa_word_t m26 = m10 & m16;
+    const csa_word_t m27 = m11 & m16;
+    const csa_word_t m29 = m13 & m16;
+    const csa_word_t m30 = m14 & m16;
+    o[1] = ~(m1 ^ m2 ^ m3 ^ m5 ^ m6 ^ m7 ^ m8 ^ m9 ^ m11 ^ m13 ^ m14 ^ m17 ^
+            m18 ^ m20 ^ m22 ^ m23 ^ m25 ^ m26 ^ m29 ^ m30);
+    o[0] = m3 ^ m4 ^ m5 ^ m7 ^ m9 ^ m10 ^ m13 ^ m17 ^ m20 ^ m21 ^ m22 ^ m23 ^
+            m24 ^ m25 ^ m26 ^ m27;
+}
+
+static inline void csa_BsSbox6( csa_word_t m16, csa_word_t m8, csa_word_t m4,
+                                csa_word_t m2, csa_word_t m1, csa_word_t o[2] )
+{
+    const csa_word_t m3 = m1 & m2;
+    const csa_word_t m5 = m1 & m4;
+    const csa_word_t m6 = m2 & m4;
+    const csa_word_t m7 = m3 & m4;
+    const csa_word_t m9 = m1 & m8;
+    const csa_word_t m10 = m2 & m8;
+    const csa_word_t m11 = m3 & m8;
+    const csa_word_t m12 = m4 & m8;
+    const csa_word_t m13 = m5 & m8;
+    const csa_word_t m14 = m6 & m8;
+    const csa_word_t m19 = m3 & m16;
+    const csa_word_t m22 = m6 & m16;
+    const csa_word_t m23 = m7 & m16;
+    const csa_word_t m25 = m9 & m16;
+    const csa_word_t m27 = m11 & m16;
+    const csa_word_t m30 = m14 & m16;
+    o[1] = m2 ^ m5 ^ m11 ^ m12 ^ m13 ^ m16 ^ m19 ^ m25;
+    o[0] = m1 ^ m4 ^ m6 ^ m7 ^ m10 ^ m12 ^ m14 ^ m19 ^ m22 ^ m23 ^ m27 ^ m30;
+}
+
+static inline void csa_BsSbox7( csa_word_t m16, csa_word_t m8, csa_word_t m4,
+                                csa_word_t m2, csa_word_t m1, csa_word_t o[2] )
+{
+    const csa_word_t m3 = m1 & m2;
+    const csa_word_t m6 = m2 & m4;
+    const csa_word_t m7 = m3 & m4;
+    const csa_word_t m10 = m2 & m8;
+    const csa_word_t m11 = m3 & m8;
+    const csa_word_t m12 = m4 & m8;
+    const csa_word_t m14 = m6 & m8;
+    const csa_word_t m17 = m1 & m16;
+    const csa_word_t m19 = m3 & m16;
+    const csa_word_t m20 = m4 & m16;
+    const csa_word_t m22 = m6 & m16;
+    const csa_word_t m23 = m7 & m16;
+    const csa_word_t m26 = m10 & m16;
+    const csa_word_t m27 = m11 & m16;
+    const csa_word_t m30 = m14 & m16;
+    o[1] = m1 ^ m2 ^ m3 ^ m4 ^ m8 ^ m11 ^ m17 ^ m19 ^ m20 ^ m22 ^ m23 ^ m27 ^
+            m30;
+    o[0] = m1 ^ m3 ^ m4 ^ m6 ^ m7 ^ m8 ^ m12 ^ m16 ^ m26 ^ m27;
+}
+
+/* One clock of the stream cypher, see csa_StreamCypher. During the
+ * initialisation, in_a and in_b are the nibbles to inject in A and B. */
+static void csa_BsClock( csa_bs_t *s, const csa_word_t *in_a,
+                         const csa_word_t *in_b,
+                         csa_word_t *p_hi, csa_word_t *p_lo )
+{
+    csa_word_t (*A)[4] = s->A;
+    csa_word_t (*B)[4] = s->B;
+    csa_word_t o[7][2];
+    csa_word_t extra_B[4], next_A1[4], next_B1[4], next_E[4];
+    csa_word_t c;
+
+    csa_BsSbox1( A[4][0], A[1][2], A[6][1], A[7][3], A[9][0], o[0] );
+    csa_BsSbox2( A[2][1], A[3][2], A[6][3], A[7][0], A[9][1], o[1] );
+    csa_BsSbox3( A[1][3], A[2][0], A[5][1], A[5][3], A[6][2], o[2] );
+    csa_BsSbox4( A[3][3], A[1][1], A[2][3], A[4][2], A[8][0], o[3] );
+    csa_BsSbox5( A[5][2], A[4][3], A[6][0], A[8][1], A[9][2], o[4] );
+    csa_BsSbox6( A[3][1], A[4][1], A[5][0], A[7][2], A[9][3], o[5] );
+    csa_BsSbox7( A[2][2], A[3][0], A[7][1], A[8][2], A[8][3], o[6] );
+
+    extra_B[3] = B[3][0] ^ B[6][1] ^ B[7][2] ^ B[9][3];
+    extra_B[2] = B[6][0] ^ B[8][1] ^ B[3][3] ^ B[4][2];
+    extra_B[1] = B[5][3] ^ B[8][2] ^ B[4][0] ^ B[5][1];
+    extra_B[0] = B[9][2] ^ B[6][3] ^ B[3][1] ^ B[8][0];
+
+    for( int k = 0; k < 4; k++ )
+    {
+        next_A1[k] = A[10][k] ^ s->X[k];
+        next_B1[k] = B[7][k] ^ B[10][k] ^ s->Y[k];
+        if( in_a )
+        {
+            next_A1[k] ^= s->D[k] ^ in_a[k];
+            next_B1[k] ^= in_b[k];
+        }
+    }
+
+    /* if p, rotate next_B1 left */
+    const csa_word_t b3 = next_B1[3];
+    for( int k = 3; k > 0; k-- )
+        next_B1[k] = (s->p & next_B1[k-1]) | (~s->p & next_B1[k]);
+    next_B1[0] = (s->p & b3) | (~s->p & next_B1[0]);
+
+    /* if q, F = Z + E + r with r the carry, else F = E */
+    c = s->r;
+    for( int k = 0; k < 4; k++ )
+    {
+        const csa_word_t t = s->Z[k] ^ s->E[k];
+        const csa_word_t sum = t ^ c;
+
+        c = (s->Z[k] & s->E[k]) | (c & t);
+        s->D[k] = t ^ extra_B[k];
+        next_E[k] = s->F[k];
+        s->F[k] = (s->q & sum) | (~s->q & s->E[k]);
+        s->E[k] = next_E[k];
+    }
+    s->r = (s->q & c) | (~s->q & s->r);
+
+    memmove( &A[2], &A[1], 9 * sizeof( A[0] ) );
+    memmove( &B[2], &B[1], 9 * sizeof( B[0] ) );
+    memcpy( A[1], next_A1, sizeof( next_A1 ) );
+    memcpy( B[1], next_B1, sizeof( next_B1 ) );
+
+    s->X[3] = o[3][0]; s->X[2] = o[2][0]; s->X[1] = o[1][1]; s->X[0] = o[0][1];
+    s->Y[3] = o[5][0]; s->Y[2] = o[4][0]; s->Y[1] = o[3][1]; s->Y[0] = o[2][1];
+    s->Z[3] = o[1][0]; s->Z[2] = o[0][0]; s->Z[1] = o[5][1]; s->Z[0] = o[4][1];
+    s->p = o[6][1];
+    s->q = o[6][0];
+
+    *p_hi = s->D[2] ^ s->D[3];
+    *p_lo = s->D[0] ^ s->D[1];
+}
+
+/* Initialises the stream cypher of n packets with the keys ck[] and the
+ * first blocks sb[], and produces i_blocks blocks of 8 bytes in out[] */
+static void csa_StreamBatch( uint8_t *const *ck, uint8_t *const *sb, int n,
+                             int i_blocks, uint8_t out[][184] )
+{
+    csa_bs_t s;
+    uint64_t m[64];
+    csa_word_t hi, lo;
+
+    memset( &s, 0, sizeof( s ) );
+
+    for( int i = 0; i < 64; i++ )
+        m[i] = i < n ? GetQWLE( ck[i] ) : 0;
+    csa_Transpose( m );
+    for( int i = 0; i < 4; i++ )
+    {
+        for( int k = 0; k < 4; k++ )
+        {
+            s.A[1+2*i][k] = m[8*i+4+k];
+            s.A[2+2*i][k] = m[8*i+k];
+            s.B[1+2*i][k] = m[32+8*i+4+k];
+            s.B[2+2*i][k] = m[32+8*i+k];
+        }
+    }
+
+    for( int i = 0; i < 64; i++ )
+        m[i] = i < n ? GetQWLE( sb[i] ) : 0;
+    csa_Transpose( m );
+    for( int i = 0; i < 8; i++ )
+    {
+        const csa_word_t *in1 = &m[8*i+4];
+        const csa_word_t *in2 = &m[8*i];
+
+        for( int j = 0; j < 4; j++ )
+            csa_BsClock( &s, (j & 1) ? in2 : in1, (j & 1) ? in1 : in2,
+                         &hi, &lo );
+    }
+
+    for( int b = 0; b < i_blocks; b++ )
+    {
+        for( int i = 0; i < 8; i++ )
+            for( int j = 0; j < 4; j++ )
+                csa_BsClock( &s, NULL, NULL,
+                             &m[8*i+7-2*j], &m[8*i+6-2*j] );
+        csa_Transpose( m );
+        for( int i = 0; i < n; i++ )
+            SetQWLE( &out[i][8*b], m[i] );
+    }
+}
+
+static void csa_EncryptChunk( csa_t *c, uint8_t **pkts, int i_pkts,
+                              int i_pkt_size )
+{
+    uint8_t *ck[CSA_BATCH_SIZE], *sb[CSA_BATCH_SIZE];
+    uint8_t stream[CSA_BATCH_SIZE][184];
+    uint8_t *pkt_lane[CSA_BATCH_SIZE];
+    int     i_hdr_lane[CSA_BATCH_SIZE];
+    int     i_lanes = 0, i_blocks = 0;
+
+    for( int l = 0; l < i_pkts; l++ )
+    {
+        uint8_t *pkt = pkts[l];
+        uint8_t *kk;
+        int i_hdr = 4;
+
+        /* set transport scrambling control */
+        pkt[3] |= 0x80;
+        if( c->use_odd )
+        {
+            pkt[3] |= 0x40;
+            ck[i_lanes] = c->o_ck;
+            kk = c->o_kk;
+        }
+        else
+        {
+            ck[i_lanes] = c->e_ck;
+            kk = c->e_kk;
+        }
+
+        if( pkt[3]&0x20 )
+            i_hdr += pkt[4] + 1; /* skip adaption field */
+        const int n = (i_pkt_size - i_hdr) / 8;
+        const int i_residue = (i_pkt_size - i_hdr) % 8;
+        if( n <= 0 )
+        {
+            pkt[3] &= 0x3f;
+            continue;
+        }
+
+        /* block cypher, ib[i] is stored in place of the block i-1 */
+        uint8_t block[8];
+        memset( block, 0, sizeof( block ) );
+        for( int i = n; i > 0; i-- )
+        {
+            uint8_t *p = &pkt[i_hdr+8*(i-1)];
+            for( int j = 0; j < 8; j++ )
+                block[j] ^= p[j];
+            csa_BlockCypher( kk, block, p );
+            memcpy( block, p, 8 );
+        }
+
+        sb[i_lanes] = &pkt[i_hdr];
+        pkt_lane[i_lanes] = pkt;
+        i_hdr_lane[i_lanes] = i_hdr;
+        i_lanes++;
+        i_blocks = __MAX( i_blocks, n - 1 + (i_residue > 0) );
+    }
+    if( i_lanes <= 0 )
+        return;
+
+    csa_StreamBatch( ck, sb, i_lanes, i_blocks, stream );
+
+    for( int l = 0; l < i_lanes; l++ )
+    {
+        uint8_t *pkt = pkt_lane[l];
+        const int i_hdr = i_hdr_lane[l];
+        const int n = (i_pkt_size - i_hdr) / 8;
+        const int i_residue = (i_pkt_size - i_hdr) % 8;
+
+        for( int i = 2; i < n + 1; i++ )
+            for( int j = 0; j < 8; j++ )
+                pkt[i_hdr+8*(i-1)+j] ^= stream[l][8*(i-2)+j];
+        for( int j = 0; j < i_residue; j++ )
+            pkt[i_pkt_size - i_residue + j] ^= stream[l][8*(n-1)+j];
+    }
+}
+
+static void csa_DecryptChunk( csa_t *c, uint8_t **pkts, int i_pkts,
+                              int i_pkt_size )
+{
+    uint8_t *ck[CSA_BATCH_SIZE], *sb[CSA_BATCH_SIZE], *kk[CSA_BATCH_SIZE];
+    uint8_t stream[CSA_BATCH_SIZE][184];
+    uint8_t *pkt_lane[CSA_BATCH_SIZE];
+    int     i_hdr_lane[CSA_BATCH_SIZE];
+    int     i_lanes = 0, i_blocks = 0;
+
+    for( int l = 0; l < i_pkts; l++ )
+    {
+        uint8_t *pkt = pkts[l];
+        int i_hdr = 4;
+
+        /* transport scrambling control */
+        if( (pkt[3]&0x80) == 0 )
+            continue; /* not scrambled */
+        if( pkt[3]&0x40 )
+        {
+            ck[i_lanes] = c->o_ck;
+            kk[i_lanes] = c->o_kk;
+        }
+        else
+        {
+            ck[i_lanes] = c->e_ck;
+            kk[i_lanes] = c->e_kk;
+        }
+        pkt[3] &= 0x3f;
+
+        if( pkt[3]&0x20 )
+            i_hdr += pkt[4] + 1; /* skip adaption field */
+        if( 188 - i_hdr < 8 || i_pkt_size < i_hdr )
+            continue;
+
+        const int n = (i_pkt_size - i_hdr) / 8;
+        const int i_residue = (i_pkt_size - i_hdr) % 8;
+
+        sb[i_lanes] = &pkt[i_hdr];
+        pkt_lane[i_lanes] = pkt;
+        i_hdr_lane[i_lanes] = i_hdr;
+        i_lanes++;
+        i_blocks = __MAX( i_blocks, __MAX( n - 1, 0 ) + (i_residue > 0) );
+    }
+    if( i_lanes <= 0 )
+        return;
+
+    csa_StreamBatch( ck, sb, i_lanes, i_blocks, stream );
+
+    for( int l = 0; l < i_lanes; l++ )
+    {
+        uint8_t *pkt = pkt_lane[l];
+        const int i_hdr = i_hdr_lane[l];
+        const int n = (i_pkt_size - i_hdr) / 8;
+        const int i_residue = (i_pkt_size - i_hdr) % 8;
+        uint8_t ib[8], block[8];
+
+        memcpy( ib, &pkt[i_hdr], 8 );
+        for( int i = 1; i < n + 1; i++ )
+        {
+            csa_BlockDecypher( kk[l], ib, block );
+            if( i != n )
+            {
+                for( int j = 0; j < 8; j++ )
+                    ib[j] = pkt[i_hdr+8*i+j] ^ stream[l][8*(i-1)+j];
+            }
+            else
+                memset( ib, 0, sizeof( ib ) );
+            for( int j = 0; j < 8; j++ )
+                pkt[i_hdr+8*(i-1)+j] = ib[j] ^ block[j];
+        }
+        for( int j = 0; j < i_residue; j++ )
+            pkt[i_pkt_size - i_residue + j] ^=
+                stream[l][8*__MAX( n - 1, 0 )+j];
+    }
+}
+
+/*****************************************************************************
+ * csa_EncryptBatch: same as csa_Encrypt on each of the i_pkts packets
+ *****************************************************************************/
+void csa_EncryptBatch( csa_t *c, uint8_t **pkts, int i_pkts, int i_pkt_size )
+{
+    for( int i = 0; i < i_pkts; i += CSA_BATCH_SIZE )
+        csa_EncryptChunk( c, &pkts[i], __MIN( i_pkts - i, CSA_BATCH_SIZE ),
+                          i_pkt_size );
+}
+
+/*****************************************************************************
+ * csa_DecryptBatch: same as csa_Decrypt on each of the i_pkts packets
+ *****************************************************************************/
+void csa_DecryptBatch( csa_t *c, uint8_t **pkts, int i_pkts, int i_pkt_size )
+{
+    for( int i = 0; i < i_pkts; i += CSA_BATCH_SIZE )
+        csa_DecryptChunk( c, &pkts[i], __MIN( i_pkts - i, CSA_BATCH_SIZE ),
+                          i_pkt_size );
+}
@@ -27,13 +27,17 @@
 typedef struct csa_t csa_t;
 #define csa_New     __csa_New
 #define csa_Delete  __csa_Delete
+#define csa_Copy    __csa_Copy
 #define csa_SetCW  __csa_SetCW
 #define csa_UseKey  __csa_UseKey
 #define csa_Decrypt __csa_decrypt
 #define csa_Encrypt __csa_encrypt
+#define csa_DecryptBatch __csa_DecryptBatch
+#define csa_EncryptBatch __csa_EncryptBatch
 
 csa_t *csa_New( void );
 void   csa_Delete( csa_t * );
+void   csa_Copy( csa_t *p_dst, const csa_t *p_src );
 
 int    csa_SetCW( vlc_object_t *p_caller, csa_t *c, char *psz_ck, bool odd );
 int    csa_UseKey( vlc_object_t *p_caller, csa_t *, bool use_odd );
@@ -41,4 +45,10 @@ int    csa_UseKey( vlc_object_t *p_caller, csa_t *, bool use_odd );
 void   csa_Decrypt( csa_t *, uint8_t *pkt, int i_pkt_size );
 void   csa_Encrypt( csa_t *, uint8_t *pkt, int i_pkt_size );
 
+/* Same as csa_Decrypt/csa_Encrypt on several packets at once, faster,
+ * especially with CSA_BATCH_SIZE packets or more */
+#define CSA_BATCH_SIZE 64
+void   csa_DecryptBatch( csa_t *, uint8_t **pkts, int i_pkts, int i_pkt_size );
+void   csa_EncryptBatch( csa_t *, uint8_t **pkts, int i_pkts, int i_pkt_size );
+
 #endif /* _CSA_H */
@@ -171,6 +171,11 @@ static void    Close  ( vlc_object_t * );
     "The encryption routines subtract the TS-header from the value before " \
     "encrypting." )
 
+#define CTHREADS_TEXT N_("Encryption threads")
+#define CTHREADS_LONGTEXT N_("Number of threads used to encrypt the TS " \
+    "packets with CSA. Encryption is the most CPU intensive part of the " \
+    "muxer on high bitrate streams.")
+
 #define SOUT_CFG_PREFIX "sout-ts-"
 #define MAX_PMT 64       /* Maximum number of programs. FIXME: I just chose an arbitrary number. Where is the maximum in the spec? */
 #define MAX_PMT_PID 64       /* Maximum pids in each pmt.  FIXME: I just chose an arbitrary number. Where is the maximum in the spec? */
@@ -230,6 +235,9 @@ vlc_module_begin ()
     add_string( SOUT_CFG_PREFIX "csa-use", "1", CU_TEXT, CU_LONGTEXT,
                 true )
     add_integer( SOUT_CFG_PREFIX "csa-pkt", 188, CPKT_TEXT, CPKT_LONGTEXT, true )
+    add_integer( SOUT_CFG_PREFIX "csa-threads", 1, CTHREADS_TEXT,
+                 CTHREADS_LONGTEXT, true )
+        change_integer_range( 1, 16 )
 
     set_callbacks( Open, Close )
 vlc_module_end ()
@@ -241,7 +249,7 @@ static const char *const ppsz_sout_options[] = {
     "pid-video", "pid-audio", "pid-spu", "pid-pmt", "tsid",
     "netid", "sdtdesc",
     "es-id-pid", "shaping", "pcr", "bmin", "bmax", "use-key-frames",
-    "dts-delay", "csa-ck", "csa2-ck", "csa-use", "csa-pkt", "crypt-audio", "crypt-video",
+    "dts-delay", "csa-ck", "csa2-ck", "csa-use", "csa-pkt", "csa-threads", "crypt-audio", "crypt-video",
     "muxpmt", "program-pmt", "alignment",
     NULL
 };
@@ -354,6 +362,14 @@ typedef struct ts_stream_t
 
 } ts_stream_t;
 
+typedef struct
+{
+    vlc_thread_t    thread;
+    csa_t           *csa;   /* private copy, keys are synced for each job */
+    sout_mux_sys_t  *p_sys;
+    int             i_slice;
+} csa_worker_t;
+
 struct sout_mux_sys_t
 {
     int             i_pcr_pid;
@@ -408,6 +424,19 @@ struct sout_mux_sys_t
     int             i_csa_pkt_size;
     bool            b_crypt_audio;
     bool            b_crypt_video;
+
+    /* parallel encryption (i_csa_threads - 1 workers plus the mux thread) */
+    int             i_csa_threads;
+    csa_worker_t    *p_csa_workers;
+    vlc_mutex_t     csa_job_lock;
+    vlc_cond_t      csa_job_wait;
+    vlc_cond_t      csa_job_done;
+    unsigned        i_csa_job;      /* job sequence number */
+    int             i_csa_job_left; /* workers still busy */
+    bool            b_csa_exit;
+    uint8_t         **pp_csa_pkts;
+    int             i_csa_pkts;
+    int             i_csa_pkts_max;
 };
 
 /* Reserve a pid and return it */
@@ -478,6 +507,9 @@ static void TSSetPCR( block_t *p_ts, mtime_t i_dts );
 
 static void PEStoTS  ( sout_instance_t *, sout_buffer_chain_t *, block_t *, ts_stream_t * );
 
+static void CsaWorkersStart( sout_mux_t * );
+static void CsaWorkersStop( sout_mux_t * );
+
 /*****************************************************************************
  * Open:
  *****************************************************************************/
@@ -763,6 +795,11 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_pcr    = 0;
 
     p_sys->csa      = NULL;
+    p_sys->i_csa_threads = 1;
+    p_sys->p_csa_workers = NULL;
+    p_sys->pp_csa_pkts = NULL;
+    p_sys->i_csa_pkts = 0;
+    p_sys->i_csa_pkts_max = 0;
     var_Create( p_mux, SOUT_CFG_PREFIX "csa-ck", VLC_VAR_STRING | VLC_VAR_DOINHERIT | VLC_VAR_ISCOMMAND );
     var_Get( p_mux, SOUT_CFG_PREFIX "csa-ck", &val );
     if( val.psz_string && *val.psz_string )
@@ -818,6 +855,10 @@ static int Open( vlc_object_t *p_this )
             }
             else p_sys->i_csa_pkt_size = pkt_val.i_int;
             msg_Dbg( p_mux, "encrypting %d bytes of packet", p_sys->i_csa_pkt_size );
+
+            p_sys->i_csa_threads = var_GetInteger( p_mux, SOUT_CFG_PREFIX "csa-threads" );
+            if( p_sys->i_csa_threads > 1 )
+                CsaWorkersStart( p_mux );
         }
         free( csa2.psz_string );
     }
@@ -844,8 +885,11 @@ static void Close( vlc_object_t * p_this )
         var_DelCallback( p_mux, SOUT_CFG_PREFIX "csa-ck", ChangeKeyCallback, NULL );
         var_DelCallback( p_mux, SOUT_CFG_PREFIX "csa2-ck", ChangeKeyCallback, NULL );
         var_DelCallback( p_mux, SOUT_CFG_PREFIX "csa-use", ActiveKeyCallback, NULL );
+        if( p_sys->p_csa_workers )
+            CsaWorkersStop( p_mux );
         csa_Delete( p_sys->csa );
     }
+    free( p_sys->pp_csa_pkts );
 
     for( i = 0; i < MAX_PMT; i++ )
     {
@@ -1911,6 +1955,144 @@ static void TSSchedule( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
         TSDate( p_mux, &new_chain, i_pcr_length, i_pcr_dts );
 }
 
+/*****************************************************************************
+ * Parallel CSA encryption
+ *****************************************************************************/
+static void CsaEncryptSlice( sout_mux_sys_t *p_sys, csa_t *csa, int i_slice )
+{
+    const int i_start = p_sys->i_csa_pkts * i_slice / p_sys->i_csa_threads;
+    const int i_end = p_sys->i_csa_pkts * (i_slice + 1) / p_sys->i_csa_threads;
+
+    csa_EncryptBatch( csa, &p_sys->pp_csa_pkts[i_start], i_end - i_start,
+                      p_sys->i_csa_pkt_size );
+}
+
+static void *CsaWorkerThread( void *data )
+{
+    csa_worker_t *p_worker = data;
+    sout_mux_sys_t *p_sys = p_worker->p_sys;
+    unsigned i_job = 0;
+
+    vlc_mutex_lock( &p_sys->csa_job_lock );
+    for( ;; )
+    {
+        while( !p_sys->b_csa_exit && p_sys->i_csa_job == i_job )
+            vlc_cond_wait( &p_sys->csa_job_wait, &p_sys->csa_job_lock );
+        if( p_sys->b_csa_exit )
+            break;
+        i_job = p_sys->i_csa_job;
+        vlc_mutex_unlock( &p_sys->csa_job_lock );
+
+        CsaEncryptSlice( p_sys, p_worker->csa, p_worker->i_slice );
+
+        vlc_mutex_lock( &p_sys->csa_job_lock );
+        if( --p_sys->i_csa_job_left == 0 )
+            vlc_cond_signal( &p_sys->csa_job_done );
+    }
+    vlc_mutex_unlock( &p_sys->csa_job_lock );
+    return NULL;
+}
+
+/* Encrypts the p_sys->pp_csa_pkts packets, the mux thread doing slice 0 */
+static void CsaEncryptParallel( sout_mux_t *p_mux )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    const int i_workers = p_sys->i_csa_threads - 1;
+
+    if( p_sys->i_csa_pkts <= 0 )
+        return;
+
+    /* Keys may be changed at any time by the callbacks */
+    vlc_mutex_lock( &p_sys->csa_lock );
+    if( i_workers <= 0 )
+    {
+        CsaEncryptSlice( p_sys, p_sys->csa, 0 );
+        vlc_mutex_unlock( &p_sys->csa_lock );
+        return;
+    }
+    for( int i = 0; i < i_workers; i++ )
+        csa_Copy( p_sys->p_csa_workers[i].csa, p_sys->csa );
+
+    vlc_mutex_lock( &p_sys->csa_job_lock );
+    p_sys->i_csa_job++;
+    p_sys->i_csa_job_left = i_workers;
+    vlc_cond_broadcast( &p_sys->csa_job_wait );
+    vlc_mutex_unlock( &p_sys->csa_job_lock );
+
+    CsaEncryptSlice( p_sys, p_sys->csa, 0 );
+
+    vlc_mutex_lock( &p_sys->csa_job_lock );
+    while( p_sys->i_csa_job_left > 0 )
+        vlc_cond_wait( &p_sys->csa_job_done, &p_sys->csa_job_lock );
+    vlc_mutex_unlock( &p_sys->csa_job_lock );
+    vlc_mutex_unlock( &p_sys->csa_lock );
+}
+
+static void CsaWorkersStart( sout_mux_t *p_mux )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    const int i_workers = p_sys->i_csa_threads - 1;
+
+    p_sys->p_csa_workers = calloc( i_workers, sizeof( csa_worker_t ) );
+    if( p_sys->p_csa_workers == NULL )
+    {
+        p_sys->i_csa_threads = 1;
+        return;
+    }
+    vlc_mutex_init( &p_sys->csa_job_lock );
+    vlc_cond_init( &p_sys->csa_job_wait );
+    vlc_cond_init( &p_sys->csa_job_done );
+    p_sys->i_csa_job = 0;
+    p_sys->i_csa_job_left = 0;
+    p_sys->b_csa_exit = false;
+
+    int i;
+    for( i = 0; i < i_workers; i++ )
+    {
+        csa_worker_t *p_worker = &p_sys->p_csa_workers[i];
+
+        p_worker->csa = csa_New();
+        p_worker->p_sys = p_sys;
+        p_worker->i_slice = i + 1;
+        if( p_worker->csa == NULL )
+            break;
+        if( vlc_clone( &p_worker->thread, CsaWorkerThread, p_worker,
+                       VLC_THREAD_PRIORITY_OUTPUT ) )
+        {
+            csa_Delete( p_worker->csa );
+            break;
+        }
+    }
+    p_sys->i_csa_threads = i + 1;
+    if( i == 0 )
+    {
+        CsaWorkersStop( p_mux );
+        return;
+    }
+    msg_Dbg( p_mux, "encrypting with %d threads", p_sys->i_csa_threads );
+}
+
+static void CsaWorkersStop( sout_mux_t *p_mux )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+
+    vlc_mutex_lock( &p_sys->csa_job_lock );
+    p_sys->b_csa_exit = true;
+    vlc_cond_broadcast( &p_sys->csa_job_wait );
+    vlc_mutex_unlock( &p_sys->csa_job_lock );
+
+    for( int i = 0; i < p_sys->i_csa_threads - 1; i++ )
+    {
+        vlc_join( p_sys->p_csa_workers[i].thread, NULL );
+        csa_Delete( p_sys->p_csa_workers[i].csa );
+    }
+    vlc_cond_destroy( &p_sys->csa_job_done );
+    vlc_cond_destroy( &p_sys->csa_job_wait );
+    vlc_mutex_destroy( &p_sys->csa_job_lock );
+    free( p_sys->p_csa_workers );
+    p_sys->p_csa_workers = NULL;
+}
+
 static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
                     mtime_t i_pcr_length, mtime_t i_pcr_dts )
 {
@@ -1946,6 +2128,48 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
         i_pcr_length = i_packet_count;
     }
 
+    if( p_sys->csa )
+    {
+        /* Date all the packets first, so that they can be encrypted in
+         * batches (and split between the workers) */
+        block_t *p_ts = p_chain_ts->p_first;
+
+        p_sys->i_csa_pkts = 0;
+        for( i = 0; i < i_packet_count; i++, p_ts = p_ts->p_next )
+        {
+            p_ts->i_dts    = i_pcr_dts + i_pcr_length * i / i_packet_count;
+            p_ts->i_length = i_pcr_length / i_packet_count;
+
+            if( p_ts->i_flags & BLOCK_FLAG_CLOCK )
+                TSSetPCR( p_ts, p_ts->i_dts - p_sys->i_dts_delay );
+            if( p_ts->i_flags & BLOCK_FLAG_SCRAMBLED )
+            {
+                if( p_sys->i_csa_pkts >= p_sys->i_csa_pkts_max )
+                {
+                    int i_max = __MAX( 2 * p_sys->i_csa_pkts_max, 256 );
+                    uint8_t **pp = realloc( p_sys->pp_csa_pkts,
+                                            i_max * sizeof( *pp ) );
+                    if( pp == NULL )
+                        continue; /* sent in clear */
+                    p_sys->pp_csa_pkts = pp;
+                    p_sys->i_csa_pkts_max = i_max;
+                }
+                p_sys->pp_csa_pkts[p_sys->i_csa_pkts++] = p_ts->p_buffer;
+            }
+        }
+        CsaEncryptParallel( p_mux );
+
+        for( i = 0; i < i_packet_count; i++ )
+        {
+            p_ts = BufferChainGet( p_chain_ts );
+            /* latency */
+            p_ts->i_dts += p_sys->i_shaping_delay * 3 / 2;
+
+            sout_AccessOutWrite( p_mux->p_access, p_ts );
+        }
+        return;
+    }
+
     /* msg_Dbg( p_mux, "real pck=%d", i_packet_count ); */
     for( i = 0; i < i_packet_count; i++ )
     {
@@ -1960,12 +2184,6 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
             /* msg_Dbg( p_mux, "pcr=%lld ms", p_ts->i_dts / 1000 ); */
             TSSetPCR( p_ts, p_ts->i_dts - p_sys->i_dts_delay );
         }
-        if( p_ts->i_flags & BLOCK_FLAG_SCRAMBLED )
-        {
-            vlc_mutex_lock( &p_sys->csa_lock );
-            csa_Encrypt( p_sys->csa, p_ts->p_buffer, p_sys->i_csa_pkt_size );
-            vlc_mutex_unlock( &p_sys->csa_lock );
-        }
 
         /* latency */
         p_ts->i_dts += p_sys->i_shaping_delay * 3 / 2;
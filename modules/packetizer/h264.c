@@ -105,6 +105,7 @@ struct decoder_sys_t
 
     /* avcC data */
     int i_avcC_length_size;
+    bool b_framed;  /* each input block is a whole access unit */
 
     /* Useful values of the Sequence Parameter Set */
     int i_log2_max_frame_num;
@@ -159,6 +160,7 @@ enum nal_priority_e
 
 static block_t *Packetize( decoder_t *, block_t ** );
 static block_t *PacketizeAVC1( decoder_t *, block_t ** );
+static bool     PacketizeAVC1Framed( decoder_t *, block_t *, block_t ** );
 static block_t *GetCc( decoder_t *p_dec, bool pb_present[4] );
 
 static void PacketizeReset( void *p_private, bool b_broken );
@@ -335,6 +337,11 @@ static int Open( vlc_object_t *p_this )
             p_dec->fmt_out.i_extra = 0;
         }
 
+        /* The demuxer gives whole access units: with 4 bytes lengths,
+         * they can be turned into annex B in place */
+        p_sys->b_framed = p_dec->fmt_in.b_packetized &&
+                          p_sys->i_avcC_length_size == 4;
+
         /* Set callback */
         p_dec->pf_packetize = PacketizeAVC1;
         /* TODO CC ? */
@@ -432,6 +439,9 @@ static block_t *PacketizeAVC1( decoder_t *p_dec, block_t **pp_block )
     p_block = *pp_block;
     *pp_block = NULL;
 
+    if( p_sys->b_framed && PacketizeAVC1Framed( p_dec, p_block, &p_ret ) )
+        return p_ret;
+
     for( p = p_block->p_buffer; p < &p_block->p_buffer[p_block->i_buffer]; )
     {
         block_t *p_pic;
@@ -470,6 +480,105 @@ static block_t *PacketizeAVC1( decoder_t *p_dec, block_t **pp_block )
     return p_ret;
 }
 
+/****************************************************************************
+ * PacketizeAVC1Framed: outputs an access unit without splitting it
+ * The 4 bytes NAL lengths are replaced by startcodes in the block itself,
+ * and only the slice headers and the SEI are parsed. Access units holding
+ * parameter sets, or that cannot be trusted, are left to PacketizeAVC1.
+ ****************************************************************************/
+static bool PacketizeAVC1Framed( decoder_t *p_dec, block_t *p_block,
+                                 block_t **pp_pic )
+{
+    decoder_sys_t *p_sys = p_dec->p_sys;
+    uint8_t *p_end = &p_block->p_buffer[p_block->i_buffer];
+    size_t i_aud = 0;
+    uint8_t *p;
+
+    /* A previous incomplete access unit needs the generic path */
+    if( p_sys->p_frame && !p_sys->b_slice )
+        return false;
+
+    for( p = p_block->p_buffer; p < p_end; )
+    {
+        if( p_end - p < 5 )
+            return false;
+
+        const uint32_t i_size = GetDWBE( p );
+        if( i_size == 0 || i_size > (size_t)(p_end - p - 4) )
+            return false;
+
+        const int i_nal_type = p[4]&0x1f;
+        if( i_nal_type == NAL_AU_DELIMITER && p == p_block->p_buffer )
+            i_aud = 4 + i_size;
+        else if( ( i_nal_type < NAL_SLICE || i_nal_type > NAL_SEI ) &&
+                 i_nal_type != 12 /* filler data */ )
+            return false;
+        p += 4 + i_size;
+    }
+
+    /* Output the pending picture of PacketizeAVC1 */
+    *pp_pic = p_sys->b_slice ? OutputPicture( p_dec ) : NULL;
+
+    bool b_slice = false;
+    for( p = p_block->p_buffer; p < p_end; )
+    {
+        const uint32_t i_size = GetDWBE( p );
+        const int i_nal_ref_idc = (p[4] >> 5)&0x03;
+        const int i_nal_type = p[4]&0x1f;
+        block_t nal;
+
+        SetDWBE( p, 1 );
+        block_Init( &nal, p, 4 + i_size );
+
+        if( i_nal_type >= NAL_SLICE && i_nal_type <= NAL_SLICE_IDR )
+        {
+            slice_t slice;
+            bool b_dummy;
+
+            ParseSlice( p_dec, &b_dummy, &slice, i_nal_ref_idc,
+                        i_nal_type, &nal );
+            p_sys->slice = slice;
+            b_slice = true;
+        }
+        else if( i_nal_type == NAL_SEI )
+        {
+            ParseSei( p_dec, &nal );
+        }
+        p += 4 + i_size;
+    }
+
+    if( !b_slice )
+    {
+        block_Release( p_block );
+        return true;
+    }
+
+    /* The delimiter must stay first when the parameter sets are inserted */
+    if( i_aud > 0 && p_sys->slice.i_frame_type == BLOCK_FLAG_TYPE_I )
+    {
+        block_t *p_aud = block_New( p_dec, i_aud );
+        if( p_aud )
+        {
+            memcpy( p_aud->p_buffer, p_block->p_buffer, i_aud );
+            p_aud->i_flags |= BLOCK_FLAG_PRIVATE_AUD;
+            p_block->p_buffer += i_aud;
+            p_block->i_buffer -= i_aud;
+            block_ChainAppend( &p_sys->p_frame, p_aud );
+        }
+    }
+    p_block->i_flags = 0;
+    block_ChainAppend( &p_sys->p_frame, p_block );
+
+    p_sys->i_frame_dts = p_block->i_dts;
+    p_sys->i_frame_pts = p_block->i_pts;
+    p_sys->b_slice = true;
+
+    block_t *p_pic = OutputPicture( p_dec );
+    if( p_pic )
+        block_ChainAppend( pp_pic, p_pic );
+    return true;
+}
+
 /*****************************************************************************
  * GetCc:
  *****************************************************************************/
@@ -773,6 +882,9 @@ static block_t *OutputPicture( decoder_t *p_dec )
     p_pic->i_length = 0;    /* FIXME */
     p_pic->i_flags |= p_sys->slice.i_frame_type;
     p_pic->i_flags &= ~BLOCK_FLAG_PRIVATE_AUD;
+    /* The slices of a picture are all reference ones or none of them is */
+    if( p_sys->slice.i_nal_ref_idc == 0 )
+        p_pic->i_flags |= BLOCK_FLAG_DISPOSABLE;
     if( !p_sys->b_header )
         p_pic->i_flags |= BLOCK_FLAG_PREROLL;
 
@@ -25,6 +25,7 @@
 #define _PACKETIZER_H 1
 
 #include <vlc_block.h>
+#include "startcode_helper.h"
 
 enum
 {
@@ -49,6 +50,7 @@ typedef struct
 
     int i_startcode;
     const uint8_t *p_startcode;
+    block_startcode_helper_t pf_startcode_helper;
 
     int i_au_prepend;
     const uint8_t *p_au_prepend;
@@ -82,6 +84,10 @@ static inline void packetizer_Init( packetizer_t *p_pack,
 
     p_pack->i_startcode = i_startcode;
     p_pack->p_startcode = p_startcode;
+    if( i_startcode == 3 && !memcmp( p_startcode, "\x00\x00\x01", 3 ) )
+        p_pack->pf_startcode_helper = startcode_FindAnnexB;
+    else
+        p_pack->pf_startcode_helper = NULL;
     p_pack->pf_reset = pf_reset;
     p_pack->pf_parse = pf_parse;
     p_pack->pf_validate = pf_validate;
@@ -125,7 +131,8 @@ static inline block_t *packetizer_Packetize( packetizer_t *p_pack, block_t **pp_
         case STATE_NOSYNC:
             /* Find a startcode */
             if( !block_FindStartcodeFromOffset( &p_pack->bytestream, &p_pack->i_offset,
-                                                p_pack->p_startcode, p_pack->i_startcode ) )
+                                                p_pack->p_startcode, p_pack->i_startcode,
+                                                p_pack->pf_startcode_helper ) )
                 p_pack->i_state = STATE_NEXT_SYNC;
 
             if( p_pack->i_offset )
@@ -143,7 +150,8 @@ static inline block_t *packetizer_Packetize( packetizer_t *p_pack, block_t **pp_
         case STATE_NEXT_SYNC:
             /* Find the next startcode */
             if( block_FindStartcodeFromOffset( &p_pack->bytestream, &p_pack->i_offset,
-                                               p_pack->p_startcode, p_pack->i_startcode ) )
+                                               p_pack->p_startcode, p_pack->i_startcode,
+                                               p_pack->pf_startcode_helper ) )
             {
                 if( !p_pack->b_flushing || !p_pack->bytestream.p_chain )
                     return NULL; /* Need more data */
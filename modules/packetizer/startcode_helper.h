@@ -0,0 +1,98 @@
+/*****************************************************************************
+ * startcode_helper.h: 00 00 01 startcode search
+ *****************************************************************************
+ * Copyright (C) 2012 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_STARTCODE_HELPER_H_
+#define VLC_STARTCODE_HELPER_H_
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+# include <arm_neon.h>
+#endif
+
+/* Checks the bytes from p, up to 16 of them, for the start of a startcode */
+static inline const uint8_t *startcode_FindAnnexBScalar( const uint8_t *p,
+                                                         const uint8_t *end )
+{
+    /* Look at the third byte first: unless it is 0 or 1, there is no
+     * startcode either there or at the two previous positions */
+    for( end -= 2; p < end; )
+    {
+        if( p[2] > 1 )
+            p += 3;
+        else if( p[1] )
+            p += 2;
+        else if( p[0] || p[2] != 1 )
+            p++;
+        else
+            return p;
+    }
+    return NULL;
+}
+
+/**
+ * Finds the first 00 00 01 sequence lying entirely within [p, end).
+ * The bytes of a startcode split between two buffers must be checked by the
+ * caller (see block_FindStartcodeFromOffset()).
+ * \return a pointer to its first byte, or NULL if there is none
+ */
+static inline const uint8_t *startcode_FindAnnexB( const uint8_t *p,
+                                                   const uint8_t *end )
+{
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+
+    for( ; end - p >= 16 + 2; p += 16 )
+    {
+        const __m128i v = _mm_loadu_si128( (const __m128i *)p );
+        unsigned i_mask = _mm_movemask_epi8( _mm_cmpeq_epi8( v, zero ) );
+
+        /* Candidates are zero bytes followed by a zero byte (the last one
+         * is followed by the next 16 bytes) */
+        i_mask &= ( i_mask >> 1 ) | 0x8000;
+        while( i_mask )
+        {
+            const int i = __builtin_ctz( i_mask );
+            if( p[i+1] == 0 && p[i+2] == 1 )
+                return &p[i];
+            i_mask &= i_mask - 1;
+        }
+    }
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+    const uint8x16_t zero = vdupq_n_u8( 0 );
+
+    for( ; end - p >= 16 + 2; p += 16 )
+    {
+        const uint64x2_t z = vreinterpretq_u64_u8(
+                                vceqq_u8( vld1q_u8( p ), zero ) );
+
+        /* Most of the blocks of compressed data hold no zero byte */
+        if( ( vgetq_lane_u64( z, 0 ) | vgetq_lane_u64( z, 1 ) ) == 0 )
+            continue;
+
+        const uint8_t *p_res = startcode_FindAnnexBScalar( p, p + 16 + 2 );
+        if( p_res )
+            return p_res;
+    }
+#endif
+    return startcode_FindAnnexBScalar( p, end );
+}
+
+#endif
@@ -0,0 +1,129 @@
+/*
+ * DASHDownloader.cpp
+ *****************************************************************************
+ * Copyright (C) 2012 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "DASHDownloader.h"
+
+using namespace dash;
+using namespace dash::http;
+using namespace dash::logic;
+using namespace dash::buffer;
+using namespace dash::exception;
+
+DASHDownloader::DASHDownloader  (HTTPConnectionManager *conManager, IAdaptationLogic *adaptationLogic,
+                                 BlockBuffer *buffer) :
+    isStarted( false )
+{
+    this->t_sys                     = (thread_sys_t *) malloc(sizeof(thread_sys_t));
+    this->t_sys->conManager         = conManager;
+    this->t_sys->adaptationLogic    = adaptationLogic;
+    this->t_sys->buffer             = buffer;
+}
+DASHDownloader::~DASHDownloader ()
+{
+    if(this->isStarted)
+    {
+        /* Makes a pending put() return and stops the loop */
+        this->t_sys->buffer->setEOF(true);
+        vlc_join(this->dashDLThread, NULL);
+    }
+    free(this->t_sys);
+}
+
+bool    DASHDownloader::start       ()
+{
+    if(vlc_clone(&(this->dashDLThread), download,
+                 (void*)this->t_sys, VLC_THREAD_PRIORITY_LOW))
+        return false;
+
+    this->isStarted = true;
+    return true;
+}
+void*   DASHDownloader::download    (void *thread_sys)
+{
+    thread_sys_t            *t_sys              = (thread_sys_t *) thread_sys;
+    HTTPConnectionManager   *conManager         = t_sys->conManager;
+    IAdaptationLogic        *adaptationLogic    = t_sys->adaptationLogic;
+    BlockBuffer             *buffer             = t_sys->buffer;
+    Chunk                   *currentChunk       = NULL;
+    int                     canc                = vlc_savecancel();
+
+    while(!buffer->getEOF())
+    {
+        block_t *block = block_Alloc(BLOCKSIZE);
+        if(block == NULL)
+            break;
+
+        if(currentChunk == NULL)
+        {
+            adaptationLogic->bufferLevelChanged(buffer->size(), buffer->getCapacity());
+            try
+            {
+                currentChunk = adaptationLogic->getNextChunk();
+            }
+            catch(EOFException &e)
+            {
+                currentChunk = NULL;
+            }
+            if(currentChunk == NULL)
+            {
+                block_Release(block);
+                break;
+            }
+        }
+
+        /* Fill the whole block before queueing it: fewer, larger blocks in
+         * the buffer and one rate notification per block instead of one
+         * per socket read. */
+        size_t filled = 0;
+        while(filled < block->i_buffer)
+        {
+            int ret = conManager->read(currentChunk, block->p_buffer + filled,
+                                       block->i_buffer - filled);
+            if(ret <= 0)
+            {
+                /* On 0 the chunk is complete and the manager released it,
+                 * on -1 no connection could be set up for it. */
+                if(ret < 0)
+                    delete currentChunk;
+                currentChunk = NULL;
+                break;
+            }
+            filled += ret;
+        }
+
+        if(filled == 0)
+        {
+            block_Release(block);
+            continue;
+        }
+
+        block->i_buffer = filled;
+        buffer->put(block);
+        conManager->notify();
+    }
+
+    /* A partially read chunk belongs to the connection manager */
+    buffer->setEOF(true);
+    vlc_restorecancel(canc);
+    return NULL;
+}
@@ -0,0 +1,63 @@
+/*
+ * DASHDownloader.h
+ *****************************************************************************
+ * Copyright (C) 2012 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef DASHDOWNLOADER_H_
+#define DASHDOWNLOADER_H_
+
+#include <vlc_common.h>
+
+#include "http/HTTPConnectionManager.h"
+#include "adaptationlogic/IAdaptationLogic.h"
+#include "exceptions/EOFException.h"
+#include "buffer/BlockBuffer.h"
+
+#define BLOCKSIZE 32768
+
+namespace dash
+{
+    struct thread_sys_t
+    {
+        dash::http::HTTPConnectionManager   *conManager;
+        logic::IAdaptationLogic             *adaptationLogic;
+        buffer::BlockBuffer                 *buffer;
+    };
+
+    /* Fetches chunks ahead of playback on its own thread, so that the
+     * network never waits for the demuxer and the demuxer only waits for
+     * the network when the buffer has run dry. */
+    class DASHDownloader
+    {
+        public:
+            DASHDownloader          (http::HTTPConnectionManager *conManager,
+                                     logic::IAdaptationLogic *adaptationLogic,
+                                     buffer::BlockBuffer *buffer);
+            virtual ~DASHDownloader ();
+
+            bool            start       ();
+            static void*    download    (void *);
+
+        private:
+            thread_sys_t    *t_sys;
+            vlc_thread_t    dashDLThread;
+            bool            isStarted;
+    };
+}
+
+#endif /* DASHDOWNLOADER_H_ */
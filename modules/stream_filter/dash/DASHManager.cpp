@@ -33,15 +33,17 @@ using namespace dash::xml;
 using namespace dash::logic;
 using namespace dash::mpd;
 using namespace dash::exception;
+using namespace dash::buffer;
 
 DASHManager::DASHManager    ( HTTPConnectionManager *conManager, MPD *mpd,
                               IAdaptationLogic::LogicType type ) :
     conManager( conManager ),
-    currentChunk( NULL ),
     adaptationLogic( NULL ),
     logicType( type ),
     mpdManager( NULL ),
-    mpd( mpd )
+    mpd( mpd ),
+    buffer( NULL ),
+    downloader( NULL )
 {
     this->mpdManager        = mpd::MPDManagerFactory::create( mpd );
     if ( this->mpdManager == NULL )
@@ -53,51 +55,30 @@ DASHManager::DASHManager    ( HTTPConnectionManager *conManager, MPD *mpd,
 }
 DASHManager::~DASHManager   ()
 {
+    /* The download thread must be gone before the logic it drives */
+    delete this->downloader;
+    delete this->buffer;
     delete this->adaptationLogic;
     delete this->mpdManager;
 }
 
-int     DASHManager::read( void *p_buffer, size_t len )
+bool    DASHManager::start( size_t bufferSize )
 {
-    if ( this->currentChunk == NULL )
-    {
-        try
-        {
-            this->currentChunk = this->adaptationLogic->getNextChunk();
-        }
-        catch(EOFException &e)
-        {
-            this->currentChunk = NULL;
-            return 0;
-        }
-    }
-
-    int ret = this->conManager->read( this->currentChunk, p_buffer, len );
-    if ( ret == 0 )
-    {
-        this->currentChunk = NULL;
-        return this->read(p_buffer, len );
-    }
+    this->buffer        = new BlockBuffer( bufferSize );
+    this->downloader    = new DASHDownloader( this->conManager,
+                                              this->adaptationLogic,
+                                              this->buffer );
+    return this->downloader->start();
+}
 
-    return ret;
+int     DASHManager::read( void *p_buffer, size_t len )
+{
+    return this->buffer->get( p_buffer, len );
 }
 
 int     DASHManager::peek( const uint8_t **pp_peek, size_t i_peek )
 {
-    if ( this->currentChunk == NULL )
-    {
-        try
-        {
-            this->currentChunk = this->adaptationLogic->getNextChunk();
-        }
-        catch(EOFException &e)
-        {
-            return 0;
-        }
-    }
-
-    int ret = this->conManager->peek( this->currentChunk, pp_peek, i_peek );
-    return ret;
+    return this->buffer->peek( pp_peek, i_peek );
 }
 
 const mpd::IMPDManager*         DASHManager::getMpdManager() const
@@ -33,6 +33,8 @@
 #include "mpd/MPDManagerFactory.h"
 #include "exceptions/EOFException.h"
 #include "mpd/MPD.h"
+#include "buffer/BlockBuffer.h"
+#include "DASHDownloader.h"
 
 namespace dash
 {
@@ -43,6 +45,7 @@ namespace dash
                          logic::IAdaptationLogic::LogicType type );
             virtual ~DASHManager    ();
 
+            bool start( size_t bufferSize );
             int read( void *p_buffer, size_t len );
             int peek( const uint8_t **pp_peek, size_t i_peek );
             const mpd::IMPDManager*         getMpdManager() const;
@@ -50,11 +53,12 @@ namespace dash
 
         private:
             http::HTTPConnectionManager         *conManager;
-            http::Chunk                         *currentChunk;
             logic::IAdaptationLogic             *adaptationLogic;
             logic::IAdaptationLogic::LogicType  logicType;
             mpd::IMPDManager                    *mpdManager;
             mpd::MPD                            *mpd;
+            buffer::BlockBuffer                 *buffer;
+            DASHDownloader                      *downloader;
     };
 }
 
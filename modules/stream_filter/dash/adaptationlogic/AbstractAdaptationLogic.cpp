@@ -36,6 +36,8 @@ AbstractAdaptationLogic::AbstractAdaptationLogic    (IMPDManager *mpdManager)
 {
     this->bpsAvg        = -1;
     this->bpsLastChunk  = 0;
+    this->bufferedBytes = 0;
+    this->bufferCapacity= 0;
     this->mpdManager    = mpdManager;
 }
 AbstractAdaptationLogic::~AbstractAdaptationLogic   ()
@@ -55,3 +57,16 @@ long AbstractAdaptationLogic::getBpsLastChunk        ()
 {
     return this->bpsLastChunk;
 }
+void AbstractAdaptationLogic::bufferLevelChanged     (size_t bytes, size_t capacity)
+{
+    this->bufferedBytes     = bytes;
+    this->bufferCapacity    = capacity;
+}
+size_t AbstractAdaptationLogic::getBufferedBytes     ()
+{
+    return this->bufferedBytes;
+}
+size_t AbstractAdaptationLogic::getBufferCapacity    ()
+{
+    return this->bufferCapacity;
+}
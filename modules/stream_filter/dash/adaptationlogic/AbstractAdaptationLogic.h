@@ -46,13 +46,18 @@ namespace dash
                 virtual ~AbstractAdaptationLogic    ();
 
                 virtual void                downloadRateChanged     (long bpsAvg, long bpsLastChunk);
+                virtual void                bufferLevelChanged      (size_t bytes, size_t capacity);
 
                 long                        getBpsAvg               ();
                 long                        getBpsLastChunk         ();
+                size_t                      getBufferedBytes        ();
+                size_t                      getBufferCapacity       ();
 
             private:
-                int                     bpsAvg;
+                long                    bpsAvg;
                 long                    bpsLastChunk;
+                size_t                  bufferedBytes;
+                size_t                  bufferCapacity;
                 dash::mpd::IMPDManager  *mpdManager;
         };
     }
@@ -38,6 +38,7 @@ IAdaptationLogic* AdaptationLogicFactory::create ( IAdaptationLogic::LogicType l
     {
         case IAdaptationLogic::AlwaysBest:      return new AlwaysBestAdaptationLogic    (mpdManager);
         case IAdaptationLogic::RateBased:       return new RateBasedAdaptationLogic     (mpdManager);
+        case IAdaptationLogic::BufferBased:     return new BufferBasedAdaptationLogic   (mpdManager);
         case IAdaptationLogic::Default:
         case IAdaptationLogic::AlwaysLowest:
         default:
@@ -30,6 +30,7 @@
 #include "mpd/IMPDManager.h"
 #include "adaptationlogic/AlwaysBestAdaptationLogic.h"
 #include "adaptationlogic/RateBasedAdaptationLogic.h"
+#include "adaptationlogic/BufferBasedAdaptationLogic.h"
 
 namespace dash
 {
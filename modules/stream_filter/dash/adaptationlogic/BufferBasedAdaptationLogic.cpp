@@ -0,0 +1,189 @@
+/*
+ * BufferBasedAdaptationLogic.cpp
+ *****************************************************************************
+ * Copyright (C) 2012 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "BufferBasedAdaptationLogic.h"
+
+#include <algorithm>
+
+using namespace dash::logic;
+using namespace dash::xml;
+using namespace dash::http;
+using namespace dash::mpd;
+using namespace dash::exception;
+
+static bool compareBandwidth    (const Representation *a, const Representation *b)
+{
+    return a->getBandwidth() < b->getBandwidth();
+}
+
+BufferBasedAdaptationLogic::BufferBasedAdaptationLogic  (IMPDManager *mpdManager) :
+    AbstractAdaptationLogic( mpdManager ),
+    mpdManager( mpdManager ),
+    count( 0 ),
+    currentPeriod( mpdManager->getFirstPeriod() ),
+    currentRep( NULL ),
+    upHold( 0 )
+{
+}
+
+void    BufferBasedAdaptationLogic::downloadRateChanged (long bpsAvg, long bpsLastChunk)
+{
+    AbstractAdaptationLogic::downloadRateChanged(bpsAvg, bpsLastChunk);
+
+    /* Chunks are fetched one at a time, so the sample belongs to the
+     * representation picked last */
+    if(this->currentRep == NULL || bpsLastChunk <= 0)
+        return;
+
+    std::map<const Representation *, long>::iterator it = this->throughput.find(this->currentRep);
+    if(it == this->throughput.end())
+        this->throughput[this->currentRep] = bpsLastChunk;
+    else
+        it->second += THROUGHPUT_WEIGHT * (bpsLastChunk - it->second);
+}
+long    BufferBasedAdaptationLogic::getThroughput       (const Representation *rep)
+{
+    std::map<const Representation *, long>::const_iterator it = this->throughput.find(rep);
+    if(it != this->throughput.end())
+        return it->second;
+
+    /* Never fetched from: assume it performs like the current one */
+    if(rep != this->currentRep && this->currentRep != NULL)
+    {
+        it = this->throughput.find(this->currentRep);
+        if(it != this->throughput.end())
+            return it->second;
+    }
+    return this->getBpsAvg() > 0 ? this->getBpsAvg() : 0;
+}
+Representation* BufferBasedAdaptationLogic::selectRepresentation    ()
+{
+    std::vector<Representation *>   reps;
+    const std::vector<Group *>      &groups = this->currentPeriod->getGroups();
+
+    for(size_t i = 0; i < groups.size(); i++)
+    {
+        std::vector<Representation *> groupReps = groups.at(i)->getRepresentations();
+        reps.insert(reps.end(), groupReps.begin(), groupReps.end());
+    }
+    if(reps.empty())
+        return NULL;
+
+    std::sort(reps.begin(), reps.end(), compareBandwidth);
+
+    size_t current = 0;
+    while(current < reps.size() && reps.at(current) != this->currentRep)
+        current++;
+
+    /* New period or first chunk: start low, the buffer is empty anyway */
+    if(current == reps.size())
+    {
+        this->upHold = 0;
+        return reps.front();
+    }
+
+    long estimate = this->getThroughput(reps.at(current));
+    if(estimate <= 0)
+        return reps.at(current);
+
+    double fill = 0;
+    if(this->getBufferCapacity() > 0)
+        fill = (double)this->getBufferedBytes() / this->getBufferCapacity();
+
+    size_t target = current;
+    if(fill < BUFFER_LOW)
+    {
+        /* About to stall: take whatever the link sustains right now */
+        target = 0;
+        for(size_t i = 1; i <= current; i++)
+            if(reps.at(i)->getBandwidth() <= estimate * THROUGHPUT_SAFETY)
+                target = i;
+        this->upHold = 0;
+    }
+    else if(fill < BUFFER_HIGH)
+    {
+        /* Let the buffer absorb dips, only leave a representation the link
+         * cannot carry at all */
+        if(current > 0 && reps.at(current)->getBandwidth() > estimate)
+            target = current - 1;
+        this->upHold = 0;
+    }
+    else if(current + 1 < reps.size())
+    {
+        /* Every switch risks a decoder restart and wastes the throughput
+         * history of the old representation: step up one level at a time,
+         * and only once the gain has been stable for a while. */
+        Representation *next = reps.at(current + 1);
+        if(next->getBandwidth() <= this->getThroughput(next) * THROUGHPUT_SAFETY)
+        {
+            if(++this->upHold >= SWITCH_UP_HOLD)
+            {
+                target = current + 1;
+                this->upHold = 0;
+            }
+        }
+        else
+            this->upHold = 0;
+    }
+
+    return reps.at(target);
+}
+
+Chunk*  BufferBasedAdaptationLogic::getNextChunk() throw(EOFException)
+{
+    if(this->mpdManager == NULL)
+        throw EOFException();
+
+    if(this->currentPeriod == NULL)
+        throw EOFException();
+
+    Representation *rep = this->selectRepresentation();
+
+    if ( rep == NULL )
+        throw EOFException();
+
+    std::vector<Segment *> segments = this->mpdManager->getSegments(rep);
+
+    if ( this->count == segments.size() )
+    {
+        this->currentPeriod = this->mpdManager->getNextPeriod(this->currentPeriod);
+        this->currentRep = NULL;
+        this->count = 0;
+        return this->getNextChunk();
+    }
+
+    this->currentRep = rep;
+
+    if ( segments.size() > this->count )
+    {
+        Segment *seg = segments.at( this->count );
+        Chunk *chunk = new Chunk;
+        chunk->setUrl( seg->getSourceUrl() );
+        //In case of UrlTemplate, we must stay on the same segment.
+        if ( seg->isSingleShot() == true )
+            this->count++;
+        seg->done();
+        return chunk;
+    }
+    return NULL;
+}
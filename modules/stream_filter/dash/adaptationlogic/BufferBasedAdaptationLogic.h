@@ -0,0 +1,74 @@
+/*
+ * BufferBasedAdaptationLogic.h
+ *****************************************************************************
+ * Copyright (C) 2012 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef BUFFERBASEDADAPTATIONLOGIC_H_
+#define BUFFERBASEDADAPTATIONLOGIC_H_
+
+#include "adaptationlogic/AbstractAdaptationLogic.h"
+#include "xml/Node.h"
+#include "mpd/IMPDManager.h"
+#include "http/Chunk.h"
+#include "exceptions/EOFException.h"
+#include "mpd/BasicCMManager.h"
+
+#include <map>
+#include <vector>
+
+/* Buffer fill, as a fraction of the download buffer capacity, under which we
+ * only care about not stalling, and over which stepping up is allowed. */
+#define BUFFER_LOW          0.25
+#define BUFFER_HIGH         0.60
+/* Share of the measured throughput a representation may use */
+#define THROUGHPUT_SAFETY   0.80
+/* Weight of a new sample in the per representation throughput average */
+#define THROUGHPUT_WEIGHT   0.30
+/* Favourable decisions in a row needed before stepping up */
+#define SWITCH_UP_HOLD      2
+
+namespace dash
+{
+    namespace logic
+    {
+        /* Picks the representation from the download buffer occupancy first
+         * and the throughput second: while the buffer is well filled, short
+         * congestion is absorbed by it instead of triggering a switch. */
+        class BufferBasedAdaptationLogic : public AbstractAdaptationLogic
+        {
+            public:
+                BufferBasedAdaptationLogic          (dash::mpd::IMPDManager *mpdManager);
+
+                dash::http::Chunk*      getNextChunk() throw(dash::exception::EOFException);
+                void                    downloadRateChanged (long bpsAvg, long bpsLastChunk);
+
+            private:
+                dash::mpd::IMPDManager                          *mpdManager;
+                size_t                                          count;
+                dash::mpd::Period                               *currentPeriod;
+                dash::mpd::Representation                       *currentRep;
+                int                                             upHold;
+                std::map<const dash::mpd::Representation *, long> throughput;
+
+                dash::mpd::Representation*  selectRepresentation    ();
+                long                        getThroughput           (const dash::mpd::Representation *rep);
+        };
+    }
+}
+
+#endif /* BUFFERBASEDADAPTATIONLOGIC_H_ */
@@ -28,12 +28,14 @@
 #include <http/Chunk.h>
 #include <adaptationlogic/IDownloadRateObserver.h>
 #include <exceptions/EOFException.h>
+#include <buffer/IBufferObserver.h>
 
 namespace dash
 {
     namespace logic
     {
-        class IAdaptationLogic : public IDownloadRateObserver
+        class IAdaptationLogic : public IDownloadRateObserver,
+                                 public dash::buffer::IBufferObserver
         {
             public:
 
@@ -42,7 +44,8 @@ namespace dash
                     Default,
                     AlwaysBest,
                     AlwaysLowest,
-                    RateBased
+                    RateBased,
+                    BufferBased
                 };
 
                 virtual dash::http::Chunk*  getNextChunk() throw(dash::exception::EOFException) = 0;
@@ -0,0 +1,155 @@
+/*
+ * BlockBuffer.cpp
+ *****************************************************************************
+ * Copyright (C) 2012 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "buffer/BlockBuffer.h"
+
+using namespace dash::buffer;
+
+BlockBuffer::BlockBuffer    (size_t capacity) :
+    capacity( capacity ),
+    sizeBytes( 0 ),
+    isEOF( false ),
+    peekBlock( NULL )
+{
+    block_BytestreamInit(&this->buffer);
+    vlc_mutex_init(&this->monitorMutex);
+    vlc_cond_init(&this->empty);
+    vlc_cond_init(&this->full);
+}
+BlockBuffer::~BlockBuffer   ()
+{
+    block_BytestreamRelease(&this->buffer);
+    if(this->peekBlock != NULL)
+        block_Release(this->peekBlock);
+
+    vlc_mutex_destroy(&this->monitorMutex);
+    vlc_cond_destroy(&this->empty);
+    vlc_cond_destroy(&this->full);
+}
+
+void    BlockBuffer::put            (block_t *block)
+{
+    vlc_mutex_lock(&this->monitorMutex);
+
+    while(this->sizeBytes >= this->capacity && !this->isEOF)
+        vlc_cond_wait(&this->full, &this->monitorMutex);
+
+    if(this->isEOF)
+    {
+        vlc_mutex_unlock(&this->monitorMutex);
+        block_Release(block);
+        return;
+    }
+
+    this->sizeBytes += block->i_buffer;
+    block_BytestreamPush(&this->buffer, block);
+
+    vlc_cond_signal(&this->empty);
+    vlc_mutex_unlock(&this->monitorMutex);
+}
+int     BlockBuffer::get            (void *p_data, size_t len)
+{
+    vlc_mutex_lock(&this->monitorMutex);
+
+    while(this->sizeBytes == 0 && !this->isEOF)
+        vlc_cond_wait(&this->empty, &this->monitorMutex);
+
+    if(this->sizeBytes == 0)
+    {
+        vlc_mutex_unlock(&this->monitorMutex);
+        return 0;
+    }
+
+    if(len > this->sizeBytes)
+        len = this->sizeBytes;
+
+    /* A NULL buffer means the caller only wants to skip data */
+    if(p_data == NULL)
+        block_SkipBytes(&this->buffer, len);
+    else
+        block_GetBytes(&this->buffer, (uint8_t *)p_data, len);
+
+    block_BytestreamFlush(&this->buffer);
+    this->sizeBytes -= len;
+
+    vlc_cond_signal(&this->full);
+    vlc_mutex_unlock(&this->monitorMutex);
+    return len;
+}
+int     BlockBuffer::peek           (const uint8_t **pp_peek, size_t i_peek)
+{
+    vlc_mutex_lock(&this->monitorMutex);
+
+    /* Never wait for more than the downloader is allowed to queue */
+    while(this->sizeBytes < i_peek && this->sizeBytes < this->capacity && !this->isEOF)
+        vlc_cond_wait(&this->empty, &this->monitorMutex);
+
+    if(i_peek > this->sizeBytes)
+        i_peek = this->sizeBytes;
+
+    if(i_peek == 0)
+    {
+        vlc_mutex_unlock(&this->monitorMutex);
+        return 0;
+    }
+
+    if(this->peekBlock == NULL || this->peekBlock->i_buffer < i_peek)
+    {
+        if(this->peekBlock != NULL)
+            block_Release(this->peekBlock);
+        this->peekBlock = block_Alloc(i_peek);
+        if(this->peekBlock == NULL)
+        {
+            vlc_mutex_unlock(&this->monitorMutex);
+            return -1;
+        }
+    }
+
+    block_PeekBytes(&this->buffer, this->peekBlock->p_buffer, i_peek);
+    *pp_peek = this->peekBlock->p_buffer;
+
+    vlc_mutex_unlock(&this->monitorMutex);
+    return i_peek;
+}
+void    BlockBuffer::setEOF         (bool value)
+{
+    vlc_mutex_lock(&this->monitorMutex);
+    this->isEOF = value;
+    vlc_cond_broadcast(&this->empty);
+    vlc_cond_broadcast(&this->full);
+    vlc_mutex_unlock(&this->monitorMutex);
+}
+bool    BlockBuffer::getEOF         ()
+{
+    vlc_mutex_locker lock(&this->monitorMutex);
+    return this->isEOF;
+}
+size_t  BlockBuffer::size           ()
+{
+    vlc_mutex_locker lock(&this->monitorMutex);
+    return this->sizeBytes;
+}
+size_t  BlockBuffer::getCapacity    () const
+{
+    return this->capacity;
+}
@@ -0,0 +1,62 @@
+/*
+ * BlockBuffer.h
+ *****************************************************************************
+ * Copyright (C) 2012 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef BLOCKBUFFER_H_
+#define BLOCKBUFFER_H_
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_block_helper.h>
+
+namespace dash
+{
+    namespace buffer
+    {
+        /* Bounded FIFO of downloaded data sitting between the download
+         * thread (producer) and the stream filter callbacks (consumer).
+         * The capacity is a byte budget, not a chunk count. */
+        class BlockBuffer
+        {
+            public:
+                BlockBuffer             (size_t capacity);
+                virtual ~BlockBuffer    ();
+
+                void    put             (block_t *block);
+                int     get             (void *p_data, size_t len);
+                int     peek            (const uint8_t **pp_peek, size_t i_peek);
+                void    setEOF          (bool value);
+                bool    getEOF          ();
+                size_t  size            ();
+                size_t  getCapacity     () const;
+
+            private:
+                size_t              capacity;
+                size_t              sizeBytes;
+                bool                isEOF;
+                block_bytestream_t  buffer;
+                block_t             *peekBlock;
+                vlc_mutex_t         monitorMutex;
+                vlc_cond_t          empty;
+                vlc_cond_t          full;
+        };
+    }
+}
+
+#endif /* BLOCKBUFFER_H_ */
@@ -0,0 +1,39 @@
+/*
+ * IBufferObserver.h
+ *****************************************************************************
+ * Copyright (C) 2012 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef IBUFFEROBSERVER_H_
+#define IBUFFEROBSERVER_H_
+
+#include <stddef.h>
+
+namespace dash
+{
+    namespace buffer
+    {
+        class IBufferObserver
+        {
+            public:
+                virtual void bufferLevelChanged(size_t bytes, size_t capacity) = 0;
+                virtual ~IBufferObserver(){}
+        };
+    }
+}
+
+#endif /* IBUFFEROBSERVER_H_ */
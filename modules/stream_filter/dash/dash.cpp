@@ -48,12 +48,36 @@
 static int  Open    (vlc_object_t *);
 static void Close   (vlc_object_t *);
 
+#define LOGIC_TEXT N_("Adaptation logic")
+#define LOGIC_LONGTEXT N_("How the representation to download is chosen: " \
+    "from the measured bandwidth, from the buffer occupancy, or always " \
+    "the best one.")
+
+static const int pi_logics[] = {
+    dash::logic::IAdaptationLogic::RateBased,
+    dash::logic::IAdaptationLogic::BufferBased,
+    dash::logic::IAdaptationLogic::AlwaysBest,
+};
+static const char *const ppsz_logics_text[] = {
+    N_("Bandwidth"), N_("Buffer occupancy"), N_("Always best"),
+};
+
+#define BUFFER_SIZE_TEXT N_("Buffer size (kB)")
+#define BUFFER_SIZE_LONGTEXT N_("Amount of data downloaded ahead of the " \
+    "playback position.")
+
 vlc_module_begin ()
         set_shortname( N_("DASH"))
         set_description( N_("Dynamic Adaptive Streaming over HTTP") )
         set_capability( "stream_filter", 19 )
         set_category( CAT_INPUT )
         set_subcategory( SUBCAT_INPUT_STREAM_FILTER )
+        add_integer( "dash-logic", dash::logic::IAdaptationLogic::RateBased,
+                     LOGIC_TEXT, LOGIC_LONGTEXT, false )
+            change_integer_list( pi_logics, ppsz_logics_text )
+        add_integer( "dash-buffer-size", 8192, BUFFER_SIZE_TEXT,
+                     BUFFER_SIZE_LONGTEXT, true )
+            change_integer_range( 64, 262144 )
         set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -107,14 +131,16 @@ static int Open(vlc_object_t *p_obj)
                               new dash::http::HTTPConnectionManager( p_stream );
     dash::DASHManager*p_dashManager =
             new dash::DASHManager( p_conManager, p_sys->p_mpd,
-                                   dash::logic::IAdaptationLogic::RateBased );
+                                   (dash::logic::IAdaptationLogic::LogicType)
+                                   var_InheritInteger( p_stream, "dash-logic" ) );
 
     if ( p_dashManager->getMpdManager() == NULL ||
          p_dashManager->getMpdManager()->getMPD() == NULL ||
-         p_dashManager->getAdaptionLogic() == NULL )
+         p_dashManager->getAdaptionLogic() == NULL ||
+         !p_dashManager->start( var_InheritInteger( p_stream, "dash-buffer-size" ) * 1024 ) )
     {
-        delete p_conManager;
         delete p_dashManager;
+        delete p_conManager;
         free( p_sys );
         return VLC_EGENERIC;
     }
@@ -141,8 +167,8 @@ static void Close(vlc_object_t *p_obj)
     dash::DASHManager                   *p_dashManager  = p_sys->p_dashManager;
     dash::http::HTTPConnectionManager   *p_conManager   = p_sys->p_conManager;
 
-    delete(p_conManager);
     delete(p_dashManager);
+    delete(p_conManager);
     free(p_sys);
 }
 /*****************************************************************************
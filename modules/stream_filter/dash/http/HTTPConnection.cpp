@@ -27,49 +27,104 @@
 
 #include "HTTPConnection.h"
 
+#include <vlc_url.h>
+
 using namespace dash::http;
 
-HTTPConnection::HTTPConnection  (const std::string& url, stream_t *stream)
+HTTPConnection::HTTPConnection  (const std::string& url, stream_t *stream) :
+    httpSocket( -1 ),
+    url( url ),
+    port( 80 ),
+    stream( stream ),
+    urlStream( NULL ),
+    contentLength( -1 ),
+    bytesRead( 0 ),
+    keepAlive( false )
 {
-    this->url       = url;
-    this->stream    = stream;
 }
 
 HTTPConnection::~HTTPConnection ()
 {
-
+    this->closeSocket();
 }
 
 int             HTTPConnection::read            (void *p_buffer, size_t len)
 {
-    int size = stream_Read(this->urlStream, p_buffer, len);
+    if(this->urlStream != NULL)
+    {
+        int size = stream_Read(this->urlStream, p_buffer, len);
+
+        if(size <= 0)
+            return 0;
+
+        return size;
+    }
+
+    if(this->httpSocket == -1)
+        return 0;
+
+    if(this->contentLength >= 0)
+    {
+        if(this->bytesRead >= this->contentLength)
+            return 0;
+        if((int64_t)len > this->contentLength - this->bytesRead)
+            len = this->contentLength - this->bytesRead;
+    }
 
+    ssize_t size = net_Read(this->stream, this->httpSocket, NULL, p_buffer, len, false);
     if(size <= 0)
+    {
+        this->keepAlive = false;
         return 0;
+    }
 
+    this->bytesRead += size;
     return size;
 }
 int             HTTPConnection::peek            (const uint8_t **pp_peek, size_t i_peek)
 {
+    if(this->urlStream == NULL)
+        return -1;
+
     return stream_Peek(this->urlStream, pp_peek, i_peek);
 }
-void            HTTPConnection::parseURL        ()
+bool            HTTPConnection::parseURL        (const std::string& url)
 {
-    this->hostname = this->url;
-    this->hostname.erase(0, 7);
-    this->path = this->hostname;
+    vlc_url_t   parsed;
+    bool        ret = false;
 
-    size_t pos = this->hostname.find("/");
+    vlc_UrlParse(&parsed, url.c_str(), 0);
 
-    this->hostname  = this->hostname.substr(0, pos);
-    this->path      = this->path.substr(pos, this->path.size());
+    /* Only plain http without credentials is handled here, anything else
+     * goes through the access modules */
+    if(parsed.psz_protocol != NULL && !strcasecmp(parsed.psz_protocol, "http") &&
+       parsed.psz_host != NULL && *parsed.psz_host && parsed.psz_username == NULL)
+    {
+        this->hostname  = parsed.psz_host;
+        this->port      = parsed.i_port > 0 ? parsed.i_port : 80;
+        this->path      = parsed.psz_path != NULL ? parsed.psz_path : "/";
+        ret = true;
+    }
 
-    this->request = "GET " + this->path + " HTTP/1.1\r\n" +
-                    "Host: " + this->hostname + "\r\nConnection: close\r\n\r\n";
+    vlc_UrlClean(&parsed);
+    return ret;
 }
 
 bool            HTTPConnection::init()
 {
+    char *psz_proxy = var_InheritString(this->stream, "http-proxy");
+    bool  direct    = (psz_proxy == NULL || *psz_proxy == '\0');
+    free(psz_proxy);
+
+    if(direct && this->parseURL(this->url))
+    {
+        this->httpSocket = net_ConnectTCP(this->stream, this->hostname.c_str(), this->port);
+        if(this->httpSocket != -1 && this->request(this->url))
+            return true;
+
+        this->closeSocket();
+    }
+
     this->urlStream = stream_UrlNew( this->stream, this->url.c_str() );
 
     if( this->urlStream == NULL )
@@ -78,36 +133,86 @@ bool            HTTPConnection::init()
     return true;
 
 }
+bool            HTTPConnection::request         (const std::string& url)
+{
+    if(this->httpSocket == -1 || !this->parseURL(url))
+        return false;
+
+    std::stringstream req;
+    req << "GET " << this->path << " HTTP/1.1\r\n"
+        << "Host: " << this->hostname;
+    if(this->port != 80)
+        req << ":" << this->port;
+    req << "\r\n";
+
+    char *psz_agent = var_InheritString(this->stream, "http-user-agent");
+    if(psz_agent != NULL)
+        req << "User-Agent: " << psz_agent << "\r\n";
+    free(psz_agent);
+
+    req << "Connection: Keep-Alive\r\n\r\n";
+
+    this->url           = url;
+    this->contentLength = -1;
+    this->bytesRead     = 0;
+    this->keepAlive     = false;
+
+    return this->sendData(req.str()) && this->parseHeader();
+}
+bool            HTTPConnection::isPersistent    () const
+{
+    return this->httpSocket != -1 && this->keepAlive &&
+           this->contentLength >= 0 && this->bytesRead == this->contentLength;
+}
 bool            HTTPConnection::parseHeader     ()
 {
-    std::string line = this->readLine();
+    char *psz_line = net_Gets(this->stream, this->httpSocket, NULL);
+    int   i_major, i_minor, i_code;
 
-    while(line.compare("\r\n"))
+    if(psz_line == NULL ||
+       sscanf(psz_line, "HTTP/%d.%d %d", &i_major, &i_minor, &i_code) != 3)
     {
-        line = this->readLine();
+        free(psz_line);
+        return false;
     }
+    free(psz_line);
 
-    return true;
-}
-std::string     HTTPConnection::readLine        ()
-{
-    std::stringstream ss;
-    char c[1];
-    size_t size = net_Read(this->stream, this->httpSocket, NULL, c, 1, false);
+    /* HTTP/1.1 connections are persistent unless told otherwise */
+    bool persistent = (i_major > 1 || (i_major == 1 && i_minor >= 1));
+    bool chunked    = false;
 
-    while(size)
+    while((psz_line = net_Gets(this->stream, this->httpSocket, NULL)) != NULL)
     {
-        ss << c[0];
-        if(c[0] == '\n')
+        if(*psz_line == '\0')
             break;
 
-        size = net_Read(this->stream, this->httpSocket, NULL, c, 1, false);
+        char *psz_value = strchr(psz_line, ':');
+        if(psz_value != NULL)
+        {
+            *psz_value++ = '\0';
+            while(*psz_value == ' ' || *psz_value == '\t')
+                psz_value++;
+
+            if(!strcasecmp(psz_line, "Content-Length"))
+                this->contentLength = strtoll(psz_value, NULL, 10);
+            else if(!strcasecmp(psz_line, "Connection"))
+                persistent = strcasecmp(psz_value, "close") != 0;
+            else if(!strcasecmp(psz_line, "Transfer-Encoding"))
+                chunked = strcasecmp(psz_value, "identity") != 0;
+        }
+        free(psz_line);
     }
 
-    if(size > 0)
-        return ss.str();
+    if(psz_line == NULL)
+        return false;
+    free(psz_line);
+
+    /* Redirections, errors and chunked bodies are left to the http access */
+    if(i_code != 200 || chunked)
+        return false;
 
-    return "\r\n";
+    this->keepAlive = persistent;
+    return true;
 }
 bool            HTTPConnection::sendData        (const std::string& data)
 {
@@ -118,12 +223,18 @@ bool            HTTPConnection::sendData        (const std::string& data)
     }
     if ((size_t)size != data.length())
     {
-        this->sendData(data.substr(size, data.size()));
+        return this->sendData(data.substr(size, data.size()));
     }
 
     return true;
 }
 void            HTTPConnection::closeSocket     ()
 {
-    stream_Delete(this->urlStream);
+    if(this->urlStream != NULL)
+        stream_Delete(this->urlStream);
+    this->urlStream = NULL;
+
+    if(this->httpSocket != -1)
+        net_Close(this->httpSocket);
+    this->httpSocket = -1;
 }
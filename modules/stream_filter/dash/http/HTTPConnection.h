@@ -48,6 +48,8 @@ namespace dash
                 virtual ~HTTPConnection ();
 
                 bool        init            ();
+                bool        request         (const std::string& url);
+                bool        isPersistent    () const;
                 void        closeSocket     ();
 
                 virtual int     read        (void *p_buffer, size_t len);
@@ -57,15 +59,17 @@ namespace dash
                 int                     httpSocket;
                 std::string             url;
                 std::string             hostname;
+                int                     port;
                 std::string             path;
-                std::string             request;
                 stream_t                *stream;
                 stream_t                *urlStream;
+                int64_t                 contentLength;
+                int64_t                 bytesRead;
+                bool                    keepAlive;
 
-                void            parseURL        ();
+                bool            parseURL        (const std::string& url);
                 bool            sendData        (const std::string& data);
                 bool            parseHeader     ();
-                std::string     readLine        ();
         };
     }
 }
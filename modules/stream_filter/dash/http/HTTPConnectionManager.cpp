@@ -64,11 +64,22 @@ bool                HTTPConnectionManager::closeConnection( IHTTPConnection *con
 
 bool                HTTPConnectionManager::closeConnection( Chunk *chunk )
 {
-    HTTPConnection *con = this->chunkMap[chunk];
-    bool ret = this->closeConnection(con);
+    HTTPConnection *con     = this->chunkMap[chunk];
+    std::string     origin  = getOrigin(chunk->getUrl());
+
     this->chunkMap.erase(chunk);
     delete(chunk);
-    return ret;
+
+    /* Keep the connection around for the next chunk from the same server */
+    if(con->isPersistent())
+    {
+        std::map<std::string, HTTPConnection *>::iterator it = this->urlMap.find(origin);
+        if(it != this->urlMap.end() && it->second != con)
+            this->closeConnection(it->second);
+        this->urlMap[origin] = con;
+        return true;
+    }
+    return this->closeConnection(con);
 }
 
 void                HTTPConnectionManager::closeAllConnections      ()
@@ -130,26 +141,37 @@ int                 HTTPConnectionManager::read( Chunk *chunk, void *p_buffer, s
         if(this->bpsLastChunk < 0 || this->chunkCount < 2)
             this->bpsLastChunk = 0;
 
-        this->notify();
     }
     return ret;
 }
 
-int                 HTTPConnectionManager::peek                     (Chunk *chunk, const uint8_t **pp_peek, size_t i_peek)
+IHTTPConnection*     HTTPConnectionManager::initConnection(Chunk *chunk)
 {
-    if(this->chunkMap.find(chunk) == this->chunkMap.end())
+    HTTPConnection *con = NULL;
+    std::map<std::string, HTTPConnection *>::iterator it =
+            this->urlMap.find(getOrigin(chunk->getUrl()));
+
+    if(it != this->urlMap.end())
     {
-        if ( this->initConnection(chunk) == NULL )
-            return -1;
+        con = it->second;
+        this->urlMap.erase(it);
+
+        /* The server may have dropped the idle connection meanwhile */
+        if(con->request(chunk->getUrl()))
+        {
+            this->chunkMap[chunk] = con;
+            this->chunkCount++;
+            return con;
+        }
+        this->closeConnection(con);
     }
-    return this->chunkMap[chunk]->peek(pp_peek, i_peek);
-}
 
-IHTTPConnection*     HTTPConnectionManager::initConnection(Chunk *chunk)
-{
-    HTTPConnection *con = new HTTPConnection(chunk->getUrl(), this->stream);
+    con = new HTTPConnection(chunk->getUrl(), this->stream);
     if ( con->init() == false )
+    {
+        delete con;
         return NULL;
+    }
     this->connections.push_back(con);
     this->chunkMap[chunk] = con;
     this->chunkCount++;
@@ -166,3 +188,11 @@ void                HTTPConnectionManager::notify                   ()
     for(size_t i = 0; i < this->rateObservers.size(); i++)
         this->rateObservers.at(i)->downloadRateChanged(this->bpsAvg, this->bpsLastChunk);
 }
+std::string         HTTPConnectionManager::getOrigin                (const std::string& url)
+{
+    size_t pos = url.find("://");
+    if(pos == std::string::npos)
+        return url;
+
+    return url.substr(0, url.find('/', pos + 3));
+}
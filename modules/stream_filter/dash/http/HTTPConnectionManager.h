@@ -51,7 +51,6 @@ namespace dash
                 void                closeAllConnections ();
                 bool                closeConnection     (IHTTPConnection *con);
                 int                 read                (Chunk *chunk, void *p_buffer, size_t len);
-                int                 peek                (Chunk *chunk, const uint8_t **pp_peek, size_t i_peek);
                 void                attach              (dash::logic::IDownloadRateObserver *observer);
                 void                notify              ();
 
@@ -72,6 +71,8 @@ namespace dash
                 bool                closeConnection( Chunk *chunk );
                 IHTTPConnection*    initConnection( Chunk *chunk );
 
+                static std::string  getOrigin( const std::string& url );
+
         };
     }
 }
@@ -35,6 +35,7 @@ using namespace dash::mpd;
 
 SegmentInfoCommon::SegmentInfoCommon() :
     duration( -1 ),
+    startIndex( -1 ),
     initialisationSegment( NULL ),
     segmentTimeline( NULL )
 {
@@ -29,6 +29,7 @@
 #include "Representation.h"
 #include "Group.h"
 #include "SegmentInfoDefault.h"
+#include "SegmentInfo.h"
 
 #include <cassert>
 #include <cstring>
@@ -47,6 +48,8 @@ SegmentTemplate::SegmentTemplate( bool containRuntimeIdentifier,
 {
 }
 
+/* URLs are built from the template when requested, so neither memory nor
+ * parsing time depends on the number of segments in the presentation. */
 std::string     SegmentTemplate::getSourceUrl() const
 {
     std::string     res = this->sourceUrl;
@@ -55,27 +58,57 @@ std::string     SegmentTemplate::getSourceUrl() const
         return Segment::getSourceUrl();
 
     if ( this->beginIndex != std::string::npos )
-        std::cerr << "Unhandled identifier \"$Index$\"" << std::endl;
+    {
+        std::ostringstream  oss;
+        oss << this->getStartIndex() + this->currentSegmentIndex;
+        res.replace( res.find( "$Index$" ), strlen("$Index$"), oss.str() );
+    }
     if ( this->beginTime != std::string::npos )
     {
-        //FIXME: This should use the current representation SegmentInfo
-        //which "inherits" the SegmentInfoDefault values.
-        if ( this->representation->getParentGroup()->getSegmentInfoDefault() != NULL &&
-             this->representation->getParentGroup()->getSegmentInfoDefault()->getSegmentTimeline() != NULL )
+        const SegmentTimeline   *timeline = this->getSegmentTimeline();
+        int64_t                 time = -1;
+
+        if ( timeline != NULL )
+            time = timeline->getElementTime( this->currentSegmentIndex );
+        if ( time >= 0 )
         {
-            const SegmentTimeline::Element  *el = this->representation->getParentGroup()->
-                    getSegmentInfoDefault()->getSegmentTimeline()->getElement( this->currentSegmentIndex );
-            if ( el != NULL )
-            {
-                std::ostringstream  oss;
-                oss << el->t;
-                res.replace( this->beginTime, strlen("$Time$"), oss.str() );
-            }
+            std::ostringstream  oss;
+            oss << time;
+            res.replace( res.find( "$Time$" ), strlen("$Time$"), oss.str() );
         }
+        else
+            std::cerr << "No SegmentTimeline entry for segment " <<
+                         this->currentSegmentIndex << std::endl;
     }
     return res;
 }
 
+const SegmentTimeline*  SegmentTemplate::getSegmentTimeline() const
+{
+    const SegmentInfo   *info = this->representation->getSegmentInfo();
+    if ( info != NULL && info->getSegmentTimeline() != NULL )
+        return info->getSegmentTimeline();
+
+    const SegmentInfoDefault    *infoDefault =
+            this->representation->getParentGroup()->getSegmentInfoDefault();
+    if ( infoDefault != NULL )
+        return infoDefault->getSegmentTimeline();
+    return NULL;
+}
+
+int     SegmentTemplate::getStartIndex() const
+{
+    const SegmentInfo   *info = this->representation->getSegmentInfo();
+    if ( info != NULL && info->getStartIndex() >= 0 )
+        return info->getStartIndex();
+
+    const SegmentInfoDefault    *infoDefault =
+            this->representation->getParentGroup()->getSegmentInfoDefault();
+    if ( infoDefault != NULL && infoDefault->getStartIndex() >= 0 )
+        return infoDefault->getStartIndex();
+    return 1;
+}
+
 void    SegmentTemplate::setSourceUrl( const std::string &url )
 {
     if ( this->containRuntimeIdentifier == true )
@@ -88,7 +121,13 @@ void    SegmentTemplate::setSourceUrl( const std::string &url )
 
 bool            SegmentTemplate::isSingleShot() const
 {
-    return false;
+    /* Only a timeline bounds the number of segments a template yields:
+     * let the caller move on once its last entry has been produced. */
+    if ( this->containRuntimeIdentifier == false )
+        return false;
+    const SegmentTimeline   *timeline = this->getSegmentTimeline();
+    return timeline != NULL &&
+           (unsigned int)this->currentSegmentIndex + 1 >= timeline->getElementCount();
 }
 
 void SegmentTemplate::done()
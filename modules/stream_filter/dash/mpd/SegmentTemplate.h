@@ -31,6 +31,7 @@ namespace dash
     namespace mpd
     {
         class   Representation;
+        class   SegmentTimeline;
 
         class SegmentTemplate : public Segment
         {
@@ -41,6 +42,9 @@ namespace dash
                 virtual bool            isSingleShot() const;
                 virtual void            done();
             private:
+                const SegmentTimeline*  getSegmentTimeline() const;
+                int                     getStartIndex() const;
+
                 bool                    containRuntimeIdentifier;
                 Representation*         representation;
                 size_t                  beginTime;
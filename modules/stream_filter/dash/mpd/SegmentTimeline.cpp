@@ -31,7 +31,8 @@
 using namespace dash::mpd;
 
 SegmentTimeline::SegmentTimeline() :
-    timescale( -1 )
+    timescale( -1 ),
+    count( 0 )
 {
 }
 
@@ -52,34 +53,36 @@ void dash::mpd::SegmentTimeline::setTimescale(int timescale)
 
 void dash::mpd::SegmentTimeline::addElement(dash::mpd::SegmentTimeline::Element *e)
 {
-    int64_t         offset = 0;
-    for ( int i = 0; i <= e->r; ++i )
-    {
-        this->elements.push_back( e );
-        if ( i < e->r )
-        {
-            e = new SegmentTimeline::Element( *e );
-            offset += e->d;
-            e->t += offset;
-        }
-    }
+    if ( e->r < 0 )
+        e->r = 0;
+    this->elements.push_back( e );
+    this->firstIndexes.push_back( this->count );
+    this->count += e->r + 1;
 }
 
-const SegmentTimeline::Element*    SegmentTimeline::getElement( unsigned int index ) const
+int64_t SegmentTimeline::getElementTime( unsigned int index ) const
 {
-    if ( this->elements.size() <= index )
-        return NULL;
-    std::list<Element*>::const_iterator     it = this->elements.begin();
-    std::list<Element*>::const_iterator     end = this->elements.end();
-    unsigned int                            i = 0;
-    while ( it != end )
+    if ( index >= this->count )
+        return -1;
+
+    /* Last S element starting at or before index */
+    size_t  low = 0;
+    size_t  high = this->firstIndexes.size() - 1;
+    while ( low < high )
     {
-        if ( i == index )
-            return *it;
-        ++it;
-        ++i;
+        size_t  mid = ( low + high + 1 ) / 2;
+        if ( this->firstIndexes[mid] <= index )
+            low = mid;
+        else
+            high = mid - 1;
     }
-    return NULL;
+    const Element   *e = this->elements[low];
+    return e->t + (int64_t)( index - this->firstIndexes[low] ) * e->d;
+}
+
+unsigned int SegmentTimeline::getElementCount() const
+{
+    return this->count;
 }
 
 dash::mpd::SegmentTimeline::Element::Element() :
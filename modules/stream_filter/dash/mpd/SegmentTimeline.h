@@ -25,7 +25,7 @@
 #define SEGMENTTIMELINE_H
 
 #include <sys/types.h>
-#include <list>
+#include <vector>
 #include <stdint.h>
 
 namespace dash
@@ -48,11 +48,15 @@ namespace dash
                 int                     getTimescale() const;
                 void                    setTimescale( int timescale );
                 void                    addElement( Element* e );
-                const Element*          getElement( unsigned int index ) const;
+                int64_t                 getElementTime( unsigned int index ) const;
+                unsigned int            getElementCount() const;
 
             private:
                 int                     timescale;
-                std::list<Element*>     elements;
+                /* One entry per S element, repetitions are not expanded */
+                std::vector<Element*>   elements;
+                std::vector<unsigned int> firstIndexes;
+                unsigned int            count;
         };
     }
 }
@@ -43,6 +43,8 @@
 #include <vlc_stream.h>
 #include <vlc_memory.h>
 #include <vlc_gcrypt.h>
+#include <vlc_network.h>
+#include <vlc_url.h>
 
 /*****************************************************************************
  * Module descriptor
@@ -50,11 +52,23 @@
 static int  Open (vlc_object_t *);
 static void Close(vlc_object_t *);
 
+#define PREFETCH_TEXT N_("Parallel segment downloads")
+#define PREFETCH_LONGTEXT N_( \
+    "Number of segments downloaded at the same time, ahead of the " \
+    "current download position." )
+#define KEEPALIVE_TEXT N_("Reuse HTTP connections")
+#define KEEPALIVE_LONGTEXT N_( \
+    "Keep HTTP/1.1 connections to segment servers open and reuse them " \
+    "for the following segments, instead of connecting for each segment." )
+
 vlc_module_begin()
     set_category(CAT_INPUT)
     set_subcategory(SUBCAT_INPUT_STREAM_FILTER)
     set_description(N_("Http Live Streaming stream filter"))
     set_capability("stream_filter", 20)
+    add_integer("hls-prefetch", 2, PREFETCH_TEXT, PREFETCH_LONGTEXT, true)
+        change_integer_range(1, 8)
+    add_bool("hls-keep-alive", true, KEEPALIVE_TEXT, KEEPALIVE_LONGTEXT, true)
     set_callbacks(Open, Close)
 vlc_module_end()
 
@@ -89,6 +103,8 @@ typedef struct hls_stream_s
                                foreach segment of (segment->duration * hls->bandwidth/8) */
 
     vlc_array_t *segments;  /* list of segments */
+    int          known_first; /* sequence range already known when */
+    int          known_last;  /* reloading, those segments are skipped */
     char        *url;        /* uri to m3u8 */
     vlc_mutex_t lock;
     bool        b_cache;    /* allow caching */
@@ -98,6 +114,32 @@ typedef struct hls_stream_s
     bool         b_iv_loaded;
 } hls_stream_t;
 
+typedef struct hls_conn_s
+{
+    char        *psz_host;
+    int          i_port;
+    int          fd;        /* idle keep-alive socket */
+} hls_conn_t;
+
+#define HLS_POOL_MAX 8      /* maximum number of idle connections */
+
+/* AES-128-CBC decryption of a segment, done while it is downloaded */
+typedef struct hls_cipher_s
+{
+    gcry_cipher_hd_t handle;
+    uint8_t          iv[AES_BLOCK_SIZE];
+    size_t           offset;    /* bytes already decrypted */
+} hls_cipher_t;
+
+#define HLS_READ_CHUNK 32768    /* bytes read between two decrypt calls */
+
+/* Bitrate adaptation */
+#define HLS_EWMA_FAST   0.50    /* weight of history in the fast average */
+#define HLS_EWMA_SLOW   0.85    /* weight of history in the slow average */
+#define HLS_WINDOW      6       /* segments buffered ahead of playback */
+#define HLS_UP_MARGIN   0.80    /* only use 80% of the estimate to go up */
+#define HLS_UP_HOLD     3       /* segments to wait between two up-switches */
+
 struct stream_sys_t
 {
     char         *m3u8;         /* M3U8 url */
@@ -108,7 +150,19 @@ struct stream_sys_t
 
     /* */
     vlc_array_t  *hls_stream;   /* bandwidth adaptation */
-    uint64_t      bandwidth;    /* measured bandwidth (bits per second) */
+    uint64_t      bandwidth;    /* estimated bandwidth (bits per second) */
+
+    /* Bitrate adaptation, protected by download.lock_wait */
+    struct hls_adaptation_s
+    {
+        double      fast;       /* fast moving average (bits per second) */
+        double      slow;       /* slow moving average (bits per second) */
+        int         samples;    /* number of measured segments */
+        int         hold;       /* segments since the last switch */
+        unsigned    ups;        /* decisions statistics */
+        unsigned    downs;
+        unsigned    holds;
+    } adaptation;
 
     /* Download */
     struct hls_download_s
@@ -120,6 +174,26 @@ struct stream_sys_t
         vlc_cond_t  wait;       /* some condition to wait on */
     } download;
 
+    /* Parallel segment downloads */
+    struct hls_prefetch_s
+    {
+        int           depth;    /* segments fetched ahead of hls_Thread */
+        int           count;    /* number of helper threads running */
+        vlc_thread_t *threads;
+        vlc_cond_t    wait;     /* download position moved */
+        bool          b_close;  /* protected by download.lock_wait */
+    } prefetch;
+
+    /* HTTP/1.1 keep-alive connections */
+    struct hls_pool_s
+    {
+        bool          b_enabled;
+        char         *psz_user_agent;
+        vlc_mutex_t   lock;
+        int           count;
+        hls_conn_t    conns[HLS_POOL_MAX];
+    } pool;
+
     /* Playback */
     struct hls_playback_s
     {
@@ -155,10 +229,11 @@ static ssize_t read_M3U8_from_stream(stream_t *s, uint8_t **buffer);
 static ssize_t read_M3U8_from_url(stream_t *s, const char *psz_url, uint8_t **buffer);
 static char *ReadLine(uint8_t *buffer, uint8_t **pos, size_t len);
 
-static int hls_Download(stream_t *s, segment_t *segment);
+static int hls_Download(stream_t *s, segment_t *segment, hls_cipher_t *cipher);
 
 static void* hls_Thread(void *);
 static void* hls_Reload(void *);
+static void* hls_PrefetchThread(void *);
 
 static segment_t *segment_GetSegment(hls_stream_t *hls, int wanted);
 static void segment_Free(segment_t *segment);
@@ -242,6 +317,8 @@ static hls_stream_t *hls_New(vlc_array_t *hls_stream, const int id, const uint64
     }
     hls->psz_current_key_path = NULL;
     hls->segments = vlc_array_new();
+    hls->known_first = 0;
+    hls->known_last = -1;
     vlc_array_append(hls_stream, hls);
     vlc_mutex_init(&hls->lock);
     return hls;
@@ -290,6 +367,19 @@ static hls_stream_t *hls_Copy(hls_stream_t *src, const bool b_cp_segments)
     }
     if (!b_cp_segments)
         dst->segments = vlc_array_new();
+
+    /* Remember which segments src already has */
+    dst->known_first = 0;
+    dst->known_last = -1;
+    vlc_mutex_lock(&src->lock);
+    int count = vlc_array_count(src->segments);
+    if (count > 0)
+    {
+        dst->known_first = segment_GetSegment(src, 0)->sequence;
+        dst->known_last = segment_GetSegment(src, count - 1)->sequence;
+    }
+    vlc_mutex_unlock(&src->lock);
+
     vlc_mutex_init(&dst->lock);
     return dst;
 }
@@ -416,6 +506,16 @@ static segment_t *segment_Find(hls_stream_t *hls, const int sequence)
 
     int count = vlc_array_count(hls->segments);
     if (count <= 0) return NULL;
+
+    /* Sequence numbers are normally consecutive */
+    int index = sequence - segment_GetSegment(hls, 0)->sequence;
+    if (index >= 0 && index < count)
+    {
+        segment_t *segment = segment_GetSegment(hls, index);
+        if (segment->sequence == sequence)
+            return segment;
+    }
+
     for (int n = 0; n < count; n++)
     {
         segment_t *segment = segment_GetSegment(hls, n);
@@ -607,7 +707,8 @@ static int parse_SegmentInformation(hls_stream_t *hls, char *p_read, int *durati
     return VLC_SUCCESS;
 }
 
-static int parse_AddSegment(hls_stream_t *hls, const int duration, const char *uri)
+static int parse_AddSegment(hls_stream_t *hls, const int duration, const char *uri,
+                            const int sequence)
 {
     assert(hls);
     assert(uri);
@@ -619,7 +720,7 @@ static int parse_AddSegment(hls_stream_t *hls, const int duration, const char *u
 
     segment_t *segment = segment_New(hls, duration, psz_uri ? psz_uri : uri);
     if (segment)
-        segment->sequence = hls->sequence + vlc_array_count(hls->segments) - 1;
+        segment->sequence = sequence;
     free(psz_uri);
 
     vlc_mutex_unlock(&hls->lock);
@@ -775,6 +876,7 @@ static int parse_Key(stream_t *s, hls_stream_t *hls, char *p_read)
             if (end != NULL)
                 *end = 0;
         }
+        free(hls->psz_current_key_path);
         hls->psz_current_key_path = strdup(uri);
         free(value);
 
@@ -902,7 +1004,7 @@ static int parse_M3U8(stream_t *s, vlc_array_t *streams, uint8_t *buffer, const
     assert(streams);
     assert(buffer);
 
-    msg_Dbg(s, "parse_M3U8\n%s", buffer);
+    msg_Dbg(s, "parse_M3U8 (%zd bytes)", len);
     p_begin = buffer;
     p_end = p_begin + len;
 
@@ -1040,8 +1142,8 @@ static int parse_M3U8(stream_t *s, vlc_array_t *streams, uint8_t *buffer, const
         msg_Info(s, "%s Playlist HLS protocol version: %d", p_sys->b_live ? "Live": "VOD", version);
 
         hls_stream_t *hls = NULL;
-        if (p_sys->b_meta)
-            hls = hls_GetLast(streams);
+        if (p_sys->b_meta || vlc_array_count(streams) > 0)
+            hls = hls_GetLast(streams); /* meta playlist or reload */
         else
         {
             /* No Meta playlist used */
@@ -1071,6 +1173,8 @@ static int parse_M3U8(stream_t *s, vlc_array_t *streams, uint8_t *buffer, const
         /* */
         bool media_sequence_loaded = false;
         int segment_duration = -1;
+        int segment_index = 0;
+        int skipped = 0;
         do
         {
             /* Next line */
@@ -1107,7 +1211,13 @@ static int parse_M3U8(stream_t *s, vlc_array_t *streams, uint8_t *buffer, const
                 err = parse_EndList(s, hls);
             else if ((strncmp(line, "#", 1) != 0) && (*line != '\0') )
             {
-                err = parse_AddSegment(hls, segment_duration, line);
+                int sequence = hls->sequence + segment_index++;
+
+                /* Only new segments matter when reloading a playlist */
+                if (sequence >= hls->known_first && sequence <= hls->known_last)
+                    skipped++;
+                else
+                    err = parse_AddSegment(hls, segment_duration, line, sequence);
                 segment_duration = -1; /* reset duration */
             }
 
@@ -1120,6 +1230,9 @@ static int parse_M3U8(stream_t *s, vlc_array_t *streams, uint8_t *buffer, const
         } while (err == VLC_SUCCESS);
 
         free(line);
+
+        if (skipped > 0)
+            msg_Dbg(s, "skipped %d known segments", skipped);
     }
 
     return err;
@@ -1178,12 +1291,9 @@ static int hls_ManageSegmentKeys(stream_t *s, hls_stream_t *hls)
     return VLC_SUCCESS;
 }
 
-static int hls_DecodeSegmentData(stream_t *s, hls_stream_t *hls, segment_t *segment)
+static int hls_CipherOpen(stream_t *s, hls_stream_t *hls, segment_t *segment,
+                          hls_cipher_t *cipher)
 {
-    /* Did the segment need to be decoded ? */
-    if (segment->psz_key_path == NULL)
-        return VLC_SUCCESS;
-
     /* Do we have loaded the key ? */
     if (!segment->b_key_loaded)
     {
@@ -1194,58 +1304,105 @@ static int hls_DecodeSegmentData(stream_t *s, hls_stream_t *hls, segment_t *segm
 
     /* For now, we only decode AES-128 data */
     gcry_error_t i_gcrypt_err;
-    gcry_cipher_hd_t aes_ctx;
     /* Setup AES */
-    i_gcrypt_err = gcry_cipher_open(&aes_ctx, GCRY_CIPHER_AES,
+    i_gcrypt_err = gcry_cipher_open(&cipher->handle, GCRY_CIPHER_AES,
                                      GCRY_CIPHER_MODE_CBC, 0);
     if (i_gcrypt_err)
     {
         msg_Err(s, "gcry_cipher_open failed: %s", gpg_strerror(i_gcrypt_err));
-        gcry_cipher_close(aes_ctx);
         return VLC_EGENERIC;
     }
 
     /* Set key */
-    i_gcrypt_err = gcry_cipher_setkey(aes_ctx, segment->aes_key,
+    i_gcrypt_err = gcry_cipher_setkey(cipher->handle, segment->aes_key,
                                        sizeof(segment->aes_key));
     if (i_gcrypt_err)
     {
         msg_Err(s, "gcry_cipher_setkey failed: %s", gpg_strerror(i_gcrypt_err));
-        gcry_cipher_close(aes_ctx);
+        gcry_cipher_close(cipher->handle);
         return VLC_EGENERIC;
     }
 
-    if (hls->b_iv_loaded == false)
+    /* Segments may be fetched by several threads, keep the IV local */
+    vlc_mutex_lock(&hls->lock);
+    if (hls->b_iv_loaded)
+        memcpy(cipher->iv, hls->psz_AES_IV, AES_BLOCK_SIZE);
+    else
     {
-        memset(hls->psz_AES_IV, 0, AES_BLOCK_SIZE);
-        hls->psz_AES_IV[15] = segment->sequence & 0xff;
-        hls->psz_AES_IV[14] = (segment->sequence >> 8)& 0xff;
-        hls->psz_AES_IV[13] = (segment->sequence >> 16)& 0xff;
-        hls->psz_AES_IV[12] = (segment->sequence >> 24)& 0xff;
+        memset(cipher->iv, 0, AES_BLOCK_SIZE);
+        cipher->iv[15] = segment->sequence & 0xff;
+        cipher->iv[14] = (segment->sequence >> 8)& 0xff;
+        cipher->iv[13] = (segment->sequence >> 16)& 0xff;
+        cipher->iv[12] = (segment->sequence >> 24)& 0xff;
     }
+    vlc_mutex_unlock(&hls->lock);
 
-    i_gcrypt_err = gcry_cipher_setiv(aes_ctx, hls->psz_AES_IV,
-                                      sizeof(hls->psz_AES_IV));
-
+    cipher->offset = 0;
+    i_gcrypt_err = gcry_cipher_setiv(cipher->handle, cipher->iv,
+                                      sizeof(cipher->iv));
     if (i_gcrypt_err)
     {
         msg_Err(s, "gcry_cipher_setiv failed: %s", gpg_strerror(i_gcrypt_err));
-        gcry_cipher_close(aes_ctx);
+        gcry_cipher_close(cipher->handle);
         return VLC_EGENERIC;
     }
+    return VLC_SUCCESS;
+}
+
+/* Restart decryption from the beginning of the segment */
+static void hls_CipherReset(hls_cipher_t *cipher)
+{
+    if (cipher != NULL && cipher->offset > 0)
+    {
+        gcry_cipher_setiv(cipher->handle, cipher->iv, sizeof(cipher->iv));
+        cipher->offset = 0;
+    }
+}
+
+/* Decrypt in place the complete AES blocks received so far.
+ * CBC only needs the previous cipher block, which gcrypt keeps between
+ * calls, so the segment can be decrypted while it is being downloaded. */
+static int hls_CipherUpdate(stream_t *s, hls_cipher_t *cipher,
+                            uint8_t *p_buffer, size_t i_length)
+{
+    if (cipher == NULL)
+        return VLC_SUCCESS;
+
+    size_t end = i_length & ~(size_t)(AES_BLOCK_SIZE - 1);
+    if (end <= cipher->offset)
+        return VLC_SUCCESS;
 
-    i_gcrypt_err = gcry_cipher_decrypt(aes_ctx,
-                                       segment->data->p_buffer, /* out */
-                                       segment->data->i_buffer,
-                                       NULL, /* in */
-                                       0);
+    gcry_error_t i_gcrypt_err = gcry_cipher_decrypt(cipher->handle,
+                                        p_buffer + cipher->offset, /* out */
+                                        end - cipher->offset,
+                                        NULL, /* in */
+                                        0);
     if (i_gcrypt_err)
     {
         msg_Err(s, "gcry_cipher_decrypt failed:  %s/%s\n", gcry_strsource(i_gcrypt_err), gcry_strerror(i_gcrypt_err));
-        gcry_cipher_close(aes_ctx);
         return VLC_EGENERIC;
     }
-    gcry_cipher_close(aes_ctx);
+    cipher->offset = end;
+    return VLC_SUCCESS;
+}
+
+static int hls_DecodeSegmentData(stream_t *s, segment_t *segment, hls_cipher_t *cipher)
+{
+    /* Did the segment need to be decoded ? */
+    if (cipher == NULL)
+        return VLC_SUCCESS;
+
+    /* Most of the segment was decrypted during the download */
+    if (hls_CipherUpdate(s, cipher, segment->data->p_buffer,
+                         segment->data->i_buffer) != VLC_SUCCESS)
+        return VLC_EGENERIC;
+    if (cipher->offset != segment->data->i_buffer || cipher->offset == 0)
+    {
+        msg_Err(s, "encrypted segment size (%zu) is not a multiple of the AES block size",
+                segment->data->i_buffer);
+        return VLC_EGENERIC;
+    }
+
     /* remove the PKCS#7 padding from the buffer */
     int pad = segment->data->p_buffer[segment->data->i_buffer-1];
     if (pad <= 0 || pad > AES_BLOCK_SIZE)
@@ -1342,24 +1499,22 @@ static int hls_UpdatePlaylist(stream_t *s, hls_stream_t *hls_new, hls_stream_t *
                 free(segment->url);
                 segment->url = strdup(p->url);
                 if ( segment->url == NULL )
-                {
                     msg_Err(s, "Failed updating segment %d - skipping it",  p->sequence);
-                    segment_Free(p);
-                    vlc_mutex_unlock(&segment->lock);
-                    continue;
-                }
-                /* We must free the content, because if the key was not downloaded, content can't be decrypted */
-                if ((p->psz_key_path || p->b_key_loaded) &&
-                    segment->data)
+                else
                 {
-                    block_Release(segment->data);
-                    segment->data = NULL;
+                    /* We must free the content, because if the key was not downloaded, content can't be decrypted */
+                    if ((p->psz_key_path || p->b_key_loaded) &&
+                        segment->data)
+                    {
+                        block_Release(segment->data);
+                        segment->data = NULL;
+                    }
+                    free(segment->psz_key_path);
+                    segment->psz_key_path = p->psz_key_path ? strdup(p->psz_key_path) : NULL;
                 }
-                free(segment->psz_key_path);
-                segment->psz_key_path = p->psz_key_path ? strdup(p->psz_key_path) : NULL;
-                segment_Free(p);
             }
             vlc_mutex_unlock(&segment->lock);
+            segment_Free(p);
         }
         else
         {
@@ -1378,6 +1533,9 @@ static int hls_UpdatePlaylist(stream_t *s, hls_stream_t *hls_new, hls_stream_t *
         vlc_mutex_unlock(&(*hls)->lock);
     }
 
+    /* segments were either moved or freed */
+    vlc_array_clear(hls_new->segments);
+
     /* update meta information */
     vlc_mutex_lock(&(*hls)->lock);
     (*hls)->sequence = hls_new->sequence;
@@ -1435,6 +1593,8 @@ static int hls_ReloadPlaylist(stream_t *s)
         else if (hls_UpdatePlaylist(s, hls_new, &hls_old) != VLC_SUCCESS)
             msg_Info(s, "failed updating HLS stream (id=%d, bandwidth=%"PRIu64")",
                      hls_new->id, hls_new->bandwidth);
+        else
+            hls_Free(hls_new);
     }
     vlc_array_destroy(hls_streams);
     return VLC_SUCCESS;
@@ -1473,20 +1633,13 @@ static int BandwidthAdaptation(stream_t *s, int progid, uint64_t *bandwidth)
     return candidate;
 }
 
-static int hls_DownloadSegmentData(stream_t *s, hls_stream_t *hls, segment_t *segment, int *cur_stream)
+/* Download and decode a segment, segment->lock must be held */
+static int hls_FetchSegment(stream_t *s, hls_stream_t *hls, segment_t *segment,
+                            mtime_t *duration)
 {
     stream_sys_t *p_sys = s->p_sys;
 
-    assert(hls);
-    assert(segment);
-
-    vlc_mutex_lock(&segment->lock);
-    if (segment->data != NULL)
-    {
-        /* Segment already downloaded */
-        vlc_mutex_unlock(&segment->lock);
-        return VLC_SUCCESS;
-    }
+    assert(segment->data == NULL);
 
     /* sanity check - can we download this segment on time? */
     if ((p_sys->bandwidth > 0) && (hls->bandwidth > 0))
@@ -1500,47 +1653,148 @@ static int hls_DownloadSegmentData(stream_t *s, hls_stream_t *hls, segment_t *se
         }
     }
 
+    /* If the segment is encrypted, it is decoded while downloading */
+    hls_cipher_t cipher, *p_cipher = NULL;
+    if (segment->psz_key_path != NULL)
+    {
+        if (hls_CipherOpen(s, hls, segment, &cipher) != VLC_SUCCESS)
+            return VLC_EGENERIC;
+        p_cipher = &cipher;
+    }
+
     mtime_t start = mdate();
-    if (hls_Download(s, segment) != VLC_SUCCESS)
+    int ret = hls_Download(s, segment, p_cipher);
+    *duration = mdate() - start;
+    if (ret == VLC_SUCCESS)
     {
-        msg_Err(s, "downloaded segment %d from stream %d failed",
-                    segment->sequence, *cur_stream);
-        vlc_mutex_unlock(&segment->lock);
-        return VLC_EGENERIC;
+        if (hls->bandwidth == 0 && segment->duration > 0)
+        {
+            /* Try to estimate the bandwidth for this stream */
+            hls->bandwidth = (uint64_t)(((double)segment->size * 8) / ((double)segment->duration));
+        }
+
+        ret = hls_DecodeSegmentData(s, segment, p_cipher);
+        if (ret != VLC_SUCCESS)
+        {
+            /* Do not let the reader use undecoded data */
+            block_Release(segment->data);
+            segment->data = NULL;
+        }
+    }
+
+    if (p_cipher != NULL)
+        gcry_cipher_close(p_cipher->handle);
+    return ret;
+}
+
+/* Measure bandwidth usage of a downloaded segment and adapt the stream */
+/* Measure bandwidth usage of a downloaded segment and adapt the stream.
+ *
+ * The throughput estimate is the lowest of a fast and a slow moving average
+ * of the measured segments, so that it drops quickly and rises slowly.
+ * The usable part of it depends on how much media is buffered ahead of
+ * playback: with an empty buffer only half of the estimate is used, with a
+ * full window all of it. Switching up additionally requires a margin, a
+ * half-full buffer and a few segments since the previous switch, which
+ * avoids oscillating between two variants on bursty links. */
+static void hls_UpdateBandwidth(stream_t *s, hls_stream_t *hls, segment_t *segment,
+                                mtime_t duration, int *cur_stream)
+{
+    stream_sys_t *p_sys = s->p_sys;
+    struct hls_adaptation_s *adapt = &p_sys->adaptation;
+
+    uint64_t bw = segment->size * 8 * 1000000 / __MAX(1, duration); /* bits / s */
+
+    vlc_mutex_lock(&p_sys->download.lock_wait);
+    if (adapt->samples++ == 0)
+        adapt->fast = adapt->slow = bw;
+    else
+    {
+        adapt->fast = HLS_EWMA_FAST * adapt->fast + (1. - HLS_EWMA_FAST) * bw;
+        adapt->slow = HLS_EWMA_SLOW * adapt->slow + (1. - HLS_EWMA_SLOW) * bw;
+    }
+    uint64_t estimate = __MIN(adapt->fast, adapt->slow);
+    p_sys->bandwidth = estimate;
+    adapt->hold++;
+
+    if (!p_sys->b_meta)
+    {
+        vlc_mutex_unlock(&p_sys->download.lock_wait);
+        return;
+    }
+
+    /* Buffer occupancy in segments */
+    int buffered = p_sys->download.segment - p_sys->playback.segment;
+    buffered = __MAX(0, __MIN(buffered, HLS_WINDOW));
+
+    uint64_t usable = estimate * (HLS_WINDOW + buffered) / (2 * HLS_WINDOW);
+    uint64_t candidate_bw = usable;
+    int newstream = BandwidthAdaptation(s, hls->id, &candidate_bw);
+    const char *psz_reason = "keep";
+
+    if (newstream < 0 || newstream == *cur_stream)
+        newstream = *cur_stream;
+    else if (candidate_bw < hls->bandwidth)
+    {
+        /* Going down: the current variant does not fit anymore */
+        psz_reason = "down";
+        adapt->downs++;
+        adapt->hold = 0;
+    }
+    else if (adapt->hold >= HLS_UP_HOLD && 2 * buffered >= HLS_WINDOW &&
+             candidate_bw <= estimate * HLS_UP_MARGIN)
+    {
+        psz_reason = "up";
+        adapt->ups++;
+        adapt->hold = 0;
+    }
+    else
+    {
+        psz_reason = "hold";
+        adapt->holds++;
+        newstream = *cur_stream;
+    }
+
+    msg_Dbg(s, "adaptation: sample %"PRIu64" estimate %"PRIu64" usable %"PRIu64
+            " buffer %d/%d stream %d -> %d (%s)", bw, estimate, usable,
+            buffered, HLS_WINDOW, *cur_stream, newstream, psz_reason);
+
+    if (newstream != *cur_stream)
+    {
+        msg_Info(s, "detected %s bandwidth (%"PRIu64") stream",
+                 (candidate_bw >= hls->bandwidth) ? "faster" : "lower", estimate);
+        *cur_stream = newstream;
     }
-    mtime_t duration = mdate() - start;
-    if (hls->bandwidth == 0 && segment->duration > 0)
+    vlc_mutex_unlock(&p_sys->download.lock_wait);
+}
+
+static int hls_DownloadSegmentData(stream_t *s, hls_stream_t *hls, segment_t *segment, int *cur_stream)
+{
+    assert(hls);
+    assert(segment);
+
+    vlc_mutex_lock(&segment->lock);
+    if (segment->data != NULL)
     {
-        /* Try to estimate the bandwidth for this stream */
-        hls->bandwidth = (uint64_t)(((double)segment->size * 8) / ((double)segment->duration));
+        /* Segment already downloaded */
+        vlc_mutex_unlock(&segment->lock);
+        return VLC_SUCCESS;
     }
 
-    /* If the segment is encrypted, decode it */
-    if (hls_DecodeSegmentData(s, hls, segment) != VLC_SUCCESS)
+    mtime_t duration;
+    if (hls_FetchSegment(s, hls, segment, &duration) != VLC_SUCCESS)
     {
+        msg_Err(s, "downloaded segment %d from stream %d failed",
+                    segment->sequence, *cur_stream);
         vlc_mutex_unlock(&segment->lock);
         return VLC_EGENERIC;
     }
-
     vlc_mutex_unlock(&segment->lock);
 
     msg_Info(s, "downloaded segment %d from stream %d",
                 segment->sequence, *cur_stream);
 
-    uint64_t bw = segment->size * 8 * 1000000 / __MAX(1, duration); /* bits / s */
-    p_sys->bandwidth = bw;
-    if (p_sys->b_meta && (hls->bandwidth != bw))
-    {
-        int newstream = BandwidthAdaptation(s, hls->id, &bw);
-
-        /* FIXME: we need an average here */
-        if ((newstream >= 0) && (newstream != *cur_stream))
-        {
-            msg_Info(s, "detected %s bandwidth (%"PRIu64") stream",
-                     (bw >= hls->bandwidth) ? "faster" : "lower", bw);
-            *cur_stream = newstream;
-        }
-    }
+    hls_UpdateBandwidth(s, hls, segment, duration, cur_stream);
     return VLC_SUCCESS;
 }
 
@@ -1615,8 +1869,80 @@ static void* hls_Thread(void *p_this)
         else if (p_sys->download.segment < count)
             p_sys->download.segment++;
         vlc_cond_signal(&p_sys->download.wait);
+        vlc_cond_broadcast(&p_sys->prefetch.wait);
+        vlc_mutex_unlock(&p_sys->download.lock_wait);
+    }
+
+    vlc_restorecancel(canc);
+    return NULL;
+}
+
+/* Download the segments following the current download position, so that
+ * hls_Thread finds them ready. The segment being fetched stays locked, which
+ * makes hls_Thread wait for it instead of downloading it twice. */
+static void* hls_PrefetchThread(void *p_this)
+{
+    stream_t *s = (stream_t *)p_this;
+    stream_sys_t *p_sys = s->p_sys;
+
+    int canc = vlc_savecancel();
+
+    vlc_mutex_lock(&p_sys->download.lock_wait);
+    while (!p_sys->prefetch.b_close && vlc_object_alive(s))
+    {
+        int stream = p_sys->download.stream;
+        int next = p_sys->download.segment;
         vlc_mutex_unlock(&p_sys->download.lock_wait);
+
+        /* Pick the first segment ahead that nobody is downloading */
+        segment_t *segment = NULL;
+        hls_stream_t *hls = hls_Get(p_sys->hls_stream, stream);
+        if (hls != NULL)
+        {
+            vlc_mutex_lock(&hls->lock);
+            for (int i = 1; i <= p_sys->prefetch.depth && segment == NULL; i++)
+            {
+                segment_t *candidate = segment_GetSegment(hls, next + i);
+                if (candidate == NULL)
+                    break;
+                if (vlc_mutex_trylock(&candidate->lock) != 0)
+                    continue;
+                if (candidate->data == NULL)
+                    segment = candidate;
+                else
+                    vlc_mutex_unlock(&candidate->lock);
+            }
+            vlc_mutex_unlock(&hls->lock);
+        }
+
+        if (segment != NULL)
+        {
+            mtime_t duration;
+            int ret = hls_FetchSegment(s, hls, segment, &duration);
+            vlc_mutex_unlock(&segment->lock);
+
+            if (ret == VLC_SUCCESS)
+            {
+                msg_Dbg(s, "prefetched segment %d from stream %d",
+                        segment->sequence, stream);
+
+                int newstream = stream;
+                hls_UpdateBandwidth(s, hls, segment, duration, &newstream);
+
+                vlc_mutex_lock(&p_sys->download.lock_wait);
+                if (newstream != stream && p_sys->download.stream == stream)
+                    p_sys->download.stream = newstream;
+                continue;
+            }
+            /* hls_Thread will retry and report the error */
+        }
+
+        vlc_mutex_lock(&p_sys->download.lock_wait);
+        if (!p_sys->prefetch.b_close &&
+            p_sys->download.segment == next && p_sys->download.stream == stream)
+            vlc_cond_wait(&p_sys->prefetch.wait, &p_sys->download.lock_wait);
     }
+    vlc_mutex_unlock(&p_sys->download.lock_wait);
 
     vlc_restorecancel(canc);
     return NULL;
@@ -1664,8 +1990,8 @@ static void* hls_Reload(void *p_this)
 
             /* determine next time to update playlist */
             p_sys->playlist.last = now;
-            p_sys->playlist.wakeup = now + ((mtime_t)(hls->duration * wait)
-                                                   * (mtime_t)1000000);
+            p_sys->playlist.wakeup = now + (mtime_t)(hls->duration * wait
+                                                     * 1000000.);
         }
 
         mwait(p_sys->playlist.wakeup);
@@ -1723,13 +2049,300 @@ static int Prefetch(stream_t *s, int *current)
     return VLC_SUCCESS;
 }
 
+/****************************************************************************
+ * HTTP/1.1 keep-alive connections
+ ****************************************************************************/
+static int hls_PoolGet(stream_t *s, const char *psz_host, int i_port)
+{
+    stream_sys_t *p_sys = s->p_sys;
+    int fd = -1;
+
+    vlc_mutex_lock(&p_sys->pool.lock);
+    for (int i = 0; i < p_sys->pool.count; i++)
+    {
+        hls_conn_t *conn = &p_sys->pool.conns[i];
+        if (conn->i_port == i_port && !strcasecmp(conn->psz_host, psz_host))
+        {
+            fd = conn->fd;
+            free(conn->psz_host);
+            *conn = p_sys->pool.conns[--p_sys->pool.count];
+            break;
+        }
+    }
+    vlc_mutex_unlock(&p_sys->pool.lock);
+    return fd;
+}
+
+static void hls_PoolPut(stream_t *s, const char *psz_host, int i_port, int fd)
+{
+    stream_sys_t *p_sys = s->p_sys;
+    char *psz_dup = strdup(psz_host);
+
+    vlc_mutex_lock(&p_sys->pool.lock);
+    if (psz_dup != NULL && p_sys->pool.count < HLS_POOL_MAX)
+    {
+        hls_conn_t *conn = &p_sys->pool.conns[p_sys->pool.count++];
+        conn->psz_host = psz_dup;
+        conn->i_port = i_port;
+        conn->fd = fd;
+        fd = -1;
+        psz_dup = NULL;
+    }
+    vlc_mutex_unlock(&p_sys->pool.lock);
+
+    free(psz_dup);
+    if (fd != -1)
+        net_Close(fd);
+}
+
+static void hls_PoolClean(stream_t *s)
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    for (int i = 0; i < p_sys->pool.count; i++)
+    {
+        net_Close(p_sys->pool.conns[i].fd);
+        free(p_sys->pool.conns[i].psz_host);
+    }
+    p_sys->pool.count = 0;
+}
+
+/* Append i_size bytes read from fd to *pp_data */
+static int hls_HttpAppend(stream_t *s, int fd, block_t **pp_data, size_t i_size,
+                          bool b_waitall, hls_cipher_t *cipher)
+{
+    block_t *data = *pp_data;
+    size_t i_offset = 0;
+
+    if (data == NULL)
+        data = block_Alloc(i_size);
+    else
+    {
+        i_offset = data->i_buffer;
+        data = block_Realloc(data, 0, i_offset + i_size);
+    }
+    *pp_data = data;
+    if (data == NULL)
+        return VLC_ENOMEM;
+
+    ssize_t i_read = net_Read(s, fd, NULL, data->p_buffer + i_offset, i_size,
+                              b_waitall);
+    if (i_read < 0 || (b_waitall && (size_t)i_read != i_size))
+        return VLC_EGENERIC;
+    data->i_buffer = i_offset + i_read;
+    return hls_CipherUpdate(s, cipher, data->p_buffer, data->i_buffer);
+}
+
+/* Send one GET request on fd and read the whole response body.
+ * *pb_stale is set when nothing at all was received, which is what happens
+ * when the server closed an idle connection. */
+static block_t *hls_HttpRequest(stream_t *s, int fd, const vlc_url_t *url,
+                                hls_cipher_t *cipher, bool *pb_keep, bool *pb_stale)
+{
+    stream_sys_t *p_sys = s->p_sys;
+    block_t *data = NULL;
+
+    *pb_keep = false;
+    *pb_stale = true;
+
+    if (net_Printf(s, fd, NULL, "GET %s HTTP/1.1\r\n"
+                   "Host: %s:%d\r\n"
+                   "User-Agent: %s\r\n"
+                   "Connection: Keep-Alive\r\n\r\n",
+                   url->psz_path ? url->psz_path : "/",
+                   url->psz_host, url->i_port, p_sys->pool.psz_user_agent) < 0)
+        return NULL;
+
+    char *psz = net_Gets(s, fd, NULL);
+    if (psz == NULL)
+        return NULL;
+    *pb_stale = false;
+
+    int i_minor, i_code;
+    if (sscanf(psz, "HTTP/1.%d %3d", &i_minor, &i_code) != 2)
+    {
+        free(psz);
+        return NULL;
+    }
+    free(psz);
+
+    bool b_keep = i_minor >= 1;
+    bool b_chunked = false;
+    int64_t i_length = -1;
+    for (;;)
+    {
+        psz = net_Gets(s, fd, NULL);
+        if (psz == NULL)
+            return NULL;
+        if (*psz == '\0')
+        {
+            free(psz);
+            break;
+        }
+
+        char *p = strchr(psz, ':');
+        if (p != NULL)
+        {
+            *p++ = '\0';
+            p += strspn(p, " \t");
+            if (!strcasecmp(psz, "Content-Length"))
+                i_length = strtoll(p, NULL, 10);
+            else if (!strcasecmp(psz, "Transfer-Encoding"))
+                b_chunked = !strncasecmp(p, "chunked", 7);
+            else if (!strcasecmp(psz, "Connection"))
+            {
+                if (!strncasecmp(p, "close", 5))
+                    b_keep = false;
+                else if (!strncasecmp(p, "keep-alive", 10))
+                    b_keep = true;
+            }
+        }
+        free(psz);
+    }
+
+    /* Let the access module deal with redirections and authentication */
+    if (i_code != 200)
+    {
+        msg_Dbg(s, "HTTP answer %d for %s", i_code, url->psz_path);
+        return NULL;
+    }
+
+    if (b_chunked)
+    {
+        for (;;)
+        {
+            psz = net_Gets(s, fd, NULL);
+            if (psz == NULL)
+                goto error;
+            size_t i_chunk = strtoull(psz, NULL, 16);
+            free(psz);
+
+            if (i_chunk == 0)
+            {
+                /* Skip trailer */
+                while ((psz = net_Gets(s, fd, NULL)) != NULL && *psz != '\0')
+                    free(psz);
+                if (psz == NULL)
+                    goto error;
+                free(psz);
+                break;
+            }
+            if (hls_HttpAppend(s, fd, &data, i_chunk, true, cipher) != VLC_SUCCESS)
+                goto error;
+
+            /* CRLF after chunk data */
+            free(net_Gets(s, fd, NULL));
+        }
+    }
+    else if (i_length > 0)
+    {
+        /* Allocate once, then read by chunks so that decryption
+         * overlaps with the transfer */
+        data = block_Alloc(i_length);
+        if (data == NULL)
+            goto error;
+        size_t i_done = 0;
+        while (i_done < (size_t)i_length)
+        {
+            size_t i_chunk = __MIN((size_t)i_length - i_done, HLS_READ_CHUNK);
+            if (net_Read(s, fd, NULL, data->p_buffer + i_done, i_chunk,
+                         true) != (ssize_t)i_chunk)
+                goto error;
+            i_done += i_chunk;
+            if (hls_CipherUpdate(s, cipher, data->p_buffer, i_done) != VLC_SUCCESS)
+                goto error;
+        }
+    }
+    else if (i_length < 0)
+    {
+        /* Body ends when the server closes the connection */
+        b_keep = false;
+        for (;;)
+        {
+            size_t i_before = data ? data->i_buffer : 0;
+            if (hls_HttpAppend(s, fd, &data, 65536, false, cipher) != VLC_SUCCESS)
+                goto error;
+            if (data->i_buffer == i_before)
+                break;
+        }
+    }
+
+    if (data == NULL || data->i_buffer == 0)
+        goto error;
+
+    *pb_keep = b_keep;
+    return data;
+
+error:
+    if (data != NULL)
+        block_Release(data);
+    return NULL;
+}
+
+/* Download psz_url over a pooled HTTP/1.1 connection.
+ * Returns NULL if this cannot be done; the caller then uses stream_UrlNew(). */
+static block_t *hls_HttpGet(stream_t *s, const char *psz_url, hls_cipher_t *cipher)
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    if (!p_sys->pool.b_enabled || strncasecmp(psz_url, "http://", 7))
+        return NULL;
+
+    vlc_url_t url;
+    vlc_UrlParse(&url, psz_url, 0);
+
+    block_t *data = NULL;
+    if (url.psz_host == NULL || *url.psz_host == '\0' || *url.psz_host == '[' ||
+        url.psz_username != NULL)
+        goto out;
+    if (url.i_port <= 0)
+        url.i_port = 80;
+
+    for (;;)
+    {
+        bool b_reused = true;
+        int fd = hls_PoolGet(s, url.psz_host, url.i_port);
+        if (fd == -1)
+        {
+            b_reused = false;
+            fd = net_ConnectTCP(s, url.psz_host, url.i_port);
+            if (fd == -1)
+                break;
+        }
+
+        bool b_keep, b_stale;
+        data = hls_HttpRequest(s, fd, &url, cipher, &b_keep, &b_stale);
+        if (data != NULL && b_keep)
+            hls_PoolPut(s, url.psz_host, url.i_port, fd);
+        else
+            net_Close(fd);
+
+        /* Retry on a new connection if an idle one was closed by the server */
+        if (data != NULL || !b_reused || !b_stale || !vlc_object_alive(s))
+            break;
+    }
+
+out:
+    vlc_UrlClean(&url);
+    return data;
+}
+
 /****************************************************************************
  *
  ****************************************************************************/
-static int hls_Download(stream_t *s, segment_t *segment)
+static int hls_Download(stream_t *s, segment_t *segment, hls_cipher_t *cipher)
 {
     assert(segment);
 
+    block_t *data = hls_HttpGet(s, segment->url, cipher);
+    if (data != NULL)
+    {
+        segment->data = data;
+        segment->size = data->i_buffer;
+        return VLC_SUCCESS;
+    }
+    hls_CipherReset(cipher);
+
     stream_t *p_ts = stream_UrlNew(s, segment->url);
     if (p_ts == NULL)
         return VLC_EGENERIC;
@@ -1767,10 +2380,18 @@ static int hls_Download(stream_t *s, segment_t *segment)
             assert(segment->data->i_buffer == segment->size);
             p_block = NULL;
         }
-        length = stream_Read(p_ts, segment->data->p_buffer + curlen, segment->size - curlen);
+        length = stream_Read(p_ts, segment->data->p_buffer + curlen,
+                             __MIN(segment->size - curlen, HLS_READ_CHUNK));
         if (length <= 0)
             break;
         curlen += length;
+        if (hls_CipherUpdate(s, cipher, segment->data->p_buffer, curlen) != VLC_SUCCESS)
+        {
+            stream_Delete(p_ts);
+            block_Release(segment->data);
+            segment->data = NULL;
+            return VLC_EGENERIC;
+        }
     } while (vlc_object_alive(s));
 
     stream_Delete(p_ts);
@@ -1924,6 +2545,28 @@ static int Open(vlc_object_t *p_this)
         return VLC_ENOMEM;
     }
 
+    /* Keep-alive connections are only used for direct HTTP connections */
+    p_sys->pool.b_enabled = var_InheritBool(s, "hls-keep-alive");
+    char *psz_proxy = var_InheritString(s, "http-proxy");
+    if ((psz_proxy != NULL && *psz_proxy != '\0') || getenv("http_proxy") != NULL)
+    {
+        msg_Dbg(s, "HTTP proxy in use, not reusing connections");
+        p_sys->pool.b_enabled = false;
+    }
+    free(psz_proxy);
+    p_sys->pool.psz_user_agent = var_InheritString(s, "http-user-agent");
+    if (p_sys->pool.psz_user_agent == NULL)
+        p_sys->pool.psz_user_agent = strdup(PACKAGE_NAME"/"PACKAGE_VERSION);
+    if (p_sys->pool.psz_user_agent == NULL)
+        p_sys->pool.b_enabled = false;
+    vlc_mutex_init(&p_sys->pool.lock);
+
+    p_sys->prefetch.depth = var_InheritInteger(s, "hls-prefetch") - 1;
+    vlc_cond_init(&p_sys->prefetch.wait);
+
+    vlc_mutex_init(&p_sys->download.lock_wait);
+    vlc_cond_init(&p_sys->download.wait);
+
     /* */
     s->pf_read = Read;
     s->pf_peek = Peek;
@@ -1967,9 +2610,6 @@ static int Open(vlc_object_t *p_this)
     p_sys->playback.stream = current;
     p_sys->download.seek = -1;
 
-    vlc_mutex_init(&p_sys->download.lock_wait);
-    vlc_cond_init(&p_sys->download.wait);
-
     /* Initialize HLS live stream */
     if (p_sys->b_live)
     {
@@ -1980,7 +2620,7 @@ static int Open(vlc_object_t *p_this)
 
         if (vlc_clone(&p_sys->reload, hls_Reload, s, VLC_THREAD_PRIORITY_LOW))
         {
-            goto fail_thread;
+            goto fail;
         }
     }
 
@@ -1988,14 +2628,26 @@ static int Open(vlc_object_t *p_this)
     {
         if (p_sys->b_live)
             vlc_join(p_sys->reload, NULL);
-        goto fail_thread;
+        goto fail;
     }
 
-    return VLC_SUCCESS;
+    if (p_sys->prefetch.depth > 0)
+    {
+        p_sys->prefetch.threads = malloc(p_sys->prefetch.depth * sizeof(vlc_thread_t));
+        if (p_sys->prefetch.threads == NULL)
+            p_sys->prefetch.depth = 0;
+    }
+    for (int i = 0; i < p_sys->prefetch.depth; i++)
+    {
+        if (vlc_clone(&p_sys->prefetch.threads[p_sys->prefetch.count],
+                      hls_PrefetchThread, s, VLC_THREAD_PRIORITY_INPUT))
+            break;
+        p_sys->prefetch.count++;
+    }
+    msg_Dbg(s, "downloading up to %d segments in parallel",
+            p_sys->prefetch.count + 1);
 
-fail_thread:
-    vlc_mutex_destroy(&p_sys->download.lock_wait);
-    vlc_cond_destroy(&p_sys->download.wait);
+    return VLC_SUCCESS;
 
 fail:
     /* Free hls streams */
@@ -2006,6 +2658,13 @@ fail:
     }
     vlc_array_destroy(p_sys->hls_stream);
 
+    hls_PoolClean(s);
+    vlc_mutex_destroy(&p_sys->pool.lock);
+    vlc_cond_destroy(&p_sys->prefetch.wait);
+    vlc_mutex_destroy(&p_sys->download.lock_wait);
+    vlc_cond_destroy(&p_sys->download.wait);
+    free(p_sys->pool.psz_user_agent);
+
     /* */
     free(p_sys->m3u8);
     free(p_sys);
@@ -2024,15 +2683,31 @@ static void Close(vlc_object_t *p_this)
 
     /* */
     vlc_mutex_lock(&p_sys->download.lock_wait);
+    p_sys->prefetch.b_close = true;
     vlc_cond_signal(&p_sys->download.wait);
+    vlc_cond_broadcast(&p_sys->prefetch.wait);
     vlc_mutex_unlock(&p_sys->download.lock_wait);
 
     /* */
     if (p_sys->b_live)
         vlc_join(p_sys->reload, NULL);
     vlc_join(p_sys->thread, NULL);
+    for (int i = 0; i < p_sys->prefetch.count; i++)
+        vlc_join(p_sys->prefetch.threads[i], NULL);
+    free(p_sys->prefetch.threads);
+
+    if (p_sys->b_meta)
+        msg_Dbg(s, "adaptation: %d segments measured, %u up, %u down, "
+                "%u held switches", p_sys->adaptation.samples,
+                p_sys->adaptation.ups, p_sys->adaptation.downs,
+                p_sys->adaptation.holds);
     vlc_mutex_destroy(&p_sys->download.lock_wait);
     vlc_cond_destroy(&p_sys->download.wait);
+    vlc_cond_destroy(&p_sys->prefetch.wait);
+
+    hls_PoolClean(s);
+    vlc_mutex_destroy(&p_sys->pool.lock);
+    free(p_sys->pool.psz_user_agent);
 
     /* Free hls streams */
     for (int i = 0; i < vlc_array_count(p_sys->hls_stream); i++)
@@ -36,6 +36,12 @@
 #include <vlc_input.h>
 #include <vlc_fs.h>
 
+#include <fcntl.h>
+#ifdef HAVE_UNISTD_H
+#   include <unistd.h>
+#endif
+
+#include "../access_output/writer.h"
 
 /*****************************************************************************
  * Module descriptor
@@ -48,6 +54,10 @@ vlc_module_begin()
     set_subcategory( SUBCAT_INPUT_STREAM_FILTER )
     set_description( N_("Internal stream record") )
     set_capability( "stream_filter", 0 )
+    add_bool( "record-async", false, WRITER_ASYNC_TEXT,
+              WRITER_ASYNC_LONGTEXT, true )
+    add_bool( "record-direct", false, WRITER_DIRECT_TEXT,
+              WRITER_DIRECT_LONGTEXT, true )
     set_callbacks( Open, Close )
 vlc_module_end()
 
@@ -57,15 +67,24 @@ vlc_module_end()
 struct stream_sys_t
 {
     FILE *f;        /* TODO it could be replaced by access_output_t one day */
+    int fd;
+    file_writer_t *p_writer;    /* used instead of f when writing from a thread */
     bool b_error;
 };
 
+static inline bool IsRecording( const stream_sys_t *p_sys )
+{
+    return p_sys->f != NULL || p_sys->p_writer != NULL;
+}
+
 
 /****************************************************************************
  * Local prototypes
  ****************************************************************************/
 static int  Read   ( stream_t *, void *p_read, unsigned int i_read );
 static int  Peek   ( stream_t *, const uint8_t **pp_peek, unsigned int i_peek );
+static int  PeekV  ( stream_t *, struct iovec *, unsigned *, unsigned int i_peek );
+static block_t *Block( stream_t *, unsigned int i_size );
 static int  Control( stream_t *, int i_query, va_list );
 
 static int  Start  ( stream_t *, const char *psz_extension );
@@ -86,10 +105,13 @@ static int Open ( vlc_object_t *p_this )
         return VLC_ENOMEM;
 
     p_sys->f = NULL;
+    p_sys->p_writer = NULL;
 
     /* */
     s->pf_read = Read;
     s->pf_peek = Peek;
+    s->pf_peekv = PeekV;
+    s->pf_block = Block;
     s->pf_control = Control;
 
     return VLC_SUCCESS;
@@ -103,7 +125,7 @@ static void Close( vlc_object_t *p_this )
     stream_t *s = (stream_t*)p_this;
     stream_sys_t *p_sys = s->p_sys;
 
-    if( p_sys->f )
+    if( IsRecording( p_sys ) )
         Stop( s );
 
     free( p_sys );
@@ -118,14 +140,14 @@ static int Read( stream_t *s, void *p_read, unsigned int i_read )
     void *p_record = p_read;
 
     /* Allocate a temporary buffer for record when no p_read */
-    if( p_sys->f && !p_record )
+    if( IsRecording( p_sys ) && !p_record )
         p_record = malloc( i_read );
 
     /* */
     const int i_record = stream_Read( s->p_source, p_record, i_read );
 
     /* Dump read data */
-    if( p_sys->f )
+    if( IsRecording( p_sys ) )
     {
         if( p_record && i_record > 0 )
             Write( s, p_record, i_record );
@@ -141,6 +163,24 @@ static int Peek( stream_t *s, const uint8_t **pp_peek, unsigned int i_peek )
     return stream_Peek( s->p_source, pp_peek, i_peek );
 }
 
+static int PeekV( stream_t *s, struct iovec *iov, unsigned *pi_iov,
+                  unsigned int i_peek )
+{
+    return stream_PeekV( s->p_source, iov, pi_iov, i_peek );
+}
+
+static block_t *Block( stream_t *s, unsigned int i_size )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    block_t *p_block = stream_Block( s->p_source, i_size );
+
+    /* Dump read data */
+    if( IsRecording( p_sys ) && p_block )
+        Write( s, p_block->p_buffer, p_block->i_buffer );
+
+    return p_block;
+}
+
 static int Control( stream_t *s, int i_query, va_list args )
 {
     if( i_query != STREAM_SET_RECORD_STATE )
@@ -151,7 +191,7 @@ static int Control( stream_t *s, int i_query, va_list args )
     if( b_active )
         psz_extension = (const char*)va_arg( args, const char* );
 
-    if( !s->p_sys->f == !b_active )
+    if( IsRecording( s->p_sys ) == b_active )
         return VLC_SUCCESS;
 
     if( b_active )
@@ -168,7 +208,8 @@ static int Start( stream_t *s, const char *psz_extension )
     stream_sys_t *p_sys = s->p_sys;
 
     char *psz_file;
-    FILE *f;
+    FILE *f = NULL;
+    file_writer_t *p_writer = NULL;
 
     /* */
     if( !psz_extension )
@@ -191,8 +232,23 @@ static int Start( stream_t *s, const char *psz_extension )
     if( !psz_file )
         return VLC_ENOMEM;
 
-    f = vlc_fopen( psz_file, "wb" );
-    if( !f )
+    if( var_InheritBool( s, "record-async" ) )
+    {
+        int fd = vlc_open( psz_file, O_WRONLY | O_CREAT | O_TRUNC, 0666 );
+        if( fd != -1 )
+        {
+            p_writer = file_writer_New( s, fd,
+                                        var_InheritBool( s, "record-direct" ) );
+            if( !p_writer )
+                close( fd );
+            else
+                p_sys->fd = fd;
+        }
+    }
+    else
+        f = vlc_fopen( psz_file, "wb" );
+
+    if( !f && !p_writer )
     {
         free( psz_file );
         return VLC_EGENERIC;
@@ -206,6 +262,7 @@ static int Start( stream_t *s, const char *psz_extension )
 
     /* */
     p_sys->f = f;
+    p_sys->p_writer = p_writer;
     p_sys->b_error = false;
     return VLC_SUCCESS;
 }
@@ -213,11 +270,20 @@ static int Stop( stream_t *s )
 {
     stream_sys_t *p_sys = s->p_sys;
 
-    assert( p_sys->f );
+    assert( IsRecording( p_sys ) );
 
     msg_Dbg( s, "Recording completed" );
-    fclose( p_sys->f );
-    p_sys->f = NULL;
+    if( p_sys->p_writer )
+    {
+        file_writer_Delete( p_sys->p_writer );
+        close( p_sys->fd );
+        p_sys->p_writer = NULL;
+    }
+    else
+    {
+        fclose( p_sys->f );
+        p_sys->f = NULL;
+    }
     return VLC_SUCCESS;
 }
 
@@ -225,14 +291,17 @@ static void Write( stream_t *s, const uint8_t *p_buffer, size_t i_buffer )
 {
     stream_sys_t *p_sys = s->p_sys;
 
-    assert( p_sys->f );
+    assert( IsRecording( p_sys ) );
 
     if( i_buffer > 0 )
     {
         const bool b_previous_error = p_sys->b_error;
-        const size_t i_written = fwrite( p_buffer, 1, i_buffer, p_sys->f );
 
-        p_sys->b_error = i_written != i_buffer;
+        if( p_sys->p_writer )
+            p_sys->b_error = file_writer_Write( p_sys->p_writer,
+                                                p_buffer, i_buffer ) != VLC_SUCCESS;
+        else
+            p_sys->b_error = fwrite( p_buffer, 1, i_buffer, p_sys->f ) != i_buffer;
 
         /* TODO maybe a intf_UserError or something like that ? */
         if( p_sys->b_error && !b_previous_error )
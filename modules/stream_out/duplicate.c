@@ -40,8 +40,16 @@
 static int      Open    ( vlc_object_t * );
 static void     Close   ( vlc_object_t * );
 
+#define HELP_TEXT N_( \
+    "Send the elementary streams to several stream output chains. Each " \
+    "dst can be limited with a select option, which makes it possible to " \
+    "split a multi-program transport stream with a single input, e.g. " \
+    "--programs=1,2 --sout '#duplicate{dst=std{...},select=\"program=1\"," \
+    "dst=std{...},select=\"program=2\"}'.")
+
 vlc_module_begin ()
     set_description( N_("Duplicate stream output") )
+    set_help( HELP_TEXT )
     set_capability( "sout stream", 50 )
     add_shortcut( "duplicate", "dup" )
     set_category( CAT_SOUT )
@@ -266,7 +274,19 @@ static int Send( sout_stream_t *p_stream, sout_stream_id_t *id,
 {
     sout_stream_sys_t *p_sys = p_stream->p_sys;
     sout_stream_t     *p_dup_stream;
-    int               i_stream;
+    int               i_stream, i_last;
+
+    /* The last output using this ES gets the original buffers, so that an
+     * ES sent to a single output (like a program split) is never copied */
+    for( i_last = p_sys->i_nb_streams - 1; i_last >= 0; i_last-- )
+        if( id->pp_ids[i_last] )
+            break;
+
+    if( i_last < 0 )
+    {
+        block_ChainRelease( p_buffer );
+        return VLC_SUCCESS;
+    }
 
     /* Loop through the linked list of buffers */
     while( p_buffer )
@@ -275,7 +295,7 @@ static int Send( sout_stream_t *p_stream, sout_stream_id_t *id,
 
         p_buffer->p_next = NULL;
 
-        for( i_stream = 0; i_stream < p_sys->i_nb_streams - 1; i_stream++ )
+        for( i_stream = 0; i_stream < i_last; i_stream++ )
         {
             p_dup_stream = p_sys->pp_streams[i_stream];
 
@@ -288,15 +308,8 @@ static int Send( sout_stream_t *p_stream, sout_stream_id_t *id,
             }
         }
 
-        if( i_stream < p_sys->i_nb_streams && id->pp_ids[i_stream] )
-        {
-            p_dup_stream = p_sys->pp_streams[i_stream];
-            sout_StreamIdSend( p_dup_stream, id->pp_ids[i_stream], p_buffer );
-        }
-        else
-        {
-            block_Release( p_buffer );
-        }
+        p_dup_stream = p_sys->pp_streams[i_last];
+        sout_StreamIdSend( p_dup_stream, id->pp_ids[i_last], p_buffer );
 
         p_buffer = p_next;
     }
@@ -52,6 +52,7 @@ struct sout_stream_sys_t
 
     decoder_t       *p_decoder;
     image_handler_t *p_image; /* filter for resizing */
+    image_handler_t *p_cell_image; /* filter for resizing to the mosaic */
     int i_height, i_width;
     unsigned int i_sar_num, i_sar_den;
     char *psz_id;
@@ -357,6 +358,8 @@ static sout_stream_id_t * Add( sout_stream_t *p_stream, es_format_t *p_fmt )
 
         p_bridge->i_es_num = 0;
         p_bridge->pp_es = NULL;
+        p_bridge->i_cell_width = p_bridge->i_cell_height = 0;
+        p_bridge->b_cell_ar = false;
     }
 
     for ( i = 0; i < p_bridge->i_es_num; i++ )
@@ -395,6 +398,7 @@ static sout_stream_id_t * Add( sout_stream_t *p_stream, es_format_t *p_fmt )
     {
         p_sys->p_image = NULL;
     }
+    p_sys->p_cell_image = NULL;
 
     msg_Dbg( p_stream, "mosaic bridge id=%s pos=%d", p_es->psz_id, i );
 
@@ -490,6 +494,10 @@ static int Del( sout_stream_t *p_stream, sout_stream_id_t *id )
     {
         image_HandlerDelete( p_sys->p_image );
     }
+    if ( p_sys->p_cell_image )
+    {
+        image_HandlerDelete( p_sys->p_cell_image );
+    }
 
     p_sys->b_inited = false;
 
@@ -513,6 +521,60 @@ static void PushPicture( sout_stream_t *p_stream, picture_t *p_picture )
     vlc_global_unlock( VLC_MOSAIC_MUTEX );
 }
 
+/*****************************************************************************
+ * ScaleToCell : scale a picture to the mosaic cells on the input thread
+ *****************************************************************************
+ * Otherwise the mosaic filter would scale the pictures of every input itself,
+ * on the thread of the video output.
+ *****************************************************************************/
+static picture_t *ScaleToCell( sout_stream_t *p_stream, picture_t *p_picture )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    unsigned i_width = 0, i_height = 0;
+    bool b_ar = false;
+
+    vlc_global_lock( VLC_MOSAIC_MUTEX );
+    bridge_t *p_bridge = GetBridge( p_stream );
+    if ( p_bridge != NULL )
+    {
+        i_width = p_bridge->i_cell_width;
+        i_height = p_bridge->i_cell_height;
+        b_ar = p_bridge->b_cell_ar;
+    }
+    vlc_global_unlock( VLC_MOSAIC_MUTEX );
+
+    if ( i_width == 0 || i_height == 0 )
+        return p_picture;
+
+    video_format_t fmt_in, fmt_out;
+
+    memset( &fmt_in, 0, sizeof(video_format_t) );
+    fmt_in.i_chroma = p_picture->format.i_chroma;
+    fmt_in.i_width = p_picture->format.i_width;
+    fmt_in.i_height = p_picture->format.i_height;
+
+    mosaic_GetCellFormat( &fmt_out, &fmt_in, i_width, i_height, b_ar );
+    if ( mosaic_IsCellPicture( p_picture, &fmt_out ) )
+        return p_picture;
+
+    if ( !p_sys->p_cell_image )
+        p_sys->p_cell_image = image_HandlerCreate( p_stream );
+    if ( !p_sys->p_cell_image )
+        return p_picture;
+
+    picture_t *p_cell_pic = image_Convert( p_sys->p_cell_image, p_picture,
+                                           &fmt_in, &fmt_out );
+    if ( p_cell_pic == NULL )
+    {
+        /* The mosaic will try again */
+        msg_Warn( p_stream, "image resizing to the mosaic failed" );
+        return p_picture;
+    }
+    p_cell_pic->date = p_picture->date;
+    picture_Release( p_picture );
+    return p_cell_pic;
+}
+
 static int Send( sout_stream_t *p_stream, sout_stream_id_t *id,
                  block_t *p_buffer )
 {
@@ -600,8 +662,10 @@ static int Send( sout_stream_t *p_stream, sout_stream_id_t *id,
 
         if( p_sys->p_vf2 )
             p_new_pic = filter_chain_VideoFilter( p_sys->p_vf2, p_new_pic );
+        if( p_new_pic == NULL )
+            continue;
 
-        PushPicture( p_stream, p_new_pic );
+        PushPicture( p_stream, ScaleToCell( p_stream, p_new_pic ) );
     }
 
     return VLC_SUCCESS;
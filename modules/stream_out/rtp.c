@@ -1187,7 +1187,8 @@ static sout_stream_id_t *Add( sout_stream_t *p_stream, es_format_t *p_fmt )
         id->rtsp_id = RtspAddId( p_sys->rtsp, id, GetDWBE( id->ssrc ),
                                  id->rtp_fmt.clock_rate, mcast_fd );
 
-    id->p_fifo = block_FifoNew();
+    /* Only fed by rtp_packetize_send() and drained by ThreadSend() */
+    id->p_fifo = block_FifoNewSPSC();
     if( unlikely(id->p_fifo == NULL) )
         goto error;
     if( vlc_clone( &id->thread, ThreadSend, id, VLC_THREAD_PRIORITY_HIGHEST ) )
@@ -1401,8 +1402,6 @@ static int  HttpCallback( httpd_file_sys_t *p_args,
 /****************************************************************************
  * RTP send
  ****************************************************************************/
-static void* ThreadSend( void *data )
-{
 #ifdef WIN32
 # define ECONNREFUSED WSAECONNREFUSED
 # define ENOPROTOOPT  WSAENOPROTOOPT
@@ -1413,6 +1412,120 @@ static void* ThreadSend( void *data )
 # define EAGAIN       WSAEWOULDBLOCK
 # define EWOULDBLOCK  WSAEWOULDBLOCK
 #endif
+
+/* Packets due within this delay of each other are sent together */
+#define RTP_BATCH_DELAY (CLOCK_FREQ / 1000)
+#define RTP_BATCH_MAX   64
+
+#ifdef HAVE_SRTP
+/* Protects a batch of packets in place, and drops those which fail.
+ * Returns the number of packets left. */
+static unsigned rtp_protect( sout_stream_id_t *id, block_t **batch,
+                             unsigned count )
+{
+    if( !id->srtp )
+        return count;
+
+    uint8_t *bufv[count];
+    size_t lenv[count], sizev[count];
+    int errv[count];
+    unsigned n = 0;
+
+    for( unsigned i = 0; i < count; i++ )
+    {
+        /* FIXME: this is awfully inefficient */
+        size_t len = batch[i]->i_buffer;
+        block_t *out = block_Realloc( batch[i], 0, len + 10 );
+        if( out == NULL )
+            continue;
+        out->i_buffer = len;
+
+        batch[n] = out;
+        bufv[n] = out->p_buffer;
+        lenv[n] = len;
+        sizev[n] = len + 10;
+        n++;
+    }
+    if( n == 0 )
+        return 0;
+
+    srtp_send_batch( id->srtp, n, bufv, lenv, sizev, errv );
+
+    count = n;
+    n = 0;
+    for( unsigned i = 0; i < count; i++ )
+    {
+        if( errv[i] )
+        {
+            errno = errv[i];
+            msg_Dbg( id->p_stream, "SRTP sending error: %m" );
+            block_Release( batch[i] );
+            continue;
+        }
+        batch[i]->i_buffer = lenv[i];
+        batch[n++] = batch[i];
+    }
+    return n;
+}
+#else
+# define rtp_protect( id, batch, count ) (count)
+#endif
+
+/* Sends a batch of packets to one sink.
+ * Returns false if the connection is broken. */
+static bool rtp_send_batch( int fd, block_t *const *batch, unsigned count )
+{
+#ifdef HAVE_SENDMMSG
+    struct mmsghdr msgv[count];
+    struct iovec iov[count];
+
+    memset( msgv, 0, sizeof( msgv ) );
+    for( unsigned i = 0; i < count; i++ )
+    {
+        iov[i].iov_base = batch[i]->p_buffer;
+        iov[i].iov_len = batch[i]->i_buffer;
+        msgv[i].msg_hdr.msg_iov = &iov[i];
+        msgv[i].msg_hdr.msg_iovlen = 1;
+    }
+#endif
+
+    for( unsigned i = 0; i < count; )
+    {
+#ifdef HAVE_SENDMMSG
+        int val = sendmmsg( fd, msgv + i, count - i, 0 );
+        if( val > 0 )
+        {
+            i += val;
+            continue;
+        }
+#else
+        if( send( fd, batch[i]->p_buffer, batch[i]->i_buffer, 0 ) != -1 )
+        {
+            i++;
+            continue;
+        }
+#endif
+        /* Packet i could not be sent */
+        if( net_errno != EAGAIN && net_errno != EWOULDBLOCK
+         && net_errno != ENOBUFS && net_errno != ENOMEM )
+        {
+            int type;
+            getsockopt( fd, SOL_SOCKET, SO_TYPE,
+                        &type, &(socklen_t){ sizeof(type) });
+            if( type == SOCK_DGRAM )
+                /* ICMP soft error: ignore and retry */
+                send( fd, batch[i]->p_buffer, batch[i]->i_buffer, 0 );
+            else
+                /* Broken connection */
+                return false;
+        }
+        i++;
+    }
+    return true;
+}
+
+static void* ThreadSend( void *data )
+{
     sout_stream_id_t *id = data;
     unsigned i_caching = id->i_caching;
 
@@ -1420,40 +1533,32 @@ static void* ThreadSend( void *data )
     {
         block_t *out = block_FifoGet( id->p_fifo );
         block_cleanup_push (out);
-
-#ifdef HAVE_SRTP
-        if( id->srtp )
-        {   /* FIXME: this is awfully inefficient */
-            size_t len = out->i_buffer;
-            out = block_Realloc( out, 0, len + 10 );
-            out->i_buffer = len;
-
-            int canc = vlc_savecancel ();
-            int val = srtp_send( id->srtp, out->p_buffer, &len, len + 10 );
-            vlc_restorecancel (canc);
-            if( val )
-            {
-                errno = val;
-                msg_Dbg( id->p_stream, "SRTP sending error: %m" );
-                block_Release( out );
-                out = NULL;
-            }
-            else
-                out->i_buffer = len;
-        }
-        if (out)
-            mwait (out->i_dts + i_caching);
-        vlc_cleanup_pop ();
-        if (out == NULL)
-            continue;
-#else
         mwait (out->i_dts + i_caching);
         vlc_cleanup_pop ();
-#endif
 
-        ssize_t len = out->i_buffer;
         int canc = vlc_savecancel ();
 
+        /* Take the packets which are due in the same slot too, so that each
+         * sink gets them with a single system call */
+        block_t *batch[RTP_BATCH_MAX];
+        unsigned count = 0;
+        mtime_t deadline = mdate() + RTP_BATCH_DELAY;
+
+        batch[count++] = out;
+        while( count < RTP_BATCH_MAX && block_FifoCount( id->p_fifo ) > 0 )
+        {
+            if( block_FifoShow( id->p_fifo )->i_dts + i_caching > deadline )
+                break;
+            batch[count++] = block_FifoGet( id->p_fifo );
+        }
+
+        count = rtp_protect( id, batch, count );
+        if( count == 0 )
+        {
+            vlc_restorecancel (canc);
+            continue;
+        }
+
         vlc_mutex_lock( &id->lock_sink );
         unsigned deadc = 0; /* How many dead sockets? */
         int deadv[id->sinkc]; /* Dead sockets list */
@@ -1463,26 +1568,18 @@ static void* ThreadSend( void *data )
 #ifdef HAVE_SRTP
             if( !id->srtp ) /* FIXME: SRTCP support */
 #endif
-                SendRTCP( id->sinkv[i].rtcp, out );
+                for( unsigned j = 0; j < count; j++ )
+                    SendRTCP( id->sinkv[i].rtcp, batch[j] );
 
-            if( send( id->sinkv[i].rtp_fd, out->p_buffer, len, 0 ) == -1
-             && net_errno != EAGAIN && net_errno != EWOULDBLOCK
-             && net_errno != ENOBUFS && net_errno != ENOMEM )
-            {
-                int type;
-                getsockopt( id->sinkv[i].rtp_fd, SOL_SOCKET, SO_TYPE,
-                            &type, &(socklen_t){ sizeof(type) });
-                if( type == SOCK_DGRAM )
-                    /* ICMP soft error: ignore and retry */
-                    send( id->sinkv[i].rtp_fd, out->p_buffer, len, 0 );
-                else
-                    /* Broken connection */
-                    deadv[deadc++] = id->sinkv[i].rtp_fd;
-            }
+            if( !rtp_send_batch( id->sinkv[i].rtp_fd, batch, count ) )
+                deadv[deadc++] = id->sinkv[i].rtp_fd;
         }
-        id->i_seq_sent_next = ntohs(((uint16_t *) out->p_buffer)[1]) + 1;
+        id->i_seq_sent_next =
+            ntohs(((uint16_t *) batch[count - 1]->p_buffer)[1]) + 1;
         vlc_mutex_unlock( &id->lock_sink );
-        block_Release( out );
+
+        for( unsigned j = 0; j < count; j++ )
+            block_Release( batch[j] );
 
         for( unsigned i = 0; i < deadc; i++ )
         {
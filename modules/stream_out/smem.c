@@ -35,6 +35,9 @@
  * Into each lock function (audio and video), you will have all the information
  * you need to allocate a buffer, so that this module will copy data in it.
  *
+ * Without a prerender callback, no copy is made: the postrender callback gets
+ * the buffer of VLC itself, which is only valid until the callback returns.
+ *
  * the video-data and audio-data pointers will be passed to lock/unlock function
  *
  ******************************************************************************/
@@ -59,11 +62,13 @@
 
 #define T_VIDEO_PRERENDER_CALLBACK N_( "Video prerender callback" )
 #define LT_VIDEO_PRERENDER_CALLBACK N_( "Address of the video prerender callback function. " \
-                                "This function will set the buffer where render will be done." )
+                                "This function will set the buffer where render will be done. " \
+                                "Without it, the postrender callback gets the buffers of VLC." )
 
 #define T_AUDIO_PRERENDER_CALLBACK N_( "Audio prerender callback" )
 #define LT_AUDIO_PRERENDER_CALLBACK N_( "Address of the audio prerender callback function. " \
-                                        "This function will set the buffer where render will be done." )
+                                        "This function will set the buffer where render will be done. " \
+                                        "Without it, the postrender callback gets the buffers of VLC." )
 
 #define T_VIDEO_POSTRENDER_CALLBACK N_( "Video postrender callback" )
 #define LT_VIDEO_POSTRENDER_CALLBACK N_( "Address of the video postrender callback function. " \
@@ -355,6 +360,23 @@ static int SendVideo( sout_stream_t *p_stream, sout_stream_id_t *id,
     {
         i_size = p_buffer->i_buffer;
     }
+
+    /* Lending our buffer for the duration of the postrender callback */
+    if( p_sys->pf_video_prerender_callback == NULL )
+    {
+        if( (size_t)i_size > p_buffer->i_buffer )
+        {
+            msg_Err( p_stream, "Incomplete picture (%zu bytes)", p_buffer->i_buffer );
+            block_ChainRelease( p_buffer );
+            return VLC_EGENERIC;
+        }
+        p_sys->pf_video_postrender_callback( id->p_data, p_buffer->p_buffer,
+                                             id->format->video.i_width, id->format->video.i_height,
+                                             id->format->video.i_bits_per_pixel, i_size, p_buffer->i_pts );
+        block_ChainRelease( p_buffer );
+        return VLC_SUCCESS;
+    }
+
     /* Calling the prerender callback to get user buffer */
     p_sys->pf_video_prerender_callback( id->p_data, &p_pixels , i_size );
 
@@ -400,6 +422,17 @@ static int SendAudio( sout_stream_t *p_stream, sout_stream_id_t *id,
     }
 
     i_samples = i_size / ( ( id->format->audio.i_bitspersample / 8 ) * id->format->audio.i_channels );
+
+    /* Lending our buffer for the duration of the postrender callback */
+    if( p_sys->pf_audio_prerender_callback == NULL )
+    {
+        p_sys->pf_audio_postrender_callback( id->p_data, p_buffer->p_buffer,
+                                             id->format->audio.i_channels, id->format->audio.i_rate, i_samples,
+                                             id->format->audio.i_bitspersample, i_size, p_buffer->i_pts );
+        block_ChainRelease( p_buffer );
+        return VLC_SUCCESS;
+    }
+
     /* Calling the prerender callback to get user buffer */
     p_sys->pf_audio_prerender_callback( id->p_data, &p_pcm_buffer, i_size );
     if (!p_pcm_buffer)
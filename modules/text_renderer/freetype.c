@@ -299,6 +299,48 @@ struct font_stack_t
     font_stack_t  *p_next;
 };
 
+/* Glyph last rendered at a pen position within one pixel, from a face at a
+ * size; it is copied and moved to the actual pen position */
+#define GLYPH_CACHE_SIZE 256
+typedef struct
+{
+    uint32_t       i_face;              /* hash of the face, 0 if unused */
+    int            i_size;
+    int            i_glyph_index;
+    int            i_style_flags;
+    FT_Vector      pen;
+    FT_Vector      pen_shadow;
+
+    FT_Glyph       p_glyph;
+    FT_BBox        glyph_bbox;
+    FT_Glyph       p_outline;
+    FT_BBox        outline_bbox;
+    FT_Glyph       p_shadow;
+    FT_BBox        shadow_bbox;
+    FT_Vector      advance;
+
+    uint64_t       i_used;
+} glyph_cache_t;
+
+/* Region last rendered from a text, given again when the same text is
+ * rendered with the same style (clock, marquee, repeated titles) */
+#define REGION_CACHE_SIZE 8
+typedef struct
+{
+    char           *psz_text;           /* text or html, NULL if unused */
+    bool           b_html;
+    text_style_t   *p_style;
+    int            i_font_size;
+    int            i_align;
+    unsigned       i_width;
+
+    video_format_t fmt;
+    video_palette_t palette;
+    picture_t      *p_picture;
+
+    uint64_t       i_used;
+} region_cache_t;
+
 /*****************************************************************************
  * filter_sys_t: freetype local data
  *****************************************************************************
@@ -339,6 +381,10 @@ struct filter_sys_t
 
     input_attachment_t **pp_font_attachments;
     int                  i_font_attachments;
+
+    glyph_cache_t  *p_glyph_cache;
+    region_cache_t p_region_cache[REGION_CACHE_SIZE];
+    uint64_t       i_cache_date;
 };
 
 /* */
@@ -1883,16 +1929,17 @@ static bool FaceStyleEquals( const text_style_t *p_style1,
            !strcmp( p_style1->psz_fontname, p_style2->psz_fontname );
 }
 
-static int GetGlyph( filter_t *p_filter,
-                     FT_Glyph *pp_glyph,   FT_BBox *p_glyph_bbox,
-                     FT_Glyph *pp_outline, FT_BBox *p_outline_bbox,
-                     FT_Glyph *pp_shadow,  FT_BBox *p_shadow_bbox,
-
-                     FT_Face  p_face,
-                     int i_glyph_index,
-                     int i_style_flags,
-                     FT_Vector *p_pen,
-                     FT_Vector *p_pen_shadow )
+static int RenderGlyph( filter_t *p_filter,
+                        FT_Glyph *pp_glyph,   FT_BBox *p_glyph_bbox,
+                        FT_Glyph *pp_outline, FT_BBox *p_outline_bbox,
+                        FT_Glyph *pp_shadow,  FT_BBox *p_shadow_bbox,
+                        FT_Vector *p_advance,
+
+                        FT_Face  p_face,
+                        int i_glyph_index,
+                        int i_style_flags,
+                        FT_Vector *p_pen,
+                        FT_Vector *p_pen_shadow )
 {
     if( FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT ) &&
         FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT ) )
@@ -1900,6 +1947,7 @@ static int GetGlyph( filter_t *p_filter,
         msg_Err( p_filter, "unable to render text FT_Load_Glyph failed" );
         return VLC_EGENERIC;
     }
+    *p_advance = p_face->glyph->advance;
 
     /* Do synthetic styling now that Freetype supports it;
      * ie. if the font we have loaded is NOT already in the
@@ -1962,19 +2010,156 @@ static int GetGlyph( filter_t *p_filter,
     return VLC_SUCCESS;
 }
 
-static void FixGlyph( FT_Glyph glyph, FT_BBox *p_bbox, FT_Face face, const FT_Vector *p_pen )
+static uint32_t GetFaceHash( FT_Face p_face )
+{
+    const char *ppsz_name[] = { p_face->family_name, p_face->style_name };
+    uint32_t i_hash = 2166136261u;
+
+    for( unsigned i = 0; i < sizeof(ppsz_name) / sizeof(*ppsz_name); i++ )
+    {
+        for( const char *psz = ppsz_name[i]; psz && *psz; psz++ )
+            i_hash = ( i_hash ^ (uint8_t)*psz ) * 16777619u;
+        i_hash = ( i_hash ^ '/' ) * 16777619u;
+    }
+    i_hash = ( i_hash ^ (uint32_t)p_face->num_glyphs ) * 16777619u;
+    return i_hash ? i_hash : 1;
+}
+
+static void CleanGlyphCache( glyph_cache_t *p_entry )
+{
+    if( p_entry->i_face == 0 )
+        return;
+    FT_Done_Glyph( p_entry->p_glyph );
+    if( p_entry->p_outline )
+        FT_Done_Glyph( p_entry->p_outline );
+    if( p_entry->p_shadow )
+        FT_Done_Glyph( p_entry->p_shadow );
+    p_entry->i_face = 0;
+}
+
+/* Copies a cached bitmap glyph i_x, i_y pixels further */
+static int MoveGlyph( FT_Glyph *pp_glyph, FT_BBox *p_bbox,
+                      FT_Glyph glyph, const FT_BBox *p_glyph_bbox,
+                      FT_Pos i_x, FT_Pos i_y )
+{
+    if( FT_Glyph_Copy( glyph, pp_glyph ) )
+        return VLC_EGENERIC;
+
+    FT_BitmapGlyph glyph_bmp = (FT_BitmapGlyph)*pp_glyph;
+    glyph_bmp->left += i_x;
+    glyph_bmp->top  += i_y;
+    p_bbox->xMin = p_glyph_bbox->xMin + i_x;
+    p_bbox->xMax = p_glyph_bbox->xMax + i_x;
+    p_bbox->yMin = p_glyph_bbox->yMin + i_y;
+    p_bbox->yMax = p_glyph_bbox->yMax + i_y;
+    return VLC_SUCCESS;
+}
+
+/* Same as RenderGlyph(), but from the cache of the last glyphs when
+ * possible */
+static int GetGlyph( filter_t *p_filter,
+                     FT_Glyph *pp_glyph,   FT_BBox *p_glyph_bbox,
+                     FT_Glyph *pp_outline, FT_BBox *p_outline_bbox,
+                     FT_Glyph *pp_shadow,  FT_BBox *p_shadow_bbox,
+                     FT_Vector *p_advance,
+
+                     FT_Face  p_face,
+                     int i_glyph_index,
+                     int i_style_flags,
+                     FT_Vector *p_pen,
+                     FT_Vector *p_pen_shadow )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( !p_sys->p_glyph_cache )
+        return RenderGlyph( p_filter, pp_glyph, p_glyph_bbox,
+                            pp_outline, p_outline_bbox,
+                            pp_shadow, p_shadow_bbox, p_advance,
+                            p_face, i_glyph_index, i_style_flags,
+                            p_pen, p_pen_shadow );
+
+    /* The glyphs are rendered at the pen position within the pixel */
+    FT_Vector pen        = { .x = p_pen->x & 63, .y = p_pen->y & 63 };
+    FT_Vector pen_shadow = { .x = p_pen_shadow->x & 63, .y = p_pen_shadow->y & 63 };
+    const uint32_t i_face = GetFaceHash( p_face );
+    const int i_size = p_face->size->metrics.y_ppem;
+
+    glyph_cache_t *p_entry = NULL;
+    glyph_cache_t *p_oldest = &p_sys->p_glyph_cache[0];
+    for( int i = 0; i < GLYPH_CACHE_SIZE; i++ )
+    {
+        glyph_cache_t *p_cur = &p_sys->p_glyph_cache[i];
+        if( p_cur->i_face == i_face && p_cur->i_size == i_size &&
+            p_cur->i_glyph_index == i_glyph_index &&
+            p_cur->i_style_flags == i_style_flags &&
+            p_cur->pen.x == pen.x && p_cur->pen.y == pen.y &&
+            p_cur->pen_shadow.x == pen_shadow.x &&
+            p_cur->pen_shadow.y == pen_shadow.y )
+        {
+            p_entry = p_cur;
+            break;
+        }
+        if( p_cur->i_used < p_oldest->i_used )
+            p_oldest = p_cur;
+    }
+
+    if( !p_entry )
+    {
+        p_entry = p_oldest;
+        CleanGlyphCache( p_entry );
+        if( RenderGlyph( p_filter, &p_entry->p_glyph, &p_entry->glyph_bbox,
+                         &p_entry->p_outline, &p_entry->outline_bbox,
+                         &p_entry->p_shadow, &p_entry->shadow_bbox,
+                         &p_entry->advance,
+                         p_face, i_glyph_index, i_style_flags,
+                         &pen, &pen_shadow ) )
+            return VLC_EGENERIC;
+        p_entry->i_face        = i_face;
+        p_entry->i_size        = i_size;
+        p_entry->i_glyph_index = i_glyph_index;
+        p_entry->i_style_flags = i_style_flags;
+        p_entry->pen           = pen;
+        p_entry->pen_shadow    = pen_shadow;
+    }
+    p_entry->i_used = ++p_sys->i_cache_date;
+
+    *pp_outline = NULL;
+    *pp_shadow  = NULL;
+    if( MoveGlyph( pp_glyph, p_glyph_bbox, p_entry->p_glyph, &p_entry->glyph_bbox,
+                   FT_FLOOR(p_pen->x), FT_FLOOR(p_pen->y) ) )
+        return VLC_EGENERIC;
+    if( ( p_entry->p_outline &&
+          MoveGlyph( pp_outline, p_outline_bbox,
+                     p_entry->p_outline, &p_entry->outline_bbox,
+                     FT_FLOOR(p_pen->x), FT_FLOOR(p_pen->y) ) ) ||
+        ( p_entry->p_shadow &&
+          MoveGlyph( pp_shadow, p_shadow_bbox,
+                     p_entry->p_shadow, &p_entry->shadow_bbox,
+                     FT_FLOOR(p_pen_shadow->x), FT_FLOOR(p_pen_shadow->y) ) ) )
+    {
+        FT_Done_Glyph( *pp_glyph );
+        if( *pp_outline )
+            FT_Done_Glyph( *pp_outline );
+        return VLC_EGENERIC;
+    }
+    *p_advance = p_entry->advance;
+    return VLC_SUCCESS;
+}
+
+static void FixGlyph( FT_Glyph glyph, FT_BBox *p_bbox, const FT_Vector *p_advance,
+                      const FT_Vector *p_pen )
 {
     FT_BitmapGlyph glyph_bmp = (FT_BitmapGlyph)glyph;
     if( p_bbox->xMin >= p_bbox->xMax )
     {
         p_bbox->xMin = FT_CEIL(p_pen->x);
-        p_bbox->xMax = FT_CEIL(p_pen->x + face->glyph->advance.x);
+        p_bbox->xMax = FT_CEIL(p_pen->x + p_advance->x);
         glyph_bmp->left = p_bbox->xMin;
     }
     if( p_bbox->yMin >= p_bbox->yMax )
     {
         p_bbox->yMax = FT_CEIL(p_pen->y);
-        p_bbox->yMin = FT_CEIL(p_pen->y + face->glyph->advance.y);
+        p_bbox->yMin = FT_CEIL(p_pen->y + p_advance->y);
         glyph_bmp->top  = p_bbox->yMax;
     }
 }
@@ -2217,20 +2402,22 @@ static int ProcessLines( filter_t *p_filter,
                 FT_BBox  outline_bbox;
                 FT_Glyph shadow;
                 FT_BBox  shadow_bbox;
+                FT_Vector advance;
 
                 if( GetGlyph( p_filter,
                               &glyph, &glyph_bbox,
                               &outline, &outline_bbox,
                               &shadow, &shadow_bbox,
+                              &advance,
                               p_current_face, i_glyph_index, p_glyph_style->i_style_flags,
                               &pen_new, &pen_shadow_new ) )
                     goto next;
 
-                FixGlyph( glyph, &glyph_bbox, p_current_face, &pen_new );
+                FixGlyph( glyph, &glyph_bbox, &advance, &pen_new );
                 if( outline )
-                    FixGlyph( outline, &outline_bbox, p_current_face, &pen_new );
+                    FixGlyph( outline, &outline_bbox, &advance, &pen_new );
                 if( shadow )
-                    FixGlyph( shadow, &shadow_bbox, p_current_face, &pen_shadow_new );
+                    FixGlyph( shadow, &shadow_bbox, &advance, &pen_shadow_new );
 
                 /* FIXME and what about outline */
 
@@ -2329,8 +2516,8 @@ static int ProcessLines( filter_t *p_filter,
                     .i_line_thickness = i_line_thickness,
                 };
 
-                pen.x = pen_new.x + p_current_face->glyph->advance.x;
-                pen.y = pen_new.y + p_current_face->glyph->advance.y;
+                pen.x = pen_new.x + advance.x;
+                pen.y = pen_new.y + advance.y;
                 line_bbox = line_bbox_new;
             next:
                 i_glyph_last = i_glyph_index;
@@ -2405,6 +2592,137 @@ static int ProcessLines( filter_t *p_filter,
     return VLC_SUCCESS;
 }
 
+static bool StyleEquals( const text_style_t *p_style1,
+                         const text_style_t *p_style2 )
+{
+    if( !p_style1 || !p_style2 )
+        return p_style1 == p_style2;
+    if( ( p_style1->psz_fontname == NULL ) != ( p_style2->psz_fontname == NULL ) ||
+        ( p_style1->psz_fontname &&
+          strcmp( p_style1->psz_fontname, p_style2->psz_fontname ) ) )
+        return false;
+
+    /* All the other fields are integers */
+    return !memcmp( &p_style1->i_font_size, &p_style2->i_font_size,
+                    sizeof(*p_style1) - offsetof(text_style_t, i_font_size) );
+}
+
+static void CleanRegionCache( region_cache_t *p_entry )
+{
+    if( !p_entry->psz_text )
+        return;
+    free( p_entry->psz_text );
+    if( p_entry->p_style )
+        text_style_Delete( p_entry->p_style );
+    picture_Release( p_entry->p_picture );
+    p_entry->psz_text = NULL;
+}
+
+/* Chroma RenderCommon() renders into from p_chroma_list */
+static vlc_fourcc_t GetRenderChroma( filter_t *p_filter,
+                                     const vlc_fourcc_t *p_chroma_list )
+{
+    if( var_InheritBool( p_filter, "freetype-yuvp" ) )
+        return VLC_CODEC_YUVP;
+    if( !p_chroma_list || *p_chroma_list == 0 )
+        return VLC_CODEC_RGBA;
+    for( ; *p_chroma_list != 0; p_chroma_list++ )
+    {
+        if( *p_chroma_list == VLC_CODEC_YUVP ||
+            *p_chroma_list == VLC_CODEC_YUVA ||
+            *p_chroma_list == VLC_CODEC_RGBA )
+            return *p_chroma_list;
+    }
+    return 0;
+}
+
+static region_cache_t *FindRegionCache( filter_t *p_filter,
+                                        const subpicture_region_t *p_region_in,
+                                        const subpicture_region_t *p_region_out,
+                                        bool b_html, vlc_fourcc_t i_chroma )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const char *psz_text = b_html ? p_region_in->psz_html : p_region_in->psz_text;
+
+    for( int i = 0; i < REGION_CACHE_SIZE; i++ )
+    {
+        region_cache_t *p_entry = &p_sys->p_region_cache[i];
+        if( p_entry->psz_text && p_entry->b_html == b_html &&
+            p_entry->fmt.i_chroma == i_chroma &&
+            p_entry->i_font_size == p_sys->i_font_size &&
+            p_entry->i_align == p_region_out->i_align &&
+            p_entry->i_width == p_filter->fmt_out.video.i_visible_width &&
+            !strcmp( p_entry->psz_text, psz_text ) &&
+            StyleEquals( p_entry->p_style, p_region_in->p_style ) )
+            return p_entry;
+    }
+    return NULL;
+}
+
+static int GetRegionCache( filter_t *p_filter, region_cache_t *p_entry,
+                           subpicture_region_t *p_region_out,
+                           const subpicture_region_t *p_region_in )
+{
+    video_format_t fmt = p_entry->fmt;
+    if( fmt.i_chroma == VLC_CODEC_YUVP )
+    {
+        fmt.p_palette = p_region_out->fmt.p_palette ? p_region_out->fmt.p_palette
+                                                     : malloc( sizeof(*fmt.p_palette) );
+        if( !fmt.p_palette )
+            return VLC_ENOMEM;
+        *fmt.p_palette = p_entry->palette;
+    }
+
+    assert( !p_region_out->p_picture );
+    p_region_out->p_picture = picture_Hold( p_entry->p_picture );
+    p_region_out->fmt = fmt;
+    p_region_out->i_x = p_region_in->i_x;
+    p_region_out->i_y = p_region_in->i_y;
+
+    p_entry->i_used = ++p_filter->p_sys->i_cache_date;
+    return VLC_SUCCESS;
+}
+
+/* Keeps the region just rendered, in place of the oldest one */
+static void PutRegionCache( filter_t *p_filter,
+                            const subpicture_region_t *p_region_out,
+                            const subpicture_region_t *p_region_in,
+                            bool b_html )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const char *psz_text = b_html ? p_region_in->psz_html : p_region_in->psz_text;
+
+    region_cache_t *p_entry = &p_sys->p_region_cache[0];
+    for( int i = 1; i < REGION_CACHE_SIZE; i++ )
+    {
+        if( p_sys->p_region_cache[i].i_used < p_entry->i_used )
+            p_entry = &p_sys->p_region_cache[i];
+    }
+    CleanRegionCache( p_entry );
+
+    p_entry->psz_text = strdup( psz_text );
+    p_entry->p_style = p_region_in->p_style ? text_style_Duplicate( p_region_in->p_style )
+                                            : NULL;
+    if( !p_entry->psz_text || ( p_region_in->p_style && !p_entry->p_style ) )
+    {
+        free( p_entry->psz_text );
+        if( p_entry->p_style )
+            text_style_Delete( p_entry->p_style );
+        p_entry->psz_text = NULL;
+        return;
+    }
+    p_entry->b_html      = b_html;
+    p_entry->i_font_size = p_sys->i_font_size;
+    p_entry->i_align     = p_region_out->i_align;
+    p_entry->i_width     = p_filter->fmt_out.video.i_visible_width;
+    p_entry->fmt         = p_region_out->fmt;
+    p_entry->fmt.p_palette = NULL;
+    if( p_region_out->fmt.p_palette )
+        p_entry->palette = *p_region_out->fmt.p_palette;
+    p_entry->p_picture   = picture_Hold( p_region_out->p_picture );
+    p_entry->i_used      = ++p_sys->i_cache_date;
+}
+
 /**
  * This function renders a text subpicture region into another one.
  * It also calculates the size needed for this string, and renders the
@@ -2439,6 +2757,16 @@ static int RenderCommon( filter_t *p_filter, subpicture_region_t *p_region_out,
     /* Reset the default fontsize in case screen metrics have changed */
     p_filter->p_sys->i_font_size = GetFontSize( p_filter );
 
+    /* The same text was rendered lately */
+    region_cache_t *p_cache = FindRegionCache( p_filter, p_region_in, p_region_out, b_html,
+                                               GetRenderChroma( p_filter, p_chroma_list ) );
+    if( p_cache && !GetRegionCache( p_filter, p_cache, p_region_out, p_region_in ) )
+    {
+        free( psz_text );
+        free( pp_styles );
+        return VLC_SUCCESS;
+    }
+
     /* */
     int rv = VLC_SUCCESS;
     int i_text_length = 0;
@@ -2585,6 +2913,8 @@ static int RenderCommon( filter_t *p_filter, subpicture_region_t *p_region_out,
          */
         if( pi_k_durations )
             var_SetBool( p_filter, "text-rerender", true );
+        else if( !rv )
+            PutRegionCache( p_filter, p_region_out, p_region_in, b_html );
     }
 
     FreeLines( p_lines );
@@ -2645,6 +2975,9 @@ static int Create( vlc_object_t *p_this )
     p_sys->p_library        = 0;
     p_sys->i_font_size      = 0;
     p_sys->i_display_height = 0;
+    p_sys->p_glyph_cache    = NULL;
+    memset( p_sys->p_region_cache, 0, sizeof(p_sys->p_region_cache) );
+    p_sys->i_cache_date     = 0;
 
     var_Create( p_filter, "freetype-rel-fontsize",
                 VLC_VAR_INTEGER | VLC_VAR_DOINHERIT );
@@ -2787,6 +3120,9 @@ static int Create( vlc_object_t *p_this )
 
     LoadFontsFromAttachments( p_filter );
 
+    /* Without it, every glyph is rendered each time */
+    p_sys->p_glyph_cache = calloc( GLYPH_CACHE_SIZE, sizeof(*p_sys->p_glyph_cache) );
+
 #ifdef HAVE_STYLES
     free( psz_fontfile );
 #endif
@@ -2822,6 +3158,15 @@ static void Destroy( vlc_object_t *p_this )
         free( p_sys->pp_font_attachments );
     }
 
+    for( int i = 0; i < REGION_CACHE_SIZE; i++ )
+        CleanRegionCache( &p_sys->p_region_cache[i] );
+    if( p_sys->p_glyph_cache )
+    {
+        for( int i = 0; i < GLYPH_CACHE_SIZE; i++ )
+            CleanGlyphCache( &p_sys->p_glyph_cache[i] );
+        free( p_sys->p_glyph_cache );
+    }
+
 #ifdef HAVE_STYLES
     if( p_sys->p_xml ) xml_ReaderDelete( p_sys->p_xml );
 #endif
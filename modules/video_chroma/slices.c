@@ -0,0 +1,181 @@
+/*****************************************************************************
+ * slices.c: picture conversion by horizontal bands on several threads
+ *****************************************************************************
+ * Copyright (C) 2012 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+
+#include "slices.h"
+
+/* Threads used when "chroma-threads" is 0 */
+#define SLICES_AUTO_MAX (4)
+
+typedef struct
+{
+    filter_slices_t *p_slices;
+    unsigned         i_slice;
+    vlc_thread_t     thread;
+} slices_worker_t;
+
+struct filter_slices_t
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  wait;    /* for the workers */
+    vlc_cond_t  done;    /* for the calling thread */
+    bool        b_exit;
+
+    /* The current job */
+    unsigned    i_job;
+    void      (*pf_slice)( void *, unsigned );
+    void       *p_data;
+    unsigned    i_pending;
+
+    unsigned    i_count;
+    unsigned    i_threads;
+    slices_worker_t p_worker[];
+};
+
+static void *SlicesThread( void *p_data )
+{
+    slices_worker_t *p_worker = p_data;
+    filter_slices_t *p_slices = p_worker->p_slices;
+    const unsigned i_slice = p_worker->i_slice;
+    unsigned i_job = 0;
+
+    vlc_mutex_lock( &p_slices->lock );
+    for( ;; )
+    {
+        while( !p_slices->b_exit && p_slices->i_job == i_job )
+            vlc_cond_wait( &p_slices->wait, &p_slices->lock );
+        if( p_slices->b_exit )
+            break;
+
+        i_job = p_slices->i_job;
+        void (*pf_slice)( void *, unsigned ) = p_slices->pf_slice;
+        void *p_job = p_slices->p_data;
+        vlc_mutex_unlock( &p_slices->lock );
+
+        pf_slice( p_job, i_slice );
+
+        vlc_mutex_lock( &p_slices->lock );
+        if( --p_slices->i_pending == 0 )
+            vlc_cond_signal( &p_slices->done );
+    }
+    vlc_mutex_unlock( &p_slices->lock );
+    return NULL;
+}
+
+filter_slices_t *SlicesNew( vlc_object_t *p_obj, unsigned i_lines )
+{
+    unsigned i_count = var_InheritInteger( p_obj, "chroma-threads" );
+
+    if( i_count == 0 )
+        i_count = __MIN( vlc_GetCPUCount(), SLICES_AUTO_MAX );
+    i_count = __MIN( i_count, i_lines / SLICES_MIN_LINES );
+    if( i_count <= 1 )
+        return NULL;
+
+    filter_slices_t *p_slices = malloc( sizeof(*p_slices) +
+                                        ( i_count - 1 ) *
+                                        sizeof(*p_slices->p_worker) );
+    if( unlikely(p_slices == NULL) )
+        return NULL;
+
+    vlc_mutex_init( &p_slices->lock );
+    vlc_cond_init( &p_slices->wait );
+    vlc_cond_init( &p_slices->done );
+    p_slices->b_exit = false;
+    p_slices->i_job = 0;
+    p_slices->i_pending = 0;
+    p_slices->i_count = 1;
+    p_slices->i_threads = 0;
+
+    /* Band 0 is converted by the calling thread */
+    for( unsigned i = 0; i < i_count - 1; i++ )
+    {
+        p_slices->p_worker[i].p_slices = p_slices;
+        p_slices->p_worker[i].i_slice = i + 1;
+        if( vlc_clone( &p_slices->p_worker[i].thread, SlicesThread,
+                       &p_slices->p_worker[i], VLC_THREAD_PRIORITY_VIDEO ) )
+            break;
+        p_slices->i_threads++;
+    }
+    p_slices->i_count = 1 + p_slices->i_threads;
+    if( p_slices->i_count <= 1 )
+    {
+        SlicesDelete( p_slices );
+        return NULL;
+    }
+    msg_Dbg( p_obj, "converting pictures as %u bands", p_slices->i_count );
+    return p_slices;
+}
+
+void SlicesDelete( filter_slices_t *p_slices )
+{
+    vlc_mutex_lock( &p_slices->lock );
+    p_slices->b_exit = true;
+    vlc_cond_broadcast( &p_slices->wait );
+    vlc_mutex_unlock( &p_slices->lock );
+
+    for( unsigned i = 0; i < p_slices->i_threads; i++ )
+        vlc_join( p_slices->p_worker[i].thread, NULL );
+
+    vlc_cond_destroy( &p_slices->done );
+    vlc_cond_destroy( &p_slices->wait );
+    vlc_mutex_destroy( &p_slices->lock );
+    free( p_slices );
+}
+
+unsigned SlicesCount( const filter_slices_t *p_slices )
+{
+    return p_slices->i_count;
+}
+
+void SlicesGetBand( unsigned i_lines, unsigned i_align, unsigned i_count,
+                    unsigned i_slice, unsigned *pi_first, unsigned *pi_last )
+{
+    const unsigned i_units = ( i_lines + i_align - 1 ) / i_align;
+
+    *pi_first = __MIN( i_lines, i_align * ( i_slice * i_units / i_count ) );
+    *pi_last  = __MIN( i_lines,
+                       i_align * ( ( i_slice + 1 ) * i_units / i_count ) );
+}
+
+void SlicesRun( filter_slices_t *p_slices,
+                void (*pf_slice)( void *p_data, unsigned i_slice ),
+                void *p_data )
+{
+    vlc_mutex_lock( &p_slices->lock );
+    p_slices->pf_slice = pf_slice;
+    p_slices->p_data = p_data;
+    p_slices->i_pending = p_slices->i_threads;
+    p_slices->i_job++;
+    vlc_cond_broadcast( &p_slices->wait );
+    vlc_mutex_unlock( &p_slices->lock );
+
+    pf_slice( p_data, 0 );
+
+    vlc_mutex_lock( &p_slices->lock );
+    while( p_slices->i_pending > 0 )
+        vlc_cond_wait( &p_slices->done, &p_slices->lock );
+    vlc_mutex_unlock( &p_slices->lock );
+}
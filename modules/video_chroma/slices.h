@@ -0,0 +1,57 @@
+/*****************************************************************************
+ * slices.h: picture conversion by horizontal bands on several threads
+ *****************************************************************************
+ * Copyright (C) 2012 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_VIDEO_CHROMA_SLICES_H_
+#define VLC_VIDEO_CHROMA_SLICES_H_
+
+/* Lines below which a band is not worth a thread */
+#define SLICES_MIN_LINES (64)
+
+typedef struct filter_slices_t filter_slices_t;
+
+/**
+ * Creates the threads converting the pictures of i_lines lines, as many as
+ * "chroma-threads" tells, but no more than leaves SLICES_MIN_LINES lines to
+ * each band.
+ * \return NULL if the pictures are better converted by the calling thread
+ * alone (or on error)
+ */
+filter_slices_t *SlicesNew( vlc_object_t *, unsigned i_lines );
+void SlicesDelete( filter_slices_t * );
+
+/** Number of bands, one per thread including the calling one */
+unsigned SlicesCount( const filter_slices_t * );
+
+/**
+ * Gives the lines [*pi_first, *pi_last) of the band i_slice out of i_count,
+ * as multiples of i_align lines (but for the end of the picture).
+ */
+void SlicesGetBand( unsigned i_lines, unsigned i_align, unsigned i_count,
+                    unsigned i_slice, unsigned *pi_first, unsigned *pi_last );
+
+/**
+ * Calls pf_slice for every band at once, the first one from the calling
+ * thread, and waits for all of them.
+ */
+void SlicesRun( filter_slices_t *,
+                void (*pf_slice)( void *p_data, unsigned i_slice ),
+                void *p_data );
+
+#endif
@@ -0,0 +1,635 @@
+/*****************************************************************************
+ * yuv_rgb.c : SSE2 and AVX2 YUV to RGB conversion module for vlc
+ *****************************************************************************
+ * Copyright (C) 2012 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_filter.h>
+#include <vlc_cpu.h>
+
+#include "slices.h"
+
+#if defined (__SSE2__)
+# include <emmintrin.h>
+#endif
+#if defined (CAN_COMPILE_AVX2)
+# include <immintrin.h>
+#endif
+
+#define SRC_FOURCC  "I420,IYUV,YV12,J420,I422,J422,NV12"
+#define DEST_FOURCC "RV15,RV16,RV32"
+
+/*****************************************************************************
+ * Local and extern prototypes.
+ *****************************************************************************/
+static int  Activate  ( vlc_object_t * );
+static void Deactivate( vlc_object_t * );
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+vlc_module_begin ()
+    set_description( N_("SSE2 and AVX2 conversions from " SRC_FOURCC
+                        " to " DEST_FOURCC) )
+    set_capability( "video filter2", 150 )
+    set_callbacks( Activate, Deactivate )
+vlc_module_end ()
+
+/* The conversion works on 16 bits samples: the luma and chroma samples,
+ * centered and multiplied by 64, are multiplied by the coefficients in Q12
+ * keeping the high 16 bits, which gives four times the color components. */
+typedef struct
+{
+    int16_t y_offset; /* black level */
+    int16_t y;        /* luma coefficient */
+    int16_t vr, ug, vg, ub;
+} yuv_matrix_t;
+
+typedef void (*yuv_row_t)( const yuv_matrix_t *, uint8_t *, const uint8_t *,
+                           const uint8_t *, const uint8_t *, unsigned );
+
+struct filter_sys_t
+{
+    yuv_matrix_t matrix;
+    yuv_row_t    pf_row;
+    bool         b_semiplanar; /* interleaved U and V (NV12) */
+    bool         b_swap_uv;    /* V plane first (YV12) */
+    unsigned     i_chroma_shift; /* vertical chroma subsampling */
+    filter_slices_t *p_slices;   /* NULL to convert from the vout thread */
+};
+
+enum
+{
+    RGB_RV32,    /* A8R8G8B8 */
+    RGB_RV32_BGR,/* A8B8G8R8 */
+    RGB_RV16,    /* R5G6B5 */
+    RGB_RV15,    /* R5G5B5 */
+};
+
+/*****************************************************************************
+ * Plain C conversion, for the last pixels of the lines
+ *****************************************************************************/
+static inline int MulHigh( int a, int b )
+{
+    return ( a * b ) >> 16;
+}
+
+static inline uint8_t Clip( int v )
+{
+    v = ( v + 2 ) >> 2;
+    return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+static void RowC( const yuv_matrix_t *m, int i_format, uint8_t *p_dst,
+                  const uint8_t *p_y, const uint8_t *p_u, const uint8_t *p_v,
+                  unsigned i_step, unsigned x, unsigned i_width )
+{
+    for( ; x < i_width; x++ )
+    {
+        const int u = ( p_u[(x / 2) * i_step] - 128 ) * 64;
+        const int v = ( p_v[(x / 2) * i_step] - 128 ) * 64;
+        const int y = MulHigh( ( p_y[x] - m->y_offset ) * 64, m->y );
+
+        const uint8_t r = Clip( y + MulHigh( v, m->vr ) );
+        const uint8_t g = Clip( y + MulHigh( u, m->ug ) + MulHigh( v, m->vg ) );
+        const uint8_t b = Clip( y + MulHigh( u, m->ub ) );
+
+        switch( i_format )
+        {
+            case RGB_RV32:
+                ((uint32_t *)p_dst)[x] = 0xff000000 | (r << 16) | (g << 8) | b;
+                break;
+            case RGB_RV32_BGR:
+                ((uint32_t *)p_dst)[x] = 0xff000000 | (b << 16) | (g << 8) | r;
+                break;
+            case RGB_RV16:
+                ((uint16_t *)p_dst)[x] = ((r & 0xf8) << 8) | ((g & 0xfc) << 3)
+                                       | (b >> 3);
+                break;
+            case RGB_RV15:
+                ((uint16_t *)p_dst)[x] = ((r & 0xf8) << 7) | ((g & 0xf8) << 2)
+                                       | (b >> 3);
+                break;
+        }
+    }
+}
+
+/*****************************************************************************
+ * SSE2 conversion, 16 pixels at a time
+ *****************************************************************************/
+#if defined (__SSE2__)
+/* Computes four times the components of 8 pixels (1 chroma sample for 2) */
+static inline void ConvertSSE2( const yuv_matrix_t *m, __m128i y8,
+                                __m128i u, __m128i v,
+                                __m128i *r, __m128i *g, __m128i *b )
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    __m128i y = _mm_sub_epi16( _mm_unpacklo_epi8( y8, zero ),
+                               _mm_set1_epi16( m->y_offset ) );
+    y = _mm_mulhi_epi16( _mm_slli_epi16( y, 6 ), _mm_set1_epi16( m->y ) );
+
+    /* u and v hold the 4 chroma samples in their lower half */
+    u = _mm_slli_epi16( _mm_sub_epi16( u, _mm_set1_epi16( 128 ) ), 6 );
+    v = _mm_slli_epi16( _mm_sub_epi16( v, _mm_set1_epi16( 128 ) ), 6 );
+
+    __m128i cr = _mm_mulhi_epi16( v, _mm_set1_epi16( m->vr ) );
+    __m128i cg = _mm_add_epi16( _mm_mulhi_epi16( u, _mm_set1_epi16( m->ug ) ),
+                                _mm_mulhi_epi16( v, _mm_set1_epi16( m->vg ) ) );
+    __m128i cb = _mm_mulhi_epi16( u, _mm_set1_epi16( m->ub ) );
+
+    const __m128i round = _mm_set1_epi16( 2 );
+    *r = _mm_srai_epi16( _mm_add_epi16( _mm_add_epi16( y, round ),
+                                        _mm_unpacklo_epi16( cr, cr ) ), 2 );
+    *g = _mm_srai_epi16( _mm_add_epi16( _mm_add_epi16( y, round ),
+                                        _mm_unpacklo_epi16( cg, cg ) ), 2 );
+    *b = _mm_srai_epi16( _mm_add_epi16( _mm_add_epi16( y, round ),
+                                        _mm_unpacklo_epi16( cb, cb ) ), 2 );
+}
+
+/* Loads the chroma samples of 16 pixels, as 16 bits samples */
+static inline void LoadChromaSSE2( const uint8_t *p_u, const uint8_t *p_v,
+                                   unsigned x, __m128i *u, __m128i *v )
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    if( p_v == NULL )
+    {
+        const __m128i uv = _mm_loadu_si128( (const __m128i *)&p_u[x] );
+        *u = _mm_and_si128( uv, _mm_set1_epi16( 0xff ) );
+        *v = _mm_srli_epi16( uv, 8 );
+    }
+    else
+    {
+        *u = _mm_unpacklo_epi8(
+                _mm_loadl_epi64( (const __m128i *)&p_u[x / 2] ), zero );
+        *v = _mm_unpacklo_epi8(
+                _mm_loadl_epi64( (const __m128i *)&p_v[x / 2] ), zero );
+    }
+}
+
+static inline void RowSSE2( const yuv_matrix_t *m, int i_format,
+                            uint8_t *p_dst, const uint8_t *p_y,
+                            const uint8_t *p_u, const uint8_t *p_v,
+                            unsigned i_width )
+{
+    const __m128i zero = _mm_setzero_si128();
+    unsigned x;
+
+    for( x = 0; x + 16 <= i_width; x += 16 )
+    {
+        const __m128i y = _mm_loadu_si128( (const __m128i *)&p_y[x] );
+        __m128i u, v, r0, g0, b0, r1, g1, b1;
+
+        LoadChromaSSE2( p_u, p_v, x, &u, &v );
+        ConvertSSE2( m, y, u, v, &r0, &g0, &b0 );
+        ConvertSSE2( m, _mm_srli_si128( y, 8 ), _mm_srli_si128( u, 8 ),
+                     _mm_srli_si128( v, 8 ), &r1, &g1, &b1 );
+
+        if( i_format == RGB_RV32 || i_format == RGB_RV32_BGR )
+        {
+            const __m128i r = _mm_packus_epi16( r0, r1 );
+            const __m128i g = _mm_packus_epi16( g0, g1 );
+            const __m128i b = _mm_packus_epi16( b0, b1 );
+            const __m128i lo = i_format == RGB_RV32 ? b : r;
+            const __m128i hi = i_format == RGB_RV32 ? r : b;
+            const __m128i a = _mm_set1_epi8( 0xff );
+
+            const __m128i lg0 = _mm_unpacklo_epi8( lo, g );
+            const __m128i lg1 = _mm_unpackhi_epi8( lo, g );
+            const __m128i ha0 = _mm_unpacklo_epi8( hi, a );
+            const __m128i ha1 = _mm_unpackhi_epi8( hi, a );
+            __m128i *p_out = (__m128i *)&p_dst[4 * x];
+
+            _mm_storeu_si128( &p_out[0], _mm_unpacklo_epi16( lg0, ha0 ) );
+            _mm_storeu_si128( &p_out[1], _mm_unpackhi_epi16( lg0, ha0 ) );
+            _mm_storeu_si128( &p_out[2], _mm_unpacklo_epi16( lg1, ha1 ) );
+            _mm_storeu_si128( &p_out[3], _mm_unpackhi_epi16( lg1, ha1 ) );
+        }
+        else
+        {
+            const __m128i max = _mm_set1_epi16( 255 );
+            const __m128i mask_g = _mm_set1_epi16( i_format == RGB_RV16
+                                                   ? 0xfc : 0xf8 );
+            const int i_shift_r = i_format == RGB_RV16 ? 8 : 7;
+            const int i_shift_g = i_format == RGB_RV16 ? 3 : 2;
+            __m128i *p_out = (__m128i *)&p_dst[2 * x];
+            __m128i pp_rgb[2][3] = { { r0, g0, b0 }, { r1, g1, b1 } };
+
+            for( int i = 0; i < 2; i++ )
+            {
+                __m128i r = _mm_min_epi16( _mm_max_epi16( pp_rgb[i][0], zero ), max );
+                __m128i g = _mm_min_epi16( _mm_max_epi16( pp_rgb[i][1], zero ), max );
+                __m128i b = _mm_min_epi16( _mm_max_epi16( pp_rgb[i][2], zero ), max );
+
+                r = _mm_slli_epi16( _mm_and_si128( r, _mm_set1_epi16( 0xf8 ) ),
+                                    i_shift_r );
+                g = _mm_slli_epi16( _mm_and_si128( g, mask_g ), i_shift_g );
+                b = _mm_srli_epi16( b, 3 );
+                _mm_storeu_si128( &p_out[i],
+                                  _mm_or_si128( _mm_or_si128( r, g ), b ) );
+            }
+        }
+    }
+
+    if( p_v == NULL )
+        RowC( m, i_format, p_dst, p_y, p_u, p_u + 1, 2, x, i_width );
+    else
+        RowC( m, i_format, p_dst, p_y, p_u, p_v, 1, x, i_width );
+}
+
+#define ROW_FUNCTION( name, isa, format ) \
+    static void name( const yuv_matrix_t *m, uint8_t *p_dst,               \
+                      const uint8_t *p_y, const uint8_t *p_u,              \
+                      const uint8_t *p_v, unsigned i_width )               \
+    {                                                                      \
+        Row##isa( m, format, p_dst, p_y, p_u, p_v, i_width );              \
+    }
+
+ROW_FUNCTION( RowRV32_SSE2,    SSE2, RGB_RV32 )
+ROW_FUNCTION( RowRV32BGR_SSE2, SSE2, RGB_RV32_BGR )
+ROW_FUNCTION( RowRV16_SSE2,    SSE2, RGB_RV16 )
+ROW_FUNCTION( RowRV15_SSE2,    SSE2, RGB_RV15 )
+#endif
+
+/*****************************************************************************
+ * AVX2 conversion, 32 pixels at a time
+ *****************************************************************************/
+#if defined (__SSE2__) && defined (CAN_COMPILE_AVX2)
+/* Computes four times the components of 16 pixels; the 16 bits chroma
+ * samples are in order, their low half for these pixels */
+VLC_AVX2
+static inline void ConvertAVX2( const yuv_matrix_t *m, __m128i y8,
+                                __m256i cr, __m256i cg, __m256i cb,
+                                __m256i *r, __m256i *g, __m256i *b )
+{
+    __m256i y = _mm256_sub_epi16( _mm256_cvtepu8_epi16( y8 ),
+                                  _mm256_set1_epi16( m->y_offset ) );
+    y = _mm256_mulhi_epi16( _mm256_slli_epi16( y, 6 ),
+                            _mm256_set1_epi16( m->y ) );
+    y = _mm256_add_epi16( y, _mm256_set1_epi16( 2 ) );
+
+    *r = _mm256_srai_epi16( _mm256_add_epi16( y, cr ), 2 );
+    *g = _mm256_srai_epi16( _mm256_add_epi16( y, cg ), 2 );
+    *b = _mm256_srai_epi16( _mm256_add_epi16( y, cb ), 2 );
+}
+
+/* Duplicates the chroma terms of 16 samples for 32 pixels */
+VLC_AVX2
+static inline void DuplicateAVX2( __m256i c, __m256i *c0, __m256i *c1 )
+{
+    const __m256i lo = _mm256_unpacklo_epi16( c, c );
+    const __m256i hi = _mm256_unpackhi_epi16( c, c );
+
+    *c0 = _mm256_permute2x128_si256( lo, hi, 0x20 );
+    *c1 = _mm256_permute2x128_si256( lo, hi, 0x31 );
+}
+
+VLC_AVX2
+static inline void RowAVX2( const yuv_matrix_t *m, int i_format,
+                            uint8_t *p_dst, const uint8_t *p_y,
+                            const uint8_t *p_u, const uint8_t *p_v,
+                            unsigned i_width )
+{
+    const __m256i zero = _mm256_setzero_si256();
+    unsigned x;
+
+    for( x = 0; x + 32 <= i_width; x += 32 )
+    {
+        __m256i u, v;
+
+        if( p_v == NULL )
+        {
+            const __m256i uv = _mm256_loadu_si256( (const __m256i *)&p_u[x] );
+            u = _mm256_and_si256( uv, _mm256_set1_epi16( 0xff ) );
+            v = _mm256_srli_epi16( uv, 8 );
+        }
+        else
+        {
+            u = _mm256_cvtepu8_epi16(
+                    _mm_loadu_si128( (const __m128i *)&p_u[x / 2] ) );
+            v = _mm256_cvtepu8_epi16(
+                    _mm_loadu_si128( (const __m128i *)&p_v[x / 2] ) );
+        }
+        u = _mm256_slli_epi16( _mm256_sub_epi16( u, _mm256_set1_epi16( 128 ) ), 6 );
+        v = _mm256_slli_epi16( _mm256_sub_epi16( v, _mm256_set1_epi16( 128 ) ), 6 );
+
+        __m256i cr0, cr1, cg0, cg1, cb0, cb1;
+        DuplicateAVX2( _mm256_mulhi_epi16( v, _mm256_set1_epi16( m->vr ) ),
+                       &cr0, &cr1 );
+        DuplicateAVX2( _mm256_add_epi16(
+                           _mm256_mulhi_epi16( u, _mm256_set1_epi16( m->ug ) ),
+                           _mm256_mulhi_epi16( v, _mm256_set1_epi16( m->vg ) ) ),
+                       &cg0, &cg1 );
+        DuplicateAVX2( _mm256_mulhi_epi16( u, _mm256_set1_epi16( m->ub ) ),
+                       &cb0, &cb1 );
+
+        __m256i r0, g0, b0, r1, g1, b1;
+        ConvertAVX2( m, _mm_loadu_si128( (const __m128i *)&p_y[x] ),
+                     cr0, cg0, cb0, &r0, &g0, &b0 );
+        ConvertAVX2( m, _mm_loadu_si128( (const __m128i *)&p_y[x + 16] ),
+                     cr1, cg1, cb1, &r1, &g1, &b1 );
+
+        if( i_format == RGB_RV32 || i_format == RGB_RV32_BGR )
+        {
+            /* packus works within the 128 bits lanes: put the pixels back
+             * in order */
+            const __m256i r = _mm256_permute4x64_epi64(
+                                  _mm256_packus_epi16( r0, r1 ), 0xd8 );
+            const __m256i g = _mm256_permute4x64_epi64(
+                                  _mm256_packus_epi16( g0, g1 ), 0xd8 );
+            const __m256i b = _mm256_permute4x64_epi64(
+                                  _mm256_packus_epi16( b0, b1 ), 0xd8 );
+            const __m256i lo = i_format == RGB_RV32 ? b : r;
+            const __m256i hi = i_format == RGB_RV32 ? r : b;
+            const __m256i a = _mm256_set1_epi8( 0xff );
+
+            /* Pixels 0-7 and 16-23, then 8-15 and 24-31 */
+            const __m256i lg0 = _mm256_unpacklo_epi8( lo, g );
+            const __m256i lg1 = _mm256_unpackhi_epi8( lo, g );
+            const __m256i ha0 = _mm256_unpacklo_epi8( hi, a );
+            const __m256i ha1 = _mm256_unpackhi_epi8( hi, a );
+
+            const __m256i p0 = _mm256_unpacklo_epi16( lg0, ha0 );
+            const __m256i p1 = _mm256_unpackhi_epi16( lg0, ha0 );
+            const __m256i p2 = _mm256_unpacklo_epi16( lg1, ha1 );
+            const __m256i p3 = _mm256_unpackhi_epi16( lg1, ha1 );
+            __m256i *p_out = (__m256i *)&p_dst[4 * x];
+
+            _mm256_storeu_si256( &p_out[0],
+                                 _mm256_permute2x128_si256( p0, p1, 0x20 ) );
+            _mm256_storeu_si256( &p_out[1],
+                                 _mm256_permute2x128_si256( p2, p3, 0x20 ) );
+            _mm256_storeu_si256( &p_out[2],
+                                 _mm256_permute2x128_si256( p0, p1, 0x31 ) );
+            _mm256_storeu_si256( &p_out[3],
+                                 _mm256_permute2x128_si256( p2, p3, 0x31 ) );
+        }
+        else
+        {
+            const __m256i max = _mm256_set1_epi16( 255 );
+            const __m256i mask_g = _mm256_set1_epi16( i_format == RGB_RV16
+                                                      ? 0xfc : 0xf8 );
+            const int i_shift_r = i_format == RGB_RV16 ? 8 : 7;
+            const int i_shift_g = i_format == RGB_RV16 ? 3 : 2;
+            __m256i *p_out = (__m256i *)&p_dst[2 * x];
+            __m256i pp_rgb[2][3] = { { r0, g0, b0 }, { r1, g1, b1 } };
+
+            for( int i = 0; i < 2; i++ )
+            {
+                __m256i r = _mm256_min_epi16( _mm256_max_epi16( pp_rgb[i][0], zero ), max );
+                __m256i g = _mm256_min_epi16( _mm256_max_epi16( pp_rgb[i][1], zero ), max );
+                __m256i b = _mm256_min_epi16( _mm256_max_epi16( pp_rgb[i][2], zero ), max );
+
+                r = _mm256_sll_epi16( _mm256_and_si256( r, _mm256_set1_epi16( 0xf8 ) ),
+                                      _mm_cvtsi32_si128( i_shift_r ) );
+                g = _mm256_sll_epi16( _mm256_and_si256( g, mask_g ),
+                                      _mm_cvtsi32_si128( i_shift_g ) );
+                b = _mm256_srli_epi16( b, 3 );
+                _mm256_storeu_si256( &p_out[i],
+                                     _mm256_or_si256( _mm256_or_si256( r, g ), b ) );
+            }
+        }
+    }
+
+    /* The SSE2 code finishes the line */
+    const unsigned i_chroma = p_v == NULL ? x : x / 2;
+    RowSSE2( m, i_format, &p_dst[x * (i_format <= RGB_RV32_BGR ? 4 : 2)],
+             &p_y[x], &p_u[i_chroma], p_v ? &p_v[i_chroma] : NULL,
+             i_width - x );
+    _mm256_zeroupper();
+}
+
+#define ROW_FUNCTION_AVX2( name, format ) \
+    VLC_AVX2 ROW_FUNCTION( name, AVX2, format )
+
+ROW_FUNCTION_AVX2( RowRV32_AVX2,    RGB_RV32 )
+ROW_FUNCTION_AVX2( RowRV32BGR_AVX2, RGB_RV32_BGR )
+ROW_FUNCTION_AVX2( RowRV16_AVX2,    RGB_RV16 )
+ROW_FUNCTION_AVX2( RowRV15_AVX2,    RGB_RV15 )
+#endif
+
+/*****************************************************************************
+ * Conversion of the whole picture
+ *****************************************************************************/
+static void ConvertLines( filter_t *p_filter, picture_t *p_src,
+                          picture_t *p_dst, unsigned i_first, unsigned i_last )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const plane_t *p_u = &p_src->p[p_sys->b_swap_uv ? V_PLANE : U_PLANE];
+    const plane_t *p_v = &p_src->p[p_sys->b_swap_uv ? U_PLANE : V_PLANE];
+
+    for( unsigned y = i_first; y < i_last; y++ )
+    {
+        const unsigned i_chroma_line = y >> p_sys->i_chroma_shift;
+
+        p_sys->pf_row( &p_sys->matrix,
+                       &p_dst->p[0].p_pixels[y * p_dst->p[0].i_pitch],
+                       &p_src->p[Y_PLANE].p_pixels[y * p_src->p[Y_PLANE].i_pitch],
+                       &p_u->p_pixels[i_chroma_line * p_u->i_pitch],
+                       p_sys->b_semiplanar ? NULL
+                           : &p_v->p_pixels[i_chroma_line * p_v->i_pitch],
+                       p_filter->fmt_in.video.i_width );
+    }
+}
+
+typedef struct
+{
+    filter_t  *p_filter;
+    picture_t *p_src;
+    picture_t *p_dst;
+} convert_job_t;
+
+static void ConvertSlice( void *p_data, unsigned i_slice )
+{
+    convert_job_t *p_job = p_data;
+    filter_sys_t *p_sys = p_job->p_filter->p_sys;
+    unsigned i_first, i_last;
+
+    SlicesGetBand( p_job->p_filter->fmt_in.video.i_height, 2,
+                   SlicesCount( p_sys->p_slices ), i_slice,
+                   &i_first, &i_last );
+    ConvertLines( p_job->p_filter, p_job->p_src, p_job->p_dst,
+                  i_first, i_last );
+}
+
+static void Convert( filter_t *p_filter, picture_t *p_src, picture_t *p_dst )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->p_slices != NULL )
+    {
+        convert_job_t job = { p_filter, p_src, p_dst };
+        SlicesRun( p_sys->p_slices, ConvertSlice, &job );
+    }
+    else
+        ConvertLines( p_filter, p_src, p_dst,
+                      0, p_filter->fmt_in.video.i_height );
+}
+
+VIDEO_FILTER_WRAPPER( Convert )
+
+/* Sets the matrix up from the Kr and Kb constants of the color space */
+static void SetMatrix( yuv_matrix_t *m, double kr, double kb, bool b_full )
+{
+    const double ky = b_full ? 1. : 255. / 219.;
+    const double kc = b_full ? 1. : 255. / 224.;
+    const double kg = 1. - kr - kb;
+
+    m->y_offset = b_full ? 0 : 16;
+    m->y  = lround( 4096. * ky );
+    m->vr = lround( 4096. * kc * 2. * ( 1. - kr ) );
+    m->ug = lround( -4096. * kc * 2. * ( 1. - kb ) * kb / kg );
+    m->vg = lround( -4096. * kc * 2. * ( 1. - kr ) * kr / kg );
+    m->ub = lround( 4096. * kc * 2. * ( 1. - kb ) );
+}
+
+/*****************************************************************************
+ * Activate: allocate a chroma function
+ *****************************************************************************/
+static int Activate( vlc_object_t *p_this )
+{
+#if defined (__SSE2__)
+    filter_t *p_filter = (filter_t *)p_this;
+    const video_format_t *p_in = &p_filter->fmt_in.video;
+    const video_format_t *p_out = &p_filter->fmt_out.video;
+    bool b_full = false, b_semiplanar = false, b_swap_uv = false;
+    unsigned i_chroma_shift = 1;
+    int i_format;
+
+    if( !(vlc_CPU() & CPU_CAPABILITY_SSE2) )
+        return VLC_EGENERIC;
+
+    /* No scaling nor cropping */
+    if( p_in->i_width != p_out->i_width || p_in->i_height != p_out->i_height
+     || ( p_in->i_width & 1 ) )
+        return VLC_EGENERIC;
+
+    switch( p_in->i_chroma )
+    {
+        case VLC_CODEC_J420:
+            b_full = true;
+            /* fall through */
+        case VLC_CODEC_I420:
+            break;
+        case VLC_CODEC_YV12:
+            b_swap_uv = true;
+            break;
+        case VLC_CODEC_NV12:
+            b_semiplanar = true;
+            break;
+        case VLC_CODEC_J422:
+            b_full = true;
+            /* fall through */
+        case VLC_CODEC_I422:
+            i_chroma_shift = 0;
+            break;
+        default:
+            return VLC_EGENERIC;
+    }
+    if( i_chroma_shift && ( p_in->i_height & 1 ) )
+        return VLC_EGENERIC;
+
+    switch( p_out->i_chroma )
+    {
+        case VLC_CODEC_RGB32:
+            if( p_out->i_rmask == 0x00ff0000 && p_out->i_gmask == 0x0000ff00
+             && p_out->i_bmask == 0x000000ff )
+                i_format = RGB_RV32;
+            else if( p_out->i_rmask == 0x000000ff
+                  && p_out->i_gmask == 0x0000ff00
+                  && p_out->i_bmask == 0x00ff0000 )
+                i_format = RGB_RV32_BGR;
+            else
+                return VLC_EGENERIC;
+            break;
+        case VLC_CODEC_RGB16:
+            if( p_out->i_rmask != 0xf800 || p_out->i_gmask != 0x07e0
+             || p_out->i_bmask != 0x001f )
+                return VLC_EGENERIC;
+            i_format = RGB_RV16;
+            break;
+        case VLC_CODEC_RGB15:
+            if( p_out->i_rmask != 0x7c00 || p_out->i_gmask != 0x03e0
+             || p_out->i_bmask != 0x001f )
+                return VLC_EGENERIC;
+            i_format = RGB_RV15;
+            break;
+        default:
+            return VLC_EGENERIC;
+    }
+
+    filter_sys_t *p_sys = malloc( sizeof( *p_sys ) );
+    if( unlikely(p_sys == NULL) )
+        return VLC_ENOMEM;
+
+    /* The format tells no color space: assume BT.709 for HD */
+    const bool b_hd = p_in->i_height > 576;
+    if( b_hd )
+        SetMatrix( &p_sys->matrix, 0.2126, 0.0722, b_full );
+    else
+        SetMatrix( &p_sys->matrix, 0.299, 0.114, b_full );
+    p_sys->b_semiplanar = b_semiplanar;
+    p_sys->b_swap_uv = b_swap_uv;
+    p_sys->i_chroma_shift = i_chroma_shift;
+    p_sys->p_slices = SlicesNew( p_this, p_in->i_height );
+
+    static const yuv_row_t pf_sse2[] = {
+        RowRV32_SSE2, RowRV32BGR_SSE2, RowRV16_SSE2, RowRV15_SSE2 };
+    p_sys->pf_row = pf_sse2[i_format];
+#if defined (CAN_COMPILE_AVX2)
+    static const yuv_row_t pf_avx2[] = {
+        RowRV32_AVX2, RowRV32BGR_AVX2, RowRV16_AVX2, RowRV15_AVX2 };
+    if( vlc_CPU() & CPU_CAPABILITY_AVX2 )
+        p_sys->pf_row = pf_avx2[i_format];
+#endif
+
+    msg_Dbg( p_filter, "%4.4s to %4.4s with %s, BT.%s %s range",
+             (const char *)&p_in->i_chroma, (const char *)&p_out->i_chroma,
+             p_sys->pf_row == pf_sse2[i_format] ? "SSE2" : "AVX2",
+             b_hd ? "709" : "601", b_full ? "full" : "limited" );
+
+    p_filter->p_sys = p_sys;
+    p_filter->pf_video_filter = Convert_Filter;
+    return VLC_SUCCESS;
+#else
+    VLC_UNUSED(p_this);
+    return VLC_EGENERIC;
+#endif
+}
+
+static void Deactivate( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->p_slices != NULL )
+        SlicesDelete( p_sys->p_slices );
+    free( p_sys );
+}
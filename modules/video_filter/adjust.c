@@ -182,6 +182,8 @@ static int Create( vlc_object_t *p_this )
                      (char*)&(p_filter->fmt_in.video.i_chroma) );
             return VLC_EGENERIC;
     }
+    /* Only point operations: the input picture can be overwritten */
+    p_filter->b_video_inplace = true;
 
     vlc_mutex_init( &p_sys->lock );
     var_AddCallback( p_filter, "contrast",   AdjustCallback, p_sys );
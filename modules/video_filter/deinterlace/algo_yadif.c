@@ -34,7 +34,7 @@
 #include <vlc_picture.h>
 #include <vlc_filter.h>
 
-#include "deinterlace.h" /* filter_sys_t  */
+#include "deinterlace.h" /* filter_sys_t, slices  */
 #include "common.h"      /* FFMIN3 et al. */
 
 #include "algo_yadif.h"
@@ -47,6 +47,87 @@
    Necessary preprocessor macros are defined in common.h. */
 #include "yadif.h"
 
+typedef void (*yadif_filter_t)(uint8_t *dst, uint8_t *prev, uint8_t *cur,
+                               uint8_t *next, int w, int prefs, int mrefs,
+                               int parity, int mode);
+
+/* What the rendering of a picture needs, for every band */
+typedef struct
+{
+    filter_t      *p_filter;
+    picture_t     *p_dst;
+    picture_t     *p_prev;
+    picture_t     *p_cur;
+    picture_t     *p_next;
+    int            i_field;
+    int            i_parity;
+    yadif_filter_t pf_filter;
+} yadif_job_t;
+
+/* Renders the lines of the band i_slice out of i_count, in all planes */
+static void RenderYadifBand( const yadif_job_t *p_job,
+                             unsigned i_slice, unsigned i_count )
+{
+    const int i_field = p_job->i_field;
+    const int yadif_parity = p_job->i_parity;
+
+    for( int n = 0; n < p_job->p_dst->i_planes; n++ )
+    {
+        const plane_t *prevp = &p_job->p_prev->p[n];
+        const plane_t *curp  = &p_job->p_cur->p[n];
+        const plane_t *nextp = &p_job->p_next->p[n];
+        plane_t *dstp        = &p_job->p_dst->p[n];
+        unsigned i_first, i_last;
+
+        SlicesGetBand( dstp->i_visible_lines, 2, i_count, i_slice,
+                       &i_first, &i_last );
+        for( int y = __MAX( (int)i_first, 1 );
+             y < __MIN( (int)i_last, dstp->i_visible_lines - 1 ); y++ )
+        {
+            if( (y % 2) == i_field  ||  yadif_parity == 2 )
+            {
+                vlc_memcpy( &dstp->p_pixels[y * dstp->i_pitch],
+                            &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
+            }
+            else
+            {
+                int mode;
+                /* Spatial checks only when enough data */
+                mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
+
+                assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
+                p_job->pf_filter( &dstp->p_pixels[y * dstp->i_pitch],
+                                  &prevp->p_pixels[y * prevp->i_pitch],
+                                  &curp->p_pixels[y * curp->i_pitch],
+                                  &nextp->p_pixels[y * nextp->i_pitch],
+                                  dstp->i_visible_pitch,
+                                  y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
+                                  y  - 1  ?  -curp->i_pitch : curp->i_pitch,
+                                  yadif_parity,
+                                  mode );
+            }
+
+            /* We duplicate the first and last lines */
+            if( y == 1 )
+                vlc_memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
+                           &dstp->p_pixels[ y    * dstp->i_pitch],
+                           dstp->i_pitch);
+            else if( y == dstp->i_visible_lines - 2 )
+                vlc_memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
+                           &dstp->p_pixels[ y    * dstp->i_pitch],
+                           dstp->i_pitch);
+        }
+    }
+}
+
+static void RenderYadifSlice( void *p_data, unsigned i_slice )
+{
+    const yadif_job_t *p_job = p_data;
+
+    RenderYadifBand( p_job, i_slice,
+                     SlicesCount( p_job->p_filter->p_sys->p_slices ) );
+}
+
 int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
                  int i_order, int i_field )
 {
@@ -104,11 +185,7 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
     /* Filter if we have all the pictures we need */
     if( p_prev && p_cur && p_next )
     {
-        /* */
-        void (*filter)(uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next,
-                       int w, int prefs, int mrefs, int parity, int mode);
-
-        filter = yadif_filter_line_c;
+        yadif_filter_t filter = yadif_filter_line_c;
 #if defined(HAVE_YADIF_MMX)
         if( vlc_CPU() & CPU_CAPABILITY_MMX )
             filter = yadif_filter_line_mmx;
@@ -121,50 +198,21 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
         if( vlc_CPU() & CPU_CAPABILITY_SSSE3 )
             filter = yadif_filter_line_ssse3;
 #endif
+#if defined(HAVE_YADIF_AVX2)
+        if( vlc_CPU() & CPU_CAPABILITY_AVX2 )
+            filter = yadif_filter_line_avx2;
+#endif
 
-        for( int n = 0; n < p_dst->i_planes; n++ )
-        {
-            const plane_t *prevp = &p_prev->p[n];
-            const plane_t *curp  = &p_cur->p[n];
-            const plane_t *nextp = &p_next->p[n];
-            plane_t *dstp        = &p_dst->p[n];
-
-            for( int y = 1; y < dstp->i_visible_lines - 1; y++ )
-            {
-                if( (y % 2) == i_field  ||  yadif_parity == 2 )
-                {
-                    vlc_memcpy( &dstp->p_pixels[y * dstp->i_pitch],
-                                &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
-                }
-                else
-                {
-                    int mode;
-                    /* Spatial checks only when enough data */
-                    mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
-
-                    assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
-                    filter( &dstp->p_pixels[y * dstp->i_pitch],
-                            &prevp->p_pixels[y * prevp->i_pitch],
-                            &curp->p_pixels[y * curp->i_pitch],
-                            &nextp->p_pixels[y * nextp->i_pitch],
-                            dstp->i_visible_pitch,
-                            y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
-                            y  - 1  ?  -curp->i_pitch : curp->i_pitch,
-                            yadif_parity,
-                            mode );
-                }
-
-                /* We duplicate the first and last lines */
-                if( y == 1 )
-                    vlc_memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-                else if( y == dstp->i_visible_lines - 2 )
-                    vlc_memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-            }
-        }
+        yadif_job_t job = {
+            .p_filter = p_filter, .p_dst = p_dst,
+            .p_prev = p_prev, .p_cur = p_cur, .p_next = p_next,
+            .i_field = i_field, .i_parity = yadif_parity,
+            .pf_filter = filter,
+        };
+        if( p_sys->p_slices != NULL )
+            SlicesRun( p_sys->p_slices, RenderYadifSlice, &job );
+        else
+            RenderYadifBand( &job, 0, 1 );
 
         p_sys->i_frame_offset = 1; /* p_cur will be rendered at next frame, too */
 
@@ -647,6 +647,7 @@ int Open( vlc_object_t *p_this )
                                   cannot have offset) */
     for( int i = 0; i < HISTORY_SIZE; i++ )
         p_sys->pp_history[i] = NULL;
+    p_sys->p_slices = NULL;
 
     IVTCClearState( p_filter );
 
@@ -739,6 +740,10 @@ int Open( vlc_object_t *p_this )
         p_sys->phosphor.i_dimmer_strength = 1;
     }
 
+    if( p_sys->i_mode == DEINTERLACE_YADIF ||
+        p_sys->i_mode == DEINTERLACE_YADIF2X )
+        p_sys->p_slices = SlicesNew( p_this, p_filter->fmt_in.video.i_height );
+
     /* */
     video_format_t fmt;
     GetOutputFormat( p_filter, &fmt, &p_filter->fmt_in.video );
@@ -769,5 +774,7 @@ void Close( vlc_object_t *p_this )
     filter_t *p_filter = (filter_t*)p_this;
 
     Flush( p_filter );
+    if( p_filter->p_sys->p_slices != NULL )
+        SlicesDelete( p_filter->p_sys->p_slices );
     free( p_filter->p_sys );
 }
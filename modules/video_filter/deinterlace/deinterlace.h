@@ -36,6 +36,8 @@ struct vlc_object_t;
 #include <vlc_common.h>
 #include <vlc_mouse.h>
 
+#include "../../video_chroma/slices.h"
+
 /* Local algorithm headers */
 #include "algo_basic.h"
 #include "algo_x.h"
@@ -114,6 +116,9 @@ struct filter_sys_t
     /** Input frame history buffer for algorithms with temporal filtering. */
     picture_t *pp_history[HISTORY_SIZE];
 
+    /** Threads rendering the pictures by bands (Yadif), or NULL */
+    filter_slices_t *p_slices;
+
     /* Algorithm-specific substructures */
     phosphor_sys_t phosphor; /**< Phosphor algorithm state. */
     ivtc_sys_t ivtc;         /**< IVTC algorithm state. */
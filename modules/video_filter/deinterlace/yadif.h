@@ -139,3 +139,121 @@ static void yadif_filter_line_c(uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8
     }
 }
 
+
+#if defined(CAN_COMPILE_AVX2) && VLC_GCC_VERSION(4, 9)
+// ================ AVX2 =================
+/* Same computations as yadif_filter_line_c(), 16 pixels at a time on
+ * 16 bits samples, so that the results are the same. */
+#include <immintrin.h>
+#define HAVE_YADIF_AVX2
+
+VLC_AVX2
+static inline __m256i yadif_load_avx2(const uint8_t *p)
+{
+    return _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)p));
+}
+
+VLC_AVX2
+static inline __m256i yadif_absdiff_avx2(__m256i a, __m256i b)
+{
+    return _mm256_abs_epi16(_mm256_sub_epi16(a, b));
+}
+
+/* CHECK(j) for the pixels selected by mask, returns the improved ones */
+VLC_AVX2
+static inline __m256i yadif_check_avx2(const uint8_t *cur, int mrefs, int prefs,
+                                       int j, __m256i mask,
+                                       __m256i *score, __m256i *pred)
+{
+    const __m256i m = yadif_load_avx2(&cur[mrefs+j]);
+    const __m256i p = yadif_load_avx2(&cur[prefs-j]);
+    __m256i s = yadif_absdiff_avx2(yadif_load_avx2(&cur[mrefs-1+j]),
+                                   yadif_load_avx2(&cur[prefs-1-j]));
+    s = _mm256_add_epi16(s, yadif_absdiff_avx2(m, p));
+    s = _mm256_add_epi16(s, yadif_absdiff_avx2(yadif_load_avx2(&cur[mrefs+1+j]),
+                                               yadif_load_avx2(&cur[prefs+1-j])));
+
+    const __m256i better = _mm256_and_si256(mask, _mm256_cmpgt_epi16(*score, s));
+    *score = _mm256_blendv_epi8(*score, s, better);
+    *pred = _mm256_blendv_epi8(*pred,
+                               _mm256_srli_epi16(_mm256_add_epi16(m, p), 1),
+                               better);
+    return better;
+}
+
+VLC_AVX2
+static void yadif_filter_line_avx2(uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next, int w, int prefs, int mrefs, int parity, int mode) {
+    uint8_t *prev2= parity ? prev : cur ;
+    uint8_t *next2= parity ? cur  : next;
+    const __m256i all = _mm256_set1_epi16(-1);
+    int x;
+
+    for(x=0; x+16<=w; x+=16){
+        const __m256i c = yadif_load_avx2(&cur[x+mrefs]);
+        const __m256i e = yadif_load_avx2(&cur[x+prefs]);
+        const __m256i p2 = yadif_load_avx2(&prev2[x]);
+        const __m256i n2 = yadif_load_avx2(&next2[x]);
+        const __m256i d = _mm256_srli_epi16(_mm256_add_epi16(p2, n2), 1);
+
+        __m256i temporal_diff0 = yadif_absdiff_avx2(p2, n2);
+        __m256i temporal_diff1 = _mm256_srli_epi16(_mm256_add_epi16(
+            yadif_absdiff_avx2(yadif_load_avx2(&prev[x+mrefs]), c),
+            yadif_absdiff_avx2(yadif_load_avx2(&prev[x+prefs]), e)), 1);
+        __m256i temporal_diff2 = _mm256_srli_epi16(_mm256_add_epi16(
+            yadif_absdiff_avx2(yadif_load_avx2(&next[x+mrefs]), c),
+            yadif_absdiff_avx2(yadif_load_avx2(&next[x+prefs]), e)), 1);
+        __m256i diff = _mm256_max_epi16(_mm256_max_epi16(
+            _mm256_srli_epi16(temporal_diff0, 1), temporal_diff1), temporal_diff2);
+
+        __m256i spatial_pred = _mm256_srli_epi16(_mm256_add_epi16(c, e), 1);
+        __m256i spatial_score = yadif_absdiff_avx2(yadif_load_avx2(&cur[x+mrefs-1]),
+                                                   yadif_load_avx2(&cur[x+prefs-1]));
+        spatial_score = _mm256_add_epi16(spatial_score, yadif_absdiff_avx2(c, e));
+        spatial_score = _mm256_add_epi16(spatial_score,
+                            yadif_absdiff_avx2(yadif_load_avx2(&cur[x+mrefs+1]),
+                                               yadif_load_avx2(&cur[x+prefs+1])));
+        spatial_score = _mm256_sub_epi16(spatial_score, _mm256_set1_epi16(1));
+
+        /* CHECK(-2) and CHECK(2) only where CHECK(-1) and CHECK(1) improved */
+        __m256i better;
+        better = yadif_check_avx2(&cur[x], mrefs, prefs, -1, all,
+                                  &spatial_score, &spatial_pred);
+        yadif_check_avx2(&cur[x], mrefs, prefs, -2, better,
+                         &spatial_score, &spatial_pred);
+        better = yadif_check_avx2(&cur[x], mrefs, prefs, 1, all,
+                                  &spatial_score, &spatial_pred);
+        yadif_check_avx2(&cur[x], mrefs, prefs, 2, better,
+                         &spatial_score, &spatial_pred);
+
+        if(mode<2){
+            const __m256i b = _mm256_srli_epi16(_mm256_add_epi16(
+                yadif_load_avx2(&prev2[x+2*mrefs]), yadif_load_avx2(&next2[x+2*mrefs])), 1);
+            const __m256i f = _mm256_srli_epi16(_mm256_add_epi16(
+                yadif_load_avx2(&prev2[x+2*prefs]), yadif_load_avx2(&next2[x+2*prefs])), 1);
+            const __m256i dc = _mm256_sub_epi16(d, c);
+            const __m256i de = _mm256_sub_epi16(d, e);
+            const __m256i bc = _mm256_sub_epi16(b, c);
+            const __m256i fe = _mm256_sub_epi16(f, e);
+            const __m256i max = _mm256_max_epi16(_mm256_max_epi16(de, dc),
+                                                 _mm256_min_epi16(bc, fe));
+            const __m256i min = _mm256_min_epi16(_mm256_min_epi16(de, dc),
+                                                 _mm256_max_epi16(bc, fe));
+
+            diff = _mm256_max_epi16(_mm256_max_epi16(diff, min),
+                                    _mm256_sub_epi16(_mm256_setzero_si256(), max));
+        }
+
+        /* diff is never negative */
+        spatial_pred = _mm256_max_epi16(spatial_pred, _mm256_sub_epi16(d, diff));
+        spatial_pred = _mm256_min_epi16(spatial_pred, _mm256_add_epi16(d, diff));
+
+        _mm_storeu_si128((__m128i *)&dst[x],
+                         _mm_packus_epi16(_mm256_castsi256_si128(spatial_pred),
+                                          _mm256_extracti128_si256(spatial_pred, 1)));
+    }
+    _mm256_zeroupper();
+
+    yadif_filter_line_c(&dst[x], &prev[x], &cur[x], &next[x], w-x,
+                        prefs, mrefs, parity, mode);
+}
+#endif
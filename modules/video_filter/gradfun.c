@@ -34,6 +34,8 @@
 #include <vlc_cpu.h>
 #include <vlc_filter.h>
 
+#include "../video_chroma/slices.h"
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -104,8 +106,18 @@ struct filter_sys_t {
     int              radius;
     const vlc_chroma_description_t *chroma;
     struct vf_priv_s cfg;
+    size_t           buf_size;  /* per band, in samples */
+    filter_slices_t *slices;
 };
 
+/* What the filtering of a picture needs, for every band */
+typedef struct {
+    filter_sys_t        *sys;
+    const video_format_t *fmt;
+    picture_t           *dst;
+    picture_t           *src;
+} gradfun_job_t;
+
 static int Open(vlc_object_t *object)
 {
     filter_t *filter = (filter_t *)object;
@@ -128,6 +140,8 @@ static int Open(vlc_object_t *object)
     var_AddCallback(filter, CFG_PREFIX "strength", Callback, NULL);
     var_AddCallback(filter, CFG_PREFIX "radius",   Callback, NULL);
     sys->cfg.buf = NULL;
+    sys->buf_size = 0;
+    sys->slices = SlicesNew(object, filter->fmt_in.video.i_height);
 
     struct vf_priv_s *cfg = &sys->cfg;
     cfg->thresh      = 0.0;
@@ -144,6 +158,10 @@ static int Open(vlc_object_t *object)
     if (vlc_CPU() & CPU_CAPABILITY_MMXEXT)
         cfg->filter_line = filter_line_mmx2;
 #endif
+#if HAVE_SSE2
+    if (vlc_CPU() & CPU_CAPABILITY_SSE2)
+        cfg->filter_line = filter_line_sse2;
+#endif
 #if HAVE_SSSE3
     if (vlc_CPU() & CPU_CAPABILITY_SSSE3)
         cfg->filter_line = filter_line_ssse3;
@@ -161,11 +179,57 @@ static void Close(vlc_object_t *object)
 
     var_DelCallback(filter, CFG_PREFIX "radius",   Callback, NULL);
     var_DelCallback(filter, CFG_PREFIX "strength", Callback, NULL);
+    if (sys->slices)
+        SlicesDelete(sys->slices);
     vlc_free(sys->cfg.buf);
     vlc_mutex_destroy(&sys->lock);
     free(sys);
 }
 
+/* Filters the rows of the band slice out of count, in all planes. Every
+ * band keeps its running blur in its own part of the buffer. */
+static void FilterBand(const gradfun_job_t *job, unsigned slice, unsigned count)
+{
+    filter_sys_t *sys = job->sys;
+    const video_format_t *fmt = job->fmt;
+    struct vf_priv_s *cfg = &sys->cfg;
+    uint16_t *buffer = cfg->buf + slice * sys->buf_size;
+
+    for (int i = 0; i < job->dst->i_planes; i++) {
+        const plane_t *srcp = &job->src->p[i];
+        plane_t       *dstp = &job->dst->p[i];
+
+        const vlc_chroma_description_t *chroma = sys->chroma;
+        int w = fmt->i_width  * chroma->p[i].w.num / chroma->p[i].w.den;
+        int h = fmt->i_height * chroma->p[i].h.num / chroma->p[i].h.den;
+        int r = (cfg->radius  * chroma->p[i].w.num / chroma->p[i].w.den +
+                 cfg->radius  * chroma->p[i].h.num / chroma->p[i].h.den) / 2;
+        r = VLC_CLIP((r + 1) & ~1, RADIUS_MIN, RADIUS_MAX);
+        if (__MIN(w, h) > 2 * r && cfg->buf) {
+            unsigned first, last;
+
+            /* The rows above r+2 belong to the first band */
+            SlicesGetBand(h, 2, count, slice, &first, &last);
+            if (slice > 0)
+                first = __MAX(first, (unsigned)r + 2);
+            last = __MIN((unsigned)h, __MAX(last, (unsigned)r + 2));
+            if (first < last)
+                filter_plane(cfg, buffer, dstp->p_pixels, srcp->p_pixels,
+                             w, h, dstp->i_pitch, srcp->i_pitch, r,
+                             first, last);
+        } else if (slice == 0) {
+            plane_CopyPixels(dstp, srcp);
+        }
+    }
+}
+
+static void FilterSlice(void *data, unsigned slice)
+{
+    const gradfun_job_t *job = data;
+
+    FilterBand(job, slice, SlicesCount(job->sys->slices));
+}
+
 static picture_t *Filter(filter_t *filter, picture_t *src)
 {
     filter_sys_t *sys = filter->p_sys;
@@ -186,28 +250,20 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
 
     cfg->thresh = (1 << 15) / strength;
     if (cfg->radius != radius) {
+        const unsigned count = sys->slices ? SlicesCount(sys->slices) : 1;
+
         cfg->radius = radius;
-        cfg->buf    = vlc_memalign(16,
-                                   (((fmt->i_width + 15) & ~15) * (cfg->radius + 1) / 2 + 32) * sizeof(*cfg->buf));
+        /* Keep every band 16 bytes aligned */
+        sys->buf_size = ((((fmt->i_width + 15) & ~15) * (cfg->radius + 1) / 2 + 32) + 7) & ~7;
+        vlc_free(cfg->buf);
+        cfg->buf    = vlc_memalign(16, count * sys->buf_size * sizeof(*cfg->buf));
     }
 
-    for (int i = 0; i < dst->i_planes; i++) {
-        const plane_t *srcp = &src->p[i];
-        plane_t       *dstp = &dst->p[i];
-
-        const vlc_chroma_description_t *chroma = sys->chroma;
-        int w = fmt->i_width  * chroma->p[i].w.num / chroma->p[i].w.den;
-        int h = fmt->i_height * chroma->p[i].h.num / chroma->p[i].h.den;
-        int r = (cfg->radius  * chroma->p[i].w.num / chroma->p[i].w.den +
-                 cfg->radius  * chroma->p[i].h.num / chroma->p[i].h.den) / 2;
-        r = VLC_CLIP((r + 1) & ~1, RADIUS_MIN, RADIUS_MAX);
-        if (__MIN(w, h) > 2 * r && cfg->buf) {
-            filter_plane(cfg, dstp->p_pixels, srcp->p_pixels,
-                         w, h, dstp->i_pitch, srcp->i_pitch, r);
-        } else {
-            plane_CopyPixels(dstp, srcp);
-        }
-    }
+    gradfun_job_t job = { sys, fmt, dst, src };
+    if (sys->slices)
+        SlicesRun(sys->slices, FilterSlice, &job);
+    else
+        FilterBand(&job, 0, 1);
 
     picture_CopyProperties(dst, src);
     picture_Release(src);
@@ -127,6 +127,56 @@ static void filter_line_mmx2(uint8_t *dst, uint8_t *src, uint16_t *dc,
 }
 #endif
 
+#if HAVE_SSE2
+VLC_SSE
+static void filter_line_sse2(uint8_t *dst, uint8_t *src, uint16_t *dc,
+                             int width, int thresh, const uint16_t *dithers)
+{
+    intptr_t x;
+    if (width&7) {
+        x = width&~7;
+        filter_line_c(dst+x, src+x, dc+x/2, width-x, thresh, dithers);
+        width = x;
+    }
+    x = -width;
+    __asm__ volatile(
+        "movd           %4, %%xmm5 \n"
+        "pxor       %%xmm7, %%xmm7 \n"
+        "pshuflw $0,%%xmm5, %%xmm5 \n"
+        "movdqa         %6, %%xmm6 \n"
+        "punpcklqdq %%xmm5, %%xmm5 \n"
+        "movdqa         %5, %%xmm4 \n"
+        "1: \n"
+        "movq      (%2,%0), %%xmm0 \n"
+        "movq      (%3,%0), %%xmm1 \n"
+        "punpcklbw  %%xmm7, %%xmm0 \n"
+        "punpcklwd  %%xmm1, %%xmm1 \n"
+        "psllw          $7, %%xmm0 \n"
+        "pxor       %%xmm2, %%xmm2 \n"
+        "psubw      %%xmm0, %%xmm1 \n" // delta = dc - pix
+        "psubw      %%xmm1, %%xmm2 \n"
+        "pmaxsw     %%xmm1, %%xmm2 \n"
+        "pmulhuw    %%xmm5, %%xmm2 \n" // m = abs(delta) * thresh >> 16
+        "psubw      %%xmm6, %%xmm2 \n"
+        "pminsw     %%xmm7, %%xmm2 \n" // m = -max(0, 127-m)
+        "pmullw     %%xmm2, %%xmm2 \n"
+        "paddw      %%xmm4, %%xmm0 \n" // pix += dither
+        "pmulhw     %%xmm2, %%xmm1 \n"
+        "psllw          $2, %%xmm1 \n" // m = m*m*delta >> 14
+        "paddw      %%xmm1, %%xmm0 \n" // pix += m
+        "psraw          $7, %%xmm0 \n"
+        "packuswb   %%xmm0, %%xmm0 \n"
+        "movq       %%xmm0, (%1,%0) \n" // dst = clip(pix>>7)
+        "add            $8, %0 \n"
+        "jl 1b \n"
+        :"+&r"(x)
+        :"r"(dst+width), "r"(src+width), "r"(dc+width/2),
+         "rm"(thresh), "m"(*dithers), "m"(*pw_7f)
+        :"xmm0", "xmm1", "xmm2", "xmm4", "xmm5", "xmm6", "xmm7", "memory"
+    );
+}
+#endif // HAVE_SSE2
+
 #if HAVE_SSSE3
 VLC_SSE
 static void filter_line_ssse3(uint8_t *dst, uint8_t *src, uint16_t *dc,
@@ -222,45 +272,72 @@ static void blur_line_sse2(uint16_t *dc, uint16_t *buf, uint16_t *buf1,
 }
 #endif // HAVE_6REGS && HAVE_SSE2
 
-static void filter_plane(struct vf_priv_s *ctx, uint8_t *dst, uint8_t *src,
-                         int width, int height, int dstride, int sstride, int r)
+/* Updates the vertical then horizontal blur in dc for the rows y and y+1 */
+static void blur_step(struct vf_priv_s *ctx, uint16_t *dc, uint16_t *buf,
+                      uint8_t *src, int width, int sstride, int r, int y)
 {
     int bstride = ((width+15)&~15)/2;
-    int y;
     uint32_t dc_factor = (1<<21)/(r*r);
-    uint16_t *dc = ctx->buf+16;
-    uint16_t *buf = ctx->buf+bstride+32;
+    int mod = ((y+r)/2)%r;
+    uint16_t *buf0 = buf+mod*bstride;
+    uint16_t *buf1 = buf+(mod?mod-1:r-1)*bstride;
+    int x, v;
+    ctx->blur_line(dc, buf0, buf1, src+(y+r)*sstride, sstride, width/2);
+    for (x=v=0; x<r; x++)
+        v += dc[x];
+    for (; x<width/2; x++) {
+        v += dc[x] - dc[x-r];
+        dc[x-r] = v * dc_factor >> 16;
+    }
+    for (; x<(width+r+1)/2; x++)
+        dc[x-r] = v * dc_factor >> 16;
+    for (x=-r/2; x<0; x++)
+        dc[x] = dc[0];
+}
+
+/* Filters the rows [y_start, y_end) of a plane, with its own blur buffer.
+ * Past the first band, y_start must be even and above r+1. */
+static void filter_plane(struct vf_priv_s *ctx, uint16_t *buffer,
+                         uint8_t *dst, uint8_t *src,
+                         int width, int height, int dstride, int sstride, int r,
+                         int y_start, int y_end)
+{
+    int bstride = ((width+15)&~15)/2;
+    int y;
+    uint16_t *dc = buffer+16;
+    uint16_t *buf = buffer+bstride+32;
     int thresh = ctx->thresh;
 
     memset(dc, 0, (bstride+16)*sizeof(*buf));
-    for (y=0; y<r; y++)
-        ctx->blur_line(dc, buf+y*bstride, buf+(y-1)*bstride, src+2*y*sstride, sstride, width/2);
+    if (y_start == 0) {
+        for (y=0; y<r; y++)
+            ctx->blur_line(dc, buf+y*bstride, buf+(y-1)*bstride, src+2*y*sstride, sstride, width/2);
+    } else {
+        /* Only the differences between the running sums are used: rebuild
+         * the last r-1 row pairs on top of a zero sum, as the previous band
+         * left them */
+        int y_last = r + (height-2*r-1)/2*2;
+        int yd = __MIN(y_start, y_last);
+        int p0 = (yd+r)/2 - r;
+
+        memset(buf+(p0%r)*bstride, 0, bstride*sizeof(*buf));
+        for (int p=p0+1; p<p0+r; p++)
+            ctx->blur_line(dc, buf+(p%r)*bstride, buf+((p-1)%r)*bstride, src+2*p*sstride, sstride, width/2);
+        if (yd < y_start)
+            blur_step(ctx, dc, buf, src, width, sstride, r, yd);
+        y = y_start;
+    }
     for (;;) {
-        if (y < height-r) {
-            int mod = ((y+r)/2)%r;
-            uint16_t *buf0 = buf+mod*bstride;
-            uint16_t *buf1 = buf+(mod?mod-1:r-1)*bstride;
-            int x, v;
-            ctx->blur_line(dc, buf0, buf1, src+(y+r)*sstride, sstride, width/2);
-            for (x=v=0; x<r; x++)
-                v += dc[x];
-            for (; x<width/2; x++) {
-                v += dc[x] - dc[x-r];
-                dc[x-r] = v * dc_factor >> 16;
-            }
-            for (; x<(width+r+1)/2; x++)
-                dc[x-r] = v * dc_factor >> 16;
-            for (x=-r/2; x<0; x++)
-                dc[x] = dc[0];
-        }
-        if (y == r) {
+        if (y < height-r)
+            blur_step(ctx, dc, buf, src, width, sstride, r, y);
+        if (y == r && y_start == 0) {
             for (y=0; y<r; y++)
                 ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
         }
         ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
-        if (++y >= height) break;
+        if (++y >= y_end) break;
         ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
-        if (++y >= height) break;
+        if (++y >= y_end) break;
     }
 }
 
@@ -33,7 +33,7 @@
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
 #include "filter_picture.h"
-
+#include "../video_chroma/slices.h"
 
 #include "hqdn3d.h"
 
@@ -98,8 +98,18 @@ struct filter_sys_t
     float chroma_temp;
 
     struct vf_priv_s cfg;
+    int line_size;              /* samples of cfg.Line for each plane */
+    filter_slices_t *slices;
 };
 
+/* What the filtering of a picture needs, for every thread */
+typedef struct
+{
+    filter_sys_t *sys;
+    picture_t    *src;
+    picture_t    *dst;
+} hqdn3d_job_t;
+
 /*****************************************************************************
  * Open
  *****************************************************************************/
@@ -140,11 +150,15 @@ static int Open(vlc_object_t *this)
         if (sys->w[i] > wmax) wmax = sys->w[i];
         sys->h[i] = fmt_out->i_height * chroma->p[i].h.num / chroma->p[i].h.den;
     }
-    cfg->Line = malloc(wmax*sizeof(int));
+    /* Each plane may be denoised by its own thread */
+    sys->line_size = wmax;
+    cfg->Line = malloc(3*wmax*sizeof(int));
     if (!cfg->Line) {
         free(sys);
         return VLC_ENOMEM;
     }
+    /* No more threads than planes */
+    sys->slices = SlicesNew(this, 3 * SLICES_MIN_LINES);
 
     filter->p_sys = sys;
     filter->pf_video_filter = Filter;
@@ -181,6 +195,8 @@ static void Close(vlc_object_t *this)
     for (int i = 0; i < 3; ++i) {
         free(cfg->Frame[i]);
     }
+    if (sys->slices)
+        SlicesDelete(sys->slices);
     free(cfg->Line);
     free(sys);
 }
@@ -188,11 +204,36 @@ static void Close(vlc_object_t *this)
 /*****************************************************************************
  * Filter
  *****************************************************************************/
+static void FilterPlane(const hqdn3d_job_t *job, int i)
+{
+    filter_sys_t *sys = job->sys;
+    struct vf_priv_s *cfg = &sys->cfg;
+    int *spat = cfg->Coefs[i ? 2 : 0];
+    int *temp = cfg->Coefs[i ? 3 : 1];
+
+    deNoise(job->src->p[i].p_pixels, job->dst->p[i].p_pixels,
+            cfg->Line + i * sys->line_size, &cfg->Frame[i], sys->w[i], sys->h[i],
+            job->src->p[i].i_pitch, job->dst->p[i].i_pitch,
+            spat, spat, temp);
+}
+
+/* Every pixel depends on its left and upper neighbours, so the planes are
+ * the units of work: the luma on the first thread, the chromas on the
+ * others. */
+static void FilterSlice(void *data, unsigned slice)
+{
+    const hqdn3d_job_t *job = data;
+    const unsigned count = SlicesCount(job->sys->slices);
+
+    for (int i = 0; i < 3; i++)
+        if (slice == (i ? 1 + (i - 1) % (count - 1) : 0))
+            FilterPlane(job, i);
+}
+
 static picture_t *Filter(filter_t *filter, picture_t *src)
 {
     picture_t *dst;
     filter_sys_t *sys = filter->p_sys;
-    struct vf_priv_s *cfg = &sys->cfg;
 
     if (!src) return NULL;
 
@@ -202,24 +243,12 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
         return NULL;
     }
 
-    deNoise(src->p[0].p_pixels, dst->p[0].p_pixels,
-            cfg->Line, &cfg->Frame[0], sys->w[0], sys->h[0],
-            src->p[0].i_pitch, dst->p[0].i_pitch,
-            cfg->Coefs[0],
-            cfg->Coefs[0],
-            cfg->Coefs[1]);
-    deNoise(src->p[1].p_pixels, dst->p[1].p_pixels,
-            cfg->Line, &cfg->Frame[1], sys->w[1], sys->h[1],
-            src->p[1].i_pitch, dst->p[1].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
-    deNoise(src->p[2].p_pixels, dst->p[2].p_pixels,
-            cfg->Line, &cfg->Frame[2], sys->w[2], sys->h[2],
-            src->p[2].i_pitch, dst->p[2].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
+    hqdn3d_job_t job = { sys, src, dst };
+    if (sys->slices)
+        SlicesRun(sys->slices, FilterSlice, &job);
+    else
+        for (int i = 0; i < 3; i++)
+            FilterPlane(&job, i);
 
     return CopyInfoAndRelease(dst, src);
 }
@@ -66,6 +66,7 @@ static int Create( vlc_object_t *p_this )
     filter_t *p_filter = (filter_t *)p_this;
 
     p_filter->pf_video_filter = Filter;
+    p_filter->b_video_inplace = true;
 
     return VLC_SUCCESS;
 }
@@ -107,9 +108,10 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
     {
         /* We don't want to invert the alpha plane */
         i_planes = p_pic->i_planes - 1;
-        vlc_memcpy(
-            p_outpic->p[A_PLANE].p_pixels, p_pic->p[A_PLANE].p_pixels,
-            p_pic->p[A_PLANE].i_pitch *  p_pic->p[A_PLANE].i_lines );
+        if( p_outpic != p_pic )
+            vlc_memcpy(
+                p_outpic->p[A_PLANE].p_pixels, p_pic->p[A_PLANE].p_pixels,
+                p_pic->p[A_PLANE].i_pitch *  p_pic->p[A_PLANE].i_lines );
     }
     else
     {
@@ -401,6 +401,13 @@ static void DestroyFilter( vlc_object_t *p_this )
     DEL_CB( order );
 #undef DEL_CB
 
+    /* The bridges have no cells to scale to anymore */
+    vlc_global_lock( VLC_MOSAIC_MUTEX );
+    bridge_t *p_bridge = GetBridge( p_filter );
+    if( p_bridge != NULL )
+        p_bridge->i_cell_width = p_bridge->i_cell_height = 0;
+    vlc_global_unlock( VLC_MOSAIC_MUTEX );
+
     if( !p_sys->b_keep )
     {
         image_HandlerDelete( p_sys->p_image );
@@ -519,6 +526,11 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
     row_inner_height = ( ( p_sys->i_height - ( p_sys->i_rows - 1 )
                        * p_sys->i_borderh ) / p_sys->i_rows );
 
+    /* Let the bridges scale the pictures to the cells on their threads */
+    p_bridge->i_cell_width = p_sys->b_keep ? 0 : col_inner_width;
+    p_bridge->i_cell_height = p_sys->b_keep ? 0 : row_inner_height;
+    p_bridge->b_cell_ar = p_sys->b_ar;
+
     i_real_index = 0;
 
     for ( i_index = 0; i_index < p_bridge->i_es_num; i_index++ )
@@ -587,49 +599,34 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
 
         if ( !p_sys->b_keep )
         {
-            /* Convert the images */
             fmt_in.i_chroma = p_es->p_picture->format.i_chroma;
             fmt_in.i_height = p_es->p_picture->format.i_height;
             fmt_in.i_width = p_es->p_picture->format.i_width;
 
-            if( fmt_in.i_chroma == VLC_CODEC_YUVA ||
-                fmt_in.i_chroma == VLC_CODEC_RGBA )
-                fmt_out.i_chroma = VLC_CODEC_YUVA;
-            else
-                fmt_out.i_chroma = VLC_CODEC_I420;
-            fmt_out.i_width = col_inner_width;
-            fmt_out.i_height = row_inner_height;
+            mosaic_GetCellFormat( &fmt_out, &fmt_in, col_inner_width,
+                                  row_inner_height, p_sys->b_ar );
 
-            if( p_sys->b_ar ) /* keep aspect ratio */
+            /* The bridge has usually scaled the picture already */
+            if( mosaic_IsCellPicture( p_es->p_picture, &fmt_out ) )
             {
-                if( (float)fmt_out.i_width / (float)fmt_out.i_height
-                      > (float)fmt_in.i_width / (float)fmt_in.i_height )
-                {
-                    fmt_out.i_width = ( fmt_out.i_height * fmt_in.i_width )
-                                         / fmt_in.i_height;
-                }
-                else
+                p_converted = picture_Hold( p_es->p_picture );
+            }
+            else
+            {
+                /* Convert the images */
+                p_converted = image_Convert( p_sys->p_image, p_es->p_picture,
+                                             &fmt_in, &fmt_out );
+                if( !p_converted )
                 {
-                    fmt_out.i_height = ( fmt_out.i_width * fmt_in.i_height )
-                                        / fmt_in.i_width;
+                    msg_Warn( p_filter,
+                               "image resizing and chroma conversion failed" );
+                    continue;
                 }
-             }
-
-            fmt_out.i_visible_width = fmt_out.i_width;
-            fmt_out.i_visible_height = fmt_out.i_height;
-
-            p_converted = image_Convert( p_sys->p_image, p_es->p_picture,
-                                         &fmt_in, &fmt_out );
-            if( !p_converted )
-            {
-                msg_Warn( p_filter,
-                           "image resizing and chroma conversion failed" );
-                continue;
             }
         }
         else
         {
-            p_converted = p_es->p_picture;
+            p_converted = picture_Hold( p_es->p_picture );
             fmt_in.i_width = fmt_out.i_width = p_converted->format.i_width;
             fmt_in.i_height = fmt_out.i_height = p_converted->format.i_height;
             fmt_in.i_chroma = fmt_out.i_chroma = p_converted->format.i_chroma;
@@ -637,11 +634,15 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
             fmt_out.i_visible_height = fmt_out.i_height;
         }
 
+        /* The bridged pictures are not modified once pushed, so the region
+         * can refer to them instead of a copy */
         p_region = subpicture_region_New( &fmt_out );
-        /* FIXME the copy is probably not needed anymore */
         if( p_region )
-            picture_Copy( p_region->p_picture, p_converted );
-        if( !p_sys->b_keep )
+        {
+            picture_Release( p_region->p_picture );
+            p_region->p_picture = p_converted;
+        }
+        else
             picture_Release( p_converted );
 
         if( !p_region )
@@ -39,6 +39,12 @@ typedef struct bridge_t
 {
     bridged_es_t **pp_es;
     int i_es_num;
+
+    /* Size of the mosaic cells, for the bridges to scale the pictures on
+     * their own threads (0 if the mosaic displays them as they are) */
+    unsigned i_cell_width;
+    unsigned i_cell_height;
+    bool b_cell_ar;
 } bridge_t;
 
 static bridge_t *GetBridge( vlc_object_t *p_object )
@@ -57,3 +63,47 @@ static bridge_t *GetBridge( vlc_object_t *p_object )
 }
 #define GetBridge(a) GetBridge( VLC_OBJECT(a) )
 
+/* Format the mosaic displays a picture of format p_in with, in a cell of
+ * i_width x i_height */
+static inline void mosaic_GetCellFormat( video_format_t *p_out,
+                                         const video_format_t *p_in,
+                                         unsigned i_width, unsigned i_height,
+                                         bool b_ar )
+{
+    memset( p_out, 0, sizeof( video_format_t ) );
+
+    if( p_in->i_chroma == VLC_CODEC_YUVA ||
+        p_in->i_chroma == VLC_CODEC_RGBA )
+        p_out->i_chroma = VLC_CODEC_YUVA;
+    else
+        p_out->i_chroma = VLC_CODEC_I420;
+    p_out->i_width = i_width;
+    p_out->i_height = i_height;
+
+    if( b_ar ) /* keep aspect ratio */
+    {
+        if( (float)p_out->i_width / (float)p_out->i_height
+              > (float)p_in->i_width / (float)p_in->i_height )
+        {
+            p_out->i_width = ( p_out->i_height * p_in->i_width )
+                                 / p_in->i_height;
+        }
+        else
+        {
+            p_out->i_height = ( p_out->i_width * p_in->i_height )
+                                / p_in->i_width;
+        }
+    }
+
+    p_out->i_visible_width = p_out->i_width;
+    p_out->i_visible_height = p_out->i_height;
+}
+
+/* Whether a picture is already in the format given by mosaic_GetCellFormat */
+static inline bool mosaic_IsCellPicture( const picture_t *p_picture,
+                                         const video_format_t *p_fmt )
+{
+    return p_picture->format.i_chroma == p_fmt->i_chroma &&
+           p_picture->format.i_visible_width == p_fmt->i_visible_width &&
+           p_picture->format.i_visible_height == p_fmt->i_visible_height;
+}
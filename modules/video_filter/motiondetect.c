@@ -32,9 +32,15 @@
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_sout.h>
+#include <vlc_cpu.h>
 
 #include <vlc_filter.h>
 #include "filter_picture.h"
+#include "filter_event_info.h"
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
 
 /*****************************************************************************
  * Module descriptor
@@ -44,6 +50,16 @@ static void Destroy   ( vlc_object_t * );
 
 #define FILTER_PREFIX "motiondetect-"
 
+#define FACTOR_TEXT N_("Analysis downscaling")
+#define FACTOR_LONGTEXT N_("The luma is averaged over blocks of this many " \
+    "pixels on each side before looking for motion, which is much cheaper " \
+    "than analysing the full pictures (1).")
+
+#define DRAW_TEXT N_("Draw the moving shapes")
+#define DRAW_LONGTEXT N_("Draws rectangles around the moving shapes. " \
+    "Otherwise the pictures are passed through untouched, and the shapes " \
+    "are only reported on the \"" VIDEO_FILTER_EVENT_VARIABLE "\" variable.")
+
 vlc_module_begin ()
     set_description( N_("Motion detect video filter") )
     set_shortname( N_( "Motion Detect" ))
@@ -51,10 +67,17 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_VIDEO_VFILTER )
     set_capability( "video filter2", 0 )
 
+    add_integer_with_range( FILTER_PREFIX "factor", 1, 1, 64,
+                            FACTOR_TEXT, FACTOR_LONGTEXT, false )
+    add_bool( FILTER_PREFIX "draw", true, DRAW_TEXT, DRAW_LONGTEXT, false )
+
     add_shortcut( "motion" )
     set_callbacks( Create, Destroy )
 vlc_module_end ()
 
+static const char *const ppsz_filter_options[] = {
+    "factor", "draw", NULL
+};
 
 /*****************************************************************************
  * Local prototypes
@@ -63,17 +86,31 @@ static picture_t *Filter( filter_t *, picture_t * );
 static void GaussianConvolution( uint32_t *, uint32_t *, int, int, int );
 static int FindShapes( uint32_t *, uint32_t *, int, int, int,
                        int *, int *, int *, int *, int *);
-static void Draw( filter_t *p_filter, uint8_t *p_pix, int i_pix_pitch, int i_pix_size );
+static void Draw( filter_t *p_filter, uint8_t *p_pix, int i_pix_pitch, int i_pix_size,
+                  int i_scale );
+static void Publish( filter_t *p_filter );
 #define NUM_COLORS (5000)
 
 struct filter_sys_t
 {
     bool is_yuv_planar;
     bool b_old;
+    bool b_draw;
     picture_t *p_old;
     uint32_t *p_buf;
     uint32_t *p_buf2;
 
+    /* Downscaled luma, when i_factor > 1 */
+    int i_factor;
+    unsigned i_small_width;
+    unsigned i_small_height;
+    uint8_t *p_small;       /* of the current picture */
+    uint8_t *p_small_old;   /* of the previous one */
+    uint32_t *p_sum;        /* a line of block sums */
+
+    /* Shapes reported on VIDEO_FILTER_EVENT_VARIABLE */
+    video_filter_event_info_t event_info;
+
     /* */
     int i_colors;
     int colors[NUM_COLORS];
@@ -115,21 +152,53 @@ static int Create( vlc_object_t *p_this )
     if( p_filter->p_sys == NULL )
         return VLC_ENOMEM;
 
+    config_ChainParse( p_filter, FILTER_PREFIX, ppsz_filter_options,
+                       p_filter->p_cfg );
+
     p_sys->is_yuv_planar = is_yuv_planar;
     p_sys->b_old = false;
-    p_sys->p_old = picture_NewFromFormat( p_fmt );
-    p_sys->p_buf  = calloc( p_fmt->i_width * p_fmt->i_height, sizeof(*p_sys->p_buf) );
-    p_sys->p_buf2 = calloc( p_fmt->i_width * p_fmt->i_height, sizeof(*p_sys->p_buf) );
-
-    if( !p_sys->p_old || !p_sys->p_buf || !p_sys->p_buf2 )
+    p_sys->b_draw = var_CreateGetBool( p_filter, FILTER_PREFIX "draw" );
+
+    /* Keep enough blocks for the smoothing of FindShapes */
+    p_sys->i_factor = var_CreateGetInteger( p_filter, FILTER_PREFIX "factor" );
+    p_sys->i_factor = VLC_CLIP( p_sys->i_factor, 1,
+                       (int)__MIN( p_fmt->i_width, p_fmt->i_height ) / 8 );
+    p_sys->i_small_width  = p_fmt->i_width  / p_sys->i_factor;
+    p_sys->i_small_height = p_fmt->i_height / p_sys->i_factor;
+
+    const size_t i_size = p_sys->i_small_width * p_sys->i_small_height;
+    p_sys->p_old = NULL;
+    p_sys->p_small = NULL;
+    p_sys->p_sum = NULL;
+    if( p_sys->i_factor > 1 )
+    {
+        p_sys->p_small = malloc( 2 * i_size );
+        p_sys->p_small_old = p_sys->p_small + i_size;
+        p_sys->p_sum = calloc( p_sys->i_small_width, sizeof(*p_sys->p_sum) );
+    }
+    else
+        p_sys->p_old = picture_NewFromFormat( p_fmt );
+    p_sys->p_buf  = calloc( i_size, sizeof(*p_sys->p_buf) );
+    p_sys->p_buf2 = calloc( i_size, sizeof(*p_sys->p_buf) );
+    p_sys->event_info.p_region = NULL;
+    p_sys->event_info.i_region_size = 0;
+
+    if( ( p_sys->i_factor > 1 ? !p_sys->p_small || !p_sys->p_sum
+                              : !p_sys->p_old ) ||
+        !p_sys->p_buf || !p_sys->p_buf2 )
     {
         free( p_sys->p_buf2 );
         free( p_sys->p_buf );
+        free( p_sys->p_sum );
+        free( p_sys->p_small );
         if( p_sys->p_old )
             picture_Release( p_sys->p_old );
+        free( p_sys );
         return VLC_ENOMEM;
     }
 
+    var_Create( p_filter->p_libvlc, VIDEO_FILTER_EVENT_VARIABLE,
+                VLC_VAR_ADDRESS | VLC_VAR_DOINHERIT );
     return VLC_SUCCESS;
 }
 
@@ -141,9 +210,15 @@ static void Destroy( vlc_object_t *p_this )
     filter_t *p_filter = (filter_t *)p_this;
     filter_sys_t *p_sys = p_filter->p_sys;
 
+    var_Destroy( p_filter->p_libvlc, VIDEO_FILTER_EVENT_VARIABLE );
+
+    free( p_sys->event_info.p_region );
     free( p_sys->p_buf2 );
     free( p_sys->p_buf );
-    picture_Release( p_sys->p_old );
+    free( p_sys->p_sum );
+    free( p_sys->p_small );
+    if( p_sys->p_old )
+        picture_Release( p_sys->p_old );
     free( p_sys );
 }
 
@@ -258,63 +333,183 @@ static int PreparePacked( filter_t *p_filter, picture_t *p_inpic, int *pi_pix_of
     return VLC_SUCCESS;
 }
 
-static picture_t *Filter( filter_t *p_filter, picture_t *p_inpic )
+/*****************************************************************************
+ * Downscaled luma
+ *****************************************************************************/
+/* Averages the luma over blocks of i_factor x i_factor pixels */
+static void Downscale( filter_t *p_filter, const picture_t *p_inpic,
+                       int i_pix_offset, int i_pix_size )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
+    const unsigned i_factor = p_sys->i_factor;
+    const unsigned i_width = p_sys->i_small_width * i_factor;
+    const plane_t *p_src = &p_inpic->p[Y_PLANE];
+    uint32_t *p_sum = p_sys->p_sum;
+#if defined(__SSE2__)
+    const bool b_sse2 = (vlc_CPU() & CPU_CAPABILITY_SSE2) &&
+                        i_pix_size == 1 && (i_factor % 8) == 0;
+#endif
 
-    if( !p_inpic )
-        return NULL;
-
-    picture_t *p_outpic = filter_NewPicture( p_filter );
-    if( !p_outpic )
+    for( unsigned y = 0; y < p_sys->i_small_height; y++ )
     {
-        picture_Release( p_inpic );
-        return NULL;
-    }
-    picture_Copy( p_outpic, p_inpic );
+        for( unsigned i = 0; i < i_factor; i++ )
+        {
+            const uint8_t *p_line = &p_src->p_pixels[(y * i_factor + i) * p_src->i_pitch + i_pix_offset];
+            unsigned x = 0;
+#if defined(__SSE2__)
+            if( b_sse2 )
+            {
+                /* Every half of the sums of absolute differences to 0 falls
+                 * in a single block */
+                const __m128i zero = _mm_setzero_si128();
+                for( ; x + 16 <= i_width; x += 16 )
+                {
+                    const __m128i sad = _mm_sad_epu8( _mm_loadu_si128( (const __m128i *)&p_line[x] ), zero );
+                    p_sum[x / i_factor] += _mm_cvtsi128_si32( sad );
+                    p_sum[(x + 8) / i_factor] += _mm_cvtsi128_si32( _mm_srli_si128( sad, 8 ) );
+                }
+                for( ; x < i_width; x += 8 )
+                {
+                    const __m128i sad = _mm_sad_epu8( _mm_loadl_epi64( (const __m128i *)&p_line[x] ), zero );
+                    p_sum[x / i_factor] += _mm_cvtsi128_si32( sad );
+                }
+            }
+#endif
+            for( ; x < i_width; x++ )
+                p_sum[x / i_factor] += p_line[x * i_pix_size];
+        }
 
-    if( !p_sys->b_old )
-    {
-        picture_Copy( p_sys->p_old, p_inpic );
-        p_sys->b_old = true;
-        goto exit;
+        uint8_t *p_small = &p_sys->p_small[y * p_sys->i_small_width];
+        const unsigned i_area = i_factor * i_factor;
+        for( unsigned x = 0; x < p_sys->i_small_width; x++ )
+        {
+            p_small[x] = ( p_sum[x] + i_area / 2 ) / i_area;
+            p_sum[x] = 0;
+        }
     }
+}
+
+/* Gets the differences of the downscaled luma with the previous picture */
+static void PrepareDownscaled( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const unsigned i_size = p_sys->i_small_width * p_sys->i_small_height;
+
+    for( unsigned i = 0; i < i_size; i++ )
+        p_sys->p_buf2[i] = abs( p_sys->p_small[i] - p_sys->p_small_old[i] );
+}
+
+/*****************************************************************************
+ * Filter
+ *****************************************************************************/
+/* Looks for the moving shapes of p_inpic, and draws them on p_outpic if not
+ * NULL */
+static void Detect( filter_t *p_filter, picture_t *p_inpic, picture_t *p_outpic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const video_format_t *p_fmt = &p_filter->fmt_in.video;
 
     int i_pix_offset;
     int i_pix_size;
     if( p_sys->is_yuv_planar )
     {
-        PreparePlanar( p_filter, p_inpic );
         i_pix_offset = 0;
         i_pix_size = 1;
     }
     else
     {
-        if( PreparePacked( p_filter, p_inpic, &i_pix_offset ) )
-            goto exit;
+        int i_u_offset, i_v_offset;
+        if( GetPackedYuvOffsets( p_fmt->i_chroma,
+                                 &i_pix_offset, &i_u_offset, &i_v_offset ) )
+        {
+            msg_Warn( p_filter, "Unsupported input chroma (%4.4s)",
+                      (char*)&p_fmt->i_chroma );
+            return;
+        }
         i_pix_size = 2;
     }
 
+    if( p_sys->i_factor > 1 )
+        Downscale( p_filter, p_inpic, i_pix_offset, i_pix_size );
+
+    if( !p_sys->b_old )
+    {
+        if( p_sys->i_factor > 1 )
+        {
+            uint8_t *p_tmp = p_sys->p_small_old;
+            p_sys->p_small_old = p_sys->p_small;
+            p_sys->p_small = p_tmp;
+        }
+        else
+            picture_Copy( p_sys->p_old, p_inpic );
+        p_sys->b_old = true;
+        return;
+    }
+
+    if( p_sys->i_factor > 1 )
+        PrepareDownscaled( p_filter );
+    else if( p_sys->is_yuv_planar )
+        PreparePlanar( p_filter, p_inpic );
+    else if( PreparePacked( p_filter, p_inpic, &i_pix_offset ) )
+        return;
+
     /**
      * Get the areas where movement was detected
      */
-    const video_format_t *p_fmt = &p_filter->fmt_in.video;
-    p_sys->i_colors = FindShapes( p_sys->p_buf2, p_sys->p_buf, p_fmt->i_width, p_fmt->i_width, p_fmt->i_height,
+    const int i_width = p_sys->i_factor > 1 ? (int)p_sys->i_small_width
+                                            : (int)p_fmt->i_width;
+    const int i_height = p_sys->i_factor > 1 ? (int)p_sys->i_small_height
+                                             : (int)p_fmt->i_height;
+    p_sys->i_colors = FindShapes( p_sys->p_buf2, p_sys->p_buf, i_width, i_width, i_height,
                                   p_sys->colors, p_sys->color_x_min, p_sys->color_x_max, p_sys->color_y_min, p_sys->color_y_max );
 
     /**
      * Count final number of shapes
      * Draw rectangles (there can be more than 1 moving shape in 1 rectangle)
      */
-    Draw( p_filter, &p_outpic->p[Y_PLANE].p_pixels[i_pix_offset], p_outpic->p[Y_PLANE].i_pitch, i_pix_size );
+    if( p_outpic )
+        Draw( p_filter, &p_outpic->p[Y_PLANE].p_pixels[i_pix_offset], p_outpic->p[Y_PLANE].i_pitch, i_pix_size,
+              p_sys->i_factor );
+    Publish( p_filter );
 
     /**
      * We're done. Lets keep a copy of the picture
      * TODO we may just picture_Release with a latency of 1 if the filters/vout
      * handle it correctly */
-    picture_Copy( p_sys->p_old, p_inpic );
+    if( p_sys->i_factor > 1 )
+    {
+        uint8_t *p_tmp = p_sys->p_small_old;
+        p_sys->p_small_old = p_sys->p_small;
+        p_sys->p_small = p_tmp;
+    }
+    else
+        picture_Copy( p_sys->p_old, p_inpic );
+}
+
+static picture_t *Filter( filter_t *p_filter, picture_t *p_inpic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( !p_inpic )
+        return NULL;
+
+    /* Only report the shapes: the picture goes through untouched */
+    if( !p_sys->b_draw )
+    {
+        Detect( p_filter, p_inpic, NULL );
+        return p_inpic;
+    }
+
+    picture_t *p_outpic = filter_NewPicture( p_filter );
+    if( !p_outpic )
+    {
+        picture_Release( p_inpic );
+        return NULL;
+    }
+    picture_Copy( p_outpic, p_inpic );
+
+    Detect( p_filter, p_inpic, p_outpic );
 
-exit:
     picture_Release( p_inpic );
     return p_outpic;
 }
@@ -520,7 +715,18 @@ static int FindShapes( uint32_t *p_diff, uint32_t *p_smooth,
     return last;
 }
 
-static void Draw( filter_t *p_filter, uint8_t *p_pix, int i_pix_pitch, int i_pix_size )
+/* A shape worth reporting */
+static bool IsShape( const filter_sys_t *p_sys, int i )
+{
+    if( p_sys->colors[i] != i || p_sys->color_x_min[i] == -1 )
+        return false;
+    return ( p_sys->color_y_max[i] - p_sys->color_y_min[i] ) *
+           ( p_sys->color_x_max[i] - p_sys->color_x_min[i] ) >= 16;
+}
+
+/* Draws the shapes found on the grid of i_scale pixels wide cells */
+static void Draw( filter_t *p_filter, uint8_t *p_pix, int i_pix_pitch, int i_pix_size,
+                  int i_scale )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
     int i, j;
@@ -529,18 +735,13 @@ static void Draw( filter_t *p_filter, uint8_t *p_pix, int i_pix_pitch, int i_pix
     {
         int x, y;
 
-        if( p_sys->colors[i] != i )
+        if( !IsShape( p_sys, i ) )
             continue;
 
-        const int color_x_min = p_sys->color_x_min[i];
-        const int color_x_max = p_sys->color_x_max[i];
-        const int color_y_min = p_sys->color_y_min[i];
-        const int color_y_max = p_sys->color_y_max[i];
-
-        if( color_x_min == -1 )
-            continue;
-        if( ( color_y_max - color_y_min ) * ( color_x_max - color_x_min ) < 16 )
-            continue;
+        const int color_x_min = p_sys->color_x_min[i] * i_scale;
+        const int color_x_max = p_sys->color_x_max[i] * i_scale + i_scale - 1;
+        const int color_y_min = p_sys->color_y_min[i] * i_scale;
+        const int color_y_max = p_sys->color_y_max[i] * i_scale + i_scale - 1;
 
         j++;
 
@@ -562,3 +763,45 @@ static void Draw( filter_t *p_filter, uint8_t *p_pix, int i_pix_pitch, int i_pix
     }
     msg_Dbg( p_filter, "Counted %d moving shapes.", j );
 }
+
+/* Reports the shapes, and their disappearance, on VIDEO_FILTER_EVENT_VARIABLE */
+static void Publish( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    video_filter_event_info_t *p_info = &p_sys->event_info;
+    const int i_scale = p_sys->i_factor;
+    int i_count = 0;
+
+    for( int i = 1; i < p_sys->i_colors; i++ )
+        if( IsShape( p_sys, i ) )
+            i_count++;
+    if( i_count == 0 && p_info->i_region_size == 0 )
+        return;
+
+    if( i_count > p_info->i_region_size )
+    {
+        video_filter_region_info_t *p_region =
+            realloc( p_info->p_region, i_count * sizeof(*p_region) );
+        if( !p_region )
+            return;
+        p_info->p_region = p_region;
+    }
+
+    p_info->i_region_size = 0;
+    for( int i = 1; i < p_sys->i_colors; i++ )
+    {
+        if( !IsShape( p_sys, i ) )
+            continue;
+
+        video_filter_region_info_t *p_region =
+            &p_info->p_region[p_info->i_region_size++];
+        memset( p_region, 0, sizeof(*p_region) );
+        p_region->i_x      = p_sys->color_x_min[i] * i_scale;
+        p_region->i_y      = p_sys->color_y_min[i] * i_scale;
+        p_region->i_width  = ( p_sys->color_x_max[i] - p_sys->color_x_min[i] + 1 ) * i_scale;
+        p_region->i_height = ( p_sys->color_y_max[i] - p_sys->color_y_min[i] + 1 ) * i_scale;
+        p_region->i_id     = i;
+        p_region->p_description = (char *)"Motion Detected";
+    }
+    var_SetAddress( p_filter->p_libvlc, VIDEO_FILTER_EVENT_VARIABLE, p_info );
+}
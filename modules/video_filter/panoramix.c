@@ -714,10 +714,60 @@ static void Close( vlc_object_t *p_this )
 /**
  * It creates multiples pictures from the source one
  */
+/**
+ * It makes every output refer to its part of the source without any copy,
+ * if none of them has black borders or attenuated edges and all the outputs
+ * allow it.
+ */
+static int FilterRef( video_splitter_t *p_splitter, picture_t *pp_dst[], picture_t *p_src )
+{
+    video_splitter_sys_t *p_sys = p_splitter->p_sys;
+    int pi_done[COL_MAX*ROW_MAX];
+    int i_done = 0;
+
+    for( int y = 0; y < p_sys->i_row; y++ )
+    {
+        for( int x = 0; x < p_sys->i_col; x++ )
+        {
+            const panoramix_output_t *p_output = &p_sys->pp_output[x][y];
+            if( !p_output->b_active )
+                continue;
+
+            const panoramix_filter_t *p_cfg = &p_output->filter;
+            if( !p_cfg->black.i_left && !p_cfg->black.i_right &&
+                !p_cfg->black.i_top && !p_cfg->black.i_bottom &&
+                !p_cfg->attenuate.i_left && !p_cfg->attenuate.i_right &&
+                !p_cfg->attenuate.i_top && !p_cfg->attenuate.i_bottom )
+                pp_dst[p_output->i_output] =
+                    video_splitter_RefPicture( p_splitter, p_output->i_output,
+                                               p_src, p_output->i_src_x,
+                                               p_output->i_src_y );
+            else
+                pp_dst[p_output->i_output] = NULL;
+
+            if( !pp_dst[p_output->i_output] )
+            {
+                /* Release the outputs already referring to the source */
+                for( int i = 0; i < i_done; i++ )
+                    picture_Release( pp_dst[pi_done[i]] );
+                return VLC_EGENERIC;
+            }
+            pi_done[i_done++] = p_output->i_output;
+        }
+    }
+    return VLC_SUCCESS;
+}
+
 static int Filter( video_splitter_t *p_splitter, picture_t *pp_dst[], picture_t *p_src )
 {
     video_splitter_sys_t *p_sys = p_splitter->p_sys;
 
+    if( !FilterRef( p_splitter, pp_dst, p_src ) )
+    {
+        picture_Release( p_src );
+        return VLC_SUCCESS;
+    }
+
     if( video_splitter_NewPicture( p_splitter, pp_dst ) )
     {
         picture_Release( p_src );
@@ -49,7 +49,7 @@ static void Destroy     ( vlc_object_t * );
 static picture_t *Filter( filter_t *, picture_t * );
 
 static void SnapshotRatio( filter_t *p_filter, picture_t *p_pic );
-static void SavePicture( filter_t *, picture_t * );
+static void *Thread( void * );
 
 /*****************************************************************************
  * Module descriptor
@@ -122,9 +122,15 @@ static const char *const ppsz_vfilter_options[] = {
     "format", "width", "height", "ratio", "prefix", "path", "replace", NULL
 };
 
+/* Snapshots waiting for the encoder thread, beyond which the oldest one
+ * is dropped */
+#define SCENE_QUEUE_MAX (3)
+
 typedef struct scene_t {
     picture_t       *p_pic;
-    video_format_t  format;
+    int32_t         i_frames;   /* for the filename */
+    int32_t         i_width;
+    int32_t         i_height;
 } scene_t;
 
 /*****************************************************************************
@@ -133,7 +139,15 @@ typedef struct scene_t {
 struct filter_sys_t
 {
     image_handler_t *p_image;
-    scene_t scene;
+
+    /* The snapshots are encoded and written by a thread of their own, not
+     * to delay the pictures */
+    vlc_thread_t thread;
+    vlc_mutex_t  lock;
+    vlc_cond_t   wait;
+    bool         b_exit;
+    scene_t      queue[SCENE_QUEUE_MAX];
+    unsigned     i_queue;
 
     char *psz_path;
     char *psz_prefix;
@@ -189,6 +203,22 @@ static int Create( vlc_object_t *p_this )
     if( p_sys->psz_path == NULL )
         p_sys->psz_path = config_GetUserDir( VLC_PICTURES_DIR );
 
+    vlc_mutex_init( &p_sys->lock );
+    vlc_cond_init( &p_sys->wait );
+    p_sys->b_exit = false;
+    p_sys->i_queue = 0;
+    if( vlc_clone( &p_sys->thread, Thread, p_filter, VLC_THREAD_PRIORITY_LOW ) )
+    {
+        vlc_cond_destroy( &p_sys->wait );
+        vlc_mutex_destroy( &p_sys->lock );
+        image_HandlerDelete( p_sys->p_image );
+        free( p_sys->psz_format );
+        free( p_sys->psz_prefix );
+        free( p_sys->psz_path );
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+
     p_filter->pf_video_filter = Filter;
 
     return VLC_SUCCESS;
@@ -202,10 +232,17 @@ static void Destroy( vlc_object_t *p_this )
     filter_t *p_filter = (filter_t *)p_this;
     filter_sys_t *p_sys = (filter_sys_t *) p_filter->p_sys;
 
+    /* The snapshots still queued are written first */
+    vlc_mutex_lock( &p_sys->lock );
+    p_sys->b_exit = true;
+    vlc_cond_signal( &p_sys->wait );
+    vlc_mutex_unlock( &p_sys->lock );
+    vlc_join( p_sys->thread, NULL );
+    vlc_cond_destroy( &p_sys->wait );
+    vlc_mutex_destroy( &p_sys->lock );
+
     image_HandlerDelete( p_sys->p_image );
 
-    if( p_sys->scene.p_pic )
-        picture_Release( p_sys->scene.p_pic );
     free( p_sys->psz_format );
     free( p_sys->psz_prefix );
     free( p_sys->psz_path );
@@ -235,9 +272,6 @@ static void SnapshotRatio( filter_t *p_filter, picture_t *p_pic )
     }
     p_sys->i_frames++;
 
-    if( p_sys->scene.p_pic )
-        picture_Release( p_sys->scene.p_pic );
-
     if( (p_sys->i_width <= 0) && (p_sys->i_height > 0) )
     {
         p_sys->i_width = (p_pic->format.i_width * p_sys->i_height) / p_pic->format.i_height;
@@ -252,18 +286,35 @@ static void SnapshotRatio( filter_t *p_filter, picture_t *p_pic )
         p_sys->i_height = p_pic->format.i_height;
     }
 
-    p_sys->scene.p_pic = picture_NewFromFormat( &p_pic->format );
-    if( p_sys->scene.p_pic )
+    scene_t scene = {
+        .p_pic = picture_NewFromFormat( &p_pic->format ),
+        .i_frames = p_sys->i_frames,
+        .i_width = p_sys->i_width,
+        .i_height = p_sys->i_height,
+    };
+    if( !scene.p_pic )
+        return;
+    picture_Copy( scene.p_pic, p_pic );
+
+    vlc_mutex_lock( &p_sys->lock );
+    if( p_sys->i_queue >= SCENE_QUEUE_MAX )
     {
-        picture_Copy( p_sys->scene.p_pic, p_pic );
-        SavePicture( p_filter, p_sys->scene.p_pic );
+        /* The encoder is late: the newest snapshots matter most */
+        msg_Warn( p_filter, "dropping snapshot %"PRId32,
+                  p_sys->queue[0].i_frames );
+        picture_Release( p_sys->queue[0].p_pic );
+        memmove( &p_sys->queue[0], &p_sys->queue[1],
+                 --p_sys->i_queue * sizeof(*p_sys->queue) );
     }
+    p_sys->queue[p_sys->i_queue++] = scene;
+    vlc_cond_signal( &p_sys->wait );
+    vlc_mutex_unlock( &p_sys->lock );
 }
 
 /*****************************************************************************
  * Save Picture to disk
  *****************************************************************************/
-static void SavePicture( filter_t *p_filter, picture_t *p_pic )
+static void SavePicture( filter_t *p_filter, const scene_t *p_scene )
 {
     filter_sys_t *p_sys = (filter_sys_t *)p_filter->p_sys;
     video_format_t fmt_in, fmt_out;
@@ -275,10 +326,10 @@ static void SavePicture( filter_t *p_filter, picture_t *p_pic )
     memset( &fmt_out, 0, sizeof(video_format_t) );
 
     /* Save snapshot psz_format to a memory zone */
-    fmt_in = p_pic->format;
+    fmt_in = p_scene->p_pic->format;
     fmt_out.i_sar_num = fmt_out.i_sar_den = 1;
-    fmt_out.i_width = p_sys->i_width;
-    fmt_out.i_height = p_sys->i_height;
+    fmt_out.i_width = p_scene->i_width;
+    fmt_out.i_height = p_scene->i_height;
     fmt_out.i_chroma = p_sys->i_format;
 
     /*
@@ -292,7 +343,7 @@ static void SavePicture( filter_t *p_filter, picture_t *p_pic )
     else
         i_ret = asprintf( &psz_filename, "%s" DIR_SEP "%s%05d.%s",
                           p_sys->psz_path, p_sys->psz_prefix,
-                          p_sys->i_frames, p_sys->psz_format );
+                          p_scene->i_frames, p_sys->psz_format );
 
     if( i_ret == -1 )
     {
@@ -310,7 +361,7 @@ static void SavePicture( filter_t *p_filter, picture_t *p_pic )
     path_sanitize( psz_temp );
 
     /* Save the image */
-    i_ret = image_WriteUrl( p_sys->p_image, p_pic, &fmt_in, &fmt_out,
+    i_ret = image_WriteUrl( p_sys->p_image, p_scene->p_pic, &fmt_in, &fmt_out,
                             psz_temp );
     if( i_ret != VLC_SUCCESS )
     {
@@ -334,3 +385,33 @@ error:
     free( psz_temp );
     free( psz_filename );
 }
+
+/*****************************************************************************
+ * Thread: encode and write the queued snapshots
+ *****************************************************************************/
+static void *Thread( void *p_data )
+{
+    filter_t *p_filter = p_data;
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    vlc_mutex_lock( &p_sys->lock );
+    for( ;; )
+    {
+        while( !p_sys->b_exit && p_sys->i_queue == 0 )
+            vlc_cond_wait( &p_sys->wait, &p_sys->lock );
+        if( p_sys->i_queue == 0 )
+            break;
+
+        scene_t scene = p_sys->queue[0];
+        memmove( &p_sys->queue[0], &p_sys->queue[1],
+                 --p_sys->i_queue * sizeof(*p_sys->queue) );
+        vlc_mutex_unlock( &p_sys->lock );
+
+        SavePicture( p_filter, &scene );
+        picture_Release( scene.p_pic );
+
+        vlc_mutex_lock( &p_sys->lock );
+    }
+    vlc_mutex_unlock( &p_sys->lock );
+    return NULL;
+}
@@ -147,6 +147,8 @@ static int Create( vlc_object_t *p_this )
     var_AddCallback( p_filter, CFG_PREFIX "intensity", FilterCallback, NULL );
 
     p_filter->pf_video_filter = Filter;
+    /* Every sample is read before it is written */
+    p_filter->b_video_inplace = true;
 
     return VLC_SUCCESS;
 }
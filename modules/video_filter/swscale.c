@@ -38,6 +38,7 @@
 #include <libswscale/swscale.h>
 
 #include "../codec/avcodec/chroma.h" // Chroma Avutil <-> VLC conversion
+#include "../video_chroma/slices.h"
 
 /* Gruikkkkkkkkkk!!!!! */
 #undef AVPALETTE_SIZE
@@ -101,11 +102,32 @@ struct filter_sys_t
     bool b_copy;
     bool b_swap_uvi;
     bool b_swap_uvo;
+
+    /* Bands of the output converted at once, each by its own context */
+    filter_slices_t *p_slices;
+    struct scaler_band_t *p_bands;
 };
 
+/**
+ * A band of the output picture, scaled from the matching source lines.
+ * When scaling vertically, it is scaled with some lines of margin, so that
+ * the filter taps see the same source lines as for the whole picture.
+ */
+typedef struct scaler_band_t
+{
+    struct SwsContext *ctx;
+    picture_t *p_pic;         /* output with the margins, or NULL */
+    unsigned   i_src_first;
+    unsigned   i_src_lines;
+    unsigned   i_dst_first;
+    unsigned   i_dst_lines;
+    unsigned   i_margin;      /* lines of p_pic above the band */
+} scaler_band_t;
+
 static picture_t *Filter( filter_t *, picture_t * );
 static int  Init( filter_t * );
 static void Clean( filter_t * );
+static void CleanBands( filter_t * );
 
 typedef struct
 {
@@ -132,6 +154,9 @@ static int GetSwsCpuMask(void);
 /* SwScaler does not like too small picture */
 #define MINIMUM_WIDTH (32)
 
+/* Output lines scaled around each band, per 1x of upscaling */
+#define BAND_MARGIN (8)
+
 /* XXX is it always 3 even for BIG_ENDIAN (blend.c seems to think so) ? */
 #define OFFSET_A (3)
 
@@ -190,6 +215,8 @@ static int OpenScaler( vlc_object_t *p_this )
     p_sys->p_dst_a = NULL;
     p_sys->p_src_e = NULL;
     p_sys->p_dst_e = NULL;
+    p_sys->p_slices = NULL;
+    p_sys->p_bands = NULL;
     memset( &p_sys->fmt_in,  0, sizeof(p_sys->fmt_in) );
     memset( &p_sys->fmt_out, 0, sizeof(p_sys->fmt_out) );
 
@@ -341,6 +368,99 @@ static int GetParameters( ScalerConfiguration *p_cfg,
     return VLC_SUCCESS;
 }
 
+/* Scales the bands of the picture on several threads, if it is worth it.
+ * On failure, the whole picture is scaled by the vout thread. */
+static void InitBands( filter_t *p_filter, const ScalerConfiguration *p_cfg )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const video_format_t *p_fmti = &p_filter->fmt_in.video;
+    const video_format_t *p_fmto = &p_filter->fmt_out.video;
+    const unsigned i_src = p_fmti->i_height;
+    const unsigned i_dst = p_fmto->i_height;
+
+    if( p_fmti->i_chroma == VLC_CODEC_RGBP ||
+        !vlc_fourcc_GetChromaDescription( p_fmti->i_chroma ) ||
+        !vlc_fourcc_GetChromaDescription( p_fmto->i_chroma ) )
+        return;
+
+    /* The bands must start at the same relative position in both pictures,
+     * and on whole chroma lines (up to 4 lines for YUV410) */
+    const unsigned i_gcd = GCD( i_src, i_dst );
+    unsigned i_step_src = i_src / i_gcd;
+    unsigned i_step_dst = i_dst / i_gcd;
+    while( ( i_step_src % 4 ) || ( i_step_dst % 4 ) )
+    {
+        i_step_src *= 2;
+        i_step_dst *= 2;
+    }
+    if( 2 * i_step_dst > i_dst )
+        return;
+
+    unsigned i_margin = 0;
+    if( i_src != i_dst )
+    {
+        i_margin = BAND_MARGIN * ( ( i_dst + i_src - 1 ) / i_src );
+        i_margin = ( i_margin + i_step_dst - 1 ) / i_step_dst * i_step_dst;
+    }
+
+    filter_slices_t *p_slices = SlicesNew( VLC_OBJECT(p_filter), i_dst );
+    if( p_slices == NULL )
+        return;
+    const unsigned i_count = SlicesCount( p_slices );
+    scaler_band_t *p_bands = calloc( i_count, sizeof(*p_bands) );
+    if( unlikely(p_bands == NULL) )
+    {
+        SlicesDelete( p_slices );
+        return;
+    }
+    p_sys->p_slices = p_slices;
+    p_sys->p_bands = p_bands;
+
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        scaler_band_t *p_band = &p_bands[i];
+        unsigned i_first, i_last;
+
+        SlicesGetBand( i_dst, i_step_dst, i_count, i, &i_first, &i_last );
+        if( i_first >= i_last )
+            goto error;
+
+        /* Scaled lines, with the margins */
+        const unsigned i_top = i_first > i_margin ? i_first - i_margin : 0;
+        const unsigned i_bottom = __MIN( i_dst, i_last + i_margin );
+        const unsigned i_src_top = i_top / i_step_dst * i_step_src;
+        const unsigned i_src_bottom = i_bottom == i_dst ? i_src
+                                    : i_bottom / i_step_dst * i_step_src;
+
+        p_band->ctx = sws_getContext( p_fmti->i_width,
+                                      i_src_bottom - i_src_top, p_cfg->i_fmti,
+                                      p_fmto->i_width, i_bottom - i_top,
+                                      p_cfg->i_fmto,
+                                      p_cfg->i_sws_flags | p_sys->i_cpu_mask,
+                                      p_sys->p_src_filter,
+                                      p_sys->p_dst_filter, 0 );
+        if( p_band->ctx == NULL )
+            goto error;
+        if( i_margin > 0 )
+        {
+            p_band->p_pic = picture_New( p_fmto->i_chroma, p_fmto->i_width,
+                                         i_bottom - i_top, 0, 1 );
+            if( p_band->p_pic == NULL )
+                goto error;
+        }
+        p_band->i_src_first = i_src_top;
+        p_band->i_src_lines = i_src_bottom - i_src_top;
+        p_band->i_dst_first = i_first;
+        p_band->i_dst_lines = i_last - i_first;
+        p_band->i_margin = i_first - i_top;
+    }
+    return;
+
+error:
+    msg_Warn( p_filter, "cannot scale by bands" );
+    CleanBands( p_filter );
+}
+
 static int Init( filter_t *p_filter )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
@@ -422,6 +542,9 @@ static int Init( filter_t *p_filter )
     p_sys->b_swap_uvi = cfg.b_swap_uvi;
     p_sys->b_swap_uvo = cfg.b_swap_uvo;
 
+    if( !p_sys->b_copy && p_sys->i_extend_factor == 1 )
+        InitBands( p_filter, &cfg );
+
     video_format_ScaleCropAr( p_fmto, p_fmti );
 #if 0
     msg_Dbg( p_filter, "%ix%i chroma: %4.4s -> %ix%i chroma: %4.4s extend by %d",
@@ -435,6 +558,8 @@ static void Clean( filter_t *p_filter )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
 
+    CleanBands( p_filter );
+
     if( p_sys->p_src_e )
         picture_Release( p_sys->p_src_e );
     if( p_sys->p_dst_e )
@@ -460,6 +585,28 @@ static void Clean( filter_t *p_filter )
     p_sys->p_dst_e = NULL;
 }
 
+static void CleanBands( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->p_slices == NULL )
+        return;
+
+    for( unsigned i = 0; i < SlicesCount( p_sys->p_slices ); i++ )
+    {
+        scaler_band_t *p_band = &p_sys->p_bands[i];
+
+        if( p_band->ctx )
+            sws_freeContext( p_band->ctx );
+        if( p_band->p_pic )
+            picture_Release( p_band->p_pic );
+    }
+    free( p_sys->p_bands );
+    SlicesDelete( p_sys->p_slices );
+    p_sys->p_bands = NULL;
+    p_sys->p_slices = NULL;
+}
+
 static void GetPixels( uint8_t *pp_pixel[4], int pi_pitch[4],
                        const picture_t *p_picture,
                        int i_plane_start, int i_plane_count,
@@ -560,6 +707,65 @@ static void Convert( filter_t *p_filter, struct SwsContext *ctx,
 #endif
 }
 
+/* Gives the planes of p_pic from its line i_line on (without reference) */
+static void ShiftPicture( picture_t *p_shifted, const picture_t *p_pic,
+                          vlc_fourcc_t i_chroma, unsigned i_line )
+{
+    const vlc_chroma_description_t *p_dsc =
+        vlc_fourcc_GetChromaDescription( i_chroma );
+
+    *p_shifted = *p_pic;
+    for( unsigned n = 0; n < p_dsc->plane_count && (int)n < p_pic->i_planes; n++ )
+        p_shifted->p[n].p_pixels += i_line * p_dsc->p[n].h.num /
+                                    p_dsc->p[n].h.den * p_pic->p[n].i_pitch;
+}
+
+typedef struct
+{
+    filter_t  *p_filter;
+    picture_t *p_src;
+    picture_t *p_dst;
+} scaler_job_t;
+
+static void ConvertBand( void *p_data, unsigned i_slice )
+{
+    scaler_job_t *p_job = p_data;
+    filter_t *p_filter = p_job->p_filter;
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const scaler_band_t *p_band = &p_sys->p_bands[i_slice];
+    picture_t src, dst;
+
+    ShiftPicture( &src, p_job->p_src, p_filter->fmt_in.video.i_chroma,
+                  p_band->i_src_first );
+    if( p_band->p_pic == NULL )
+        ShiftPicture( &dst, p_job->p_dst, p_filter->fmt_out.video.i_chroma,
+                      p_band->i_dst_first );
+    Convert( p_filter, p_band->ctx, p_band->p_pic ? p_band->p_pic : &dst,
+             &src, p_band->i_src_lines, 0, 3,
+             p_sys->b_swap_uvi, p_sys->b_swap_uvo );
+    if( p_band->p_pic == NULL )
+        return;
+
+    /* Keep the band without its margins */
+    const vlc_chroma_description_t *p_dsc =
+        vlc_fourcc_GetChromaDescription( p_filter->fmt_out.video.i_chroma );
+    for( int n = 0; n < p_band->p_pic->i_planes; n++ )
+    {
+        const plane_t *s = &p_band->p_pic->p[n];
+        plane_t *d = &p_job->p_dst->p[n];
+        const unsigned i_num = p_dsc->p[n].h.num, i_den = p_dsc->p[n].h.den;
+        const unsigned i_first = p_band->i_dst_first * i_num / i_den;
+        const unsigned i_lines = ( ( p_band->i_dst_first + p_band->i_dst_lines )
+                                   * i_num + i_den - 1 ) / i_den - i_first;
+        const unsigned i_margin = p_band->i_margin * i_num / i_den;
+        const int i_width = __MIN( s->i_visible_pitch, d->i_visible_pitch );
+
+        for( unsigned y = 0; y < i_lines; y++ )
+            memcpy( &d->p_pixels[( i_first + y ) * d->i_pitch],
+                    &s->p_pixels[( i_margin + y ) * s->i_pitch], i_width );
+    }
+}
+
 /****************************************************************************
  * Filter: the whole thing
  ****************************************************************************
@@ -602,6 +808,11 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
         picture_CopyPixels( p_dst, p_src );
     else if( p_sys->b_copy )
         SwapUV( p_dst, p_src );
+    else if( p_sys->p_slices != NULL )
+    {
+        scaler_job_t job = { p_filter, p_src, p_dst };
+        SlicesRun( p_sys->p_slices, ConvertBand, &job );
+    }
     else
         Convert( p_filter, p_sys->ctx, p_dst, p_src, p_fmti->i_height, 0, 3,
                  p_sys->b_swap_uvi, p_sys->b_swap_uvo );
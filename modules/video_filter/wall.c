@@ -379,10 +379,51 @@ static void Close( vlc_object_t *p_this )
     free( p_sys );
 }
 
+/**
+ * This function makes every output refer to its part of the source without
+ * any copy, if all the outputs allow it.
+ */
+static int FilterRef( video_splitter_t *p_splitter, picture_t *pp_dst[], picture_t *p_src )
+{
+    video_splitter_sys_t *p_sys = p_splitter->p_sys;
+    int pi_done[COL_MAX*ROW_MAX];
+    int i_done = 0;
+
+    for( int y = 0; y < p_sys->i_row; y++ )
+    {
+        for( int x = 0; x < p_sys->i_col; x++ )
+        {
+            wall_output_t *p_output = &p_sys->pp_output[x][y];
+            if( !p_output->b_active )
+                continue;
+
+            pp_dst[p_output->i_output] =
+                video_splitter_RefPicture( p_splitter, p_output->i_output,
+                                           p_src, p_output->i_left,
+                                           p_output->i_top );
+            if( !pp_dst[p_output->i_output] )
+            {
+                /* Release the outputs already referring to the source */
+                for( int i = 0; i < i_done; i++ )
+                    picture_Release( pp_dst[pi_done[i]] );
+                return VLC_EGENERIC;
+            }
+            pi_done[i_done++] = p_output->i_output;
+        }
+    }
+    return VLC_SUCCESS;
+}
+
 static int Filter( video_splitter_t *p_splitter, picture_t *pp_dst[], picture_t *p_src )
 {
     video_splitter_sys_t *p_sys = p_splitter->p_sys;
 
+    if( !FilterRef( p_splitter, pp_dst, p_src ) )
+    {
+        picture_Release( p_src );
+        return VLC_SUCCESS;
+    }
+
     if( video_splitter_NewPicture( p_splitter, pp_dst ) )
     {
         picture_Release( p_src );
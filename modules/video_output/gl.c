@@ -78,6 +78,7 @@ vlc_module_begin ()
     add_shortcut ("opengl", "gl")
     add_module ("gl", "opengl", NULL,
                 GL_TEXT, PROVIDER_LONGTEXT, true)
+    add_opengl_filters ()
 #endif
 vlc_module_end ()
 
@@ -138,13 +139,25 @@ static int Open (vlc_object_t *obj)
         goto error;
 
     /* Initialize video display */
-    sys->vgl = vout_display_opengl_New (&vd->fmt, NULL, sys->gl);
+    const vlc_fourcc_t *spu_chromas;
+#if !USE_OPENGL_ES
+    char *deinterlace = var_InheritString (vd, "gl-deinterlace");
+    char *scaler = var_InheritString (vd, "gl-scaler");
+    sys->vgl = vout_display_opengl_NewFiltered (&vd->fmt, &spu_chromas, sys->gl,
+                                                deinterlace, scaler);
+    free (scaler);
+    free (deinterlace);
+#else
+    sys->vgl = vout_display_opengl_New (&vd->fmt, &spu_chromas, sys->gl);
+#endif
     if (!sys->vgl)
         goto error;
 
     vd->sys = sys;
     vd->info.has_pictures_invalid = false;
     vd->info.has_event_thread = false;
+    /* Subpictures are composited as textures over the video */
+    vd->info.subpicture_chromas = spu_chromas;
     vd->pool = Pool;
     vd->prepare = PictureRender;
     vd->display = PictureDisplay;
@@ -28,6 +28,8 @@
 # include "config.h"
 #endif
 
+#include <stdarg.h>
+
 #include <vlc_common.h>
 #include <vlc_picture_pool.h>
 #include <vlc_subpicture.h>
@@ -53,15 +55,63 @@
 #ifndef GL_CLAMP_TO_EDGE
 # define GL_CLAMP_TO_EDGE 0x812F
 #endif
+#ifndef GL_MAX_TEXTURE_IMAGE_UNITS_ARB
+# define GL_MAX_TEXTURE_IMAGE_UNITS_ARB 0x8872
+#endif
 
 #if USE_OPENGL_ES
 #   define VLCGL_TEXTURE_COUNT 1
 #   define VLCGL_PICTURE_MAX 1
 #else
-#   define VLCGL_TEXTURE_COUNT 1
+#   define VLCGL_TEXTURE_COUNT 3
 #   define VLCGL_PICTURE_MAX 128
 #endif
 
+/* Pictures in persistently mapped pixel buffers, the decoders writing
+ * straight into memory the GL can upload from without a copy */
+#if !USE_OPENGL_ES && !defined(MACOS_OPENGL) && \
+    defined(GL_ARB_buffer_storage) && defined(GL_ARB_sync)
+#   define VLCGL_PBO 1
+#endif
+
+/* Fragment program stages, see "gl-deinterlace" and "gl-scaler" */
+enum {
+    VLCGL_DEINTERLACE_NONE,
+    VLCGL_DEINTERLACE_BOB,
+    VLCGL_DEINTERLACE_LINEAR,
+    VLCGL_DEINTERLACE_ADAPTIVE,
+};
+static const char *const deinterlace_names[] = {
+    "", "bob", "linear", "adaptive",
+};
+
+enum {
+    VLCGL_SCALER_BILINEAR,
+    VLCGL_SCALER_BICUBIC,
+    VLCGL_SCALER_LANCZOS,
+};
+static const char *const scaler_names[] = {
+    "bilinear", "bicubic", "lanczos",
+};
+
+/* Program locals after the colour matrix: the size of the textures of
+ * each plane { w, h, 1/w, 1/h }, then { kept field, motion threshold,
+ * motion gain, 0 } for the deinterlacing */
+#define VLCGL_LOCAL_SIZE  4
+#define VLCGL_LOCAL_FIELD 7
+
+/* Motion (in 8 bits samples) below which the missing lines are woven,
+ * and above which they are fully interpolated */
+#define VLCGL_MOTION_LOW  6
+#define VLCGL_MOTION_HIGH 18
+
+#ifdef VLCGL_PBO
+struct picture_sys_t {
+    GLuint buffer;
+    size_t offset[PICTURE_PLANE_MAX];
+};
+#endif
+
 static const vlc_fourcc_t gl_subpicture_chromas[] = {
     VLC_CODEC_RGBA,
     0
@@ -96,7 +146,11 @@ struct vout_display_opengl_t {
     int        tex_width[PICTURE_PLANE_MAX];
     int        tex_height[PICTURE_PLANE_MAX];
 
+    /* Ring of textures, the pictures being uploaded in turn into the
+     * texture the GL is the least likely to still draw from */
     GLuint     texture[VLCGL_TEXTURE_COUNT][PICTURE_PLANE_MAX];
+    int        texture_count;
+    int        texture_index;
 
     int         region_count;
     gl_region_t *region;
@@ -105,9 +159,16 @@ struct vout_display_opengl_t {
     picture_pool_t *pool;
 
     GLuint     program;
+    GLuint     program_deinterlace; /* for the interlaced pictures, or 0 */
     int        local_count;
     GLfloat    local_value[16][4];
 
+    /* Deinterlacing, the previous picture (for the adaptive mode) being
+     * the one before in the ring of textures */
+    int        deinterlace;
+    bool       interlaced; /* whether the prepared picture is */
+    bool       has_prev;
+
     /* fragment_program */
     PFNGLGENPROGRAMSARBPROC              GenProgramsARB;
     PFNGLBINDPROGRAMARBPROC              BindProgramARB;
@@ -119,6 +180,23 @@ struct vout_display_opengl_t {
     bool use_multitexture;
     PFNGLACTIVETEXTUREARBPROC   ActiveTextureARB;
     PFNGLMULTITEXCOORD2FARBPROC MultiTexCoord2fARB;
+
+#ifdef VLCGL_PBO
+    /* pixel buffers */
+    bool use_pbo;
+    int            pbo_count;
+    picture_sys_t *pbo[VLCGL_PICTURE_MAX];
+    GLsync         fence; /* of the last upload */
+    PFNGLGENBUFFERSPROC      GenBuffers;
+    PFNGLDELETEBUFFERSPROC   DeleteBuffers;
+    PFNGLBINDBUFFERPROC      BindBuffer;
+    PFNGLBUFFERSTORAGEPROC   BufferStorage;
+    PFNGLMAPBUFFERRANGEPROC  MapBufferRange;
+    PFNGLUNMAPBUFFERPROC     UnmapBuffer;
+    PFNGLFENCESYNCPROC       FenceSync;
+    PFNGLCLIENTWAITSYNCPROC  ClientWaitSync;
+    PFNGLDELETESYNCPROC      DeleteSync;
+#endif
 };
 
 static inline int GetAlignedSize(unsigned size)
@@ -162,9 +240,259 @@ static bool IsLuminance16Supported(int target)
     return size == 16;
 }
 
+static int FindName(const char *name, const char *const *names, int count)
+{
+    for (int i = 0; name && i < count; i++) {
+        if (!strcmp(name, names[i]))
+            return i;
+    }
+    return 0;
+}
+
+/* Appends to a fragment program, which is freed on error */
+static void AppendCode(char **code, const char *format, ...)
+{
+    if (!*code)
+        return;
+
+    va_list ap;
+    char *add;
+    va_start(ap, format);
+    int len = vasprintf(&add, format, ap);
+    va_end(ap);
+
+    char *grown = len >= 0 ? realloc(*code, strlen(*code) + len + 1) : NULL;
+    if (grown)
+        strcat(grown, add);
+    else
+        free(*code);
+    if (len >= 0)
+        free(add);
+    *code = grown;
+}
+
+/* Computes the 4 weights of the taps around the sample, in the temporary
+ * w<axis>, from its distance f.<axis> to the second tap */
+static void AppendWeights(char **code, int scaler, char axis)
+{
+    if (scaler == VLCGL_SCALER_BICUBIC) {
+        /* Catmull-Rom spline */
+        AppendCode(code,
+            "MAD w%c, f.%c, cubic[0], cubic[1];"
+            "MAD w%c, w%c, f.%c, cubic[2];"
+            "MAD w%c, w%c, f.%c, cubic[3];",
+            axis, axis, axis, axis, axis, axis, axis, axis);
+        return;
+    }
+
+    /* Lanczos 2: sin(pi d) sin(pi d / 2) / (pi d)^2 for the distances d
+     * to the taps, normalized as the window is short */
+    AppendCode(code,
+        "MAD m, f.%c, lanczos_sign, lanczos_dist;"
+        "MAX m, m, lanczos.z;"
+        "MUL p, m, lanczos.x;"
+        "SIN w.x, p.x; SIN w.y, p.y; SIN w.z, p.z; SIN w.w, p.w;"
+        "MUL p, m, lanczos.y;"
+        "SIN d.x, p.x; SIN d.y, p.y; SIN d.z, p.z; SIN d.w, p.w;"
+        "MUL w, w, d;"
+        "MUL m, m, m;"
+        "RCP d.x, m.x; RCP d.y, m.y; RCP d.z, m.z; RCP d.w, m.w;"
+        "MUL w, w, d;"
+        "DP4 d.x, w, lanczos.w;"
+        "RCP d.x, d.x;"
+        "MUL w%c, w, d.x;",
+        axis, axis);
+}
+
+/* Samples the plane into src.<component> with 4x4 taps (the luminance
+ * textures give an alpha of 1, hence the fourth tap through tmp) */
+static void AppendScaler(char **code, int scaler, unsigned plane, char component)
+{
+    static const char tap[] = "xyzw";
+
+    AppendCode(code,
+        "MUL pos, fragment.texcoord[%u], size%u;"
+        "ADD pos, pos, offset.x;"
+        "FLR base, pos;"
+        "SUB f, pos, base;",
+        plane, plane);
+    AppendWeights(code, scaler, 'x');
+    AppendWeights(code, scaler, 'y');
+
+    /* Texel centres of the columns and of the rows of the taps, the
+     * columns paired as t.xy, t.zw, u.xy and u.zw */
+    AppendCode(code,
+        "ADD base, base, offset.y;"
+        "ADD coord, base.x, taps;"
+        "MUL coord, coord, size%u.z;"
+        "MOV t.xz, coord.xxyy;"
+        "MOV u.xz, coord.zzww;"
+        "ADD coord, base.y, taps;"
+        "MUL coord, coord, size%u.w;",
+        plane, plane);
+    for (int j = 0; j < 4; j++)
+        AppendCode(code,
+            "MOV t.yw, coord.%c;"
+            "MOV u.yw, coord.%c;"
+            "TEX s.x, t, texture[%u], 2D;"
+            "TEX s.y, t.zwzw, texture[%u], 2D;"
+            "TEX s.z, u, texture[%u], 2D;"
+            "TEX tmp, u.zwzw, texture[%u], 2D;"
+            "MOV s.w, tmp.x;"
+            "DP4 row.%c, s, wx;",
+            tap[j], tap[j], plane, plane, plane, plane, tap[j]);
+    AppendCode(code, "DP4 src.%c, row, wy;", component);
+}
+
+/* Samples the plane into src.<component>, rebuilding the lines of the
+ * field which is not kept, and interpolating vertically between the two
+ * lines around the sample */
+static void AppendDeinterlace(char **code, int deinterlace, unsigned plane,
+                              char component)
+{
+    /* line.y:  the line above the sample, f.y: the distance to it,
+     * miss.x: 0.5 if it belongs to the missing field, 0 otherwise,
+     * s: the lines from line.y - 1 to line.y + 2 */
+    AppendCode(code,
+        "MUL pos, fragment.texcoord[%u], size%u;"
+        "ADD pos.y, pos.y, offset.x;"
+        "FLR line.y, pos.y;"
+        "SUB f.y, pos.y, line.y;"
+        "SUB miss.x, line.y, field.x;"
+        "MUL miss.x, miss.x, offset.y;"
+        "FRC miss.x, miss.x;"
+        "MOV coord, fragment.texcoord[%u];"
+        "ADD coord.y, line.y, offset.x;"
+        "MUL coord.y, coord.y, size%u.w;"
+        "TEX s.x, coord, texture[%u], 2D;"
+        "ADD coord.y, line.y, offset.y;"
+        "MUL coord.y, coord.y, size%u.w;"
+        "TEX s.y, coord, texture[%u], 2D;"
+        "ADD coord.y, line.y, offset.z;"
+        "MUL coord.y, coord.y, size%u.w;"
+        "TEX s.z, coord, texture[%u], 2D;"
+        "ADD coord.y, line.y, offset.w;"
+        "MUL coord.y, coord.y, size%u.w;"
+        "TEX tmp, coord, texture[%u], 2D;"
+        "MOV s.w, tmp.x;",
+        plane, plane, plane, plane, plane, plane, plane,
+        plane, plane, plane, plane);
+
+    /* m.x, m.y: the lines line.y and line.y + 1 if they are missing */
+    if (deinterlace == VLCGL_DEINTERLACE_BOB) {
+        AppendCode(code, "MOV m.xy, s;");
+    } else {
+        AppendCode(code,
+            "ADD m.x, s.x, s.z;"
+            "ADD m.y, s.y, s.w;"
+            "MUL m, m, offset.y;");
+    }
+    if (deinterlace == VLCGL_DEINTERLACE_ADAPTIVE) {
+        /* Weave where the lines of the missing field of the previous
+         * picture (in texture[3 + plane]) are about the same */
+        AppendCode(code,
+            "ADD coord.y, line.y, offset.y;"
+            "MUL coord.y, coord.y, size%u.w;"
+            "TEX p.x, coord, texture[%u], 2D;"
+            "ADD coord.y, line.y, offset.z;"
+            "MUL coord.y, coord.y, size%u.w;"
+            "TEX p.y, coord, texture[%u], 2D;"
+            "SUB w.x, s.y, p.x;"
+            "SUB w.y, s.z, p.y;"
+            "ABS w, w;"
+            "SUB w, w, field.y;"
+            "MUL_SAT w, w, field.z;"
+            "LRP m.x, w.x, m.x, s.y;"
+            "LRP m.y, w.y, m.y, s.z;",
+            plane, 3 + plane, plane, 3 + plane);
+    }
+    AppendCode(code,
+        "CMP d.x, -miss.x, m.x, s.y;"
+        "CMP d.y, -miss.x, s.z, m.y;"
+        "LRP src.%c, f.y, d.y, d.x;",
+        component);
+}
+
+/* Builds the YUV program with the given stages, the scaler applying to
+ * the luma only */
+static char *BuildFilteredProgram(int deinterlace, int scaler, bool swap_uv)
+{
+    char *code = strdup(
+        "!!ARBfp1.0"
+        "OPTION ARB_precision_hint_nicest;"
+
+        "TEMP src, tmp, pos, base, f, coord, t, u, s, row, wx, wy, w, m, d, p;"
+        "TEMP line, miss;"
+
+        "PARAM coefficient[4] = { program.local[0..3] };"
+        "PARAM size0 = program.local[4];"
+        "PARAM size1 = program.local[5];"
+        "PARAM size2 = program.local[6];"
+        "PARAM field = program.local[7];"
+        "PARAM offset = { -0.5, 0.5, 1.5, 2.5 };"
+        "PARAM taps = { -1.0, 0.0, 1.0, 2.0 };"
+        "PARAM cubic[4] = { { -0.5,  1.5, -1.5,  0.5 },"
+                           "{  1.0, -2.5,  2.0, -0.5 },"
+                           "{ -0.5,  0.0,  0.5,  0.0 },"
+                           "{  0.0,  1.0,  0.0,  0.0 } };"
+        "PARAM lanczos = { 3.14159265, 1.57079633, 0.00001, 1.0 };"
+        "PARAM lanczos_sign = { 1.0, 1.0, -1.0, -1.0 };"
+        "PARAM lanczos_dist = { 1.0, 0.0, 1.0, 2.0 };");
+
+    const char component[3] = { 'x', swap_uv ? 'z' : 'y', swap_uv ? 'y' : 'z' };
+    for (unsigned j = 0; j < 3; j++) {
+        if (deinterlace != VLCGL_DEINTERLACE_NONE)
+            AppendDeinterlace(&code, deinterlace, j, component[j]);
+        else if (j == 0 && scaler != VLCGL_SCALER_BILINEAR)
+            AppendScaler(&code, scaler, j, component[j]);
+        else
+            AppendCode(&code, "TEX src.%c, fragment.texcoord[%u], texture[%u], 2D;",
+                       component[j], j, j);
+    }
+    AppendCode(&code,
+        "MAD  tmp.rgb,          src.xxxx, coefficient[0], coefficient[3];"
+        "MAD  tmp.rgb,          src.yyyy, coefficient[1], tmp;"
+        "MAD  result.color.rgb, src.zzzz, coefficient[2], tmp;"
+        "END");
+    return code;
+}
+
+static GLuint CompileProgram(vout_display_opengl_t *vgl, const char *code)
+{
+    GLuint program;
+
+    vgl->GenProgramsARB(1, &program);
+    vgl->BindProgramARB(GL_FRAGMENT_PROGRAM_ARB, program);
+    vgl->ProgramStringARB(GL_FRAGMENT_PROGRAM_ARB,
+                          GL_PROGRAM_FORMAT_ASCII_ARB,
+                          strlen(code), (const GLbyte*)code);
+    if (glGetError() == GL_INVALID_OPERATION) {
+#if 0
+        GLint position;
+        glGetIntegerv(GL_PROGRAM_ERROR_POSITION_ARB, &position);
+
+        const char *msg = (const char *)glGetString(GL_PROGRAM_ERROR_STRING_ARB);
+        fprintf(stderr, "GL_INVALID_OPERATION: error at %d: %s\n", position, msg);
+#endif
+        vgl->DeleteProgramsARB(1, &program);
+        program = 0;
+    }
+    return program;
+}
+
 vout_display_opengl_t *vout_display_opengl_New(video_format_t *fmt,
                                                const vlc_fourcc_t **subpicture_chromas,
                                                vlc_gl_t *gl)
+{
+    return vout_display_opengl_NewFiltered(fmt, subpicture_chromas, gl,
+                                           NULL, NULL);
+}
+
+vout_display_opengl_t *vout_display_opengl_NewFiltered(video_format_t *fmt,
+                                                       const vlc_fourcc_t **subpicture_chromas,
+                                                       vlc_gl_t *gl,
+                                                       const char *deinterlace,
+                                                       const char *scaler)
 {
     vout_display_opengl_t *vgl = calloc(1, sizeof(*vgl));
     if (!vgl)
@@ -217,6 +545,30 @@ vout_display_opengl_t *vout_display_opengl_New(video_format_t *fmt,
             glGetIntegerv(GL_MAX_TEXTURE_UNITS_ARB, &max_texture_units);
     }
 
+#ifdef VLCGL_PBO
+    if (HasExtension(extensions, "GL_ARB_pixel_buffer_object") &&
+        HasExtension(extensions, "GL_ARB_map_buffer_range") &&
+        HasExtension(extensions, "GL_ARB_buffer_storage") &&
+        HasExtension(extensions, "GL_ARB_sync")) {
+        vgl->GenBuffers     = (PFNGLGENBUFFERSPROC)vlc_gl_GetProcAddress(vgl->gl, "glGenBuffers");
+        vgl->DeleteBuffers  = (PFNGLDELETEBUFFERSPROC)vlc_gl_GetProcAddress(vgl->gl, "glDeleteBuffers");
+        vgl->BindBuffer     = (PFNGLBINDBUFFERPROC)vlc_gl_GetProcAddress(vgl->gl, "glBindBuffer");
+        vgl->BufferStorage  = (PFNGLBUFFERSTORAGEPROC)vlc_gl_GetProcAddress(vgl->gl, "glBufferStorage");
+        vgl->MapBufferRange = (PFNGLMAPBUFFERRANGEPROC)vlc_gl_GetProcAddress(vgl->gl, "glMapBufferRange");
+        vgl->UnmapBuffer    = (PFNGLUNMAPBUFFERPROC)vlc_gl_GetProcAddress(vgl->gl, "glUnmapBuffer");
+        vgl->FenceSync      = (PFNGLFENCESYNCPROC)vlc_gl_GetProcAddress(vgl->gl, "glFenceSync");
+        vgl->ClientWaitSync = (PFNGLCLIENTWAITSYNCPROC)vlc_gl_GetProcAddress(vgl->gl, "glClientWaitSync");
+        vgl->DeleteSync     = (PFNGLDELETESYNCPROC)vlc_gl_GetProcAddress(vgl->gl, "glDeleteSync");
+        vgl->use_pbo = vgl->GenBuffers && vgl->DeleteBuffers &&
+                       vgl->BindBuffer && vgl->BufferStorage &&
+                       vgl->MapBufferRange && vgl->UnmapBuffer &&
+                       vgl->FenceSync && vgl->ClientWaitSync &&
+                       vgl->DeleteSync;
+    }
+    vgl->pbo_count = 0;
+    vgl->fence = NULL;
+#endif
+
     /* Initialize with default chroma */
     vgl->fmt = *fmt;
 #if USE_OPENGL_ES
@@ -322,9 +674,15 @@ vout_display_opengl_t *vout_display_opengl_New(video_format_t *fmt,
 
     /* Build fragment program if needed */
     vgl->program = 0;
+    vgl->program_deinterlace = 0;
     vgl->local_count = 0;
+    vgl->deinterlace = FindName(deinterlace, deinterlace_names,
+                                ARRAY_SIZE(deinterlace_names));
+    int scaler_id = FindName(scaler, scaler_names, ARRAY_SIZE(scaler_names));
     if (supports_fp) {
         char *code = NULL;
+        char *code_plain = NULL;
+        char *code_deinterlace = NULL;
 
         if (need_fs_yuv) {
             /* [R/G/B][Y U V O] from TV range to full range
@@ -375,29 +733,72 @@ vout_display_opengl_t *vout_display_opengl_New(video_format_t *fmt,
                 }
             }
             vgl->local_count += 4;
-        }
-        if (code) {
-        // Here you have shaders
-            vgl->GenProgramsARB(1, &vgl->program);
-            vgl->BindProgramARB(GL_FRAGMENT_PROGRAM_ARB, vgl->program);
-            vgl->ProgramStringARB(GL_FRAGMENT_PROGRAM_ARB,
-                                  GL_PROGRAM_FORMAT_ASCII_ARB,
-                                  strlen(code), (const GLbyte*)code);
-            if (glGetError() == GL_INVALID_OPERATION) {
-                /* FIXME if the program was needed for YUV, the video will be broken */
-#if 0
-                GLint position;
-                glGetIntegerv(GL_PROGRAM_ERROR_POSITION_ARB, &position);
 
-                const char *msg = (const char *)glGetString(GL_PROGRAM_ERROR_STRING_ARB);
-                fprintf(stderr, "GL_INVALID_OPERATION: error at %d: %s\n", position, msg);
-#endif
-                vgl->DeleteProgramsARB(1, &vgl->program);
-                vgl->program = 0;
+            /* The adaptive deinterlacing samples the previous picture too */
+            GLint max_image_units = 0;
+            if (vgl->deinterlace == VLCGL_DEINTERLACE_ADAPTIVE)
+                glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS_ARB, &max_image_units);
+            if (vgl->deinterlace == VLCGL_DEINTERLACE_ADAPTIVE && max_image_units < 6)
+                vgl->deinterlace = VLCGL_DEINTERLACE_LINEAR;
+
+            if (vgl->tex_target == GL_TEXTURE_2D &&
+                (vgl->deinterlace != VLCGL_DEINTERLACE_NONE ||
+                 scaler_id != VLCGL_SCALER_BILINEAR)) {
+                for (unsigned j = 0; j < 3; j++) {
+                    GLfloat *size = vgl->local_value[VLCGL_LOCAL_SIZE + j];
+                    size[0] = vgl->tex_width[j];
+                    size[1] = vgl->tex_height[j];
+                    size[2] = 1.0 / vgl->tex_width[j];
+                    size[3] = 1.0 / vgl->tex_height[j];
+                }
+                GLfloat *field = vgl->local_value[VLCGL_LOCAL_FIELD];
+                field[0] = 0.0;
+                field[1] = VLCGL_MOTION_LOW / 255.0 / yuv_range_correction;
+                field[2] = 255.0 * yuv_range_correction /
+                           (VLCGL_MOTION_HIGH - VLCGL_MOTION_LOW);
+                field[3] = 0.0;
+                vgl->local_count = VLCGL_LOCAL_FIELD + 1;
+
+                if (vgl->deinterlace != VLCGL_DEINTERLACE_NONE)
+                    code_deinterlace = BuildFilteredProgram(vgl->deinterlace,
+                                                            VLCGL_SCALER_BILINEAR,
+                                                            swap_uv);
+                if (scaler_id != VLCGL_SCALER_BILINEAR) {
+                    code_plain = code;
+                    code = BuildFilteredProgram(VLCGL_DEINTERLACE_NONE,
+                                                scaler_id, swap_uv);
+                }
             }
+        }
+        if (code || code_plain) {
+        // Here you have shaders
+            if (code)
+                vgl->program = CompileProgram(vgl, code);
+            /* Without the scaler, if the driver cannot run it */
+            if (!vgl->program && code_plain)
+                vgl->program = CompileProgram(vgl, code_plain);
+            /* FIXME if the program was needed for YUV, the video will be broken */
             free(code);
+            free(code_plain);
+        }
+        if (code_deinterlace) {
+            vgl->program_deinterlace = CompileProgram(vgl, code_deinterlace);
+            free(code_deinterlace);
         }
     }
+    if (!vgl->program_deinterlace)
+        vgl->deinterlace = VLCGL_DEINTERLACE_NONE;
+
+    /* The adaptive deinterlacing needs the previous picture at least */
+    vgl->texture_count = 1;
+#ifdef VLCGL_PBO
+    if (vgl->use_pbo)
+        vgl->texture_count = VLCGL_TEXTURE_COUNT;
+#endif
+    if (vgl->deinterlace == VLCGL_DEINTERLACE_ADAPTIVE)
+        vgl->texture_count = __MIN(__MAX(vgl->texture_count, 2),
+                                   VLCGL_TEXTURE_COUNT);
+    vgl->texture_index = 0;
 
     /* */
     glDisable(GL_BLEND);
@@ -414,6 +815,8 @@ vout_display_opengl_t *vout_display_opengl_New(video_format_t *fmt,
         for (int j = 0; j < PICTURE_PLANE_MAX; j++)
             vgl->texture[i][j] = 0;
     }
+    vgl->interlaced = false;
+    vgl->has_prev = false;
     vgl->region_count = 0;
     vgl->region = NULL;
     vgl->pool = NULL;
@@ -429,6 +832,76 @@ vout_display_opengl_t *vout_display_opengl_New(video_format_t *fmt,
     return vgl;
 }
 
+#ifdef VLCGL_PBO
+/* Allocates a picture in a pixel buffer mapped for good (the GL being
+ * locked) */
+static picture_t *NewBufferPicture(vout_display_opengl_t *vgl)
+{
+    picture_t layout;
+    memset(&layout, 0, sizeof(layout));
+    if (picture_Setup(&layout, vgl->fmt.i_chroma,
+                      vgl->fmt.i_width, vgl->fmt.i_height,
+                      vgl->fmt.i_sar_num, vgl->fmt.i_sar_den))
+        return NULL;
+
+    picture_sys_t *sys = malloc(sizeof(*sys));
+    if (!sys)
+        return NULL;
+
+    size_t size = 0;
+    for (int i = 0; i < layout.i_planes; i++) {
+        sys->offset[i] = size;
+        size += layout.p[i].i_pitch * layout.p[i].i_lines;
+    }
+
+    /* In cached memory if possible, as the decoders read their reference
+     * pictures back */
+    const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT |
+                             GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    vgl->GenBuffers(1, &sys->buffer);
+    vgl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, sys->buffer);
+    vgl->BufferStorage(GL_PIXEL_UNPACK_BUFFER, size, NULL,
+                       flags | GL_CLIENT_STORAGE_BIT);
+    uint8_t *pixels = vgl->MapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+
+    picture_t *picture = NULL;
+    if (pixels) {
+        picture_resource_t rsc;
+        memset(&rsc, 0, sizeof(rsc));
+        rsc.p_sys = sys;
+        for (int i = 0; i < layout.i_planes; i++) {
+            rsc.p[i].p_pixels = &pixels[sys->offset[i]];
+            rsc.p[i].i_lines  = layout.p[i].i_lines;
+            rsc.p[i].i_pitch  = layout.p[i].i_pitch;
+        }
+        picture = picture_NewFromResource(&vgl->fmt, &rsc);
+        if (!picture)
+            vgl->UnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+    vgl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (!picture) {
+        vgl->DeleteBuffers(1, &sys->buffer);
+        free(sys);
+        return NULL;
+    }
+    vgl->pbo[vgl->pbo_count++] = sys;
+    return picture;
+}
+
+/* Releases the pixel buffers of the pictures, the GL being locked */
+static void DeleteBufferPictures(vout_display_opengl_t *vgl)
+{
+    for (int i = 0; i < vgl->pbo_count; i++) {
+        vgl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, vgl->pbo[i]->buffer);
+        vgl->UnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        vgl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        vgl->DeleteBuffers(1, &vgl->pbo[i]->buffer);
+    }
+    vgl->pbo_count = 0;
+}
+#endif
+
 void vout_display_opengl_Delete(vout_display_opengl_t *vgl)
 {
     /* */
@@ -436,8 +909,13 @@ void vout_display_opengl_Delete(vout_display_opengl_t *vgl)
 
         glFinish();
         glFlush();
-        for (int i = 0; i < VLCGL_TEXTURE_COUNT; i++)
+        for (int i = 0; i < vgl->texture_count; i++)
             glDeleteTextures(vgl->chroma->plane_count, vgl->texture[i]);
+#ifdef VLCGL_PBO
+        if (vgl->fence)
+            vgl->DeleteSync(vgl->fence);
+        DeleteBufferPictures(vgl);
+#endif
         for (int i = 0; i < vgl->region_count; i++) {
             if (vgl->region[i].texture)
                 glDeleteTextures(1, &vgl->region[i].texture);
@@ -446,6 +924,8 @@ void vout_display_opengl_Delete(vout_display_opengl_t *vgl)
 
         if (vgl->program)
             vgl->DeleteProgramsARB(1, &vgl->program);
+        if (vgl->program_deinterlace)
+            vgl->DeleteProgramsARB(1, &vgl->program_deinterlace);
 
         vlc_gl_Unlock(vgl->gl);
     }
@@ -463,7 +943,18 @@ picture_pool_t *vout_display_opengl_GetPool(vout_display_opengl_t *vgl, unsigned
     picture_t *picture[VLCGL_PICTURE_MAX] = {NULL, };
     unsigned count = 0;
 
-    for (count = 0; count < __MIN(VLCGL_PICTURE_MAX, requested_count); count++) {
+#ifdef VLCGL_PBO
+    if (vgl->use_pbo && !vlc_gl_Lock(vgl->gl)) {
+        for (; count < __MIN(VLCGL_PICTURE_MAX, requested_count); count++) {
+            picture[count] = NewBufferPicture(vgl);
+            if (!picture[count])
+                break;
+        }
+        vlc_gl_Unlock(vgl->gl);
+    }
+#endif
+    /* The remaining ones in memory */
+    for (; count < __MIN(VLCGL_PICTURE_MAX, requested_count); count++) {
         picture[count] = picture_NewFromFormat(&vgl->fmt);
         if (!picture[count])
             break;
@@ -484,7 +975,7 @@ picture_pool_t *vout_display_opengl_GetPool(vout_display_opengl_t *vgl, unsigned
     if (vlc_gl_Lock(vgl->gl))
         return vgl->pool;
 
-    for (int i = 0; i < VLCGL_TEXTURE_COUNT; i++) {
+    for (int i = 0; i < vgl->texture_count; i++) {
         glGenTextures(vgl->chroma->plane_count, vgl->texture[i]);
         for (unsigned j = 0; j < vgl->chroma->plane_count; j++) {
             if (vgl->use_multitexture)
@@ -514,6 +1005,13 @@ picture_pool_t *vout_display_opengl_GetPool(vout_display_opengl_t *vgl, unsigned
     return vgl->pool;
 
 error:
+#ifdef VLCGL_PBO
+    if (vgl->pbo_count > 0 && !vlc_gl_Lock(vgl->gl)) {
+        DeleteBufferPictures(vgl);
+        vlc_gl_Unlock(vgl->gl);
+    }
+    vgl->pbo_count = 0;
+#endif
     for (unsigned i = 0; i < count; i++)
         picture_Delete(picture[i]);
     return NULL;
@@ -541,18 +1039,59 @@ int vout_display_opengl_Prepare(vout_display_opengl_t *vgl,
     if (vlc_gl_Lock(vgl->gl))
         return VLC_EGENERIC;
 
+    /* Keep the field shown first */
+    vgl->interlaced = vgl->program_deinterlace && !picture->b_progressive;
+    vgl->local_value[VLCGL_LOCAL_FIELD][0] = picture->b_top_field_first ? 0.0 : 1.0;
+
+    /* Upload into the next texture of the ring */
+    const int previous = vgl->texture_index;
+    vgl->texture_index = (vgl->texture_index + 1) % vgl->texture_count;
+
+#ifdef VLCGL_PBO
+    /* From the pixel buffer of the picture, if it has one */
+    const picture_sys_t *sys = NULL;
+    for (int i = 0; i < vgl->pbo_count; i++) {
+        if (vgl->pbo[i] == picture->p_sys)
+            sys = picture->p_sys;
+    }
+    if (sys)
+        vgl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, sys->buffer);
+#endif
+
     /* Update the texture */
     for (unsigned j = 0; j < vgl->chroma->plane_count; j++) {
+        const void *pixels = picture->p[j].p_pixels;
+#ifdef VLCGL_PBO
+        if (sys)
+            pixels = (const void *)(uintptr_t)sys->offset[j];
+#endif
         if (vgl->use_multitexture)
             vgl->ActiveTextureARB(GL_TEXTURE0_ARB + j);
-        glBindTexture(vgl->tex_target, vgl->texture[0][j]);
         glPixelStorei(GL_UNPACK_ROW_LENGTH, picture->p[j].i_pitch / picture->p[j].i_pixel_pitch);
-        glTexSubImage2D(vgl->tex_target, 0,
-                        0, 0,
-                        vgl->fmt.i_width  * vgl->chroma->p[j].w.num / vgl->chroma->p[j].w.den,
-                        vgl->fmt.i_height * vgl->chroma->p[j].h.num / vgl->chroma->p[j].h.den,
-                        vgl->tex_format, vgl->tex_type, picture->p[j].p_pixels);
+        for (int k = 0; k < 2; k++) {
+            /* The first picture stands for the previous one too */
+            if (k == 1 && (vgl->texture_count < 2 || vgl->has_prev))
+                break;
+            glBindTexture(vgl->tex_target, vgl->texture[k == 0 ? vgl->texture_index
+                                                               : previous][j]);
+            glTexSubImage2D(vgl->tex_target, 0,
+                            0, 0,
+                            vgl->fmt.i_width  * vgl->chroma->p[j].w.num / vgl->chroma->p[j].w.den,
+                            vgl->fmt.i_height * vgl->chroma->p[j].h.num / vgl->chroma->p[j].h.den,
+                            vgl->tex_format, vgl->tex_type, pixels);
+        }
+    }
+    vgl->has_prev = true;
+
+#ifdef VLCGL_PBO
+    if (sys) {
+        vgl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        /* Display() waits for the upload before the picture is released */
+        if (vgl->fence)
+            vgl->DeleteSync(vgl->fence);
+        vgl->fence = vgl->FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
     }
+#endif
 
     int         last_count = vgl->region_count;
     gl_region_t *last = vgl->region;
@@ -670,7 +1209,9 @@ int vout_display_opengl_Display(vout_display_opengl_t *vgl,
 
     glClear(GL_COLOR_BUFFER_BIT);
 
-    if (vgl->program) {
+    GLuint program = vgl->interlaced ? vgl->program_deinterlace : vgl->program;
+    if (program) {
+        vgl->BindProgramARB(GL_FRAGMENT_PROGRAM_ARB, program);
         glEnable(GL_FRAGMENT_PROGRAM_ARB);
         for (int i = 0; i < vgl->local_count; i++)
             vgl->ProgramLocalParameter4fvARB(GL_FRAGMENT_PROGRAM_ARB, i, vgl->local_value[i]);
@@ -703,7 +1244,15 @@ int vout_display_opengl_Display(vout_display_opengl_t *vgl,
     for (unsigned j = 0; j < vgl->chroma->plane_count; j++) {
         if (vgl->use_multitexture)
             vgl->ActiveTextureARB(GL_TEXTURE0_ARB + j);
-        glBindTexture(vgl->tex_target, vgl->texture[0][j]);
+        glBindTexture(vgl->tex_target, vgl->texture[vgl->texture_index][j]);
+    }
+    if (vgl->interlaced && vgl->deinterlace == VLCGL_DEINTERLACE_ADAPTIVE) {
+        const int previous = (vgl->texture_index + vgl->texture_count - 1) %
+                             vgl->texture_count;
+        for (unsigned j = 0; j < vgl->chroma->plane_count; j++) {
+            vgl->ActiveTextureARB(GL_TEXTURE0_ARB + 3 + j);
+            glBindTexture(vgl->tex_target, vgl->texture[previous][j]);
+        }
     }
     glBegin(GL_POLYGON);
 
@@ -730,7 +1279,7 @@ int vout_display_opengl_Display(vout_display_opengl_t *vgl,
     glEnd();
 #endif
 
-    if (vgl->program)
+    if (program)
         glDisable(GL_FRAGMENT_PROGRAM_ARB);
     else
         glDisable(vgl->tex_target);
@@ -770,6 +1319,16 @@ int vout_display_opengl_Display(vout_display_opengl_t *vgl,
 
     vlc_gl_Swap(vgl->gl);
 
+#ifdef VLCGL_PBO
+    /* The decoder may write into the picture again once it is released */
+    if (vgl->fence) {
+        vgl->ClientWaitSync(vgl->fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                            UINT64_C(1000000000));
+        vgl->DeleteSync(vgl->fence);
+        vgl->fence = NULL;
+    }
+#endif
+
     vlc_gl_Unlock(vgl->gl);
     return VLC_SUCCESS;
 }
@@ -71,9 +71,36 @@ static inline bool HasExtension(const char *apis, const char *api)
 
 typedef struct vout_display_opengl_t vout_display_opengl_t;
 
+/* Options of the fragment program stages, for the YUV pictures */
+#define GL_DEINTERLACE_TEXT N_("Deinterlacing by the GPU")
+#define GL_DEINTERLACE_LONGTEXT N_( \
+    "Deinterlace the interlaced pictures while drawing them: \"bob\", " \
+    "\"linear\" or \"adaptive\" (motion adaptive, linear where the " \
+    "picture moves). Keep the video deinterlacing off to use it.")
+#define GL_SCALER_TEXT N_("Scaling by the GPU")
+#define GL_SCALER_LONGTEXT N_( \
+    "Filter scaling the luma of the pictures to the window size: " \
+    "\"bilinear\", \"bicubic\" or \"lanczos\".")
+
+#define add_opengl_filters() \
+    add_string ("gl-deinterlace", NULL, GL_DEINTERLACE_TEXT, \
+                GL_DEINTERLACE_LONGTEXT, true) \
+    add_string ("gl-scaler", "bilinear", GL_SCALER_TEXT, \
+                GL_SCALER_LONGTEXT, true)
+
 vout_display_opengl_t *vout_display_opengl_New(video_format_t *fmt,
                                                const vlc_fourcc_t **subpicture_chromas,
                                                vlc_gl_t *gl);
+/**
+ * Same as vout_display_opengl_New(), with the deinterlacing and the
+ * scaling filters given by name (see "gl-deinterlace" and "gl-scaler"),
+ * NULL for none.
+ */
+vout_display_opengl_t *vout_display_opengl_NewFiltered(video_format_t *fmt,
+                                                       const vlc_fourcc_t **subpicture_chromas,
+                                                       vlc_gl_t *gl,
+                                                       const char *deinterlace,
+                                                       const char *scaler);
 void vout_display_opengl_Delete(vout_display_opengl_t *vgl);
 
 picture_pool_t *vout_display_opengl_GetPool(vout_display_opengl_t *vgl, unsigned);
@@ -29,8 +29,6 @@
 # include "config.h"
 #endif
 
-#include <assert.h>
-
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_vout_display.h>
@@ -247,8 +245,12 @@ static picture_pool_t *Pool(vout_display_t *vd, unsigned count)
     if (sys->pool)
         return sys->pool;
 
-    if (count > sys->count)
+    /* With that many buffers, the decoder renders directly into them */
+    if (count > sys->count) {
+        msg_Dbg(vd, "%u picture buffers would avoid a copy per picture, "
+                "%u given", count, sys->count);
         count = sys->count;
+    }
 
     picture_t *pictures[count];
 
@@ -299,7 +301,8 @@ static void Display(vout_display_t *vd, picture_t *picture, subpicture_t *subpic
 {
     vout_display_sys_t *sys = vd->sys;
 
-    assert(!picture_IsReferenced(picture));
+    /* When rendered directly, the picture may still be held by the decoder
+     * (as a reference) or by the video output (as the last one shown) */
     if (sys->display != NULL)
         sys->display(sys->opaque, picture->p_sys->id);
     picture_Release(picture);
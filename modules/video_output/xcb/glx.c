@@ -56,6 +56,7 @@ vlc_module_begin ()
     set_callbacks (Open, Close)
 
     add_shortcut ("xcb-glx", "glx", "opengl", "xid")
+    add_opengl_filters ()
 vlc_module_end ()
 
 struct vout_display_sys_t
@@ -396,7 +397,12 @@ static int Open (vlc_object_t *obj)
     sys->gl.sys = sys;
 
     const vlc_fourcc_t *subpicture_chromas;
-    sys->vgl = vout_display_opengl_New (&vd->fmt, &subpicture_chromas, &sys->gl);
+    char *deinterlace = var_InheritString (vd, "gl-deinterlace");
+    char *scaler = var_InheritString (vd, "gl-scaler");
+    sys->vgl = vout_display_opengl_NewFiltered (&vd->fmt, &subpicture_chromas,
+                                                &sys->gl, deinterlace, scaler);
+    free (scaler);
+    free (deinterlace);
     if (!sys->vgl)
     {
         sys->gl.sys = NULL;
@@ -642,12 +642,66 @@ static void Close (vlc_object_t *obj)
     free (p_sys);
 }
 
+/**
+ * Queries the layout of XVideo images as large as the pictures of the
+ * decoders (see picture_Setup()), so that they can decode straight into the
+ * shared memory segments. Returns NULL if the server layout would not suit
+ * them (planes not aligned on 16 bytes).
+ */
+static xcb_xv_query_image_attributes_reply_t *
+QueryAlignedImage (vout_display_t *vd)
+{
+    vout_display_sys_t *p_sys = vd->sys;
+    picture_t ref;
+
+    memset (&ref, 0, sizeof (ref));
+    if (picture_Setup (&ref, vd->fmt.i_chroma,
+                       vd->fmt.i_width, vd->fmt.i_height,
+                       vd->fmt.i_sar_num, vd->fmt.i_sar_den))
+        return NULL;
+
+    const unsigned width = ref.p[0].i_pitch / ref.p[0].i_pixel_pitch;
+    const unsigned height = ref.p[0].i_lines;
+    xcb_xv_query_image_attributes_reply_t *att =
+        xcb_xv_query_image_attributes_reply (p_sys->conn,
+            xcb_xv_query_image_attributes (p_sys->conn, p_sys->port,
+                                           p_sys->id, width, height), NULL);
+    if (att == NULL)
+        return NULL;
+
+    const uint32_t *pitches = xcb_xv_query_image_attributes_pitches (att);
+    const uint32_t *offsets = xcb_xv_query_image_attributes_offsets (att);
+    bool ok = att->width == width && att->height == height &&
+              att->num_planes == (unsigned)ref.i_planes;
+    for (unsigned i = 0; ok && i < att->num_planes; i++)
+        if ((pitches[i] % 16) || (offsets[i] % 16))
+            ok = false;
+
+    if (!ok)
+    {
+        free (att);
+        return NULL;
+    }
+    return att;
+}
+
 static void PoolAlloc (vout_display_t *vd, unsigned requested_count)
 {
     vout_display_sys_t *p_sys = vd->sys;
 
     memset (p_sys->resource, 0, sizeof(p_sys->resource));
 
+    /* Pad the images like the decoders pad their pictures, so that the
+     * video output lends them the shared memory pictures. */
+    xcb_xv_query_image_attributes_reply_t *att = QueryAlignedImage (vd);
+    if (att != NULL)
+    {
+        free (p_sys->att);
+        p_sys->att = att;
+    }
+    else
+        msg_Dbg (vd, "XVideo images unsuitable for direct rendering");
+
     const uint32_t *pitches= xcb_xv_query_image_attributes_pitches (p_sys->att);
     const uint32_t *offsets= xcb_xv_query_image_attributes_offsets (p_sys->att);
     const unsigned num_planes= __MIN(p_sys->att->num_planes, PICTURE_PLANE_MAX);
@@ -697,6 +751,9 @@ static void PoolAlloc (vout_display_t *vd, unsigned requested_count)
 
     if (count == 0)
         return;
+    if (count < requested_count)
+        msg_Warn (vd, "%u out of %u pictures allocated", count,
+                  requested_count);
 
     p_sys->pool = picture_pool_New (count, pic_array);
     /* TODO release picture resources if NULL */
@@ -107,6 +107,8 @@ typedef struct
     int       nb_filters;
 
     vlc_atomic_t restart;
+
+    struct aout_buffer_pool *pool; /**< Recycled decoded buffers */
 } aout_owner_t;
 
 typedef struct
@@ -196,6 +198,7 @@ int aout_DecNew(audio_output_t *, const audio_sample_format_t *,
 void aout_DecDelete(audio_output_t *);
 block_t *aout_DecNewBuffer(audio_output_t *, size_t);
 void aout_DecDeleteBuffer(audio_output_t *, block_t *);
+void aout_DecDeletePool(audio_output_t *);
 int aout_DecPlay(audio_output_t *, block_t *, int i_input_rate);
 int aout_DecGetResetLost(audio_output_t *);
 void aout_DecChangePause(audio_output_t *, bool b_paused, mtime_t i_date);
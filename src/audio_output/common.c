@@ -64,6 +64,7 @@ audio_output_t *aout_New( vlc_object_t * p_parent )
     vlc_mutex_init (&owner->volume.lock);
     owner->volume.multiplier = 1.0;
     owner->volume.mixer = NULL;
+    owner->pool = NULL;
 
     aout->pf_play = aout_DecDeleteBuffer;
     aout_VolumeNoneInit (aout);
@@ -186,6 +187,7 @@ static void aout_Destructor (vlc_object_t *obj)
     audio_output_t *aout = (audio_output_t *)obj;
     aout_owner_t *owner = aout_owner (aout);
 
+    aout_DecDeletePool (aout);
     vlc_mutex_destroy (&owner->volume.lock);
     vlc_mutex_destroy (&owner->lock);
 }
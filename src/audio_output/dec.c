@@ -259,6 +259,150 @@ void aout_InputRequestRestart (audio_output_t *aout)
  * Buffer management
  */
 
+/* The decoders ask for a buffer every few tens of milliseconds: the released
+ * ones are recycled through a free list. The list outlives the audio output
+ * until the last buffer allocated from it is released, as the buffers may
+ * still be queued somewhere when the output is destroyed. */
+#define AOUT_POOL_DEPTH 64 /* free buffers kept at most */
+#define AOUT_POOL_ALIGN 16
+
+struct aout_buffer_pool
+{
+    vlc_mutex_t lock;
+    block_t    *first; /**< Free buffers */
+    unsigned    count; /**< Number of free buffers */
+    size_t      size; /**< Payload size (longest frame), or 0 once deleted */
+    unsigned    refs; /**< Buffers in use, plus one for the audio output */
+};
+
+typedef struct
+{
+    block_t                  self;
+    struct aout_buffer_pool *pool;
+    size_t                   size;
+    uint8_t                  payload[];
+} aout_pool_buffer_t;
+
+static void aout_PoolEmpty (struct aout_buffer_pool *pool)
+{
+    block_t *block = pool->first;
+
+    while (block != NULL)
+    {
+        block_t *next = block->p_next;
+
+        free (block);
+        block = next;
+    }
+    pool->first = NULL;
+    pool->count = 0;
+}
+
+static void aout_PoolDestroy (struct aout_buffer_pool *pool)
+{
+    assert (pool->first == NULL);
+    vlc_mutex_destroy (&pool->lock);
+    free (pool);
+}
+
+static void aout_PoolBufferRelease (block_t *block)
+{
+    aout_pool_buffer_t *buf = (aout_pool_buffer_t *)block;
+    struct aout_buffer_pool *pool = buf->pool;
+
+    vlc_mutex_lock (&pool->lock);
+    if (buf->size == pool->size && pool->size > 0
+     && pool->count < AOUT_POOL_DEPTH)
+    {
+        block->p_next = pool->first;
+        pool->first = block;
+        pool->count++;
+        block = NULL;
+    }
+    bool last = --pool->refs == 0;
+    vlc_mutex_unlock (&pool->lock);
+
+    free (block);
+    if (last)
+        aout_PoolDestroy (pool);
+}
+
+static block_t *aout_PoolBufferNew (aout_owner_t *owner, size_t length)
+{
+    struct aout_buffer_pool *pool = owner->pool;
+
+    if (unlikely(pool == NULL))
+    {
+        pool = malloc (sizeof (*pool));
+        if (unlikely(pool == NULL))
+            return NULL;
+        vlc_mutex_init (&pool->lock);
+        pool->first = NULL;
+        pool->count = 0;
+        pool->size = 0;
+        pool->refs = 1;
+        owner->pool = pool;
+    }
+
+    vlc_mutex_lock (&pool->lock);
+    if (length > pool->size)
+    {   /* Longer frame: the smaller buffers are freed as they come back */
+        aout_PoolEmpty (pool);
+        pool->size = length;
+    }
+
+    aout_pool_buffer_t *buf = (aout_pool_buffer_t *)pool->first;
+    if (buf != NULL)
+    {
+        pool->first = buf->self.p_next;
+        pool->count--;
+    }
+    else
+    {
+        buf = malloc (sizeof (*buf) + pool->size + AOUT_POOL_ALIGN - 1);
+        if (likely(buf != NULL))
+        {
+            buf->pool = pool;
+            buf->size = pool->size;
+        }
+    }
+    if (likely(buf != NULL))
+        pool->refs++;
+    vlc_mutex_unlock (&pool->lock);
+
+    if (unlikely(buf == NULL))
+        return NULL;
+
+    uint8_t *payload = (uint8_t *)(((uintptr_t)buf->payload
+                                    + AOUT_POOL_ALIGN - 1)
+                                   & ~(uintptr_t)(AOUT_POOL_ALIGN - 1));
+    block_Init (&buf->self, payload, length);
+    buf->self.pf_release = aout_PoolBufferRelease;
+    return &buf->self;
+}
+
+/**
+ * Frees the recycled buffers. Those still in use are freed when released.
+ */
+void aout_DecDeletePool (audio_output_t *aout)
+{
+    aout_owner_t *owner = aout_owner (aout);
+    struct aout_buffer_pool *pool = owner->pool;
+
+    if (pool == NULL)
+        return;
+    owner->pool = NULL;
+
+    vlc_mutex_lock (&pool->lock);
+    aout_PoolEmpty (pool);
+    pool->size = 0;
+    bool last = --pool->refs == 0;
+    vlc_mutex_unlock (&pool->lock);
+
+    if (last)
+        aout_PoolDestroy (pool);
+}
+
 /*****************************************************************************
  * aout_DecNewBuffer : ask for a new empty buffer
  *****************************************************************************/
@@ -269,7 +413,9 @@ block_t *aout_DecNewBuffer (audio_output_t *aout, size_t samples)
 
     size_t length = samples * owner->input_format.i_bytes_per_frame
                             / owner->input_format.i_frame_length;
-    block_t *block = block_Alloc( length );
+    block_t *block = aout_PoolBufferNew (owner, length);
+    if( unlikely(block == NULL) )
+        block = block_Alloc( length );
     if( likely(block != NULL) )
     {
         block->i_nb_samples = samples;
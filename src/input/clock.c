@@ -99,6 +99,10 @@
 /* Due to some problems in es_out, we cannot use a large value yet */
 #define CR_BUFFERING_TARGET (100000)
 
+/* Duration of each of the two periods over which the clock reference
+ * arrival jitter is measured */
+#define CR_JITTER_PERIOD (5*CLOCK_FREQ)
+
 /*****************************************************************************
  * Structures
  *****************************************************************************/
@@ -165,6 +169,17 @@ struct input_clock_t
         unsigned i_index;
     } late;
 
+    /* Arrival jitter statistics
+     * Transit time (system minus stream date) extrema of the current [0]
+     * and previous [1] periods */
+    struct
+    {
+        mtime_t pi_min[2];
+        mtime_t pi_max[2];
+        mtime_t i_period_end;
+        bool    b_valid; /* a full previous period is available */
+    } transit;
+
     /* Reference point */
     clock_point_t ref;
     bool          b_has_reference;
@@ -184,6 +199,9 @@ static mtime_t ClockStreamToSystem( input_clock_t *, mtime_t i_stream );
 static mtime_t ClockSystemToStream( input_clock_t *, mtime_t i_system );
 
 static mtime_t ClockGetTsOffset( input_clock_t * );
+static void ClockShiftLate( input_clock_t *, mtime_t i_delay_delta );
+static void ClockUpdateTransit( input_clock_t *, bool b_reset,
+                                mtime_t i_ck_stream, mtime_t i_ck_system );
 
 /*****************************************************************************
  * input_clock_New: create a new clock
@@ -212,6 +230,9 @@ input_clock_t *input_clock_New( int i_rate )
     for( int i = 0; i < INPUT_CLOCK_LATE_COUNT; i++ )
         cl->late.pi_value[i] = 0;
 
+    cl->transit.i_period_end = VLC_TS_INVALID;
+    cl->transit.b_valid = false;
+
     cl->i_rate = i_rate;
     cl->i_pts_delay = 0;
     cl->b_paused = false;
@@ -291,6 +312,10 @@ void input_clock_Update( input_clock_t *cl, vlc_object_t *p_log,
         cl->i_next_drift_update = i_ck_system + CLOCK_FREQ/5; /* FIXME why that */
     }
 
+    /* Measure the arrival jitter, only meaningful for real-time sources */
+    if( !b_can_pace_control )
+        ClockUpdateTransit( cl, b_reset_reference, i_ck_stream, i_ck_system );
+
     /* Update the extra buffering value */
     if( !b_can_pace_control || b_reset_reference )
     {
@@ -376,6 +401,8 @@ void input_clock_ChangePause( input_clock_t *cl, bool b_paused, mtime_t i_date )
             cl->ref.i_system += i_duration;
             cl->last.i_system += i_duration;
         }
+        /* The pause is not network jitter */
+        cl->transit.i_period_end = VLC_TS_INVALID;
     }
     cl->i_pause_date = i_date;
     cl->b_paused = b_paused;
@@ -535,22 +562,7 @@ void input_clock_SetJitter( input_clock_t *cl,
     vlc_mutex_lock( &cl->lock );
 
     /* Update late observations */
-    const mtime_t i_delay_delta = i_pts_delay - cl->i_pts_delay;
-    mtime_t pi_late[INPUT_CLOCK_LATE_COUNT];
-    for( int i = 0; i < INPUT_CLOCK_LATE_COUNT; i++ )
-        pi_late[i] = __MAX( cl->late.pi_value[(cl->late.i_index + 1 + i)%INPUT_CLOCK_LATE_COUNT] - i_delay_delta, 0 );
-
-    for( int i = 0; i < INPUT_CLOCK_LATE_COUNT; i++ )
-        cl->late.pi_value[i] = 0;
-    cl->late.i_index = 0;
-
-    for( int i = 0; i < INPUT_CLOCK_LATE_COUNT; i++ )
-    {
-        if( pi_late[i] <= 0 )
-            continue;
-        cl->late.pi_value[cl->late.i_index] = pi_late[i];
-        cl->late.i_index = ( cl->late.i_index + 1 ) % INPUT_CLOCK_LATE_COUNT;
-    }
+    ClockShiftLate( cl, i_pts_delay - cl->i_pts_delay );
 
     /* TODO always save the value, and when rebuffering use the new one if smaller
      * TODO when increasing -> force rebuffering
@@ -590,6 +602,87 @@ mtime_t input_clock_GetJitter( input_clock_t *cl )
     return i_pts_delay + i_late_median;
 }
 
+void input_clock_ChangeDelay( input_clock_t *cl, mtime_t i_pts_delay )
+{
+    vlc_mutex_lock( &cl->lock );
+
+    ClockShiftLate( cl, i_pts_delay - cl->i_pts_delay );
+    cl->i_pts_delay = i_pts_delay;
+
+    vlc_mutex_unlock( &cl->lock );
+}
+
+mtime_t input_clock_GetArrivalJitter( input_clock_t *cl )
+{
+    mtime_t i_jitter = -1;
+
+    vlc_mutex_lock( &cl->lock );
+
+    if( cl->transit.b_valid )
+        i_jitter = __MAX( cl->transit.pi_max[0], cl->transit.pi_max[1] )
+                 - __MIN( cl->transit.pi_min[0], cl->transit.pi_min[1] );
+
+    vlc_mutex_unlock( &cl->lock );
+
+    return i_jitter;
+}
+
+/*****************************************************************************
+ * ClockShiftLate: updates the late observations for a new pts_delay
+ *****************************************************************************/
+static void ClockShiftLate( input_clock_t *cl, mtime_t i_delay_delta )
+{
+    mtime_t pi_late[INPUT_CLOCK_LATE_COUNT];
+    for( int i = 0; i < INPUT_CLOCK_LATE_COUNT; i++ )
+        pi_late[i] = __MAX( cl->late.pi_value[(cl->late.i_index + 1 + i)%INPUT_CLOCK_LATE_COUNT] - i_delay_delta, 0 );
+
+    for( int i = 0; i < INPUT_CLOCK_LATE_COUNT; i++ )
+        cl->late.pi_value[i] = 0;
+    cl->late.i_index = 0;
+
+    for( int i = 0; i < INPUT_CLOCK_LATE_COUNT; i++ )
+    {
+        if( pi_late[i] <= 0 )
+            continue;
+        cl->late.pi_value[cl->late.i_index] = pi_late[i];
+        cl->late.i_index = ( cl->late.i_index + 1 ) % INPUT_CLOCK_LATE_COUNT;
+    }
+}
+
+/*****************************************************************************
+ * ClockUpdateTransit: updates the arrival jitter statistics
+ *
+ * The spread of the transit time over the last one to two periods is the
+ * delay needed to absorb the network jitter. Both clocks drift too slowly
+ * to matter at that time scale.
+ *****************************************************************************/
+static void ClockUpdateTransit( input_clock_t *cl, bool b_reset,
+                                mtime_t i_ck_stream, mtime_t i_ck_system )
+{
+    const mtime_t i_transit = i_ck_system - i_ck_stream;
+
+    if( b_reset || cl->transit.i_period_end == VLC_TS_INVALID )
+        cl->transit.b_valid = false;
+    else if( i_ck_system >= cl->transit.i_period_end )
+    {
+        cl->transit.pi_min[1] = cl->transit.pi_min[0];
+        cl->transit.pi_max[1] = cl->transit.pi_max[0];
+        cl->transit.b_valid = true;
+    }
+    else
+    {
+        if( i_transit < cl->transit.pi_min[0] )
+            cl->transit.pi_min[0] = i_transit;
+        if( i_transit > cl->transit.pi_max[0] )
+            cl->transit.pi_max[0] = i_transit;
+        return;
+    }
+
+    /* New period */
+    cl->transit.pi_min[0] = cl->transit.pi_max[0] = i_transit;
+    cl->transit.i_period_end = i_ck_system + CR_JITTER_PERIOD;
+}
+
 /*****************************************************************************
  * ClockStreamToSystem: converts a movie clock to system date
  *****************************************************************************/
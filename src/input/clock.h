@@ -135,4 +135,15 @@ void input_clock_SetJitter( input_clock_t *,
  */
 mtime_t input_clock_GetJitter( input_clock_t * );
 
+/**
+ * This function changes the pts_delay, making it smaller if needed.
+ */
+void input_clock_ChangeDelay( input_clock_t *, mtime_t i_pts_delay );
+
+/**
+ * This function returns the clock reference arrival jitter measured over
+ * the last periods, or -1 if not known yet.
+ */
+mtime_t input_clock_GetArrivalJitter( input_clock_t * );
+
 #endif
@@ -59,12 +59,16 @@ static decoder_t *CreateDecoder( vlc_object_t *, input_thread_t *,
 static void       DeleteDecoder( decoder_t * );
 
 static void      *DecoderThread( void * );
+static void       DecoderProcessBlock( decoder_t *, block_t * );
 static void       DecoderProcess( decoder_t *, block_t * );
 static void       DecoderError( decoder_t *p_dec, block_t *p_block );
 static void       DecoderOutputChangePause( decoder_t *, bool b_paused, mtime_t i_date );
 static void       DecoderFlush( decoder_t * );
 static void       DecoderSignalBuffering( decoder_t *, bool );
 static void       DecoderFlushBuffering( decoder_t * );
+#ifdef ENABLE_SOUT
+static void       DecoderPlaySout( decoder_t *, block_t *, bool );
+#endif
 
 static void       DecoderUnsupportedCodec( decoder_t *, vlc_fourcc_t );
 
@@ -97,6 +101,26 @@ struct decoder_owner_sys_t
 
     vlc_thread_t     thread;
 
+    /* Packetized by the input thread itself (see "sout-direct") */
+    bool             b_direct;
+
+    /* Only the intra pictures are decoded (see "video-keyframes-only") */
+    bool             b_keyframes_only;
+
+    /* Shared decoder threads (see "decoder-pool"), instead of thread */
+    bool             b_pooled;
+    struct
+    {
+        /* -- These variables are protected by the pool lock -- */
+        bool       b_queued;  /* waiting for a pool thread */
+        bool       b_running; /* being run by a pool thread */
+        bool       b_pending; /* more data came while running */
+        decoder_t *p_next;
+
+        /* -- This one by the decoder lock -- */
+        bool       b_wake;    /* same as a block_FifoWake() */
+    } pool;
+
     /* Some decoders require already packetized data (ie. not truncated) */
     decoder_t *p_packetizer;
     bool b_packetizer;
@@ -182,6 +206,261 @@ struct decoder_owner_sys_t
 /* */
 #define DECODER_SPU_VOUT_WAIT_DURATION ((int)(0.200*CLOCK_FREQ))
 
+/* Blocks decoded by a pool thread before it moves to the next decoder */
+#define DECODER_POOL_BLOCKS (16)
+
+/*****************************************************************************
+ * Decoder pool
+ *****************************************************************************
+ * The audio and SPU decoders (and packetizers) may share a few threads
+ * instead of one thread each. A decoder is never run by two threads at
+ * once, so its blocks are still processed in order.
+ * At most i_max decoders run at once. A decoder waiting for the clock,
+ * a pause or the end of buffering does not count: another thread is
+ * started if needed, so that the waiting decoders never starve the others.
+ *****************************************************************************/
+static vlc_mutex_t pool_setup = VLC_STATIC_MUTEX; /* users and threads */
+static struct
+{
+    vlc_mutex_t   lock;
+    vlc_cond_t    wait;
+    bool          b_exit;
+
+    unsigned      i_users;   /* pooled decoders */
+    unsigned      i_max;     /* decoders running at once */
+    unsigned      i_running;
+    unsigned      i_idle;    /* threads waiting for a decoder */
+
+    vlc_thread_t *p_threads;
+    unsigned      i_threads;
+
+    decoder_t     *p_first;  /* decoders with data to process */
+    decoder_t    **pp_last;
+} pool = {
+    .lock = VLC_STATIC_MUTEX,
+    .wait = VLC_STATIC_COND,
+    .pp_last = &pool.p_first,
+};
+
+static void *DecoderPoolThread( void * );
+
+/* Makes sure a thread will run the first queued decoder, if allowed */
+static void DecoderPoolWakeLocked( decoder_t *p_dec )
+{
+    vlc_assert_locked( &pool.lock );
+
+    if( pool.p_first == NULL || pool.i_running >= pool.i_max )
+        return;
+
+    if( pool.i_idle > 0 )
+    {
+        vlc_cond_signal( &pool.wait );
+        return;
+    }
+
+    vlc_thread_t *p_threads = realloc( pool.p_threads, ( pool.i_threads + 1 )
+                                       * sizeof(*p_threads) );
+    if( p_threads == NULL )
+        return;
+    pool.p_threads = p_threads;
+    if( vlc_clone( &p_threads[pool.i_threads], DecoderPoolThread, NULL,
+                   VLC_THREAD_PRIORITY_AUDIO ) )
+    {
+        msg_Err( p_dec, "cannot spawn decoder pool thread" );
+        return;
+    }
+    pool.i_threads++;
+}
+
+static void DecoderPoolQueueLocked( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    p_owner->pool.b_queued = true;
+    p_owner->pool.p_next = NULL;
+    *pool.pp_last = p_dec;
+    pool.pp_last = &p_owner->pool.p_next;
+    DecoderPoolWakeLocked( p_dec );
+}
+
+/* Tells the pool that the decoder has some work to do */
+static void DecoderPoolSchedule( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    vlc_mutex_lock( &pool.lock );
+    if( p_owner->pool.b_running )
+        p_owner->pool.b_pending = true;
+    else if( !p_owner->pool.b_queued )
+        DecoderPoolQueueLocked( p_dec );
+    vlc_mutex_unlock( &pool.lock );
+}
+
+/* Must surround any wait of a decoder for something else than CPU time */
+static void DecoderPoolBlock( decoder_t *p_dec )
+{
+    if( !p_dec->p_owner->b_pooled )
+        return;
+
+    vlc_mutex_lock( &pool.lock );
+    pool.i_running--;
+    DecoderPoolWakeLocked( p_dec );
+    vlc_mutex_unlock( &pool.lock );
+}
+
+static void DecoderPoolUnblock( decoder_t *p_dec )
+{
+    if( !p_dec->p_owner->b_pooled )
+        return;
+
+    vlc_mutex_lock( &pool.lock );
+    pool.i_running++;
+    vlc_mutex_unlock( &pool.lock );
+}
+
+/* Processes a few blocks of the decoder, returns true if more are left */
+static bool DecoderPoolRun( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    for( int i = 0; i < DECODER_POOL_BLOCKS; i++ )
+    {
+        vlc_mutex_lock( &p_owner->lock );
+        const bool b_exit = p_owner->b_exit;
+        const bool b_empty = block_FifoCount( p_owner->p_fifo ) <= 0;
+        const bool b_wake = b_empty && p_owner->pool.b_wake;
+        if( b_wake )
+            p_owner->pool.b_wake = false;
+        vlc_mutex_unlock( &p_owner->lock );
+
+        if( b_exit )
+            return false;
+        if( b_empty )
+        {
+            /* As an empty block_FifoGet() in DecoderThread() */
+            if( b_wake )
+                DecoderSignalBuffering( p_dec, true );
+            return false;
+        }
+
+        /* This thread is the only consumer: this does not wait */
+        block_t *p_block = block_FifoGet( p_owner->p_fifo );
+        DecoderSignalBuffering( p_dec, false );
+        if( p_block )
+            DecoderProcessBlock( p_dec, p_block );
+    }
+    return true;
+}
+
+static void *DecoderPoolThread( void *p_data )
+{
+    VLC_UNUSED( p_data );
+    int canc = vlc_savecancel();
+
+    vlc_mutex_lock( &pool.lock );
+    for( ;; )
+    {
+        while( !pool.b_exit &&
+               ( pool.p_first == NULL || pool.i_running >= pool.i_max ) )
+        {
+            pool.i_idle++;
+            vlc_cond_wait( &pool.wait, &pool.lock );
+            pool.i_idle--;
+        }
+        if( pool.b_exit )
+            break;
+
+        decoder_t *p_dec = pool.p_first;
+        decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+        pool.p_first = p_owner->pool.p_next;
+        if( pool.p_first == NULL )
+            pool.pp_last = &pool.p_first;
+        p_owner->pool.b_queued = false;
+        p_owner->pool.b_running = true;
+        p_owner->pool.b_pending = false;
+        pool.i_running++;
+        vlc_mutex_unlock( &pool.lock );
+
+        const bool b_more = DecoderPoolRun( p_dec );
+
+        vlc_mutex_lock( &pool.lock );
+        pool.i_running--;
+        p_owner->pool.b_running = false;
+        if( b_more || p_owner->pool.b_pending )
+            DecoderPoolQueueLocked( p_dec );
+        /* Wakes up input_DecoderDelete() and the threads waiting for a
+         * free slot */
+        vlc_cond_broadcast( &pool.wait );
+    }
+    vlc_mutex_unlock( &pool.lock );
+
+    vlc_restorecancel( canc );
+    return NULL;
+}
+
+static void DecoderPoolJoin( decoder_t *p_dec, unsigned i_max )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    vlc_mutex_lock( &pool_setup );
+    vlc_mutex_lock( &pool.lock );
+    pool.i_users++;
+    pool.i_max = i_max;
+    p_owner->b_pooled = true;
+    vlc_mutex_unlock( &pool.lock );
+    vlc_mutex_unlock( &pool_setup );
+}
+
+/* Waits for the pool threads to be done with the decoder; they are
+ * stopped with the last pooled decoder */
+static void DecoderPoolLeave( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    vlc_mutex_lock( &pool_setup );
+    vlc_mutex_lock( &pool.lock );
+    /* A running decoder may be queued again when its thread is done */
+    while( p_owner->pool.b_running )
+        vlc_cond_wait( &pool.wait, &pool.lock );
+    if( p_owner->pool.b_queued )
+    {
+        decoder_t **pp = &pool.p_first;
+        while( *pp != p_dec )
+            pp = &(*pp)->p_owner->pool.p_next;
+        *pp = p_owner->pool.p_next;
+        if( pool.pp_last == &p_owner->pool.p_next )
+            pool.pp_last = pp;
+        p_owner->pool.b_queued = false;
+    }
+    p_owner->b_pooled = false;
+
+    vlc_thread_t *p_threads = NULL;
+    unsigned i_threads = 0;
+    if( --pool.i_users == 0 )
+    {
+        pool.b_exit = true;
+        vlc_cond_broadcast( &pool.wait );
+        p_threads = pool.p_threads;
+        i_threads = pool.i_threads;
+        pool.p_threads = NULL;
+        pool.i_threads = 0;
+    }
+    vlc_mutex_unlock( &pool.lock );
+
+    for( unsigned i = 0; i < i_threads; i++ )
+        vlc_join( p_threads[i], NULL );
+    free( p_threads );
+
+    if( i_threads > 0 )
+    {
+        vlc_mutex_lock( &pool.lock );
+        pool.b_exit = false;
+        vlc_mutex_unlock( &pool.lock );
+    }
+    vlc_mutex_unlock( &pool_setup );
+}
+
 
 /*****************************************************************************
  * Public functions
@@ -295,6 +574,24 @@ static decoder_t *decoder_New( vlc_object_t *p_parent, input_thread_t *p_input,
     else
         i_priority = VLC_THREAD_PRIORITY_VIDEO;
 
+#ifdef ENABLE_SOUT
+    /* A plain remux does not need a thread between the input and the sout */
+    if( p_sout != NULL && var_InheritBool( p_dec, "sout-direct" ) )
+    {
+        p_dec->p_owner->b_direct = true;
+        return p_dec;
+    }
+#endif
+
+    /* The light decoders may share the threads of the pool */
+    const int i_pool = var_InheritInteger( p_dec, "decoder-pool" );
+    if( i_pool > 0 && ( p_dec->fmt_out.i_cat == AUDIO_ES ||
+                        p_dec->fmt_out.i_cat == SPU_ES ) )
+    {
+        DecoderPoolJoin( p_dec, i_pool );
+        return p_dec;
+    }
+
     /* Spawn the decoder thread */
     if( vlc_clone( &p_dec->p_owner->thread, DecoderThread, p_dec, i_priority ) )
     {
@@ -343,8 +640,11 @@ decoder_t *input_DecoderCreate( vlc_object_t *p_parent, es_format_t *fmt,
 void input_DecoderDelete( decoder_t *p_dec )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    const bool b_pooled = p_owner->b_pooled;
+    const bool b_direct = p_owner->b_direct;
 
-    vlc_cancel( p_owner->thread );
+    if( !b_pooled && !b_direct )
+        vlc_cancel( p_owner->thread );
 
     /* Make sure we aren't paused/buffering/waiting/decoding anymore */
     vlc_mutex_lock( &p_owner->lock );
@@ -356,7 +656,10 @@ void input_DecoderDelete( decoder_t *p_dec )
     vlc_cond_signal( &p_owner->wait_request );
     vlc_mutex_unlock( &p_owner->lock );
 
-    vlc_join( p_owner->thread, NULL );
+    if( b_pooled )
+        DecoderPoolLeave( p_dec );
+    else if( !b_direct )
+        vlc_join( p_owner->thread, NULL );
     p_owner->b_paused = b_was_paused;
 
     module_unneed( p_dec, p_dec->p_module );
@@ -384,6 +687,14 @@ void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
 
+    if( p_owner->b_direct )
+    {
+        int canc = vlc_savecancel();
+        DecoderProcessBlock( p_dec, p_block );
+        vlc_restorecancel( canc );
+        return;
+    }
+
     if( b_do_pace )
     {
         /* The fifo is not consummed when buffering and so will
@@ -407,6 +718,8 @@ void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
     }
 
     block_FifoPut( p_owner->p_fifo, p_block );
+    if( p_owner->b_pooled )
+        DecoderPoolSchedule( p_dec );
 }
 
 bool input_DecoderIsEmpty( decoder_t * p_dec )
@@ -584,6 +897,13 @@ void input_DecoderStopBuffering( decoder_t *p_dec )
     vlc_cond_signal( &p_owner->wait_request );
 
     vlc_mutex_unlock( &p_owner->lock );
+
+#ifdef ENABLE_SOUT
+    /* There is no decoder thread to send the buffered blocks */
+    if( p_owner->b_direct )
+        DecoderPlaySout( p_dec, NULL,
+                         p_dec->fmt_in.i_codec == VLC_CODEC_TELETEXT );
+#endif
 }
 
 void input_DecoderWaitBuffering( decoder_t *p_dec )
@@ -592,9 +912,19 @@ void input_DecoderWaitBuffering( decoder_t *p_dec )
 
     vlc_mutex_lock( &p_owner->lock );
 
+    /* Everything was already processed by the input thread */
+    if( p_owner->b_direct )
+        p_owner->buffer.b_full = true;
+
     while( p_owner->b_buffering && !p_owner->buffer.b_full )
     {
-        block_FifoWake( p_owner->p_fifo );
+        if( p_owner->b_pooled )
+        {
+            p_owner->pool.b_wake = true;
+            DecoderPoolSchedule( p_dec );
+        }
+        else
+            block_FifoWake( p_owner->p_fifo );
         vlc_cond_wait( &p_owner->wait_acknowledge, &p_owner->lock );
     }
 
@@ -867,6 +1197,16 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
 
     p_owner->b_exit = false;
 
+    p_owner->b_direct = false;
+    p_owner->b_keyframes_only = !b_packetizer && fmt->i_cat == VIDEO_ES &&
+                                var_InheritBool( p_dec, "video-keyframes-only" );
+    p_owner->b_pooled = false;
+    p_owner->pool.b_queued = false;
+    p_owner->pool.b_running = false;
+    p_owner->pool.b_pending = false;
+    p_owner->pool.b_wake = false;
+    p_owner->pool.p_next = NULL;
+
     p_owner->b_paused = false;
     p_owner->pause.i_date = VLC_TS_INVALID;
     p_owner->pause.i_ignore = 0;
@@ -923,26 +1263,29 @@ static void *DecoderThread( void *p_data )
         if( p_block )
         {
             int canc = vlc_savecancel();
-
-            if( !p_dec->b_need_eos && (p_block->i_flags & BLOCK_FLAG_END_OF_STREAM) )
-            {
-                /* calling DecoderProcess() with NULL block will make
-                 * decoders/packetizers flush their buffers */
-                block_Release( p_block );
-                p_block = NULL;
-            }
-
-            if( p_dec->b_error )
-                DecoderError( p_dec, p_block );
-            else
-                DecoderProcess( p_dec, p_block );
-
+            DecoderProcessBlock( p_dec, p_block );
             vlc_restorecancel( canc );
         }
     }
     return NULL;
 }
 
+static void DecoderProcessBlock( decoder_t *p_dec, block_t *p_block )
+{
+    if( !p_dec->b_need_eos && (p_block->i_flags & BLOCK_FLAG_END_OF_STREAM) )
+    {
+        /* calling DecoderProcess() with NULL block will make
+         * decoders/packetizers flush their buffers */
+        block_Release( p_block );
+        p_block = NULL;
+    }
+
+    if( p_dec->b_error )
+        DecoderError( p_dec, p_block );
+    else
+        DecoderProcess( p_dec, p_block );
+}
+
 static block_t *DecoderBlockFlushNew()
 {
     block_t *p_null = block_Alloc( 128 );
@@ -974,7 +1317,15 @@ static void DecoderFlush( decoder_t *p_dec )
     block_t *p_null = DecoderBlockFlushNew();
     if( !p_null )
         return;
-    input_DecoderDecode( p_dec, p_null, false );
+    if( p_owner->b_direct )
+    {
+        /* It is processed right away, and needs the lock */
+        vlc_mutex_unlock( &p_owner->lock );
+        input_DecoderDecode( p_dec, p_null, false );
+        vlc_mutex_lock( &p_owner->lock );
+    }
+    else
+        input_DecoderDecode( p_dec, p_null, false );
 
     /* */
     while( p_owner->b_flushing )
@@ -1017,6 +1368,7 @@ static void DecoderWaitUnblock( decoder_t *p_dec, bool *pb_reject )
 
     vlc_assert_locked( &p_owner->lock );
 
+    bool b_blocked = false;
     while( !p_owner->b_flushing )
     {
         if( p_owner->b_paused )
@@ -1034,8 +1386,15 @@ static void DecoderWaitUnblock( decoder_t *p_dec, bool *pb_reject )
             if( !p_owner->b_buffering || !p_owner->buffer.b_full )
                 break;
         }
+        if( !b_blocked )
+        {
+            DecoderPoolBlock( p_dec );
+            b_blocked = true;
+        }
         vlc_cond_wait( &p_owner->wait_request, &p_owner->lock );
     }
+    if( b_blocked )
+        DecoderPoolUnblock( p_dec );
 
     if( pb_reject )
         *pb_reject = p_owner->b_flushing;
@@ -1157,6 +1516,7 @@ static void DecoderWaitDate( decoder_t *p_dec,
     if( *pb_reject || i_deadline < 0 )
         return;
 
+    DecoderPoolBlock( p_dec );
     for( ;; )
     {
         vlc_mutex_lock( &p_owner->lock );
@@ -1172,6 +1532,7 @@ static void DecoderWaitDate( decoder_t *p_dec,
         if( i_ret )
             break;
     }
+    DecoderPoolUnblock( p_dec );
 }
 
 static void DecoderPlayAudio( decoder_t *p_dec, aout_buffer_t *p_audio,
@@ -1514,6 +1875,16 @@ static void DecoderDecodeVideo( decoder_t *p_dec, block_t *p_block )
     int i_decoded = 0;
     int i_displayed = 0;
 
+    /* The other pictures are dropped undecoded when the demuxer or the
+     * packetizer tells their type */
+    if( p_owner->b_keyframes_only && p_block &&
+        ( p_block->i_flags & ( BLOCK_FLAG_TYPE_P | BLOCK_FLAG_TYPE_B |
+                               BLOCK_FLAG_TYPE_PB ) ) )
+    {
+        block_Release( p_block );
+        return;
+    }
+
     while( (p_pic = p_dec->pf_decode_video( p_dec, &p_block )) )
     {
         vout_thread_t  *p_vout = p_owner->p_vout;
@@ -1662,11 +2033,12 @@ static void DecoderPlaySout( decoder_t *p_dec, block_t *p_sout_block,
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
 
     assert( p_owner->p_clock );
-    assert( !p_sout_block->p_next );
+    assert( !p_sout_block || !p_sout_block->p_next );
 
     vlc_mutex_lock( &p_owner->lock );
 
-    if( p_owner->b_buffering || p_owner->buffer.p_block )
+    if( p_sout_block &&
+        ( p_owner->b_buffering || p_owner->buffer.p_block ) )
     {
         block_ChainLastAppend( &p_owner->buffer.pp_block_next, p_sout_block );
 
@@ -1683,7 +2055,11 @@ static void DecoderPlaySout( decoder_t *p_dec, block_t *p_sout_block,
     {
         bool b_has_more = false;
         bool b_reject;
-        DecoderWaitUnblock( p_dec, &b_reject );
+        /* The input thread must not wait for itself */
+        if( p_owner->b_direct )
+            b_reject = p_owner->b_flushing;
+        else
+            DecoderWaitUnblock( p_dec, &b_reject );
 
         if( p_owner->b_buffering )
         {
@@ -1703,6 +2079,12 @@ static void DecoderPlaySout( decoder_t *p_dec, block_t *p_sout_block,
             if( !b_has_more )
                 p_owner->buffer.pp_block_next = &p_owner->buffer.p_block;
         }
+        else if( p_sout_block == NULL )
+        {
+            /* Only the buffered blocks were to be sent */
+            vlc_mutex_unlock( &p_owner->lock );
+            return;
+        }
         p_sout_block->p_next = NULL;
 
         DecoderFixTs( p_dec, &p_sout_block->i_dts, &p_sout_block->i_pts,
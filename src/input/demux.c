@@ -92,6 +92,7 @@ demux_t *demux_New( vlc_object_t *p_obj, input_thread_t *p_parent_input,
 
     p_demux->s          = s;
     p_demux->out        = out;
+    p_demux->b_preparsing = b_quick;
 
     p_demux->pf_demux   = NULL;
     p_demux->pf_control = NULL;
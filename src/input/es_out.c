@@ -153,6 +153,12 @@ struct es_out_sys_t
     int         i_cr_average;
     int         i_rate;
 
+    /* Adaptive caching */
+    bool        b_adaptive;
+    mtime_t     i_adaptive_min;
+    mtime_t     i_adaptive_max;
+    mtime_t     i_adaptive_next; /* date of the next adjustment */
+
     /* */
     bool        b_paused;
     mtime_t     i_pause_date;
@@ -317,6 +323,15 @@ es_out_t *input_EsOutNew( input_thread_t *p_input, int i_rate )
     p_sys->i_pts_jitter = 0;
     p_sys->i_cr_average = 0;
 
+    p_sys->b_adaptive = var_InheritBool( p_input, "adaptive-caching" );
+    p_sys->i_adaptive_min = INT64_C(1000)
+                          * var_InheritInteger( p_input, "adaptive-caching-min" );
+    p_sys->i_adaptive_max = INT64_C(1000)
+                          * var_InheritInteger( p_input, "adaptive-caching-max" );
+    if( p_sys->i_adaptive_max < p_sys->i_adaptive_min )
+        p_sys->i_adaptive_max = p_sys->i_adaptive_min;
+    p_sys->i_adaptive_next = VLC_TS_INVALID;
+
     p_sys->b_buffering = true;
     p_sys->i_buffering_extra_initial = 0;
     p_sys->i_buffering_extra_stream = 0;
@@ -751,6 +766,48 @@ static bool EsOutIsExtraBufferingAllowed( es_out_t *out )
     return i_size < i_level_high;
 }
 
+/* Adaptive caching: period between two adjustments, and largest decrease
+ * per adjustment (small enough for the audio output to resample) */
+#define ADAPTIVE_PERIOD (CLOCK_FREQ)
+#define ADAPTIVE_STEP   (CLOCK_FREQ/100)
+
+/*****************************************************************************
+ * EsOutAdaptDelay: follows the arrival jitter of a real-time source
+ *
+ * The delay grows at once to twice the measured jitter, but only shrinks
+ * slowly toward it, within the configured bounds.
+ *****************************************************************************/
+static void EsOutAdaptDelay( es_out_t *out, es_out_pgrm_t *p_pgrm )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+    const mtime_t i_now = mdate();
+
+    if( i_now < p_sys->i_adaptive_next )
+        return;
+    p_sys->i_adaptive_next = i_now + ADAPTIVE_PERIOD;
+
+    const mtime_t i_jitter = input_clock_GetArrivalJitter( p_pgrm->p_clock );
+    if( i_jitter < 0 )
+        return; /* not measured yet */
+
+    const mtime_t i_target = __MIN( __MAX( 2 * i_jitter, p_sys->i_adaptive_min ),
+                                    p_sys->i_adaptive_max );
+    mtime_t i_delay = p_sys->i_pts_delay;
+    if( i_target > i_delay )
+        i_delay = i_target;
+    else
+        i_delay -= __MIN( i_delay - i_target, ADAPTIVE_STEP );
+    if( i_delay == p_sys->i_pts_delay )
+        return;
+
+    msg_Dbg( p_sys->p_input, "adaptive caching: %d ms (arrival jitter %d ms)",
+             (int)(i_delay / 1000), (int)(i_jitter / 1000) );
+    p_sys->i_pts_delay = i_delay;
+    p_sys->i_pts_jitter = 0;
+    for( int i = 0; i < p_sys->i_pgrm; i++ )
+        input_clock_ChangeDelay( p_sys->pgrm[i]->p_clock, i_delay );
+}
+
 static void EsOutProgramChangePause( es_out_t *out, bool b_paused, mtime_t i_date )
 {
     es_out_sys_t *p_sys = out->p_sys;
@@ -2364,6 +2421,13 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
 
                     es_out_SetJitter( out, i_pts_delay_base, i_pts_delay - i_pts_delay_base, p_sys->i_cr_average );
                 }
+                else if( p_sys->b_adaptive &&
+                         !p_sys->p_input->p->b_can_pace_control &&
+                         ( !p_sys->p_input->p->p_sout ||
+                           !p_sys->p_input->p->b_out_pace_control ) )
+                {
+                    EsOutAdaptDelay( out, p_pgrm );
+                }
             }
             return VLC_SUCCESS;
         }
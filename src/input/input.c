@@ -195,18 +195,48 @@ int input_Preparse( vlc_object_t *p_parent, input_item_t *p_item )
     input_thread_t *p_input;
 
     /* Allocate descriptor */
-    p_input = Create( p_parent, p_item, NULL, true, NULL );
+    p_input = input_CreatePreparser( p_parent, p_item );
     if( !p_input )
         return VLC_EGENERIC;
 
-    if( !Init( p_input ) )
-        End( p_input );
+    input_RunPreparser( p_input );
 
     vlc_object_release( p_input );
 
     return VLC_SUCCESS;
 }
 
+/**
+ * Create an input to preparse the item, without running it.
+ *
+ * This split of input_Preparse() lets another thread abort the preparsing
+ * with input_StopPreparser(). Release the input with vlc_object_release().
+ */
+input_thread_t *input_CreatePreparser( vlc_object_t *p_parent,
+                                       input_item_t *p_item )
+{
+    return Create( p_parent, p_item, NULL, true, NULL );
+}
+
+/**
+ * Preparse the item of an input created by input_CreatePreparser().
+ * This function is blocking.
+ */
+void input_RunPreparser( input_thread_t *p_input )
+{
+    if( !Init( p_input ) )
+        End( p_input );
+}
+
+/**
+ * Abort input_RunPreparser(). It may be called from any thread, and more
+ * than once as objects created after the first call are not stopped.
+ */
+void input_StopPreparser( input_thread_t *p_input )
+{
+    ObjectKillChildrens( p_input, VLC_OBJECT(p_input) );
+}
+
 /**
  * Start a input_thread_t created by input_Create.
  *
@@ -1623,8 +1653,12 @@ static void ControlPause( input_thread_t *p_input, mtime_t i_control_date )
     if( p_input->p->b_can_pause )
     {
         if( p_input->p->input.p_access )
+        {
+            stream_AccessLock( p_input->p->input.p_stream );
             i_ret = access_Control( p_input->p->input.p_access,
                                      ACCESS_SET_PAUSE_STATE, true );
+            stream_AccessUnlock( p_input->p->input.p_stream );
+        }
         else
             i_ret = demux_Control( p_input->p->input.p_demux,
                                     DEMUX_SET_PAUSE_STATE, true );
@@ -1657,8 +1691,12 @@ static void ControlUnpause( input_thread_t *p_input, mtime_t i_control_date )
     if( p_input->p->b_can_pause )
     {
         if( p_input->p->input.p_access )
+        {
+            stream_AccessLock( p_input->p->input.p_stream );
             i_ret = access_Control( p_input->p->input.p_access,
                                      ACCESS_SET_PAUSE_STATE, false );
+            stream_AccessUnlock( p_input->p->input.p_stream );
+        }
         else
             i_ret = demux_Control( p_input->p->input.p_demux,
                                     DEMUX_SET_PAUSE_STATE, false );
@@ -2098,7 +2136,9 @@ static bool Control( input_thread_t *p_input,
                     p_meta = vlc_meta_New();
                     if( p_meta )
                     {
+                        stream_AccessLock( slave->p_stream );
                         access_Control( slave->p_access, ACCESS_GET_META, p_meta );
+                        stream_AccessUnlock( slave->p_stream );
                         demux_Control( slave->p_demux, DEMUX_GET_META, p_meta );
                         InputUpdateMeta( p_input, p_meta );
                     }
@@ -2318,7 +2358,9 @@ static void UpdateGenericFromAccess( input_thread_t *p_input )
         vlc_meta_t *p_meta = vlc_meta_New();
         if( p_meta )
         {
+            stream_AccessLock( p_input->p->input.p_stream );
             access_Control( p_input->p->input.p_access, ACCESS_GET_META, p_meta );
+            stream_AccessUnlock( p_input->p->input.p_stream );
             InputUpdateMeta( p_input, p_meta );
         }
         p_access->info.i_update &= ~INPUT_UPDATE_META;
@@ -2328,8 +2370,10 @@ static void UpdateGenericFromAccess( input_thread_t *p_input )
         double f_quality;
         double f_strength;
 
+        stream_AccessLock( p_input->p->input.p_stream );
         if( access_Control( p_access, ACCESS_GET_SIGNAL, &f_quality, &f_strength ) )
             f_quality = f_strength = -1;
+        stream_AccessUnlock( p_input->p->input.p_stream );
 
         input_SendEventSignal( p_input, f_quality, f_strength );
 
@@ -2538,7 +2582,11 @@ static int InputSourceInit( input_thread_t *p_input,
             TAB_APPEND( i_input_list, ppsz_input_list, NULL );
 
         /* Create the stream_t */
-        in->p_stream = stream_AccessNew( in->p_access, ppsz_input_list );
+        in->p_stream = NULL;
+        if( i_input_list <= 0 && var_InheritBool( p_input, "stream-mmap" ) )
+            in->p_stream = stream_MmapNew( in->p_access );
+        if( in->p_stream == NULL )
+            in->p_stream = stream_AccessNew( in->p_access, ppsz_input_list );
         if( ppsz_input_list )
         {
             for( int i = 0; ppsz_input_list[i] != NULL; i++ )
@@ -2641,8 +2689,10 @@ static int InputSourceInit( input_thread_t *p_input,
         {
             /* GET_PTS_DELAY is mandatory for access_demux */
             assert( in->p_access );
+            stream_AccessLock( in->p_stream );
             access_Control( in->p_access,
                             ACCESS_GET_PTS_DELAY, &in->i_pts_delay );
+            stream_AccessUnlock( in->p_stream );
         }
         if( in->i_pts_delay > INPUT_PTS_DELAY_MAX )
             in->i_pts_delay = INPUT_PTS_DELAY_MAX;
@@ -2717,7 +2767,13 @@ static void InputSourceMeta( input_thread_t *p_input,
     bool has_meta;
 
     /* Read access meta */
-    has_meta = p_access && !access_Control( p_access, ACCESS_GET_META, p_meta );
+    has_meta = false;
+    if( p_access )
+    {
+        stream_AccessLock( p_source->p_stream );
+        has_meta = !access_Control( p_access, ACCESS_GET_META, p_meta );
+        stream_AccessUnlock( p_source->p_stream );
+    }
 
     /* Read demux meta */
     has_meta |= !demux_Control( p_demux, DEMUX_GET_META, p_meta );
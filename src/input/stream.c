@@ -31,6 +31,7 @@
 #include <vlc_common.h>
 #include <vlc_strings.h>
 #include <vlc_memory.h>
+#include <vlc_network.h> /* struct iovec */
 
 #include <libvlc.h>
 
@@ -58,16 +59,9 @@
  *      It should probably defaulted (instead of the stream method (2)).
  */
 
-/* How many tracks we have, currently only used for stream mode */
-#ifdef OPTIMIZE_MEMORY
-#   define STREAM_CACHE_TRACK 1
-    /* Max size of our cache 128Ko per track */
-#   define STREAM_CACHE_SIZE  (STREAM_CACHE_TRACK*1024*128)
-#else
-#   define STREAM_CACHE_TRACK 3
-    /* Max size of our cache 4Mo per track */
-#   define STREAM_CACHE_SIZE  (4*STREAM_CACHE_TRACK*1024*1024)
-#endif
+/* The number of tracks (only used for stream mode) and the total size of
+ * the cache are set per input by the "stream-cache-tracks" and
+ * "stream-cache-size" options; the defaults are in libvlc-module.c. */
 
 /* How many data we try to prebuffer
  * XXX it should be small to avoid useless latency but big enough for
@@ -93,7 +87,16 @@
  *        - ?
  */
 #define STREAM_READ_ATONCE 1024
-#define STREAM_CACHE_TRACK_SIZE (STREAM_CACHE_SIZE/STREAM_CACHE_TRACK)
+
+/* Method2 read-ahead (optional): a thread keeps the current track filled
+ * up to the track size ahead of the read position, so the reader
+ * only waits for the access if it catches up with the thread.
+ *  - the thread writes outside of the lock, but only to the free part of
+ *    the current track ring buffer, and updates i_end/i_start under the lock
+ *  - anything else using the access (seeking, controls) first pauses the
+ *    thread and waits for its pending read to complete
+ */
+#define STREAM_PREFETCH_ATONCE (32*1024)
 
 typedef struct
 {
@@ -126,6 +129,7 @@ struct stream_sys_t
     stream_read_method_t   method;    /* method to use */
 
     uint64_t     i_pos;      /* Current reading offset */
+    unsigned     i_cache_size;
 
     /* Method 1: pf_block */
     struct
@@ -145,7 +149,9 @@ struct stream_sys_t
     {
         unsigned i_offset;   /* Buffer offset in the current track */
         int      i_tk;       /* Current track */
-        stream_track_t tk[STREAM_CACHE_TRACK];
+        int      i_tk_count;
+        unsigned i_tk_size;  /* Size of a track ring buffer */
+        stream_track_t *tk;
 
         /* Global buffer */
         uint8_t *p_buffer;
@@ -156,6 +162,22 @@ struct stream_sys_t
 
     } stream;
 
+    /* Method 2 read-ahead thread */
+    struct
+    {
+        bool         b_enabled;
+        vlc_thread_t thread;
+        vlc_mutex_t  lock;
+        vlc_cond_t   wait;     /* Signaled to the thread */
+        vlc_cond_t   done;     /* Signaled by the thread */
+
+        unsigned     i_paused; /* Pending pause requests */
+        bool         b_busy;   /* Reading from the access */
+        bool         b_eof;
+        bool         b_exit;
+
+    } prefetch;
+
     /* Peek temporary buffer */
     unsigned int i_peek;
     uint8_t *p_peek;
@@ -186,6 +208,8 @@ struct stream_sys_t
 /* Method 1: */
 static int  AStreamReadBlock( stream_t *s, void *p_read, unsigned int i_read );
 static int  AStreamPeekBlock( stream_t *s, const uint8_t **p_peek, unsigned int i_read );
+static int  AStreamPeekVBlock( stream_t *s, struct iovec *, unsigned *, unsigned int i_read );
+static block_t *AStreamBlockBlock( stream_t *s, unsigned int i_size );
 static int  AStreamSeekBlock( stream_t *s, uint64_t i_pos );
 static void AStreamPrebufferBlock( stream_t *s );
 static block_t *AReadBlock( stream_t *s, bool *pb_eof );
@@ -193,13 +217,20 @@ static block_t *AReadBlock( stream_t *s, bool *pb_eof );
 /* Method 2 */
 static int  AStreamReadStream( stream_t *s, void *p_read, unsigned int i_read );
 static int  AStreamPeekStream( stream_t *s, const uint8_t **pp_peek, unsigned int i_read );
+static int  AStreamPeekVStream( stream_t *s, struct iovec *, unsigned *, unsigned int i_read );
 static int  AStreamSeekStream( stream_t *s, uint64_t i_pos );
 static void AStreamPrebufferStream( stream_t *s );
 static int  AReadStream( stream_t *s, void *p_read, unsigned int i_read );
 
+static int  AStreamReadStreamAhead( stream_t *s, void *p_read, unsigned int i_read );
+static int  AStreamPeekStreamAhead( stream_t *s, const uint8_t **pp_peek, unsigned int i_read );
+static int  AStreamPeekVStreamAhead( stream_t *s, struct iovec *, unsigned *, unsigned int i_read );
+static void *AStreamPrefetchThread( void * );
+
 /* Common */
 static int AStreamControl( stream_t *s, int i_query, va_list );
 static void AStreamDestroy( stream_t *s );
+static block_t *BlockCopy( stream_t *s, unsigned int i_size );
 static void UStreamDestroy( stream_t *s );
 static int  ASeek( stream_t *s, uint64_t i_pos );
 
@@ -307,6 +338,19 @@ stream_t *stream_AccessNew( access_t *p_access, char **ppsz_list )
         p_sys->method = STREAM_METHOD_STREAM;
 
     p_sys->i_pos = p_access->info.i_pos;
+    p_sys->prefetch.b_enabled = false;
+    p_sys->stream.p_buffer = NULL;
+    p_sys->stream.tk = NULL;
+
+    /* Cache size */
+    p_sys->i_cache_size = var_InheritInteger( s, "stream-cache-size" ) * 1024;
+    p_sys->stream.i_tk_count = var_InheritInteger( s, "stream-cache-tracks" );
+    if( p_sys->stream.i_tk_count < 1 )
+        p_sys->stream.i_tk_count = 1;
+    p_sys->stream.i_tk_size = p_sys->i_cache_size / p_sys->stream.i_tk_count;
+    if( p_sys->stream.i_tk_size < 16 * STREAM_READ_ATONCE )
+        p_sys->stream.i_tk_size = 16 * STREAM_READ_ATONCE;
+    p_sys->i_cache_size = p_sys->stream.i_tk_size * p_sys->stream.i_tk_count;
 
     /* Stats */
     access_Control( p_access, ACCESS_CAN_FASTSEEK, &p_sys->stat.b_fastseek );
@@ -374,6 +418,8 @@ stream_t *stream_AccessNew( access_t *p_access, char **ppsz_list )
         msg_Dbg( s, "Using block method for AStream*" );
         s->pf_read = AStreamReadBlock;
         s->pf_peek = AStreamPeekBlock;
+        s->pf_peekv = AStreamPeekVBlock;
+        s->pf_block = AStreamBlockBlock;
 
         /* Init all fields of p_sys->block */
         p_sys->block.i_start = p_sys->i_pos;
@@ -402,26 +448,31 @@ stream_t *stream_AccessNew( access_t *p_access, char **ppsz_list )
 
         s->pf_read = AStreamReadStream;
         s->pf_peek = AStreamPeekStream;
+        s->pf_peekv = AStreamPeekVStream;
 
         /* Allocate/Setup our tracks */
         p_sys->stream.i_offset = 0;
         p_sys->stream.i_tk     = 0;
-        p_sys->stream.p_buffer = malloc( STREAM_CACHE_SIZE );
-        if( p_sys->stream.p_buffer == NULL )
+        p_sys->stream.p_buffer = malloc( p_sys->i_cache_size );
+        p_sys->stream.tk = calloc( p_sys->stream.i_tk_count,
+                                   sizeof( *p_sys->stream.tk ) );
+        if( p_sys->stream.p_buffer == NULL || p_sys->stream.tk == NULL )
             goto error;
+        msg_Dbg( s, "using %d tracks of %u bytes", p_sys->stream.i_tk_count,
+                 p_sys->stream.i_tk_size );
         p_sys->stream.i_used   = 0;
         p_sys->stream.i_read_size = STREAM_READ_ATONCE;
 #if STREAM_READ_ATONCE < 256
 #   error "Invalid STREAM_READ_ATONCE value"
 #endif
 
-        for( i = 0; i < STREAM_CACHE_TRACK; i++ )
+        for( i = 0; i < p_sys->stream.i_tk_count; i++ )
         {
             p_sys->stream.tk[i].i_date  = 0;
             p_sys->stream.tk[i].i_start = p_sys->i_pos;
             p_sys->stream.tk[i].i_end   = p_sys->i_pos;
             p_sys->stream.tk[i].p_buffer=
-                &p_sys->stream.p_buffer[i * STREAM_CACHE_TRACK_SIZE];
+                &p_sys->stream.p_buffer[i * p_sys->stream.i_tk_size];
         }
 
         /* Do the prebuffering */
@@ -432,6 +483,35 @@ stream_t *stream_AccessNew( access_t *p_access, char **ppsz_list )
             msg_Err( s, "cannot pre fill buffer" );
             goto error;
         }
+
+        /* Start the read-ahead */
+        if( var_InheritBool( s, "stream-prefetch" ) )
+        {
+            vlc_mutex_init( &p_sys->prefetch.lock );
+            vlc_cond_init( &p_sys->prefetch.wait );
+            vlc_cond_init( &p_sys->prefetch.done );
+            p_sys->prefetch.i_paused = 0;
+            p_sys->prefetch.b_busy = false;
+            p_sys->prefetch.b_eof = false;
+            p_sys->prefetch.b_exit = false;
+
+            if( vlc_clone( &p_sys->prefetch.thread, AStreamPrefetchThread, s,
+                           VLC_THREAD_PRIORITY_INPUT ) )
+            {
+                msg_Err( s, "cannot start read-ahead thread" );
+                vlc_cond_destroy( &p_sys->prefetch.done );
+                vlc_cond_destroy( &p_sys->prefetch.wait );
+                vlc_mutex_destroy( &p_sys->prefetch.lock );
+            }
+            else
+            {
+                msg_Dbg( s, "reading ahead in the background" );
+                p_sys->prefetch.b_enabled = true;
+                s->pf_read = AStreamReadStreamAhead;
+                s->pf_peek = AStreamPeekStreamAhead;
+                s->pf_peekv = AStreamPeekVStreamAhead;
+            }
+        }
     }
 
     return s;
@@ -443,6 +523,7 @@ error:
     }
     else
     {
+        free( p_sys->stream.tk );
         free( p_sys->stream.p_buffer );
     }
     while( p_sys->i_list > 0 )
@@ -460,10 +541,31 @@ static void AStreamDestroy( stream_t *s )
 {
     stream_sys_t *p_sys = s->p_sys;
 
+    if( p_sys->prefetch.b_enabled )
+    {
+        vlc_mutex_lock( &p_sys->prefetch.lock );
+        p_sys->prefetch.b_exit = true;
+        vlc_cond_signal( &p_sys->prefetch.wait );
+        vlc_mutex_unlock( &p_sys->prefetch.lock );
+
+        /* Interrupt the pending read, if any */
+        vlc_object_kill( p_sys->p_access );
+        if( p_sys->p_list_access && p_sys->p_list_access != p_sys->p_access )
+            vlc_object_kill( p_sys->p_list_access );
+
+        vlc_join( p_sys->prefetch.thread, NULL );
+        vlc_cond_destroy( &p_sys->prefetch.done );
+        vlc_cond_destroy( &p_sys->prefetch.wait );
+        vlc_mutex_destroy( &p_sys->prefetch.lock );
+    }
+
     if( p_sys->method == STREAM_METHOD_BLOCK )
         block_ChainRelease( p_sys->block.p_first );
     else
+    {
+        free( p_sys->stream.tk );
         free( p_sys->stream.p_buffer );
+    }
 
     free( p_sys->p_peek );
 
@@ -524,7 +626,7 @@ static void AStreamControlReset( stream_t *s )
         p_sys->stream.i_tk     = 0;
         p_sys->stream.i_used   = 0;
 
-        for( i = 0; i < STREAM_CACHE_TRACK; i++ )
+        for( i = 0; i < p_sys->stream.i_tk_count; i++ )
         {
             p_sys->stream.tk[i].i_date  = 0;
             p_sys->stream.tk[i].i_start = p_sys->i_pos;
@@ -555,10 +657,95 @@ static void AStreamControlUpdate( stream_t *s )
     }
 }
 
+/****************************************************************************
+ * Read-ahead synchronization:
+ ****************************************************************************/
+/* Stops the read-ahead thread from using the access (lock held) */
+static void AStreamPrefetchPause( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    p_sys->prefetch.i_paused++;
+    while( p_sys->prefetch.b_busy )
+        vlc_cond_wait( &p_sys->prefetch.done, &p_sys->prefetch.lock );
+}
+
+static void AStreamPrefetchResume( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    assert( p_sys->prefetch.i_paused > 0 );
+    if( --p_sys->prefetch.i_paused == 0 )
+    {
+        /* The position may have changed */
+        p_sys->prefetch.b_eof = false;
+        vlc_cond_signal( &p_sys->prefetch.wait );
+    }
+}
+
+/* Returns the access stream below the stream filters, if it reads ahead */
+static stream_t *AStreamPrefetchFind( stream_t *s )
+{
+    while( s->p_source != NULL )
+        s = s->p_source;
+    if( s->pf_destroy != AStreamDestroy && s->pf_destroy != UStreamDestroy )
+        return NULL;
+    return s->p_sys->prefetch.b_enabled ? s : NULL;
+}
+
+/**
+ * Suspends the read-ahead of the stream (or of the source of the stream
+ * filter), if any, so that the caller can use the access directly.
+ */
+void stream_AccessLock( stream_t *s )
+{
+    s = AStreamPrefetchFind( s );
+    if( s == NULL )
+        return;
+
+    vlc_mutex_lock( &s->p_sys->prefetch.lock );
+    AStreamPrefetchPause( s );
+    vlc_mutex_unlock( &s->p_sys->prefetch.lock );
+}
+
+void stream_AccessUnlock( stream_t *s )
+{
+    s = AStreamPrefetchFind( s );
+    if( s == NULL )
+        return;
+
+    vlc_mutex_lock( &s->p_sys->prefetch.lock );
+    AStreamPrefetchResume( s );
+    vlc_mutex_unlock( &s->p_sys->prefetch.lock );
+}
+
 /****************************************************************************
  * AStreamControl:
  ****************************************************************************/
+static int AStreamVaControl( stream_t *s, int i_query, va_list args );
+
 static int AStreamControl( stream_t *s, int i_query, va_list args )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    if( !p_sys->prefetch.b_enabled )
+        return AStreamVaControl( s, i_query, args );
+
+    /* Only the position and size queries do not involve the access */
+    const bool b_pause = i_query != STREAM_GET_POSITION &&
+                         i_query != STREAM_GET_SIZE;
+
+    vlc_mutex_lock( &p_sys->prefetch.lock );
+    if( b_pause )
+        AStreamPrefetchPause( s );
+    int i_ret = AStreamVaControl( s, i_query, args );
+    if( b_pause )
+        AStreamPrefetchResume( s );
+    vlc_mutex_unlock( &p_sys->prefetch.lock );
+    return i_ret;
+}
+
+static int AStreamVaControl( stream_t *s, int i_query, va_list args )
 {
     stream_sys_t *p_sys = s->p_sys;
     access_t     *p_access = p_sys->p_access;
@@ -771,6 +958,23 @@ static int AStreamReadBlock( stream_t *s, void *p_read, unsigned int i_read )
     return i_data;
 }
 
+/* Buffers at least i_read bytes after the position, if possible */
+static void AStreamFillBlock( stream_t *s, unsigned int i_read )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    while( p_sys->block.i_size - (p_sys->i_pos - p_sys->block.i_start)
+           < i_read )
+    {
+        block_t **pp_last = p_sys->block.pp_last;
+
+        if( AStreamRefillBlock( s ) ) break;
+
+        /* Our buffer are probably filled enough, don't try anymore */
+        if( pp_last == p_sys->block.pp_last ) break;
+    }
+}
+
 static int AStreamPeekBlock( stream_t *s, const uint8_t **pp_peek, unsigned int i_read )
 {
     stream_sys_t *p_sys = s->p_sys;
@@ -800,17 +1004,7 @@ static int AStreamPeekBlock( stream_t *s, const uint8_t **pp_peek, unsigned int
         p_sys->i_peek = i_read;
     }
 
-    /* Fill enough data */
-    while( p_sys->block.i_size - (p_sys->i_pos - p_sys->block.i_start)
-           < i_read )
-    {
-        block_t **pp_last = p_sys->block.pp_last;
-
-        if( AStreamRefillBlock( s ) ) break;
-
-        /* Our buffer are probably filled enough, don't try anymore */
-        if( pp_last == p_sys->block.pp_last ) break;
-    }
+    AStreamFillBlock( s, i_read );
 
     /* Copy what we have */
     b = p_sys->block.p_current;
@@ -838,6 +1032,104 @@ static int AStreamPeekBlock( stream_t *s, const uint8_t **pp_peek, unsigned int
     return i_data;
 }
 
+static int AStreamPeekVBlock( stream_t *s, struct iovec *iov, unsigned *pi_iov,
+                              unsigned int i_read )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    unsigned int i_data = 0;
+    unsigned i_iov = 0;
+
+    if( p_sys->block.p_current != NULL )
+        AStreamFillBlock( s, i_read );
+
+    block_t *b = p_sys->block.p_current;
+    size_t i_offset = p_sys->block.i_offset;
+
+    while( b && i_data < i_read && i_iov < *pi_iov )
+    {
+        size_t i_len = __MIN( b->i_buffer - i_offset, i_read - i_data );
+
+        if( i_len > 0 )
+        {
+            iov[i_iov].iov_base = &b->p_buffer[i_offset];
+            iov[i_iov].iov_len = i_len;
+            i_iov++;
+            i_data += i_len;
+        }
+        i_offset = 0;
+        b = b->p_next;
+    }
+    *pi_iov = i_iov;
+    return i_data;
+}
+
+/* Hands out the buffered block holding the next i_size bytes, if they
+ * end it or nearly so. The data before the block is dropped from the
+ * cache, as the block is given to the caller. */
+static block_t *AStreamBlockBlock( stream_t *s, unsigned int i_size )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    block_t *b = p_sys->block.p_current;
+
+    /* It means EOF */
+    if( b == NULL )
+        return NULL;
+
+    const size_t i_offset = p_sys->block.i_offset;
+    const size_t i_avail = b->i_buffer - i_offset;
+
+    /* The end of the block is kept in a copy, which must not be larger
+     * than the data a plain read would copy */
+    if( i_avail < i_size || i_avail - i_size > i_size )
+        return BlockCopy( s, i_size );
+
+    block_t *p_next = b->p_next;
+    if( i_avail > i_size )
+    {
+        block_t *p_tail = block_Alloc( i_avail - i_size );
+        if( p_tail == NULL )
+            return BlockCopy( s, i_size );
+        memcpy( p_tail->p_buffer, &b->p_buffer[i_offset + i_size],
+                p_tail->i_buffer );
+        p_tail->p_next = p_next;
+        if( p_sys->block.pp_last == &b->p_next )
+            p_sys->block.pp_last = &p_tail->p_next;
+        p_next = p_tail;
+    }
+    else if( p_sys->block.pp_last == &b->p_next )
+        p_sys->block.pp_last = &p_sys->block.p_first;
+
+    /* Release data */
+    while( p_sys->block.p_first != b )
+    {
+        block_t *p_old = p_sys->block.p_first;
+
+        p_sys->block.p_first = p_old->p_next;
+        block_Release( p_old );
+    }
+    p_sys->block.p_first = p_next;
+
+    p_sys->i_pos += i_size;
+    p_sys->block.i_size -= p_sys->i_pos - p_sys->block.i_start;
+    p_sys->block.i_start = p_sys->i_pos;
+    p_sys->block.p_current = p_next;
+    p_sys->block.i_offset = 0;
+
+    /* Get a new block if needed */
+    if( !p_sys->block.p_current )
+        AStreamRefillBlock( s );
+
+    /* Return the data as a read would */
+    b->p_next = NULL;
+    b->p_buffer += i_offset;
+    b->i_buffer = i_size;
+    b->i_flags = 0;
+    b->i_nb_samples = 0;
+    b->i_pts = b->i_dts = VLC_TS_INVALID;
+    b->i_length = 0;
+    return b;
+}
+
 static int AStreamSeekBlock( stream_t *s, uint64_t i_pos )
 {
     stream_sys_t *p_sys = s->p_sys;
@@ -903,7 +1195,7 @@ static int AStreamSeekBlock( stream_t *s, uint64_t i_pos )
             int i_th = b_aseekfast ? 1 : 5;
 
             if( i_skip <= i_th * i_avg &&
-                i_skip < STREAM_CACHE_SIZE )
+                i_skip < p_sys->i_cache_size )
                 b_seek = false;
             else
                 b_seek = true;
@@ -975,7 +1267,7 @@ static int AStreamRefillBlock( stream_t *s )
     block_t      *b;
 
     /* Release data */
-    while( p_sys->block.i_size >= STREAM_CACHE_SIZE &&
+    while( p_sys->block.i_size >= p_sys->i_cache_size &&
            p_sys->block.p_first != p_sys->block.p_current )
     {
         block_t *b = p_sys->block.p_first;
@@ -986,7 +1278,7 @@ static int AStreamRefillBlock( stream_t *s )
 
         block_Release( b );
     }
-    if( p_sys->block.i_size >= STREAM_CACHE_SIZE &&
+    if( p_sys->block.i_size >= p_sys->i_cache_size &&
         p_sys->block.p_current == p_sys->block.p_first &&
         p_sys->block.p_current->p_next )    /* At least 2 packets */
     {
@@ -1038,6 +1330,47 @@ static int AStreamRefillBlock( stream_t *s )
 static int AStreamRefillStream( stream_t *s );
 static int AStreamReadNoSeekStream( stream_t *s, void *p_read, unsigned int i_read );
 
+static int AStreamReadStreamAhead( stream_t *s, void *p_read, unsigned int i_read )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    int i_ret;
+
+    vlc_mutex_lock( &p_sys->prefetch.lock );
+    if( !p_read )
+    {   /* Skipping may seek the access */
+        AStreamPrefetchPause( s );
+        i_ret = AStreamReadStream( s, p_read, i_read );
+        AStreamPrefetchResume( s );
+    }
+    else
+        i_ret = AStreamReadStream( s, p_read, i_read );
+    /* Room was made in the track */
+    vlc_cond_signal( &p_sys->prefetch.wait );
+    vlc_mutex_unlock( &p_sys->prefetch.lock );
+    return i_ret;
+}
+
+static int AStreamPeekStreamAhead( stream_t *s, const uint8_t **pp_peek, unsigned int i_read )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    vlc_mutex_lock( &p_sys->prefetch.lock );
+    int i_ret = AStreamPeekStream( s, pp_peek, i_read );
+    vlc_mutex_unlock( &p_sys->prefetch.lock );
+    return i_ret;
+}
+
+static int AStreamPeekVStreamAhead( stream_t *s, struct iovec *iov,
+                                    unsigned *pi_iov, unsigned int i_read )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    vlc_mutex_lock( &p_sys->prefetch.lock );
+    int i_ret = AStreamPeekVStream( s, iov, pi_iov, i_read );
+    vlc_mutex_unlock( &p_sys->prefetch.lock );
+    return i_ret;
+}
+
 static int AStreamReadStream( stream_t *s, void *p_read, unsigned int i_read )
 {
     stream_sys_t *p_sys = s->p_sys;
@@ -1056,24 +1389,16 @@ static int AStreamReadStream( stream_t *s, void *p_read, unsigned int i_read )
     return AStreamReadNoSeekStream( s, p_read, i_read );
 }
 
-static int AStreamPeekStream( stream_t *s, const uint8_t **pp_peek, unsigned int i_read )
+/* Buffers up to i_read bytes after the position in the current track
+ * \return the number of buffered bytes */
+static unsigned int AStreamFillStream( stream_t *s, unsigned int i_read )
 {
     stream_sys_t *p_sys = s->p_sys;
     stream_track_t *tk = &p_sys->stream.tk[p_sys->stream.i_tk];
-    uint64_t i_off;
-
-    if( tk->i_start >= tk->i_end ) return 0; /* EOF */
-
-#ifdef STREAM_DEBUG
-    msg_Dbg( s, "AStreamPeekStream: %d pos=%"PRId64" tk=%d "
-             "start=%"PRId64" offset=%d end=%"PRId64,
-             i_read, p_sys->i_pos, p_sys->stream.i_tk,
-             tk->i_start, p_sys->stream.i_offset, tk->i_end );
-#endif
 
     /* Avoid problem, but that should *never* happen */
-    if( i_read > STREAM_CACHE_TRACK_SIZE / 2 )
-        i_read = STREAM_CACHE_TRACK_SIZE / 2;
+    if( i_read > p_sys->stream.i_tk_size / 2 )
+        i_read = p_sys->stream.i_tk_size / 2;
 
     while( tk->i_end < tk->i_start + p_sys->stream.i_offset + i_read )
     {
@@ -1089,11 +1414,61 @@ static int AStreamPeekStream( stream_t *s, const uint8_t **pp_peek, unsigned int
     {
         i_read = tk->i_end - tk->i_start - p_sys->stream.i_offset;
     }
+    return i_read;
+}
+
+static int AStreamPeekVStream( stream_t *s, struct iovec *iov, unsigned *pi_iov,
+                               unsigned int i_read )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    stream_track_t *tk = &p_sys->stream.tk[p_sys->stream.i_tk];
+
+    if( tk->i_start >= tk->i_end )
+    {
+        *pi_iov = 0;
+        return 0; /* EOF */
+    }
+
+    i_read = AStreamFillStream( s, i_read );
+
+    /* At most two pieces, as the track is a ring buffer */
+    unsigned i_off = (tk->i_start + p_sys->stream.i_offset) % p_sys->stream.i_tk_size;
+    unsigned i_len = __MIN( i_read, p_sys->stream.i_tk_size - i_off );
+
+    iov[0].iov_base = &tk->p_buffer[i_off];
+    iov[0].iov_len = i_len;
+    if( i_len < i_read && *pi_iov > 1 )
+    {
+        iov[1].iov_base = &tk->p_buffer[0];
+        iov[1].iov_len = i_read - i_len;
+        *pi_iov = 2;
+        return i_read;
+    }
+    *pi_iov = 1;
+    return i_len;
+}
+
+static int AStreamPeekStream( stream_t *s, const uint8_t **pp_peek, unsigned int i_read )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    stream_track_t *tk = &p_sys->stream.tk[p_sys->stream.i_tk];
+    uint64_t i_off;
+
+    if( tk->i_start >= tk->i_end ) return 0; /* EOF */
+
+#ifdef STREAM_DEBUG
+    msg_Dbg( s, "AStreamPeekStream: %d pos=%"PRId64" tk=%d "
+             "start=%"PRId64" offset=%d end=%"PRId64,
+             i_read, p_sys->i_pos, p_sys->stream.i_tk,
+             tk->i_start, p_sys->stream.i_offset, tk->i_end );
+#endif
+
+    i_read = AStreamFillStream( s, i_read );
 
 
     /* Now, direct pointer or a copy ? */
-    i_off = (tk->i_start + p_sys->stream.i_offset) % STREAM_CACHE_TRACK_SIZE;
-    if( i_off + i_read <= STREAM_CACHE_TRACK_SIZE )
+    i_off = (tk->i_start + p_sys->stream.i_offset) % p_sys->stream.i_tk_size;
+    if( i_off + i_read <= p_sys->stream.i_tk_size )
     {
         *pp_peek = &tk->p_buffer[i_off];
         return i_read;
@@ -1111,14 +1486,39 @@ static int AStreamPeekStream( stream_t *s, const uint8_t **pp_peek, unsigned int
     }
 
     memcpy( p_sys->p_peek, &tk->p_buffer[i_off],
-            STREAM_CACHE_TRACK_SIZE - i_off );
-    memcpy( &p_sys->p_peek[STREAM_CACHE_TRACK_SIZE - i_off],
-            &tk->p_buffer[0], i_read - (STREAM_CACHE_TRACK_SIZE - i_off) );
+            p_sys->stream.i_tk_size - i_off );
+    memcpy( &p_sys->p_peek[p_sys->stream.i_tk_size - i_off],
+            &tk->p_buffer[0], i_read - (p_sys->stream.i_tk_size - i_off) );
 
     *pp_peek = p_sys->p_peek;
     return i_read;
 }
 
+/* Seeks the access, measuring how long it takes */
+static int AStreamSeekAccess( stream_t *s, uint64_t i_pos )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    const int64_t i_start = mdate();
+
+    if( ASeek( s, i_pos ) )
+        return VLC_EGENERIC;
+    p_sys->stat.i_seek_time += mdate() - i_start;
+    p_sys->stat.i_seek_count++;
+    return VLC_SUCCESS;
+}
+
+/* Estimates how long a seek of the access takes */
+static int64_t AStreamSeekCost( stream_t *s, bool b_fastseek )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    if( b_fastseek )
+        return 0;
+    if( p_sys->stat.i_seek_count == 0 )
+        return CLOCK_FREQ / 20; /* No measure yet */
+    return p_sys->stat.i_seek_time / p_sys->stat.i_seek_count;
+}
+
 static int AStreamSeekStream( stream_t *s, uint64_t i_pos )
 {
     stream_sys_t *p_sys = s->p_sys;
@@ -1149,15 +1549,28 @@ static int AStreamSeekStream( stream_t *s, uint64_t i_pos )
     bool   b_afastseek;
     access_Control( p_access, ACCESS_CAN_FASTSEEK, &b_afastseek );
 
-    /* FIXME compute seek cost (instead of static 'stupid' value) */
+    /* Skip rather than seek as long as reading costs less than seeking */
+    const int64_t i_seek_cost = AStreamSeekCost( s, b_afastseek );
     uint64_t i_skip_threshold;
-    if( b_aseek )
-        i_skip_threshold = b_afastseek ? 128 : 3*p_sys->stream.i_read_size;
-    else
+    if( !b_aseek )
         i_skip_threshold = INT64_MAX;
+    else if( b_afastseek )
+        i_skip_threshold = 128;
+    else
+    {
+        i_skip_threshold = 3*p_sys->stream.i_read_size;
+        if( p_sys->stat.i_read_time > 0 )
+        {
+            uint64_t i_bytes = p_sys->stat.i_bytes * i_seek_cost
+                             / p_sys->stat.i_read_time;
+            i_skip_threshold = __MAX( i_skip_threshold,
+                               __MIN( i_bytes, p_sys->stream.i_tk_size / 2 ) );
+        }
+    }
 
     /* Date the current track */
-    p_current->i_date = mdate();
+    const int64_t i_now = mdate();
+    p_current->i_date = i_now;
 
     /* Search a new track slot */
     stream_track_t *tk = NULL;
@@ -1172,7 +1585,7 @@ static int AStreamSeekStream( stream_t *s, uint64_t i_pos )
     if( !tk )
     {
         /* Try to maximize already read data */
-        for( int i = 0; i < STREAM_CACHE_TRACK; i++ )
+        for( int i = 0; i < p_sys->stream.i_tk_count; i++ )
         {
             stream_track_t *t = &p_sys->stream.tk[i];
 
@@ -1188,19 +1601,32 @@ static int AStreamSeekStream( stream_t *s, uint64_t i_pos )
     }
     if( !tk )
     {
-        /* Use the oldest unused */
-        for( int i = 0; i < STREAM_CACHE_TRACK; i++ )
+        /* Drop the track that is the cheapest to read again for how long
+         * it has not been used: the least recently used one if seeking is
+         * what costs most, otherwise the smaller ones go first */
+        double f_best = 0.;
+        for( int i = 0; i < p_sys->stream.i_tk_count; i++ )
         {
             stream_track_t *t = &p_sys->stream.tk[i];
 
-            if( !tk || tk->i_date > t->i_date )
+            if( t == p_current && p_sys->stream.i_tk_count > 1 )
+                continue;
+
+            double f_cost = i_seek_cost;
+            if( p_sys->stat.i_bytes > 0 )
+                f_cost += (double)(t->i_end - t->i_start)
+                        * p_sys->stat.i_read_time / p_sys->stat.i_bytes;
+            double f_value = (f_cost + 1.) / (i_now - t->i_date + 1);
+
+            if( !tk || f_value < f_best )
             {
                 tk = t;
                 i_tk_idx = i;
+                f_best = f_value;
             }
         }
     }
-    assert( i_tk_idx >= 0 && i_tk_idx < STREAM_CACHE_TRACK );
+    assert( i_tk_idx >= 0 && i_tk_idx < p_sys->stream.i_tk_count );
 
     if( tk != p_current )
         i_skip_threshold = 0;
@@ -1219,7 +1645,7 @@ static int AStreamSeekStream( stream_t *s, uint64_t i_pos )
             /* Seek at the end of the buffer
              * TODO it is stupid to seek now, it would be better to delay it
              */
-            if( ASeek( s, tk->i_end ) )
+            if( AStreamSeekAccess( s, tk->i_end ) )
                 return VLC_EGENERIC;
         }
         else if( i_pos > tk->i_end )
@@ -1239,8 +1665,8 @@ static int AStreamSeekStream( stream_t *s, uint64_t i_pos )
 #ifdef STREAM_DEBUG
         msg_Err( s, "AStreamSeekStream: hard seek" );
 #endif
-        /* Nothing good, seek and choose oldest segment */
-        if( ASeek( s, i_pos ) )
+        /* Nothing good, seek and choose the cheapest segment */
+        if( AStreamSeekAccess( s, i_pos ) )
             return VLC_EGENERIC;
 
         tk->i_start = i_pos;
@@ -1286,10 +1712,10 @@ static int AStreamReadNoSeekStream( stream_t *s, void *p_read, unsigned int i_re
 
     while( i_data < i_read )
     {
-        unsigned i_off = (tk->i_start + p_sys->stream.i_offset) % STREAM_CACHE_TRACK_SIZE;
+        unsigned i_off = (tk->i_start + p_sys->stream.i_offset) % p_sys->stream.i_tk_size;
         unsigned int i_current =
             __MIN( tk->i_end - tk->i_start - p_sys->stream.i_offset,
-                   STREAM_CACHE_TRACK_SIZE - i_off );
+                   p_sys->stream.i_tk_size - i_off );
         int i_copy = __MIN( i_current, i_read - i_data );
 
         if( i_copy <= 0 ) break; /* EOF */
@@ -1331,14 +1757,36 @@ static int AStreamReadNoSeekStream( stream_t *s, void *p_read, unsigned int i_re
 }
 
 
+/* Waits for the read-ahead thread to extend the current track (lock held) */
+static int AStreamWaitStream( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    stream_track_t *tk = &p_sys->stream.tk[p_sys->stream.i_tk];
+    const uint64_t i_end = tk->i_end;
+    const int64_t i_start = mdate();
+
+    vlc_cond_signal( &p_sys->prefetch.wait );
+    while( tk->i_end == i_end )
+    {
+        if( p_sys->prefetch.b_eof || s->b_die )
+            return VLC_EGENERIC;
+        vlc_cond_wait( &p_sys->prefetch.done, &p_sys->prefetch.lock );
+    }
+    p_sys->stat.i_read_time += mdate() - i_start;
+    return VLC_SUCCESS;
+}
+
 static int AStreamRefillStream( stream_t *s )
 {
     stream_sys_t *p_sys = s->p_sys;
     stream_track_t *tk = &p_sys->stream.tk[p_sys->stream.i_tk];
 
+    if( p_sys->prefetch.b_enabled && p_sys->prefetch.i_paused == 0 )
+        return AStreamWaitStream( s );
+
     /* We read but won't increase i_start after initial start + offset */
     int i_toread =
-        __MIN( p_sys->stream.i_used, STREAM_CACHE_TRACK_SIZE -
+        __MIN( p_sys->stream.i_used, p_sys->stream.i_tk_size -
                (tk->i_end - tk->i_start - p_sys->stream.i_offset) );
     bool b_read = false;
     int64_t i_start, i_stop;
@@ -1353,13 +1801,13 @@ static int AStreamRefillStream( stream_t *s )
     i_start = mdate();
     while( i_toread > 0 )
     {
-        int i_off = tk->i_end % STREAM_CACHE_TRACK_SIZE;
+        int i_off = tk->i_end % p_sys->stream.i_tk_size;
         int i_read;
 
         if( s->b_die )
             return VLC_EGENERIC;
 
-        i_read = __MIN( i_toread, STREAM_CACHE_TRACK_SIZE - i_off );
+        i_read = __MIN( i_toread, p_sys->stream.i_tk_size - i_off );
         i_read = AReadStream( s, &tk->p_buffer[i_off], i_read );
 
         /* msg_Dbg( s, "AStreamRefillStream: read=%d", i_read ); */
@@ -1378,10 +1826,10 @@ static int AStreamRefillStream( stream_t *s )
         /* Update end */
         tk->i_end += i_read;
 
-        /* Windows of STREAM_CACHE_TRACK_SIZE */
-        if( tk->i_start + STREAM_CACHE_TRACK_SIZE < tk->i_end )
+        /* Windows of the track size */
+        if( tk->i_start + p_sys->stream.i_tk_size < tk->i_end )
         {
-            unsigned i_invalid = tk->i_end - tk->i_start - STREAM_CACHE_TRACK_SIZE;
+            unsigned i_invalid = tk->i_end - tk->i_start - p_sys->stream.i_tk_size;
 
             tk->i_start += i_invalid;
             p_sys->stream.i_offset -= i_invalid;
@@ -1400,6 +1848,61 @@ static int AStreamRefillStream( stream_t *s )
     return VLC_SUCCESS;
 }
 
+static void *AStreamPrefetchThread( void *data )
+{
+    stream_t *s = data;
+    stream_sys_t *p_sys = s->p_sys;
+
+    vlc_mutex_lock( &p_sys->prefetch.lock );
+    while( !p_sys->prefetch.b_exit )
+    {
+        stream_track_t *tk = &p_sys->stream.tk[p_sys->stream.i_tk];
+        const unsigned i_free = p_sys->stream.i_tk_size -
+                      (tk->i_end - tk->i_start - p_sys->stream.i_offset);
+
+        if( p_sys->prefetch.i_paused > 0 || p_sys->prefetch.b_eof ||
+            s->b_die || i_free < STREAM_READ_ATONCE )
+        {
+            vlc_cond_wait( &p_sys->prefetch.wait, &p_sys->prefetch.lock );
+            continue;
+        }
+
+        /* Fill the free part of the ring, the reader will not touch it */
+        const unsigned i_off = tk->i_end % p_sys->stream.i_tk_size;
+        int i_read = __MIN( i_free, p_sys->stream.i_tk_size - i_off );
+        i_read = __MIN( i_read, STREAM_PREFETCH_ATONCE );
+
+        p_sys->prefetch.b_busy = true;
+        vlc_mutex_unlock( &p_sys->prefetch.lock );
+
+        i_read = AReadStream( s, &tk->p_buffer[i_off], i_read );
+
+        vlc_mutex_lock( &p_sys->prefetch.lock );
+        p_sys->prefetch.b_busy = false;
+        if( i_read > 0 )
+        {
+            tk->i_end += i_read;
+
+            /* Windows of the track size */
+            if( tk->i_start + p_sys->stream.i_tk_size < tk->i_end )
+            {
+                unsigned i_invalid = tk->i_end - tk->i_start - p_sys->stream.i_tk_size;
+
+                tk->i_start += i_invalid;
+                p_sys->stream.i_offset -= i_invalid;
+            }
+
+            p_sys->stat.i_bytes += i_read;
+            p_sys->stat.i_read_count++;
+        }
+        else if( i_read == 0 )
+            p_sys->prefetch.b_eof = true;
+        vlc_cond_broadcast( &p_sys->prefetch.done );
+    }
+    vlc_mutex_unlock( &p_sys->prefetch.lock );
+    return NULL;
+}
+
 static void AStreamPrebufferStream( stream_t *s )
 {
     stream_sys_t *p_sys = s->p_sys;
@@ -1436,7 +1939,7 @@ static void AStreamPrebufferStream( stream_t *s )
         }
 
         /* */
-        i_read = STREAM_CACHE_TRACK_SIZE - i_buffered;
+        i_read = p_sys->stream.i_tk_size - i_buffered;
         i_read = __MIN( (int)p_sys->stream.i_read_size, i_read );
         i_read = AReadStream( s, &tk->p_buffer[i_buffered], i_read );
         if( i_read <  0 )
@@ -1760,12 +2263,18 @@ static block_t *AReadBlock( stream_t *s, bool *pb_eof )
         if( pb_eof ) *pb_eof = p_access->info.b_eof;
         if( p_input && p_block && libvlc_stats (p_access) )
         {
+            /* The access may return several packets at once */
+            size_t i_size;
+            int i_count;
+
+            block_ChainProperties( p_block, &i_count, &i_size, NULL );
             vlc_mutex_lock( &p_input->p->counters.counters_lock );
             stats_UpdateInteger( s, p_input->p->counters.p_read_bytes,
-                                 p_block->i_buffer, &i_total );
+                                 i_size, &i_total );
             stats_UpdateFloat( s, p_input->p->counters.p_input_bitrate,
                               (float)i_total, NULL );
-            stats_UpdateInteger( s, p_input->p->counters.p_read_packets, 1, NULL );
+            stats_UpdateInteger( s, p_input->p->counters.p_read_packets,
+                                 i_count, NULL );
             vlc_mutex_unlock( &p_input->p->counters.counters_lock );
         }
         return p_block;
@@ -1895,6 +2404,36 @@ int stream_Peek( stream_t *s, const uint8_t **pp_peek, int i_peek )
     return s->pf_peek( s, pp_peek, i_peek );
 }
 
+/**
+ * Store in iov the locations of the next "i_peek" bytes in the stream, as
+ * they lie in the stream buffers, without making them contiguous.
+ * \param pi_iov the number of entries of iov, set to the number of used
+ * entries on return
+ * \return The real number of valid bytes (as stream_Peek()). It can also be
+ * less than i_peek if there are not enough iov entries.
+ * \note The iov entries are invalid as soon as other stream_* functions are
+ * called. Streams that cannot scatter their data fall back to stream_Peek().
+ */
+int stream_PeekV( stream_t *s, struct iovec *iov, unsigned *pi_iov, int i_peek )
+{
+    if( *pi_iov == 0 )
+        return 0;
+    if( s->pf_peekv != NULL )
+        return s->pf_peekv( s, iov, pi_iov, i_peek );
+
+    const uint8_t *p_peek;
+    int i_ret = s->pf_peek( s, &p_peek, i_peek );
+    if( i_ret > 0 )
+    {
+        iov[0].iov_base = (uint8_t *)p_peek;
+        iov[0].iov_len = i_ret;
+        *pi_iov = 1;
+    }
+    else
+        *pi_iov = 0;
+    return i_ret;
+}
+
 /**
  * Use to control the "stream_t *". Look at #stream_query_e for
  * possible "i_query" value and format arguments.  Return VLC_SUCCESS
@@ -1927,15 +2466,8 @@ int stream_Control( stream_t *s, int i_query, ... )
     return i_result;
 }
 
-/**
- * Read "i_size" bytes and store them in a block_t.
- * It always read i_size bytes unless you are at the end of the stream
- * where it return what is available.
- */
-block_t *stream_Block( stream_t *s, int i_size )
+static block_t *BlockCopy( stream_t *s, unsigned int i_size )
 {
-    if( i_size <= 0 ) return NULL;
-
     /* emulate block read */
     block_t *p_bk = block_New( s, i_size );
     if( p_bk )
@@ -1951,6 +2483,23 @@ block_t *stream_Block( stream_t *s, int i_size )
     return NULL;
 }
 
+/**
+ * Read "i_size" bytes and store them in a block_t.
+ * It always read i_size bytes unless you are at the end of the stream
+ * where it return what is available.
+ *
+ * Streams fed by a block access may return the access block itself, instead
+ * of a copy of its data, when it holds the requested bytes.
+ */
+block_t *stream_Block( stream_t *s, int i_size )
+{
+    if( i_size <= 0 ) return NULL;
+
+    if( s->pf_block != NULL )
+        return s->pf_block( s, i_size );
+    return BlockCopy( s, i_size );
+}
+
 /**
  * Read the remaining of the data if there is less than i_max_size bytes, otherwise
  * return NULL.
@@ -52,6 +52,18 @@ void stream_CommonDelete( stream_t * );
  */
 stream_t *stream_AccessNew( access_t *p_access, char **ppsz_list );
 
+/**
+ * This function creates a stream_t reading the regular local file opened by
+ * the provided access_t through a memory mapping.
+ *
+ * It returns NULL if the access is not suitable. The access is not deleted
+ * with the stream.
+ */
+stream_t *stream_MmapNew( access_t *p_access );
+
+void stream_AccessLock( stream_t * );
+void stream_AccessUnlock( stream_t * );
+
 /**
  * This function creates a new stream_t filter.
  *
@@ -0,0 +1,349 @@
+/*****************************************************************************
+ * stream_mmap.c: stream_t over a memory mapped local file
+ *****************************************************************************
+ * Copyright (C) 2008-2012 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_access.h>
+
+#include "stream.h"
+
+#ifdef HAVE_MMAP
+#include <vlc_fs.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "input_internal.h"
+
+/* Size of the mapped window. On 64-bits, the whole file is mapped at once;
+ * on 32-bits, the address space is too scarce for that. */
+#if SIZE_MAX > UINT32_MAX
+# define STREAM_MMAP_WINDOW (SIZE_MAX / 4)
+#else
+# define STREAM_MMAP_WINDOW (32 * 1024 * 1024)
+#endif
+
+/* Number of reads between checks for a growing file */
+#define STREAM_MMAP_FSTAT_NB_READS 64
+
+struct stream_sys_t
+{
+    access_t   *p_access;   /* Kept for the controls only */
+    int         fd;
+
+    uint64_t    i_pos;      /* Current reading offset */
+    uint64_t    i_size;
+    unsigned    i_nb_reads;
+
+    /* Mapped window */
+    uint8_t    *p_base;
+    uint64_t    i_start;
+    size_t      i_length;
+    size_t      i_page;
+};
+
+static int  Read   ( stream_t *, void *p_read, unsigned int i_read );
+static int  Peek   ( stream_t *, const uint8_t **pp_peek, unsigned int i_read );
+static int  Control( stream_t *, int i_query, va_list );
+static void Delete ( stream_t * );
+
+/**
+ * Creates a stream reading a regular local file through a memory mapping,
+ * instead of read() into the stream cache. stream_Peek() then points
+ * directly into the mapping.
+ *
+ * The access is used for the controls only. It is not deleted with the
+ * stream.
+ *
+ * \return the stream, or NULL if the access is not suitable (the caller
+ * should then fall back to stream_AccessNew())
+ */
+stream_t *stream_MmapNew( access_t *p_access )
+{
+    if( strcmp( p_access->psz_access, "file" )
+     || p_access->psz_filepath == NULL )
+        return NULL;
+
+    int fd = vlc_open( p_access->psz_filepath, O_RDONLY );
+    if( fd == -1 )
+        return NULL;
+
+    struct stat st;
+    if( fstat( fd, &st ) || !S_ISREG( st.st_mode ) || st.st_size <= 0 )
+    {
+        close( fd );
+        return NULL;
+    }
+
+    stream_t *s = stream_CommonNew( VLC_OBJECT(p_access) );
+    if( !s )
+    {
+        close( fd );
+        return NULL;
+    }
+
+    stream_sys_t *p_sys;
+    s->p_input = p_access->p_input;
+    s->psz_access = strdup( p_access->psz_access );
+    s->psz_path = strdup( p_access->psz_location );
+    s->p_sys = p_sys = malloc( sizeof( *p_sys ) );
+    if( !s->psz_access || !s->psz_path || !s->p_sys )
+    {
+        free( s->p_sys );
+        stream_CommonDelete( s );
+        close( fd );
+        return NULL;
+    }
+
+    p_sys->p_access = p_access;
+    p_sys->fd = fd;
+    p_sys->i_pos = p_access->info.i_pos;
+    p_sys->i_size = st.st_size;
+    p_sys->i_nb_reads = 0;
+    p_sys->p_base = NULL;
+    p_sys->i_start = 0;
+    p_sys->i_length = 0;
+    p_sys->i_page = sysconf( _SC_PAGESIZE );
+
+    s->pf_read    = Read;
+    s->pf_peek    = Peek;
+    s->pf_control = Control;
+    s->pf_destroy = Delete;
+
+    msg_Dbg( s, "using memory mapping for `%s' (%"PRIu64" bytes)",
+             p_access->psz_filepath, p_sys->i_size );
+    return s;
+}
+
+static void Delete( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    if( p_sys->p_base != NULL )
+        munmap( p_sys->p_base, p_sys->i_length );
+    close( p_sys->fd );
+    free( p_sys );
+    stream_CommonDelete( s );
+}
+
+/* Checks whether the file grew (or shrank) since it was mapped */
+static void UpdateSize( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    struct stat st;
+
+    if( fstat( p_sys->fd, &st ) == 0 && (uint64_t)st.st_size != p_sys->i_size )
+    {
+        p_sys->i_size = st.st_size;
+        /* Drop the window, it may extend past the end of the file */
+        if( p_sys->p_base != NULL
+         && p_sys->i_start + p_sys->i_length > p_sys->i_size )
+        {
+            munmap( p_sys->p_base, p_sys->i_length );
+            p_sys->p_base = NULL;
+            p_sys->i_length = 0;
+        }
+    }
+}
+
+/**
+ * Makes sure that the bytes from the current position up to i_len further
+ * are mapped.
+ * \return the number of available bytes (may be less than i_len at the end
+ * of the file), or -1 on error
+ */
+static ssize_t Map( stream_t *s, size_t i_len )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    if( (++p_sys->i_nb_reads % STREAM_MMAP_FSTAT_NB_READS) == 0
+     || p_sys->i_pos + i_len > p_sys->i_size )
+        UpdateSize( s );
+
+    if( p_sys->i_pos >= p_sys->i_size )
+        return 0;
+    if( i_len > p_sys->i_size - p_sys->i_pos )
+        i_len = p_sys->i_size - p_sys->i_pos;
+
+    if( p_sys->p_base != NULL && p_sys->i_pos >= p_sys->i_start
+     && p_sys->i_pos + i_len <= p_sys->i_start + p_sys->i_length )
+        return i_len;
+
+    /* Map a new window starting at the page of the current position */
+    uint64_t i_start = p_sys->i_pos - (p_sys->i_pos % p_sys->i_page);
+    uint64_t i_length = __MAX( STREAM_MMAP_WINDOW, p_sys->i_pos + i_len - i_start );
+    if( i_length > p_sys->i_size - i_start )
+        i_length = p_sys->i_size - i_start;
+
+    if( p_sys->p_base != NULL )
+        munmap( p_sys->p_base, p_sys->i_length );
+    p_sys->p_base = mmap( NULL, i_length, PROT_READ, MAP_SHARED,
+                          p_sys->fd, i_start );
+    if( p_sys->p_base == MAP_FAILED )
+    {
+        msg_Err( s, "cannot map file (%m)" );
+        p_sys->p_base = NULL;
+        p_sys->i_length = 0;
+        return -1;
+    }
+#ifdef HAVE_POSIX_MADVISE
+    posix_madvise( p_sys->p_base, i_length, POSIX_MADV_SEQUENTIAL );
+#endif
+    p_sys->i_start = i_start;
+    p_sys->i_length = i_length;
+    return i_len;
+}
+
+static void UpdateStats( stream_t *s, int i_read )
+{
+    input_thread_t *p_input = s->p_input;
+    int i_total = 0;
+
+    if( p_input == NULL || i_read <= 0 )
+        return;
+
+    vlc_mutex_lock( &p_input->p->counters.counters_lock );
+    stats_UpdateInteger( s, p_input->p->counters.p_read_bytes, i_read,
+                         &i_total );
+    stats_UpdateFloat( s, p_input->p->counters.p_input_bitrate,
+                       (float)i_total, NULL );
+    stats_UpdateInteger( s, p_input->p->counters.p_read_packets, 1, NULL );
+    vlc_mutex_unlock( &p_input->p->counters.counters_lock );
+}
+
+static int Read( stream_t *s, void *p_read, unsigned int i_read )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    unsigned int i_done = 0;
+
+    if( p_read == NULL )
+    {   /* Skip without mapping */
+        UpdateSize( s );
+        if( p_sys->i_pos < p_sys->i_size )
+            i_done = __MIN( i_read, p_sys->i_size - p_sys->i_pos );
+        p_sys->i_pos += i_done;
+        UpdateStats( s, i_done );
+        return i_done;
+    }
+
+    /* Copy window by window, so that large reads work with small windows */
+    while( i_done < i_read )
+    {
+        ssize_t i_len = Map( s, __MIN( i_read - i_done, STREAM_MMAP_WINDOW ) );
+        if( i_len <= 0 )
+            break;
+
+        memcpy( (uint8_t *)p_read + i_done,
+                p_sys->p_base + (p_sys->i_pos - p_sys->i_start), i_len );
+        p_sys->i_pos += i_len;
+        i_done += i_len;
+    }
+    UpdateStats( s, i_done );
+    return i_done;
+}
+
+static int Peek( stream_t *s, const uint8_t **pp_peek, unsigned int i_read )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    ssize_t i_len = Map( s, i_read );
+    if( i_len < 0 )
+        return -1;
+    if( i_len > 0 )
+        *pp_peek = p_sys->p_base + (p_sys->i_pos - p_sys->i_start);
+    return i_len;
+}
+
+static int Control( stream_t *s, int i_query, va_list args )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    access_t *p_access = p_sys->p_access;
+
+    bool *p_bool;
+    uint64_t   *pi_64, i_64;
+    int         i_int;
+
+    switch( i_query )
+    {
+        case STREAM_GET_SIZE:
+            pi_64 = va_arg( args, uint64_t * );
+            *pi_64 = p_sys->i_size;
+            break;
+
+        case STREAM_CAN_SEEK:
+        case STREAM_CAN_FASTSEEK:
+            p_bool = (bool*)va_arg( args, bool * );
+            *p_bool = true;
+            break;
+
+        case STREAM_GET_POSITION:
+            pi_64 = va_arg( args, uint64_t * );
+            *pi_64 = p_sys->i_pos;
+            break;
+
+        case STREAM_SET_POSITION:
+            i_64 = va_arg( args, uint64_t );
+            p_sys->i_pos = i_64;
+            break;
+
+        case STREAM_UPDATE_SIZE:
+            UpdateSize( s );
+            break;
+
+        case STREAM_CONTROL_ACCESS:
+            i_int = (int) va_arg( args, int );
+            if( i_int != ACCESS_SET_PRIVATE_ID_STATE &&
+                i_int != ACCESS_SET_PRIVATE_ID_CA &&
+                i_int != ACCESS_GET_PRIVATE_ID_STATE &&
+                i_int != ACCESS_SET_TITLE &&
+                i_int != ACCESS_SET_SEEKPOINT )
+            {
+                msg_Err( s, "Hey, what are you thinking ?"
+                            "DON'T USE STREAM_CONTROL_ACCESS !!!" );
+                return VLC_EGENERIC;
+            }
+            return access_vaControl( p_access, i_int, args );
+
+        case STREAM_GET_CONTENT_TYPE:
+            return access_Control( p_access, ACCESS_GET_CONTENT_TYPE,
+                                   va_arg( args, char ** ) );
+
+        case STREAM_SET_RECORD_STATE:
+        default:
+            msg_Err( s, "invalid stream_vaControl query=0x%x", i_query );
+            return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+#else /* !HAVE_MMAP */
+stream_t *stream_MmapNew( access_t *p_access )
+{
+    (void) p_access;
+    return NULL;
+}
+#endif
@@ -627,6 +627,18 @@ static const char *const ppsz_pos_descriptions[] =
     "Enables framedropping on MPEG2 stream. Framedropping " \
     "occurs when your computer is not powerful enough" )
 
+#define KEYFRAMES_ONLY_TEXT N_("Decode only the keyframes")
+#define KEYFRAMES_ONLY_LONGTEXT N_( \
+    "Only the intra pictures of the video are decoded, the other ones are " \
+    "dropped. This is much faster to extract snapshots or scenes, " \
+    "especially along with fast seeking." )
+
+#define CHROMA_THREADS_TEXT N_("Conversion threads")
+#define CHROMA_THREADS_LONGTEXT N_( \
+    "Number of threads converting and scaling each picture by horizontal " \
+    "bands, for the filters that can (0 for one per CPU, up to 4; " \
+    "1 to convert on the video output thread only)." )
+
 #define DROP_LATE_FRAMES_TEXT N_("Drop late frames")
 #define DROP_LATE_FRAMES_LONGTEXT N_( \
     "This drops frames that are late (arrive to the video output after " \
@@ -687,6 +699,42 @@ static const char *const ppsz_pos_descriptions[] =
     "This defines the maximum input delay jitter that the synchronization " \
     "algorithms should try to compensate (in milliseconds)." )
 
+#define ADAPTIVE_CACHING_TEXT N_("Adaptive caching")
+#define ADAPTIVE_CACHING_LONGTEXT N_( \
+    "Adjust the caching of real-time sources to the measured arrival " \
+    "jitter of their clock references, so that steady network paths get " \
+    "a low latency and irregular ones do not break up." )
+
+#define ADAPTIVE_CACHING_MIN_TEXT N_("Adaptive caching minimum (ms)")
+#define ADAPTIVE_CACHING_MIN_LONGTEXT N_( \
+    "Smallest caching value used by adaptive caching, in milliseconds." )
+
+#define ADAPTIVE_CACHING_MAX_TEXT N_("Adaptive caching maximum (ms)")
+#define ADAPTIVE_CACHING_MAX_LONGTEXT N_( \
+    "Largest caching value used by adaptive caching, in milliseconds." )
+
+#define STREAM_PREFETCH_TEXT N_("Read ahead in the background")
+#define STREAM_PREFETCH_LONGTEXT N_( \
+    "Keep the input stream cache filled from a separate thread, so that " \
+    "demuxing does not wait for slow (network) file systems." )
+
+#define STREAM_CACHE_SIZE_TEXT N_("Stream cache size (kB)")
+#define STREAM_CACHE_SIZE_LONGTEXT N_( \
+    "Amount of memory used to cache the data read from the input, " \
+    "in kilobytes." )
+
+#define STREAM_CACHE_TRACKS_TEXT N_("Stream cache tracks")
+#define STREAM_CACHE_TRACKS_LONGTEXT N_( \
+    "Number of separate regions of seekable inputs kept in the stream " \
+    "cache, so that seeking back and forth between them does not read " \
+    "them again. The cache size is shared between the tracks." )
+
+#define STREAM_MMAP_TEXT N_("Memory map local files")
+#define STREAM_MMAP_LONGTEXT N_( \
+    "Read regular local files through a memory mapping rather than " \
+    "through the input stream cache, saving one copy of the data. " \
+    "Files must not be truncated while they are played." )
+
 #define NETSYNC_TEXT N_("Network synchronisation" )
 #define NETSYNC_LONGTEXT N_( "This allows you to remotely " \
         "synchronise clocks for server and client. The detailed settings " \
@@ -963,6 +1011,12 @@ static const char *const ppsz_prefres[] = {
     "However allocation of port numbers below 1025 is usually restricted " \
     "by the operating system." )
 
+#define HTTP_THREADS_TEXT N_( "HTTP server threads" )
+#define HTTP_THREADS_LONGTEXT N_( \
+    "Number of threads sharing the connections of each HTTP server. " \
+    "More threads help serving many clients at once. " \
+    "This is only supported on Linux." )
+
 #define HTTPS_PORT_TEXT N_( "HTTPS server port" )
 #define HTTPS_PORT_LONGTEXT N_( \
     "The HTTPS server will listen on this TCP port. " \
@@ -1058,6 +1112,13 @@ static const char *const ppsz_prefres[] = {
     "This allows you to select a list of encoders that VLC will use in " \
     "priority.")
 
+#define DECODER_POOL_TEXT N_("Shared decoder threads")
+#define DECODER_POOL_LONGTEXT N_( \
+    "Number of audio and subtitles decoders that can run at once on " \
+    "threads shared by all of them, instead of one thread per " \
+    "elementary stream. This helps when transcoding inputs with many " \
+    "tracks. 0 gives each decoder its own thread.")
+
 /*****************************************************************************
  * Sout
  ****************************************************************************/
@@ -1077,6 +1138,13 @@ static const char *const ppsz_prefres[] = {
 #define SOUT_ALL_LONGTEXT N_( \
     "Stream all elementary streams (video, audio and subtitles)")
 
+#define SOUT_DIRECT_TEXT N_("Stream from the input thread")
+#define SOUT_DIRECT_LONGTEXT N_( \
+    "Packetize and send the elementary streams to the stream output from " \
+    "the input thread, without a decoder thread per stream. This lowers " \
+    "the overhead of a plain remux, but a transcoding stream output would " \
+    "slow down the input.")
+
 #define SOUT_DISPLAY_TEXT N_("Display while streaming")
 #define SOUT_DISPLAY_LONGTEXT N_( \
     "Play locally the stream while streaming it.")
@@ -1156,6 +1224,13 @@ static const char *const ppsz_prefres[] = {
     "the correct access is not automatically detected. You should not "\
     "set this as a global option unless you really know what you are doing." )
 
+#define DEMUX_SEEK_INDEX_TEXT N_("Remember seek points")
+#define DEMUX_SEEK_INDEX_LONGTEXT N_( \
+    "Demuxers of formats without an index (MPEG-PS, MPEG-TS, elementary " \
+    "streams) record the file offsets of the times played, in the user " \
+    "cache directory, and use them for exact and fast seeking the next " \
+    "time the same file is played." )
+
 #define STREAM_FILTER_TEXT N_("Stream filter module")
 #define STREAM_FILTER_LONGTEXT N_( \
     "Stream filters are used to modify the stream that is being read. " )
@@ -1285,6 +1360,16 @@ static const char *const ppsz_prefres[] = {
     "Automatically preparse files added to the playlist " \
     "(to retrieve some metadata)." )
 
+#define PREPARSE_THREADS_TEXT N_( "Preparsing threads" )
+#define PREPARSE_THREADS_LONGTEXT N_( \
+    "Maximum number of items preparsed, or whose art is fetched, at the " \
+    "same time." )
+
+#define PREPARSE_TIMEOUT_TEXT N_( "Preparsing timeout (ms)" )
+#define PREPARSE_TIMEOUT_LONGTEXT N_( \
+    "Preparsing of an item is aborted after this time, in milliseconds " \
+    "(0 = no limit)." )
+
 #define ALBUM_ART_TEXT N_( "Album art policy" )
 #define ALBUM_ART_LONGTEXT N_( \
     "Choose how album art will be downloaded." )
@@ -1689,6 +1774,11 @@ vlc_module_begin ()
               SKIP_FRAMES_LONGTEXT, true )
     add_bool( "quiet-synchro", 0, QUIET_SYNCHRO_TEXT,
               QUIET_SYNCHRO_LONGTEXT, true )
+    add_bool( "video-keyframes-only", false, KEYFRAMES_ONLY_TEXT,
+              KEYFRAMES_ONLY_LONGTEXT, true )
+    add_integer( "chroma-threads", 0, CHROMA_THREADS_TEXT,
+                 CHROMA_THREADS_LONGTEXT, true )
+        change_integer_range( 0, 16 )
     add_bool( "keyboard-events", true, KEYBOARD_EVENTS_TEXT,
               KEYBOARD_EVENTS_LONGTEXT, true )
     add_bool( "mouse-events", true, MOUSE_EVENTS_TEXT,
@@ -1909,6 +1999,9 @@ vlc_module_begin ()
     add_string( "http-host", NULL, HTTP_HOST_TEXT, HOST_LONGTEXT, true )
     add_integer( "http-port", 8080, HTTP_PORT_TEXT, HTTP_PORT_LONGTEXT, true )
         change_integer_range( 1, 65535 )
+    add_integer( "http-threads", 1, HTTP_THREADS_TEXT,
+                 HTTP_THREADS_LONGTEXT, true )
+        change_integer_range( 1, 64 )
     add_integer( "https-port", 8443, HTTPS_PORT_TEXT, HTTPS_PORT_LONGTEXT, true )
         change_integer_range( 1, 65535 )
     add_string( "rtsp-host", NULL, RTSP_HOST_TEXT, RTSP_HOST_LONGTEXT, true )
@@ -2015,6 +2108,41 @@ vlc_module_begin ()
     add_integer( "clock-jitter", 5 * CLOCK_FREQ/1000, CLOCK_JITTER_TEXT,
               CLOCK_JITTER_LONGTEXT, true )
         change_safe()
+    add_bool( "adaptive-caching", false, ADAPTIVE_CACHING_TEXT,
+              ADAPTIVE_CACHING_LONGTEXT, true )
+        change_safe()
+    add_integer( "adaptive-caching-min", 50, ADAPTIVE_CACHING_MIN_TEXT,
+                 ADAPTIVE_CACHING_MIN_LONGTEXT, true )
+        change_integer_range( 0, 60000 )
+        change_safe()
+    add_integer( "adaptive-caching-max", 3000, ADAPTIVE_CACHING_MAX_TEXT,
+                 ADAPTIVE_CACHING_MAX_LONGTEXT, true )
+        change_integer_range( 0, 60000 )
+        change_safe()
+    add_bool( "stream-prefetch", false, STREAM_PREFETCH_TEXT,
+              STREAM_PREFETCH_LONGTEXT, true )
+        change_safe()
+#ifdef OPTIMIZE_MEMORY
+    add_integer( "stream-cache-size", 128, STREAM_CACHE_SIZE_TEXT,
+                 STREAM_CACHE_SIZE_LONGTEXT, true )
+#else
+    add_integer( "stream-cache-size", 12 * 1024, STREAM_CACHE_SIZE_TEXT,
+                 STREAM_CACHE_SIZE_LONGTEXT, true )
+#endif
+        change_integer_range( 16, 1024 * 1024 )
+        change_safe()
+#ifdef OPTIMIZE_MEMORY
+    add_integer( "stream-cache-tracks", 1, STREAM_CACHE_TRACKS_TEXT,
+                 STREAM_CACHE_TRACKS_LONGTEXT, true )
+#else
+    add_integer( "stream-cache-tracks", 3, STREAM_CACHE_TRACKS_TEXT,
+                 STREAM_CACHE_TRACKS_LONGTEXT, true )
+#endif
+        change_integer_range( 1, 16 )
+        change_safe()
+    add_bool( "stream-mmap", false, STREAM_MMAP_TEXT,
+              STREAM_MMAP_LONGTEXT, true )
+        change_safe()
 
     add_bool( "network-synchronisation", false, NETSYNC_TEXT,
               NETSYNC_LONGTEXT, true )
@@ -2037,6 +2165,9 @@ vlc_module_begin ()
                 CODEC_LONGTEXT, true )
     add_string( "encoder",  NULL, ENCODER_TEXT,
                 ENCODER_LONGTEXT, true )
+    add_integer( "decoder-pool", 0, DECODER_POOL_TEXT,
+                 DECODER_POOL_LONGTEXT, true )
+        change_integer_range( 0, 64 )
 
     set_subcategory( SUBCAT_INPUT_ACCESS )
     add_category_hint( N_("Input"), INPUT_CAT_LONGTEXT , false )
@@ -2044,6 +2175,9 @@ vlc_module_begin ()
 
     set_subcategory( SUBCAT_INPUT_DEMUX )
     add_module( "demux", "demux", NULL, DEMUX_TEXT, DEMUX_LONGTEXT, true )
+    add_bool( "demux-seek-index", false, DEMUX_SEEK_INDEX_TEXT,
+              DEMUX_SEEK_INDEX_LONGTEXT, true )
+        change_safe()
     set_subcategory( SUBCAT_INPUT_VCODEC )
     set_subcategory( SUBCAT_INPUT_ACODEC )
     set_subcategory( SUBCAT_INPUT_SCODEC )
@@ -2066,6 +2200,8 @@ vlc_module_begin ()
                                 SOUT_KEEP_LONGTEXT, true )
     add_bool( "sout-all", 0, SOUT_ALL_TEXT,
                                 SOUT_ALL_LONGTEXT, true )
+    add_bool( "sout-direct", false, SOUT_DIRECT_TEXT,
+                                SOUT_DIRECT_LONGTEXT, true )
     add_bool( "sout-audio", 1, SOUT_AUDIO_TEXT,
                                 SOUT_AUDIO_LONGTEXT, true )
     add_bool( "sout-video", 1, SOUT_VIDEO_TEXT,
@@ -2202,6 +2338,12 @@ vlc_module_begin ()
 
     add_bool( "auto-preparse", true, PREPARSE_TEXT,
               PREPARSE_LONGTEXT, false )
+    add_integer( "preparse-threads", 2, PREPARSE_THREADS_TEXT,
+                 PREPARSE_THREADS_LONGTEXT, true )
+        change_integer_range( 1, 32 )
+    add_integer( "preparse-timeout", 5000, PREPARSE_TIMEOUT_TEXT,
+                 PREPARSE_TIMEOUT_LONGTEXT, true )
+        change_integer_range( 0, 3600000 )
 
     add_integer( "album-art", ALBUM_ART_WHEN_ASKED, ALBUM_ART_TEXT,
                  ALBUM_ART_LONGTEXT, false )
@@ -779,6 +779,7 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
     playlist_Destroy( p_playlist );
     stats_TimersDumpAll( p_libvlc );
     stats_TimersCleanAll( p_libvlc );
+    block_CacheDump( VLC_OBJECT(p_libvlc) );
 
     msg_Dbg( p_libvlc, "removing stats" );
 
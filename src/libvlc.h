@@ -46,6 +46,11 @@ void system_End       ( void );
 void vlc_CPU_init(void);
 void vlc_CPU_dump(vlc_object_t *);
 
+/*
+ * Blocks
+ */
+void block_CacheDump( vlc_object_t * );
+
 /*
  * Threads subsystem
  */
@@ -37,6 +37,8 @@
 #endif
 
 #include "vlc_block.h"
+#include <vlc_atomic.h>
+#include "../libvlc.h"
 
 /**
  * @section Block handling functions.
@@ -49,6 +51,7 @@ struct block_sys_t
 {
     block_t     self;
     size_t      i_allocated_buffer;
+    unsigned    i_class; /* 1 + block cache class, 0 if not cacheable */
     uint8_t     p_allocated_buffer[];
 };
 
@@ -76,9 +79,16 @@ void block_Init( block_t *restrict b, void *buf, size_t size )
 #endif
 }
 
+static void BlockCachePut( block_sys_t * );
+
 static void BlockRelease( block_t *p_block )
 {
-    free( p_block );
+    block_sys_t *p_sys = (block_sys_t *)p_block;
+
+    if( p_sys->i_class )
+        BlockCachePut( p_sys );
+    else
+        free( p_sys );
 }
 
 static void BlockMetaCopy( block_t *restrict out, const block_t *in )
@@ -98,6 +108,205 @@ static void BlockMetaCopy( block_t *restrict out, const block_t *in )
 /* Maximum size of reserved footer before we release with realloc() */
 #define BLOCK_WASTE_SIZE   2048
 
+/*
+ * Per-thread block cache.
+ *
+ * Blocks whose payload size falls into one of the size classes below are
+ * allocated with the full class size. When released, they are kept in a
+ * small per-thread free list and handed out again by the next block_Alloc()
+ * of the same class on that thread, without going through the C allocator.
+ * Setting the VLC_BLOCK_CACHE environment variable to 0 disables the cache
+ * (e.g. when looking for memory errors with valgrind).
+ */
+#if !defined(WIN32) && !defined(__OS2__)
+# define BLOCK_CACHE 1
+#endif
+
+/* Payload sizes of the cache classes: TS packet, 7 TS packets (UDP/RTP),
+ * page and large chunks. A class serves the sizes above half of it. */
+static const size_t block_cache_sizes[] = { 188, 1316, 4096, 65536 };
+#define BLOCK_CACHE_CLASSES \
+    (sizeof (block_cache_sizes) / sizeof (block_cache_sizes[0]))
+/* Maximum number of bytes kept per class and per thread */
+#define BLOCK_CACHE_BYTES  (256 << 10)
+#define BLOCK_CACHE_DEPTH  256
+
+typedef struct
+{
+    uint64_t hits; /**< allocations served from the cache */
+    uint64_t misses; /**< allocations served by malloc() */
+    uint64_t recycled; /**< releases kept in the cache */
+    uint64_t freed; /**< releases passed to free() (cache full) */
+} block_cache_stats_t;
+
+#ifdef BLOCK_CACHE
+typedef struct
+{
+    block_sys_t *p_free[BLOCK_CACHE_CLASSES];
+    unsigned     i_free[BLOCK_CACHE_CLASSES];
+    block_cache_stats_t stats[BLOCK_CACHE_CLASSES];
+} block_cache_t;
+
+static vlc_threadvar_t block_cache_key;
+static bool block_cache_enabled;
+/* Statistics of the threads that have exited */
+static vlc_mutex_t block_cache_lock = VLC_STATIC_MUTEX;
+static block_cache_stats_t block_cache_totals[BLOCK_CACHE_CLASSES];
+
+static void BlockCacheMerge( block_cache_stats_t *restrict dst,
+                             const block_cache_stats_t *restrict src )
+{
+    dst->hits += src->hits;
+    dst->misses += src->misses;
+    dst->recycled += src->recycled;
+    dst->freed += src->freed;
+}
+
+static void BlockCacheDestroy( void *data )
+{
+    block_cache_t *p_cache = data;
+
+    vlc_mutex_lock( &block_cache_lock );
+    for( unsigned i = 0; i < BLOCK_CACHE_CLASSES; i++ )
+    {
+        BlockCacheMerge( &block_cache_totals[i], &p_cache->stats[i] );
+        for( block_sys_t *p = p_cache->p_free[i], *next; p != NULL; p = next )
+        {
+            next = (block_sys_t *)p->self.p_next;
+            free( p );
+        }
+    }
+    vlc_mutex_unlock( &block_cache_lock );
+    free( p_cache );
+}
+
+static void BlockCacheInit( void )
+{
+    const char *psz_env = getenv( "VLC_BLOCK_CACHE" );
+
+    block_cache_enabled = ( psz_env == NULL || atoi( psz_env ) != 0 )
+                     && !vlc_threadvar_create( &block_cache_key,
+                                               BlockCacheDestroy );
+}
+
+/**
+ * Returns the block cache of the calling thread, creating it if needed,
+ * or NULL if the cache is disabled.
+ */
+static block_cache_t *BlockCacheGet( void )
+{
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once( &once, BlockCacheInit );
+
+    if( !block_cache_enabled )
+        return NULL;
+
+    block_cache_t *p_cache = vlc_threadvar_get( block_cache_key );
+    if( unlikely(p_cache == NULL) )
+    {
+        p_cache = calloc( 1, sizeof( *p_cache ) );
+        if( p_cache != NULL && vlc_threadvar_set( block_cache_key, p_cache ) )
+        {
+            free( p_cache );
+            p_cache = NULL;
+        }
+    }
+    return p_cache;
+}
+
+static void BlockCachePut( block_sys_t *p_sys )
+{
+    block_cache_t *p_cache = BlockCacheGet();
+    const unsigned i = p_sys->i_class - 1;
+    const unsigned i_max = __MIN( BLOCK_CACHE_DEPTH,
+                                  BLOCK_CACHE_BYTES / block_cache_sizes[i] );
+
+    if( p_cache == NULL )
+    {
+        free( p_sys );
+        return;
+    }
+
+    if( p_cache->i_free[i] >= __MAX( i_max, 1 ) )
+    {
+        p_cache->stats[i].freed++;
+        free( p_sys );
+        return;
+    }
+    p_sys->self.p_next = &p_cache->p_free[i]->self;
+    p_cache->p_free[i] = p_sys;
+    p_cache->i_free[i]++;
+    p_cache->stats[i].recycled++;
+}
+
+/**
+ * Takes a block of the given class from the cache of the calling thread.
+ */
+static block_sys_t *BlockCacheTake( unsigned i )
+{
+    block_cache_t *p_cache = BlockCacheGet();
+    if( p_cache == NULL )
+        return NULL;
+
+    block_sys_t *p_sys = p_cache->p_free[i];
+    if( p_sys == NULL )
+    {
+        p_cache->stats[i].misses++;
+        return NULL;
+    }
+    p_cache->p_free[i] = (block_sys_t *)p_sys->self.p_next;
+    p_cache->i_free[i]--;
+    p_cache->stats[i].hits++;
+    return p_sys;
+}
+
+void block_CacheDump( vlc_object_t *obj )
+{
+    block_cache_stats_t stats[BLOCK_CACHE_CLASSES];
+    block_cache_t *p_cache = BlockCacheGet();
+
+    if( p_cache == NULL )
+        return;
+
+    vlc_mutex_lock( &block_cache_lock );
+    memcpy( stats, block_cache_totals, sizeof( stats ) );
+    vlc_mutex_unlock( &block_cache_lock );
+
+    for( unsigned i = 0; i < BLOCK_CACHE_CLASSES; i++ )
+    {
+        BlockCacheMerge( &stats[i], &p_cache->stats[i] );
+        msg_Dbg( obj, "block cache class %zu bytes: %"PRIu64" hits, "
+                 "%"PRIu64" misses, %"PRIu64" recycled, %"PRIu64" freed",
+                 block_cache_sizes[i], stats[i].hits, stats[i].misses,
+                 stats[i].recycled, stats[i].freed );
+    }
+}
+#else
+static void BlockCachePut( block_sys_t *p_sys )
+{
+    free( p_sys );
+}
+
+# define BlockCacheTake( i ) NULL
+
+void block_CacheDump( vlc_object_t *obj )
+{
+    (void) obj;
+}
+#endif
+
+/**
+ * Finds the cache class of a payload size.
+ * @return 1 + class index, or 0 if the size is not cacheable
+ */
+static unsigned BlockCacheClass( size_t i_size )
+{
+    for( unsigned i = 0; i < BLOCK_CACHE_CLASSES; i++ )
+        if( i_size <= block_cache_sizes[i] )
+            return ( 2 * i_size > block_cache_sizes[i] ) ? (i + 1) : 0;
+    return 0;
+}
+
 block_t *block_Alloc( size_t i_size )
 {
     /* We do only one malloc
@@ -107,11 +316,27 @@ block_t *block_Alloc( size_t i_size )
     block_sys_t *p_sys;
     uint8_t *buf;
 #define ALIGN(x) (((x) + BLOCK_ALIGN - 1) & ~(BLOCK_ALIGN - 1))
+    const unsigned i_class = BlockCacheClass( i_size );
+    if( i_class )
+    {
+        p_sys = BlockCacheTake( i_class - 1 );
+        if( p_sys != NULL )
+        {
+            buf = (void *)ALIGN((uintptr_t)p_sys->p_allocated_buffer);
+            buf += BLOCK_PADDING;
+            block_Init( &p_sys->self, buf, i_size );
+            p_sys->self.pf_release = BlockRelease;
+            return &p_sys->self;
+        }
+    }
+
+    /* Cacheable blocks are allocated with the whole class size */
+    const size_t i_body = i_class ? block_cache_sizes[i_class - 1] : i_size;
 #if 0 /*def HAVE_POSIX_MEMALIGN */
     /* posix_memalign(,16,) is much slower than malloc() on glibc.
      * -- Courmisch, September 2009, glibc 2.5 & 2.9 */
     const size_t i_alloc = ALIGN(sizeof(*p_sys)) + (2 * BLOCK_PADDING)
-                         + ALIGN(i_size);
+                         + ALIGN(i_body);
     if( unlikely(i_alloc <= i_size) )
         return NULL;
     void *ptr;
@@ -124,7 +349,7 @@ block_t *block_Alloc( size_t i_size )
 
 #else
     const size_t i_alloc = sizeof(*p_sys) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
-                         + ALIGN(i_size);
+                         + ALIGN(i_body);
     if( unlikely(i_alloc <= i_size) )
         return NULL;
 
@@ -141,6 +366,7 @@ block_t *block_Alloc( size_t i_size )
     p_sys->self.pf_release    = BlockRelease;
     /* Fill opaque data */
     p_sys->i_allocated_buffer = i_alloc - sizeof(*p_sys);
+    p_sys->i_class = i_class;
 
     return &p_sys->self;
 }
@@ -234,9 +460,11 @@ block_t *block_Realloc( block_t *p_block, ssize_t i_prebody, size_t i_body )
         p_block = p_rea;
     }
     else
-    /* We have a very large reserved footer now? Release some of it.
+    /* We have a very large reserved footer now? Release some of it,
+     * unless the block still belongs to its cache class.
      * XXX it might not preserve the alignment of p_buffer */
-    if( p_end - (p_block->p_buffer + i_body) > BLOCK_WASTE_SIZE )
+    if( p_end - (p_block->p_buffer + i_body) > BLOCK_WASTE_SIZE
+     && ( p_sys->i_class == 0 || BlockCacheClass( requested ) != p_sys->i_class ) )
     {
         block_t *p_rea = block_Alloc( requested );
         if( p_rea )
@@ -506,8 +734,24 @@ struct block_fifo_t
     size_t              i_depth;
     size_t              i_size;
     bool          b_force_wake;
+
+    /* Single producer, single consumer queues only.
+     * Blocks go through a lock-free ring. If the ring is full, they are
+     * queued in the locked p_first list instead (the overflow list) until
+     * the consumer has caught up. */
+    block_t           **pp_ring;
+    vlc_atomic_t        read_index; /**< Only written by the consumer */
+    vlc_atomic_t        write_index; /**< Only written by the producer */
+    vlc_atomic_t        overflow; /**< Overflow list is not empty */
+    vlc_atomic_t        depth;
+    vlc_atomic_t        size;
+    vlc_atomic_t        waiting; /**< Consumer waits for data */
+    vlc_atomic_t        waiting_room; /**< Producer waits in FifoPace */
+    block_t            *p_pending; /**< Consumer-owned head of the queue */
 };
 
+#define SPSC_RING_SIZE 1024 /* must be a power of two */
+
 block_fifo_t *block_FifoNew( void )
 {
     block_fifo_t *p_fifo = malloc( sizeof( block_fifo_t ) );
@@ -521,16 +765,173 @@ block_fifo_t *block_FifoNew( void )
     p_fifo->pp_last = &p_fifo->p_first;
     p_fifo->i_depth = p_fifo->i_size = 0;
     p_fifo->b_force_wake = false;
+    p_fifo->pp_ring = NULL;
+
+    return p_fifo;
+}
+
+/**
+ * Creates a FIFO that is fed by a single thread and drained by a single
+ * (other) thread. Blocks are passed through a lock-free ring; the lock is
+ * only taken to wake up a sleeping thread or if the ring overflows.
+ *
+ * The returned FIFO is used with the usual block_Fifo*() functions, but
+ * block_FifoPut() and block_FifoPace() must only be called from the producer
+ * thread, while block_FifoGet(), block_FifoShow() and block_FifoEmpty() must
+ * only be called from the consumer thread. block_FifoWake(),
+ * block_FifoCount() and block_FifoSize() can be called from any thread.
+ */
+block_fifo_t *block_FifoNewSPSC( void )
+{
+    block_fifo_t *p_fifo = block_FifoNew();
+    if( !p_fifo )
+        return NULL;
 
+    p_fifo->pp_ring = malloc( SPSC_RING_SIZE * sizeof( *p_fifo->pp_ring ) );
+    if( !p_fifo->pp_ring )
+    {
+        block_FifoRelease( p_fifo );
+        return NULL;
+    }
+    vlc_atomic_set( &p_fifo->read_index, 0 );
+    vlc_atomic_set( &p_fifo->write_index, 0 );
+    vlc_atomic_set( &p_fifo->overflow, 0 );
+    vlc_atomic_set( &p_fifo->depth, 0 );
+    vlc_atomic_set( &p_fifo->size, 0 );
+    vlc_atomic_set( &p_fifo->waiting, 0 );
+    vlc_atomic_set( &p_fifo->waiting_room, 0 );
+    p_fifo->p_pending = NULL;
     return p_fifo;
 }
 
+/**
+ * Makes sure p_pending points to the first queued block, if any.
+ * Consumer side of SPSC queues only.
+ * @param locked whether the caller holds the FIFO lock
+ */
+static block_t *SpscFront( block_fifo_t *p_fifo, bool locked )
+{
+    if( p_fifo->p_pending != NULL )
+        return p_fifo->p_pending;
+
+    uintptr_t r = vlc_atomic_get( &p_fifo->read_index );
+    if( r != vlc_atomic_get( &p_fifo->write_index ) )
+    {
+        p_fifo->p_pending = p_fifo->pp_ring[r & (SPSC_RING_SIZE - 1)];
+        vlc_atomic_set( &p_fifo->read_index, r + 1 );
+    }
+    else if( vlc_atomic_get( &p_fifo->overflow ) )
+    {
+        /* The ring is drained and the producer keeps feeding the overflow
+         * list until it is empty, so the whole list comes next. */
+        if( !locked )
+            vlc_mutex_lock( &p_fifo->lock );
+        p_fifo->p_pending = p_fifo->p_first;
+        p_fifo->p_first = NULL;
+        p_fifo->pp_last = &p_fifo->p_first;
+        vlc_atomic_set( &p_fifo->overflow, 0 );
+        if( !locked )
+            vlc_mutex_unlock( &p_fifo->lock );
+    }
+    return p_fifo->p_pending;
+}
+
+/**
+ * Dequeues the first block of a SPSC queue, if any.
+ * @param locked whether the caller holds the FIFO lock
+ */
+static block_t *SpscPop( block_fifo_t *p_fifo, bool locked )
+{
+    block_t *b = SpscFront( p_fifo, locked );
+    if( b == NULL )
+        return NULL;
+
+    p_fifo->p_pending = b->p_next;
+    b->p_next = NULL;
+    vlc_atomic_sub( &p_fifo->size, b->i_buffer );
+    vlc_atomic_dec( &p_fifo->depth );
+
+    if( vlc_atomic_get( &p_fifo->waiting_room ) )
+    {
+        if( !locked )
+            vlc_mutex_lock( &p_fifo->lock );
+        vlc_cond_broadcast( &p_fifo->wait_room );
+        if( !locked )
+            vlc_mutex_unlock( &p_fifo->lock );
+    }
+    return b;
+}
+
+static void SpscPut( block_fifo_t *p_fifo, block_t *p_block,
+                     size_t i_depth, size_t i_size )
+{
+    bool overflow = false;
+
+    /* Account first, so that the counters never go below zero */
+    vlc_atomic_add( &p_fifo->size, i_size );
+    vlc_atomic_add( &p_fifo->depth, i_depth );
+
+    while( p_block != NULL )
+    {
+        block_t *p_next = p_block->p_next;
+        uintptr_t w = vlc_atomic_get( &p_fifo->write_index );
+
+        p_block->p_next = NULL;
+        if( !vlc_atomic_get( &p_fifo->overflow )
+         && w - vlc_atomic_get( &p_fifo->read_index ) < SPSC_RING_SIZE )
+        {
+            p_fifo->pp_ring[w & (SPSC_RING_SIZE - 1)] = p_block;
+            vlc_atomic_set( &p_fifo->write_index, w + 1 );
+        }
+        else
+        {
+            vlc_mutex_lock( &p_fifo->lock );
+            *p_fifo->pp_last = p_block;
+            p_fifo->pp_last = &p_block->p_next;
+            vlc_atomic_set( &p_fifo->overflow, 1 );
+            vlc_mutex_unlock( &p_fifo->lock );
+            overflow = true;
+        }
+        p_block = p_next;
+    }
+
+    /* Only wake the consumer up if it is actually sleeping */
+    if( overflow || vlc_atomic_get( &p_fifo->waiting ) )
+    {
+        vlc_mutex_lock( &p_fifo->lock );
+        vlc_cond_signal( &p_fifo->wait );
+        vlc_mutex_unlock( &p_fifo->lock );
+    }
+}
+
+/**
+ * Waits for the first block of a SPSC queue.
+ * @return the first block (still queued), or NULL if woken up
+ */
+static block_t *SpscWait( block_fifo_t *p_fifo )
+{
+    block_t *b = SpscFront( p_fifo, false );
+    if( b != NULL )
+        return b;
+
+    vlc_mutex_lock( &p_fifo->lock );
+    mutex_cleanup_push( &p_fifo->lock );
+    vlc_atomic_set( &p_fifo->waiting, 1 );
+    while( ( b = SpscFront( p_fifo, true ) ) == NULL && !p_fifo->b_force_wake )
+        vlc_cond_wait( &p_fifo->wait, &p_fifo->lock );
+    vlc_atomic_set( &p_fifo->waiting, 0 );
+    p_fifo->b_force_wake = false;
+    vlc_cleanup_run();
+    return b;
+}
+
 void block_FifoRelease( block_fifo_t *p_fifo )
 {
     block_FifoEmpty( p_fifo );
     vlc_cond_destroy( &p_fifo->wait_room );
     vlc_cond_destroy( &p_fifo->wait );
     vlc_mutex_destroy( &p_fifo->lock );
+    free( p_fifo->pp_ring );
     free( p_fifo );
 }
 
@@ -538,6 +939,13 @@ void block_FifoEmpty( block_fifo_t *p_fifo )
 {
     block_t *block;
 
+    if( p_fifo->pp_ring != NULL )
+    {
+        while( ( block = SpscPop( p_fifo, false ) ) != NULL )
+            block_Release( block );
+        return;
+    }
+
     vlc_mutex_lock( &p_fifo->lock );
     block = p_fifo->p_first;
     if (block != NULL)
@@ -580,6 +988,19 @@ void block_FifoPace (block_fifo_t *fifo, size_t max_depth, size_t max_size)
 {
     vlc_testcancel ();
 
+    if (fifo->pp_ring != NULL)
+    {
+        vlc_mutex_lock (&fifo->lock);
+        mutex_cleanup_push (&fifo->lock);
+        vlc_atomic_set (&fifo->waiting_room, 1);
+        while (vlc_atomic_get (&fifo->depth) > max_depth
+            || vlc_atomic_get (&fifo->size) > max_size)
+            vlc_cond_wait (&fifo->wait_room, &fifo->lock);
+        vlc_atomic_set (&fifo->waiting_room, 0);
+        vlc_cleanup_run ();
+        return;
+    }
+
     vlc_mutex_lock (&fifo->lock);
     while ((fifo->i_depth > max_depth) || (fifo->i_size > max_size))
     {
@@ -611,6 +1032,12 @@ size_t block_FifoPut( block_fifo_t *p_fifo, block_t *p_block )
             break;
     }
 
+    if( p_fifo->pp_ring != NULL )
+    {
+        SpscPut( p_fifo, p_block, i_depth, i_size );
+        return i_size;
+    }
+
     vlc_mutex_lock (&p_fifo->lock);
     *p_fifo->pp_last = p_block;
     p_fifo->pp_last = &p_last->p_next;
@@ -626,7 +1053,8 @@ size_t block_FifoPut( block_fifo_t *p_fifo, block_t *p_block )
 void block_FifoWake( block_fifo_t *p_fifo )
 {
     vlc_mutex_lock( &p_fifo->lock );
-    if( p_fifo->p_first == NULL )
+    if( p_fifo->pp_ring != NULL ? vlc_atomic_get( &p_fifo->depth ) == 0
+                                : p_fifo->p_first == NULL )
         p_fifo->b_force_wake = true;
     vlc_cond_broadcast( &p_fifo->wait );
     vlc_mutex_unlock( &p_fifo->lock );
@@ -644,6 +1072,13 @@ block_t *block_FifoGet( block_fifo_t *p_fifo )
 
     vlc_testcancel( );
 
+    if( p_fifo->pp_ring != NULL )
+    {
+        if( SpscWait( p_fifo ) == NULL )
+            return NULL;
+        return SpscPop( p_fifo, false );
+    }
+
     vlc_mutex_lock( &p_fifo->lock );
     mutex_cleanup_push( &p_fifo->lock );
 
@@ -697,6 +1132,12 @@ block_t *block_FifoShow( block_fifo_t *p_fifo )
 
     vlc_testcancel( );
 
+    if( p_fifo->pp_ring != NULL )
+    {
+        while( ( b = SpscWait( p_fifo ) ) == NULL );
+        return b;
+    }
+
     vlc_mutex_lock( &p_fifo->lock );
     mutex_cleanup_push( &p_fifo->lock );
 
@@ -712,11 +1153,15 @@ block_t *block_FifoShow( block_fifo_t *p_fifo )
 /* FIXME: not thread-safe */
 size_t block_FifoSize( const block_fifo_t *p_fifo )
 {
+    if( p_fifo->pp_ring != NULL )
+        return vlc_atomic_get( &p_fifo->size );
     return p_fifo->i_size;
 }
 
 /* FIXME: not thread-safe */
 size_t block_FifoCount( const block_fifo_t *p_fifo )
 {
+    if( p_fifo->pp_ring != NULL )
+        return vlc_atomic_get( &p_fifo->depth );
     return p_fifo->i_depth;
 }
@@ -163,15 +163,19 @@ void vlc_CPU_init (void)
                    "cpuid\n\t" \
                    "xchgl %%ebx,%1\n\t" \
                    : "=a" (i_eax), "=r" (i_ebx), "=c" (i_ecx), "=d" (i_edx) \
-                   : "a" (reg) \
+                   : "a" (reg), "c" (0) \
                    : "cc");
 # else
 #  define cpuid(reg) \
      asm volatile ("cpuid\n\t" \
                    : "=a" (i_eax), "=b" (i_ebx), "=c" (i_ecx), "=d" (i_edx) \
-                   : "a" (reg) \
+                   : "a" (reg), "c" (0) \
                    : "cc");
 # endif
+    /* Reads XCR0, the register states enabled by the OS (xgetbv) */
+# define xgetbv(lo) \
+     asm volatile (".byte 0x0f, 0x01, 0xd0\n\t" \
+                   : "=a" (lo), "=d" (i_edx) : "c" (0))
      /* Check if the OS really supports the requested instructions */
 # if defined (__i386__) && !defined (__i486__) && !defined (__i586__) \
   && !defined (__i686__) && !defined (__pentium4__) \
@@ -199,6 +203,7 @@ void vlc_CPU_init (void)
 
     /* the CPU supports the CPUID instruction - get its level */
     cpuid( 0x00000000 );
+    const unsigned i_max = i_eax;
 
 # if defined (__i386__) && !defined (__i586__) \
   && !defined (__i686__) && !defined (__pentium4__) \
@@ -268,6 +273,28 @@ void vlc_CPU_init (void)
         i_capabilities |= CPU_CAPABILITY_SSE4_2;
 # endif
 
+    /* The OS must save the YMM (and ZMM) registers for the AVX instructions
+     * to be usable: there is no need to try them out */
+    unsigned i_xcr0 = 0;
+    if( i_ecx & 0x08000000 ) /* OSXSAVE */
+        xgetbv( i_xcr0 );
+
+    if( ( i_xcr0 & 0x06 ) == 0x06 && ( i_ecx & 0x10000000 ) )
+    {
+        i_capabilities |= CPU_CAPABILITY_AVX;
+        if( i_ecx & 0x00001000 )
+            i_capabilities |= CPU_CAPABILITY_FMA3;
+
+        if( i_max >= 7 )
+        {
+            cpuid( 0x00000007 );
+            if( i_ebx & 0x00000020 )
+                i_capabilities |= CPU_CAPABILITY_AVX2;
+            if( ( i_xcr0 & 0xe6 ) == 0xe6 && ( i_ebx & 0x00010000 ) )
+                i_capabilities |= CPU_CAPABILITY_AVX512F;
+        }
+    }
+
     /* test for additional capabilities */
     cpuid( 0x80000000 );
 
@@ -390,6 +417,10 @@ void vlc_CPU_dump (vlc_object_t *obj)
     PRINT_CAPABILITY(CPU_CAPABILITY_SSE4_1, "SSE4.1");
     PRINT_CAPABILITY(CPU_CAPABILITY_SSE4_2, "SSE4.2");
     PRINT_CAPABILITY(CPU_CAPABILITY_SSE4A,  "SSE4A");
+    PRINT_CAPABILITY(CPU_CAPABILITY_AVX, "AVX");
+    PRINT_CAPABILITY(CPU_CAPABILITY_AVX2, "AVX2");
+    PRINT_CAPABILITY(CPU_CAPABILITY_FMA3, "FMA3");
+    PRINT_CAPABILITY(CPU_CAPABILITY_AVX512F, "AVX-512F");
 
 #elif defined (__powerpc__) || defined (__ppc__) || defined (__ppc64__)
     PRINT_CAPABILITY(CPU_CAPABILITY_ALTIVEC, "AltiVec");
@@ -47,6 +47,7 @@ typedef struct chained_filter_t
     struct chained_filter_t *prev, *next;
     vlc_mouse_t *mouse;
     picture_t *pending;
+    picture_t *inplace; /* input picture to give as the output buffer */
 } chained_filter_t;
 
 /* Only use this with filter objects from _this_ C module */
@@ -224,12 +225,28 @@ const es_format_t *filter_chain_GetFmtOut( filter_chain_t *p_chain )
     return &p_chain->fmt_out;
 }
 
+/* The input picture can be overwritten by the filter when nothing else
+ * refers to it, and it is laid out as the internal allocator would do */
+static bool CanFilterInPlace( chained_filter_t *f, const picture_t *p_pic )
+{
+    const video_format_t *p_fmt = &f->filter.fmt_out.video;
+
+    return f->filter.b_video_inplace && IsInternalVideoAllocator( f ) &&
+           p_pic->pf_release != NULL && p_pic->i_refcount == 1 &&
+           p_pic->format.i_chroma == p_fmt->i_chroma &&
+           p_pic->format.i_width == p_fmt->i_width &&
+           p_pic->format.i_height == p_fmt->i_height;
+}
+
 static picture_t *FilterChainVideoFilter( chained_filter_t *f, picture_t *p_pic )
 {
     for( ; f != NULL; f = f->next )
     {
         filter_t *p_filter = &f->filter;
+        if( CanFilterInPlace( f, p_pic ) )
+            f->inplace = p_pic;
         p_pic = p_filter->pf_video_filter( p_filter, p_pic );
+        f->inplace = NULL;
         if( !p_pic )
             break;
         if( f->pending )
@@ -428,6 +445,7 @@ static filter_t *filter_chain_AppendFilterInternal( filter_chain_t *p_chain,
         vlc_mouse_Init( p_mouse );
     p_chained->mouse = p_mouse;
     p_chained->pending = NULL;
+    p_chained->inplace = NULL;
 
     msg_Dbg( p_chain->p_this, "Filter '%s' (%p) appended to chain",
              psz_name ? psz_name : module_get_name(p_filter->p_module, false),
@@ -592,8 +610,17 @@ static int UpdateBufferFunctions( filter_chain_t *p_chain )
 /* Internal video allocator functions */
 static picture_t *VideoBufferNew( filter_t *p_filter )
 {
+    chained_filter_t *p_chained = chained( p_filter );
     const video_format_t *p_fmt = &p_filter->fmt_out.video;
 
+    if( p_chained->inplace != NULL )
+    {
+        /* Only once per input picture */
+        picture_t *p_picture = picture_Hold( p_chained->inplace );
+        p_chained->inplace = NULL;
+        return p_picture;
+    }
+
     picture_t *p_picture = picture_NewFromFormat( p_fmt );
     if( !p_picture )
         msg_Err( p_filter, "Failed to allocate picture" );
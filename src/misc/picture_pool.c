@@ -48,6 +48,10 @@ struct picture_release_sys_t {
 
     /* */
     int64_t tick;
+
+    /* Pool the picture is currently given by, and its index there */
+    picture_pool_t *pool;
+    int            index;
 };
 
 struct picture_pool_t {
@@ -58,6 +62,14 @@ struct picture_pool_t {
     int            picture_count;
     picture_t      **picture;
     bool           *picture_reserved;
+
+    /* Indexes of the pictures not in use, the last released on top */
+    int            *free;
+    int            free_count;
+    int            available; /* pictures not reserved by another pool */
+
+    /* */
+    picture_pool_stats_t stats;
 };
 
 static void Release(picture_t *);
@@ -75,15 +87,42 @@ static picture_pool_t *Create(picture_pool_t *master, int picture_count)
     pool->picture_count = picture_count;
     pool->picture = calloc(pool->picture_count, sizeof(*pool->picture));
     pool->picture_reserved = calloc(pool->picture_count, sizeof(*pool->picture_reserved));
-    if (!pool->picture || !pool->picture_reserved) {
+    pool->free = calloc(pool->picture_count, sizeof(*pool->free));
+    if (!pool->picture || !pool->picture_reserved || !pool->free) {
         free(pool->picture);
         free(pool->picture_reserved);
+        free(pool->free);
         free(pool);
         return NULL;
     }
+    pool->free_count = 0;
     return pool;
 }
 
+static void PushFree(picture_pool_t *pool, int index)
+{
+    assert(pool->free_count < pool->picture_count);
+    pool->free[pool->free_count++] = index;
+}
+
+/* Gives the pictures of the pool back to it, and to its master pool */
+static void Rebind(picture_pool_t *pool)
+{
+    pool->free_count = 0;
+    pool->available  = 0;
+    for (int i = 0; i < pool->picture_count; i++) {
+        if (pool->picture_reserved[i])
+            continue;
+        pool->available++;
+
+        picture_release_sys_t *release_sys = pool->picture[i]->p_release_sys;
+        release_sys->pool  = pool;
+        release_sys->index = i;
+        if (pool->picture[i]->i_refcount == 0)
+            PushFree(pool, i);
+    }
+}
+
 picture_pool_t *picture_pool_NewExtended(const picture_pool_configuration_t *cfg)
 {
     picture_pool_t *pool = Create(NULL, cfg->picture_count);
@@ -105,6 +144,8 @@ picture_pool_t *picture_pool_NewExtended(const picture_pool_configuration_t *cfg
         release_sys->lock        = cfg->lock;
         release_sys->unlock      = cfg->unlock;
         release_sys->tick        = 0;
+        release_sys->pool        = pool;
+        release_sys->index       = i;
 
         /* */
         picture->i_refcount    = 0;
@@ -114,7 +155,9 @@ picture_pool_t *picture_pool_NewExtended(const picture_pool_configuration_t *cfg
         /* */
         pool->picture[i] = picture;
         pool->picture_reserved[i] = false;
+        PushFree(pool, i);
     }
+    pool->available = cfg->picture_count;
     return pool;
 
 }
@@ -176,6 +219,8 @@ picture_pool_t *picture_pool_Reserve(picture_pool_t *master, int count)
         picture_pool_Delete(pool);
         return NULL;
     }
+    Rebind(master);
+    Rebind(pool);
     return pool;
 }
 
@@ -204,6 +249,9 @@ void picture_pool_Delete(picture_pool_t *pool)
             free(release_sys);
         }
     }
+    if (pool->master)
+        Rebind(pool->master);
+    free(pool->free);
     free(pool->picture_reserved);
     free(pool->picture);
     free(pool);
@@ -211,23 +259,27 @@ void picture_pool_Delete(picture_pool_t *pool)
 
 picture_t *picture_pool_Get(picture_pool_t *pool)
 {
-    for (int i = 0; i < pool->picture_count; i++) {
-        if (pool->picture_reserved[i])
-            continue;
-
-        picture_t *picture = pool->picture[i];
-        if (picture->i_refcount > 0)
-            continue;
+    /* The top of the stack is taken unless it cannot be locked */
+    for (int k = pool->free_count - 1; k >= 0; k--) {
+        picture_t *picture = pool->picture[pool->free[k]];
+        assert(picture->i_refcount == 0);
 
         if (Lock(picture))
             continue;
 
+        pool->free[k] = pool->free[--pool->free_count];
+
+        const unsigned used = pool->available - pool->free_count;
+        if (used > pool->stats.used_max)
+            pool->stats.used_max = used;
+
         /* */
         picture->p_next = NULL;
         picture->p_release_sys->tick = pool->tick++;
         picture_Hold(picture);
         return picture;
     }
+    pool->stats.starvations++;
     return NULL;
 }
 
@@ -250,10 +302,13 @@ void picture_pool_NonEmpty(picture_pool_t *pool, bool reset)
             old = picture;
         }
     }
-    if (!reset && old) {
+    if (reset) {
+        Rebind(pool);
+    } else if (old) {
         if (old->i_refcount > 0)
             Unlock(old);
         old->i_refcount = 0;
+        PushFree(pool, old->p_release_sys->index);
     }
 }
 int picture_pool_GetSize(picture_pool_t *pool)
@@ -261,6 +316,11 @@ int picture_pool_GetSize(picture_pool_t *pool)
     return pool->picture_count;
 }
 
+void picture_pool_GetStats(picture_pool_t *pool, picture_pool_stats_t *stats)
+{
+    *stats = pool->stats;
+}
+
 static void Release(picture_t *picture)
 {
     assert(picture->i_refcount > 0);
@@ -271,6 +331,9 @@ static void Release(picture_t *picture)
     if (--picture->i_refcount > 0)
         return;
     Unlock(picture);
+
+    picture_release_sys_t *release_sys = picture->p_release_sys;
+    PushFree(release_sys->pool, release_sys->index);
 }
 
 static int Lock(picture_t *picture)
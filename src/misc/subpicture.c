@@ -187,16 +187,23 @@ subpicture_region_private_t *subpicture_region_private_New( video_format_t *p_fm
             *p_private->fmt.p_palette = *p_fmt->p_palette;
     }
     p_private->p_picture = NULL;
+    p_private->p_next = NULL;
 
     return p_private;
 }
 
 void subpicture_region_private_Delete( subpicture_region_private_t *p_private )
 {
-    if( p_private->p_picture )
-        picture_Release( p_private->p_picture );
-    free( p_private->fmt.p_palette );
-    free( p_private );
+    while( p_private )
+    {
+        subpicture_region_private_t *p_next = p_private->p_next;
+
+        if( p_private->p_picture )
+            picture_Release( p_private->p_picture );
+        free( p_private->fmt.p_palette );
+        free( p_private );
+        p_private = p_next;
+    }
 }
 
 subpicture_region_t *subpicture_region_New( const video_format_t *p_fmt )
@@ -24,8 +24,12 @@
 struct subpicture_region_private_t {
     video_format_t fmt;
     picture_t      *p_picture;
+
+    /* Versions scaled for other outputs, most recently used first */
+    subpicture_region_private_t *p_next;
 };
 
 subpicture_region_private_t *subpicture_region_private_New(video_format_t *);
+/* Deletes the whole chain of scaled versions */
 void subpicture_region_private_Delete(subpicture_region_private_t *);
 
@@ -69,6 +69,18 @@ httpd_file_t *httpd_FileNew (httpd_host_t *host,
     assert (0);
 }
 
+httpd_file_t *httpd_FileNewPath (httpd_host_t *host,
+                                 const char *url, const char *content_type,
+                                 const char *login, const char *password,
+                                 const vlc_acl_t *acl, const char *path)
+{
+    (void) host;
+    (void) url; (void) content_type;
+    (void) login; (void) password; (void) acl;
+    (void) path;
+    assert (0);
+}
+
 httpd_handler_sys_t *httpd_HandlerDelete (httpd_handler_t *handler)
 {
     (void) handler;
@@ -142,6 +154,12 @@ char *httpd_ServerIP (const httpd_client_t *client, char *ip, int *port)
     assert (0);
 }
 
+void httpd_StreamBurst (httpd_stream_t *stream, int rate)
+{
+    (void) stream; (void) rate;
+    assert (0);
+}
+
 void httpd_StreamDelete (httpd_stream_t *stream)
 {
     (void) stream;
@@ -154,6 +172,12 @@ int httpd_StreamHeader (httpd_stream_t *stream, uint8_t *data, int count)
     assert (0);
 }
 
+void httpd_StreamKeyFrame (httpd_stream_t *stream)
+{
+    (void) stream;
+    assert (0);
+}
+
 httpd_stream_t *httpd_StreamNew (httpd_host_t *host,
                                  const char *url, const char *content_type,
                                  const char *login, const char *password,
@@ -39,10 +39,15 @@
 #include <vlc_rand.h>
 #include <vlc_charset.h>
 #include <vlc_url.h>
+#include <vlc_atomic.h>
 #include "../libvlc.h"
 
 #include <string.h>
 #include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <vlc_fs.h>
 
 #ifdef HAVE_UNISTD_H
 #   include <unistd.h>
@@ -52,6 +57,16 @@
 # include <poll.h>
 #endif
 
+#ifdef HAVE_SYS_SENDFILE_H
+# include <sys/sendfile.h>
+#endif
+
+#ifdef HAVE_SYS_EPOLL_H
+# include <sys/epoll.h>
+/* events handled per wake-up of a worker */
+# define HTTPD_MAX_EVENTS 64
+#endif
+
 #if defined( UNDER_CE )
 #   include <winsock.h>
 #elif defined( WIN32 )
@@ -69,7 +84,43 @@
 
 static void httpd_ClientClean( httpd_client_t *cl );
 
-/* each host run in his own thread */
+/* Part of the data of a stream, shared by all its clients */
+typedef struct httpd_chunk_t
+{
+    vlc_atomic_t refs;
+    int64_t      i_pos;   /* absolute position of p_data[0] */
+    size_t       i_size;  /* only grows, written under the stream lock */
+    size_t       i_alloc;
+    uint8_t      p_data[];
+} httpd_chunk_t;
+
+/* appending small writes to big chunks saves send() calls */
+#define HTTPD_CHUNK_SIZE 65536
+
+/* Largest piece of a disk file sent at once */
+#define HTTPD_FILE_CHUNK 65536
+
+static void httpd_ChunkRelease( httpd_chunk_t *chunk )
+{
+    if( vlc_atomic_dec( &chunk->refs ) == 0 )
+        free( chunk );
+}
+
+/* each worker thread of a host serves its own share of the clients */
+typedef struct httpd_worker_t
+{
+    httpd_host_t *host;
+    vlc_thread_t  thread;
+
+    int            i_client;
+    httpd_client_t **client;
+
+#ifdef HAVE_SYS_EPOLL_H
+    int epfd;       /* sockets of the clients, kept across iterations */
+    int wakefd[2];  /* to wake the worker up from another thread */
+#endif
+} httpd_worker_t;
+
 struct httpd_host_t
 {
     VLC_COMMON_MEMBERS
@@ -82,7 +133,8 @@ struct httpd_host_t
     unsigned     nfd;
     unsigned     port;
 
-    vlc_thread_t thread;
+    unsigned        nworker;
+    httpd_worker_t *worker;
     vlc_mutex_t lock;
     vlc_cond_t  wait;
 
@@ -93,9 +145,6 @@ struct httpd_host_t
     int         i_url;
     httpd_url_t **url;
 
-    int            i_client;
-    httpd_client_t **client;
-
     /* TLS data */
     vlc_tls_creds_t *p_tls;
 };
@@ -150,6 +199,9 @@ struct httpd_client_t
     int     i_ref;
 
     int     fd;
+#ifdef HAVE_SYS_EPOLL_H
+    short   i_events; /* being polled for */
+#endif
 
     bool    b_stream_mode;
     uint8_t i_state;
@@ -168,6 +220,23 @@ struct httpd_client_t
 
     /* TLS data */
     vlc_tls_t *p_tls;
+
+    /* Stream data p_buffer points to, NULL if p_buffer is allocated */
+    httpd_chunk_t *p_chunk;
+    /* Stream data of the answer body, not sent yet */
+    httpd_chunk_t *p_body_chunk;
+    uint8_t       *p_body_data;
+
+    /* Catching up with the stream from a key frame */
+    mtime_t i_burst_date;
+    int64_t i_burst_start;
+    int64_t i_burst_end;
+
+    /* Disk file the answer body is read from, -1 if none */
+    int      i_file_fd;
+    bool     b_file_body; /* headers are sent, now sending the file */
+    uint64_t i_file_pos;
+    uint64_t i_file_end;
 };
 
 
@@ -265,9 +334,9 @@ static const http_status_info http_reason[] =
     { 202, "Accepted" },
     { 203, "Non-authoritative information" },
     { 204, "No content" },
-    { 205, "Reset content" },
+    { 205, "Reset content" },*/
     { 206, "Partial content" },
-    { 250, "Low on storage space" },
+  /*{ 250, "Low on storage space" },
     { 300, "Multiple choices" },*/
     { 301, "Moved permanently" },
   /*{ 302, "Moved temporarily" },
@@ -290,9 +359,9 @@ static const http_status_info http_reason[] =
     { 412, "Precondition failed" },
     { 413, "Request entity too large" },
     { 414, "Request-URI too large" },
-    { 415, "Unsupported media Type" },
+    { 415, "Unsupported media Type" },*/
     { 416, "Requested range not satisfiable" },
-    { 417, "Expectation failed" },
+  /*{ 417, "Expectation failed" },
     { 451, "Parameter not understood" },
     { 452, "Conference not found" },
     { 453, "Not enough bandwidth" },*/
@@ -377,6 +446,7 @@ struct httpd_file_t
     httpd_file_callback_t pf_fill;
     httpd_file_sys_t      *p_sys;
 
+    char *psz_path; /* served from disk if not NULL */
 };
 
 static int
@@ -468,6 +538,7 @@ httpd_file_t *httpd_FileNew( httpd_host_t *host,
 
     file->pf_fill = pf_fill;
     file->p_sys   = p_sys;
+    file->psz_path = NULL;
 
     httpd_UrlCatch( file->url, HTTPD_MSG_HEAD, httpd_FileCallBack,
                     (httpd_callback_sys_t*)file );
@@ -479,6 +550,172 @@ httpd_file_t *httpd_FileNew( httpd_host_t *host,
     return file;
 }
 
+/* Parse a single "bytes=" range. Returns false if it cannot be satisfied,
+ * and leaves the whole file selected if there is no usable range. */
+static bool httpd_FileRange( const char *psz_range, uint64_t i_size,
+                             uint64_t *pi_start, uint64_t *pi_end )
+{
+    *pi_start = 0;
+    *pi_end = i_size;
+
+    if( psz_range == NULL || strncasecmp( psz_range, "bytes=", 6 ) )
+        return true;
+    psz_range += 6;
+    if( strchr( psz_range, ',' ) != NULL )
+        return true; /* multiple ranges are not supported, send everything */
+
+    char *end;
+    if( *psz_range == '-' )
+    {
+        /* suffix: last N bytes */
+        uint64_t i_len = strtoull( psz_range + 1, &end, 10 );
+        if( end == psz_range + 1 || i_len == 0 )
+            return false;
+        if( i_len < i_size )
+            *pi_start = i_size - i_len;
+        return i_size > 0;
+    }
+
+    uint64_t i_start = strtoull( psz_range, &end, 10 );
+    if( end == psz_range || *end != '-' )
+        return true;
+    if( i_start >= i_size )
+        return false;
+    *pi_start = i_start;
+
+    psz_range = end + 1;
+    if( *psz_range != '\0' )
+    {
+        uint64_t i_last = strtoull( psz_range, &end, 10 );
+        if( end == psz_range || i_last < i_start )
+            return true;
+        if( i_last < i_size )
+            *pi_end = i_last + 1;
+    }
+    return true;
+}
+
+static int
+httpd_FilePathCallBack( httpd_callback_sys_t *p_sys, httpd_client_t *cl,
+                        httpd_message_t *answer, const httpd_message_t *query )
+{
+    httpd_file_t *file = (httpd_file_t*)p_sys;
+    const char *psz_connection;
+    struct stat st;
+    uint64_t i_start, i_end;
+
+    if( answer == NULL || query == NULL )
+    {
+        return VLC_SUCCESS;
+    }
+    answer->i_proto  = HTTPD_PROTO_HTTP;
+    answer->i_version= 1;
+    answer->i_type   = HTTPD_MSG_ANSWER;
+
+    /* We respect client request */
+    psz_connection = httpd_MsgGet( &cl->query, "Connection" );
+    if( psz_connection != NULL )
+    {
+        httpd_MsgAdd( answer, "Connection", "%s", psz_connection );
+    }
+
+    int fd = vlc_open( file->psz_path, O_RDONLY );
+    if( fd != -1 && ( fstat( fd, &st ) || !S_ISREG( st.st_mode ) ) )
+    {
+        close( fd );
+        fd = -1;
+    }
+    if( fd == -1 )
+    {
+        char *p;
+
+        answer->i_status = 404;
+        answer->i_body = httpd_HtmlError( &p, 404, file->psz_url );
+        answer->p_body = (uint8_t *)p;
+        httpd_MsgAdd( answer, "Content-Type", "%s", "text/html" );
+        httpd_MsgAdd( answer, "Content-Length", "%d", answer->i_body );
+        return VLC_SUCCESS;
+    }
+
+    httpd_MsgAdd( answer, "Accept-Ranges", "bytes" );
+    if( !httpd_FileRange( httpd_MsgGet( query, "Range" ), st.st_size,
+                          &i_start, &i_end ) )
+    {
+        close( fd );
+        answer->i_status = 416;
+        httpd_MsgAdd( answer, "Content-Range", "bytes */%"PRIu64,
+                      (uint64_t)st.st_size );
+        httpd_MsgAdd( answer, "Content-Length", "0" );
+        return VLC_SUCCESS;
+    }
+
+    if( i_start > 0 || i_end < (uint64_t)st.st_size )
+    {
+        answer->i_status = 206;
+        httpd_MsgAdd( answer, "Content-Range", "bytes %"PRIu64"-%"PRIu64"/%"PRIu64,
+                      i_start, i_end - 1, (uint64_t)st.st_size );
+    }
+    else
+        answer->i_status = 200;
+
+    httpd_MsgAdd( answer, "Content-type",  "%s", file->psz_mime );
+    httpd_MsgAdd( answer, "Content-Length", "%"PRIu64, i_end - i_start );
+
+    if( query->i_type == HTTPD_MSG_HEAD || i_start >= i_end )
+    {
+        close( fd );
+        return VLC_SUCCESS;
+    }
+
+    /* The body is sent from the file once the headers are out */
+    if( cl->i_file_fd != -1 )
+        close( cl->i_file_fd );
+    cl->i_file_fd = fd;
+    cl->i_file_pos = i_start;
+    cl->i_file_end = i_end;
+#ifdef HAVE_POSIX_FADVISE
+    posix_fadvise( fd, i_start, i_end - i_start, POSIX_FADV_SEQUENTIAL );
+#endif
+    return VLC_SUCCESS;
+}
+
+httpd_file_t *httpd_FileNewPath( httpd_host_t *host,
+                                 const char *psz_url, const char *psz_mime,
+                                 const char *psz_user, const char *psz_password,
+                                 const vlc_acl_t *p_acl, const char *psz_path )
+{
+    httpd_file_t *file = xmalloc( sizeof( httpd_file_t ) );
+
+    if( ( file->url = httpd_UrlNewUnique( host, psz_url, psz_user,
+                                          psz_password, p_acl )
+        ) == NULL )
+    {
+        free( file );
+        return NULL;
+    }
+
+    file->psz_url  = strdup( psz_url );
+    if( psz_mime && *psz_mime )
+    {
+        file->psz_mime = strdup( psz_mime );
+    }
+    else
+    {
+        file->psz_mime = strdup( httpd_MimeFromUrl( psz_url ) );
+    }
+
+    file->pf_fill  = NULL;
+    file->p_sys    = NULL;
+    file->psz_path = strdup( psz_path );
+
+    httpd_UrlCatch( file->url, HTTPD_MSG_HEAD, httpd_FilePathCallBack,
+                    (httpd_callback_sys_t*)file );
+    httpd_UrlCatch( file->url, HTTPD_MSG_GET,  httpd_FilePathCallBack,
+                    (httpd_callback_sys_t*)file );
+
+    return file;
+}
+
 httpd_file_sys_t *httpd_FileDelete( httpd_file_t *file )
 {
     httpd_file_sys_t *p_sys = file->p_sys;
@@ -487,6 +724,7 @@ httpd_file_sys_t *httpd_FileDelete( httpd_file_t *file )
 
     free( file->psz_url );
     free( file->psz_mime );
+    free( file->psz_path );
 
     free( file );
 
@@ -707,13 +945,35 @@ struct httpd_stream_t
     uint8_t *p_header;
     int     i_header;
 
-    /* circular buffer */
-    int         i_buffer_size;      /* buffer size, can't be reallocated smaller */
-    uint8_t     *p_buffer;          /* buffer */
+    /* shared buffer, sent to the clients without copy */
+    int         i_buffer_size;      /* data kept for late clients */
+    int             i_chunk;
+    httpd_chunk_t **pp_chunk;
     int64_t     i_buffer_pos;       /* absolute position from begining */
     int64_t     i_buffer_last_pos;  /* a new connection will start with that */
+
+    /* Key frames, to start new connections with */
+    int64_t     i_keyframe_pos;     /* latest one, 0 if unknown */
+    bool        b_keyframe;         /* the next data starts one */
+    int         i_burst_rate;       /* to catch up with the stream, in bytes/s */
 };
 
+/* Where new clients start, stream lock held */
+static int64_t httpd_StreamJoin( httpd_stream_t *stream, httpd_client_t *cl )
+{
+    int64_t i_pos = stream->i_buffer_last_pos;
+
+    /* The latest key frame, if it is still there */
+    if( stream->i_keyframe_pos > 0 && stream->i_chunk > 0
+     && stream->i_keyframe_pos >= stream->pp_chunk[0]->i_pos )
+        i_pos = stream->i_keyframe_pos;
+
+    cl->i_burst_date = mdate();
+    cl->i_burst_start = i_pos;
+    cl->i_burst_end = stream->i_buffer_pos;
+    return i_pos;
+}
+
 static int httpd_StreamCallBack( httpd_callback_sys_t *p_sys,
                                  httpd_client_t *cl, httpd_message_t *answer,
                                  const httpd_message_t *query )
@@ -727,52 +987,71 @@ static int httpd_StreamCallBack( httpd_callback_sys_t *p_sys,
 
     if( answer->i_body_offset > 0 )
     {
+        httpd_chunk_t *chunk;
         int64_t i_write;
         int     i_pos;
+        int     i;
 
 #if 0
         fprintf( stderr, "httpd_StreamCallBack i_body_offset=%lld\n",
                  answer->i_body_offset );
 #endif
 
+        vlc_mutex_lock( &stream->lock );
         if( answer->i_body_offset >= stream->i_buffer_pos )
         {
             /* fprintf( stderr, "httpd_StreamCallBack: no data\n" ); */
+            vlc_mutex_unlock( &stream->lock );
             return VLC_EGENERIC;    /* wait, no data available */
         }
-        if( answer->i_body_offset + stream->i_buffer_size <
-            stream->i_buffer_pos )
+        if( answer->i_body_offset < stream->pp_chunk[0]->i_pos )
         {
             /* this client isn't fast enough */
 #if 0
             fprintf( stderr, "fixing i_body_offset (old=%lld new=%lld)\n",
                      answer->i_body_offset, stream->i_buffer_last_pos );
 #endif
-            answer->i_body_offset = stream->i_buffer_last_pos;
+            answer->i_body_offset = httpd_StreamJoin( stream, cl );
         }
 
-        i_pos   = answer->i_body_offset % stream->i_buffer_size;
-        i_write = stream->i_buffer_pos - answer->i_body_offset;
-        if( i_write > HTTPD_CL_BUFSIZE )
-        {
-            i_write = HTTPD_CL_BUFSIZE;
-        }
-        else if( i_write <= 0 )
+        /* Clients are usually near the end of the stream */
+        for( i = stream->i_chunk - 1; i > 0; i-- )
+            if( stream->pp_chunk[i]->i_pos <= answer->i_body_offset )
+                break;
+        chunk = stream->pp_chunk[i];
+        i_pos   = answer->i_body_offset - chunk->i_pos;
+        i_write = chunk->i_size - i_pos;
+
+        /* Do not send what was buffered before the client came too fast */
+        if( stream->i_burst_rate > 0
+         && answer->i_body_offset < cl->i_burst_end )
         {
-            return VLC_EGENERIC;    /* wait, no data available */
-        }
+            int64_t i_allowed = cl->i_burst_start + stream->i_burst_rate
+                              * ( mdate() - cl->i_burst_date ) / CLOCK_FREQ;
 
-        /* Don't go past the end of the circular buffer */
-        i_write = __MIN( i_write, stream->i_buffer_size - i_pos );
+            i_write = __MIN( i_write, i_allowed - answer->i_body_offset );
+            if( i_write <= 0 )
+            {
+                vlc_mutex_unlock( &stream->lock );
+                return VLC_EGENERIC;    /* wait */
+            }
+        }
+        vlc_atomic_inc( &chunk->refs );
+        vlc_mutex_unlock( &stream->lock );
 
         /* using HTTPD_MSG_ANSWER -> data available */
         answer->i_proto  = HTTPD_PROTO_HTTP;
         answer->i_version= 0;
         answer->i_type   = HTTPD_MSG_ANSWER;
 
+        /* The data is sent straight from the chunk, which never changes
+         * below i_size */
+        if( cl->p_body_chunk != NULL )
+            httpd_ChunkRelease( cl->p_body_chunk );
+        cl->p_body_chunk = chunk;
+        cl->p_body_data = &chunk->p_data[i_pos];
         answer->i_body = i_write;
-        answer->p_body = xmalloc( i_write );
-        memcpy( answer->p_body, &stream->p_buffer[i_pos], i_write );
+        answer->p_body = NULL;
 
         answer->i_body_offset += i_write;
 
@@ -797,7 +1076,7 @@ static int httpd_StreamCallBack( httpd_callback_sys_t *p_sys,
                 answer->p_body = xmalloc( stream->i_header );
                 memcpy( answer->p_body, stream->p_header, stream->i_header );
             }
-            answer->i_body_offset = stream->i_buffer_last_pos;
+            answer->i_body_offset = httpd_StreamJoin( stream, cl );
             vlc_mutex_unlock( &stream->lock );
         }
         else
@@ -869,11 +1148,14 @@ httpd_stream_t *httpd_StreamNew( httpd_host_t *host,
     stream->i_header = 0;
     stream->p_header = NULL;
     stream->i_buffer_size = 5000000;    /* 5 Mo per stream */
-    stream->p_buffer = xmalloc( stream->i_buffer_size );
+    TAB_INIT( stream->i_chunk, stream->pp_chunk );
     /* We set to 1 to make life simpler
      * (this way i_body_offset can never be 0) */
     stream->i_buffer_pos = 1;
     stream->i_buffer_last_pos = 1;
+    stream->i_keyframe_pos = 0;
+    stream->b_keyframe = false;
+    stream->i_burst_rate = 0;
 
     httpd_UrlCatch( stream->url, HTTPD_MSG_HEAD, httpd_StreamCallBack,
                     (httpd_callback_sys_t*)stream );
@@ -904,9 +1186,6 @@ int httpd_StreamHeader( httpd_stream_t *stream, uint8_t *p_data, int i_data )
 
 int httpd_StreamSend( httpd_stream_t *stream, uint8_t *p_data, int i_data )
 {
-    int i_count;
-    int i_pos;
-
     if( i_data < 0 || p_data == NULL )
     {
         return VLC_SUCCESS;
@@ -915,43 +1194,84 @@ int httpd_StreamSend( httpd_stream_t *stream, uint8_t *p_data, int i_data )
 
     /* save this pointer (to be used by new connection) */
     stream->i_buffer_last_pos = stream->i_buffer_pos;
+    if( stream->b_keyframe )
+    {
+        stream->i_keyframe_pos = stream->i_buffer_pos;
+        stream->b_keyframe = false;
+    }
 
-    i_pos = stream->i_buffer_pos % stream->i_buffer_size;
-    i_count = i_data;
-    while( i_count > 0)
+    while( i_data > 0 )
     {
-        int i_copy;
+        httpd_chunk_t *chunk = NULL;
+        size_t i_copy;
 
-        i_copy = __MIN( i_count, stream->i_buffer_size - i_pos );
+        if( stream->i_chunk > 0 )
+            chunk = stream->pp_chunk[stream->i_chunk - 1];
+        if( chunk == NULL || chunk->i_size == chunk->i_alloc )
+        {
+            size_t i_alloc = __MAX( (size_t)i_data, HTTPD_CHUNK_SIZE );
+
+            chunk = xmalloc( sizeof( *chunk ) + i_alloc );
+            vlc_atomic_set( &chunk->refs, 1 );
+            chunk->i_pos = stream->i_buffer_pos;
+            chunk->i_size = 0;
+            chunk->i_alloc = i_alloc;
+            TAB_APPEND( stream->i_chunk, stream->pp_chunk, chunk );
+
+            /* Drop what is too old, clients sending it keep a reference */
+            while( stream->i_chunk > 1 && stream->i_buffer_pos -
+                   stream->pp_chunk[1]->i_pos >= stream->i_buffer_size )
+            {
+                httpd_chunk_t *old = stream->pp_chunk[0];
+                TAB_REMOVE( stream->i_chunk, stream->pp_chunk, old );
+                httpd_ChunkRelease( old );
+            }
+        }
 
-        /* Ok, we can't go past the end of our buffer */
-        memcpy( &stream->p_buffer[i_pos], p_data, i_copy );
+        /* Ok, we can't go past the end of the chunk */
+        i_copy = __MIN( (size_t)i_data, chunk->i_alloc - chunk->i_size );
+        memcpy( &chunk->p_data[chunk->i_size], p_data, i_copy );
+        chunk->i_size += i_copy;
 
-        i_pos = ( i_pos + i_copy ) % stream->i_buffer_size;
-        i_count -= i_copy;
-        p_data  += i_copy;
+        stream->i_buffer_pos += i_copy;
+        i_data -= i_copy;
+        p_data += i_copy;
     }
 
-    stream->i_buffer_pos += i_data;
-
     vlc_mutex_unlock( &stream->lock );
     return VLC_SUCCESS;
 }
 
+void httpd_StreamKeyFrame( httpd_stream_t *stream )
+{
+    vlc_mutex_lock( &stream->lock );
+    stream->b_keyframe = true;
+    vlc_mutex_unlock( &stream->lock );
+}
+
+void httpd_StreamBurst( httpd_stream_t *stream, int i_rate )
+{
+    vlc_mutex_lock( &stream->lock );
+    stream->i_burst_rate = __MAX( i_rate, 0 );
+    vlc_mutex_unlock( &stream->lock );
+}
+
 void httpd_StreamDelete( httpd_stream_t *stream )
 {
     httpd_UrlDelete( stream->url );
     vlc_mutex_destroy( &stream->lock );
     free( stream->psz_mime );
     free( stream->p_header );
-    free( stream->p_buffer );
+    for( int i = 0; i < stream->i_chunk; i++ )
+        httpd_ChunkRelease( stream->pp_chunk[i] );
+    TAB_CLEAN( stream->i_chunk, stream->pp_chunk );
     free( stream );
 }
 
 /*****************************************************************************
  * Low level
  *****************************************************************************/
-static void* httpd_HostThread( void * );
+static void* httpd_WorkerThread( void * );
 static httpd_host_t *httpd_HostCreate( vlc_object_t *, const char *,
                                        const char *, vlc_tls_creds_t * );
 
@@ -1020,6 +1340,71 @@ httpd_host_t *vlc_rtsp_HostNew( vlc_object_t *p_this )
     return httpd_HostCreate( p_this, "rtsp-host", "rtsp-port", NULL );
 }
 
+#ifdef HAVE_SYS_EPOLL_H
+static void httpd_WorkerWake( httpd_worker_t * );
+#endif
+
+static int httpd_WorkerInit( httpd_host_t *host, httpd_worker_t *worker,
+                             bool b_listen )
+{
+    worker->host = host;
+    worker->i_client = 0;
+    worker->client = NULL;
+
+#ifdef HAVE_SYS_EPOLL_H
+    struct epoll_event ev;
+
+    worker->epfd = epoll_create1( EPOLL_CLOEXEC );
+    if( worker->epfd == -1 )
+        return -1;
+    if( vlc_pipe( worker->wakefd ) )
+    {
+        close( worker->epfd );
+        return -1;
+    }
+    fcntl( worker->wakefd[0], F_SETFL, O_NONBLOCK );
+    fcntl( worker->wakefd[1], F_SETFL, O_NONBLOCK );
+
+    ev.events = EPOLLIN;
+    ev.data.ptr = worker;
+    if( epoll_ctl( worker->epfd, EPOLL_CTL_ADD, worker->wakefd[0], &ev ) )
+        goto error;
+
+    ev.data.ptr = host;
+    if( epoll_ctl( worker->epfd, EPOLL_CTL_ADD,
+                   vlc_object_waitpipe( VLC_OBJECT( host ) ), &ev ) )
+        goto error;
+
+    for( unsigned i = 0; b_listen && i < host->nfd; i++ )
+    {
+        ev.data.ptr = &host->fds[i];
+        if( epoll_ctl( worker->epfd, EPOLL_CTL_ADD, host->fds[i], &ev ) )
+            goto error;
+    }
+    return 0;
+
+error:
+    close( worker->wakefd[1] );
+    close( worker->wakefd[0] );
+    close( worker->epfd );
+    return -1;
+#else
+    VLC_UNUSED( b_listen );
+    return 0;
+#endif
+}
+
+static void httpd_WorkerClean( httpd_worker_t *worker )
+{
+#ifdef HAVE_SYS_EPOLL_H
+    close( worker->wakefd[1] );
+    close( worker->wakefd[0] );
+    close( worker->epfd );
+#else
+    VLC_UNUSED( worker );
+#endif
+}
+
 static struct httpd_t
 {
     vlc_mutex_t  mutex;
@@ -1082,6 +1467,7 @@ static httpd_host_t *httpd_HostCreate( vlc_object_t *p_this,
                                               "http host" );
     if (host == NULL)
         goto error;
+    host->worker = NULL;
 
     vlc_mutex_init( &host->lock );
     vlc_cond_init( &host->wait );
@@ -1104,17 +1490,46 @@ static httpd_host_t *httpd_HostCreate( vlc_object_t *p_this,
     host->port     = port;
     host->i_url    = 0;
     host->url      = NULL;
-    host->i_client = 0;
-    host->client   = NULL;
     host->p_tls    = p_tls;
 
-    /* create the thread */
-    if( vlc_clone( &host->thread, httpd_HostThread, host,
-                   VLC_THREAD_PRIORITY_LOW ) )
-    {
-        msg_Err( p_this, "cannot spawn http host thread" );
+#ifdef HAVE_SYS_EPOLL_H
+    host->nworker = var_InheritInteger( p_this, "http-threads" );
+    if( host->nworker < 1 )
+        host->nworker = 1;
+#else
+    /* without epoll, clients cannot be handed to a sleeping worker */
+    host->nworker = 1;
+#endif
+    host->worker = calloc( host->nworker, sizeof( *host->worker ) );
+    if( host->worker == NULL )
         goto error;
+    for( unsigned i = 0; i < host->nworker; i++ )
+    {
+        if( httpd_WorkerInit( host, &host->worker[i], i == 0 ) )
+        {
+            msg_Err( p_this, "cannot initialize http host worker: %m" );
+            while( i > 0 )
+                httpd_WorkerClean( &host->worker[--i] );
+            goto error;
+        }
+    }
+
+    /* create the threads */
+    for( unsigned i = 0; i < host->nworker; i++ )
+    {
+        if( vlc_clone( &host->worker[i].thread, httpd_WorkerThread,
+                       &host->worker[i], VLC_THREAD_PRIORITY_LOW ) )
+        {
+            msg_Err( p_this, "cannot spawn http host thread" );
+            vlc_object_kill( host );
+            while( i > 0 )
+                vlc_join( host->worker[--i].thread, NULL );
+            for( i = 0; i < host->nworker; i++ )
+                httpd_WorkerClean( &host->worker[i] );
+            goto error;
+        }
     }
+    msg_Dbg( p_this, "HTTP host with %u worker thread(s)", host->nworker );
 
     /* now add it to httpd */
     TAB_APPEND( httpd.i_host, httpd.host, host );
@@ -1129,6 +1544,7 @@ error:
 
     if( host != NULL )
     {
+        free( host->worker );
         net_ListenClose( host->fds );
         vlc_cond_destroy( &host->wait );
         vlc_mutex_destroy( &host->lock );
@@ -1155,7 +1571,7 @@ void httpd_HostDelete( httpd_host_t *host )
     host->i_ref--;
     if( host->i_ref == 0 )
     {
-        vlc_cond_signal( &host->wait );
+        vlc_cond_broadcast( &host->wait );
         delete = true;
     }
     vlc_mutex_unlock( &host->lock );
@@ -1169,7 +1585,8 @@ void httpd_HostDelete( httpd_host_t *host )
     TAB_REMOVE( httpd.i_host, httpd.host, host );
 
     vlc_object_kill( host );
-    vlc_join( host->thread, NULL );
+    for( unsigned w = 0; w < host->nworker; w++ )
+        vlc_join( host->worker[w].thread, NULL );
 
     msg_Dbg( host, "HTTP host removed" );
 
@@ -1177,16 +1594,23 @@ void httpd_HostDelete( httpd_host_t *host )
     {
         msg_Err( host, "url still registered: %s", host->url[i]->psz_url );
     }
-    for( i = 0; i < host->i_client; i++ )
+    for( unsigned w = 0; w < host->nworker; w++ )
     {
-        httpd_client_t *cl = host->client[i];
-        msg_Warn( host, "client still connected" );
-        httpd_ClientClean( cl );
-        TAB_REMOVE( host->i_client, host->client, cl );
-        free( cl );
-        i--;
-        /* TODO */
+        httpd_worker_t *worker = &host->worker[w];
+
+        for( i = 0; i < worker->i_client; i++ )
+        {
+            httpd_client_t *cl = worker->client[i];
+            msg_Warn( host, "client still connected" );
+            httpd_ClientClean( cl );
+            TAB_REMOVE( worker->i_client, worker->client, cl );
+            free( cl );
+            i--;
+            /* TODO */
+        }
+        httpd_WorkerClean( worker );
     }
+    free( host->worker );
 
     if( host->p_tls != NULL)
         vlc_tls_ServerDelete( host->p_tls );
@@ -1238,7 +1662,7 @@ static httpd_url_t *httpd_UrlNewPrivate( httpd_host_t *host, const char *psz_url
     }
 
     TAB_APPEND( host->i_url, host->url, url );
-    vlc_cond_signal( &host->wait );
+    vlc_cond_broadcast( &host->wait );
     vlc_mutex_unlock( &host->lock );
 
     return url;
@@ -1287,18 +1711,32 @@ void httpd_UrlDelete( httpd_url_t *url )
     free( url->psz_password );
     ACL_Destroy( url->p_acl );
 
-    for( i = 0; i < host->i_client; i++ )
+    for( unsigned w = 0; w < host->nworker; w++ )
     {
-        httpd_client_t *client = host->client[i];
+        httpd_worker_t *worker = &host->worker[w];
 
-        if( client->url == url )
+        for( i = 0; i < worker->i_client; i++ )
         {
-            /* TODO complete it */
-            msg_Warn( host, "force closing connections" );
-            httpd_ClientClean( client );
-            TAB_REMOVE( host->i_client, host->client, client );
-            free( client );
-            i--;
+            httpd_client_t *client = worker->client[i];
+
+            if( client->url == url )
+            {
+                /* TODO complete it */
+                msg_Warn( host, "force closing connections" );
+#ifdef HAVE_SYS_EPOLL_H
+                /* The worker may hold pending events for this client,
+                 * let it remove the client itself */
+                client->url = NULL;
+                client->i_ref = -1;
+                client->i_state = HTTPD_CLIENT_DEAD;
+                httpd_WorkerWake( worker );
+#else
+                httpd_ClientClean( client );
+                TAB_REMOVE( worker->i_client, worker->client, client );
+                free( client );
+                i--;
+#endif
+            }
         }
     }
     free( url );
@@ -1406,6 +1844,38 @@ char* httpd_ServerIP( const httpd_client_t *cl, char *ip, int *port )
     return net_GetSockAddress( cl->fd, ip, port ) ? NULL : ip;
 }
 
+/* Drop the data being sent */
+static void httpd_ClientBufferRelease( httpd_client_t *cl )
+{
+    if( cl->p_chunk != NULL )
+    {
+        httpd_ChunkRelease( cl->p_chunk );
+        cl->p_chunk = NULL;
+    }
+    else
+        free( cl->p_buffer );
+    cl->p_buffer = NULL;
+}
+
+/* Send the answer body next */
+static void httpd_ClientTakeBody( httpd_client_t *cl )
+{
+    httpd_ClientBufferRelease( cl );
+    if( cl->p_body_chunk != NULL )
+    {
+        cl->p_chunk = cl->p_body_chunk;
+        cl->p_buffer = cl->p_body_data;
+        cl->p_body_chunk = NULL;
+    }
+    else
+        cl->p_buffer = cl->answer.p_body;
+    cl->i_buffer_size = cl->answer.i_body;
+    cl->i_buffer = 0;
+
+    cl->answer.i_body = 0;
+    cl->answer.p_body = NULL;
+}
+
 static void httpd_ClientClean( httpd_client_t *cl )
 {
     if( cl->fd >= 0 )
@@ -1419,8 +1889,17 @@ static void httpd_ClientClean( httpd_client_t *cl )
     httpd_MsgClean( &cl->answer );
     httpd_MsgClean( &cl->query );
 
-    free( cl->p_buffer );
-    cl->p_buffer = NULL;
+    httpd_ClientBufferRelease( cl );
+    if( cl->p_body_chunk != NULL )
+    {
+        httpd_ChunkRelease( cl->p_body_chunk );
+        cl->p_body_chunk = NULL;
+    }
+    if( cl->i_file_fd != -1 )
+    {
+        close( cl->i_file_fd );
+        cl->i_file_fd = -1;
+    }
 }
 
 static httpd_client_t *httpd_ClientNew( int fd, vlc_tls_t *p_tls, mtime_t now )
@@ -1433,6 +1912,11 @@ static httpd_client_t *httpd_ClientNew( int fd, vlc_tls_t *p_tls, mtime_t now )
     cl->fd      = fd;
     cl->url     = NULL;
     cl->p_tls = p_tls;
+    cl->p_chunk = NULL;
+    cl->p_body_chunk = NULL;
+    cl->i_burst_end = 0;
+    cl->i_file_fd = -1;
+    cl->b_file_body = false;
 
     httpd_ClientInit( cl, now );
 
@@ -1895,11 +2379,91 @@ static void httpd_ClientRecv( httpd_client_t *cl )
 #endif
 }
 
+/* Send the next piece of the disk file body */
+static void httpd_ClientSendFile( httpd_client_t *cl )
+{
+    size_t i_max = __MIN( cl->i_file_end - cl->i_file_pos, HTTPD_FILE_CHUNK );
+    ssize_t i_len;
+
+#ifdef HAVE_SYS_SENDFILE_H
+    if( cl->p_tls == NULL )
+    {
+        /* straight from the page cache to the socket */
+        off_t i_offset = cl->i_file_pos;
+
+        do
+            i_len = sendfile( cl->fd, cl->i_file_fd, &i_offset, i_max );
+        while( i_len == -1 && errno == EINTR );
+        if( i_len > 0 )
+            cl->i_file_pos += i_len;
+    }
+    else
+#endif
+    {
+        if( cl->i_buffer >= cl->i_buffer_size )
+        {
+            ssize_t i_read;
+
+            if( cl->p_buffer == NULL )
+                cl->p_buffer = xmalloc( HTTPD_FILE_CHUNK );
+#ifdef HAVE_PREAD
+            i_read = pread( cl->i_file_fd, cl->p_buffer, i_max,
+                            cl->i_file_pos );
+#else
+            i_read = -1;
+            if( lseek( cl->i_file_fd, cl->i_file_pos, SEEK_SET ) != -1 )
+                i_read = read( cl->i_file_fd, cl->p_buffer, i_max );
+#endif
+            if( i_read <= 0 )
+            {
+                /* the file went shorter than announced */
+                cl->i_state = HTTPD_CLIENT_DEAD;
+                return;
+            }
+            cl->i_file_pos += i_read;
+            cl->i_buffer = 0;
+            cl->i_buffer_size = i_read;
+        }
+
+        i_len = httpd_NetSend( cl, &cl->p_buffer[cl->i_buffer],
+                               cl->i_buffer_size - cl->i_buffer );
+        if( i_len > 0 )
+            cl->i_buffer += i_len;
+    }
+
+    if( i_len > 0 )
+    {
+        if( cl->i_file_pos >= cl->i_file_end
+         && cl->i_buffer >= cl->i_buffer_size )
+        {
+            close( cl->i_file_fd );
+            cl->i_file_fd = -1;
+            cl->b_file_body = false;
+            cl->i_state = HTTPD_CLIENT_SEND_DONE;
+        }
+    }
+#if defined( WIN32 ) || defined( UNDER_CE )
+    else if( i_len == 0 || WSAGetLastError() != WSAEWOULDBLOCK )
+#else
+    else if( i_len == 0 || errno != EAGAIN )
+#endif
+    {
+        /* error, or the file went shorter than announced */
+        cl->i_state = HTTPD_CLIENT_DEAD;
+    }
+}
+
 static void httpd_ClientSend( httpd_client_t *cl )
 {
     int i;
     int i_len;
 
+    if( cl->b_file_body )
+    {
+        httpd_ClientSendFile( cl );
+        return;
+    }
+
     if( cl->i_buffer < 0 )
     {
         /* We need to create the header */
@@ -1914,10 +2478,10 @@ static void httpd_ClientSend( httpd_client_t *cl )
                       strlen( cl->answer.value[i] ) + 2;
         }
 
-        if( cl->i_buffer_size < i_size )
+        if( cl->i_buffer_size < i_size || cl->p_chunk != NULL )
         {
             cl->i_buffer_size = i_size;
-            free( cl->p_buffer );
+            httpd_ClientBufferRelease( cl );
             cl->p_buffer = xmalloc( i_size );
         }
         p = (char *)cl->p_buffer;
@@ -1964,13 +2528,15 @@ static void httpd_ClientSend( httpd_client_t *cl )
             if( cl->answer.i_body > 0 )
             {
                 /* send the body data */
-                free( cl->p_buffer );
-                cl->p_buffer = cl->answer.p_body;
-                cl->i_buffer_size = cl->answer.i_body;
-                cl->i_buffer = 0;
-
-                cl->answer.i_body = 0;
-                cl->answer.p_body = NULL;
+                httpd_ClientTakeBody( cl );
+            }
+            else if( cl->i_file_fd != -1 )
+            {
+                /* send the body from the disk file */
+                httpd_ClientBufferRelease( cl );
+                cl->i_buffer = 0;
+                cl->i_buffer_size = 0;
+                cl->b_file_body = true;
             }
             else
             {
@@ -2030,358 +2596,572 @@ static void httpd_ClientTlsHsOut( httpd_client_t *cl )
     }
 }
 
-static void* httpd_HostThread( void *data )
+/* Decide what the client waits for, handling the requests it completed */
+static short httpd_ClientPrepare( httpd_host_t *host, httpd_client_t *cl )
 {
-    httpd_host_t *host = data;
-    counter_t *p_total_counter = stats_CounterCreate( host, VLC_VAR_INTEGER, STATS_COUNTER );
-    counter_t *p_active_counter = stats_CounterCreate( host, VLC_VAR_INTEGER, STATS_COUNTER );
-    int evfd = vlc_object_waitpipe( VLC_OBJECT( host ) );
+    short events = 0;
 
-    for( ;; )
+    if( ( cl->i_state == HTTPD_CLIENT_RECEIVING )
+          || ( cl->i_state == HTTPD_CLIENT_TLS_HS_IN ) )
     {
-        struct pollfd ufd[host->nfd + host->i_client + 1];
-        unsigned nfd;
-        for( nfd = 0; nfd < host->nfd; nfd++ )
+        events = POLLIN;
+    }
+    else if( ( cl->i_state == HTTPD_CLIENT_SENDING )
+          || ( cl->i_state == HTTPD_CLIENT_TLS_HS_OUT ) )
+    {
+        events = POLLOUT;
+    }
+    else if( cl->i_state == HTTPD_CLIENT_RECEIVE_DONE )
+    {
+        httpd_message_t *answer = &cl->answer;
+        httpd_message_t *query  = &cl->query;
+        int i_msg = query->i_type;
+
+        httpd_MsgInit( answer );
+
+        /* Handle what we received */
+        if( i_msg == HTTPD_MSG_ANSWER )
         {
-            ufd[nfd].fd = host->fds[nfd];
-            ufd[nfd].events = POLLIN;
-            ufd[nfd].revents = 0;
+            cl->url     = NULL;
+            cl->i_state = HTTPD_CLIENT_DEAD;
         }
+        else if( i_msg == HTTPD_MSG_OPTIONS )
+        {
 
-        /* add all socket that should be read/write and close dead connection */
-        vlc_mutex_lock( &host->lock );
-        while( host->i_url <= 0 && host->i_ref > 0 )
-            vlc_cond_wait( &host->wait, &host->lock );
+            answer->i_type   = HTTPD_MSG_ANSWER;
+            answer->i_proto  = query->i_proto;
+            answer->i_status = 200;
+            answer->i_body = 0;
+            answer->p_body = NULL;
 
-        mtime_t now = mdate();
-        bool b_low_delay = false;
+            httpd_MsgAdd( answer, "Server", "VLC/%s", VERSION );
+            httpd_MsgAdd( answer, "Content-Length", "0" );
 
-        for(int i_client = 0; i_client < host->i_client; i_client++ )
-        {
-            httpd_client_t *cl = host->client[i_client];
-            if( cl->i_ref < 0 || ( cl->i_ref == 0 &&
-                ( cl->i_state == HTTPD_CLIENT_DEAD ||
-                  ( cl->i_activity_timeout > 0 &&
-                    cl->i_activity_date+cl->i_activity_timeout < now) ) ) )
+            switch( query->i_proto )
             {
-                httpd_ClientClean( cl );
-                stats_UpdateInteger( host, p_active_counter, -1, NULL );
-                TAB_REMOVE( host->i_client, host->client, cl );
-                free( cl );
-                i_client--;
-                continue;
-            }
+                case HTTPD_PROTO_HTTP:
+                    answer->i_version = 1;
+                    httpd_MsgAdd( answer, "Allow",
+                                  "GET,HEAD,POST,OPTIONS" );
+                    break;
 
-            struct pollfd *pufd = ufd + nfd;
-            assert (pufd < ufd + (sizeof (ufd) / sizeof (ufd[0])));
+                case HTTPD_PROTO_RTSP:
+                {
+                    const char *p;
+                    answer->i_version = 0;
+
+                    p = httpd_MsgGet( query, "Cseq" );
+                    if( p != NULL )
+                        httpd_MsgAdd( answer, "Cseq", "%s", p );
+                    p = httpd_MsgGet( query, "Timestamp" );
+                    if( p != NULL )
+                        httpd_MsgAdd( answer, "Timestamp", "%s", p );
+
+                    p = httpd_MsgGet( query, "Require" );
+                    if( p != NULL )
+                    {
+                        answer->i_status = 551;
+                        httpd_MsgAdd( query, "Unsupported", "%s", p );
+                    }
 
-            pufd->fd = cl->fd;
-            pufd->events = pufd->revents = 0;
+                    httpd_MsgAdd( answer, "Public", "DESCRIBE,SETUP,"
+                                  "TEARDOWN,PLAY,PAUSE,GET_PARAMETER" );
+                    break;
+                }
+            }
 
-            if( ( cl->i_state == HTTPD_CLIENT_RECEIVING )
-                  || ( cl->i_state == HTTPD_CLIENT_TLS_HS_IN ) )
+            cl->i_buffer = -1;  /* Force the creation of the answer in
+                                 * httpd_ClientSend */
+            cl->i_state = HTTPD_CLIENT_SENDING;
+        }
+        else if( i_msg == HTTPD_MSG_NONE )
+        {
+            if( query->i_proto == HTTPD_PROTO_NONE )
             {
-                pufd->events = POLLIN;
+                cl->url = NULL;
+                cl->i_state = HTTPD_CLIENT_DEAD;
             }
-            else if( ( cl->i_state == HTTPD_CLIENT_SENDING )
-                  || ( cl->i_state == HTTPD_CLIENT_TLS_HS_OUT ) )
+            else
             {
-                pufd->events = POLLOUT;
+                char *p;
+
+                /* unimplemented */
+                answer->i_proto  = query->i_proto ;
+                answer->i_type   = HTTPD_MSG_ANSWER;
+                answer->i_version= 0;
+                answer->i_status = 501;
+
+                answer->i_body = httpd_HtmlError (&p, 501, NULL);
+                answer->p_body = (uint8_t *)p;
+                httpd_MsgAdd( answer, "Content-Length", "%d", answer->i_body );
+
+                cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
+                cl->i_state = HTTPD_CLIENT_SENDING;
             }
-            else if( cl->i_state == HTTPD_CLIENT_RECEIVE_DONE )
-            {
-                httpd_message_t *answer = &cl->answer;
-                httpd_message_t *query  = &cl->query;
-                int i_msg = query->i_type;
+        }
+        else
+        {
+            bool b_auth_failed = false;
+            bool b_hosts_failed = false;
 
-                httpd_MsgInit( answer );
+            /* Search the url and trigger callbacks */
+            for(int i = 0; i < host->i_url; i++ )
+            {
+                httpd_url_t *url = host->url[i];
 
-                /* Handle what we received */
-                if( i_msg == HTTPD_MSG_ANSWER )
-                {
-                    cl->url     = NULL;
-                    cl->i_state = HTTPD_CLIENT_DEAD;
-                }
-                else if( i_msg == HTTPD_MSG_OPTIONS )
+                if( !strcmp( url->psz_url, query->psz_url ) )
                 {
+                    if( url->catch[i_msg].cb )
+                    {
+                        if( answer && ( url->p_acl != NULL ) )
+                        {
+                            char ip[NI_MAXNUMERICHOST];
 
-                    answer->i_type   = HTTPD_MSG_ANSWER;
-                    answer->i_proto  = query->i_proto;
-                    answer->i_status = 200;
-                    answer->i_body = 0;
-                    answer->p_body = NULL;
+                            if( ( httpd_ClientIP( cl, ip, NULL ) == NULL )
+                             || ACL_Check( url->p_acl, ip ) )
+                            {
+                                b_hosts_failed = true;
+                                break;
+                            }
+                        }
 
-                    httpd_MsgAdd( answer, "Server", "VLC/%s", VERSION );
-                    httpd_MsgAdd( answer, "Content-Length", "0" );
+                        if( answer && ( *url->psz_user || *url->psz_password ) )
+                        {
+                            /* create the headers */
+                            const char *b64 = httpd_MsgGet( query, "Authorization" ); /* BASIC id */
+                            char *user = NULL, *pass = NULL;
 
-                    switch( query->i_proto )
-                    {
-                        case HTTPD_PROTO_HTTP:
-                            answer->i_version = 1;
-                            httpd_MsgAdd( answer, "Allow",
-                                          "GET,HEAD,POST,OPTIONS" );
-                            break;
+                            if( b64 != NULL
+                             && !strncasecmp( b64, "BASIC", 5 ) )
+                            {
+                                b64 += 5;
+                                while( *b64 == ' ' )
+                                    b64++;
 
-                        case HTTPD_PROTO_RTSP:
+                                user = vlc_b64_decode( b64 );
+                                if (user != NULL)
+                                {
+                                    pass = strchr (user, ':');
+                                    if (pass != NULL)
+                                        *pass++ = '\0';
+                                }
+                            }
+
+                            if ((user == NULL) || (pass == NULL)
+                             || strcmp (user, url->psz_user)
+                             || strcmp (pass, url->psz_password))
+                            {
+                                httpd_MsgAdd( answer,
+                                              "WWW-Authenticate",
+                                              "Basic realm=\"VLC stream\"" );
+                                /* We fail for all url */
+                                b_auth_failed = true;
+                                free( user );
+                                break;
+                            }
+
+                            free( user );
+                        }
+
+                        if( !url->catch[i_msg].cb( url->catch[i_msg].p_sys, cl, answer, query ) )
                         {
-                            const char *p;
-                            answer->i_version = 0;
-
-                            p = httpd_MsgGet( query, "Cseq" );
-                            if( p != NULL )
-                                httpd_MsgAdd( answer, "Cseq", "%s", p );
-                            p = httpd_MsgGet( query, "Timestamp" );
-                            if( p != NULL )
-                                httpd_MsgAdd( answer, "Timestamp", "%s", p );
-
-                            p = httpd_MsgGet( query, "Require" );
-                            if( p != NULL )
+                            if( answer->i_proto == HTTPD_PROTO_NONE )
                             {
-                                answer->i_status = 551;
-                                httpd_MsgAdd( query, "Unsupported", "%s", p );
+                                /* Raw answer from a CGI */
+                                cl->i_buffer = cl->i_buffer_size;
                             }
+                            else
+                                cl->i_buffer = -1;
 
-                            httpd_MsgAdd( answer, "Public", "DESCRIBE,SETUP,"
-                                          "TEARDOWN,PLAY,PAUSE,GET_PARAMETER" );
-                            break;
+                            /* only one url can answer */
+                            answer = NULL;
+                            if( cl->url == NULL )
+                            {
+                                cl->url = url;
+                            }
                         }
                     }
-
-                    cl->i_buffer = -1;  /* Force the creation of the answer in
-                                         * httpd_ClientSend */
-                    cl->i_state = HTTPD_CLIENT_SENDING;
                 }
-                else if( i_msg == HTTPD_MSG_NONE )
-                {
-                    if( query->i_proto == HTTPD_PROTO_NONE )
-                    {
-                        cl->url = NULL;
-                        cl->i_state = HTTPD_CLIENT_DEAD;
-                    }
-                    else
-                    {
-                        char *p;
+            }
 
-                        /* unimplemented */
-                        answer->i_proto  = query->i_proto ;
-                        answer->i_type   = HTTPD_MSG_ANSWER;
-                        answer->i_version= 0;
-                        answer->i_status = 501;
+            if( answer )
+            {
+                char *p;
 
-                        answer->i_body = httpd_HtmlError (&p, 501, NULL);
-                        answer->p_body = (uint8_t *)p;
-                        httpd_MsgAdd( answer, "Content-Length", "%d", answer->i_body );
+                answer->i_proto  = query->i_proto;
+                answer->i_type   = HTTPD_MSG_ANSWER;
+                answer->i_version= 0;
 
-                        cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
-                        cl->i_state = HTTPD_CLIENT_SENDING;
-                    }
+                if( b_hosts_failed )
+                {
+                    answer->i_status = 403;
+                }
+                else if( b_auth_failed )
+                {
+                    answer->i_status = 401;
                 }
                 else
                 {
-                    bool b_auth_failed = false;
-                    bool b_hosts_failed = false;
+                    /* no url registered */
+                    answer->i_status = 404;
+                }
 
-                    /* Search the url and trigger callbacks */
-                    for(int i = 0; i < host->i_url; i++ )
-                    {
-                        httpd_url_t *url = host->url[i];
+                answer->i_body = httpd_HtmlError (&p,
+                                                  answer->i_status,
+                                                  query->psz_url);
+                answer->p_body = (uint8_t *)p;
 
-                        if( !strcmp( url->psz_url, query->psz_url ) )
-                        {
-                            if( url->catch[i_msg].cb )
-                            {
-                                if( answer && ( url->p_acl != NULL ) )
-                                {
-                                    char ip[NI_MAXNUMERICHOST];
-
-                                    if( ( httpd_ClientIP( cl, ip, NULL ) == NULL )
-                                     || ACL_Check( url->p_acl, ip ) )
-                                    {
-                                        b_hosts_failed = true;
-                                        break;
-                                    }
-                                }
+                cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
+                httpd_MsgAdd( answer, "Content-Length", "%d", answer->i_body );
+                httpd_MsgAdd( answer, "Content-Type", "%s", "text/html" );
+            }
 
-                                if( answer && ( *url->psz_user || *url->psz_password ) )
-                                {
-                                    /* create the headers */
-                                    const char *b64 = httpd_MsgGet( query, "Authorization" ); /* BASIC id */
-                                    char *user = NULL, *pass = NULL;
-
-                                    if( b64 != NULL
-                                     && !strncasecmp( b64, "BASIC", 5 ) )
-                                    {
-                                        b64 += 5;
-                                        while( *b64 == ' ' )
-                                            b64++;
-
-                                        user = vlc_b64_decode( b64 );
-                                        if (user != NULL)
-                                        {
-                                            pass = strchr (user, ':');
-                                            if (pass != NULL)
-                                                *pass++ = '\0';
-                                        }
-                                    }
-
-                                    if ((user == NULL) || (pass == NULL)
-                                     || strcmp (user, url->psz_user)
-                                     || strcmp (pass, url->psz_password))
-                                    {
-                                        httpd_MsgAdd( answer,
-                                                      "WWW-Authenticate",
-                                                      "Basic realm=\"VLC stream\"" );
-                                        /* We fail for all url */
-                                        b_auth_failed = true;
-                                        free( user );
-                                        break;
-                                    }
-
-                                    free( user );
-                                }
+            cl->i_state = HTTPD_CLIENT_SENDING;
+        }
+    }
+    else if( cl->i_state == HTTPD_CLIENT_SEND_DONE )
+    {
+        if( !cl->b_stream_mode || cl->answer.i_body_offset == 0 )
+        {
+            const char *psz_connection = httpd_MsgGet( &cl->answer, "Connection" );
+            const char *psz_query = httpd_MsgGet( &cl->query, "Connection" );
+            bool b_connection = false;
+            bool b_keepalive = false;
+            bool b_query = false;
+
+            cl->url = NULL;
+            if( psz_connection )
+            {
+                b_connection = ( strcasecmp( psz_connection, "Close" ) == 0 );
+                b_keepalive = ( strcasecmp( psz_connection, "Keep-Alive" ) == 0 );
+            }
 
-                                if( !url->catch[i_msg].cb( url->catch[i_msg].p_sys, cl, answer, query ) )
-                                {
-                                    if( answer->i_proto == HTTPD_PROTO_NONE )
-                                    {
-                                        /* Raw answer from a CGI */
-                                        cl->i_buffer = cl->i_buffer_size;
-                                    }
-                                    else
-                                        cl->i_buffer = -1;
-
-                                    /* only one url can answer */
-                                    answer = NULL;
-                                    if( cl->url == NULL )
-                                    {
-                                        cl->url = url;
-                                    }
-                                }
-                            }
-                        }
-                    }
+            if( psz_query )
+            {
+                b_query = ( strcasecmp( psz_query, "Close" ) == 0 );
+            }
 
-                    if( answer )
-                    {
-                        char *p;
+            if( ( ( cl->query.i_proto == HTTPD_PROTO_HTTP ) &&
+                  ( ( cl->query.i_version == 0 && b_keepalive ) ||
+                    ( cl->query.i_version == 1 && !b_connection ) ) ) ||
+                ( ( cl->query.i_proto == HTTPD_PROTO_RTSP ) &&
+                  !b_query && !b_connection ) )
+            {
+                httpd_MsgClean( &cl->query );
+                httpd_MsgInit( &cl->query );
 
-                        answer->i_proto  = query->i_proto;
-                        answer->i_type   = HTTPD_MSG_ANSWER;
-                        answer->i_version= 0;
+                cl->i_buffer = 0;
+                cl->i_buffer_size = 1000;
+                httpd_ClientBufferRelease( cl );
+                cl->p_buffer = xmalloc( cl->i_buffer_size );
+                cl->i_state = HTTPD_CLIENT_RECEIVING;
+            }
+            else
+            {
+                cl->i_state = HTTPD_CLIENT_DEAD;
+            }
+            httpd_MsgClean( &cl->answer );
+        }
+        else
+        {
+            int64_t i_offset = cl->answer.i_body_offset;
+            httpd_MsgClean( &cl->answer );
 
-                        if( b_hosts_failed )
-                        {
-                            answer->i_status = 403;
-                        }
-                        else if( b_auth_failed )
-                        {
-                            answer->i_status = 401;
-                        }
-                        else
-                        {
-                            /* no url registered */
-                            answer->i_status = 404;
-                        }
+            cl->answer.i_body_offset = i_offset;
+            httpd_ClientBufferRelease( cl );
+            cl->i_buffer = 0;
+            cl->i_buffer_size = 0;
 
-                        answer->i_body = httpd_HtmlError (&p,
-                                                          answer->i_status,
-                                                          query->psz_url);
-                        answer->p_body = (uint8_t *)p;
+            cl->i_state = HTTPD_CLIENT_WAITING;
+        }
+    }
+    else if( cl->i_state == HTTPD_CLIENT_WAITING )
+    {
+        int64_t i_offset = cl->answer.i_body_offset;
+        int     i_msg = cl->query.i_type;
 
-                        cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
-                        httpd_MsgAdd( answer, "Content-Length", "%d", answer->i_body );
-                        httpd_MsgAdd( answer, "Content-Type", "%s", "text/html" );
-                    }
+        httpd_MsgInit( &cl->answer );
+        cl->answer.i_body_offset = i_offset;
 
-                    cl->i_state = HTTPD_CLIENT_SENDING;
-                }
-            }
-            else if( cl->i_state == HTTPD_CLIENT_SEND_DONE )
-            {
-                if( !cl->b_stream_mode || cl->answer.i_body_offset == 0 )
-                {
-                    const char *psz_connection = httpd_MsgGet( &cl->answer, "Connection" );
-                    const char *psz_query = httpd_MsgGet( &cl->query, "Connection" );
-                    bool b_connection = false;
-                    bool b_keepalive = false;
-                    bool b_query = false;
-
-                    cl->url = NULL;
-                    if( psz_connection )
-                    {
-                        b_connection = ( strcasecmp( psz_connection, "Close" ) == 0 );
-                        b_keepalive = ( strcasecmp( psz_connection, "Keep-Alive" ) == 0 );
-                    }
+        cl->url->catch[i_msg].cb( cl->url->catch[i_msg].p_sys, cl,
+                                  &cl->answer, &cl->query );
+        if( cl->answer.i_type != HTTPD_MSG_NONE )
+        {
+            /* we have new data, so re-enter send mode */
+            httpd_ClientTakeBody( cl );
+            cl->i_state = HTTPD_CLIENT_SENDING;
+        }
+    }
+    return events;
+}
 
-                    if( psz_query )
-                    {
-                        b_query = ( strcasecmp( psz_query, "Close" ) == 0 );
-                    }
+#ifdef HAVE_SYS_EPOLL_H
+/* Update what the worker polls for this client */
+static void httpd_WorkerPoll( httpd_worker_t *worker, httpd_client_t *cl,
+                              short events )
+{
+    struct epoll_event ev;
 
-                    if( ( ( cl->query.i_proto == HTTPD_PROTO_HTTP ) &&
-                          ( ( cl->query.i_version == 0 && b_keepalive ) ||
-                            ( cl->query.i_version == 1 && !b_connection ) ) ) ||
-                        ( ( cl->query.i_proto == HTTPD_PROTO_RTSP ) &&
-                          !b_query && !b_connection ) )
-                    {
-                        httpd_MsgClean( &cl->query );
-                        httpd_MsgInit( &cl->query );
-
-                        cl->i_buffer = 0;
-                        cl->i_buffer_size = 1000;
-                        free( cl->p_buffer );
-                        cl->p_buffer = xmalloc( cl->i_buffer_size );
-                        cl->i_state = HTTPD_CLIENT_RECEIVING;
-                    }
-                    else
-                    {
-                        cl->i_state = HTTPD_CLIENT_DEAD;
-                    }
-                    httpd_MsgClean( &cl->answer );
-                }
-                else
-                {
-                    int64_t i_offset = cl->answer.i_body_offset;
-                    httpd_MsgClean( &cl->answer );
+    if( events == cl->i_events )
+        return;
 
-                    cl->answer.i_body_offset = i_offset;
-                    free( cl->p_buffer );
-                    cl->p_buffer = NULL;
-                    cl->i_buffer = 0;
-                    cl->i_buffer_size = 0;
+    ev.events = ( ( events & POLLIN ) ? EPOLLIN : 0 )
+              | ( ( events & POLLOUT ) ? EPOLLOUT : 0 );
+    ev.data.ptr = cl;
+    if( epoll_ctl( worker->epfd, EPOLL_CTL_MOD, cl->fd, &ev ) == 0 )
+        cl->i_events = events;
+}
 
-                    cl->i_state = HTTPD_CLIENT_WAITING;
-                }
+static bool httpd_IsListener( const httpd_host_t *host, const void *ptr )
+{
+    return ptr >= (const void *)host->fds
+        && ptr < (const void *)( host->fds + host->nfd );
+}
+
+static void httpd_WorkerWake( httpd_worker_t *worker )
+{
+    uint8_t dummy = 0;
+
+    /* The pipe is non-blocking: if it is full, the worker is woken anyway */
+    ssize_t val = write( worker->wakefd[1], &dummy, 1 );
+    VLC_UNUSED( val );
+}
+#endif
+
+/* Remove a client from its worker, host lock held */
+static void httpd_WorkerRemove( httpd_worker_t *worker, httpd_client_t *cl )
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if( cl->fd >= 0 )
+        epoll_ctl( worker->epfd, EPOLL_CTL_DEL, cl->fd, NULL );
+#endif
+    httpd_ClientClean( cl );
+    TAB_REMOVE( worker->i_client, worker->client, cl );
+    free( cl );
+}
+
+/* Give a new connection to the worker with the fewest clients */
+static bool httpd_HostAccept( httpd_host_t *host, int fd, mtime_t now )
+{
+    httpd_client_t *cl;
+    int i_state = -1;
+
+    /* */
+    fd = vlc_accept (fd, NULL, NULL, true);
+    if (fd == -1)
+        return false;
+    setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
+                &(int){ 1 }, sizeof(int));
+
+    vlc_tls_t *p_tls;
+
+    if( host->p_tls != NULL )
+    {
+        p_tls = vlc_tls_ServerSessionCreate( host->p_tls, fd );
+        switch( vlc_tls_ServerSessionHandshake( p_tls ) )
+        {
+            case -1:
+                msg_Err( host, "Rejecting TLS connection" );
+                /* p_tls is destroyed implicitly */
+                net_Close( fd );
+                return false;
+
+            case 1: /* missing input - most likely */
+                i_state = HTTPD_CLIENT_TLS_HS_IN;
+                break;
+
+            case 2: /* missing output */
+                i_state = HTTPD_CLIENT_TLS_HS_OUT;
+                break;
+        }
+    }
+    else
+        p_tls = NULL;
+
+    cl = httpd_ClientNew( fd, p_tls, now );
+    if( cl == NULL )
+    {
+        if( p_tls != NULL )
+            vlc_tls_ServerSessionDelete( p_tls );
+        net_Close( fd );
+        return false;
+    }
+    if( i_state != -1 )
+        cl->i_state = i_state; // override state for TLS
+
+    vlc_mutex_lock( &host->lock );
+    httpd_worker_t *worker = &host->worker[0];
+    for( unsigned i = 1; i < host->nworker; i++ )
+        if( host->worker[i].i_client < worker->i_client )
+            worker = &host->worker[i];
+
+#ifdef HAVE_SYS_EPOLL_H
+    /* The client fd wakes the worker up as soon as it has something to do */
+    struct epoll_event ev;
+    ev.events = ( cl->i_state == HTTPD_CLIENT_TLS_HS_OUT ) ? EPOLLOUT : EPOLLIN;
+    ev.data.ptr = cl;
+    if( epoll_ctl( worker->epfd, EPOLL_CTL_ADD, fd, &ev ) )
+    {
+        vlc_mutex_unlock( &host->lock );
+        msg_Err( host, "cannot poll connection: %m" );
+        httpd_ClientClean( cl );
+        free( cl );
+        return false;
+    }
+    cl->i_events = ( ev.events & EPOLLOUT ) ? POLLOUT : POLLIN;
+#endif
+    TAB_APPEND( worker->i_client, worker->client, cl );
+    vlc_mutex_unlock( &host->lock );
+    return true;
+}
+
+/* Handle an event on a client socket, host lock held */
+static void httpd_ClientEvent( httpd_client_t *cl, mtime_t now )
+{
+    cl->i_activity_date = now;
+
+    if( cl->i_state == HTTPD_CLIENT_RECEIVING )
+    {
+        httpd_ClientRecv( cl );
+    }
+    else if( cl->i_state == HTTPD_CLIENT_SENDING )
+    {
+        httpd_ClientSend( cl );
+    }
+    else if( cl->i_state == HTTPD_CLIENT_TLS_HS_IN )
+    {
+        httpd_ClientTlsHsIn( cl );
+    }
+    else if( cl->i_state == HTTPD_CLIENT_TLS_HS_OUT )
+    {
+        httpd_ClientTlsHsOut( cl );
+    }
+}
+
+static void* httpd_WorkerThread( void *data )
+{
+    httpd_worker_t *worker = data;
+    httpd_host_t *host = worker->host;
+    counter_t *p_total_counter = stats_CounterCreate( host, VLC_VAR_INTEGER, STATS_COUNTER );
+    counter_t *p_active_counter = stats_CounterCreate( host, VLC_VAR_INTEGER, STATS_COUNTER );
+#ifndef HAVE_SYS_EPOLL_H
+    int evfd = vlc_object_waitpipe( VLC_OBJECT( host ) );
+    const unsigned nlisten = host->nfd;
+#endif
+
+    for( ;; )
+    {
+#ifndef HAVE_SYS_EPOLL_H
+        /* Only this thread adds clients (there is a single worker) */
+        struct pollfd ufd[nlisten + worker->i_client + 1];
+        unsigned nfd;
+        for( nfd = 0; nfd < nlisten; nfd++ )
+        {
+            ufd[nfd].fd = host->fds[nfd];
+            ufd[nfd].events = POLLIN;
+            ufd[nfd].revents = 0;
+        }
+#endif
+
+        /* add all socket that should be read/write and close dead connection */
+        vlc_mutex_lock( &host->lock );
+        while( host->i_url <= 0 && host->i_ref > 0 )
+            vlc_cond_wait( &host->wait, &host->lock );
+
+        mtime_t now = mdate();
+        bool b_low_delay = false;
+
+        for(int i_client = 0; i_client < worker->i_client; i_client++ )
+        {
+            httpd_client_t *cl = worker->client[i_client];
+            if( cl->i_ref < 0 || ( cl->i_ref == 0 &&
+                ( cl->i_state == HTTPD_CLIENT_DEAD ||
+                  ( cl->i_activity_timeout > 0 &&
+                    cl->i_activity_date+cl->i_activity_timeout < now) ) ) )
+            {
+                httpd_WorkerRemove( worker, cl );
+                stats_UpdateInteger( host, p_active_counter, -1, NULL );
+                i_client--;
+                continue;
             }
-            else if( cl->i_state == HTTPD_CLIENT_WAITING )
+
+            short events = httpd_ClientPrepare( host, cl );
+#ifdef HAVE_SYS_EPOLL_H
+            httpd_WorkerPoll( worker, cl, events );
+#else
+            if( events != 0 )
             {
-                int64_t i_offset = cl->answer.i_body_offset;
-                int     i_msg = cl->query.i_type;
+                struct pollfd *pufd = ufd + nfd++;
+                assert (pufd < ufd + (sizeof (ufd) / sizeof (ufd[0])));
 
-                httpd_MsgInit( &cl->answer );
-                cl->answer.i_body_offset = i_offset;
+                pufd->fd = cl->fd;
+                pufd->events = events;
+                pufd->revents = 0;
+            }
+#endif
+            if( events == 0 )
+                b_low_delay = true;
+        }
+        vlc_mutex_unlock( &host->lock );
 
-                cl->url->catch[i_msg].cb( cl->url->catch[i_msg].p_sys, cl,
-                                          &cl->answer, &cl->query );
-                if( cl->answer.i_type != HTTPD_MSG_NONE )
-                {
-                    /* we have new data, so re-enter send mode */
-                    cl->i_buffer      = 0;
-                    cl->p_buffer      = cl->answer.p_body;
-                    cl->i_buffer_size = cl->answer.i_body;
-                    cl->answer.p_body = NULL;
-                    cl->answer.i_body = 0;
-                    cl->i_state = HTTPD_CLIENT_SENDING;
-                }
+#ifdef HAVE_SYS_EPOLL_H
+        struct epoll_event ev[HTTPD_MAX_EVENTS];
+        int n;
+
+        /* we will wait 20ms (not too big) if HTTPD_CLIENT_WAITING */
+        n = epoll_wait( worker->epfd, ev, HTTPD_MAX_EVENTS, b_low_delay ? 20 : -1 );
+        if( n == -1 )
+        {
+            if (errno != EINTR)
+            {
+                /* Kernel on low memory or a bug: pace */
+                msg_Err( host, "polling error: %m" );
+                msleep( 100000 );
             }
+            continue;
+        }
 
-            if (pufd->events != 0)
-                nfd++;
-            else
-                b_low_delay = true;
+        bool b_die = false;
+        now = mdate();
+        vlc_mutex_lock( &host->lock );
+        for( int i = 0; i < n; i++ )
+        {
+            void *ptr = ev[i].data.ptr;
+
+            if( ptr == host )
+                b_die = true;
+            else if( ptr == worker )
+            {
+                uint8_t buf[64];
+                while( read( worker->wakefd[0], buf, sizeof( buf ) ) > 0 );
+            }
+            else if( !httpd_IsListener( host, ptr ) )
+            {
+                httpd_client_t *cl = ptr;
+
+                if( cl->i_events == 0 )
+                    /* Error or hang-up while waiting for nothing */
+                    cl->i_state = HTTPD_CLIENT_DEAD;
+                else
+                    httpd_ClientEvent( cl, now );
+            }
         }
         vlc_mutex_unlock( &host->lock );
+        if( b_die )
+            break;
 
+        /* Handle server sockets (accept new connections) */
+        for( int i = 0; i < n; i++ )
+        {
+            int *pfd = ev[i].data.ptr;
+
+            if( httpd_IsListener( host, pfd ) && httpd_HostAccept( host, *pfd, now ) )
+            {
+                stats_UpdateInteger( host, p_total_counter, 1, NULL );
+                stats_UpdateInteger( host, p_active_counter, 1, NULL );
+            }
+        }
+#else
         ufd[nfd].fd = evfd;
         ufd[nfd].events = POLLIN;
         ufd[nfd].revents = 0;
@@ -2407,10 +3187,10 @@ static void* httpd_HostThread( void *data )
         /* Handle client sockets */
         vlc_mutex_lock( &host->lock );
         now = mdate();
-        nfd = host->nfd;
-        for( int i_client = 0; i_client < host->i_client; i_client++ )
+        nfd = nlisten;
+        for( int i_client = 0; i_client < worker->i_client; i_client++ )
         {
-            httpd_client_t *cl = host->client[i_client];
+            httpd_client_t *cl = worker->client[i_client];
             const struct pollfd *pufd = &ufd[nfd];
 
             assert( pufd < &ufd[sizeof(ufd) / sizeof(ufd[0])] );
@@ -2421,83 +3201,25 @@ static void* httpd_HostThread( void *data )
             if( pufd->revents == 0 )
                 continue; // no event received
 
-            cl->i_activity_date = now;
-
-            if( cl->i_state == HTTPD_CLIENT_RECEIVING )
-            {
-                httpd_ClientRecv( cl );
-            }
-            else if( cl->i_state == HTTPD_CLIENT_SENDING )
-            {
-                httpd_ClientSend( cl );
-            }
-            else if( cl->i_state == HTTPD_CLIENT_TLS_HS_IN )
-            {
-                httpd_ClientTlsHsIn( cl );
-            }
-            else if( cl->i_state == HTTPD_CLIENT_TLS_HS_OUT )
-            {
-                httpd_ClientTlsHsOut( cl );
-            }
+            httpd_ClientEvent( cl, now );
         }
         vlc_mutex_unlock( &host->lock );
 
         /* Handle server sockets (accept new connections) */
-        for( nfd = 0; nfd < host->nfd; nfd++ )
+        for( nfd = 0; nfd < nlisten; nfd++ )
         {
-            httpd_client_t *cl;
-            int i_state = -1;
-            int fd = ufd[nfd].fd;
-
-            assert (fd == host->fds[nfd]);
+            assert (ufd[nfd].fd == host->fds[nfd]);
 
             if( ufd[nfd].revents == 0 )
                 continue;
 
-            /* */
-            fd = vlc_accept (fd, NULL, NULL, true);
-            if (fd == -1)
-                continue;
-            setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
-                        &(int){ 1 }, sizeof(int));
-
-            vlc_tls_t *p_tls;
-
-            if( host->p_tls != NULL )
+            if( httpd_HostAccept( host, ufd[nfd].fd, now ) )
             {
-                p_tls = vlc_tls_ServerSessionCreate( host->p_tls, fd );
-                switch( vlc_tls_ServerSessionHandshake( p_tls ) )
-                {
-                    case -1:
-                        msg_Err( host, "Rejecting TLS connection" );
-                        /* p_tls is destroyed implicitly */
-                        net_Close( fd );
-                        fd = -1;
-                        p_tls = NULL;
-                        continue;
-
-                    case 1: /* missing input - most likely */
-                        i_state = HTTPD_CLIENT_TLS_HS_IN;
-                        break;
-
-                    case 2: /* missing output */
-                        i_state = HTTPD_CLIENT_TLS_HS_OUT;
-                        break;
-                }
+                stats_UpdateInteger( host, p_total_counter, 1, NULL );
+                stats_UpdateInteger( host, p_active_counter, 1, NULL );
             }
-            else
-                p_tls = NULL;
-
-            stats_UpdateInteger( host, p_total_counter, 1, NULL );
-            stats_UpdateInteger( host, p_active_counter, 1, NULL );
-            cl = httpd_ClientNew( fd, p_tls, now );
-            vlc_mutex_lock( &host->lock );
-            TAB_APPEND( host->i_client, host->client, cl );
-            vlc_mutex_unlock( &host->lock );
-            if( i_state != -1 )
-                cl->i_state = i_state; // override state for TLS
         }
-
+#endif
     }
 
     if( p_total_counter )
@@ -198,14 +198,17 @@ static int PlaylistVAControl( playlist_t * p_playlist, int i_query, va_list args
 /*****************************************************************************
  * Preparse control
  *****************************************************************************/
-/** Enqueue an item for preparsing */
+/** Enqueue an item for preparsing
+ *
+ * The item is preparsed before the ones added to the playlist, as it is
+ * likely shown to the user. */
 int playlist_PreparseEnqueue( playlist_t *p_playlist, input_item_t *p_item )
 {
     playlist_private_t *p_sys = pl_priv(p_playlist);
 
     if( unlikely(p_sys->p_preparser == NULL) )
         return VLC_ENOMEM;
-    playlist_preparser_Push( p_sys->p_preparser, p_item );
+    playlist_preparser_Push( p_sys->p_preparser, p_item, true );
     return VLC_SUCCESS;
 }
 
@@ -215,7 +218,7 @@ int playlist_AskForArtEnqueue( playlist_t *p_playlist, input_item_t *p_item )
 
     if( unlikely(p_sys->p_fetcher == NULL) )
         return VLC_ENOMEM;
-    playlist_fetcher_Push( p_sys->p_fetcher, p_item );
+    playlist_fetcher_Push( p_sys->p_fetcher, p_item, true );
     return VLC_SUCCESS;
 }
 
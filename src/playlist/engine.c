@@ -203,18 +203,24 @@ playlist_t * playlist_Create( vlc_object_t *p_parent )
     pl_priv(p_playlist)->b_auto_preparse =
         var_InheritBool( p_parent, "auto-preparse" );
 
-    /* Fetcher */
-    p->p_fetcher = playlist_fetcher_New( p_playlist );
-    if( unlikely(p->p_fetcher == NULL) )
-    {
-        msg_Err( p_playlist, "cannot create fetcher" );
-        p->p_preparser = NULL;
-    }
+    /* Threads shared by the fetcher and the preparser */
+    p->p_pool = playlist_pool_New( p_playlist );
+    p->p_fetcher = NULL;
+    p->p_preparser = NULL;
+    if( unlikely(p->p_pool == NULL) )
+        msg_Err( p_playlist, "cannot create pre-parser threads" );
     else
-    {   /* Preparse */
-        p->p_preparser = playlist_preparser_New( p_playlist, p->p_fetcher );
-        if( unlikely(p->p_preparser == NULL) )
-            msg_Err( p_playlist, "cannot create preparser" );
+    {   /* Fetcher */
+        p->p_fetcher = playlist_fetcher_New( p_playlist, p->p_pool );
+        if( unlikely(p->p_fetcher == NULL) )
+            msg_Err( p_playlist, "cannot create fetcher" );
+        else
+        {   /* Preparse */
+            p->p_preparser = playlist_preparser_New( p_playlist, p->p_pool,
+                                                     p->p_fetcher );
+            if( unlikely(p->p_preparser == NULL) )
+                msg_Err( p_playlist, "cannot create preparser" );
+        }
     }
 
     /* Create the root node */
@@ -291,6 +297,8 @@ void playlist_Destroy( playlist_t *p_playlist )
         playlist_preparser_Delete( p_sys->p_preparser );
     if( p_sys->p_fetcher )
         playlist_fetcher_Delete( p_sys->p_fetcher );
+    if( p_sys->p_pool )
+        playlist_pool_Delete( p_sys->p_pool );
 
     /* Already cleared when deactivating (if activated anyway) */
     assert( !p_sys->p_input );
@@ -37,6 +37,7 @@
 #include <vlc_modules.h>
 
 #include "art.h"
+#include "pool.h"
 #include "fetcher.h"
 #include "playlist_internal.h"
 
@@ -46,35 +47,30 @@
 struct playlist_fetcher_t
 {
     playlist_t      *p_playlist;
+    playlist_pool_t *p_pool;
 
     vlc_mutex_t     lock;
-    vlc_cond_t      wait;
-    bool            b_live;
     int             i_art_policy;
-    int             i_waiting;
-    input_item_t    **pp_waiting;
 
-    DECL_ARRAY(playlist_album_t) albums;
+    DECL_ARRAY(playlist_album_t) albums;    /* protected by lock */
 };
 
-static void *Thread( void * );
+static void Job( void *, input_item_t *, playlist_job_t * );
 
 
 /*****************************************************************************
  * Public functions
  *****************************************************************************/
-playlist_fetcher_t *playlist_fetcher_New( playlist_t *p_playlist )
+playlist_fetcher_t *playlist_fetcher_New( playlist_t *p_playlist,
+                                          playlist_pool_t *p_pool )
 {
     playlist_fetcher_t *p_fetcher = malloc( sizeof(*p_fetcher) );
     if( !p_fetcher )
         return NULL;
 
     p_fetcher->p_playlist = p_playlist;
+    p_fetcher->p_pool = p_pool;
     vlc_mutex_init( &p_fetcher->lock );
-    vlc_cond_init( &p_fetcher->wait );
-    p_fetcher->b_live = false;
-    p_fetcher->i_waiting = 0;
-    p_fetcher->pp_waiting = NULL;
     p_fetcher->i_art_policy = var_GetInteger( p_playlist, "album-art" );
     ARRAY_INIT( p_fetcher->albums );
 
@@ -82,40 +78,17 @@ playlist_fetcher_t *playlist_fetcher_New( playlist_t *p_playlist )
 }
 
 void playlist_fetcher_Push( playlist_fetcher_t *p_fetcher,
-                            input_item_t *p_item )
+                            input_item_t *p_item, bool b_visible )
 {
-    vlc_gc_incref( p_item );
-
-    vlc_mutex_lock( &p_fetcher->lock );
-    INSERT_ELEM( p_fetcher->pp_waiting, p_fetcher->i_waiting,
-                 p_fetcher->i_waiting, p_item );
-    if( !p_fetcher->b_live )
-    {
-        if( vlc_clone_detach( NULL, Thread, p_fetcher,
-                              VLC_THREAD_PRIORITY_LOW ) )
-            msg_Err( p_fetcher->p_playlist,
-                     "cannot spawn secondary preparse thread" );
-        else
-            p_fetcher->b_live = true;
-    }
-    vlc_mutex_unlock( &p_fetcher->lock );
+    playlist_pool_Push( p_fetcher->p_pool, Job, p_fetcher, p_item,
+                        b_visible, 0 );
 }
 
 void playlist_fetcher_Delete( playlist_fetcher_t *p_fetcher )
 {
-    vlc_mutex_lock( &p_fetcher->lock );
-    /* Remove any left-over item, the fetcher will exit */
-    while( p_fetcher->i_waiting > 0 )
-    {
-        vlc_gc_decref( p_fetcher->pp_waiting[0] );
-        REMOVE_ELEM( p_fetcher->pp_waiting, p_fetcher->i_waiting, 0 );
-    }
-
-    while( p_fetcher->b_live )
-        vlc_cond_wait( &p_fetcher->wait, &p_fetcher->lock );
-    vlc_mutex_unlock( &p_fetcher->lock );
+    /* Remove any left-over item, and wait for the running ones */
+    playlist_pool_Cancel( p_fetcher->p_pool, p_fetcher );
 
-    vlc_cond_destroy( &p_fetcher->wait );
     vlc_mutex_destroy( &p_fetcher->lock );
     free( p_fetcher );
 }
@@ -149,6 +122,7 @@ static int FindArt( playlist_fetcher_t *p_fetcher, input_item_t *p_item )
     /* If we already checked this album in this session, skip */
     if( psz_artist && psz_album )
     {
+        vlc_mutex_lock( &p_fetcher->lock );
         FOREACH_ARRAY( playlist_album_t album, p_fetcher->albums )
             if( !strcmp( album.psz_artist, psz_artist ) &&
                 !strcmp( album.psz_album, psz_album ) )
@@ -165,14 +139,17 @@ static int FindArt( playlist_fetcher_t *p_fetcher, input_item_t *p_item )
                         input_item_SetArtURL( p_item, album.psz_arturl );
                     else /* Actually get URL from cache */
                         playlist_FindArtInCache( p_item );
+                    vlc_mutex_unlock( &p_fetcher->lock );
                     return 0;
                 }
                 else
                 {
+                    vlc_mutex_unlock( &p_fetcher->lock );
                     return VLC_EGENERIC;
                 }
             }
         FOREACH_END();
+        vlc_mutex_unlock( &p_fetcher->lock );
     }
     free( psz_artist );
     free( psz_album );
@@ -246,7 +223,9 @@ static int FindArt( playlist_fetcher_t *p_fetcher, input_item_t *p_item )
         a.psz_album = psz_album;
         a.psz_arturl = input_item_GetArtURL( p_item );
         a.b_found = (i_ret == VLC_EGENERIC ? false : true );
+        vlc_mutex_lock( &p_fetcher->lock );
         ARRAY_APPEND( p_fetcher->albums, a );
+        vlc_mutex_unlock( &p_fetcher->lock );
     }
     else
     {
@@ -401,62 +380,38 @@ exit:
     vlc_object_release( p_input );
 }
 
-static void *Thread( void *p_data )
+static void Job( void *p_owner, input_item_t *p_item, playlist_job_t *p_job )
 {
-    playlist_fetcher_t *p_fetcher = p_data;
+    playlist_fetcher_t *p_fetcher = p_owner;
     playlist_t *p_playlist = p_fetcher->p_playlist;
+    VLC_UNUSED(p_job);
 
-    for( ;; )
-    {
-        input_item_t *p_item = NULL;
-
-        vlc_mutex_lock( &p_fetcher->lock );
-        if( p_fetcher->i_waiting != 0 )
-        {
-            p_item = p_fetcher->pp_waiting[0];
-            REMOVE_ELEM( p_fetcher->pp_waiting, p_fetcher->i_waiting, 0 );
-        }
-        else
-        {
-            p_fetcher->b_live = false;
-            vlc_cond_signal( &p_fetcher->wait );
-        }
-        vlc_mutex_unlock( &p_fetcher->lock );
-
-        if( !p_item )
-            break;
-
-        /* */
+    /* Wait that the input item is preparsed if it is being played */
+    WaitPreparsed( p_fetcher, p_item );
 
-        /* Wait that the input item is preparsed if it is being played */
-        WaitPreparsed( p_fetcher, p_item );
+    /* Triggers "meta fetcher", eventually fetch meta on the network.
+     * They are identical to "meta reader" expect that may actually
+     * takes time. That's why they are running here.
+     * The result of this fetch is not cached. */
+    FetchMeta( p_fetcher, p_item );
 
-        /* Triggers "meta fetcher", eventually fetch meta on the network.
-         * They are identical to "meta reader" expect that may actually
-         * takes time. That's why they are running here.
-         * The result of this fetch is not cached. */
-        FetchMeta( p_fetcher, p_item );
+    /* Find art, and download it if needed */
+    int i_ret = FindArt( p_fetcher, p_item );
+    if( i_ret == 1 )
+        i_ret = DownloadArt( p_fetcher, p_item );
 
-        /* Find art, and download it if needed */
-        int i_ret = FindArt( p_fetcher, p_item );
-        if( i_ret == 1 )
-            i_ret = DownloadArt( p_fetcher, p_item );
-
-        /* */
-        char *psz_name = input_item_GetName( p_item );
-        if( !i_ret ) /* Art is now in cache */
-        {
-            PL_DEBUG( "found art for %s in cache", psz_name );
-            input_item_SetArtFetched( p_item, true );
-            var_SetAddress( p_playlist, "item-change", p_item );
-        }
-        else
-        {
-            PL_DEBUG( "art not found for %s", psz_name );
-            input_item_SetArtNotFound( p_item, true );
-        }
-        free( psz_name );
-        vlc_gc_decref( p_item );
+    /* */
+    char *psz_name = input_item_GetName( p_item );
+    if( !i_ret ) /* Art is now in cache */
+    {
+        PL_DEBUG( "found art for %s in cache", psz_name );
+        input_item_SetArtFetched( p_item, true );
+        var_SetAddress( p_playlist, "item-change", p_item );
+    }
+    else
+    {
+        PL_DEBUG( "art not found for %s", psz_name );
+        input_item_SetArtNotFound( p_item, true );
     }
-    return NULL;
+    free( psz_name );
 }
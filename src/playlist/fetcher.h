@@ -34,20 +34,23 @@
 typedef struct playlist_fetcher_t playlist_fetcher_t;
 
 /**
- * This function creates the fetcher object and thread.
+ * This function creates the fetcher object. It runs in the threads of the
+ * given pool.
  */
-playlist_fetcher_t *playlist_fetcher_New( playlist_t * );
+playlist_fetcher_t *playlist_fetcher_New( playlist_t *, playlist_pool_t * );
 
 /**
  * This function enqueues the provided item to be art fetched.
  *
  * The input item is retained until the art fetching is done or until the
  * fetcher object is destroyed.
+ * Visible items are fetched before the others.
  */
-void playlist_fetcher_Push( playlist_fetcher_t *, input_item_t * );
+void playlist_fetcher_Push( playlist_fetcher_t *, input_item_t *,
+                            bool b_visible );
 
 /**
- * This function destroys the fetcher object and thread.
+ * This function destroys the fetcher object.
  *
  * All pending input items will be released.
  */
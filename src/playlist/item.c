@@ -741,10 +741,12 @@ static void GoAndPreparse( playlist_t *p_playlist, int i_mode,
     char *psz_artist = input_item_GetArtist( p_item->p_input );
     char *psz_album = input_item_GetAlbum( p_item->p_input );
     if( pl_priv(p_playlist)->b_auto_preparse &&
+        pl_priv(p_playlist)->p_preparser != NULL &&
         input_item_IsPreparsed( p_item->p_input ) == false &&
             ( EMPTY_STR( psz_artist ) || ( EMPTY_STR( psz_album ) ) )
           )
-        playlist_PreparseEnqueue( p_playlist, p_item->p_input );
+        playlist_preparser_Push( pl_priv(p_playlist)->p_preparser,
+                                 p_item->p_input, false );
     free( psz_artist );
     free( psz_album );
 }
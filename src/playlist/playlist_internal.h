@@ -38,6 +38,7 @@
 #include <assert.h>
 
 #include "art.h"
+#include "pool.h"
 #include "fetcher.h"
 #include "preparser.h"
 
@@ -46,6 +47,7 @@ typedef struct vlc_sd_internal_t vlc_sd_internal_t;
 typedef struct playlist_private_t
 {
     playlist_t           public_data;
+    playlist_pool_t      *p_pool;       /**< Preparser and fetcher threads */
     playlist_preparser_t *p_preparser;  /**< Preparser data */
     playlist_fetcher_t   *p_fetcher;    /**< Meta and art fetcher data */
 
@@ -0,0 +1,315 @@
+/*****************************************************************************
+ * pool.c: Preparser and fetcher worker threads
+ *****************************************************************************
+ * Copyright (C) 2012 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_playlist.h>
+
+#include "pool.h"
+#include "../input/input_interface.h"
+
+/* Once timed out, the input is stopped again at this interval, so that
+ * the objects it opens afterwards are stopped too */
+#define POOL_KILL_INTERVAL (CLOCK_FREQ/10)
+
+/*****************************************************************************
+ * Structures/definitions
+ *****************************************************************************/
+struct playlist_job_t
+{
+    playlist_pool_t *p_pool;
+    playlist_job_cb  pf_run;
+    void            *p_owner;
+    input_item_t    *p_item;
+    mtime_t          i_timeout;
+
+    input_thread_t  *p_input;   /* watched input, protected by the pool lock */
+    bool             b_killed;
+};
+
+struct playlist_pool_t
+{
+    playlist_t      *p_playlist;
+
+    vlc_mutex_t     lock;
+    vlc_cond_t      wait;
+    int             i_threads;      /* threads taking jobs */
+    int             i_exiting;      /* threads about to exit */
+    int             i_max_threads;
+
+    int             i_waiting;
+    playlist_job_t  **pp_waiting;
+    int             i_running;
+    playlist_job_t  **pp_running;
+};
+
+static void *Thread( void * );
+
+/*****************************************************************************
+ * Public functions
+ *****************************************************************************/
+playlist_pool_t *playlist_pool_New( playlist_t *p_playlist )
+{
+    playlist_pool_t *p_pool = malloc( sizeof(*p_pool) );
+    if( !p_pool )
+        return NULL;
+
+    p_pool->p_playlist = p_playlist;
+    vlc_mutex_init( &p_pool->lock );
+    vlc_cond_init( &p_pool->wait );
+    p_pool->i_threads = 0;
+    p_pool->i_exiting = 0;
+    p_pool->i_max_threads = var_InheritInteger( p_playlist, "preparse-threads" );
+    if( p_pool->i_max_threads < 1 )
+        p_pool->i_max_threads = 1;
+    p_pool->i_waiting = 0;
+    p_pool->pp_waiting = NULL;
+    p_pool->i_running = 0;
+    p_pool->pp_running = NULL;
+
+    return p_pool;
+}
+
+void playlist_pool_Delete( playlist_pool_t *p_pool )
+{
+    vlc_mutex_lock( &p_pool->lock );
+    assert( p_pool->i_waiting == 0 && p_pool->i_running == 0 );
+    while( p_pool->i_threads > 0 || p_pool->i_exiting > 0 )
+        vlc_cond_wait( &p_pool->wait, &p_pool->lock );
+    vlc_mutex_unlock( &p_pool->lock );
+
+    vlc_cond_destroy( &p_pool->wait );
+    vlc_mutex_destroy( &p_pool->lock );
+    free( p_pool );
+}
+
+void playlist_pool_Push( playlist_pool_t *p_pool, playlist_job_cb pf_run,
+                         void *p_owner, input_item_t *p_item, bool b_front,
+                         mtime_t i_timeout )
+{
+    playlist_job_t *p_job = malloc( sizeof(*p_job) );
+    if( !p_job )
+        return;
+
+    p_job->p_pool = p_pool;
+    p_job->pf_run = pf_run;
+    p_job->p_owner = p_owner;
+    p_job->p_item = p_item;
+    p_job->i_timeout = i_timeout;
+    p_job->p_input = NULL;
+    p_job->b_killed = false;
+    vlc_gc_incref( p_item );
+
+    vlc_mutex_lock( &p_pool->lock );
+    if( b_front )
+    {
+        /* Do not preparse the same item twice if it was already queued */
+        for( int i = 0; i < p_pool->i_waiting; i++ )
+        {
+            playlist_job_t *p_old = p_pool->pp_waiting[i];
+            if( p_old->p_item == p_item && p_old->pf_run == pf_run
+             && p_old->p_owner == p_owner )
+            {
+                REMOVE_ELEM( p_pool->pp_waiting, p_pool->i_waiting, i );
+                vlc_gc_decref( p_old->p_item );
+                free( p_old );
+                break;
+            }
+        }
+        INSERT_ELEM( p_pool->pp_waiting, p_pool->i_waiting, 0, p_job );
+    }
+    else
+        INSERT_ELEM( p_pool->pp_waiting, p_pool->i_waiting,
+                     p_pool->i_waiting, p_job );
+
+    /* Spawn a thread unless an idle one will take the job */
+    if( p_pool->i_threads - p_pool->i_running < p_pool->i_waiting
+     && p_pool->i_threads < p_pool->i_max_threads )
+    {
+        if( vlc_clone_detach( NULL, Thread, p_pool,
+                              VLC_THREAD_PRIORITY_LOW ) )
+            msg_Warn( p_pool->p_playlist, "cannot spawn pre-parser thread" );
+        else
+            p_pool->i_threads++;
+    }
+    vlc_mutex_unlock( &p_pool->lock );
+}
+
+/* Stops the watched input of a job. The pool lock must be held. */
+static void Kill( playlist_job_t *p_job )
+{
+    p_job->b_killed = true;
+    if( p_job->p_input )
+        input_StopPreparser( p_job->p_input );
+}
+
+void playlist_pool_Cancel( playlist_pool_t *p_pool, void *p_owner )
+{
+    vlc_mutex_lock( &p_pool->lock );
+    /* Remove pending jobs to speed up the exit */
+    for( int i = 0; i < p_pool->i_waiting; )
+    {
+        playlist_job_t *p_job = p_pool->pp_waiting[i];
+        if( p_job->p_owner != p_owner )
+        {
+            i++;
+            continue;
+        }
+        REMOVE_ELEM( p_pool->pp_waiting, p_pool->i_waiting, i );
+        vlc_gc_decref( p_job->p_item );
+        free( p_job );
+    }
+
+    for( ;; )
+    {
+        bool b_running = false;
+        for( int i = 0; i < p_pool->i_running; i++ )
+        {
+            playlist_job_t *p_job = p_pool->pp_running[i];
+            if( p_job->p_owner == p_owner )
+            {
+                Kill( p_job );
+                b_running = true;
+            }
+        }
+        if( !b_running )
+            break;
+        vlc_cond_wait( &p_pool->wait, &p_pool->lock );
+    }
+    vlc_mutex_unlock( &p_pool->lock );
+}
+
+void playlist_job_Watch( playlist_job_t *p_job, input_thread_t *p_input )
+{
+    playlist_pool_t *p_pool = p_job->p_pool;
+
+    vlc_mutex_lock( &p_pool->lock );
+    p_job->p_input = p_input;
+    if( p_job->b_killed )
+        Kill( p_job );
+    vlc_mutex_unlock( &p_pool->lock );
+}
+
+bool playlist_job_IsKilled( playlist_job_t *p_job )
+{
+    playlist_pool_t *p_pool = p_job->p_pool;
+
+    vlc_mutex_lock( &p_pool->lock );
+    bool b_killed = p_job->b_killed;
+    vlc_mutex_unlock( &p_pool->lock );
+    return b_killed;
+}
+
+/*****************************************************************************
+ * Privates functions
+ *****************************************************************************/
+typedef struct
+{
+    playlist_pool_t *p_pool;
+    playlist_job_t  *p_job;     /* current job, protected by the pool lock */
+} pool_thread_t;
+
+static void Timeout( void *data )
+{
+    pool_thread_t *p_thread = data;
+    playlist_pool_t *p_pool = p_thread->p_pool;
+
+    vlc_mutex_lock( &p_pool->lock );
+    if( p_thread->p_job )
+    {
+        if( !p_thread->p_job->b_killed )
+            msg_Warn( p_pool->p_playlist, "pre-parsing timed out" );
+        Kill( p_thread->p_job );
+    }
+    vlc_mutex_unlock( &p_pool->lock );
+}
+
+/**
+ * This function runs the queued jobs until there is none left
+ */
+static void *Thread( void *data )
+{
+    pool_thread_t thread = { .p_pool = data, .p_job = NULL };
+    playlist_pool_t *p_pool = thread.p_pool;
+    vlc_timer_t timer;
+    bool b_timer = !vlc_timer_create( &timer, Timeout, &thread );
+
+    for( ;; )
+    {
+        playlist_job_t *p_job;
+
+        vlc_mutex_lock( &p_pool->lock );
+        if( p_pool->i_waiting > 0 )
+        {
+            p_job = p_pool->pp_waiting[0];
+            REMOVE_ELEM( p_pool->pp_waiting, p_pool->i_waiting, 0 );
+            INSERT_ELEM( p_pool->pp_running, p_pool->i_running,
+                         p_pool->i_running, p_job );
+            thread.p_job = p_job;
+        }
+        else
+        {
+            p_job = NULL;
+            /* From now on, Push() spawns new threads */
+            p_pool->i_threads--;
+            p_pool->i_exiting++;
+        }
+        vlc_mutex_unlock( &p_pool->lock );
+
+        if( !p_job )
+            break;
+
+        if( b_timer && p_job->i_timeout > 0 )
+            vlc_timer_schedule( timer, false, p_job->i_timeout,
+                                POOL_KILL_INTERVAL );
+
+        p_job->pf_run( p_job->p_owner, p_job->p_item, p_job );
+
+        if( b_timer && p_job->i_timeout > 0 )
+            vlc_timer_schedule( timer, false, 0, 0 );
+
+        vlc_mutex_lock( &p_pool->lock );
+        thread.p_job = NULL;
+        for( int i = 0; i < p_pool->i_running; i++ )
+            if( p_pool->pp_running[i] == p_job )
+            {
+                REMOVE_ELEM( p_pool->pp_running, p_pool->i_running, i );
+                break;
+            }
+        vlc_cond_broadcast( &p_pool->wait );
+        vlc_mutex_unlock( &p_pool->lock );
+
+        vlc_gc_decref( p_job->p_item );
+        free( p_job );
+    }
+
+    if( b_timer )
+        vlc_timer_destroy( timer );
+
+    vlc_mutex_lock( &p_pool->lock );
+    p_pool->i_exiting--;
+    vlc_cond_broadcast( &p_pool->wait );
+    vlc_mutex_unlock( &p_pool->lock );
+    return NULL;
+}
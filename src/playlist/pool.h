@@ -0,0 +1,86 @@
+/*****************************************************************************
+ * pool.h: Preparser and fetcher worker threads
+ *****************************************************************************
+ * Copyright (C) 2012 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef _PLAYLIST_POOL_H
+#define _PLAYLIST_POOL_H 1
+
+/**
+ * Worker pool opaque structure.
+ *
+ * The pool runs the jobs of the preparser and of the fetcher on up to
+ * "preparse-threads" threads, which are spawned when jobs are queued and
+ * exit when there is nothing left to do.
+ */
+typedef struct playlist_pool_t playlist_pool_t;
+
+/**
+ * Job opaque structure, given to the job callback.
+ */
+typedef struct playlist_job_t playlist_job_t;
+
+/**
+ * Job callback. It is called from one of the pool threads, with the owner
+ * and the input item given to playlist_pool_Push().
+ */
+typedef void (*playlist_job_cb)( void *p_owner, input_item_t *,
+                                 playlist_job_t * );
+
+/**
+ * This function creates the pool. No thread is started yet.
+ */
+playlist_pool_t *playlist_pool_New( playlist_t * );
+
+/**
+ * This function destroys the pool.
+ *
+ * All owners must have been cancelled already.
+ */
+void playlist_pool_Delete( playlist_pool_t * );
+
+/**
+ * This function enqueues a job.
+ *
+ * The input item is retained until the job is done or cancelled.
+ * \param b_front queue the job before the others (for visible items)
+ * \param i_timeout time after which the input watched by the job is
+ * stopped, or 0 for no time limit
+ */
+void playlist_pool_Push( playlist_pool_t *, playlist_job_cb, void *p_owner,
+                         input_item_t *, bool b_front, mtime_t i_timeout );
+
+/**
+ * This function removes the pending jobs of an owner, stops the input
+ * watched by its running jobs, and waits for them to return.
+ */
+void playlist_pool_Cancel( playlist_pool_t *, void *p_owner );
+
+/**
+ * This function sets the preparser input to stop when the job times out or
+ * is cancelled (NULL for none). The input must not be released before it is
+ * unset.
+ */
+void playlist_job_Watch( playlist_job_t *, input_thread_t * );
+
+/**
+ * This function tells whether the job timed out or was cancelled.
+ */
+bool playlist_job_IsKilled( playlist_job_t * );
+
+#endif
@@ -29,6 +29,7 @@
 #include <vlc_playlist.h>
 
 #include "art.h"
+#include "pool.h"
 #include "fetcher.h"
 #include "preparser.h"
 #include "../input/input_interface.h"
@@ -41,22 +42,20 @@ struct playlist_preparser_t
 {
     playlist_t          *p_playlist;
     playlist_fetcher_t  *p_fetcher;
+    playlist_pool_t     *p_pool;
 
-    vlc_mutex_t     lock;
-    vlc_cond_t      wait;
-    bool            b_live;
-    input_item_t  **pp_waiting;
-    int             i_waiting;
-
+    mtime_t         i_timeout;
     int             i_art_policy;
 };
 
-static void *Thread( void * );
+static void Job( void *, input_item_t *, playlist_job_t * );
 
 /*****************************************************************************
  * Public functions
  *****************************************************************************/
-playlist_preparser_t *playlist_preparser_New( playlist_t *p_playlist, playlist_fetcher_t *p_fetcher )
+playlist_preparser_t *playlist_preparser_New( playlist_t *p_playlist,
+                                              playlist_pool_t *p_pool,
+                                              playlist_fetcher_t *p_fetcher )
 {
     playlist_preparser_t *p_preparser = malloc( sizeof(*p_preparser) );
     if( !p_preparser )
@@ -64,52 +63,26 @@ playlist_preparser_t *playlist_preparser_New( playlist_t *p_playlist, playlist_f
 
     p_preparser->p_playlist = p_playlist;
     p_preparser->p_fetcher = p_fetcher;
-    vlc_mutex_init( &p_preparser->lock );
-    vlc_cond_init( &p_preparser->wait );
-    p_preparser->b_live = false;
+    p_preparser->p_pool = p_pool;
+    p_preparser->i_timeout = INT64_C(1000) *
+        var_InheritInteger( p_playlist, "preparse-timeout" );
     p_preparser->i_art_policy = var_GetInteger( p_playlist, "album-art" );
-    p_preparser->i_waiting = 0;
-    p_preparser->pp_waiting = NULL;
 
     return p_preparser;
 }
 
-void playlist_preparser_Push( playlist_preparser_t *p_preparser, input_item_t *p_item )
+void playlist_preparser_Push( playlist_preparser_t *p_preparser,
+                              input_item_t *p_item, bool b_visible )
 {
-    vlc_gc_incref( p_item );
-
-    vlc_mutex_lock( &p_preparser->lock );
-    INSERT_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting,
-                 p_preparser->i_waiting, p_item );
-    if( !p_preparser->b_live )
-    {
-        if( vlc_clone_detach( NULL, Thread, p_preparser,
-                              VLC_THREAD_PRIORITY_LOW ) )
-            msg_Warn( p_preparser->p_playlist,
-                      "cannot spawn pre-parser thread" );
-        else
-            p_preparser->b_live = true;
-    }
-    vlc_mutex_unlock( &p_preparser->lock );
+    playlist_pool_Push( p_preparser->p_pool, Job, p_preparser, p_item,
+                        b_visible, p_preparser->i_timeout );
 }
 
 void playlist_preparser_Delete( playlist_preparser_t *p_preparser )
 {
-    vlc_mutex_lock( &p_preparser->lock );
-    /* Remove pending item to speed up preparser thread exit */
-    while( p_preparser->i_waiting > 0 )
-    {
-        vlc_gc_decref( p_preparser->pp_waiting[0] );
-        REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, 0 );
-    }
-
-    while( p_preparser->b_live )
-        vlc_cond_wait( &p_preparser->wait, &p_preparser->lock );
-    vlc_mutex_unlock( &p_preparser->lock );
+    playlist_pool_Cancel( p_preparser->p_pool, p_preparser );
 
     /* Destroy the item preparser */
-    vlc_cond_destroy( &p_preparser->wait );
-    vlc_mutex_destroy( &p_preparser->lock );
     free( p_preparser );
 }
 
@@ -119,7 +92,8 @@ void playlist_preparser_Delete( playlist_preparser_t *p_preparser )
 /**
  * This function preparses an item when needed.
  */
-static void Preparse( playlist_t *p_playlist, input_item_t *p_item )
+static void Preparse( playlist_t *p_playlist, input_item_t *p_item,
+                      playlist_job_t *p_job )
 {
     vlc_mutex_lock( &p_item->lock );
     int i_type = p_item->i_type;
@@ -136,7 +110,16 @@ static void Preparse( playlist_t *p_playlist, input_item_t *p_item )
     /* Do not preparse if it is already done (like by playing it) */
     if( !input_item_IsPreparsed( p_item ) )
     {
-        input_Preparse( VLC_OBJECT(p_playlist), p_item );
+        input_thread_t *p_input =
+            input_CreatePreparser( VLC_OBJECT(p_playlist), p_item );
+        if( p_input )
+        {
+            playlist_job_Watch( p_job, p_input );
+            input_RunPreparser( p_input );
+            playlist_job_Watch( p_job, NULL );
+            vlc_object_release( p_input );
+        }
+        /* Do not try again an item that timed out */
         input_item_SetPreparsed( p_item, true );
 
         var_SetAddress( p_playlist, "item-change", p_item );
@@ -185,44 +168,19 @@ static void Art( playlist_preparser_t *p_preparser, input_item_t *p_item )
     vlc_mutex_unlock( &p_item->lock );
 
     if( b_fetch && p_fetcher )
-        playlist_fetcher_Push( p_fetcher, p_item );
+        playlist_fetcher_Push( p_fetcher, p_item, false );
 }
 
 /**
  * This function does the preparsing and issues the art fetching requests
  */
-static void *Thread( void *data )
+static void Job( void *p_owner, input_item_t *p_item, playlist_job_t *p_job )
 {
-    playlist_preparser_t *p_preparser = data;
-    playlist_t *p_playlist = p_preparser->p_playlist;
+    playlist_preparser_t *p_preparser = p_owner;
 
-    for( ;; )
-    {
-        input_item_t *p_current;
-
-        /* */
-        vlc_mutex_lock( &p_preparser->lock );
-        if( p_preparser->i_waiting > 0 )
-        {
-            p_current = p_preparser->pp_waiting[0];
-            REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, 0 );
-        }
-        else
-        {
-            p_current = NULL;
-            p_preparser->b_live = false;
-            vlc_cond_signal( &p_preparser->wait );
-        }
-        vlc_mutex_unlock( &p_preparser->lock );
-
-        if( !p_current )
-            break;
+    Preparse( p_preparser->p_playlist, p_item, p_job );
 
-        Preparse( p_playlist, p_current );
-
-        Art( p_preparser, p_current );
-        vlc_gc_decref(p_current);
-    }
-    return NULL;
+    if( !playlist_job_IsKilled( p_job ) )
+        Art( p_preparser, p_item );
 }
 
@@ -35,22 +35,27 @@
 typedef struct playlist_preparser_t playlist_preparser_t;
 
 /**
- * This function creates the preparser object and thread.
+ * This function creates the preparser object. It runs in the threads of
+ * the given pool.
  */
-playlist_preparser_t *playlist_preparser_New( playlist_t *, playlist_fetcher_t * );
+playlist_preparser_t *playlist_preparser_New( playlist_t *, playlist_pool_t *,
+                                              playlist_fetcher_t * );
 
 /**
  * This function enqueues the provided item to be preparsed.
  *
  * The input item is retained until the preparsing is done or until the
  * preparser object is deleted.
+ * Visible items are preparsed before the others.
  */
-void playlist_preparser_Push( playlist_preparser_t *, input_item_t * );
+void playlist_preparser_Push( playlist_preparser_t *, input_item_t *,
+                              bool b_visible );
 
 /**
- * This function destroys the preparser object and thread.
+ * This function destroys the preparser object.
  *
- * All pending input items will be released.
+ * All pending input items will be released, and the running preparsing
+ * aborted.
  */
 void playlist_preparser_Delete( playlist_preparser_t * );
 
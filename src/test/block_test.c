@@ -84,10 +84,62 @@ static void test_block (void)
     //assert (block == NULL);
 }
 
+#define FIFO_BLOCKS 5000 /* more than the lock-free ring can hold */
+
+static void *test_fifo_producer (void *data)
+{
+    block_fifo_t *fifo = data;
+
+    for (unsigned i = 0; i < FIFO_BLOCKS; i++)
+    {
+        block_t *block = block_Alloc (sizeof (i));
+        assert (block != NULL);
+        memcpy (block->p_buffer, &i, sizeof (i));
+        block_FifoPut (fifo, block);
+    }
+    return NULL;
+}
+
+static void test_fifo_spsc (void)
+{
+    block_fifo_t *fifo = block_FifoNewSPSC ();
+    vlc_thread_t th;
+
+    assert (fifo != NULL);
+    assert (block_FifoCount (fifo) == 0);
+
+    int val = vlc_clone (&th, test_fifo_producer, fifo,
+                         VLC_THREAD_PRIORITY_LOW);
+    assert (val == 0);
+
+    for (unsigned i = 0; i < FIFO_BLOCKS; i++)
+    {
+        block_t *block = block_FifoShow (fifo);
+        assert (block != NULL);
+        assert (block == block_FifoGet (fifo));
+        assert (block->i_buffer == sizeof (i));
+        assert (!memcmp (block->p_buffer, &i, sizeof (i)));
+        block_Release (block);
+    }
+    vlc_join (th, NULL);
+    assert (block_FifoCount (fifo) == 0);
+    assert (block_FifoSize (fifo) == 0);
+
+    /* Ring overflow without a concurrent consumer */
+    test_fifo_producer (fifo);
+    assert (block_FifoCount (fifo) == FIFO_BLOCKS);
+    block_FifoWake (fifo); /* not empty: must be ignored */
+    block_t *block = block_FifoGet (fifo);
+    assert (block != NULL);
+    block_Release (block);
+    block_FifoRelease (fifo);
+}
+
 int main (void)
 {
     test_block_File ();
     test_block ();
+    test_fifo_spsc ();
     return 0;
 }
 
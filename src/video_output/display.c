@@ -1506,6 +1506,61 @@ static void SplitterPictureDel(video_splitter_t *splitter, picture_t *picture[])
     for (int i = 0; i < wsys->count; i++)
         picture_Release(picture[i]);
 }
+
+/* Pictures sharing the planes of a splitter source picture */
+struct picture_sys_t {
+    picture_t *source;
+};
+
+static void SplitterPictureRefRelease(picture_t *picture)
+{
+    if (--picture->i_refcount > 0)
+        return;
+    picture_Release(picture->p_sys->source);
+    picture_Delete(picture);
+}
+static picture_t *SplitterPictureRef(video_splitter_t *splitter, int index,
+                                     picture_t *source, int x, int y)
+{
+    vout_display_sys_t *wsys = splitter->p_owner->wrapper->sys;
+    vout_display_t *vd = wsys->display[index];
+
+    /* Only the converters of a filtered display can read any pitch, the
+     * others need pictures from the display pool */
+    if (!vout_IsDisplayFiltered(vd) ||
+        vd->source.i_chroma != source->format.i_chroma)
+        return NULL;
+
+    picture_sys_t *sys = malloc(sizeof(*sys));
+    if (!sys)
+        return NULL;
+
+    picture_resource_t rsc;
+    memset(&rsc, 0, sizeof(rsc));
+    rsc.p_sys = sys;
+
+    const plane_t *p0 = &source->p[0];
+    for (int i = 0; i < source->i_planes; i++) {
+        const plane_t *p = &source->p[i];
+        int dx = x * p->i_visible_pitch * p0->i_pixel_pitch / p0->i_visible_pitch;
+        int dy = y * p->i_visible_lines / p0->i_visible_lines;
+
+        dx -= dx % p->i_pixel_pitch;
+        rsc.p[i].p_pixels = &p->p_pixels[dy * p->i_pitch + dx];
+        rsc.p[i].i_lines  = p->i_lines - dy;
+        rsc.p[i].i_pitch  = p->i_pitch;
+    }
+
+    picture_t *picture = picture_NewFromResource(&vd->source, &rsc);
+    if (!picture) {
+        free(sys);
+        return NULL;
+    }
+    sys->source = picture_Hold(source);
+    picture->pf_release = SplitterPictureRefRelease;
+    picture_CopyProperties(picture, source);
+    return picture;
+}
 static void SplitterClose(vout_display_t *vd)
 {
     vout_display_sys_t *sys = vd->sys;
@@ -1572,6 +1627,7 @@ vout_display_t *vout_NewSplitter(vout_thread_t *vout,
     splitter->p_owner = owner;
     splitter->pf_picture_new = SplitterPictureNew;
     splitter->pf_picture_del = SplitterPictureDel;
+    splitter->pf_picture_ref = SplitterPictureRef;
 
     /* */
     TAB_INIT(sys->count, sys->display);
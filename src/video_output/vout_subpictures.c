@@ -51,6 +51,9 @@
 /* Number of simultaneous subpictures */
 #define VOUT_MAX_SUBPICTURES (__MAX(VOUT_MAX_PICTURES, SPU_MAX_PREPARE_TIME/5000))
 
+/* Number of scaled versions kept per region (e.g. windowed and fullscreen) */
+#define SPU_MAX_SCALED_REGIONS (2)
+
 /* */
 typedef struct {
     subpicture_t *subpicture;
@@ -659,7 +662,47 @@ static void SpuSelectSubpictures(spu_t *spu,
     sys->last_sort_date = render_subtitle_date;
 }
 
+/**
+ * It returns the version of the region already scaled to the given size
+ * (and converted to the given chroma unless 0), and moves it first.
+ */
+static subpicture_region_private_t *SpuRegionCacheGet(subpicture_region_t *region,
+                                                      unsigned width, unsigned height,
+                                                      vlc_fourcc_t chroma)
+{
+    for (subpicture_region_private_t **pp = &region->p_private; *pp; pp = &(*pp)->p_next) {
+        subpicture_region_private_t *private = *pp;
+
+        if (private->fmt.i_width  != width ||
+            private->fmt.i_height != height ||
+            (chroma && private->fmt.i_chroma != chroma))
+            continue;
+
+        *pp = private->p_next;
+        private->p_next   = region->p_private;
+        region->p_private = private;
+        return private;
+    }
+    return NULL;
+}
 
+/**
+ * It adds a scaled version of the region, dropping the least recently
+ * used ones beyond SPU_MAX_SCALED_REGIONS.
+ */
+static void SpuRegionCachePut(subpicture_region_t *region,
+                              subpicture_region_private_t *private)
+{
+    private->p_next   = region->p_private;
+    region->p_private = private;
+
+    for (int i = 1; i < SPU_MAX_SCALED_REGIONS && private; i++)
+        private = private->p_next;
+    if (private && private->p_next) {
+        subpicture_region_private_Delete(private->p_next);
+        private->p_next = NULL;
+    }
+}
 
 /**
  * It will transform the provided region into another region suitable for rendering.
@@ -785,31 +828,18 @@ static void SpuRenderRegion(spu_t *spu,
         const unsigned dst_width  = spu_scale_w(region->fmt.i_width,  scale_size);
         const unsigned dst_height = spu_scale_h(region->fmt.i_height, scale_size);
 
-        /* Destroy the cache if unusable */
-        if (region->p_private) {
-            subpicture_region_private_t *private = region->p_private;
-            bool is_changed = false;
-
-            /* Check resize changes */
-            if (dst_width  != private->fmt.i_width ||
-                dst_height != private->fmt.i_height)
-                is_changed = true;
-
-            /* Check forced palette changes */
-            if (changed_palette)
-                is_changed = true;
-
-            if (convert_chroma && private->fmt.i_chroma != chroma_list[0])
-                is_changed = true;
-
-            if (is_changed) {
-                subpicture_region_private_Delete(private);
-                region->p_private = NULL;
-            }
+        /* Destroy the cache on forced palette changes */
+        if (region->p_private && changed_palette) {
+            subpicture_region_private_Delete(region->p_private);
+            region->p_private = NULL;
         }
 
+        subpicture_region_private_t *private =
+            SpuRegionCacheGet(region, dst_width, dst_height,
+                              convert_chroma ? chroma_list[0] : 0);
+
         /* Scale if needed into cache */
-        if (!region->p_private && dst_width > 0 && dst_height > 0) {
+        if (!private && dst_width > 0 && dst_height > 0) {
             filter_t *scale = sys->scale;
 
             picture_t *picture = region->p_picture;
@@ -860,13 +890,10 @@ static void SpuRenderRegion(spu_t *spu,
 
             /* */
             if (picture) {
-                region->p_private = subpicture_region_private_New(&picture->format);
-                if (region->p_private) {
-                    region->p_private->p_picture = picture;
-                    if (!region->p_private->p_picture) {
-                        subpicture_region_private_Delete(region->p_private);
-                        region->p_private = NULL;
-                    }
+                private = subpicture_region_private_New(&picture->format);
+                if (private) {
+                    private->p_picture = picture;
+                    SpuRegionCachePut(region, private);
                 } else {
                     picture_Release(picture);
                 }
@@ -874,9 +901,9 @@ static void SpuRenderRegion(spu_t *spu,
         }
 
         /* And use the scaled picture */
-        if (region->p_private) {
-            region_fmt     = region->p_private->fmt;
-            region_picture = region->p_private->p_picture;
+        if (private) {
+            region_fmt     = private->fmt;
+            region_picture = private->p_picture;
         }
     }
 
@@ -914,6 +941,21 @@ static void SpuRenderRegion(spu_t *spu,
         }
     }
 
+    int fade_alpha = 255;
+    if (subpic->b_fade) {
+        mtime_t fade_start = subpic->i_start + 3 * (subpic->i_stop - subpic->i_start) / 4;
+
+        if (fade_start <= render_date && fade_start < subpic->i_stop)
+            fade_alpha = 255 * (subpic->i_stop - render_date) /
+                               (subpic->i_stop - fade_start);
+    }
+    const int alpha = fade_alpha * subpic->i_alpha * region->i_alpha / 65025;
+
+    /* Do not output a region that would not change a single pixel */
+    if (region_fmt.i_visible_width == 0 || region_fmt.i_visible_height == 0 ||
+        alpha <= 0)
+        goto exit;
+
     subpicture_region_t *dst = *dst_ptr = subpicture_region_New(&region_fmt);
     if (dst) {
         dst->i_x       = x_offset;
@@ -922,15 +964,7 @@ static void SpuRenderRegion(spu_t *spu,
         if (dst->p_picture)
             picture_Release(dst->p_picture);
         dst->p_picture = picture_Hold(region_picture);
-        int fade_alpha = 255;
-        if (subpic->b_fade) {
-            mtime_t fade_start = subpic->i_start + 3 * (subpic->i_stop - subpic->i_start) / 4;
-
-            if (fade_start <= render_date && fade_start < subpic->i_stop)
-                fade_alpha = 255 * (subpic->i_stop - render_date) /
-                                   (subpic->i_stop - fade_start);
-        }
-        dst->i_alpha   = fade_alpha * subpic->i_alpha * region->i_alpha / 65025;
+        dst->i_alpha   = alpha;
     }
 
 exit:
@@ -1088,6 +1122,11 @@ static subpicture_t *SpuRenderSubpictures(spu_t *spu,
     if (subtitle_area != subtitle_area_buffer)
         free(subtitle_area);
 
+    /* Nothing visible: let the vout display the picture untouched */
+    if (!output->p_region) {
+        subpicture_Delete(output);
+        return NULL;
+    }
     return output;
 }
 
@@ -168,11 +168,26 @@ int vout_InitWrapper(vout_thread_t *vout)
 /*****************************************************************************
  *
  *****************************************************************************/
+static void PoolStats(vout_thread_t *vout, const char *name,
+                      picture_pool_t *pool)
+{
+    picture_pool_stats_t stats;
+
+    picture_pool_GetStats(pool, &stats);
+    msg_Dbg(vout, "%s pool: %d pictures, at most %u used, %u times empty",
+            name, picture_pool_GetSize(pool), stats.used_max,
+            stats.starvations);
+}
+
 void vout_EndWrapper(vout_thread_t *vout)
 {
     vout_thread_sys_t *sys = vout->p;
 
     assert(!sys->display.filtered);
+    /* To size the pools */
+    PoolStats(vout, "decoder", sys->decoder_pool);
+    if (sys->private_pool)
+        PoolStats(vout, "private", sys->private_pool);
     if (sys->private_pool)
         picture_pool_Delete(sys->private_pool);
 
@@ -0,0 +1,213 @@
+/*****************************************************************************
+ * bench.c: software volume benchmark
+ *****************************************************************************
+ * Copyright (C) 2012 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Amplifies float and 16 bits samples with the kernels of the float32 and
+ * fixed32 mixers, each one that this CPU runs against the plain C one.
+ *
+ * Usage: test_modules_audio_mixer_bench [-n loops] [-s samples] [-g gain]
+ *
+ * The results of every kernel are checked against the C ones first. The
+ * timings include copying the samples back before each pass. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#include "../../../modules/audio_mixer/gain.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+static double GetWall( void )
+{
+    struct timeval tv;
+
+    gettimeofday( &tv, NULL );
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+typedef struct
+{
+    const char *psz_name;
+    unsigned    i_cpu;
+    void      (*pf_float)( float *, size_t, float );
+    void      (*pf_s16)( int16_t *, size_t, int32_t );
+} kernel_t;
+
+static const kernel_t p_kernels[] =
+{
+    { "c", 0, GainFloatC, GainS16C },
+#if defined (__SSE__)
+    { "sse", CPU_CAPABILITY_SSE, GainFloatSSE, NULL },
+#endif
+#if defined (__SSE2__)
+    { "sse2", CPU_CAPABILITY_SSE2, NULL, GainS16SSE2 },
+#endif
+#if defined (CAN_COMPILE_AVX)
+    { "avx", CPU_CAPABILITY_AVX, GainFloatAVX, NULL },
+#endif
+#if defined (__ARM_NEON__)
+    { "neon", CPU_CAPABILITY_NEON, GainFloatNEON, NULL },
+#endif
+};
+
+static void Print( const char *psz_format, const char *psz_name,
+                   size_t i_samples, int i_loops, double f_wall )
+{
+    printf( "format=%s kernel=%s %.0fMsamples/s\n", psz_format, psz_name,
+            f_wall > 0. ? i_samples * (double)i_loops / f_wall / 1e6 : 0. );
+    fflush( stdout );
+}
+
+static int BenchFloat( size_t i_samples, float f_gain, int i_loops )
+{
+    float *p_src = vlc_memalign( 32, i_samples * sizeof(float) );
+    float *p_ref = vlc_memalign( 32, i_samples * sizeof(float) );
+    float *p_buf = vlc_memalign( 32, i_samples * sizeof(float) );
+    int i_ret = 1;
+
+    if( p_src == NULL || p_ref == NULL || p_buf == NULL )
+        goto end;
+    for( size_t i = 0; i < i_samples; i++ )
+        p_src[i] = rand() / (float)RAND_MAX * 2.f - 1.f;
+    memcpy( p_ref, p_src, i_samples * sizeof(float) );
+    GainFloatC( p_ref, i_samples, f_gain );
+
+    for( size_t k = 0; k < ARRAY_SIZE(p_kernels); k++ )
+    {
+        const kernel_t *p_kernel = &p_kernels[k];
+
+        if( p_kernel->pf_float == NULL ||
+            (vlc_CPU() & p_kernel->i_cpu) != p_kernel->i_cpu )
+            continue;
+
+        memcpy( p_buf, p_src, i_samples * sizeof(float) );
+        p_kernel->pf_float( p_buf, i_samples, f_gain );
+        if( memcmp( p_buf, p_ref, i_samples * sizeof(float) ) )
+        {
+            fprintf( stderr, "%s: mismatch with the C samples\n",
+                     p_kernel->psz_name );
+            goto end;
+        }
+
+        const double f_wall = GetWall();
+        for( int i = 0; i < i_loops; i++ )
+        {
+            memcpy( p_buf, p_src, i_samples * sizeof(float) );
+            p_kernel->pf_float( p_buf, i_samples, f_gain );
+        }
+        Print( "fl32", p_kernel->psz_name, i_samples, i_loops,
+               GetWall() - f_wall );
+    }
+    i_ret = 0;
+end:
+    vlc_free( p_buf );
+    vlc_free( p_ref );
+    vlc_free( p_src );
+    return i_ret;
+}
+
+static int BenchS16( size_t i_samples, float f_gain, int i_loops )
+{
+    const int32_t i_mult = f_gain * 0x1.p16;
+    int16_t *p_src = vlc_memalign( 32, i_samples * sizeof(int16_t) );
+    int16_t *p_ref = vlc_memalign( 32, i_samples * sizeof(int16_t) );
+    int16_t *p_buf = vlc_memalign( 32, i_samples * sizeof(int16_t) );
+    int i_ret = 1;
+
+    if( p_src == NULL || p_ref == NULL || p_buf == NULL )
+        goto end;
+    for( size_t i = 0; i < i_samples; i++ )
+        p_src[i] = rand();
+    memcpy( p_ref, p_src, i_samples * sizeof(int16_t) );
+    GainS16C( p_ref, i_samples, i_mult );
+
+    for( size_t k = 0; k < ARRAY_SIZE(p_kernels); k++ )
+    {
+        const kernel_t *p_kernel = &p_kernels[k];
+
+        if( p_kernel->pf_s16 == NULL ||
+            (vlc_CPU() & p_kernel->i_cpu) != p_kernel->i_cpu )
+            continue;
+
+        memcpy( p_buf, p_src, i_samples * sizeof(int16_t) );
+        p_kernel->pf_s16( p_buf, i_samples, i_mult );
+        if( memcmp( p_buf, p_ref, i_samples * sizeof(int16_t) ) )
+        {
+            fprintf( stderr, "%s: mismatch with the C samples\n",
+                     p_kernel->psz_name );
+            goto end;
+        }
+
+        const double f_wall = GetWall();
+        for( int i = 0; i < i_loops; i++ )
+        {
+            memcpy( p_buf, p_src, i_samples * sizeof(int16_t) );
+            p_kernel->pf_s16( p_buf, i_samples, i_mult );
+        }
+        Print( "s16n", p_kernel->psz_name, i_samples, i_loops,
+               GetWall() - f_wall );
+    }
+    i_ret = 0;
+end:
+    vlc_free( p_buf );
+    vlc_free( p_ref );
+    vlc_free( p_src );
+    return i_ret;
+}
+
+int main( int argc, char **argv )
+{
+    unsigned i_samples = 48000 * 2;
+    float f_gain = 1.5f;
+    int i_loops = 1000;
+    int c;
+
+    while( (c = getopt( argc, argv, "n:s:g:" )) != -1 )
+    {
+        switch( c )
+        {
+            case 'n':
+                i_loops = atoi( optarg );
+                break;
+            case 's':
+                i_samples = strtoul( optarg, NULL, 0 );
+                break;
+            case 'g':
+                f_gain = atof( optarg );
+                break;
+            default:
+                fprintf( stderr, "Usage: %s [-n loops] [-s samples] "
+                         "[-g gain]\n", argv[0] );
+                return 1;
+        }
+    }
+    if( i_loops <= 0 || i_samples == 0 || !(f_gain >= 0.f) || f_gain > 8.f )
+        return 1;
+
+    printf( "cpu=0x%x samples=%u gain=%.3f\n", vlc_CPU(), i_samples, f_gain );
+    return BenchFloat( i_samples, f_gain, i_loops ) ||
+           BenchS16( i_samples, f_gain, i_loops );
+}
@@ -0,0 +1,229 @@
+/*****************************************************************************
+ * bench.c: hardware surface copy benchmark
+ *****************************************************************************
+ * Copyright (C) 2012 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Copies NV12 and YV12 surfaces to YV12 pictures, with the plain C loops
+ * and with the CopyFrom* functions of the avcodec module, which pick their
+ * code path at run time from vlc_CPU().
+ *
+ * Usage: test_modules_avcodec_bench [-n loops] [-s widthxheight]
+ *
+ * The results of both copies are checked against each other first. The
+ * source is ordinary memory, not an actual USWC surface. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <vlc_common.h>
+#include <vlc_picture.h>
+#include <vlc_cpu.h>
+
+#include "../../../modules/codec/avcodec/copy.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+static double GetWall( void )
+{
+    struct timeval tv;
+
+    gettimeofday( &tv, NULL );
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+typedef struct
+{
+    uint8_t *pp_plane[3];
+    size_t   pi_pitch[3];
+    uint8_t *p_buffer;
+} surface_t;
+
+/* Allocates a surface with the usual 64 bytes aligned pitches, filled
+ * with random samples */
+static int SurfaceNew( surface_t *p_surface, bool b_nv12,
+                       unsigned i_width, unsigned i_height )
+{
+    const size_t i_pitch = ( i_width + 63 ) & ~63;
+    const size_t i_chroma = b_nv12 ? i_pitch : i_pitch / 2;
+    const size_t i_size = i_pitch * i_height +
+                          ( b_nv12 ? 1 : 2 ) * i_chroma * i_height / 2;
+
+    p_surface->p_buffer = vlc_memalign( 64, i_size );
+    if( p_surface->p_buffer == NULL )
+        return VLC_ENOMEM;
+    for( size_t i = 0; i < i_size; i++ )
+        p_surface->p_buffer[i] = rand();
+
+    p_surface->pp_plane[0] = p_surface->p_buffer;
+    p_surface->pi_pitch[0] = i_pitch;
+    for( int i = 1; i < 3; i++ )
+    {
+        p_surface->pp_plane[i] = p_surface->pp_plane[i-1] +
+                                 p_surface->pi_pitch[i-1] *
+                                 ( i == 1 ? i_height : i_height / 2 );
+        p_surface->pi_pitch[i] = i_chroma;
+    }
+    return VLC_SUCCESS;
+}
+
+/* Reference copy, as in the C fallback of copy.c */
+static void CopyReference( picture_t *p_dst, const surface_t *p_src,
+                           bool b_nv12, unsigned i_width, unsigned i_height )
+{
+    for( unsigned y = 0; y < i_height; y++ )
+        memcpy( &p_dst->p[0].p_pixels[y * p_dst->p[0].i_pitch],
+                &p_src->pp_plane[0][y * p_src->pi_pitch[0]], i_width );
+
+    for( unsigned y = 0; y < i_height / 2; y++ )
+    {
+        uint8_t *p_v = &p_dst->p[1].p_pixels[y * p_dst->p[1].i_pitch];
+        uint8_t *p_u = &p_dst->p[2].p_pixels[y * p_dst->p[2].i_pitch];
+
+        if( b_nv12 )
+        {
+            const uint8_t *p_uv = &p_src->pp_plane[1][y * p_src->pi_pitch[1]];
+            for( unsigned x = 0; x < i_width / 2; x++ )
+            {
+                p_u[x] = p_uv[2*x+0];
+                p_v[x] = p_uv[2*x+1];
+            }
+        }
+        else
+        {
+            memcpy( p_v, &p_src->pp_plane[1][y * p_src->pi_pitch[1]],
+                    i_width / 2 );
+            memcpy( p_u, &p_src->pp_plane[2][y * p_src->pi_pitch[2]],
+                    i_width / 2 );
+        }
+    }
+}
+
+static void Copy( picture_t *p_dst, surface_t *p_src, bool b_nv12,
+                  unsigned i_width, unsigned i_height, copy_cache_t *p_cache )
+{
+    if( b_nv12 )
+        CopyFromNv12( p_dst, p_src->pp_plane, p_src->pi_pitch,
+                      i_width, i_height, p_cache );
+    else
+        CopyFromYv12( p_dst, p_src->pp_plane, p_src->pi_pitch,
+                      i_width, i_height, p_cache );
+}
+
+static bool PictureEqual( const picture_t *p_a, const picture_t *p_b,
+                          unsigned i_width, unsigned i_height )
+{
+    for( int i = 0; i < p_a->i_planes; i++ )
+    {
+        const unsigned i_w = i ? i_width / 2 : i_width;
+        const unsigned i_h = i ? i_height / 2 : i_height;
+
+        for( unsigned y = 0; y < i_h; y++ )
+            if( memcmp( &p_a->p[i].p_pixels[y * p_a->p[i].i_pitch],
+                        &p_b->p[i].p_pixels[y * p_b->p[i].i_pitch], i_w ) )
+                return false;
+    }
+    return true;
+}
+
+static int Bench( bool b_nv12, unsigned i_width, unsigned i_height,
+                  int i_loops )
+{
+    const char *psz_name = b_nv12 ? "nv12" : "yv12";
+    const double f_size = i_width * i_height * 3. / 2.;
+    surface_t surface;
+    copy_cache_t cache;
+    int i_ret = 1;
+
+    if( SurfaceNew( &surface, b_nv12, i_width, i_height ) )
+        return 1;
+    picture_t *p_ref = picture_New( VLC_CODEC_YV12, i_width, i_height, 1, 1 );
+    picture_t *p_pic = picture_New( VLC_CODEC_YV12, i_width, i_height, 1, 1 );
+    if( p_ref == NULL || p_pic == NULL || CopyInitCache( &cache, i_width ) )
+        goto end;
+
+    CopyReference( p_ref, &surface, b_nv12, i_width, i_height );
+    Copy( p_pic, &surface, b_nv12, i_width, i_height, &cache );
+    if( !PictureEqual( p_ref, p_pic, i_width, i_height ) )
+    {
+        fprintf( stderr, "%s: mismatch with the reference copy\n", psz_name );
+        CopyCleanCache( &cache );
+        goto end;
+    }
+
+    double f_wall = GetWall();
+    for( int i = 0; i < i_loops; i++ )
+        CopyReference( p_ref, &surface, b_nv12, i_width, i_height );
+    const double f_reference = GetWall() - f_wall;
+
+    f_wall = GetWall();
+    for( int i = 0; i < i_loops; i++ )
+        Copy( p_pic, &surface, b_nv12, i_width, i_height, &cache );
+    const double f_copy = GetWall() - f_wall;
+
+    printf( "format=%s c=%.0fMB/s copy=%.0fMB/s\n", psz_name,
+            f_reference > 0. ? f_size * i_loops / f_reference / 1e6 : 0.,
+            f_copy > 0. ? f_size * i_loops / f_copy / 1e6 : 0. );
+    fflush( stdout );
+    CopyCleanCache( &cache );
+    i_ret = 0;
+end:
+    if( p_pic != NULL )
+        picture_Release( p_pic );
+    if( p_ref != NULL )
+        picture_Release( p_ref );
+    vlc_free( surface.p_buffer );
+    return i_ret;
+}
+
+int main( int argc, char **argv )
+{
+    unsigned i_width = 1920, i_height = 1080;
+    int i_loops = 200;
+    int c;
+
+    while( (c = getopt( argc, argv, "n:s:" )) != -1 )
+    {
+        switch( c )
+        {
+            case 'n':
+                i_loops = atoi( optarg );
+                break;
+            case 's':
+                if( sscanf( optarg, "%ux%u", &i_width, &i_height ) == 2 )
+                    break;
+                /* fall through */
+            default:
+                fprintf( stderr, "Usage: %s [-n loops] [-s widthxheight]\n",
+                         argv[0] );
+                return 1;
+        }
+    }
+    /* The surfaces hold whole chroma samples */
+    i_width &= ~1;
+    i_height &= ~1;
+    if( i_loops <= 0 || i_width == 0 || i_height == 0 )
+        return 1;
+
+    printf( "cpu=0x%x size=%ux%u\n", vlc_CPU(), i_width, i_height );
+    return Bench( true, i_width, i_height, i_loops ) ||
+           Bench( false, i_width, i_height, i_loops );
+}
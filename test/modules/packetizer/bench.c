@@ -0,0 +1,254 @@
+/*****************************************************************************
+ * bench.c: startcode search benchmark
+ *****************************************************************************
+ * Copyright (C) 2012 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Looks for all the 00 00 01 startcodes of an H.264 annex B stream, split
+ * in blocks, as the packetizers do, with and without the startcode helper.
+ *
+ * Usage: test_modules_packetizer_bench [-n loops] [-b block size] [file.264]
+ *
+ * Without a file, a stream of random NAL units of typical slice sizes is
+ * generated. The results of both searches are checked against each other,
+ * also with tiny blocks to exercise the startcodes split between blocks. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <vlc_common.h>
+#include <vlc_block_helper.h>
+
+#include "../../../modules/packetizer/startcode_helper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/time.h>
+#if defined(__i386__) || defined(__x86_64__)
+# include <x86intrin.h>
+#endif
+
+static double GetWall( void )
+{
+    struct timeval tv;
+
+    gettimeofday( &tv, NULL );
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static uint64_t GetCycles( void )
+{
+#if defined(__i386__) || defined(__x86_64__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/* Random NAL units with emulation prevention, as an encoder writes them */
+static uint8_t *Generate( size_t i_size )
+{
+    uint8_t *p = malloc( i_size );
+    size_t i = 0;
+
+    if( p == NULL )
+        return NULL;
+
+    srand( 42 );
+    while( i < i_size )
+    {
+        size_t i_nal = 100 + rand() % 30000;
+        int i_zeros = 0;
+
+        for( int j = 0; j < 4 && i < i_size; j++ )
+            p[i++] = j == 3;
+
+        while( i_nal-- > 0 && i < i_size )
+        {
+            uint8_t b = rand() & 0xff;
+
+            /* compressed data holds more zeros than random data */
+            if( rand() % 16 == 0 )
+                b = 0;
+            if( i_zeros >= 2 && b <= 3 )
+            {
+                p[i++] = 0x03;
+                i_zeros = 0;
+                continue;
+            }
+            i_zeros = b ? 0 : i_zeros + 1;
+            p[i++] = b;
+        }
+    }
+    return p;
+}
+
+static uint8_t *Load( const char *psz_file, size_t *pi_size )
+{
+    FILE *file = fopen( psz_file, "rb" );
+    uint8_t *p = NULL;
+    long i_size;
+
+    if( file == NULL )
+        return NULL;
+    if( !fseek( file, 0, SEEK_END ) && ( i_size = ftell( file ) ) > 0 &&
+        !fseek( file, 0, SEEK_SET ) && ( p = malloc( i_size ) ) != NULL &&
+        fread( p, i_size, 1, file ) != 1 )
+    {
+        free( p );
+        p = NULL;
+    }
+    fclose( file );
+    if( p != NULL )
+        *pi_size = i_size;
+    return p;
+}
+
+/* Splits the data in blocks of i_block bytes, or of random sizes up to
+ * -i_block bytes */
+static void Split( block_bytestream_t *p_bs, const uint8_t *p, size_t i_size,
+                   int i_block )
+{
+    block_t *p_chain = NULL, **pp_last = &p_chain;
+
+    block_BytestreamInit( p_bs );
+    while( i_size > 0 )
+    {
+        size_t i_len = i_block > 0 ? (size_t)i_block
+                                   : 1 + (size_t)( rand() % -i_block );
+        if( i_len > i_size )
+            i_len = i_size;
+
+        block_t *p_block = block_Alloc( i_len );
+        if( p_block == NULL )
+            abort();
+        memcpy( p_block->p_buffer, p, i_len );
+        block_ChainLastAppend( &pp_last, p_block );
+        p += i_len;
+        i_size -= i_len;
+    }
+    /* Pushing the blocks one by one would walk the whole chain each time */
+    if( p_chain != NULL )
+        block_BytestreamPush( p_bs, p_chain );
+}
+
+/* Returns the number of startcodes, and a checksum of their offsets */
+static unsigned Scan( block_bytestream_t *p_bs,
+                      block_startcode_helper_t pf_helper, uint64_t *pi_sum )
+{
+    static const uint8_t p_startcode[3] = { 0x00, 0x00, 0x01 };
+    size_t i_offset = 0;
+    unsigned i_count = 0;
+
+    *pi_sum = 0;
+    while( !block_FindStartcodeFromOffset( p_bs, &i_offset, p_startcode, 3,
+                                           pf_helper ) )
+    {
+        i_count++;
+        *pi_sum = *pi_sum * 31 + i_offset;
+        i_offset++;
+    }
+    return i_count;
+}
+
+static void Bench( const char *psz_name, block_bytestream_t *p_bs,
+                   size_t i_size, block_startcode_helper_t pf_helper,
+                   int i_loops )
+{
+    unsigned i_count = 0;
+    uint64_t i_sum;
+
+    const double f_wall = GetWall();
+    const uint64_t i_cycles = GetCycles();
+    for( int i = 0; i < i_loops; i++ )
+        i_count = Scan( p_bs, pf_helper, &i_sum );
+    const double f_time = GetWall() - f_wall;
+    const uint64_t i_total = GetCycles() - i_cycles;
+
+    printf( "search=%s startcodes=%u MB/s=%.0f bytes/cycle=%.2f\n",
+            psz_name, i_count,
+            f_time > 0. ? (double)i_size * i_loops / f_time / 1e6 : 0.,
+            i_total > 0 ? (double)i_size * i_loops / i_total : 0. );
+    fflush( stdout );
+}
+
+int main( int argc, char **argv )
+{
+    int i_loops = 20;
+    int i_block = 4096;
+    int c;
+
+    while( (c = getopt( argc, argv, "n:b:" )) != -1 )
+    {
+        switch( c )
+        {
+            case 'n':
+                i_loops = atoi( optarg );
+                break;
+            case 'b':
+                i_block = atoi( optarg );
+                break;
+            default:
+                fprintf( stderr, "Usage: %s [-n loops] [-b block size] "
+                         "[file.264]\n", argv[0] );
+                return 1;
+        }
+    }
+    if( i_loops <= 0 || i_block <= 0 )
+        return 1;
+
+    size_t i_size = 16 * 1024 * 1024;
+    uint8_t *p_data = optind < argc ? Load( argv[optind], &i_size )
+                                    : Generate( i_size );
+    if( p_data == NULL )
+    {
+        fprintf( stderr, "cannot read the stream\n" );
+        return 1;
+    }
+
+    /* Both searches must find the same startcodes, whatever the blocks */
+    const int pi_check[] = { i_block, 1, 2, 3, -8, -64 };
+    for( unsigned i = 0; i < sizeof(pi_check) / sizeof(*pi_check); i++ )
+    {
+        block_bytestream_t bs;
+        uint64_t i_sum, i_sum_helper;
+
+        Split( &bs, p_data, __MIN( i_size, (size_t)(1 << 20) ), pi_check[i] );
+        const unsigned i_count = Scan( &bs, NULL, &i_sum );
+        const unsigned i_count_helper = Scan( &bs, startcode_FindAnnexB,
+                                              &i_sum_helper );
+        block_BytestreamRelease( &bs );
+
+        if( i_count != i_count_helper || i_sum != i_sum_helper )
+        {
+            fprintf( stderr, "mismatch with %d bytes blocks: %u/%u startcodes\n",
+                     pi_check[i], i_count, i_count_helper );
+            free( p_data );
+            return 1;
+        }
+    }
+
+    block_bytestream_t bs;
+    Split( &bs, p_data, i_size, i_block );
+    Bench( "bytes", &bs, i_size, NULL, i_loops );
+    Bench( "helper", &bs, i_size, startcode_FindAnnexB, i_loops );
+    block_BytestreamRelease( &bs );
+
+    free( p_data );
+    return 0;
+}
@@ -0,0 +1,242 @@
+/*****************************************************************************
+ * bench.c: TS demux and mux benchmark
+ *****************************************************************************
+ * Copyright (C) 2012 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Feeds a recorded TS capture through the TS demuxer, the packetizers and
+ * the TS muxer down to the dummy access output, as fast as possible.
+ *
+ * Usage: test_modules_ts_bench [-n loops] [-- extra VLC options] file.ts
+ *
+ * Each run prints one line per stage, so that the outputs of two builds can
+ * be compared. The "demux" stage stops at the dummy stream output, the
+ * "mux" stage adds the TS muxer, and "mux-only" is the difference. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <vlc/vlc.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#ifdef __GLIBC__
+/* Count the allocations made by the core and the plugins */
+extern void *__libc_malloc( size_t );
+extern void *__libc_calloc( size_t, size_t );
+extern void *__libc_realloc( void *, size_t );
+
+static unsigned long allocs = 0;
+
+void *malloc( size_t size )
+{
+    __sync_fetch_and_add( &allocs, 1 );
+    return __libc_malloc( size );
+}
+
+void *calloc( size_t n, size_t size )
+{
+    __sync_fetch_and_add( &allocs, 1 );
+    return __libc_calloc( n, size );
+}
+
+void *realloc( void *ptr, size_t size )
+{
+    __sync_fetch_and_add( &allocs, 1 );
+    return __libc_realloc( ptr, size );
+}
+
+static unsigned long GetAllocs( void )
+{
+    return __sync_fetch_and_add( &allocs, 0 );
+}
+#else
+static unsigned long GetAllocs( void )
+{
+    return 0;
+}
+#endif
+
+typedef struct
+{
+    double        f_wall;   /* seconds */
+    double        f_cpu;    /* seconds, all threads */
+    unsigned long i_allocs;
+} bench_result_t;
+
+static double GetWall( void )
+{
+    struct timeval tv;
+
+    gettimeofday( &tv, NULL );
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static double GetCPU( void )
+{
+    struct rusage ru;
+
+    getrusage( RUSAGE_SELF, &ru );
+    return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6
+         + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+}
+
+static int Run( const char *psz_file, const char *psz_sout,
+                int i_extra, const char *const *ppsz_extra,
+                bench_result_t *p_res )
+{
+    const char *args[32] = {
+        "--ignore-config",
+        "--quiet",
+        "-I", "dummy",
+        "--no-media-library",
+        "--vout=dummy",
+        "--aout=dummy",
+        "--sout-all",
+        psz_sout,
+    };
+    int i_args = 9;
+
+    for( int i = 0; i < i_extra && i_args < 32; i++ )
+        args[i_args++] = ppsz_extra[i];
+
+    libvlc_instance_t *vlc = libvlc_new( i_args, args );
+    if( vlc == NULL )
+        return -1;
+
+    libvlc_media_t *md = libvlc_media_new_path( vlc, psz_file );
+    if( md == NULL )
+    {
+        libvlc_release( vlc );
+        return -1;
+    }
+    libvlc_media_add_option( md, ":demux=ts" );
+
+    libvlc_media_player_t *mp = libvlc_media_player_new_from_media( md );
+    libvlc_media_release( md );
+    if( mp == NULL )
+    {
+        libvlc_release( vlc );
+        return -1;
+    }
+
+    const unsigned long i_allocs = GetAllocs();
+    const double f_cpu = GetCPU();
+    const double f_wall = GetWall();
+
+    libvlc_media_player_play( mp );
+
+    libvlc_state_t state;
+    do
+    {
+        usleep( 10000 );
+        state = libvlc_media_player_get_state( mp );
+    }
+    while( state != libvlc_Ended && state != libvlc_Error );
+
+    libvlc_media_player_stop( mp );
+
+    p_res->f_wall = GetWall() - f_wall;
+    p_res->f_cpu = GetCPU() - f_cpu;
+    p_res->i_allocs = GetAllocs() - i_allocs;
+
+    libvlc_media_player_release( mp );
+    libvlc_release( vlc );
+    return state == libvlc_Ended ? 0 : -1;
+}
+
+static void Print( const char *psz_stage, int i_loop, unsigned long i_packets,
+                   const bench_result_t *p_res )
+{
+    printf( "stage=%s loop=%d packets=%lu wall=%.3fs cpu=%.3fs "
+            "pkt/s=%.0f cpu-ns/pkt=%.1f allocs/pkt=%.2f\n",
+            psz_stage, i_loop, i_packets, p_res->f_wall, p_res->f_cpu,
+            p_res->f_wall > 0. ? i_packets / p_res->f_wall : 0.,
+            p_res->f_cpu * 1e9 / i_packets,
+            (double)p_res->i_allocs / i_packets );
+    fflush( stdout );
+}
+
+int main( int argc, char **argv )
+{
+    int i_loops = 1;
+    int c;
+
+    while( (c = getopt( argc, argv, "n:" )) != -1 )
+    {
+        switch( c )
+        {
+            case 'n':
+                i_loops = atoi( optarg );
+                break;
+            default:
+                fprintf( stderr, "Usage: %s [-n loops] [-- vlc options] "
+                         "file.ts\n", argv[0] );
+                return 1;
+        }
+    }
+    if( optind >= argc )
+    {
+        fprintf( stderr, "Usage: %s [-n loops] [-- vlc options] file.ts\n",
+                 argv[0] );
+        return 1;
+    }
+
+    const char *psz_file = argv[argc - 1];
+    const char *const *ppsz_extra = (const char *const *)&argv[optind];
+    const int i_extra = argc - 1 - optind;
+
+    struct stat st;
+    if( stat( psz_file, &st ) || st.st_size < 188 )
+    {
+        fprintf( stderr, "%s: invalid capture\n", psz_file );
+        return 1;
+    }
+    const unsigned long i_packets = st.st_size / 188;
+
+    if( getenv( "VLC_PLUGIN_PATH" ) == NULL )
+        setenv( "VLC_PLUGIN_PATH", "../modules", 1 );
+
+    for( int i = 0; i < i_loops; i++ )
+    {
+        bench_result_t demux, mux, diff;
+
+        if( Run( psz_file, "--sout=#dummy", i_extra, ppsz_extra, &demux )
+         || Run( psz_file, "--sout=#std{access=dummy,mux=ts}",
+                 i_extra, ppsz_extra, &mux ) )
+        {
+            fprintf( stderr, "%s: playback failed\n", psz_file );
+            return 1;
+        }
+
+        diff.f_wall = mux.f_wall - demux.f_wall;
+        diff.f_cpu = mux.f_cpu - demux.f_cpu;
+        diff.i_allocs = mux.i_allocs > demux.i_allocs
+                      ? mux.i_allocs - demux.i_allocs : 0;
+
+        Print( "demux", i, i_packets, &demux );
+        Print( "mux", i, i_packets, &mux );
+        Print( "mux-only", i, i_packets, &diff );
+    }
+    return 0;
+}